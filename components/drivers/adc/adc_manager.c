@@ -11,6 +11,11 @@
 #include "adc_manager.h"
 
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
 #include "soc/soc_caps.h"
 #include <string.h>
 
@@ -23,6 +28,50 @@ static const char* TAG = "ADC_SHARED";
 
 static adc_shared_unit_t shared_units[SOC_ADC_PERIPH_NUM] = {0};
 
+// Calibration tables survive deep sleep; the key ties a table to its channel setup
+#define ADC_LUT_MAGIC   0xCA100000u
+typedef struct {
+    uint32_t key;
+    uint16_t mv[ADC_SHARED_LUT_POINTS];
+} adc_lut_cache_t;
+
+static RTC_DATA_ATTR adc_lut_cache_t s_lut_cache[SOC_ADC_PERIPH_NUM][ADC_SHARED_MAX_CHANNELS];
+
+static int adc_bitwidth_bits(adc_bitwidth_t bitwidth) {
+    return (bitwidth == ADC_BITWIDTH_DEFAULT) ? SOC_ADC_RTC_MAX_BITWIDTH : (int)bitwidth;
+}
+
+static uint32_t adc_lut_key(adc_unit_t unit, adc_channel_t channel, adc_atten_t attenuation, int bits) {
+    return ADC_LUT_MAGIC | ((uint32_t)unit << 16) | ((uint32_t)channel << 8) |
+           ((uint32_t)attenuation << 4) | (uint32_t)(bits & 0x0F);
+}
+
+// Serializes unit/channel setup: monitors run in parallel tasks and may register channels concurrently
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Signals waiters in adc_shared_scan() that a new scan pass has completed
+static StaticEventGroup_t s_scan_events_buffer;
+static EventGroupHandle_t s_scan_events = NULL;
+#define ADC_SCAN_DONE_BIT(unit)     (BIT0 << (unit))
+
+static void adc_shared_lock(void) {
+    if (s_lock == NULL) {
+        portENTER_CRITICAL(&s_lock_mux);
+        if (s_lock == NULL) {
+            s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+            s_scan_events = xEventGroupCreateStatic(&s_scan_events_buffer);
+        }
+        portEXIT_CRITICAL(&s_lock_mux);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void adc_shared_unlock(void) {
+    xSemaphoreGive(s_lock);
+}
+
 /**
  * @brief Get pointer to shared ADC unit structure
  * 
@@ -36,7 +85,7 @@ static adc_shared_unit_t* get_shared_unit(adc_unit_t unit) {
     return &shared_units[unit];
 }
 
-esp_err_t adc_shared_init(adc_unit_t unit) {
+static esp_err_t adc_shared_init_locked(adc_unit_t unit) {
     adc_shared_unit_t* shared_unit = get_shared_unit(unit);
     if (shared_unit == NULL) {
         ESP_LOGE(TAG, "Invalid ADC unit: %d", unit);
@@ -69,11 +118,18 @@ esp_err_t adc_shared_init(adc_unit_t unit) {
         shared_unit->channels[i].is_configured = false;
     }
     
+    // Empty scan group with the default block settings
+    memset(&shared_unit->scan, 0, sizeof(shared_unit->scan));
+    shared_unit->scan.config.samples_per_channel = ADC_SHARED_SCAN_DEFAULT_SAMPLES;
+    shared_unit->scan.config.sample_rate_hz = ADC_SHARED_SCAN_DEFAULT_RATE_HZ;
+    shared_unit->scan.config.filter = ADC_SHARED_SCAN_DEFAULT_FILTER;
+    shared_unit->scan.config.trim_percent = ADC_SHARED_SCAN_DEFAULT_TRIM_PERCENT;
+    
     ESP_LOGI(TAG, "Shared ADC unit %d initialized successfully", unit);
     return ESP_OK;
 }
 
-esp_err_t adc_shared_deinit(adc_unit_t unit) {
+static esp_err_t adc_shared_deinit_locked(adc_unit_t unit) {
     adc_shared_unit_t* shared_unit = get_shared_unit(unit);
     if (shared_unit == NULL) {
         ESP_LOGE(TAG, "Invalid ADC unit: %d", unit);
@@ -93,6 +149,12 @@ esp_err_t adc_shared_deinit(adc_unit_t unit) {
     }
     
     // Actually deinitialize when ref count reaches 0
+#if SOC_ADC_DMA_SUPPORTED
+    if (shared_unit->dma_handle != NULL) {
+        adc_continuous_deinit(shared_unit->dma_handle);
+        shared_unit->dma_handle = NULL;
+    }
+#endif
     esp_err_t ret = adc_oneshot_del_unit(shared_unit->handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to deinitialize shared ADC unit %d: %s", unit, esp_err_to_name(ret));
@@ -104,7 +166,7 @@ esp_err_t adc_shared_deinit(adc_unit_t unit) {
     return ESP_OK;
 }
 
-esp_err_t adc_shared_add_channel(adc_unit_t unit, adc_channel_t channel, 
+static esp_err_t adc_shared_add_channel_locked(adc_unit_t unit, adc_channel_t channel, 
                                  adc_bitwidth_t bitwidth, adc_atten_t attenuation, 
                                  float reference_voltage) {
     adc_shared_unit_t* shared_unit = get_shared_unit(unit);
@@ -144,6 +206,20 @@ esp_err_t adc_shared_add_channel(adc_unit_t unit, adc_channel_t channel,
     shared_unit->channels[channel].is_configured = true;
     shared_unit->channels[channel].cali_enabled = false;
     
+    shared_unit->channels[channel].lut_mv = NULL;
+    
+    int bits = adc_bitwidth_bits(bitwidth);
+    adc_lut_cache_t* lut = &s_lut_cache[unit][channel];
+    uint32_t key = adc_lut_key(unit, channel, attenuation, bits);
+    shared_unit->channels[channel].lut_shift = (uint8_t)(bits - ADC_SHARED_LUT_SEGMENT_BITS);
+    if (lut->key == key) {
+        // Table from an earlier boot: the calibration scheme is not needed at all
+        shared_unit->channels[channel].lut_mv = lut->mv;
+        ESP_LOGI(TAG, "ADC channel %d on unit %d: Calibration table restored from RTC memory", channel, unit);
+        ESP_LOGI(TAG, "ADC channel %d configured on unit %d successfully", channel, unit);
+        return ESP_OK;
+    }
+    
     // Initialize ADC calibration (ESP32-C6 uses curve fitting and requires channel!)
     adc_cali_curve_fitting_config_t cali_config = {
         .unit_id = unit,
@@ -156,6 +232,26 @@ esp_err_t adc_shared_add_channel(adc_unit_t unit, adc_channel_t channel,
     if (ret == ESP_OK) {
         shared_unit->channels[channel].cali_enabled = true;
         ESP_LOGI(TAG, "ADC channel %d on unit %d: Calibration enabled (curve fitting)", channel, unit);
+        
+        // Sample the curve at every segment boundary (the last point is the full-scale code)
+        int max_raw = (1 << bits) - 1;
+        lut->key = 0;
+        for (int i = 0; i < ADC_SHARED_LUT_POINTS; i++) {
+            int raw = i << shared_unit->channels[channel].lut_shift;
+            int mv = 0;
+            ret = adc_cali_raw_to_voltage(shared_unit->channels[channel].cali_handle,
+                                          (raw > max_raw) ? max_raw : raw, &mv);
+            if (ret != ESP_OK) {
+                break;
+            }
+            lut->mv[i] = (uint16_t)((mv < 0) ? 0 : mv);
+        }
+        if (ret == ESP_OK) {
+            lut->key = key;
+            shared_unit->channels[channel].lut_mv = lut->mv;
+        } else {
+            ESP_LOGW(TAG, "ADC channel %d: Calibration table not built (%s)", channel, esp_err_to_name(ret));
+        }
     } else {
         ESP_LOGW(TAG, "ADC channel %d on unit %d: Calibration failed (%s), using linear conversion",
                  channel, unit, esp_err_to_name(ret));
@@ -165,7 +261,7 @@ esp_err_t adc_shared_add_channel(adc_unit_t unit, adc_channel_t channel,
     return ESP_OK;
 }
 
-esp_err_t adc_shared_read_raw(adc_unit_t unit, adc_channel_t channel, int* raw_value) {
+static esp_err_t adc_shared_read_raw_locked(adc_unit_t unit, adc_channel_t channel, int* raw_value) {
     if (raw_value == NULL) {
         ESP_LOGE(TAG, "Invalid parameter: raw_value is NULL");
         return ESP_ERR_INVALID_ARG;
@@ -198,7 +294,7 @@ esp_err_t adc_shared_read_raw(adc_unit_t unit, adc_channel_t channel, int* raw_v
     return ESP_OK;
 }
 
-esp_err_t adc_shared_read_voltage(adc_unit_t unit, adc_channel_t channel, float* voltage) {
+esp_err_t adc_shared_raw_to_voltage(adc_unit_t unit, adc_channel_t channel, int raw_value, float* voltage) {
     if (voltage == NULL) {
         ESP_LOGE(TAG, "Invalid parameter: voltage is NULL");
         return ESP_ERR_INVALID_ARG;
@@ -213,21 +309,32 @@ esp_err_t adc_shared_read_voltage(adc_unit_t unit, adc_channel_t channel, float*
     if (channel >= ADC_SHARED_MAX_CHANNELS || !shared_unit->channels[channel].is_configured) {
         ESP_LOGE(TAG, "ADC channel %d not configured on unit %d", channel, unit);
         return ESP_ERR_INVALID_STATE;
-        
-    }
-    
-    int raw_value;
-    esp_err_t ret = adc_shared_read_raw(unit, channel, &raw_value);
-    if (ret != ESP_OK) {
-        return ret;
     }
     
     adc_shared_channel_config_t* ch_config = &shared_unit->channels[channel];
     
+    // Calibration table: interpolate between the two surrounding curve points
+    if (ch_config->lut_mv != NULL) {
+        int max_raw = (1 << adc_bitwidth_bits(ch_config->bitwidth)) - 1;
+        int raw = (raw_value < 0) ? 0 : (raw_value > max_raw) ? max_raw : raw_value;
+        int index = raw >> ch_config->lut_shift;
+        int offset = raw - (index << ch_config->lut_shift);
+        int step = 1 << ch_config->lut_shift;
+        if (index + 1 == ADC_SHARED_LUT_POINTS - 1) {
+            step = max_raw - (index << ch_config->lut_shift);   // Last segment ends at full scale
+        }
+        float mv = ch_config->lut_mv[index] +
+                   (float)(ch_config->lut_mv[index + 1] - ch_config->lut_mv[index]) * offset / step;
+        *voltage = mv / 1000.0f;
+        ESP_LOGD(TAG, "ADC unit %d channel %d: Raw: %d, Calibrated Voltage: %.3f V (table)",
+                 unit, channel, raw_value, *voltage);
+        return ESP_OK;
+    }
+    
     // Use calibrated conversion if available
     if (ch_config->cali_enabled) {
         int voltage_mv = 0;
-        ret = adc_cali_raw_to_voltage(ch_config->cali_handle, raw_value, &voltage_mv);
+        esp_err_t ret = adc_cali_raw_to_voltage(ch_config->cali_handle, raw_value, &voltage_mv);
         if (ret == ESP_OK) {
             *voltage = voltage_mv / 1000.0f;  // Convert mV to V
             ESP_LOGD(TAG, "ADC unit %d channel %d: Raw: %d, Calibrated Voltage: %.3f V", 
@@ -263,7 +370,349 @@ esp_err_t adc_shared_read_voltage(adc_unit_t unit, adc_channel_t channel, float*
     return ESP_OK;
 }
 
-esp_err_t adc_shared_remove_channel(adc_unit_t unit, adc_channel_t channel) {
+esp_err_t adc_shared_read_voltage(adc_unit_t unit, adc_channel_t channel, float* voltage) {
+    if (voltage == NULL) {
+        ESP_LOGE(TAG, "Invalid parameter: voltage is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    int raw_value;
+    esp_err_t ret = adc_shared_read_raw(unit, channel, &raw_value);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    return adc_shared_raw_to_voltage(unit, channel, raw_value, voltage);
+}
+
+// ============================================================================
+// Block Sampling (continuous DMA, oneshot fallback for scans)
+// ============================================================================
+
+/**
+ * @brief Per-channel accumulators of one block
+ */
+typedef struct {
+    int slot_of[ADC_SHARED_MAX_CHANNELS];   ///< Result slot per channel (-1 = not sampled)
+    int64_t sums[ADC_SHARED_MAX_CHANNELS];  ///< Raw sums per slot
+    int counts[ADC_SHARED_MAX_CHANNELS];    ///< Samples per slot
+    uint16_t* store;                        ///< samples_per_channel raw values per slot (NULL = mean only)
+    int samples_per_channel;                ///< Target samples per slot
+    int complete;                           ///< Slots that reached the target
+} adc_block_t;
+
+static esp_err_t adc_block_init(adc_block_t* block, const adc_channel_t* channels, int channel_count,
+                                int samples_per_channel, uint16_t* store) {
+    memset(block, 0, sizeof(*block));
+    for (int c = 0; c < ADC_SHARED_MAX_CHANNELS; c++) {
+        block->slot_of[c] = -1;
+    }
+    for (int i = 0; i < channel_count; i++) {
+        if (block->slot_of[channels[i]] >= 0) {
+            return ESP_ERR_INVALID_ARG;     // Each channel may appear only once
+        }
+        block->slot_of[channels[i]] = i;
+    }
+    block->store = store;
+    block->samples_per_channel = samples_per_channel;
+    return ESP_OK;
+}
+
+static void adc_block_add(adc_block_t* block, uint32_t channel, int raw) {
+    if (channel >= ADC_SHARED_MAX_CHANNELS || block->slot_of[channel] < 0) {
+        return;     // Invalid conversion result
+    }
+    int slot = block->slot_of[channel];
+    if (block->counts[slot] >= block->samples_per_channel) {
+        return;
+    }
+    if (block->store) {
+        block->store[slot * block->samples_per_channel + block->counts[slot]] = (uint16_t)raw;
+    }
+    block->sums[slot] += raw;
+    if (++block->counts[slot] == block->samples_per_channel) {
+        block->complete++;
+    }
+}
+
+static int adc_block_mean(const adc_block_t* block, int slot) {
+    return (int)((block->sums[slot] + block->counts[slot] / 2) / block->counts[slot]);
+}
+
+/**
+ * @brief Filter the stored samples of one slot (sorts them in place)
+ */
+static int adc_block_filter(adc_block_t* block, int slot, adc_shared_filter_t filter, int trim_percent) {
+    if (filter == ADC_SHARED_FILTER_MEAN || block->store == NULL) {
+        return adc_block_mean(block, slot);
+    }
+
+    // Insertion sort: blocks are small and mostly similar values
+    uint16_t* v = &block->store[slot * block->samples_per_channel];
+    int n = block->counts[slot];
+    for (int i = 1; i < n; i++) {
+        uint16_t x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+
+    if (filter == ADC_SHARED_FILTER_MEDIAN) {
+        return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2] + 1) / 2;
+    }
+
+    // Trimmed mean: drop trim_percent of the samples at each end
+    int trim = n * trim_percent / 100;
+    if (2 * trim >= n) {
+        trim = (n - 1) / 2;
+    }
+    int64_t sum = 0;
+    for (int i = trim; i < n - trim; i++) {
+        sum += v[i];
+    }
+    int kept = n - 2 * trim;
+    return (int)((sum + kept / 2) / kept);
+}
+
+#if SOC_ADC_DMA_SUPPORTED
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_DMA_OUTPUT_FORMAT           ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_DMA_GET_CHANNEL(p)          ((p)->type1.channel)
+#define ADC_DMA_GET_DATA(p)             ((p)->type1.data)
+#else
+#define ADC_DMA_OUTPUT_FORMAT           ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_DMA_GET_CHANNEL(p)          ((p)->type2.channel)
+#define ADC_DMA_GET_DATA(p)             ((p)->type2.data)
+#endif
+
+// Conversion frames are only touched while s_lock is held
+static uint8_t s_dma_frame[ADC_SHARED_DMA_FRAME_SIZE];
+
+static esp_err_t adc_shared_dma_prepare(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                        int channel_count, uint32_t sample_rate_hz) {
+    if (shared_unit->dma_handle == NULL) {
+        adc_continuous_handle_cfg_t handle_config = {
+            .max_store_buf_size = ADC_SHARED_DMA_BUFFER_SIZE,
+            .conv_frame_size = ADC_SHARED_DMA_FRAME_SIZE,
+        };
+        esp_err_t ret = adc_continuous_new_handle(&handle_config, &shared_unit->dma_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create continuous ADC handle: %s", esp_err_to_name(ret));
+            shared_unit->dma_handle = NULL;
+            return ret;
+        }
+    }
+    
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {0};
+    for (int i = 0; i < channel_count; i++) {
+        const adc_shared_channel_config_t* ch_config = &shared_unit->channels[channels[i]];
+        pattern[i].atten = ch_config->attenuation;
+        pattern[i].channel = channels[i];
+        pattern[i].unit = shared_unit->unit;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    
+    adc_continuous_config_t dig_config = {
+        .pattern_num = channel_count,
+        .adc_pattern = pattern,
+        .sample_freq_hz = sample_rate_hz,
+        .conv_mode = (shared_unit->unit == ADC_UNIT_1) ? ADC_CONV_SINGLE_UNIT_1 : ADC_CONV_SINGLE_UNIT_2,
+        .format = ADC_DMA_OUTPUT_FORMAT,
+    };
+    return adc_continuous_config(shared_unit->dma_handle, &dig_config);
+}
+
+static esp_err_t adc_shared_dma_collect_locked(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                               int channel_count, uint32_t sample_rate_hz, adc_block_t* block) {
+#ifdef SOC_ADC_DIG_SUPPORTED_UNIT
+    if (!SOC_ADC_DIG_SUPPORTED_UNIT(shared_unit->unit)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+    if (sample_rate_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW) {
+        sample_rate_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    } else if (sample_rate_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        sample_rate_hz = SOC_ADC_SAMPLE_FREQ_THRES_HIGH;
+    }
+    
+    esp_err_t ret = adc_shared_dma_prepare(shared_unit, channels, channel_count, sample_rate_hz);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure continuous ADC: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Give each read a generous multiple of the time the whole block needs
+    uint32_t block_ms = (uint32_t)((uint64_t)block->samples_per_channel * channel_count * 1000ULL / sample_rate_hz);
+    uint32_t read_timeout_ms = block_ms * 2 + 20;
+    
+    adc_continuous_flush_pool(shared_unit->dma_handle);   // Drop conversions left from the last block
+    ret = adc_continuous_start(shared_unit->dma_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start continuous ADC: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    while (block->complete < channel_count) {
+        uint32_t frame_len = 0;
+        ret = adc_continuous_read(shared_unit->dma_handle, s_dma_frame, sizeof(s_dma_frame),
+                                  &frame_len, read_timeout_ms);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Continuous ADC read failed: %s", esp_err_to_name(ret));
+            break;
+        }
+        
+        for (uint32_t off = 0; off + SOC_ADC_DIGI_RESULT_BYTES <= frame_len; off += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* p = (const adc_digi_output_data_t*)&s_dma_frame[off];
+            adc_block_add(block, ADC_DMA_GET_CHANNEL(p), ADC_DMA_GET_DATA(p));
+        }
+    }
+    adc_continuous_stop(shared_unit->dma_handle);
+    
+    if (block->complete < channel_count) {
+        return (ret == ESP_OK) ? ESP_ERR_TIMEOUT : ret;
+    }
+    return ESP_OK;
+}
+
+#else
+
+static esp_err_t adc_shared_dma_collect_locked(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                               int channel_count, uint32_t sample_rate_hz, adc_block_t* block) {
+    (void)shared_unit;
+    (void)channels;
+    (void)channel_count;
+    (void)sample_rate_hz;
+    (void)block;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // SOC_ADC_DMA_SUPPORTED
+
+/**
+ * @brief Collect the block with oneshot reads (round robin over the channels)
+ */
+static esp_err_t adc_shared_oneshot_collect_locked(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                                   int channel_count, adc_block_t* block) {
+    for (int n = 0; n < block->samples_per_channel; n++) {
+        for (int i = 0; i < channel_count; i++) {
+            int raw_value;
+            esp_err_t ret = adc_shared_read_raw_locked(shared_unit->unit, channels[i], &raw_value);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            adc_block_add(block, channels[i], raw_value);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t adc_shared_check_channels_locked(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                                  int channel_count) {
+    if (!shared_unit->is_initialized) {
+        ESP_LOGE(TAG, "Shared ADC unit %d not initialized", shared_unit->unit);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < channel_count; i++) {
+        if (channels[i] >= ADC_SHARED_MAX_CHANNELS || !shared_unit->channels[channels[i]].is_configured) {
+            ESP_LOGE(TAG, "ADC channel %d not configured on unit %d", channels[i], shared_unit->unit);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Calibrate the filtered value of every slot (not the individual samples)
+ */
+static esp_err_t adc_shared_block_results(adc_shared_unit_t* shared_unit, const adc_channel_t* channels,
+                                          int channel_count, adc_block_t* block, adc_shared_filter_t filter,
+                                          int trim_percent, adc_shared_block_result_t* results) {
+    for (int i = 0; i < channel_count; i++) {
+        results[i].channel = channels[i];
+        results[i].sample_count = block->counts[i];
+        results[i].raw = adc_block_filter(block, i, filter, trim_percent);
+        esp_err_t ret = adc_shared_raw_to_voltage(shared_unit->unit, channels[i], results[i].raw, &results[i].voltage);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Scan Group
+// ============================================================================
+
+// Scan sample storage (filters other than the mean need every sample); guarded by s_lock
+static uint16_t s_scan_samples[ADC_SHARED_SCAN_MAX_CHANNELS * ADC_SHARED_SCAN_MAX_SAMPLES];
+
+static esp_err_t adc_shared_scan_run_locked(adc_shared_unit_t* shared_unit) {
+    adc_shared_scan_group_t* group = &shared_unit->scan;
+    if (group->channel_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t ret = adc_shared_check_channels_locked(shared_unit, group->channels, group->channel_count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    adc_block_t block;
+    uint16_t* store = (group->config.filter == ADC_SHARED_FILTER_MEAN) ? NULL : s_scan_samples;
+    ret = adc_block_init(&block, group->channels, group->channel_count,
+                         group->config.samples_per_channel, store);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ret = adc_shared_dma_collect_locked(shared_unit, group->channels, group->channel_count,
+                                        group->config.sample_rate_hz, &block);
+    if (ret != ESP_OK) {
+        if (ret != ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGW(TAG, "DMA scan failed (%s), using oneshot reads", esp_err_to_name(ret));
+        }
+        adc_block_init(&block, group->channels, group->channel_count,
+                       group->config.samples_per_channel, store);
+        ret = adc_shared_oneshot_collect_locked(shared_unit, group->channels, group->channel_count, &block);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    
+    adc_shared_scan_result_t* result = &group->last_result;
+    ret = adc_shared_block_results(shared_unit, group->channels, group->channel_count, &block,
+                                   group->config.filter, group->config.trim_percent, result->channels);
+    if (ret != ESP_OK) {
+        result->channel_count = 0;
+        return ret;
+    }
+    result->channel_count = group->channel_count;
+    result->timestamp_us = esp_timer_get_time();
+    xEventGroupSetBits(s_scan_events, ADC_SCAN_DONE_BIT(shared_unit->unit));
+    
+    ESP_LOGD(TAG, "Scan on unit %d: %d channels x %d samples", shared_unit->unit,
+             group->channel_count, group->config.samples_per_channel);
+    return ESP_OK;
+}
+
+static void adc_shared_scan_remove_locked(adc_shared_unit_t* shared_unit, adc_channel_t channel) {
+    adc_shared_scan_group_t* group = &shared_unit->scan;
+    for (int i = 0; i < group->channel_count; i++) {
+        if (group->channels[i] == channel) {
+            memmove(&group->channels[i], &group->channels[i + 1],
+                    (group->channel_count - i - 1) * sizeof(group->channels[0]));
+            group->channel_count--;
+            group->last_result.channel_count = 0;   // Cached pass no longer matches the group
+            return;
+        }
+    }
+}
+
+static esp_err_t adc_shared_remove_channel_locked(adc_unit_t unit, adc_channel_t channel) {
     adc_shared_unit_t* shared_unit = get_shared_unit(unit);
     if (shared_unit == NULL) {
         ESP_LOGE(TAG, "Invalid ADC unit: %d", unit);
@@ -282,6 +731,8 @@ esp_err_t adc_shared_remove_channel(adc_unit_t unit, adc_channel_t channel) {
         ESP_LOGD(TAG, "ADC calibration deleted for channel %d", channel);
     }
     
+    adc_shared_scan_remove_locked(shared_unit, channel);
+    shared_unit->channels[channel].lut_mv = NULL;     // RTC table stays cached for the next boot
     shared_unit->channels[channel].is_configured = false;
     ESP_LOGI(TAG, "ADC channel %d removed from unit %d", channel, unit);
     return ESP_OK;
@@ -293,4 +744,197 @@ bool adc_shared_is_initialized(adc_unit_t unit) {
         return false;
     }
     return shared_unit->is_initialized;
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Locked entry points
+// ============================================================================
+
+// Oneshot reads would fail with ESP_ERR_TIMEOUT while a DMA block owns the unit
+esp_err_t adc_shared_read_raw(adc_unit_t unit, adc_channel_t channel, int* raw_value) {
+    adc_shared_lock();
+    esp_err_t ret = adc_shared_read_raw_locked(unit, channel, raw_value);
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_read_block(adc_unit_t unit, const adc_channel_t* channels, int channel_count,
+                                int samples_per_channel, uint32_t sample_rate_hz,
+                                adc_shared_block_result_t* results) {
+    if (channels == NULL || results == NULL || channel_count <= 0 ||
+        channel_count > SOC_ADC_PATT_LEN_MAX || channel_count > ADC_SHARED_MAX_CHANNELS ||
+        samples_per_channel <= 0 || samples_per_channel > ADC_SHARED_DMA_MAX_SAMPLES ||
+        sample_rate_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    adc_shared_unit_t* shared_unit = get_shared_unit(unit);
+    if (shared_unit == NULL) {
+        ESP_LOGE(TAG, "Invalid ADC unit: %d", unit);
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    adc_shared_lock();
+    adc_block_t block;
+    esp_err_t ret = adc_shared_check_channels_locked(shared_unit, channels, channel_count);
+    if (ret == ESP_OK) {
+        ret = adc_block_init(&block, channels, channel_count, samples_per_channel, NULL);
+    }
+    if (ret == ESP_OK) {
+        ret = adc_shared_dma_collect_locked(shared_unit, channels, channel_count, sample_rate_hz, &block);
+    }
+    if (ret == ESP_OK) {
+        ret = adc_shared_block_results(shared_unit, channels, channel_count, &block,
+                                       ADC_SHARED_FILTER_MEAN, 0, results);
+    }
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_scan_add_channel(adc_unit_t unit, adc_channel_t channel) {
+    adc_shared_unit_t* shared_unit = get_shared_unit(unit);
+    if (shared_unit == NULL || channel >= ADC_SHARED_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    adc_shared_lock();
+    esp_err_t ret = ESP_OK;
+    adc_shared_scan_group_t* group = &shared_unit->scan;
+    if (!shared_unit->is_initialized || !shared_unit->channels[channel].is_configured) {
+        ESP_LOGE(TAG, "ADC channel %d not configured on unit %d", channel, unit);
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        bool member = false;
+        for (int i = 0; i < group->channel_count; i++) {
+            member |= (group->channels[i] == channel);
+        }
+        if (!member) {
+            if (group->channel_count >= ADC_SHARED_SCAN_MAX_CHANNELS ||
+                group->channel_count >= SOC_ADC_PATT_LEN_MAX) {
+                ret = ESP_ERR_NO_MEM;
+            } else {
+                group->channels[group->channel_count++] = channel;
+                group->last_result.channel_count = 0;
+                ESP_LOGI(TAG, "ADC channel %d joined scan group of unit %d (%d channels)",
+                         channel, unit, group->channel_count);
+            }
+        }
+    }
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_scan_remove_channel(adc_unit_t unit, adc_channel_t channel) {
+    adc_shared_unit_t* shared_unit = get_shared_unit(unit);
+    if (shared_unit == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc_shared_lock();
+    adc_shared_scan_remove_locked(shared_unit, channel);
+    adc_shared_unlock();
+    return ESP_OK;
+}
+
+esp_err_t adc_shared_scan_configure(adc_unit_t unit, const adc_shared_scan_config_t* config) {
+    adc_shared_unit_t* shared_unit = get_shared_unit(unit);
+    if (shared_unit == NULL || config == NULL || config->sample_rate_hz == 0 ||
+        config->samples_per_channel <= 0 || config->samples_per_channel > ADC_SHARED_SCAN_MAX_SAMPLES ||
+        config->trim_percent < 0 || config->trim_percent >= 50) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc_shared_lock();
+    shared_unit->scan.config = *config;
+    shared_unit->scan.last_result.channel_count = 0;
+    adc_shared_unlock();
+    return ESP_OK;
+}
+
+esp_err_t adc_shared_scan(adc_unit_t unit, int64_t not_before_us, uint32_t wait_ms,
+                          adc_shared_scan_result_t* result) {
+    adc_shared_unit_t* shared_unit = get_shared_unit(unit);
+    if (shared_unit == NULL || result == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)wait_ms * 1000;
+    adc_shared_scan_result_t* last = &shared_unit->scan.last_result;
+    esp_err_t ret = ESP_OK;
+    
+    adc_shared_lock();
+    while (1) {
+        // Share a pass that is recent enough for this caller
+        if (last->channel_count > 0 && last->timestamp_us >= not_before_us) {
+            break;
+        }
+        
+        int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0) {
+            ret = adc_shared_scan_run_locked(shared_unit);
+            break;
+        }
+        
+        // Let another consumer's pass serve this one too
+        xEventGroupClearBits(s_scan_events, ADC_SCAN_DONE_BIT(unit));
+        adc_shared_unlock();
+        EventBits_t bits = xEventGroupWaitBits(s_scan_events, ADC_SCAN_DONE_BIT(unit), pdFALSE, pdFALSE,
+                                               pdMS_TO_TICKS(remaining_us / 1000) + 1);
+        adc_shared_lock();
+        if (!(bits & ADC_SCAN_DONE_BIT(unit))) {
+            deadline_us = 0;    // Nobody scanned in time: run the pass here
+        }
+    }
+    if (ret == ESP_OK) {
+        *result = *last;
+    }
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_scan_get(const adc_shared_scan_result_t* result, adc_channel_t channel,
+                              float* voltage, int* raw_value) {
+    if (result == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < result->channel_count; i++) {
+        if (result->channels[i].channel == channel) {
+            if (voltage) {
+                *voltage = result->channels[i].voltage;
+            }
+            if (raw_value) {
+                *raw_value = result->channels[i].raw;
+            }
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t adc_shared_init(adc_unit_t unit) {
+    adc_shared_lock();
+    esp_err_t ret = adc_shared_init_locked(unit);
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_deinit(adc_unit_t unit) {
+    adc_shared_lock();
+    esp_err_t ret = adc_shared_deinit_locked(unit);
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_add_channel(adc_unit_t unit, adc_channel_t channel, 
+                                 adc_bitwidth_t bitwidth, adc_atten_t attenuation, 
+                                 float reference_voltage) {
+    adc_shared_lock();
+    esp_err_t ret = adc_shared_add_channel_locked(unit, channel, bitwidth, attenuation, reference_voltage);
+    adc_shared_unlock();
+    return ret;
+}
+
+esp_err_t adc_shared_remove_channel(adc_unit_t unit, adc_channel_t channel) {
+    adc_shared_lock();
+    esp_err_t ret = adc_shared_remove_channel_locked(unit, channel);
+    adc_shared_unlock();
+    return ret;
+}
@@ -14,6 +14,7 @@
 #include "adc_manager.h"
 
 #include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
 #include "esp_err.h"
@@ -21,6 +22,31 @@
 // Maximum number of channels per ADC unit
 #define ADC_SHARED_MAX_CHANNELS 8
 
+// Calibration lookup table: piecewise-linear raw -> mV over 2^ADC_SHARED_LUT_SEGMENT_BITS segments
+#define ADC_SHARED_LUT_SEGMENT_BITS     5
+#define ADC_SHARED_LUT_POINTS           ((1 << ADC_SHARED_LUT_SEGMENT_BITS) + 1)
+
+// Continuous (DMA) sampling
+#define ADC_SHARED_DMA_FRAME_SIZE       256     ///< Bytes per DMA conversion frame
+#define ADC_SHARED_DMA_BUFFER_SIZE      1024    ///< Driver-side ring buffer in bytes
+#define ADC_SHARED_DMA_MAX_SAMPLES      1024    ///< Upper bound for samples per channel in one block
+
+// Scan group (one conversion pass over every registered channel of a unit)
+#define ADC_SHARED_SCAN_MAX_CHANNELS    4       ///< Channels per scan group
+#define ADC_SHARED_SCAN_MAX_SAMPLES     128     ///< Samples per channel in one scan
+#ifndef ADC_SHARED_SCAN_DEFAULT_SAMPLES
+#define ADC_SHARED_SCAN_DEFAULT_SAMPLES         64
+#endif
+#ifndef ADC_SHARED_SCAN_DEFAULT_RATE_HZ
+#define ADC_SHARED_SCAN_DEFAULT_RATE_HZ         20000
+#endif
+#ifndef ADC_SHARED_SCAN_DEFAULT_FILTER
+#define ADC_SHARED_SCAN_DEFAULT_FILTER          ADC_SHARED_FILTER_TRIMMED_MEAN
+#endif
+#ifndef ADC_SHARED_SCAN_DEFAULT_TRIM_PERCENT
+#define ADC_SHARED_SCAN_DEFAULT_TRIM_PERCENT    10
+#endif
+
 /**
  * @brief Channel configuration for shared ADC
  */
@@ -30,10 +56,60 @@ typedef struct {
     adc_atten_t attenuation;            ///< ADC attenuation
     float reference_voltage;            ///< Reference voltage for calculations (fallback)
     adc_cali_handle_t cali_handle;      ///< ADC calibration handle
+    const uint16_t* lut_mv;             ///< Calibration table in RTC memory (NULL = not built)
+    uint8_t lut_shift;                  ///< Raw bits below the segment index
     bool is_configured;                 ///< Channel configuration status
     bool cali_enabled;                  ///< Calibration status
 } adc_shared_channel_config_t;
 
+/**
+ * @brief Result of a block read for one channel
+ */
+typedef struct {
+    adc_channel_t channel;              ///< ADC channel
+    int raw;                            ///< Filtered raw value of the block
+    float voltage;                      ///< Calibrated voltage of the filtered raw value
+    int sample_count;                   ///< Samples that went into the filter
+} adc_shared_block_result_t;
+
+/**
+ * @brief Filter applied to the samples of one channel
+ */
+typedef enum {
+    ADC_SHARED_FILTER_MEAN = 0,         ///< Arithmetic mean
+    ADC_SHARED_FILTER_MEDIAN,           ///< Median (robust against single spikes)
+    ADC_SHARED_FILTER_TRIMMED_MEAN      ///< Mean without the lowest/highest trim_percent
+} adc_shared_filter_t;
+
+/**
+ * @brief Scan group block settings
+ */
+typedef struct {
+    int samples_per_channel;            ///< Samples per channel and pass (max ADC_SHARED_SCAN_MAX_SAMPLES)
+    uint32_t sample_rate_hz;            ///< Conversion rate of the pattern
+    adc_shared_filter_t filter;         ///< Filter applied per channel
+    int trim_percent;                   ///< Samples dropped at each end for the trimmed mean (0-49)
+} adc_shared_scan_config_t;
+
+/**
+ * @brief Calibrated voltages of every channel in one scan pass
+ */
+typedef struct {
+    int64_t timestamp_us;               ///< esp_timer time the pass completed
+    int channel_count;                  ///< Valid entries in channels (0 = no pass yet)
+    adc_shared_block_result_t channels[ADC_SHARED_SCAN_MAX_CHANNELS]; ///< Per-channel results
+} adc_shared_scan_result_t;
+
+/**
+ * @brief Channels sampled together by adc_shared_scan()
+ */
+typedef struct {
+    adc_channel_t channels[ADC_SHARED_SCAN_MAX_CHANNELS]; ///< Registered channels
+    int channel_count;                  ///< Number of registered channels
+    adc_shared_scan_config_t config;    ///< Block settings
+    adc_shared_scan_result_t last_result; ///< Most recent pass (shared between consumers)
+} adc_shared_scan_group_t;
+
 /**
  * @brief Shared ADC unit structure
  */
@@ -42,6 +118,8 @@ typedef struct {
     adc_unit_t unit;                    ///< ADC unit
     int ref_count;                      ///< Reference counter
     adc_shared_channel_config_t channels[ADC_SHARED_MAX_CHANNELS]; ///< Channel configurations
+    adc_continuous_handle_t dma_handle; ///< Continuous-mode handle (created on first block read)
+    adc_shared_scan_group_t scan;       ///< Scan group of the unit
     bool is_initialized;                ///< Initialization status
 } adc_shared_unit_t;
 
@@ -64,6 +142,10 @@ esp_err_t adc_shared_deinit(adc_unit_t unit);
 /**
  * @brief Add and configure a channel to shared ADC unit
  * 
+ * Samples the calibration curve once into a piecewise-linear lookup table, so
+ * converting raw values needs no calibration driver call. The table is kept in
+ * RTC memory and reused after deep sleep without touching the calibration scheme.
+ * 
  * @param unit ADC unit
  * @param channel ADC channel to add
  * @param bitwidth ADC resolution
@@ -95,6 +177,99 @@ esp_err_t adc_shared_read_raw(adc_unit_t unit, adc_channel_t channel, int* raw_v
  */
 esp_err_t adc_shared_read_voltage(adc_unit_t unit, adc_channel_t channel, float* voltage);
 
+/**
+ * @brief Convert a raw value of a configured channel to volts
+ * 
+ * Uses the channel calibration if available, otherwise a linear conversion
+ * against the channel reference voltage.
+ * 
+ * @param unit ADC unit
+ * @param channel ADC channel the value was sampled on
+ * @param raw_value Raw (or filtered raw) ADC value
+ * @param voltage Pointer to store voltage value
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t adc_shared_raw_to_voltage(adc_unit_t unit, adc_channel_t channel, int raw_value, float* voltage);
+
+/**
+ * @brief Sample a block of conversions for one or more channels via DMA
+ * 
+ * Runs the continuous ADC driver at sample_rate_hz with all channels in one
+ * conversion pattern until every channel has samples_per_channel results,
+ * averages the raw values per channel and calibrates the mean. The channels
+ * must have been added with adc_shared_add_channel(); oneshot reads on the
+ * unit are held off while the block runs.
+ * 
+ * @param unit ADC unit (must support DMA, ADC_UNIT_1 on the ESP32-C6)
+ * @param channels Channels to sample
+ * @param channel_count Number of channels
+ * @param samples_per_channel Samples to average per channel
+ * @param sample_rate_hz Conversion rate of the pattern (clamped to the hardware range)
+ * @param results One entry per channel, in the order of channels
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED without DMA support,
+ *         ESP_ERR_TIMEOUT if the block did not complete
+ */
+esp_err_t adc_shared_read_block(adc_unit_t unit, const adc_channel_t* channels, int channel_count,
+                                int samples_per_channel, uint32_t sample_rate_hz,
+                                adc_shared_block_result_t* results);
+
+/**
+ * @brief Add a configured channel to the scan group of its unit
+ * 
+ * @param unit ADC unit
+ * @param channel Channel added with adc_shared_add_channel()
+ * @return esp_err_t ESP_OK on success (also if already a member),
+ *         ESP_ERR_NO_MEM if the group is full
+ */
+esp_err_t adc_shared_scan_add_channel(adc_unit_t unit, adc_channel_t channel);
+
+/**
+ * @brief Remove a channel from the scan group (adc_shared_remove_channel() does this too)
+ * 
+ * @param unit ADC unit
+ * @param channel Channel to remove
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t adc_shared_scan_remove_channel(adc_unit_t unit, adc_channel_t channel);
+
+/**
+ * @brief Change the block settings of a scan group
+ * 
+ * @param unit ADC unit
+ * @param config Samples, rate and filter for every following pass
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for out-of-range settings
+ */
+esp_err_t adc_shared_scan_configure(adc_unit_t unit, const adc_shared_scan_config_t* config);
+
+/**
+ * @brief Get calibrated voltages of every scan group channel from one pass
+ * 
+ * A pass completed at or after not_before_us is shared: consumers on different
+ * tasks get the same acquisition instead of sampling the ADC one after another.
+ * If no such pass exists, this waits up to wait_ms for another consumer to run
+ * one and otherwise runs the pass itself (DMA block, oneshot reads as fallback).
+ * 
+ * @param unit ADC unit
+ * @param not_before_us Oldest acceptable pass (esp_timer time; use the current time to force a new pass)
+ * @param wait_ms Time to wait for a pass run by another consumer (0 = scan now if needed)
+ * @param result Receives the pass
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the group is empty
+ */
+esp_err_t adc_shared_scan(adc_unit_t unit, int64_t not_before_us, uint32_t wait_ms,
+                          adc_shared_scan_result_t* result);
+
+/**
+ * @brief Look up one channel in a scan result
+ * 
+ * @param result Scan pass
+ * @param channel Channel to look up
+ * @param voltage Receives the calibrated voltage (may be NULL)
+ * @param raw_value Receives the filtered raw value (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the channel was not scanned
+ */
+esp_err_t adc_shared_scan_get(const adc_shared_scan_result_t* result, adc_channel_t channel,
+                              float* voltage, int* raw_value);
+
 /**
  * @brief Remove channel from shared ADC unit
  * 
@@ -14,10 +14,55 @@
 #include "csm_v2_driver.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
 #include <string.h>
 
+#if CONFIG_APP_SOIL_LP_POWER
+#include "csm_v2_lp_power.h"
+#endif
+
 static const char* TAG = "CSM_V2";
 
+// Replace the calibration curve; the slope of every segment is computed once here
+static esp_err_t csm_v2_set_curve(csm_v2_driver_t* driver, const csm_v2_cal_point_t* points, size_t count) {
+    csm_v2_cal_point_t sorted[CSM_V2_MAX_CAL_POINTS];
+    memcpy(sorted, points, count * sizeof(csm_v2_cal_point_t));
+    
+    // Insertion sort by voltage (at most a handful of points)
+    for (size_t i = 1; i < count; i++) {
+        csm_v2_cal_point_t p = sorted[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1].voltage > p.voltage) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = p;
+    }
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (sorted[i + 1].voltage - sorted[i].voltage <= 0.0f) {
+            ESP_LOGE(TAG, "Invalid calibration curve: duplicate voltage %.3fV", sorted[i].voltage);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    
+    memcpy(driver->cal_points, sorted, count * sizeof(csm_v2_cal_point_t));
+    for (size_t i = 0; i + 1 < count; i++) {
+        driver->cal_slopes[i] = (sorted[i + 1].percent - sorted[i].percent) /
+                                (sorted[i + 1].voltage - sorted[i].voltage);
+    }
+    driver->cal_count = (uint8_t)count;
+    return ESP_OK;
+}
+
+static esp_err_t csm_v2_set_two_point(csm_v2_driver_t* driver, float dry_voltage, float wet_voltage) {
+    const csm_v2_cal_point_t points[2] = {
+        { .voltage = wet_voltage, .percent = 100.0f },
+        { .voltage = dry_voltage, .percent = 0.0f },
+    };
+    return csm_v2_set_curve(driver, points, 2);
+}
+
 esp_err_t csm_v2_get_default_config(csm_v2_config_t* config, adc_unit_t adc_unit, adc_channel_t adc_channel, int power_pin) {
     if (config == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -41,8 +86,13 @@ esp_err_t csm_v2_init(csm_v2_driver_t* driver, const csm_v2_config_t* config) {
     // Copy configuration
     memcpy(&driver->config, config, sizeof(csm_v2_config_t));
     
+    esp_err_t ret = csm_v2_set_two_point(driver, config->dry_voltage, config->wet_voltage);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
     // Initialize shared ADC unit
-    esp_err_t ret = adc_shared_init(config->adc_unit);
+    ret = adc_shared_init(config->adc_unit);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize shared ADC unit: %s", esp_err_to_name(ret));
         return ret;
@@ -57,6 +107,15 @@ esp_err_t csm_v2_init(csm_v2_driver_t* driver, const csm_v2_config_t* config) {
         return ret;
     }
     
+    // Sample together with the other channels of the unit
+    ret = adc_shared_scan_add_channel(config->adc_unit, config->adc_channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add soil sensor channel to scan group: %s", esp_err_to_name(ret));
+        adc_shared_remove_channel(config->adc_unit, config->adc_channel);
+        adc_shared_deinit(config->adc_unit);
+        return ret;
+    }
+    
     // Initialize power control GPIO pin
     ret = csm_v2_init_power_pin(driver);
     if (ret != ESP_OK) {
@@ -110,6 +169,21 @@ esp_err_t csm_v2_deinit(csm_v2_driver_t* driver) {
 }
 
 
+/**
+ * @brief Sample the channel in a scan pass started after the sensor was powered
+ *
+ * Other scan group members (e.g. the battery channel) get their values from
+ * the same pass.
+ */
+static esp_err_t csm_v2_sample(csm_v2_driver_t* driver, int* raw_avg, float* voltage) {
+    adc_shared_scan_result_t result;
+    esp_err_t ret = adc_shared_scan(driver->config.adc_unit, esp_timer_get_time(), 0, &result);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return adc_shared_scan_get(&result, driver->config.adc_channel, voltage, raw_avg);
+}
+
 esp_err_t csm_v2_read_voltage(csm_v2_driver_t* driver, float* voltage) {
     if (driver == NULL || voltage == NULL) {
         ESP_LOGE(TAG, "Invalid parameters");
@@ -121,30 +195,14 @@ esp_err_t csm_v2_read_voltage(csm_v2_driver_t* driver, float* voltage) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Multisampling to reduce noise (recommended by Espressif)
-    const int samples = 64;  // Average 64 readings
-    int64_t raw_sum = 0;
-    
-    for (int i = 0; i < samples; i++) {
-        int raw_value;
-        esp_err_t ret = adc_shared_read_raw(driver->config.adc_unit, driver->config.adc_channel, &raw_value);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read raw ADC: %s", esp_err_to_name(ret));
-            return ret;
-        }
-        raw_sum += raw_value;
-    }
-    
-    int raw_avg = (int)(raw_sum / samples);
-    
-    // Convert average to voltage using calibration
-    esp_err_t ret = adc_shared_read_voltage(driver->config.adc_unit, driver->config.adc_channel, voltage);
+    int raw_avg = 0;
+    esp_err_t ret = csm_v2_sample(driver, &raw_avg, voltage);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read voltage: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    ESP_LOGD(TAG, "Soil: RawAvg=%d (n=%d), Voltage=%.3fV", raw_avg, samples, *voltage);
+    ESP_LOGD(TAG, "Soil: RawAvg=%d, Voltage=%.3fV", raw_avg, *voltage);
     return ESP_OK;
 }
 
@@ -162,16 +220,10 @@ esp_err_t csm_v2_read(csm_v2_driver_t* driver, csm_v2_reading_t* reading) {
     // Read timestamp
     reading->timestamp = esp_utils_get_timestamp_ms();
     
-    // Read raw ADC value
-    esp_err_t ret = adc_shared_read_raw(driver->config.adc_unit, driver->config.adc_channel, &reading->raw_adc);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read raw ADC: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Read voltage
-    ret = csm_v2_read_voltage(driver, &reading->voltage);
+    // Raw value and voltage both come from the same averaged block
+    esp_err_t ret = csm_v2_sample(driver, &reading->raw_adc, &reading->voltage);
     if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read voltage: %s", esp_err_to_name(ret));
         return ret;
     }
     
@@ -195,6 +247,10 @@ esp_err_t csm_v2_calibrate(csm_v2_driver_t* driver, float dry_voltage, float wet
         return ESP_ERR_INVALID_ARG;
     }
     
+    esp_err_t ret = csm_v2_set_two_point(driver, dry_voltage, wet_voltage);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     driver->config.dry_voltage = dry_voltage;
     driver->config.wet_voltage = wet_voltage;
     driver->config.enable_calibration = true;
@@ -203,6 +259,27 @@ esp_err_t csm_v2_calibrate(csm_v2_driver_t* driver, float dry_voltage, float wet
     return ESP_OK;
 }
 
+esp_err_t csm_v2_calibrate_table(csm_v2_driver_t* driver, const csm_v2_cal_point_t* points, size_t count) {
+    if (driver == NULL || points == NULL || count < 2 || count > CSM_V2_MAX_CAL_POINTS) {
+        ESP_LOGE(TAG, "Invalid calibration table");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = csm_v2_set_curve(driver, points, count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Keep the two-point view in sync with the curve ends
+    driver->config.wet_voltage = driver->cal_points[0].voltage;
+    driver->config.dry_voltage = driver->cal_points[count - 1].voltage;
+    driver->config.enable_calibration = true;
+    
+    ESP_LOGI(TAG, "Calibration curve updated: %u points, %.3fV..%.3fV",
+             (unsigned)count, driver->config.wet_voltage, driver->config.dry_voltage);
+    return ESP_OK;
+}
+
 esp_err_t csm_v2_init_power_pin(csm_v2_driver_t* driver) {
     if (driver == NULL) {
         ESP_LOGE(TAG, "Invalid parameter");
@@ -214,6 +291,16 @@ esp_err_t csm_v2_init_power_pin(csm_v2_driver_t* driver) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    driver->lp_powered = false;
+#if CONFIG_APP_SOIL_LP_POWER
+    // The LP core may have switched the supply on during the last sleep: keep it on
+    driver->lp_powered = csm_v2_lp_power_release(driver->config.esp_pin_power);
+    if (driver->lp_powered) {
+        ESP_LOGI(TAG, "Power pin GPIO%d initialized (powered by the LP core)", driver->config.esp_pin_power);
+        return ESP_OK;
+    }
+#endif
+    
     // Configure the GPIO pin for power control
     gpio_reset_pin(driver->config.esp_pin_power);
     esp_err_t ret = gpio_set_direction(driver->config.esp_pin_power, GPIO_MODE_OUTPUT);
@@ -294,6 +381,42 @@ esp_err_t csm_v2_get_power_state(csm_v2_driver_t* driver, bool* is_powered) {
     return ESP_OK;
 }
 
+// MARK: SENSOR HAL
+static esp_err_t csm_v2_hal_prepare(void* ctx) {
+    return csm_v2_enable_power((csm_v2_driver_t*)ctx);
+}
+
+static esp_err_t csm_v2_hal_read(void* ctx, sensor_hal_reading_t* reading) {
+    csm_v2_reading_t r;
+    esp_err_t ret = csm_v2_read((csm_v2_driver_t*)ctx, &r);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    reading->values[0] = r.voltage;
+    reading->values[1] = r.moisture_percent;
+    reading->count = 2;
+    reading->raw = r.raw_adc;
+    return ESP_OK;
+}
+
+static esp_err_t csm_v2_hal_power_down(void* ctx) {
+    return csm_v2_disable_power((csm_v2_driver_t*)ctx);
+}
+
+static const sensor_hal_ops_t s_hal_ops = {
+    .prepare = csm_v2_hal_prepare,
+    .start_conversion = NULL,           // The ADC scan runs inside read()
+    .read = csm_v2_hal_read,
+    .power_down = csm_v2_hal_power_down,
+};
+
+void csm_v2_get_sensor_hal(csm_v2_driver_t* driver, sensor_hal_t* hal) {
+    hal->name = "soil";
+    hal->ops = &s_hal_ops;
+    hal->ctx = driver;
+    hal->warmup_ms = CSM_V2_WARMUP_MS;
+    hal->conversion_ms = 0;
+}
 
 // MARK: UTILS
 float csm_v2_voltage_to_percent(csm_v2_driver_t* driver, float voltage) {
@@ -301,16 +424,23 @@ float csm_v2_voltage_to_percent(csm_v2_driver_t* driver, float voltage) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    float moisture_percent = 0;
-    
-    if (voltage >= driver->config.dry_voltage) {
-        moisture_percent = 0.0f;
-    } else if (voltage <= driver->config.wet_voltage) {
-        moisture_percent = 100.0f;
+    const csm_v2_cal_point_t* points = driver->cal_points;
+    int last = driver->cal_count - 1;
+    float moisture_percent;
+    
+    // Outside the curve the nearest end point applies
+    if (last < 1) {
+        return 0.0f;
+    } else if (voltage <= points[0].voltage) {
+        moisture_percent = points[0].percent;
+    } else if (voltage >= points[last].voltage) {
+        moisture_percent = points[last].percent;
     } else {
-        moisture_percent = 
-            ((driver->config.dry_voltage - voltage) / 
-                (driver->config.dry_voltage - driver->config.wet_voltage)) * 100.0f;
+        int seg = 0;
+        while (voltage > points[seg + 1].voltage) {
+            seg++;
+        }
+        moisture_percent = points[seg].percent + (voltage - points[seg].voltage) * driver->cal_slopes[seg];
     }
     
     // Clamp to [0, 100]
@@ -15,12 +15,16 @@
 
 #include "esp_utils.h"
 #include "adc_manager.h"
+#include "sensor_hal.h"
+#include <stddef.h>
 
 /**
  * Parameters
  */
 #define CSM_V2_DRY_VOLTAGE_DEFAULT    3.0f   ///< Default dry voltage (in volts)
 #define CSM_V2_WET_VOLTAGE_DEFAULT    1.0f   ///< Default wet voltage (in volts)
+#define CSM_V2_MAX_CAL_POINTS         8      ///< Points in a multi-point calibration curve
+#define CSM_V2_WARMUP_MS              1000   ///< Output settling time after power-up
 
 
 
@@ -36,11 +40,23 @@ typedef struct {
     bool enable_calibration;            ///< Enable automatic calibration
 } csm_v2_config_t;
 
+/**
+ * @brief Calibration point: sensor voltage measured at a known moisture
+ */
+typedef struct {
+    float voltage;                      ///< Sensor voltage (in volts)
+    float percent;                      ///< Moisture at that voltage (0-100%)
+} csm_v2_cal_point_t;
+
 /**
  * @brief Soil moisture sensor handle
  */
 typedef struct {
     csm_v2_config_t config;             ///< Sensor configuration
+    csm_v2_cal_point_t cal_points[CSM_V2_MAX_CAL_POINTS];  ///< Calibration curve, ascending voltage
+    float cal_slopes[CSM_V2_MAX_CAL_POINTS - 1];           ///< Percent per volt of each segment
+    uint8_t cal_count;                  ///< Points in the calibration curve
+    bool lp_powered;                    ///< Supply switched on by the LP core before this wake
     bool is_initialized;                ///< Initialization status
 } csm_v2_driver_t;
 
@@ -110,6 +126,19 @@ esp_err_t csm_v2_read(csm_v2_driver_t* driver, csm_v2_reading_t* reading);
  */
 esp_err_t csm_v2_calibrate(csm_v2_driver_t* driver, float dry_voltage, float wet_voltage);
 
+/**
+ * @brief Calibrate the sensor with a multi-point curve
+ * 
+ * Moisture is interpolated linearly between neighbouring points and clamped to
+ * the outermost points. The points may be given in any order.
+ * 
+ * @param driver Pointer to driver handle
+ * @param points Calibration points (distinct voltages)
+ * @param count Number of points (2..CSM_V2_MAX_CAL_POINTS)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on a bad curve
+ */
+esp_err_t csm_v2_calibrate_table(csm_v2_driver_t* driver, const csm_v2_cal_point_t* points, size_t count);
+
 /**
  * @brief Initialize GPIO pin for power control
  * 
@@ -143,6 +172,18 @@ esp_err_t csm_v2_disable_power(csm_v2_driver_t* driver);
  */
 esp_err_t csm_v2_get_power_state(csm_v2_driver_t* driver, bool* is_powered);
 
+/**
+ * @brief Describe the sensor through the generic sensor interface
+ * 
+ * prepare/power_down switch the supply pin, read() samples the channel in a
+ * shared ADC scan pass. Reading values: [0] voltage (V), [1] moisture (%),
+ * raw is the averaged ADC value.
+ * 
+ * @param driver Pointer to an initialized driver handle (must outlive the descriptor)
+ * @param hal Descriptor to fill
+ */
+void csm_v2_get_sensor_hal(csm_v2_driver_t* driver, sensor_hal_t* hal);
+
 // MARK: UTILS
 float csm_v2_voltage_to_percent(csm_v2_driver_t* driver, float voltage);
 
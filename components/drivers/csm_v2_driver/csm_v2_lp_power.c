@@ -0,0 +1,74 @@
+/**
+ * @file csm_v2_lp_power.c
+ * @brief CSM V2 Sensor Supply from the LP Core - Implementation
+ */
+
+#include "csm_v2_lp_power.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "ulp_lp_core.h"
+#include "ulp_csm_v2.h"
+
+static const char* TAG = "CSM_V2_LP";
+
+extern const uint8_t ulp_csm_v2_bin_start[] asm("_binary_ulp_csm_v2_bin_start");
+extern const uint8_t ulp_csm_v2_bin_end[] asm("_binary_ulp_csm_v2_bin_end");
+
+esp_err_t csm_v2_lp_power_arm(int power_pin, uint32_t power_on_in_ms) {
+    if (!rtc_gpio_is_valid_gpio(power_pin)) {
+        ESP_LOGE(TAG, "GPIO%d is not an LP IO, the LP core cannot switch it", power_pin);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (power_on_in_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = ulp_lp_core_load_binary(ulp_csm_v2_bin_start, ulp_csm_v2_bin_end - ulp_csm_v2_bin_start);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load LP program: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Supply off until the LP core switches it on
+    rtc_gpio_init(power_pin);
+    rtc_gpio_set_direction(power_pin, RTC_GPIO_MODE_OUTPUT_ONLY);
+    rtc_gpio_set_level(power_pin, 0);
+    
+    ulp_power_pin = (uint32_t)power_pin;    // LP IO numbers are the GPIO numbers
+    ulp_power_on_count = 0;
+    
+    ulp_lp_core_cfg_t cfg = {
+        .wakeup_source = ULP_LP_CORE_WAKEUP_SOURCE_LP_TIMER,
+        .lp_timer_sleep_duration_us = (uint64_t)power_on_in_ms * 1000ULL,
+    };
+    ret = ulp_lp_core_run(&cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start LP program: %s", esp_err_to_name(ret));
+        rtc_gpio_deinit(power_pin);
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "LP core switches GPIO%d on in %lu ms", power_pin, (unsigned long)power_on_in_ms);
+    return ESP_OK;
+}
+
+bool csm_v2_lp_power_release(int power_pin) {
+    if (!rtc_gpio_is_valid_gpio(power_pin)) {
+        return false;
+    }
+    
+    ulp_lp_core_stop();
+    // LP memory only holds the program's state after a deep sleep wake
+    bool powered = (esp_reset_reason() == ESP_RST_DEEPSLEEP) && ulp_power_on_count > 0;
+    ulp_power_on_count = 0;
+    
+    if (powered) {
+        // Keep the supply on across the hand-over from the LP IO to the GPIO driver
+        gpio_set_direction(power_pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(power_pin, 1);
+    }
+    rtc_gpio_deinit(power_pin);
+    return powered;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file csm_v2_lp_power.h
+ * @brief CSM V2 Sensor Supply from the LP Core
+ *
+ * The sensor needs CSM_V2_WARMUP_MS of supply before its output is valid. The
+ * main core would otherwise wake, switch the supply on and wait that long
+ * with the CPU and flash powered. Before deep sleep the LP core is armed to
+ * switch the supply on the warm-up time ahead of the wake; the main core then
+ * finds a settled sensor and samples it at once.
+ *
+ * The ESP32-C6 ADC is in the main (HP) power domain and cannot be read by
+ * the LP core, so sampling stays on the main core.
+ *
+ * The supply pin must be an LP IO (GPIO0-7 on the ESP32-C6). Requires
+ * CONFIG_APP_SOIL_LP_POWER, which needs the LP core ULP enabled in menuconfig.
+ *
+ * Usage:
+ *   csm_v2_lp_power_arm(pin, sleep_ms - CSM_V2_WARMUP_MS);   // before deep sleep
+ *   bool warm = csm_v2_lp_power_release(pin);                // after the wake
+ */
+
+#ifndef CSM_V2_LP_POWER_H
+#define CSM_V2_LP_POWER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Let the LP core switch the sensor supply on during the coming sleep
+ *
+ * Hands the pin (supply off) to the LP IO domain and starts the LP program on
+ * the LP timer.
+ *
+ * @param power_pin Sensor supply pin (LP IO)
+ * @param power_on_in_ms Time from now until the supply is switched on
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the pin is no LP IO
+ *         or the time is 0
+ */
+esp_err_t csm_v2_lp_power_arm(int power_pin, uint32_t power_on_in_ms);
+
+/**
+ * @brief Stop the LP program and give the supply pin back to the GPIO driver
+ *
+ * A supply the LP core has switched on stays on (the pin is driven high by
+ * the GPIO driver before the LP IO releases it). Safe to call when nothing
+ * was armed.
+ *
+ * @param power_pin Sensor supply pin
+ * @return true if the LP core switched the supply on during the last sleep
+ */
+bool csm_v2_lp_power_release(int power_pin);
+
+#endif // CSM_V2_LP_POWER_H
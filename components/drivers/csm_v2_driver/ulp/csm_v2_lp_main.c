@@ -0,0 +1,26 @@
+/**
+ * @file csm_v2_lp_main.c
+ * @brief CSM V2 Sensor Supply - LP Core Program
+ *
+ * Runs on the LP core while the main core is in deep sleep. The LP timer
+ * starts it the sensor's warm-up time before the main core wakes; it switches
+ * the sensor supply on, so the output has settled by the time the main core
+ * samples it. Built with ulp_embed_binary() (CONFIG_APP_SOIL_LP_POWER).
+ */
+
+#include <stdint.h>
+#include "ulp_lp_core_gpio.h"
+
+volatile uint32_t power_pin;        // LP IO of the sensor supply (set by the main core)
+volatile uint32_t power_on_count;   // Runs that switched the supply on (cleared by the main core)
+
+int main(void)
+{
+    // The LP timer restarts the program every period until the main core stops it;
+    // later runs find the supply already on
+    ulp_lp_core_gpio_init((lp_io_num_t)power_pin);
+    ulp_lp_core_gpio_output_enable((lp_io_num_t)power_pin);
+    ulp_lp_core_gpio_set_level((lp_io_num_t)power_pin, 1);
+    power_on_count++;
+    return 0;
+}
@@ -7,7 +7,14 @@
  */
 
 #include "epaper_driver.h"
+#include "perf_profiler.h"
+#include "event_counters.h"
+#include "esp_attr.h"
+#include "esp_crc.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
@@ -17,6 +24,22 @@
 
 static const char* TAG = "EPAPER";
 
+#define EPAPER_RTC_MAGIC  0x45504432  // "EPD2"
+
+// What the panel shows, kept across deep sleep (the panel keeps its image without power)
+typedef struct {
+    uint32_t magic;
+    uint32_t fb_size;
+    uint32_t crc;                       // CRC32 of the displayed framebuffer
+    uint16_t image_len;                 // PackBits bytes in image (0 = CRC only)
+    uint8_t model;
+    uint8_t partial_update_count;
+    uint32_t ghost_px;                  // Pixels flipped by partial refreshes since the last full one
+    uint8_t image[EPAPER_RETAIN_MAX_BYTES];
+} epaper_rtc_state_t;
+
+static RTC_DATA_ATTR epaper_rtc_state_t s_retained;
+
 // Simple 5x8 bitmap font for ASCII characters 32-126
 static const uint8_t font_5x8[][5] = {
     {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
@@ -134,58 +157,152 @@ static const epaper_spec_t display_specs[] = {
 // Low-Level SPI Communication
 // ============================================================================
 
+// trans->user carries the DC pin and level for the pre-transfer callback
+#define EPAPER_DC_USER(pin, level)  ((void*)(uintptr_t)(((uint32_t)(pin) << 1) | ((level) & 1)))
+
 /**
- * @brief Send command byte to display (DC=LOW)
+ * @brief Drive DC right before each queued transaction goes out
  */
-static esp_err_t epaper_send_command(epaper_driver_t* driver, uint8_t cmd) {
-    gpio_set_level(driver->config.dc_pin, 0);  // DC=0 for command
+static void IRAM_ATTR epaper_spi_pre_cb(spi_transaction_t* trans) {
+    uintptr_t user = (uintptr_t)trans->user;
+    gpio_set_level((gpio_num_t)(user >> 1), user & 1);
+}
+
+/**
+ * @brief Collect queued transactions until at most max_inflight remain
+ */
+static esp_err_t epaper_spi_reap(epaper_driver_t* driver, uint8_t max_inflight) {
+    esp_err_t ret = ESP_OK;
+    while (driver->trans_inflight > max_inflight) {
+        spi_transaction_t* done = NULL;
+        esp_err_t r = spi_device_get_trans_result(driver->spi, &done, portMAX_DELAY);
+        if (r != ESP_OK) {
+            ret = r;
+            break;
+        }
+        driver->trans_inflight--;
+    }
+    return ret;
+}
+
+/**
+ * @brief Wait until every queued transaction has been sent
+ */
+static esp_err_t epaper_spi_flush(epaper_driver_t* driver) {
+    return epaper_spi_reap(driver, 0);
+}
+
+/**
+ * @brief Queue one transaction (DC=LOW for commands, HIGH for data)
+ *
+ * Up to 4 bytes are copied into the transaction; longer buffers are sent by
+ * DMA in place and must stay untouched until the next flush.
+ */
+static esp_err_t epaper_spi_queue(epaper_driver_t* driver, bool is_data, const uint8_t* buf, size_t len) {
+    if (len == 0) return ESP_OK;
     
-    spi_transaction_t trans = {
-        .length = 8,
-        .tx_buffer = &cmd,
-        .flags = SPI_TRANS_USE_TXDATA,
-    };
-    trans.tx_data[0] = cmd;
+    // Reuse the oldest slot once the pipeline is full (results arrive in order)
+    esp_err_t ret = epaper_spi_reap(driver, EPAPER_SPI_QUEUE_SIZE - 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    return spi_device_transmit(driver->spi, &trans);
+    spi_transaction_t* trans = &driver->trans[driver->trans_next];
+    memset(trans, 0, sizeof(*trans));
+    trans->length = len * 8;
+    trans->user = EPAPER_DC_USER(driver->config.dc_pin, is_data ? 1 : 0);
+    if (len <= sizeof(trans->tx_data)) {
+        trans->flags = SPI_TRANS_USE_TXDATA;
+        memcpy(trans->tx_data, buf, len);
+    } else {
+        trans->tx_buffer = buf;
+    }
+    
+    ret = spi_device_queue_trans(driver->spi, trans, portMAX_DELAY);
+    if (ret == ESP_OK) {
+        driver->trans_next = (driver->trans_next + 1) % EPAPER_SPI_QUEUE_SIZE;
+        driver->trans_inflight++;
+    }
+    return ret;
+}
+
+/**
+ * @brief Send command byte to display (DC=LOW)
+ */
+static esp_err_t epaper_send_command(epaper_driver_t* driver, uint8_t cmd) {
+    return epaper_spi_queue(driver, false, &cmd, 1);
 }
 
 /**
  * @brief Send data byte to display (DC=HIGH)
  */
 static esp_err_t epaper_send_data(epaper_driver_t* driver, uint8_t data) {
-    gpio_set_level(driver->config.dc_pin, 1);  // DC=1 for data
-    
-    spi_transaction_t trans = {
-        .length = 8,
-        .tx_buffer = &data,
-        .flags = SPI_TRANS_USE_TXDATA,
-    };
-    trans.tx_data[0] = data;
-    
-    return spi_device_transmit(driver->spi, &trans);
+    return epaper_spi_queue(driver, true, &data, 1);
 }
 
 /**
  * @brief Send data buffer to display (DC=HIGH)
  */
 static esp_err_t epaper_send_data_buffer(epaper_driver_t* driver, const uint8_t* data, size_t len) {
-    if (len == 0) return ESP_OK;
-    
-    gpio_set_level(driver->config.dc_pin, 1);  // DC=1 for data
-    
-    spi_transaction_t trans = {
-        .length = len * 8,
-        .tx_buffer = data,
-    };
+    return epaper_spi_queue(driver, true, data, len);
+}
+
+/**
+ * @brief Send a command followed by its parameter bytes
+ */
+static esp_err_t epaper_send_sequence(epaper_driver_t* driver, uint8_t cmd, const uint8_t* data, size_t len) {
+    esp_err_t ret = epaper_send_command(driver, cmd);
+    if (ret == ESP_OK) {
+        ret = epaper_send_data_buffer(driver, data, len);
+    }
+    return ret;
+}
+
+static void IRAM_ATTR epaper_busy_isr(void* arg) {
+    epaper_driver_t* driver = (epaper_driver_t*)arg;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(driver->busy_sem, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ * @brief Hook the BUSY falling edge; without it epaper_wait_idle polls
+ */
+static void epaper_busy_irq_init(epaper_driver_t* driver) {
+    driver->busy_sem = xSemaphoreCreateBinary();
+    if (driver->busy_sem == NULL) {
+        return;
+    }
     
-    return spi_device_transmit(driver->spi, &trans);
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret == ESP_OK || ret == ESP_ERR_INVALID_STATE) {    // Already installed by someone else
+        ret = gpio_set_intr_type(driver->config.busy_pin, GPIO_INTR_NEGEDGE);
+    }
+    if (ret == ESP_OK) {
+        ret = gpio_isr_handler_add(driver->config.busy_pin, epaper_busy_isr, driver);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "BUSY interrupt unavailable (%s), polling instead", esp_err_to_name(ret));
+        vSemaphoreDelete(driver->busy_sem);
+        driver->busy_sem = NULL;
+    }
+}
+
+static void epaper_busy_irq_deinit(epaper_driver_t* driver) {
+    if (driver->busy_sem != NULL) {
+        gpio_isr_handler_remove(driver->config.busy_pin);
+        vSemaphoreDelete(driver->busy_sem);
+        driver->busy_sem = NULL;
+    }
 }
 
 /**
  * @brief Hardware reset via RST pin
  */
 static esp_err_t epaper_hw_reset(epaper_driver_t* driver) {
+    epaper_spi_flush(driver);
     gpio_set_level(driver->config.rst_pin, 0);
     vTaskDelay(pdMS_TO_TICKS(10));
     gpio_set_level(driver->config.rst_pin, 1);
@@ -201,21 +318,225 @@ esp_err_t epaper_wait_idle(epaper_driver_t* driver, uint32_t timeout_ms) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    // The command that made the controller busy must have gone out first
+    epaper_spi_flush(driver);
+    
     uint32_t start_time = xTaskGetTickCount();
     uint32_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
     
     while (gpio_get_level(driver->config.busy_pin) == 1) {
-        if ((xTaskGetTickCount() - start_time) > timeout_ticks) {
+        uint32_t elapsed = xTaskGetTickCount() - start_time;
+        if (elapsed > timeout_ticks) {
             ESP_LOGW(TAG, "Wait idle timeout after %lu ms", timeout_ms);
             return ESP_ERR_TIMEOUT;
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        if (driver->busy_sem != NULL) {
+            // Blocks until the falling edge (a stale give only costs one more level check)
+            xSemaphoreTake(driver->busy_sem, timeout_ticks - elapsed + 1);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
     }
     
     ESP_LOGD(TAG, "Display idle");
     return ESP_OK;
 }
 
+// ============================================================================
+// Windowed RAM Transfer
+// ============================================================================
+
+// RAM window in controller units: x in bytes (8 pixels), y in rows, both inclusive
+typedef struct {
+    uint16_t x0;
+    uint16_t x1;
+    uint16_t y0;
+    uint16_t y1;
+} epaper_window_t;
+
+/**
+ * @brief Bounding box of the framebuffer bytes that differ from the controller RAM
+ *
+ * @param changed_px Receives the number of pixels that differ
+ * @return false if nothing changed
+ */
+static bool epaper_find_dirty(const epaper_driver_t* driver, epaper_window_t* win, uint32_t* changed_px) {
+    const uint32_t bytes_per_row = (driver->config.width + 7) / 8;
+    bool dirty = false;
+    *changed_px = 0;
+    
+    for (uint16_t y = 0; y < driver->config.height; y++) {
+        const uint8_t* row = driver->framebuffer + y * bytes_per_row;
+        const uint8_t* old = driver->ram_shadow + y * bytes_per_row;
+        if (memcmp(row, old, bytes_per_row) == 0) {
+            continue;
+        }
+        
+        uint16_t first = 0;
+        while (row[first] == old[first]) {
+            first++;
+        }
+        uint16_t last = bytes_per_row - 1;
+        while (row[last] == old[last]) {
+            last--;
+        }
+        for (uint16_t x = first; x <= last; x++) {
+            *changed_px += __builtin_popcount(row[x] ^ old[x]);
+        }
+        
+        if (!dirty) {
+            win->x0 = first;
+            win->x1 = last;
+            win->y0 = y;
+            dirty = true;
+        } else {
+            if (first < win->x0) win->x0 = first;
+            if (last > win->x1) win->x1 = last;
+        }
+        win->y1 = y;
+    }
+    
+    return dirty;
+}
+
+/**
+ * @brief Write a window of the framebuffer to a controller RAM (0x24 or 0x26)
+ *
+ * Sets the RAM X/Y window (0x44/0x45) and address counters (0x4E/0x4F); the
+ * controller wraps to the next row at the window edge, so the data is the
+ * window's bytes row by row. SSD1680 and SSD1681 share these commands.
+ */
+static esp_err_t epaper_write_ram_window(epaper_driver_t* driver, uint8_t ram_cmd,
+                                         const epaper_window_t* win, const uint8_t* data) {
+    const uint8_t x_range[2] = { win->x0, win->x1 };
+    const uint8_t y_range[4] = { win->y0 & 0xFF, win->y0 >> 8, win->y1 & 0xFF, win->y1 >> 8 };
+    epaper_send_sequence(driver, 0x44, x_range, sizeof(x_range));
+    epaper_send_sequence(driver, 0x45, y_range, sizeof(y_range));
+    epaper_send_sequence(driver, 0x4E, x_range, 1);
+    epaper_send_sequence(driver, 0x4F, y_range, 2);
+    
+    size_t len = (size_t)(win->x1 - win->x0 + 1) * (win->y1 - win->y0 + 1);
+    epaper_send_command(driver, ram_cmd);
+    return epaper_send_data_buffer(driver, data, len);
+}
+
+// ============================================================================
+// Retained Frame (RTC Memory)
+// ============================================================================
+
+/**
+ * @brief PackBits-encode a buffer (mostly white frames compress well)
+ *
+ * @return Encoded length, 0 if it does not fit into cap
+ */
+static size_t epaper_packbits_encode(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    size_t i = 0;
+    size_t o = 0;
+    
+    while (i < len) {
+        size_t run = 1;
+        while (i + run < len && run < 128 && in[i + run] == in[i]) {
+            run++;
+        }
+        
+        if (run >= 2) {
+            if (o + 2 > cap) {
+                return 0;
+            }
+            out[o++] = (uint8_t)(257 - run);    // 129..255: repeat next byte
+            out[o++] = in[i];
+            i += run;
+        } else {
+            // Literal bytes up to the start of the next run
+            size_t lit = 1;
+            while (i + lit < len && lit < 128 &&
+                   !(i + lit + 1 < len && in[i + lit] == in[i + lit + 1])) {
+                lit++;
+            }
+            if (o + 1 + lit > cap) {
+                return 0;
+            }
+            out[o++] = (uint8_t)(lit - 1);      // 0..127: copy n+1 bytes
+            memcpy(out + o, in + i, lit);
+            o += lit;
+            i += lit;
+        }
+    }
+    
+    return o;
+}
+
+static bool epaper_packbits_decode(const uint8_t* in, size_t len, uint8_t* out, size_t out_len) {
+    size_t i = 0;
+    size_t o = 0;
+    
+    while (i < len) {
+        uint8_t header = in[i++];
+        if (header < 128) {
+            size_t n = header + 1;
+            if (i + n > len || o + n > out_len) {
+                return false;
+            }
+            memcpy(out + o, in + i, n);
+            i += n;
+            o += n;
+        } else if (header > 128) {
+            size_t n = 257 - header;
+            if (i >= len || o + n > out_len) {
+                return false;
+            }
+            memset(out + o, in[i++], n);
+            o += n;
+        }
+    }
+    
+    return o == out_len;
+}
+
+static bool epaper_retained_valid(const epaper_driver_t* driver) {
+    return s_retained.magic == EPAPER_RTC_MAGIC &&
+           s_retained.model == driver->config.model &&
+           s_retained.fb_size == driver->fb_size;
+}
+
+/**
+ * @brief Pick up the frame and refresh cadence left by the previous wake
+ */
+static void epaper_restore_retained(epaper_driver_t* driver) {
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        s_retained.magic = 0;   // Panel content unknown after a reset
+        return;
+    }
+    if (!epaper_retained_valid(driver)) {
+        return;
+    }
+    
+    driver->partial_update_count = s_retained.partial_update_count;
+    driver->ghost_px = s_retained.ghost_px;
+    
+    if (driver->ram_shadow != NULL && s_retained.image_len > 0 &&
+        epaper_packbits_decode(s_retained.image, s_retained.image_len,
+                               driver->ram_shadow, driver->fb_size) &&
+        esp_crc32_le(0, driver->ram_shadow, driver->fb_size) == s_retained.crc) {
+        driver->shadow_valid = true;
+    }
+    
+    ESP_LOGI(TAG, "Retained frame: %s, %u partial updates (%lu px) since full refresh",
+             driver->shadow_valid ? "image" : "CRC only", driver->partial_update_count,
+             (unsigned long)driver->ghost_px);
+}
+
+static void epaper_save_retained(const epaper_driver_t* driver) {
+    s_retained.magic = EPAPER_RTC_MAGIC;
+    s_retained.model = driver->config.model;
+    s_retained.fb_size = driver->fb_size;
+    s_retained.partial_update_count = driver->partial_update_count;
+    s_retained.ghost_px = driver->ghost_px;
+    s_retained.crc = esp_crc32_le(0, driver->framebuffer, driver->fb_size);
+    s_retained.image_len = (uint16_t)epaper_packbits_encode(driver->framebuffer, driver->fb_size,
+                                                            s_retained.image, sizeof(s_retained.image));
+}
+
 // ============================================================================
 // Display Controller Initialization
 // ============================================================================
@@ -329,6 +650,8 @@ static esp_err_t epaper_init_154d67(epaper_driver_t* driver) {
  * @brief Initialize display based on model
  */
 static esp_err_t epaper_init_display_controller(epaper_driver_t* driver) {
+    driver->ram_valid = false;  // Reset leaves the controller RAM undefined
+    
     switch (driver->config.model) {
         case EPAPER_MODEL_213_122x250:
             return epaper_init_213bn(driver);
@@ -348,6 +671,157 @@ static esp_err_t epaper_init_display_controller(epaper_driver_t* driver) {
     }
 }
 
+// ============================================================================
+// Rasterizer
+// ============================================================================
+
+// Framebuffer geometry and rotation, resolved once per draw call
+typedef struct {
+    uint8_t* fb;
+    uint16_t bytes_per_row;
+    uint16_t width;
+    uint16_t height;
+    uint8_t rotation;
+} epaper_raster_t;
+
+static void epaper_raster_begin(const epaper_driver_t* driver, epaper_raster_t* r) {
+    r->fb = driver->framebuffer;
+    r->bytes_per_row = (driver->config.width + 7) / 8;
+    r->width = driver->config.width;
+    r->height = driver->config.height;
+    r->rotation = driver->config.rotation;
+}
+
+/**
+ * @brief Fill a rectangle in framebuffer coordinates (already clipped)
+ *
+ * Each row is a span: masked first and last bytes, memset in between.
+ */
+static void epaper_raster_fill_phys(const epaper_raster_t* r, int32_t x, int32_t y,
+                                    int32_t w, int32_t h, epaper_color_t color) {
+    const int32_t x_end = x + w - 1;
+    const int32_t b0 = x >> 3;
+    const int32_t b1 = x_end >> 3;
+    const uint8_t mask0 = 0xFF >> (x & 7);
+    const uint8_t mask1 = (uint8_t)(0xFF << (7 - (x_end & 7)));
+    const bool black = (color == EPAPER_COLOR_BLACK);   // 0 = black, 1 = white
+    
+    for (int32_t row = y; row < y + h; row++) {
+        uint8_t* p = r->fb + row * r->bytes_per_row;
+        if (b0 == b1) {
+            uint8_t m = mask0 & mask1;
+            p[b0] = black ? (p[b0] & ~m) : (p[b0] | m);
+            continue;
+        }
+        p[b0] = black ? (p[b0] & ~mask0) : (p[b0] | mask0);
+        if (b1 - b0 > 1) {
+            memset(p + b0 + 1, black ? 0x00 : 0xFF, b1 - b0 - 1);
+        }
+        p[b1] = black ? (p[b1] & ~mask1) : (p[b1] | mask1);
+    }
+}
+
+/**
+ * @brief Fill a rectangle in drawing coordinates
+ *
+ * Uses the same rotation mapping as epaper_draw_pixel (a rectangle stays a
+ * rectangle) and clips to the framebuffer.
+ */
+static void epaper_raster_fill(const epaper_raster_t* r, int32_t x, int32_t y,
+                               int32_t w, int32_t h, epaper_color_t color) {
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    
+    int32_t px = x, py = y, pw = w, ph = h;
+    switch (r->rotation) {
+        case 1:  // px = height-1-y, py = x
+            px = r->height - y - h;
+            py = x;
+            pw = h;
+            ph = w;
+            break;
+        case 2:  // px = width-1-x, py = height-1-y
+            px = r->width - x - w;
+            py = r->height - y - h;
+            break;
+        case 3:  // px = y, py = width-1-x
+            px = y;
+            py = r->width - x - w;
+            pw = h;
+            ph = w;
+            break;
+        default:
+            break;
+    }
+    
+    if (px < 0) { pw += px; px = 0; }
+    if (py < 0) { ph += py; py = 0; }
+    if (px + pw > r->width) pw = r->width - px;
+    if (py + ph > r->height) ph = r->height - py;
+    if (pw <= 0 || ph <= 0) {
+        return;
+    }
+    
+    epaper_raster_fill_phys(r, px, py, pw, ph, color);
+}
+
+/**
+ * @brief Draw one 5x8 glyph scaled by size: each horizontal run of set bits is one rectangle
+ */
+static void epaper_raster_glyph_5x8(const epaper_raster_t* r, int32_t x, int32_t y,
+                                    const uint8_t* glyph, uint8_t size) {
+    for (uint8_t row = 0; row < 8; row++) {
+        uint8_t col = 0;
+        while (col < 5) {
+            if (!(glyph[col] & (1 << row))) {
+                col++;
+                continue;
+            }
+            uint8_t start = col;
+            while (col < 5 && (glyph[col] & (1 << row))) {
+                col++;
+            }
+            epaper_raster_fill(r, x + start * size, y + row * size,
+                               (col - start) * size, size, EPAPER_COLOR_BLACK);
+        }
+    }
+}
+
+/**
+ * @brief Draw one proportional-font glyph (row-major, MSB first)
+ */
+static void epaper_raster_glyph_font(const epaper_raster_t* r, int32_t x, int32_t y,
+                                     const epaper_font_t* font, const epaper_glyph_t* glyph) {
+    const uint8_t* bits = font->bitmap + glyph->bitmap_offset;
+    const uint16_t row_bytes = (glyph->width + 7) / 8;
+    
+    for (uint8_t row = 0; row < font->height; row++) {
+        const uint8_t* line = bits + row * row_bytes;
+        uint8_t col = 0;
+        while (col < glyph->width) {
+            if (!(line[col >> 3] & (0x80 >> (col & 7)))) {
+                col++;
+                continue;
+            }
+            uint8_t start = col;
+            while (col < glyph->width && (line[col >> 3] & (0x80 >> (col & 7)))) {
+                col++;
+            }
+            epaper_raster_fill(r, x + start, y + row, col - start, 1, EPAPER_COLOR_BLACK);
+        }
+    }
+}
+
+static const epaper_glyph_t* epaper_font_glyph(const epaper_font_t* font, char c) {
+    uint8_t code = (uint8_t)c;
+    if (code < font->first || code > font->last) {
+        return NULL;
+    }
+    const epaper_glyph_t* glyph = &font->glyphs[code - font->first];
+    return glyph->x_advance > 0 ? glyph : NULL;
+}
+
 // ============================================================================
 // Public API Implementation
 // ============================================================================
@@ -365,6 +839,8 @@ esp_err_t epaper_get_default_config(epaper_config_t* config, epaper_model_t mode
     config->rotation = 0;
     config->use_partial_update = true;
     config->full_update_interval = 10;
+    config->full_refresh_percent = 50;
+    config->ghost_limit_percent = 100;
     
     ESP_LOGI(TAG, "Default config for %s (%dx%d)", 
              display_specs[model].name, config->width, config->height);
@@ -391,13 +867,26 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
     ESP_LOGI(TAG, "Framebuffer: %ux%u pixels, %lu bytes per row, %lu bytes total",
              config->width, config->height, bytes_per_row, driver->fb_size);
     
-    driver->framebuffer = (uint8_t*)malloc(driver->fb_size);
+    // Frames are sent by SPI DMA straight from these buffers
+    driver->framebuffer = (uint8_t*)heap_caps_malloc(driver->fb_size, MALLOC_CAP_DMA);
     if (driver->framebuffer == NULL) {
         ESP_LOGE(TAG, "Failed to allocate framebuffer (%lu bytes)", driver->fb_size);
         return ESP_ERR_NO_MEM;
     }
     memset(driver->framebuffer, 0xFF, driver->fb_size); // Initialize to white
     
+    // Without the shadow every update simply transfers the whole framebuffer
+    driver->ram_shadow = (uint8_t*)heap_caps_malloc(driver->fb_size, MALLOC_CAP_DMA);
+    if (driver->ram_shadow == NULL) {
+        ESP_LOGW(TAG, "No memory for RAM shadow, windowed updates disabled");
+    }
+    driver->shadow_valid = false;
+    driver->ram_valid = false;
+    driver->trans_next = 0;
+    driver->trans_inflight = 0;
+    driver->busy_sem = NULL;
+    driver->refresh_pending = false;
+    
     // Initialize GPIO pins
     gpio_config_t io_conf = {
         .mode = GPIO_MODE_OUTPUT,
@@ -425,6 +914,7 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
     io_conf.mode = GPIO_MODE_INPUT;
     io_conf.pin_bit_mask = (1ULL << config->busy_pin);
     gpio_config(&io_conf);
+    epaper_busy_irq_init(driver);
     
     // Initialize SPI bus
     spi_bus_config_t bus_cfg = {
@@ -440,6 +930,8 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
         // ESP_ERR_INVALID_STATE means bus already initialized (shared)
         ESP_LOGE(TAG, "SPI bus init failed: %s", esp_err_to_name(ret));
+        epaper_busy_irq_deinit(driver);
+        free(driver->ram_shadow);
         free(driver->framebuffer);
         return ret;
     }
@@ -449,15 +941,17 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
         .clock_speed_hz = 4 * 1000 * 1000,  // 4 MHz (ePaper displays are slow)
         .mode = 0,                           // SPI mode 0
         .spics_io_num = config->cs_pin,
-        .queue_size = 1,
+        .queue_size = EPAPER_SPI_QUEUE_SIZE,
         .flags = 0,
-        .pre_cb = NULL,
+        .pre_cb = epaper_spi_pre_cb,         // Drives DC per transaction
     };
     
     ret = spi_bus_add_device(config->spi_host, &dev_cfg, &driver->spi);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
         spi_bus_free(config->spi_host);
+        epaper_busy_irq_deinit(driver);
+        free(driver->ram_shadow);
         free(driver->framebuffer);
         return ret;
     }
@@ -468,6 +962,8 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
         ESP_LOGE(TAG, "Display controller init failed: %s", esp_err_to_name(ret));
         spi_bus_remove_device(driver->spi);
         spi_bus_free(config->spi_host);
+        epaper_busy_irq_deinit(driver);
+        free(driver->ram_shadow);
         free(driver->framebuffer);
         return ret;
     }
@@ -475,6 +971,9 @@ esp_err_t epaper_init(epaper_driver_t* driver, const epaper_config_t* config) {
     driver->is_initialized = true;
     driver->is_powered = false;
     driver->partial_update_count = 0;
+    driver->ghost_px = 0;
+    driver->last_refresh = EPAPER_REFRESH_NONE;
+    epaper_restore_retained(driver);
     
     ESP_LOGI(TAG, "ePaper display %s initialized successfully", 
              display_specs[config->model].name);
@@ -499,8 +998,12 @@ esp_err_t epaper_deinit(epaper_driver_t* driver) {
         free(driver->framebuffer);
         driver->framebuffer = NULL;
     }
+    free(driver->ram_shadow);
+    driver->ram_shadow = NULL;
+    driver->shadow_valid = false;
     
     // Remove SPI device and free bus
+    epaper_busy_irq_deinit(driver);
     spi_bus_remove_device(driver->spi);
     spi_bus_free(driver->config.spi_host);
     
@@ -544,6 +1047,8 @@ esp_err_t epaper_power_off(epaper_driver_t* driver) {
         return ESP_OK;
     }
     
+    epaper_update_finish(driver);   // Never cut power during a refresh
+    
     // Send deep sleep command (for SSD1680)
     if (driver->config.model == EPAPER_MODEL_213_122x250) {
         epaper_send_command(driver, 0x10);  // Deep sleep mode
@@ -551,6 +1056,7 @@ esp_err_t epaper_power_off(epaper_driver_t* driver) {
     }
     
     // Set power pin LOW
+    epaper_spi_flush(driver);
     if (driver->config.power_pin >= 0) {
         vTaskDelay(pdMS_TO_TICKS(100));
         gpio_set_level(driver->config.power_pin, 0);
@@ -639,6 +1145,12 @@ esp_err_t epaper_draw_text(epaper_driver_t* driver, uint16_t x, uint16_t y,
     if (driver == NULL || text == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (driver->framebuffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    epaper_raster_t raster;
+    epaper_raster_begin(driver, &raster);
     
     if (size < 1) {
         size = 1;
@@ -682,23 +1194,7 @@ esp_err_t epaper_draw_text(epaper_driver_t* driver, uint16_t x, uint16_t y,
             c = '?';
         }
         
-        const uint8_t *glyph = font_5x8[c - 32];
-        
-        // Draw character with scaling
-        for (uint8_t col = 0; col < 5; col++) {
-            uint8_t line = glyph[col];
-            for (uint8_t row = 0; row < 8; row++) {
-                if (line & (1 << row)) {
-                    // Draw scaled pixel
-                    for (uint8_t sy = 0; sy < size; sy++) {
-                        for (uint8_t sx = 0; sx < size; sx++) {
-                            epaper_draw_pixel(driver, cursor_x + col * size + sx, 
-                                            cursor_y + row * size + sy, EPAPER_COLOR_BLACK);
-                        }
-                    }
-                }
-            }
-        }
+        epaper_raster_glyph_5x8(&raster, cursor_x, cursor_y, font_5x8[c - 32], size);
         
         cursor_x += char_width + char_spacing;
         text++;
@@ -712,6 +1208,22 @@ esp_err_t epaper_draw_line(epaper_driver_t* driver, uint16_t x0, uint16_t y0,
     if (driver == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (driver->framebuffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    epaper_raster_t raster;
+    epaper_raster_begin(driver, &raster);
+    
+    // Horizontal and vertical lines are single spans
+    if (y0 == y1) {
+        epaper_raster_fill(&raster, x0 < x1 ? x0 : x1, y0, abs((int)x1 - (int)x0) + 1, 1, color);
+        return ESP_OK;
+    }
+    if (x0 == x1) {
+        epaper_raster_fill(&raster, x0, y0 < y1 ? y0 : y1, 1, abs((int)y1 - (int)y0) + 1, color);
+        return ESP_OK;
+    }
     
     // Bresenham's line algorithm
     int dx = abs((int)x1 - (int)x0);
@@ -721,7 +1233,7 @@ esp_err_t epaper_draw_line(epaper_driver_t* driver, uint16_t x0, uint16_t y0,
     int err = dx - dy;
     
     while (true) {
-        epaper_draw_pixel(driver, x0, y0, color);
+        epaper_raster_fill(&raster, x0, y0, 1, 1, color);
         
         if (x0 == x1 && y0 == y1) {
             break;
@@ -746,121 +1258,315 @@ esp_err_t epaper_draw_rect(epaper_driver_t* driver, uint16_t x, uint16_t y,
     if (driver == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (driver->framebuffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    epaper_raster_t raster;
+    epaper_raster_begin(driver, &raster);
     
     if (filled) {
         // Draw filled rectangle
-        for (uint16_t row = y; row < y + height && row < driver->config.height; row++) {
-            for (uint16_t col = x; col < x + width && col < driver->config.width; col++) {
-                epaper_draw_pixel(driver, col, row, color);
-            }
-        }
+        epaper_raster_fill(&raster, x, y, width, height, color);
     } else {
         // Draw outline
-        epaper_draw_line(driver, x, y, x + width - 1, y, color);                    // Top
-        epaper_draw_line(driver, x, y + height - 1, x + width - 1, y + height - 1, color); // Bottom
-        epaper_draw_line(driver, x, y, x, y + height - 1, color);                    // Left
-        epaper_draw_line(driver, x + width - 1, y, x + width - 1, y + height - 1, color); // Right
+        epaper_raster_fill(&raster, x, y, width, 1, color);                      // Top
+        epaper_raster_fill(&raster, x, y + height - 1, width, 1, color);         // Bottom
+        epaper_raster_fill(&raster, x, y, 1, height, color);                     // Left
+        epaper_raster_fill(&raster, x + width - 1, y, 1, height, color);         // Right
     }
     
     return ESP_OK;
 }
 
-esp_err_t epaper_update(epaper_driver_t* driver, bool force_full) {
+uint16_t epaper_text_width_font(const char* text, const epaper_font_t* font) {
+    if (text == NULL || font == NULL) {
+        return 0;
+    }
+    
+    uint16_t width = 0;
+    for (; *text && *text != '\n'; text++) {
+        const epaper_glyph_t* glyph = epaper_font_glyph(font, *text);
+        width += glyph ? glyph->x_advance : font->height / 4;
+    }
+    return width;
+}
+
+esp_err_t epaper_draw_text_font(epaper_driver_t* driver, uint16_t x, uint16_t y,
+                                const char* text, const epaper_font_t* font,
+                                epaper_text_align_t align) {
+    if (driver == NULL || text == NULL || font == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (driver->framebuffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    epaper_raster_t raster;
+    epaper_raster_begin(driver, &raster);
+    
+    int32_t cursor_y = y;
+    while (*text) {
+        uint16_t line_width = epaper_text_width_font(text, font);
+        int32_t cursor_x = x;
+        if (align == EPAPER_ALIGN_CENTER) {
+            cursor_x = x > line_width / 2 ? x - line_width / 2 : 0;
+        } else if (align == EPAPER_ALIGN_RIGHT) {
+            cursor_x = x > line_width ? x - line_width : 0;
+        }
+        
+        for (; *text && *text != '\n'; text++) {
+            const epaper_glyph_t* glyph = epaper_font_glyph(font, *text);
+            if (glyph == NULL) {
+                cursor_x += font->height / 4;   // Not in the font: leave a gap
+                continue;
+            }
+            if (glyph->width > 0) {
+                epaper_raster_glyph_font(&raster, cursor_x, cursor_y, font, glyph);
+            }
+            cursor_x += glyph->x_advance;
+        }
+        
+        if (*text == '\n') {
+            text++;
+            cursor_y += font->height + font->height / 4;
+        }
+    }
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Choose how to show the framebuffer
+ *
+ * A partial refresh takes ~0.3 s instead of ~2 s, but every pixel it flips
+ * leaves a faint ghost, and a large change looks worse than after a full
+ * refresh. The flipped pixels are accumulated until a full refresh clears them.
+ *
+ * @param changed_px Pixels that differ from the panel, NULL if unknown (no shadow)
+ */
+static epaper_refresh_t epaper_choose_refresh(const epaper_driver_t* driver, bool force_full,
+                                              bool unchanged, const uint32_t* changed_px) {
+    const epaper_config_t* cfg = &driver->config;
+    if (force_full) {
+        return EPAPER_REFRESH_FULL;
+    }
+    if (unchanged) {
+        return EPAPER_REFRESH_NONE;
+    }
+    
+    // A partial refresh needs the old image as its base
+    if (!cfg->use_partial_update || (!driver->ram_valid && !driver->shadow_valid) ||
+        driver->partial_update_count >= cfg->full_update_interval) {
+        return EPAPER_REFRESH_FULL;
+    }
+    if (changed_px != NULL) {
+        const uint64_t panel_px = (uint64_t)cfg->width * cfg->height;
+        if (cfg->full_refresh_percent > 0 &&
+            (uint64_t)*changed_px * 100 >= panel_px * cfg->full_refresh_percent) {
+            return EPAPER_REFRESH_FULL;
+        }
+        if (cfg->ghost_limit_percent > 0 &&
+            ((uint64_t)driver->ghost_px + *changed_px) * 100 >= panel_px * cfg->ghost_limit_percent) {
+            return EPAPER_REFRESH_FULL;
+        }
+    }
+    return EPAPER_REFRESH_PARTIAL;
+}
+
+esp_err_t epaper_update_start(epaper_driver_t* driver, bool force_full) {
     if (driver == NULL || !driver->is_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    bool do_full_update = force_full || 
-                          (driver->partial_update_count >= driver->config.full_update_interval);
+    epaper_update_finish(driver);   // One refresh at a time
+    
+    const uint32_t bytes_per_row = (driver->config.width + 7) / 8;
+    epaper_window_t win = {
+        .x0 = 0,
+        .x1 = bytes_per_row - 1,
+        .y0 = 0,
+        .y1 = driver->config.height - 1,
+    };
+    
+    // With a known panel image only the changed bytes need to reach the controller RAM
+    bool transfer = true;
+    bool unchanged = false;
+    uint32_t changed_px = 0;
+    if (driver->shadow_valid) {
+        transfer = epaper_find_dirty(driver, &win, &changed_px);
+        unchanged = !transfer;
+    } else if (epaper_retained_valid(driver)) {
+        unchanged = esp_crc32_le(0, driver->framebuffer, driver->fb_size) == s_retained.crc;
+    }
+    epaper_refresh_t refresh = epaper_choose_refresh(driver, force_full, unchanged,
+                                                     driver->shadow_valid ? &changed_px : NULL);
+    if (refresh == EPAPER_REFRESH_NONE) {
+        EVT_LOGI(TAG, "Framebuffer unchanged, skipping display update");
+        driver->last_refresh = EPAPER_REFRESH_NONE;
+        return ESP_OK;
+    }
+    
+    // Controller RAM lost (reset or power cycle): reload all of it
+    if (!driver->ram_valid) {
+        transfer = true;
+        win.x0 = 0;
+        win.x1 = bytes_per_row - 1;
+        win.y0 = 0;
+        win.y1 = driver->config.height - 1;
+    }
     
+    bool do_full_update = (refresh == EPAPER_REFRESH_FULL);
     if (do_full_update) {
-        ESP_LOGI(TAG, "Performing full display update");
+        EVT_LOGI(TAG, "Performing full display update (%lu px changed)", (unsigned long)changed_px);
         driver->partial_update_count = 0;
+        driver->ghost_px = 0;
     } else {
-        ESP_LOGI(TAG, "Performing partial display update (%d/%d)", 
-                 driver->partial_update_count + 1, driver->config.full_update_interval);
+        EVT_LOGI(TAG, "Performing partial display update (%d/%d, %lu px changed)", 
+                 driver->partial_update_count + 1, driver->config.full_update_interval,
+                 (unsigned long)changed_px);
         driver->partial_update_count++;
+        driver->ghost_px += changed_px;
+    }
+    driver->last_refresh = refresh;
+    
+    // Gather the window rows into one buffer unless they are contiguous (full width)
+    const uint8_t* data = driver->framebuffer + win.y0 * bytes_per_row;
+    uint8_t* packed = NULL;
+    if (transfer && (win.x0 != 0 || win.x1 != bytes_per_row - 1)) {
+        uint16_t win_bytes = win.x1 - win.x0 + 1;
+        packed = (uint8_t*)heap_caps_malloc((size_t)win_bytes * (win.y1 - win.y0 + 1), MALLOC_CAP_DMA);
+        if (packed != NULL) {
+            for (uint16_t y = win.y0; y <= win.y1; y++) {
+                memcpy(packed + (y - win.y0) * win_bytes,
+                       driver->framebuffer + y * bytes_per_row + win.x0, win_bytes);
+            }
+            data = packed;
+        } else {
+            // Fall back to the full-width rows of the window
+            win.x0 = 0;
+            win.x1 = bytes_per_row - 1;
+        }
+    }
+    if (transfer) {
+        EVT_LOGI(TAG, "Writing RAM window x=%u..%u y=%u..%u (%u bytes)",
+                 win.x0 * 8, win.x1 * 8 + 7, win.y0, win.y1,
+                 (unsigned)((win.x1 - win.x0 + 1) * (win.y1 - win.y0 + 1)));
     }
     
-    // Implementation for 2.13" SSD1680
-    if (driver->config.model == EPAPER_MODEL_213_122x250) {
-        // Set RAM X address counter to start
-        epaper_send_command(driver, 0x4E);
-        epaper_send_data(driver, 0x00);
-        
-        // Set RAM Y address counter to start (0x0000 in Y-increment mode)
-        epaper_send_command(driver, 0x4F);
-        epaper_send_data(driver, 0x00);  // Y start = 0 low byte
-        epaper_send_data(driver, 0x00);  // Y start high byte
-        
-        // Write to 0x26 buffer (same data as 0x24 per WeActStudio)
-        epaper_send_command(driver, 0x26);
-        epaper_send_data_buffer(driver, driver->framebuffer, driver->fb_size);
-        
-        // Reset RAM address pointers to start again
-        epaper_send_command(driver, 0x4E);
-        epaper_send_data(driver, 0x00);
-        epaper_send_command(driver, 0x4F);
-        epaper_send_data(driver, 0x00);  // Y start = 0 low byte
-        epaper_send_data(driver, 0x00);  // Y start high byte
-        
-        // Write to 0x24 buffer (current display data)
-        epaper_send_command(driver, 0x24);
-        epaper_send_data_buffer(driver, driver->framebuffer, driver->fb_size);
-        
-        // Update display
-        epaper_send_command(driver, 0x22);  // Display Update Control 2
-        epaper_send_data(driver, 0xF7);  // Full update (per WeActStudio)
-        epaper_send_command(driver, 0x20);  // Master Activation (Update display)
-        
-        // Wait for update to complete
-        vTaskDelay(pdMS_TO_TICKS(100));
-        epaper_wait_idle(driver, 10000);
-        
-        ESP_LOGI(TAG, "Display update complete");
-    } else if (driver->config.model == EPAPER_MODEL_154_200x200) {
-        // Implementation for 1.54" SSD1681 (supports partial refresh with dual buffers)
-        // Re-initialize RAM address pointers before each update
-        epaper_send_command(driver, 0x4E);
-        epaper_send_data(driver, 0x00);
-        
-        // Set RAM Y address counter  
-        epaper_send_command(driver, 0x4F);
-        epaper_send_data(driver, 0x00);  // Start from 0
-        epaper_send_data(driver, 0x00);
-        
+    perf_phase_begin(PERF_PHASE_DISPLAY);
+    
+    bool updated = true;
+    // 2.13" SSD1680 and 1.54" SSD1681: dual RAM buffers, 0x26 holds the old image
+    // the partial waveform compares against
+    if (driver->config.model == EPAPER_MODEL_213_122x250 ||
+        driver->config.model == EPAPER_MODEL_154_200x200) {
         if (do_full_update) {
             // Full refresh: write to both RAM buffers (0x24 and 0x26)
-            // Buffer 0x24 - new data
-            epaper_send_command(driver, 0x24);
-            epaper_send_data_buffer(driver, driver->framebuffer, driver->fb_size);
-            
-            // Buffer 0x26 - old data (same as new for full refresh)
-            epaper_send_command(driver, 0x26);
-            epaper_send_data_buffer(driver, driver->framebuffer, driver->fb_size);
+            if (transfer) {
+                // Buffer 0x24 - new data
+                epaper_write_ram_window(driver, 0x24, &win, data);
+                
+                // Buffer 0x26 - old data (same as new for full refresh)
+                epaper_write_ram_window(driver, 0x26, &win, data);
+            }
             
             // Full update mode
             epaper_send_command(driver, 0x22);
             epaper_send_data(driver, 0xF7);  // Full update sequence
         } else {
             // Partial refresh: only update 0x24 buffer
-            epaper_send_command(driver, 0x24);
-            epaper_send_data_buffer(driver, driver->framebuffer, driver->fb_size);
+            if (!driver->ram_valid) {
+                // The base image the panel shows goes to 0x26 first (retained across deep sleep)
+                epaper_write_ram_window(driver, 0x26, &win, driver->ram_shadow);
+            }
+            if (transfer) {
+                epaper_write_ram_window(driver, 0x24, &win, data);
+            }
             
             // Partial update mode
             epaper_send_command(driver, 0x22);
-            epaper_send_data(driver, 0xFF);  // Partial update sequence
+            epaper_send_data(driver, 0xFF);  // Display mode 2: partial waveform (LUT) from OTP
         }
         
         epaper_send_command(driver, 0x20);  // Master Activation
-        
-        // Wait for update to complete (BUSY pin goes low when done)
-        epaper_wait_idle(driver, 5000);
-        
-        ESP_LOGI(TAG, "Display update complete");
     } else {
         ESP_LOGW(TAG, "Update not implemented for this display model");
+        updated = false;
     }
     
+    // The RAM transfer has to be out before the framebuffer may change again
+    epaper_spi_flush(driver);
+    free(packed);
+    
+    if (!updated) {
+        perf_phase_end(PERF_PHASE_DISPLAY);
+        return ESP_OK;
+    }
+    
+    if (driver->ram_shadow != NULL) {
+        memcpy(driver->ram_shadow, driver->framebuffer, driver->fb_size);
+        driver->shadow_valid = true;
+    }
+    driver->ram_valid = true;
+    epaper_save_retained(driver);
+    
+    // The refreshed image becomes the "old" buffer the next partial refresh compares against
+    driver->rewrite_base = !do_full_update && transfer;
+    driver->base_y0 = win.y0;
+    driver->base_y1 = win.y1;
+    driver->refresh_start_us = esp_timer_get_time();
+    driver->refresh_pending = true;
+    event_counter_inc(EVT_DISPLAY_REFRESH);
+    EVT_LOGI(TAG, "Display refresh started");
     return ESP_OK;
 }
+
+esp_err_t epaper_update_finish(epaper_driver_t* driver) {
+    if (driver == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!driver->refresh_pending) {
+        return ESP_OK;
+    }
+    driver->refresh_pending = false;
+    
+    esp_err_t ret;
+    if (driver->config.model == EPAPER_MODEL_213_122x250) {
+        // Give BUSY time to rise after the activation (per WeActStudio)
+        int64_t since_us = esp_timer_get_time() - driver->refresh_start_us;
+        if (since_us < 100000) {
+            vTaskDelay(pdMS_TO_TICKS((100000 - since_us) / 1000) + 1);
+        }
+        ret = epaper_wait_idle(driver, 10000);
+    } else {
+        // Wait for update to complete (BUSY pin goes low when done)
+        ret = epaper_wait_idle(driver, 5000);
+    }
+    
+    if (driver->rewrite_base) {
+        // Full-width rows of the refreshed window (the shadow does not change while drawing)
+        const uint32_t bytes_per_row = (driver->config.width + 7) / 8;
+        epaper_window_t win = {
+            .x0 = 0,
+            .x1 = bytes_per_row - 1,
+            .y0 = driver->base_y0,
+            .y1 = driver->base_y1,
+        };
+        const uint8_t* image = driver->ram_shadow ? driver->ram_shadow : driver->framebuffer;
+        epaper_write_ram_window(driver, 0x26, &win, image + win.y0 * bytes_per_row);
+        epaper_spi_flush(driver);
+    }
+    
+    perf_phase_end(PERF_PHASE_DISPLAY);
+    EVT_LOGI(TAG, "Display update complete");
+    return ret;
+}
+
+esp_err_t epaper_update(epaper_driver_t* driver, bool force_full) {
+    esp_err_t ret = epaper_update_start(driver, force_full);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return epaper_update_finish(driver);
+}
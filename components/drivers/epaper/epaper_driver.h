@@ -12,6 +12,8 @@
 #include "esp_err.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -19,6 +21,12 @@
 extern "C" {
 #endif
 
+// SPI transactions that can be queued to the DMA at once
+#define EPAPER_SPI_QUEUE_SIZE     8
+
+// RTC memory for a PackBits copy of the displayed frame (only a CRC is kept if it does not fit)
+#define EPAPER_RETAIN_MAX_BYTES   2048
+
 // Display Model Identifiers
 typedef enum {
     EPAPER_MODEL_154_200x200,   // 1.54" GDEH0154D67
@@ -27,6 +35,13 @@ typedef enum {
     EPAPER_MODEL_420_400x300,   // 4.2" GDEY042T81
 } epaper_model_t;
 
+// How an update is shown (chosen per update by the refresh policy)
+typedef enum {
+    EPAPER_REFRESH_NONE,        // Framebuffer unchanged, panel left alone
+    EPAPER_REFRESH_PARTIAL,     // Partial waveform against the previous image (~0.3 s, leaves ghosting)
+    EPAPER_REFRESH_FULL,        // Full waveform (~2 s, flashes, clears ghosting)
+} epaper_refresh_t;
+
 // Color Definitions
 typedef enum {
     EPAPER_COLOR_WHITE = 0,
@@ -56,6 +71,8 @@ typedef struct {
     // Update Strategy
     bool use_partial_update;
     uint8_t full_update_interval; // Full refresh every N partial updates
+    uint8_t full_refresh_percent; // Changed pixels (% of the panel) that get a full refresh (0 = off)
+    uint16_t ghost_limit_percent; // Pixels flipped by partial refreshes (% of the panel) before a full one (0 = off)
 } epaper_config_t;
 
 // Display Driver Handle
@@ -63,10 +80,28 @@ typedef struct {
     epaper_config_t config;
     spi_device_handle_t spi;
     uint8_t* framebuffer;         // Black/White buffer
+    uint8_t* ram_shadow;          // Last image sent to the panel (NULL if not allocated)
     uint32_t fb_size;
     bool is_initialized;
     bool is_powered;
+    bool shadow_valid;            // ram_shadow is what the panel shows (kept across deep sleep)
+    bool ram_valid;               // Controller RAM holds the last image sent
     uint8_t partial_update_count;
+    uint32_t ghost_px;            // Pixels flipped by partial refreshes since the last full one
+    epaper_refresh_t last_refresh;  // Mode the last update used
+    
+    // Queued SPI pipeline (DC is driven from the pre-transfer callback)
+    spi_transaction_t trans[EPAPER_SPI_QUEUE_SIZE];
+    uint8_t trans_next;           // Next free slot
+    uint8_t trans_inflight;       // Queued, result not yet collected
+    SemaphoreHandle_t busy_sem;   // Given by the BUSY falling-edge interrupt (NULL = poll)
+    
+    // Refresh started by epaper_update_start()
+    bool refresh_pending;
+    bool rewrite_base;            // Partial: copy rows base_y0..base_y1 to 0x26 afterwards
+    uint16_t base_y0;
+    uint16_t base_y1;
+    int64_t refresh_start_us;
 } epaper_driver_t;
 
 // Text Alignment
@@ -76,6 +111,25 @@ typedef enum {
     EPAPER_ALIGN_RIGHT
 } epaper_text_align_t;
 
+// Proportional Font Glyph
+typedef struct {
+    uint16_t bitmap_offset;   // First byte of the glyph in the font bitmap
+    uint8_t width;            // Bitmap width in pixels (0 = nothing to draw)
+    uint8_t x_advance;        // Cursor advance in pixels (0 = not in the font)
+} epaper_glyph_t;
+
+// Proportional Font (const, lives in flash)
+typedef struct {
+    const uint8_t* bitmap;          // Row-major glyph rows, padded to whole bytes, MSB first
+    const epaper_glyph_t* glyphs;   // One entry per character first..last
+    uint8_t first;
+    uint8_t last;
+    uint8_t height;                 // Glyph height in pixels
+} epaper_font_t;
+
+// Built-in fonts
+extern const epaper_font_t epaper_font_numerals_24;   // 24 px digits, space, % - . :
+
 /**
  * @brief Get default configuration for specific display model
  */
@@ -134,8 +188,49 @@ esp_err_t epaper_draw_rect(epaper_driver_t* driver, uint16_t x, uint16_t y,
 esp_err_t epaper_draw_text(epaper_driver_t* driver, uint16_t x, uint16_t y, 
                             const char* text, uint8_t size, epaper_text_align_t align);
 
+/**
+ * @brief Draw text with a proportional font; (x, y) is the top of the glyphs
+ */
+esp_err_t epaper_draw_text_font(epaper_driver_t* driver, uint16_t x, uint16_t y,
+                                const char* text, const epaper_font_t* font,
+                                epaper_text_align_t align);
+
+/**
+ * @brief Width in pixels of a single line of text in a proportional font
+ */
+uint16_t epaper_text_width_font(const char* text, const epaper_font_t* font);
+
+/**
+ * @brief Start a display update and return while the panel refreshes
+ *
+ * The RAM transfer goes through the queued SPI DMA pipeline and the refresh is
+ * triggered; the BUSY wait is left to epaper_update_finish(), so the caller
+ * can draw or do network work during the refresh. Same update rules as
+ * epaper_update().
+ */
+esp_err_t epaper_update_start(epaper_driver_t* driver, bool force_full);
+
+/**
+ * @brief Wait (interrupt driven) for a refresh started by epaper_update_start()
+ *
+ * Returns immediately if no refresh is pending.
+ */
+esp_err_t epaper_update_finish(epaper_driver_t* driver);
+
 /**
  * @brief Update display (full or partial depending on config)
+ *
+ * Only the bounding box of the bytes that differ from the controller RAM is
+ * transferred (RAM X/Y window). The new framebuffer is compared with the
+ * displayed one and the changed pixels are counted:
+ *   - Nothing changed: no refresh (unless force_full)
+ *   - A change of full_refresh_percent of the panel or more, ghosting of
+ *     ghost_limit_percent accumulated by partial refreshes, or
+ *     full_update_interval partial refreshes in a row: full refresh
+ *   - Otherwise a partial refresh
+ * The displayed frame, the partial refresh counter and the accumulated
+ * ghosting are retained in RTC memory, so this also holds for the first
+ * update after a deep sleep wakeup.
  */
 esp_err_t epaper_update(epaper_driver_t* driver, bool force_full);
 
@@ -0,0 +1,87 @@
+/**
+ * @file epaper_fonts.c
+ * @brief Proportional bitmap fonts for the ePaper driver (stored in flash)
+ */
+
+#include "epaper_driver.h"
+
+// Generated 14x24 segment-style numerals: digits, space, %, -, ., :
+static const uint8_t s_numerals_24_bitmap[] = {
+    0x00, 0x0C, 0xFC, 0x0C, 0xFC, 0x18, 0xCC, 0x18, 0xCC, 0x30, 0xCC, 0x30, 0xFC, 0x60, 0xFC, 0x60,
+    0x00, 0xC0, 0x00, 0xC0, 0x01, 0x80, 0x01, 0x80, 0x03, 0x00, 0x03, 0x00, 0x06, 0x00, 0x06, 0x00,
+    0x0C, 0xFC, 0x0C, 0xFC, 0x18, 0xCC, 0x18, 0xCC, 0x30, 0xCC, 0x30, 0xFC, 0x60, 0xFC, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xE0, 0xE0, 0x7F, 0xF8, 0xFF, 0xFC, 0xFF, 0xFC, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC, 0x7F, 0xF8, 0x00, 0x00, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x00, 0x7F, 0xF8, 0x7F, 0xFC, 0x7F, 0xFC, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x7F, 0xFC, 0xFF, 0xFC,
+    0xFF, 0xFC, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00,
+    0xE0, 0x00, 0xFF, 0xF8, 0xFF, 0xF8, 0x7F, 0xF8, 0x7F, 0xF8, 0x7F, 0xFC, 0x7F, 0xFC, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x7F, 0xFC, 0x7F, 0xFC,
+    0x7F, 0xFC, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x7F, 0xFC, 0x7F, 0xFC, 0x7F, 0xF8, 0x00, 0x00, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC,
+    0xFF, 0xFC, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x00, 0x7F, 0xF8, 0xFF, 0xF8, 0xFF, 0xF8, 0xE0, 0x00,
+    0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xFF, 0xF8, 0xFF, 0xFC,
+    0xFF, 0xFC, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x7F, 0xFC, 0x7F, 0xFC, 0x7F, 0xF8, 0x7F, 0xF8, 0xFF, 0xF8, 0xFF, 0xF8, 0xE0, 0x00,
+    0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xE0, 0x00, 0xFF, 0xF8, 0xFF, 0xFC,
+    0xFF, 0xFC, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC, 0x7F, 0xF8, 0x7F, 0xF8, 0x7F, 0xFC, 0x7F, 0xFC, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x00, 0x7F, 0xF8, 0xFF, 0xFC, 0xFF, 0xFC, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC,
+    0xFF, 0xFC, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC, 0x7F, 0xF8, 0x7F, 0xF8, 0xFF, 0xFC, 0xFF, 0xFC, 0xE0, 0x1C,
+    0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xE0, 0x1C, 0xFF, 0xFC, 0xFF, 0xFC,
+    0xFF, 0xFC, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x1C,
+    0x00, 0x1C, 0x7F, 0xFC, 0x7F, 0xFC, 0x7F, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xE0,
+    0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xE0, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const epaper_glyph_t s_numerals_24_glyphs[] = {
+    {   0,  0,  7},   // ' '
+    {   0,  0,  0},   // '!'
+    {   0,  0,  0},   // '"'
+    {   0,  0,  0},   // '#'
+    {   0,  0,  0},   // '$'
+    {   0, 14, 16},   // '%'
+    {   0,  0,  0},   // '&'
+    {   0,  0,  0},   // '\''
+    {   0,  0,  0},   // '('
+    {   0,  0,  0},   // ')'
+    {   0,  0,  0},   // '*'
+    {   0,  0,  0},   // '+'
+    {   0,  0,  0},   // ','
+    {  48,  9, 11},   // '-'
+    {  96,  3,  5},   // '.'
+    {   0,  0,  0},   // '/'
+    { 120, 14, 16},   // '0'
+    { 168, 14, 16},   // '1'
+    { 216, 14, 16},   // '2'
+    { 264, 14, 16},   // '3'
+    { 312, 14, 16},   // '4'
+    { 360, 14, 16},   // '5'
+    { 408, 14, 16},   // '6'
+    { 456, 14, 16},   // '7'
+    { 504, 14, 16},   // '8'
+    { 552, 14, 16},   // '9'
+    { 600,  3,  5},   // ':'
+};
+
+const epaper_font_t epaper_font_numerals_24 = {
+    .bitmap = s_numerals_24_bitmap,
+    .glyphs = s_numerals_24_glyphs,
+    .first = ' ',
+    .last = ':',
+    .height = 24,
+};
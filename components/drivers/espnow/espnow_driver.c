@@ -4,10 +4,16 @@
  */
 
 #include "espnow_driver.h"
+#include "espnow_reassembly.h"
+#include "espnow_fragment.h"
+#include "event_counters.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
-#include "esp_crc.h"
+#include "esp_idf_version.h"
 #include "string.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -30,19 +36,59 @@ static int8_t s_last_rssi = 0;
 
 // Event bits
 #define ESPNOW_SEND_DONE_BIT    BIT0
-#define ESPNOW_SEND_SUCCESS_BIT BIT1
+#define ESPNOW_ACK_BIT          BIT1
+#define ESPNOW_RX_STOPPED_BIT   BIT2
+
+// Receive ring: frames copied out of the WiFi task's receive callback (the only
+// producer, writes head) and processed by the RX task (the only consumer, writes tail)
+typedef struct {
+    uint8_t src_mac[6];
+    int8_t rssi;
+    uint16_t len;
+    uint8_t data[sizeof(espnow_packet_t)];
+} rx_frame_t;
+
+static rx_frame_t s_rx_ring[ESPNOW_RX_RING_SIZE];
+static atomic_uint_fast32_t s_rx_head;
+static atomic_uint_fast32_t s_rx_tail;
+static volatile uint32_t s_rx_dropped = 0;     // Frames lost to a full ring (written by the callback)
+static TaskHandle_t s_rx_task = NULL;
+static volatile bool s_rx_stop = false;
 
 // Fragmentation buffer
-static espnow_packet_t s_tx_packets[32];  // Support up to 32 fragments
-static const uint8_t *s_current_dest_mac = NULL;
+static espnow_packet_t s_tx_packets[ESPNOW_MAX_CHUNKS];
 
-// ============================================================================
-// CRC16 Implementation
-// ============================================================================
+// Per-chunk status of the message being sent (written by the send callback)
+typedef enum {
+    CHUNK_PENDING,
+    CHUNK_IN_FLIGHT,
+    CHUNK_SENT,
+    CHUNK_FAILED
+} chunk_state_t;
 
-uint16_t espnow_crc16(const uint8_t *data, size_t len) {
-    return esp_crc16_le(0xFFFF, data, len);
-}
+static volatile uint8_t s_chunk_state[ESPNOW_MAX_CHUNKS];
+static uint8_t s_chunk_retries[ESPNOW_MAX_CHUNKS];
+
+// Frames handed to esp_now_send, in order. The send callback only reports the
+// destination MAC, so it completes the oldest entry for that MAC.
+#define TX_FIFO_CONTROL         0xFF    // Entry of an ACK frame, not a data chunk
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t chunk;
+} tx_fifo_entry_t;
+
+static tx_fifo_entry_t s_tx_fifo[ESPNOW_TX_FIFO_SIZE];
+static uint8_t s_tx_fifo_count = 0;
+static portMUX_TYPE s_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// End-to-end ACK expected for the message being sent
+static struct {
+    bool active;
+    uint8_t mac[6];
+    uint16_t packet_sequence;
+    uint32_t received_mask;
+} s_ack_wait;
 
 // ============================================================================
 // MAC Address Utilities
@@ -68,162 +114,408 @@ esp_err_t espnow_str_to_mac(const char *str, uint8_t *mac) {
 /**
  * @brief Internal send callback from ESP-NOW
  */
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0)
+static void espnow_send_cb(const esp_now_send_info_t *tx_info, esp_now_send_status_t status) {
+    const uint8_t *mac_addr = tx_info->des_addr;
+#else
 static void espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status) {
-    char mac_str[18];
-    espnow_mac_to_str(mac_addr, mac_str);
-    
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        ESP_LOGD(TAG, "Send success to %s, chunk %d/%d", 
-                 mac_str, s_send_ctx.current_chunk + 1, s_send_ctx.total_chunks);
-        s_send_ctx.state = ESPNOW_STATE_SUCCESS;
-        xEventGroupSetBits(s_send_event_group, ESPNOW_SEND_DONE_BIT | ESPNOW_SEND_SUCCESS_BIT);
-    } else {
-        ESP_LOGW(TAG, "Send failed to %s, chunk %d/%d (retry %d/%d)", 
-                 mac_str, s_send_ctx.current_chunk + 1, s_send_ctx.total_chunks,
-                 s_send_ctx.retry_count, s_config.max_retries);
-        s_send_ctx.state = ESPNOW_STATE_FAILED;
-        xEventGroupSetBits(s_send_event_group, ESPNOW_SEND_DONE_BIT);
+#endif
+    uint8_t chunk = TX_FIFO_CONTROL;
+    bool found = false;
+    
+    taskENTER_CRITICAL(&s_tx_lock);
+    for (uint8_t i = 0; i < s_tx_fifo_count; i++) {
+        if (memcmp(s_tx_fifo[i].mac, mac_addr, 6) == 0) {
+            chunk = s_tx_fifo[i].chunk;
+            memmove(&s_tx_fifo[i], &s_tx_fifo[i + 1], (s_tx_fifo_count - i - 1) * sizeof(tx_fifo_entry_t));
+            s_tx_fifo_count--;
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_tx_lock);
+    
+    // Late callbacks of frames given up after a timeout have no entry left
+    if (!found || chunk == TX_FIFO_CONTROL) {
+        return;
     }
+    
+    s_chunk_state[chunk] = (status == ESP_NOW_SEND_SUCCESS) ? CHUNK_SENT : CHUNK_FAILED;
+    xEventGroupSetBits(s_send_event_group, ESPNOW_SEND_DONE_BIT);
 }
 
 /**
- * @brief Internal receive callback from ESP-NOW
+ * @brief Record a frame in the send FIFO before handing it to esp_now_send
  */
-static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
-    if (!recv_info || !data || len < sizeof(espnow_packet_header_t)) {
+static bool tx_fifo_push(const uint8_t *mac, uint8_t chunk) {
+    bool ok = false;
+    
+    taskENTER_CRITICAL(&s_tx_lock);
+    if (s_tx_fifo_count < ESPNOW_TX_FIFO_SIZE) {
+        memcpy(s_tx_fifo[s_tx_fifo_count].mac, mac, 6);
+        s_tx_fifo[s_tx_fifo_count].chunk = chunk;
+        s_tx_fifo_count++;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&s_tx_lock);
+    return ok;
+}
+
+/**
+ * @brief Drop the newest FIFO entry of a frame (esp_now_send refused it)
+ */
+static void tx_fifo_remove(const uint8_t *mac, uint8_t chunk) {
+    taskENTER_CRITICAL(&s_tx_lock);
+    for (int i = s_tx_fifo_count - 1; i >= 0; i--) {
+        if (s_tx_fifo[i].chunk == chunk && memcmp(s_tx_fifo[i].mac, mac, 6) == 0) {
+            memmove(&s_tx_fifo[i], &s_tx_fifo[i + 1], (s_tx_fifo_count - i - 1) * sizeof(tx_fifo_entry_t));
+            s_tx_fifo_count--;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_tx_lock);
+}
+
+/**
+ * @brief Forget all data frames still queued for a destination
+ */
+static void tx_fifo_flush(const uint8_t *mac) {
+    taskENTER_CRITICAL(&s_tx_lock);
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < s_tx_fifo_count; i++) {
+        if (s_tx_fifo[i].chunk == TX_FIFO_CONTROL || memcmp(s_tx_fifo[i].mac, mac, 6) != 0) {
+            s_tx_fifo[n++] = s_tx_fifo[i];
+        }
+    }
+    s_tx_fifo_count = n;
+    taskEXIT_CRITICAL(&s_tx_lock);
+}
+
+/**
+ * @brief Answer a chunk that asked for an end-to-end ACK with our chunk bitmap
+ */
+static void send_ack(const uint8_t *dest_mac, const espnow_packet_header_t *hdr, uint32_t received_mask) {
+    // Replies need the sender as a peer; unknown senders are added unencrypted
+    if (!esp_now_is_peer_exist(dest_mac)) {
+        esp_now_peer_info_t peer_info = {0};
+        memcpy(peer_info.peer_addr, dest_mac, 6);
+        peer_info.channel = 0;  // Current channel
+        peer_info.ifidx = WIFI_IF_STA;
+        if (esp_now_add_peer(&peer_info) != ESP_OK) {
+            return;
+        }
+    }
+    
+    espnow_packet_t ack = {0};
+    espnow_ack_t body = {
+        .packet_sequence = hdr->packet_sequence,
+        .received_mask = received_mask
+    };
+    ack.header.node_id = s_config.node_id;
+    ack.header.packet_sequence = hdr->packet_sequence;
+    ack.header.total_chunks = s_config.header_crc ? ESPNOW_HEADER_CRC : 0;    // Control frame
+    ack.header.payload_length = sizeof(body);
+    memcpy(ack.payload, &body, sizeof(body));
+    ack.header.crc16 = espnow_frame_crc16(&ack.header, ack.payload);
+    
+    if (!tx_fifo_push(dest_mac, TX_FIFO_CONTROL)) {
+        return;
+    }
+    if (esp_now_send(dest_mac, (const uint8_t *)&ack, sizeof(espnow_packet_header_t) + sizeof(body)) != ESP_OK) {
+        tx_fifo_remove(dest_mac, TX_FIFO_CONTROL);
+    }
+}
+
+/**
+ * @brief Take an ACK frame for the message being sent
+ */
+static void handle_ack(const uint8_t *src_mac, const espnow_packet_t *packet) {
+    if (packet->header.payload_length != sizeof(espnow_ack_t)) {
+        return;
+    }
+    
+    espnow_ack_t body;
+    memcpy(&body, packet->payload, sizeof(body));
+    if (!s_ack_wait.active || body.packet_sequence != s_ack_wait.packet_sequence ||
+        memcmp(src_mac, s_ack_wait.mac, 6) != 0) {
+        return;
+    }
+    
+    s_ack_wait.received_mask = body.received_mask;
+    xEventGroupSetBits(s_send_event_group, ESPNOW_ACK_BIT);
+}
+
+/**
+ * @brief Check, reassemble and dispatch one received frame (RX task)
+ */
+static void process_frame(const rx_frame_t *frame) {
+    if (frame->len < sizeof(espnow_packet_header_t)) {
         ESP_LOGW(TAG, "Invalid received packet");
         return;
     }
     
-    // Extract RSSI
-    s_last_rssi = recv_info->rx_ctrl->rssi;
+    s_last_rssi = frame->rssi;
     
-    espnow_packet_t *packet = (espnow_packet_t *)data;
+    const espnow_packet_t *packet = (const espnow_packet_t *)frame->data;
+    if (packet->header.payload_length > frame->len - sizeof(espnow_packet_header_t)) {
+        ESP_LOGW(TAG, "Truncated packet (%d bytes)", frame->len);
+        return;
+    }
     
-    // Verify CRC
-    uint16_t calculated_crc = espnow_crc16(packet->payload, packet->header.payload_length);
+    // Verify CRC (covers the header too when the sender set ESPNOW_HEADER_CRC)
+    uint16_t calculated_crc = espnow_frame_crc16(&packet->header, packet->payload);
     if (calculated_crc != packet->header.crc16) {
         ESP_LOGW(TAG, "CRC mismatch! Expected 0x%04X, got 0x%04X", 
                  calculated_crc, packet->header.crc16);
         return;
     }
     
-    char mac_str[18];
-    espnow_mac_to_str(recv_info->src_addr, mac_str);
-    
-    ESP_LOGI(TAG, "Received from %s: Node %d, Seq %d, Chunk %d/%d, Len %d, RSSI %d dBm",
-             mac_str, 
-             packet->header.node_id,
-             packet->header.packet_sequence,
-             packet->header.chunk_index + 1,
-             packet->header.total_chunks,
-             packet->header.payload_length,
-             s_last_rssi);
-    
-    // If user registered a callback, invoke it
+    event_counter_inc(EVT_ESPNOW_RX_FRAME);
+    event_counter_add(EVT_ESPNOW_RX_BYTES, packet->header.payload_length);
+#if !CONFIG_APP_LOG_PRODUCTION
+    if (esp_log_level_get(TAG) >= ESP_LOG_DEBUG) {
+        char mac_str[18];
+        espnow_mac_to_str(frame->src_mac, mac_str);
+        ESP_LOGD(TAG, "Received from %s: Node %d, Seq %d, Chunk %d/%d, Len %d, RSSI %d dBm",
+                 mac_str, 
+                 packet->header.node_id,
+                 packet->header.packet_sequence,
+                 (packet->header.chunk_index & ESPNOW_CHUNK_INDEX_MASK) + 1,
+                 packet->header.total_chunks & ESPNOW_TOTAL_CHUNKS_MASK,
+                 packet->header.payload_length,
+                 frame->rssi);
+    }
+#endif
+    
+    if ((packet->header.total_chunks & ESPNOW_TOTAL_CHUNKS_MASK) == 0) {
+        handle_ack(frame->src_mac, packet);
+        return;
+    }
+    
+    // Only complete messages reach the user callback
+    const uint8_t *message = NULL;
+    size_t message_len = 0;
+    uint32_t ack_mask = 0;
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    esp_err_t ret = espnow_reassembly_feed(frame->src_mac, packet, now_ms,
+                                           &message, &message_len, &ack_mask);
+    if ((packet->header.chunk_index & ESPNOW_CHUNK_ACK_REQUEST) && ack_mask != 0) {
+        send_ack(frame->src_mac, &packet->header, ack_mask);
+    }
+    if (ret != ESP_OK) {
+        return;
+    }
+    
     if (s_recv_callback) {
-        s_recv_callback(recv_info->src_addr, packet->payload, 
-                       packet->header.payload_length, s_last_rssi);
+        s_recv_callback(frame->src_mac, message, message_len, frame->rssi);
     }
 }
 
-// ============================================================================
-// Fragmentation Logic
-// ============================================================================
-
 /**
- * @brief Fragment data into packets
- * @return Number of packets created
+ * @brief RX task: drains the receive ring
+ *
+ * A single-chunk message is passed to the user callback straight from its ring
+ * slot, so the slot is released only after the callback returned.
  */
-static uint8_t fragment_data(const uint8_t *data, size_t len, uint16_t sequence_num) {
-    uint8_t total_chunks = (len + ESPNOW_MAX_PAYLOAD_SIZE - 1) / ESPNOW_MAX_PAYLOAD_SIZE;
+static void espnow_rx_task(void *arg) {
+    while (!s_rx_stop) {
+        uint32_t tail = atomic_load_explicit(&s_rx_tail, memory_order_relaxed);
+        while (tail != atomic_load_explicit(&s_rx_head, memory_order_acquire)) {
+            process_frame(&s_rx_ring[tail % ESPNOW_RX_RING_SIZE]);
+            tail++;
+            atomic_store_explicit(&s_rx_tail, tail, memory_order_release);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
     
-    if (total_chunks > 32) {
-        ESP_LOGE(TAG, "Data too large: %d bytes requires %d chunks (max 32)", len, total_chunks);
-        return 0;
+    xEventGroupSetBits(s_send_event_group, ESPNOW_RX_STOPPED_BIT);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Internal receive callback from ESP-NOW
+ *
+ * Runs in the WiFi task: only copies the frame into the ring and wakes the RX
+ * task, which does the CRC check, reassembly and dispatch.
+ */
+static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
+    if (!recv_info || !data || len <= 0 || len > (int)sizeof(espnow_packet_t)) {
+        s_rx_dropped++;
+        return;
     }
     
-    for (uint8_t i = 0; i < total_chunks; i++) {
-        size_t offset = i * ESPNOW_MAX_PAYLOAD_SIZE;
-        size_t chunk_size = (offset + ESPNOW_MAX_PAYLOAD_SIZE > len) 
-                           ? (len - offset) : ESPNOW_MAX_PAYLOAD_SIZE;
-        
-        // Fill header
-        s_tx_packets[i].header.node_id = s_config.node_id;
-        s_tx_packets[i].header.packet_sequence = sequence_num;
-        s_tx_packets[i].header.total_chunks = total_chunks;
-        s_tx_packets[i].header.chunk_index = i;
-        s_tx_packets[i].header.payload_length = chunk_size;
-        
-        // Copy payload
-        memcpy(s_tx_packets[i].payload, data + offset, chunk_size);
-        
-        // Calculate CRC
-        s_tx_packets[i].header.crc16 = espnow_crc16(s_tx_packets[i].payload, chunk_size);
+    uint32_t head = atomic_load_explicit(&s_rx_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&s_rx_tail, memory_order_acquire) >= ESPNOW_RX_RING_SIZE) {
+        s_rx_dropped++;     // RX task is behind
+        return;
     }
     
-    return total_chunks;
+    rx_frame_t *frame = &s_rx_ring[head % ESPNOW_RX_RING_SIZE];
+    memcpy(frame->src_mac, recv_info->src_addr, 6);
+    frame->rssi = recv_info->rx_ctrl->rssi;
+    frame->len = (uint16_t)len;
+    memcpy(frame->data, data, len);
+    atomic_store_explicit(&s_rx_head, head + 1, memory_order_release);
+    
+    TaskHandle_t task = s_rx_task;
+    if (task) {
+        xTaskNotifyGive(task);
+    }
 }
 
 // ============================================================================
 // Send State Machine
 // ============================================================================
 
+static uint32_t backoff_ms(uint8_t retry) {
+    return 10 * (1 << retry);   // Exponential backoff
+}
+
 /**
- * @brief Send a single packet with retry logic
+ * @brief Hand one chunk to ESP-NOW
+ * @return ESP_OK if queued, ESP_ERR_ESPNOW_NO_MEM if the ESP-NOW queue is full
  */
-static esp_err_t send_packet_with_retry(const uint8_t *dest_mac, const espnow_packet_t *packet) {
-    esp_err_t err;
-    uint8_t retry = 0;
-    
-    // Calculate actual packet size (header + payload)
+static esp_err_t send_chunk(const uint8_t *dest_mac, uint8_t chunk) {
+    const espnow_packet_t *packet = &s_tx_packets[chunk];
     size_t packet_size = sizeof(espnow_packet_header_t) + packet->header.payload_length;
     
-    while (retry <= s_config.max_retries) {
-        // Clear event bits
-        xEventGroupClearBits(s_send_event_group, ESPNOW_SEND_DONE_BIT | ESPNOW_SEND_SUCCESS_BIT);
-        
-        // Send packet
-        s_send_ctx.state = ESPNOW_STATE_SENDING;
-        s_send_ctx.retry_count = retry;
-        s_send_ctx.last_send_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        
-        err = esp_now_send(dest_mac, (const uint8_t *)packet, packet_size);
-        if (err != ESP_OK) {
+    if (!tx_fifo_push(dest_mac, chunk)) {
+        return ESP_ERR_ESPNOW_NO_MEM;
+    }
+    
+    s_chunk_state[chunk] = CHUNK_IN_FLIGHT;
+    s_send_ctx.current_chunk = chunk;
+    s_send_ctx.last_send_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    
+    esp_err_t err = esp_now_send(dest_mac, (const uint8_t *)packet, packet_size);
+    if (err != ESP_OK) {
+        tx_fifo_remove(dest_mac, chunk);
+        s_chunk_state[chunk] = (err == ESP_ERR_ESPNOW_NO_MEM) ? CHUNK_PENDING : CHUNK_FAILED;
+        if (err != ESP_ERR_ESPNOW_NO_MEM) {
             ESP_LOGE(TAG, "esp_now_send failed: %s", esp_err_to_name(err));
-            retry++;
-            vTaskDelay(pdMS_TO_TICKS(10 * (1 << retry))); // Exponential backoff
+        }
+    }
+    return err;
+}
+
+/**
+ * @brief Send all chunks with a sliding window
+ *
+ * Up to the window size of chunks are in flight at once. The send callback
+ * marks each chunk sent or failed, and only failed chunks are retransmitted.
+ * With end-to-end ACKs the receiver's chunk bitmap decides which chunks are
+ * missing once every chunk was acknowledged at the MAC layer.
+ */
+static esp_err_t send_windowed(const uint8_t *dest_mac, uint8_t total_chunks, bool want_ack) {
+    uint8_t window = s_config.tx_window ? s_config.tx_window : ESPNOW_TX_WINDOW;
+    uint8_t ack_rounds = 0;
+    
+    if (window > ESPNOW_TX_FIFO_SIZE) {
+        window = ESPNOW_TX_FIFO_SIZE;
+    }
+    for (uint8_t i = 0; i < total_chunks; i++) {
+        s_chunk_state[i] = CHUNK_PENDING;
+        s_chunk_retries[i] = 0;
+    }
+    
+    while (1) {
+        // Count the window and requeue failed chunks that have retries left
+        uint8_t in_flight = 0;
+        uint8_t sent = 0;
+        uint8_t max_retry = 0;
+        for (uint8_t i = 0; i < total_chunks; i++) {
+            if (s_chunk_state[i] == CHUNK_FAILED) {
+                if (s_chunk_retries[i] >= s_config.max_retries) {
+                    ESP_LOGE(TAG, "Chunk %d/%d failed after %d retries", i + 1, total_chunks, s_config.max_retries);
+                    tx_fifo_flush(dest_mac);
+                    return ESP_ERR_TIMEOUT;
+                }
+                s_chunk_retries[i]++;
+                s_chunk_state[i] = CHUNK_PENDING;
+            }
+            if (s_chunk_retries[i] > max_retry && s_chunk_state[i] == CHUNK_PENDING) {
+                max_retry = s_chunk_retries[i];
+            }
+            if (s_chunk_state[i] == CHUNK_IN_FLIGHT) {
+                in_flight++;
+            } else if (s_chunk_state[i] == CHUNK_SENT) {
+                sent++;
+            }
+        }
+        s_send_ctx.retry_count = max_retry;
+        
+        if (sent == total_chunks) {
+            if (!want_ack) {
+                return ESP_OK;
+            }
+            
+            // Every chunk reached the receiver's radio, now ask what it kept
+            EventBits_t bits = xEventGroupWaitBits(s_send_event_group, ESPNOW_ACK_BIT, pdTRUE, pdFALSE,
+                                                   pdMS_TO_TICKS(ESPNOW_ACK_TIMEOUT_MS));
+            uint32_t mask = (bits & ESPNOW_ACK_BIT) ? s_ack_wait.received_mask : 0;
+            uint32_t full = (total_chunks >= 32) ? 0xFFFFFFFFu : ((1u << total_chunks) - 1);
+            if ((mask & full) == full) {
+                return ESP_OK;
+            }
+            if (++ack_rounds > s_config.max_retries) {
+                ESP_LOGE(TAG, "No end-to-end ACK after %d rounds", ack_rounds - 1);
+                return ESP_ERR_TIMEOUT;
+            }
+            
+            // Resend the gaps; without any ACK the last chunk prompts a new one
+            uint8_t missing = 0;
+            for (uint8_t i = 0; i < total_chunks; i++) {
+                if (!(mask & (1u << i))) {
+                    s_chunk_state[i] = CHUNK_PENDING;
+                    missing++;
+                }
+            }
+            if (mask == 0) {
+                for (uint8_t i = 0; i < total_chunks - 1; i++) {
+                    s_chunk_state[i] = CHUNK_SENT;
+                }
+            }
+            ESP_LOGW(TAG, "Receiver misses %d/%d chunks, resending", mask ? missing : 1, total_chunks);
             continue;
         }
         
-        // Wait for callback
-        EventBits_t bits = xEventGroupWaitBits(
-            s_send_event_group,
-            ESPNOW_SEND_DONE_BIT,
-            pdTRUE,  // Clear on exit
-            pdFALSE, // Wait for any bit
-            pdMS_TO_TICKS(s_config.send_timeout_ms)
-        );
+        // Back off before a retransmission round when nothing else is in flight
+        if (in_flight == 0 && max_retry > 0) {
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms(max_retry)));
+        }
         
-        if (bits & ESPNOW_SEND_DONE_BIT) {
-            if (bits & ESPNOW_SEND_SUCCESS_BIT) {
-                // Success!
-                return ESP_OK;
-            } else {
-                // Failed, retry
-                retry++;
-                vTaskDelay(pdMS_TO_TICKS(10 * (1 << retry))); // Exponential backoff
+        // Fill the window
+        for (uint8_t i = 0; i < total_chunks && in_flight < window; i++) {
+            if (s_chunk_state[i] != CHUNK_PENDING) {
+                continue;
+            }
+            esp_err_t err = send_chunk(dest_mac, i);
+            if (err == ESP_ERR_ESPNOW_NO_MEM) {
+                break;  // ESP-NOW queue full, wait for a completion
+            }
+            if (err == ESP_OK) {
+                in_flight++;
+            }
+        }
+        if (in_flight == 0) {
+            // Nothing was queued: let the ESP-NOW queue drain, retry accounting happens above
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms(0)));
+            continue;
+        }
+        
+        // Wait for at least one completion
+        EventBits_t bits = xEventGroupWaitBits(s_send_event_group, ESPNOW_SEND_DONE_BIT, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(s_config.send_timeout_ms));
+        if (!(bits & ESPNOW_SEND_DONE_BIT)) {
+            ESP_LOGW(TAG, "Send timeout, %d chunks in flight", in_flight);
+            tx_fifo_flush(dest_mac);
+            for (uint8_t i = 0; i < total_chunks; i++) {
+                if (s_chunk_state[i] == CHUNK_IN_FLIGHT) {
+                    s_chunk_state[i] = CHUNK_FAILED;
+                }
             }
-        } else {
-            // Timeout
-            ESP_LOGW(TAG, "Send timeout");
-            retry++;
-            vTaskDelay(pdMS_TO_TICKS(10 * (1 << retry)));
         }
     }
-    
-    ESP_LOGE(TAG, "Failed to send packet after %d retries", s_config.max_retries);
-    return ESP_ERR_TIMEOUT;
 }
 
 // ============================================================================
@@ -246,6 +538,8 @@ esp_err_t espnow_driver_init(const espnow_config_t *config) {
     // Copy configuration
     memcpy(&s_config, config, sizeof(espnow_config_t));
     
+    espnow_reassembly_reset();
+    
     // Create synchronization primitives
     s_send_mutex = xSemaphoreCreateMutex();
     s_send_event_group = xEventGroupCreate();
@@ -286,6 +580,10 @@ esp_err_t espnow_driver_init(const espnow_config_t *config) {
         return err;
     }
     
+    atomic_store(&s_rx_head, 0);
+    atomic_store(&s_rx_tail, 0);
+    s_rx_dropped = 0;
+    s_rx_stop = false;
     err = esp_now_register_recv_cb(espnow_recv_cb);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_now_register_recv_cb failed: %s", esp_err_to_name(err));
@@ -293,6 +591,15 @@ esp_err_t espnow_driver_init(const espnow_config_t *config) {
         return err;
     }
     
+    // Frames that arrive before the task runs wait in the ring
+    if (xTaskCreate(espnow_rx_task, "espnow_rx", ESPNOW_RX_TASK_STACK, NULL,
+                    ESPNOW_RX_TASK_PRIO, &s_rx_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create RX task");
+        s_rx_task = NULL;
+        esp_now_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    
     s_driver_initialized = true;
     s_send_ctx.state = ESPNOW_STATE_IDLE;
     
@@ -309,6 +616,14 @@ esp_err_t espnow_driver_deinit(void) {
     
     esp_now_deinit();
     
+    // No more frames arrive: let the RX task finish the frame it is on and exit
+    if (s_rx_task) {
+        s_rx_stop = true;
+        xTaskNotifyGive(s_rx_task);
+        xEventGroupWaitBits(s_send_event_group, ESPNOW_RX_STOPPED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        s_rx_task = NULL;
+    }
+    
     if (s_send_mutex) {
         vSemaphoreDelete(s_send_mutex);
         s_send_mutex = NULL;
@@ -402,14 +717,19 @@ esp_err_t espnow_driver_send(const uint8_t *dest_mac, const uint8_t *data, size_
     
     char mac_str[18];
     espnow_mac_to_str(dest_mac, mac_str);
-    ESP_LOGI(TAG, "Sending %d bytes to %s", len, mac_str);
+    EVT_LOGI(TAG, "Sending %d bytes to %s", (int)len, mac_str);
     
     // Generate sequence number
     static uint16_t sequence_num = 0;
     sequence_num++;
     
+    // Broadcasts have no single receiver to answer
+    static const uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    bool want_ack = s_config.end_to_end_ack && memcmp(dest_mac, broadcast_mac, 6) != 0;
+    
     // Fragment data
-    uint8_t total_chunks = fragment_data(data, len, sequence_num);
+    uint8_t total_chunks = espnow_fragment(s_tx_packets, data, len, s_config.node_id, sequence_num,
+                                           s_config.header_crc, want_ack);
     if (total_chunks == 0) {
         xSemaphoreGive(s_send_mutex);
         return ESP_ERR_INVALID_SIZE;
@@ -417,27 +737,20 @@ esp_err_t espnow_driver_send(const uint8_t *dest_mac, const uint8_t *data, size_
     
     s_send_ctx.total_chunks = total_chunks;
     s_send_ctx.is_sending = true;
-    s_current_dest_mac = dest_mac;
+    s_send_ctx.state = ESPNOW_STATE_SENDING;
     
-    // Send all chunks
-    esp_err_t result = ESP_OK;
-    for (uint8_t i = 0; i < total_chunks; i++) {
-        s_send_ctx.current_chunk = i;
-        
-        ESP_LOGD(TAG, "Sending chunk %d/%d (%d bytes)", 
-                 i + 1, total_chunks, s_tx_packets[i].header.payload_length);
-        
-        esp_err_t err = send_packet_with_retry(dest_mac, &s_tx_packets[i]);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send chunk %d/%d", i + 1, total_chunks);
-            result = err;
-            break;
-        }
-        
-        // Small delay between chunks to avoid buffer overflow
-        if (i < total_chunks - 1) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
+    if (want_ack) {
+        memcpy(s_ack_wait.mac, dest_mac, 6);
+        s_ack_wait.packet_sequence = sequence_num;
+        s_ack_wait.received_mask = 0;
+        s_ack_wait.active = true;
+    }
+    xEventGroupClearBits(s_send_event_group, ESPNOW_SEND_DONE_BIT | ESPNOW_ACK_BIT);
+    
+    esp_err_t result = send_windowed(dest_mac, total_chunks, want_ack);
+    s_ack_wait.active = false;
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send %d chunks to %s", total_chunks, mac_str);
     }
     
     s_send_ctx.is_sending = false;
@@ -451,7 +764,8 @@ esp_err_t espnow_driver_send(const uint8_t *dest_mac, const uint8_t *data, size_
     xSemaphoreGive(s_send_mutex);
     
     if (result == ESP_OK) {
-        ESP_LOGI(TAG, "Successfully sent %d chunks to %s", total_chunks, mac_str);
+        event_counter_inc(EVT_ESPNOW_TX_MSG);
+        EVT_LOGI(TAG, "Successfully sent %d chunks to %s", total_chunks, mac_str);
     }
     
     return result;
@@ -493,3 +807,10 @@ esp_err_t espnow_driver_wait_send_done(uint32_t timeout_ms) {
 int8_t espnow_driver_get_last_rssi(void) {
     return s_last_rssi;
 }
+
+void espnow_driver_get_rx_stats(espnow_rx_stats_t *stats) {
+    if (stats) {
+        espnow_reassembly_get_stats(stats);
+        stats->ring_dropped = s_rx_dropped;
+    }
+}
@@ -4,11 +4,14 @@
  * 
  * Features:
  * - Fragmentation for large payloads (>250 bytes)
+ * - Sliding-window transmission, only failed chunks are retransmitted
+ * - Optional end-to-end ACK with the receiver's chunk bitmap
  * - Retry mechanism with exponential backoff
  * - Packet sequencing and verification
  * - RTC memory persistence for deep sleep scenarios
  * - Send callback state machine
  * - CRC16 checksum validation
+ * - Receive-side reassembly with duplicate suppression (complete messages only)
  * - Both unicast and broadcast support
  */
 
@@ -17,6 +20,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_now.h"
 #include "esp_err.h"
 
@@ -34,6 +38,27 @@ extern "C" {
 #define ESPNOW_MAX_PEERS            10      // Maximum number of peers
 #define ESPNOW_WIFI_CHANNEL         1       // Default WiFi channel (1-13)
 #define ESPNOW_PMK_LEN              16      // Primary Master Key length
+#define ESPNOW_TX_WINDOW            4       // Default chunks in flight at once
+#define ESPNOW_TX_FIFO_SIZE         8       // Frames awaiting their send callback (window + ACKs)
+#define ESPNOW_ACK_TIMEOUT_MS       50      // Wait for the receiver's end-to-end ACK
+
+// chunk_index carries a flag in its top bit
+#define ESPNOW_CHUNK_INDEX_MASK     0x7F
+#define ESPNOW_CHUNK_ACK_REQUEST    0x80    // Receiver answers with an espnow_ack_t
+
+// total_chunks carries a flag in its top bit
+#define ESPNOW_TOTAL_CHUNKS_MASK    0x7F
+#define ESPNOW_HEADER_CRC           0x80    // crc16 also covers the header fields before it
+
+// Receive-side reassembly
+#define ESPNOW_REASSEMBLY_SLOTS     4       // Messages reassembled concurrently
+#define ESPNOW_REASSEMBLY_TIMEOUT_MS 500    // Incomplete messages are dropped after this
+#define ESPNOW_RECENT_MESSAGES      8       // Completed messages remembered for duplicate checks
+
+// Receive path: the WiFi callback only copies frames into a ring, a task processes them
+#define ESPNOW_RX_RING_SIZE         16      // Frames buffered between callback and RX task
+#define ESPNOW_RX_TASK_STACK        4096    // Runs the receive callback
+#define ESPNOW_RX_TASK_PRIO         19      // Below the WiFi task, above the application tasks
 
 // ============================================================================
 // Data Structures
@@ -46,12 +71,21 @@ extern "C" {
 typedef struct __attribute__((packed)) {
     uint8_t node_id;            // Sender identification
     uint16_t packet_sequence;   // Sequential packet number
-    uint8_t total_chunks;       // Total number of fragments
-    uint8_t chunk_index;        // Current fragment index (0-based)
+    uint8_t total_chunks;       // Total number of fragments, ESPNOW_HEADER_CRC flag
+    uint8_t chunk_index;        // Current fragment index (0-based), ESPNOW_CHUNK_ACK_REQUEST flag
+                                // total_chunks == 0 marks a control (ACK) frame
     uint16_t payload_length;    // Actual payload bytes in this chunk
-    uint16_t crc16;             // CRC16 checksum of payload
+    uint16_t crc16;             // CRC16 of the payload (ESPNOW_HEADER_CRC: of header and payload)
 } espnow_packet_header_t;
 
+/**
+ * @brief End-to-end ACK payload, sent back once the last chunk arrived
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t packet_sequence;   // Acknowledged message
+    uint32_t received_mask;     // Bit n set for every chunk the receiver holds
+} espnow_ack_t;
+
 /**
  * @brief Complete ESP-NOW packet structure
  */
@@ -94,6 +128,18 @@ typedef struct {
     bool is_sending;
 } espnow_send_context_t;
 
+/**
+ * @brief Receive statistics
+ */
+typedef struct {
+    uint32_t completed;         // Messages delivered to the receive callback
+    uint32_t duplicates;        // Chunks or messages received twice
+    uint32_t timeouts;          // Incomplete messages dropped after the timeout
+    uint32_t evicted;           // Incomplete messages dropped for lack of a slot
+    uint32_t malformed;         // Packets with an invalid chunk header
+    uint32_t ring_dropped;      // Frames dropped because the RX task fell behind
+} espnow_rx_stats_t;
+
 /**
  * @brief Driver configuration
  */
@@ -104,10 +150,18 @@ typedef struct {
     uint8_t pmk[ESPNOW_PMK_LEN];       // Primary Master Key
     uint32_t send_timeout_ms;           // Send timeout in milliseconds
     uint8_t max_retries;                // Maximum retry attempts
+    uint8_t tx_window;                  // Chunks in flight at once (0 = ESPNOW_TX_WINDOW)
+    bool end_to_end_ack;                // Wait for the receiver's chunk bitmap on unicast sends
+    bool header_crc;                    // Let the CRC cover the header too (receivers without
+                                        // ESPNOW_HEADER_CRC support drop these frames)
 } espnow_config_t;
 
 /**
  * @brief Receive callback function type
+ *
+ * Called once per complete (reassembled) message on the driver's RX task,
+ * not in the WiFi task. Frames that arrive meanwhile wait in the receive ring.
+ *
  * @param src_mac Source MAC address
  * @param data Received data buffer
  * @param len Length of received data
@@ -155,10 +209,15 @@ esp_err_t espnow_driver_remove_peer(const uint8_t *mac_addr);
 
 /**
  * @brief Send data to a specific peer (with fragmentation if needed)
+ *
+ * A message is at most ESPNOW_MAX_CHUNKS (espnow_fragment.h) fragments of
+ * ESPNOW_MAX_PAYLOAD_SIZE, i.e. 1600 bytes: the largest message the receiving
+ * driver reassembles. Send larger data in several messages.
+ *
  * @param dest_mac Destination MAC address
  * @param data Data buffer to send
- * @param len Length of data
- * @return ESP_OK on success
+ * @param len Length of data (1..1600 bytes)
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if len exceeds 1600 bytes
  */
 esp_err_t espnow_driver_send(const uint8_t *dest_mac, const uint8_t *data, size_t len);
 
@@ -203,6 +262,12 @@ esp_err_t espnow_driver_wait_send_done(uint32_t timeout_ms);
  */
 int8_t espnow_driver_get_last_rssi(void);
 
+/**
+ * @brief Get receive and reassembly statistics
+ * @param stats Output statistics
+ */
+void espnow_driver_get_rx_stats(espnow_rx_stats_t *stats);
+
 // ============================================================================
 // Utility Functions
 // ============================================================================
@@ -215,6 +280,19 @@ int8_t espnow_driver_get_last_rssi(void);
  */
 uint16_t espnow_crc16(const uint8_t *data, size_t len);
 
+/**
+ * @brief CRC16 of a frame as carried in its header
+ *
+ * The payload CRC, continued from the header fields before crc16 when the
+ * header has the ESPNOW_HEADER_CRC flag. Frames without the flag get the same
+ * value as espnow_crc16() of the payload, so older nodes interoperate.
+ *
+ * @param hdr Frame header (payload_length must be valid)
+ * @param payload Frame payload
+ * @return CRC16 value
+ */
+uint16_t espnow_frame_crc16(const espnow_packet_header_t *hdr, const uint8_t *payload);
+
 /**
  * @brief Convert MAC address to string
  * @param mac MAC address
@@ -0,0 +1,66 @@
+/**
+ * @file espnow_fragment.c
+ * @brief ESP-NOW Send-Side Fragmentation Implementation
+ */
+
+#include "espnow_fragment.h"
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "string.h"
+#include <stddef.h>
+
+static const char *TAG = "ESPNOW_TX";
+
+// ============================================================================
+// CRC
+// ============================================================================
+
+// esp_crc16_le is the table-driven ROM routine; it chains, so the header and
+// payload are checked in one pass without copying them together
+uint16_t espnow_crc16(const uint8_t *data, size_t len) {
+    return esp_crc16_le(0xFFFF, data, len);
+}
+
+uint16_t espnow_frame_crc16(const espnow_packet_header_t *hdr, const uint8_t *payload) {
+    uint16_t crc = 0xFFFF;
+    if (hdr->total_chunks & ESPNOW_HEADER_CRC) {
+        crc = esp_crc16_le(crc, (const uint8_t *)hdr, offsetof(espnow_packet_header_t, crc16));
+    }
+    return esp_crc16_le(crc, payload, hdr->payload_length);
+}
+
+// ============================================================================
+// Fragmentation
+// ============================================================================
+
+uint8_t espnow_fragment(espnow_packet_t *packets, const uint8_t *data, size_t len,
+                        uint8_t node_id, uint16_t sequence_num, bool header_crc, bool ack_request) {
+    size_t chunks = (len + ESPNOW_MAX_PAYLOAD_SIZE - 1) / ESPNOW_MAX_PAYLOAD_SIZE;
+    
+    if (chunks > ESPNOW_MAX_CHUNKS) {
+        ESP_LOGE(TAG, "Data too large: %d bytes requires %d chunks (max %d)", (int)len, (int)chunks, ESPNOW_MAX_CHUNKS);
+        return 0;
+    }
+    uint8_t total_chunks = (uint8_t)chunks;
+    
+    for (uint8_t i = 0; i < total_chunks; i++) {
+        size_t offset = i * ESPNOW_MAX_PAYLOAD_SIZE;
+        size_t chunk_size = (offset + ESPNOW_MAX_PAYLOAD_SIZE > len) 
+                           ? (len - offset) : ESPNOW_MAX_PAYLOAD_SIZE;
+        
+        // Fill header
+        packets[i].header.node_id = node_id;
+        packets[i].header.packet_sequence = sequence_num;
+        packets[i].header.total_chunks = header_crc ? (total_chunks | ESPNOW_HEADER_CRC) : total_chunks;
+        packets[i].header.chunk_index = ack_request ? (i | ESPNOW_CHUNK_ACK_REQUEST) : i;
+        packets[i].header.payload_length = chunk_size;
+        
+        // Copy payload
+        memcpy(packets[i].payload, data + offset, chunk_size);
+        
+        // Calculate CRC
+        packets[i].header.crc16 = espnow_frame_crc16(&packets[i].header, packets[i].payload);
+    }
+    
+    return total_chunks;
+}
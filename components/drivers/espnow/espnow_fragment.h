@@ -0,0 +1,42 @@
+/**
+ * @file espnow_fragment.h
+ * @brief ESP-NOW Send-Side Fragmentation
+ *
+ * Splits a message into the packets espnow_driver_send() hands to ESP-NOW
+ * and computes their CRCs. Needs no radio, so the host tests cover it
+ * together with espnow_reassembly.
+ */
+
+#ifndef ESPNOW_FRAGMENT_H
+#define ESPNOW_FRAGMENT_H
+
+#include "espnow_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fragments per message. The sender refuses and the receiver drops anything
+// longer, so both sides agree on the largest message (8 x 200 bytes).
+#define ESPNOW_MAX_CHUNKS           8
+
+/**
+ * @brief Fragment a message into packets
+ *
+ * @param packets Output packets (ESPNOW_MAX_CHUNKS entries)
+ * @param data Message
+ * @param len Message length
+ * @param node_id Sender node id written to every header
+ * @param sequence_num Message sequence number written to every header
+ * @param header_crc Let the CRC cover the header too (ESPNOW_HEADER_CRC)
+ * @param ack_request Ask the receiver for an end-to-end ACK (ESPNOW_CHUNK_ACK_REQUEST)
+ * @return Number of packets written, 0 if the message needs more than ESPNOW_MAX_CHUNKS
+ */
+uint8_t espnow_fragment(espnow_packet_t *packets, const uint8_t *data, size_t len,
+                        uint8_t node_id, uint16_t sequence_num, bool header_crc, bool ack_request);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESPNOW_FRAGMENT_H
@@ -0,0 +1,225 @@
+/**
+ * @file espnow_reassembly.c
+ * @brief ESP-NOW Receive-Side Reassembly Implementation
+ */
+
+#include "espnow_reassembly.h"
+#include "espnow_fragment.h"
+#include "esp_log.h"
+#include "string.h"
+
+static const char *TAG = "ESPNOW_RX";
+
+// ============================================================================
+// Private Types and Variables
+// ============================================================================
+
+/**
+ * @brief Message being reassembled
+ */
+typedef struct {
+    bool in_use;
+    uint8_t src_mac[6];
+    uint8_t node_id;
+    uint16_t packet_sequence;
+    uint8_t total_chunks;
+    uint32_t received_mask;     // Bit n set once chunk n arrived
+    uint32_t first_seen_ms;
+    size_t length;              // Set once the last chunk arrived
+    uint8_t buffer[ESPNOW_MAX_CHUNKS * ESPNOW_MAX_PAYLOAD_SIZE];
+} reassembly_slot_t;
+
+/**
+ * @brief Recently completed message, used to drop late retransmissions
+ */
+typedef struct {
+    bool valid;
+    uint8_t src_mac[6];
+    uint8_t node_id;
+    uint16_t packet_sequence;
+    uint32_t completed_ms;
+} recent_message_t;
+
+static reassembly_slot_t s_slots[ESPNOW_REASSEMBLY_SLOTS];
+static recent_message_t s_recent[ESPNOW_RECENT_MESSAGES];
+static uint8_t s_recent_next = 0;
+static espnow_rx_stats_t s_stats = {0};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static bool key_matches(const uint8_t *mac_a, uint8_t node_a, uint16_t seq_a,
+                        const uint8_t *mac_b, uint8_t node_b, uint16_t seq_b) {
+    return node_a == node_b && seq_a == seq_b && memcmp(mac_a, mac_b, 6) == 0;
+}
+
+static uint32_t full_mask(uint8_t total_chunks) {
+    return (total_chunks >= 32) ? 0xFFFFFFFFu : ((1u << total_chunks) - 1);
+}
+
+static bool is_recent(const uint8_t *src_mac, const espnow_packet_header_t *hdr, uint32_t now_ms) {
+    for (int i = 0; i < ESPNOW_RECENT_MESSAGES; i++) {
+        const recent_message_t *r = &s_recent[i];
+        if (r->valid && (now_ms - r->completed_ms) < ESPNOW_REASSEMBLY_TIMEOUT_MS &&
+            key_matches(r->src_mac, r->node_id, r->packet_sequence,
+                        src_mac, hdr->node_id, hdr->packet_sequence)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void remember_completed(const uint8_t *src_mac, const espnow_packet_header_t *hdr, uint32_t now_ms) {
+    recent_message_t *r = &s_recent[s_recent_next];
+    s_recent_next = (s_recent_next + 1) % ESPNOW_RECENT_MESSAGES;
+
+    r->valid = true;
+    memcpy(r->src_mac, src_mac, 6);
+    r->node_id = hdr->node_id;
+    r->packet_sequence = hdr->packet_sequence;
+    r->completed_ms = now_ms;
+}
+
+/**
+ * @brief Find the slot of a message, or claim one (free, stale, else oldest)
+ */
+static reassembly_slot_t *get_slot(const uint8_t *src_mac, const espnow_packet_header_t *hdr, uint32_t now_ms) {
+    reassembly_slot_t *free_slot = NULL;
+    reassembly_slot_t *oldest = NULL;
+
+    for (int i = 0; i < ESPNOW_REASSEMBLY_SLOTS; i++) {
+        reassembly_slot_t *slot = &s_slots[i];
+        if (slot->in_use && (now_ms - slot->first_seen_ms) >= ESPNOW_REASSEMBLY_TIMEOUT_MS) {
+            ESP_LOGW(TAG, "Node %d seq %d timed out with %d/%d chunks", slot->node_id,
+                     slot->packet_sequence, __builtin_popcount(slot->received_mask), slot->total_chunks);
+            slot->in_use = false;
+            s_stats.timeouts++;
+        }
+        if (!slot->in_use) {
+            if (free_slot == NULL) {
+                free_slot = slot;
+            }
+            continue;
+        }
+        if (key_matches(slot->src_mac, slot->node_id, slot->packet_sequence,
+                        src_mac, hdr->node_id, hdr->packet_sequence)) {
+            return slot;
+        }
+        if (oldest == NULL || (now_ms - slot->first_seen_ms) > (now_ms - oldest->first_seen_ms)) {
+            oldest = slot;
+        }
+    }
+
+    reassembly_slot_t *slot = free_slot;
+    if (slot == NULL) {
+        ESP_LOGW(TAG, "No free slot, evicting node %d seq %d", oldest->node_id, oldest->packet_sequence);
+        s_stats.evicted++;
+        slot = oldest;
+    }
+
+    slot->in_use = true;
+    memcpy(slot->src_mac, src_mac, 6);
+    slot->node_id = hdr->node_id;
+    slot->packet_sequence = hdr->packet_sequence;
+    slot->total_chunks = hdr->total_chunks & ESPNOW_TOTAL_CHUNKS_MASK;
+    slot->received_mask = 0;
+    slot->first_seen_ms = now_ms;
+    slot->length = 0;
+    return slot;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void espnow_reassembly_reset(void) {
+    memset(s_slots, 0, sizeof(s_slots));
+    memset(s_recent, 0, sizeof(s_recent));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_recent_next = 0;
+}
+
+esp_err_t espnow_reassembly_feed(const uint8_t *src_mac, const espnow_packet_t *packet,
+                                 uint32_t now_ms, const uint8_t **out, size_t *out_len,
+                                 uint32_t *ack_mask) {
+    const espnow_packet_header_t *hdr = &packet->header;
+    uint8_t index = hdr->chunk_index & ESPNOW_CHUNK_INDEX_MASK;
+    uint8_t total = hdr->total_chunks & ESPNOW_TOTAL_CHUNKS_MASK;
+
+    *ack_mask = 0;
+    if (total == 0 || index >= total ||
+        hdr->payload_length > ESPNOW_MAX_PAYLOAD_SIZE ||
+        (index < total - 1 && hdr->payload_length != ESPNOW_MAX_PAYLOAD_SIZE)) {
+        s_stats.malformed++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (is_recent(src_mac, hdr, now_ms)) {
+        // The sender missed our ACK and retransmitted
+        *ack_mask = full_mask(total);
+        s_stats.duplicates++;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Single-chunk messages need no buffering
+    if (total == 1) {
+        remember_completed(src_mac, hdr, now_ms);
+        s_stats.completed++;
+        *ack_mask = 1;
+        *out = packet->payload;
+        *out_len = hdr->payload_length;
+        return ESP_OK;
+    }
+
+    if (total > ESPNOW_MAX_CHUNKS) {
+        ESP_LOGW(TAG, "Node %d seq %d has %d chunks (max %d)", hdr->node_id,
+                 hdr->packet_sequence, total, ESPNOW_MAX_CHUNKS);
+        s_stats.malformed++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    reassembly_slot_t *slot = get_slot(src_mac, hdr, now_ms);
+    if (slot->total_chunks != total) {
+        // Same key with a different shape: the sender restarted its sequence counter
+        slot->total_chunks = total;
+        slot->received_mask = 0;
+        slot->first_seen_ms = now_ms;
+        slot->length = 0;
+    }
+
+    uint32_t bit = 1u << index;
+    if (slot->received_mask & bit) {
+        if (slot->length > 0) {
+            *ack_mask = slot->received_mask;
+        }
+        s_stats.duplicates++;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memcpy(slot->buffer + index * ESPNOW_MAX_PAYLOAD_SIZE, packet->payload, hdr->payload_length);
+    slot->received_mask |= bit;
+    if (index == total - 1) {
+        slot->length = index * ESPNOW_MAX_PAYLOAD_SIZE + hdr->payload_length;
+    }
+    if (slot->length > 0) {
+        // From the last chunk on every arrival is answered, so resent gaps are confirmed
+        *ack_mask = slot->received_mask;
+    }
+
+    if (slot->received_mask != full_mask(slot->total_chunks)) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    // The buffer stays intact until the slot is claimed again by a later call
+    slot->in_use = false;
+    remember_completed(src_mac, hdr, now_ms);
+    s_stats.completed++;
+    *out = slot->buffer;
+    *out_len = slot->length;
+    return ESP_OK;
+}
+
+void espnow_reassembly_get_stats(espnow_rx_stats_t *stats) {
+    *stats = s_stats;
+}
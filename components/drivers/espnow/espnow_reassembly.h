@@ -0,0 +1,56 @@
+/**
+ * @file espnow_reassembly.h
+ * @brief ESP-NOW Receive-Side Reassembly
+ *
+ * Collects the fragments produced by espnow_driver_send() per
+ * (source MAC, node_id, packet_sequence) in preallocated slots:
+ * - Bitmap of received chunks, out-of-order arrival is fine
+ * - Duplicate chunks and retransmissions of completed messages are dropped
+ * - Incomplete messages are evicted after ESPNOW_REASSEMBLY_TIMEOUT_MS
+ * - Only complete messages are returned to the caller
+ */
+
+#ifndef ESPNOW_REASSEMBLY_H
+#define ESPNOW_REASSEMBLY_H
+
+#include "espnow_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reset all slots and statistics
+ */
+void espnow_reassembly_reset(void);
+
+/**
+ * @brief Feed one verified packet into the reassembly table
+ *
+ * @param src_mac Source MAC address
+ * @param packet Received packet (header and payload)
+ * @param now_ms Current time in milliseconds
+ * @param out Receives the complete message (valid until the next call)
+ * @param out_len Receives the message length
+ * @param ack_mask Receives the chunk bitmap to acknowledge, 0 while no ACK is due
+ *                 (an ACK is due once the last chunk or the whole message arrived)
+ * @return ESP_OK when the message is complete,
+ *         ESP_ERR_NOT_FINISHED while chunks are missing,
+ *         ESP_ERR_INVALID_STATE for a duplicate,
+ *         ESP_ERR_INVALID_SIZE for a malformed or too large message
+ */
+esp_err_t espnow_reassembly_feed(const uint8_t *src_mac, const espnow_packet_t *packet,
+                                 uint32_t now_ms, const uint8_t **out, size_t *out_len,
+                                 uint32_t *ack_mask);
+
+/**
+ * @brief Get receive statistics
+ * @param stats Output statistics
+ */
+void espnow_reassembly_get_stats(espnow_rx_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESPNOW_REASSEMBLY_H
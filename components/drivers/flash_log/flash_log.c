@@ -0,0 +1,550 @@
+/**
+ * @file flash_log.c
+ * @brief Append-only Ring Log on a Raw Flash Partition - Implementation
+ */
+
+#include "flash_log.h"
+
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include <string.h>
+
+static const char *TAG = "FLASH_LOG";
+
+#define FLASH_LOG_SECTOR_MAGIC      0x474F4C46u     // "FLOG"
+#define FLASH_LOG_RECORD_MAGIC      0xA55Au
+#define FLASH_LOG_RTC_MAGIC         0x52544346u
+#define FLASH_LOG_STATE_VALID       0xFFFFFFFFu     // Erased value: record not consumed yet
+#define FLASH_LOG_STATE_CONSUMED    0x00000000u
+
+/**
+ * @brief Header at the start of every sector in use
+ */
+typedef struct {
+    uint32_t magic;                 ///< FLASH_LOG_SECTOR_MAGIC
+    uint32_t seq;                   ///< Increases every time the head enters a new sector
+} flash_log_sector_hdr_t;
+
+/**
+ * @brief Header in front of every record payload
+ */
+typedef struct {
+    uint16_t magic;                 ///< FLASH_LOG_RECORD_MAGIC
+    uint16_t length;                ///< Payload length in bytes
+    uint32_t crc32;                 ///< CRC32 of the payload
+    uint32_t state;                 ///< FLASH_LOG_STATE_VALID or _CONSUMED (programmed last)
+} flash_log_record_hdr_t;
+
+#define SECTOR_HDR_SIZE     sizeof(flash_log_sector_hdr_t)
+#define RECORD_HDR_SIZE     sizeof(flash_log_record_hdr_t)
+#define RECORD_STATE_OFFSET offsetof(flash_log_record_hdr_t, state)
+
+/**
+ * @brief Positions kept across deep sleep so wakeups skip the recovery scan
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t address;
+    uint32_t head_sector;
+    uint32_t head_offset;
+    uint32_t head_seq;
+    uint32_t tail_sector;
+    uint32_t tail_offset;
+    uint32_t record_count;
+} flash_log_rtc_state_t;
+
+RTC_DATA_ATTR static flash_log_rtc_state_t s_rtc_state[FLASH_LOG_MAX_INSTANCES];
+
+// ============================================================================
+// Flash Helpers
+// ============================================================================
+
+static inline uint32_t record_size(uint32_t payload_len)
+{
+    return (RECORD_HDR_SIZE + payload_len + 3u) & ~3u;
+}
+
+static inline size_t sector_addr(uint32_t sector)
+{
+    return (size_t)sector * FLASH_LOG_SECTOR_SIZE;
+}
+
+static bool read_sector_header(const flash_log_t* log, uint32_t sector, uint32_t* seq)
+{
+    flash_log_sector_hdr_t hdr;
+    if (esp_partition_read(log->partition, sector_addr(sector), &hdr, sizeof(hdr)) != ESP_OK) {
+        return false;
+    }
+    if (hdr.magic != FLASH_LOG_SECTOR_MAGIC || hdr.seq == 0xFFFFFFFFu) {
+        return false;
+    }
+    *seq = hdr.seq;
+    return true;
+}
+
+static esp_err_t format_sector(const flash_log_t* log, uint32_t sector, uint32_t seq)
+{
+    esp_err_t ret = esp_partition_erase_range(log->partition, sector_addr(sector), FLASH_LOG_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %lu: %s", (unsigned long)sector, esp_err_to_name(ret));
+        return ret;
+    }
+    flash_log_sector_hdr_t hdr = { .magic = FLASH_LOG_SECTOR_MAGIC, .seq = seq };
+    return esp_partition_write(log->partition, sector_addr(sector), &hdr, sizeof(hdr));
+}
+
+/**
+ * @brief Read a record header; false at the end of the sector's records
+ */
+static bool read_record_header(const flash_log_t* log, uint32_t sector, uint32_t offset,
+                               flash_log_record_hdr_t* hdr)
+{
+    if (offset + RECORD_HDR_SIZE > FLASH_LOG_SECTOR_SIZE) {
+        return false;
+    }
+    if (esp_partition_read(log->partition, sector_addr(sector) + offset, hdr, sizeof(*hdr)) != ESP_OK) {
+        return false;
+    }
+    if (hdr->magic != FLASH_LOG_RECORD_MAGIC) {
+        return false;
+    }
+    return offset + record_size(hdr->length) <= FLASH_LOG_SECTOR_SIZE;
+}
+
+static bool is_blank(const flash_log_t* log, uint32_t sector, uint32_t offset)
+{
+    uint32_t word = 0;
+    if (offset + sizeof(word) > FLASH_LOG_SECTOR_SIZE) {
+        return true;
+    }
+    esp_partition_read(log->partition, sector_addr(sector) + offset, &word, sizeof(word));
+    return word == 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Find the next unconsumed record at or after (sector, offset)
+ *
+ * @return false when the head is reached
+ */
+static bool find_record(const flash_log_t* log, uint32_t* sector, uint32_t* offset,
+                        flash_log_record_hdr_t* hdr)
+{
+    while (true) {
+        if (*sector == log->head_sector && *offset >= log->head_offset) {
+            return false;
+        }
+        if (read_record_header(log, *sector, *offset, hdr)) {
+            if (hdr->state == FLASH_LOG_STATE_VALID) {
+                return true;
+            }
+            *offset += record_size(hdr->length);
+            continue;
+        }
+        // No more records in this sector: continue with the next one
+        if (*sector == log->head_sector) {
+            return false;
+        }
+        *sector = (*sector + 1) % log->sector_count;
+        *offset = SECTOR_HDR_SIZE;
+    }
+}
+
+static uint32_t count_sector_records(const flash_log_t* log, uint32_t sector, uint32_t offset)
+{
+    flash_log_record_hdr_t hdr;
+    uint32_t count = 0;
+    while (read_record_header(log, sector, offset, &hdr)) {
+        if (hdr.state == FLASH_LOG_STATE_VALID) {
+            count++;
+        }
+        offset += record_size(hdr.length);
+    }
+    return count;
+}
+
+// ============================================================================
+// RTC Position Cache
+// ============================================================================
+
+static void rtc_save(const flash_log_t* log)
+{
+    if (log->rtc_slot < 0) {
+        return;
+    }
+    flash_log_rtc_state_t* st = &s_rtc_state[log->rtc_slot];
+    st->magic = FLASH_LOG_RTC_MAGIC;
+    st->address = log->partition->address;
+    st->head_sector = log->head_sector;
+    st->head_offset = log->head_offset;
+    st->head_seq = log->head_seq;
+    st->tail_sector = log->tail_sector;
+    st->tail_offset = log->tail_offset;
+    st->record_count = log->record_count;
+}
+
+static int rtc_find_slot(uint32_t address)
+{
+    int free_slot = -1;
+    for (int i = 0; i < FLASH_LOG_MAX_INSTANCES; i++) {
+        if (s_rtc_state[i].magic == FLASH_LOG_RTC_MAGIC && s_rtc_state[i].address == address) {
+            return i;
+        }
+        if (free_slot < 0 && s_rtc_state[i].magic != FLASH_LOG_RTC_MAGIC) {
+            free_slot = i;
+        }
+    }
+    return free_slot;
+}
+
+static bool rtc_restore(flash_log_t* log)
+{
+    if (log->rtc_slot < 0 || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        return false;
+    }
+    const flash_log_rtc_state_t* st = &s_rtc_state[log->rtc_slot];
+    if (st->magic != FLASH_LOG_RTC_MAGIC || st->address != log->partition->address ||
+        st->head_sector >= log->sector_count || st->tail_sector >= log->sector_count) {
+        return false;
+    }
+    log->head_sector = st->head_sector;
+    log->head_offset = st->head_offset;
+    log->head_seq = st->head_seq;
+    log->tail_sector = st->tail_sector;
+    log->tail_offset = st->tail_offset;
+    log->record_count = st->record_count;
+    return true;
+}
+
+// ============================================================================
+// Recovery
+// ============================================================================
+
+static esp_err_t recover(flash_log_t* log)
+{
+    // Head is the sector with the highest sequence number
+    bool found = false;
+    for (uint32_t s = 0; s < log->sector_count; s++) {
+        uint32_t seq;
+        if (read_sector_header(log, s, &seq) && (!found || seq > log->head_seq)) {
+            log->head_sector = s;
+            log->head_seq = seq;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "No log found on '%s', formatting", log->partition->label);
+        log->head_sector = 0;
+        log->head_seq = 1;
+        log->head_offset = SECTOR_HDR_SIZE;
+        log->tail_sector = 0;
+        log->tail_offset = SECTOR_HDR_SIZE;
+        log->record_count = 0;
+        return format_sector(log, 0, log->head_seq);
+    }
+
+    // Write position: first free slot in the head sector
+    flash_log_record_hdr_t hdr;
+    uint32_t offset = SECTOR_HDR_SIZE;
+    while (read_record_header(log, log->head_sector, offset, &hdr)) {
+        offset += record_size(hdr.length);
+    }
+    if (!is_blank(log, log->head_sector, offset)) {
+        // Torn write: never program over it, continue in a fresh sector
+        ESP_LOGW(TAG, "Incomplete record at sector %lu offset %lu",
+                 (unsigned long)log->head_sector, (unsigned long)offset);
+        offset = FLASH_LOG_SECTOR_SIZE;
+    }
+    log->head_offset = offset;
+
+    // Oldest data follows the head in ring order
+    bool have_tail = false;
+    log->record_count = 0;
+    for (uint32_t i = 1; i <= log->sector_count; i++) {
+        uint32_t s = (log->head_sector + i) % log->sector_count;
+        uint32_t seq;
+        if (!read_sector_header(log, s, &seq) || seq > log->head_seq) {
+            continue;
+        }
+        offset = SECTOR_HDR_SIZE;
+        while (read_record_header(log, s, offset, &hdr)) {
+            if (hdr.state == FLASH_LOG_STATE_VALID) {
+                if (!have_tail) {
+                    log->tail_sector = s;
+                    log->tail_offset = offset;
+                    have_tail = true;
+                }
+                log->record_count++;
+            }
+            offset += record_size(hdr.length);
+        }
+    }
+    if (!have_tail) {
+        log->tail_sector = log->head_sector;
+        log->tail_offset = log->head_offset;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Move the head into the next sector, dropping the oldest data if needed
+ */
+static esp_err_t advance_head(flash_log_t* log)
+{
+    uint32_t next = (log->head_sector + 1) % log->sector_count;
+
+    if (log->record_count > 0 && log->tail_sector == next) {
+        uint32_t dropped = count_sector_records(log, next, log->tail_offset);
+        log->record_count -= (dropped < log->record_count) ? dropped : log->record_count;
+        log->dropped_count += dropped;
+        log->tail_sector = (next + 1) % log->sector_count;
+        log->tail_offset = SECTOR_HDR_SIZE;
+        ESP_LOGW(TAG, "Log full, dropped %lu oldest records", (unsigned long)dropped);
+    }
+
+    esp_err_t ret = format_sector(log, next, log->head_seq + 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    log->head_seq++;
+    log->head_sector = next;
+    log->head_offset = SECTOR_HDR_SIZE;
+
+    if (log->record_count == 0) {
+        log->tail_sector = log->head_sector;
+        log->tail_offset = log->head_offset;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t flash_log_init(flash_log_t* log, const char* partition_label)
+{
+    if (log == NULL || partition_label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(log, 0, sizeof(*log));
+    log->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                              partition_label);
+    if (log->partition == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found - check partitions.csv", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    log->sector_count = log->partition->size / FLASH_LOG_SECTOR_SIZE;
+    if (log->sector_count < 2) {
+        ESP_LOGE(TAG, "Partition '%s' too small (need at least 2 sectors)", partition_label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    log->rtc_slot = rtc_find_slot(log->partition->address);
+
+    if (rtc_restore(log)) {
+        ESP_LOGD(TAG, "Restored log positions from RTC memory");
+    } else {
+        esp_err_t ret = recover(log);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    log->is_initialized = true;
+    rtc_save(log);
+
+    ESP_LOGI(TAG, "Log '%s' ready: %lu records, %lu sectors",
+             partition_label, (unsigned long)log->record_count, (unsigned long)log->sector_count);
+    return ESP_OK;
+}
+
+esp_err_t flash_log_deinit(flash_log_t* log)
+{
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (log->is_initialized) {
+        rtc_save(log);
+    }
+    log->is_initialized = false;
+    return ESP_OK;
+}
+
+size_t flash_log_max_record_size(void)
+{
+    return FLASH_LOG_SECTOR_SIZE - SECTOR_HDR_SIZE - RECORD_HDR_SIZE;
+}
+
+esp_err_t flash_log_append(flash_log_t* log, const void* data, size_t len)
+{
+    if (log == NULL || !log->is_initialized || data == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len == 0 || len > flash_log_max_record_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t size = record_size(len);
+    if (log->head_offset + size > FLASH_LOG_SECTOR_SIZE) {
+        esp_err_t ret = advance_head(log);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    // Magic, length and CRC first; the state word is left erased (valid)
+    flash_log_record_hdr_t hdr = {
+        .magic = FLASH_LOG_RECORD_MAGIC,
+        .length = (uint16_t)len,
+        .crc32 = esp_crc32_le(0, data, len),
+    };
+    size_t addr = sector_addr(log->head_sector) + log->head_offset;
+    esp_err_t ret = esp_partition_write(log->partition, addr, &hdr, RECORD_STATE_OFFSET);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(log->partition, addr + RECORD_HDR_SIZE, data, len);
+    }
+    // Even a failed write may have programmed bits: never reuse this slot
+    log->head_offset += size;
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(ret));
+        rtc_save(log);
+        return ret;
+    }
+
+    if (log->record_count == 0) {
+        log->tail_sector = log->head_sector;
+        log->tail_offset = log->head_offset - size;
+    }
+    log->record_count++;
+    rtc_save(log);
+    return ESP_OK;
+}
+
+void flash_log_cursor_init(const flash_log_t* log, flash_log_cursor_t* cursor)
+{
+    cursor->sector = log->tail_sector;
+    cursor->offset = log->tail_offset;
+    cursor->remaining = log->record_count;
+}
+
+esp_err_t flash_log_read(const flash_log_t* log, flash_log_cursor_t* cursor,
+                         void* buf, size_t buf_size, size_t* len)
+{
+    if (log == NULL || !log->is_initialized || cursor == NULL || buf == NULL || len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cursor->remaining == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    flash_log_record_hdr_t hdr;
+    if (!find_record(log, &cursor->sector, &cursor->offset, &hdr)) {
+        cursor->remaining = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (hdr.length > buf_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = esp_partition_read(log->partition,
+                                       sector_addr(cursor->sector) + cursor->offset + RECORD_HDR_SIZE,
+                                       buf, hdr.length);
+    cursor->offset += record_size(hdr.length);
+    cursor->remaining--;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    *len = hdr.length;
+    if (esp_crc32_le(0, buf, hdr.length) != hdr.crc32) {
+        ESP_LOGW(TAG, "Skipping corrupt record (CRC mismatch)");
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_log_peek(const flash_log_t* log, void* buf, size_t buf_size, size_t* len)
+{
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    flash_log_cursor_t cursor;
+    flash_log_cursor_init(log, &cursor);
+    return flash_log_read(log, &cursor, buf, buf_size, len);
+}
+
+esp_err_t flash_log_pop(flash_log_t* log, uint32_t count)
+{
+    if (log == NULL || !log->is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    while (count > 0 && log->record_count > 0) {
+        uint32_t sector = log->tail_sector;
+        uint32_t offset = log->tail_offset;
+        flash_log_record_hdr_t hdr;
+        if (!find_record(log, &sector, &offset, &hdr)) {
+            log->record_count = 0;
+            break;
+        }
+
+        uint32_t consumed = FLASH_LOG_STATE_CONSUMED;
+        ret = esp_partition_write(log->partition, sector_addr(sector) + offset + RECORD_STATE_OFFSET,
+                                  &consumed, sizeof(consumed));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to mark record consumed: %s", esp_err_to_name(ret));
+            break;
+        }
+
+        log->tail_sector = sector;
+        log->tail_offset = offset + record_size(hdr.length);
+        log->record_count--;
+        count--;
+    }
+
+    if (log->record_count == 0) {
+        log->tail_sector = log->head_sector;
+        log->tail_offset = log->head_offset;
+    }
+    rtc_save(log);
+    return ret;
+}
+
+esp_err_t flash_log_clear(flash_log_t* log)
+{
+    if (log == NULL || !log->is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Erase every sector from the tail up to the head, then restart in the head sector
+    uint32_t sector = log->tail_sector;
+    while (sector != log->head_sector) {
+        esp_partition_erase_range(log->partition, sector_addr(sector), FLASH_LOG_SECTOR_SIZE);
+        sector = (sector + 1) % log->sector_count;
+    }
+    esp_err_t ret = format_sector(log, log->head_sector, log->head_seq + 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    log->head_seq++;
+    log->head_offset = SECTOR_HDR_SIZE;
+    log->tail_sector = log->head_sector;
+    log->tail_offset = log->head_offset;
+    log->record_count = 0;
+    rtc_save(log);
+    return ESP_OK;
+}
+
+uint32_t flash_log_count(const flash_log_t* log)
+{
+    if (log == NULL || !log->is_initialized) {
+        return 0;
+    }
+    return log->record_count;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file flash_log.h
+ * @brief Append-only Ring Log on a Raw Flash Partition
+ *
+ * Stores variable-length records in a dedicated data partition. The partition
+ * is used as a ring of 4 KB sectors:
+ *   - Each sector starts with a header holding a monotonically increasing
+ *     sequence number, so head and tail can be recovered after a reset.
+ *   - Records (header + payload, 4-byte aligned) never straddle a sector and
+ *     carry a CRC32 of their payload.
+ *   - Consuming a record only programs its state word from 0xFFFFFFFF to 0,
+ *     so nothing is ever rewritten or shifted.
+ *   - When the head wraps onto the oldest sector, that sector is erased and its
+ *     remaining records are dropped (oldest data is overwritten first).
+ *
+ * Append and pop are O(1) flash operations. Head/tail positions are cached in
+ * RTC memory so a deep-sleep wakeup does not need to rescan the partition.
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLASH_LOG_SECTOR_SIZE       4096    ///< Flash erase unit
+#define FLASH_LOG_MAX_INSTANCES     3       ///< Logs that can keep an RTC position cache
+
+/**
+ * @brief Ring log handle
+ */
+typedef struct {
+    const esp_partition_t* partition;   ///< Backing data partition
+    uint32_t sector_count;              ///< Number of sectors in the ring
+    uint32_t head_sector;               ///< Sector currently written
+    uint32_t head_offset;               ///< Next write offset in the head sector
+    uint32_t head_seq;                  ///< Sequence number of the head sector
+    uint32_t tail_sector;               ///< Sector holding the oldest record
+    uint32_t tail_offset;               ///< Offset of the oldest unconsumed record
+    uint32_t record_count;              ///< Unconsumed records in the log
+    uint32_t dropped_count;             ///< Records overwritten since init
+    int rtc_slot;                       ///< RTC position cache slot (-1 if none)
+    bool is_initialized;                ///< Initialization status
+} flash_log_t;
+
+/**
+ * @brief Read cursor for walking the log from oldest to newest
+ */
+typedef struct {
+    uint32_t sector;                    ///< Current sector
+    uint32_t offset;                    ///< Current offset in the sector
+    uint32_t remaining;                 ///< Records left to visit
+} flash_log_cursor_t;
+
+/**
+ * @brief Open (and if needed format) a ring log on a partition
+ *
+ * @param log Log handle
+ * @param partition_label Label of a data partition (at least 2 sectors)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t flash_log_init(flash_log_t* log, const char* partition_label);
+
+/**
+ * @brief Close the log (positions stay cached in RTC memory)
+ *
+ * @param log Log handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t flash_log_deinit(flash_log_t* log);
+
+/**
+ * @brief Append a record
+ *
+ * @param log Log handle
+ * @param data Record payload
+ * @param len Payload length (max flash_log_max_record_size())
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if too large
+ */
+esp_err_t flash_log_append(flash_log_t* log, const void* data, size_t len);
+
+/**
+ * @brief Start reading at the oldest record
+ *
+ * @param log Log handle
+ * @param cursor Cursor to initialize
+ */
+void flash_log_cursor_init(const flash_log_t* log, flash_log_cursor_t* cursor);
+
+/**
+ * @brief Read the record at the cursor and advance it
+ *
+ * Records that fail their CRC check are skipped.
+ *
+ * @param log Log handle
+ * @param cursor Read cursor
+ * @param buf Destination buffer
+ * @param buf_size Destination size
+ * @param len Receives the payload length
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND at the end of the log,
+ *         ESP_ERR_INVALID_SIZE if buf is too small (cursor is not advanced)
+ */
+esp_err_t flash_log_read(const flash_log_t* log, flash_log_cursor_t* cursor,
+                         void* buf, size_t buf_size, size_t* len);
+
+/**
+ * @brief Read the oldest record without consuming it
+ */
+esp_err_t flash_log_peek(const flash_log_t* log, void* buf, size_t buf_size, size_t* len);
+
+/**
+ * @brief Consume the oldest records
+ *
+ * @param log Log handle
+ * @param count Number of records to consume
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t flash_log_pop(flash_log_t* log, uint32_t count);
+
+/**
+ * @brief Drop all records (erases only the sectors in use)
+ */
+esp_err_t flash_log_clear(flash_log_t* log);
+
+/**
+ * @brief Number of unconsumed records
+ */
+uint32_t flash_log_count(const flash_log_t* log);
+
+/**
+ * @brief Largest payload a single record can hold
+ */
+size_t flash_log_max_record_size(void);
+
+#endif // FLASH_LOG_H
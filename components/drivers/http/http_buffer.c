@@ -4,110 +4,144 @@
  */
 
 #include "http_buffer.h"
+#include "flash_log.h"
 #include "esp_utils.h"
+#include "config/esp32-config.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "HTTPBuffer";
 
-// NVS buffering constants
-#define HTTP_BUFFER_NAMESPACE "http_buffer"
-#define HTTP_BUFFER_COUNT_KEY "pkt_count"
-#define HTTP_BUFFER_PACKET_KEY "pkt_%03d"
+// Buffering constants
 #define MAX_PACKET_SIZE 1024
 #define DEFAULT_MAX_BUFFERED_PACKETS 50
 
 // Static variables
-static nvs_handle_t s_nvs_handle = 0;
+static flash_log_t s_log;
 static bool s_buffering_enabled = false;
 static int32_t s_max_buffered_packets = DEFAULT_MAX_BUFFERED_PACKETS;
 
+// Add and flush may run on different tasks at once; flash_log is not thread safe
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#if STATIC_ALLOCATION_ENABLED
+// Fixed pool instead of a malloc per packet: one slot for add, one for flush
+static uint8_t s_pool[HTTP_BUFFER_POOL_SLOTS][MAX_PACKET_SIZE] __attribute__((aligned(4)));
+static uint32_t s_pool_used = 0;
+static portMUX_TYPE s_pool_mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+static void http_buffer_lock(void)
+{
+    if (s_lock == NULL) {
+        portENTER_CRITICAL(&s_lock_mux);
+        if (s_lock == NULL) {
+            s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+        }
+        portEXIT_CRITICAL(&s_lock_mux);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void http_buffer_unlock(void)
+{
+    xSemaphoreGive(s_lock);
+}
+
+static http_buffered_packet_t* packet_alloc(size_t size)
+{
+#if STATIC_ALLOCATION_ENABLED
+    http_buffered_packet_t* packet = NULL;
+    if (size <= MAX_PACKET_SIZE) {
+        portENTER_CRITICAL(&s_pool_mux);
+        for (int i = 0; i < HTTP_BUFFER_POOL_SLOTS; i++) {
+            if ((s_pool_used & (1UL << i)) == 0) {
+                s_pool_used |= 1UL << i;
+                packet = (http_buffered_packet_t*)s_pool[i];
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&s_pool_mux);
+    }
+    return packet;
+#else
+    return malloc(size);
+#endif
+}
+
+static void packet_free(http_buffered_packet_t* packet)
+{
+#if STATIC_ALLOCATION_ENABLED
+    int i = (int)(((uint8_t*)packet - s_pool[0]) / MAX_PACKET_SIZE);
+    portENTER_CRITICAL(&s_pool_mux);
+    s_pool_used &= ~(1UL << i);
+    portEXIT_CRITICAL(&s_pool_mux);
+#else
+    free(packet);
+#endif
+}
+
 esp_err_t http_buffer_init(const http_buffer_config_t* config)
 {
     if (config == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    http_buffer_lock();
     s_buffering_enabled = config->enable_buffering;
-    s_max_buffered_packets = (config->max_buffered_packets > 0) ? 
+    s_max_buffered_packets = (config->max_buffered_packets > 0) ?
                             config->max_buffered_packets : DEFAULT_MAX_BUFFERED_PACKETS;
-    
-    // Initialize NVS for buffering if enabled
+
+    // Open the flash ring log for buffering if enabled
+    esp_err_t ret = ESP_OK;
     if (s_buffering_enabled) {
-        esp_err_t nvs_ret = nvs_open(HTTP_BUFFER_NAMESPACE, NVS_READWRITE, &s_nvs_handle);
-        if (nvs_ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to open NVS for buffering: %s", esp_err_to_name(nvs_ret));
+        ret = flash_log_init(&s_log, HTTP_BUFFER_PARTITION);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to open flash log for buffering: %s", esp_err_to_name(ret));
             s_buffering_enabled = false;
-            return nvs_ret;
         } else {
-            ESP_LOGI(TAG, "HTTP buffering initialized (max %ld packets)", (long)s_max_buffered_packets);
+            ESP_LOGI(TAG, "HTTP buffering initialized (max %ld packets, %lu stored)",
+                     (long)s_max_buffered_packets, (unsigned long)flash_log_count(&s_log));
         }
     }
-    
-    return ESP_OK;
+    http_buffer_unlock();
+
+    return ret;
 }
 
 esp_err_t http_buffer_deinit(void)
 {
-    if (s_buffering_enabled && s_nvs_handle != 0) {
-        nvs_close(s_nvs_handle);
-        s_nvs_handle = 0;
+    http_buffer_lock();
+    if (s_buffering_enabled) {
+        flash_log_deinit(&s_log);
     }
-    
+
     s_buffering_enabled = false;
+    http_buffer_unlock();
     ESP_LOGI(TAG, "HTTP buffer deinitialized");
     return ESP_OK;
 }
 
 esp_err_t http_buffer_add_packet(const char* json_payload)
 {
-    if (!s_buffering_enabled || s_nvs_handle == 0 || json_payload == NULL) {
+    if (!http_buffer_is_enabled() || json_payload == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Get current packet count
-    int32_t packet_count = 0;
-    esp_err_t ret = nvs_get_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, &packet_count);
-    if (ret == ESP_ERR_NVS_NOT_FOUND) {
-        packet_count = 0;
-    } else if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get packet count: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    // Check buffer limit
-    if (packet_count >= s_max_buffered_packets) {
-        ESP_LOGW(TAG, "Buffer full (%ld packets), dropping oldest", (long)packet_count);
-        // Remove oldest packet (packet 0) and shift others down
-        for (int32_t i = 0; i < packet_count - 1; i++) {
-            char old_key[32], new_key[32];
-            snprintf(old_key, sizeof(old_key), HTTP_BUFFER_PACKET_KEY, (int)(i + 1));
-            snprintf(new_key, sizeof(new_key), HTTP_BUFFER_PACKET_KEY, (int)i);
-            
-            size_t blob_size = MAX_PACKET_SIZE;
-            char temp_buffer[MAX_PACKET_SIZE];
-            ret = nvs_get_blob(s_nvs_handle, old_key, temp_buffer, &blob_size);
-            if (ret == ESP_OK) {
-                nvs_set_blob(s_nvs_handle, new_key, temp_buffer, blob_size);
-            }
-        }
-        packet_count--;
-    }
-
-    // Store new packet
-    char packet_key[32];
-    snprintf(packet_key, sizeof(packet_key), HTTP_BUFFER_PACKET_KEY, (int)packet_count);
-    
     size_t payload_len = strlen(json_payload);
-    if (payload_len >= MAX_PACKET_SIZE - sizeof(uint32_t) - sizeof(uint16_t)) {
+    if (payload_len >= MAX_PACKET_SIZE - sizeof(http_buffered_packet_t)) {
         ESP_LOGE(TAG, "Packet too large to buffer (%d bytes)", payload_len);
         return ESP_ERR_INVALID_SIZE;
     }
 
     // Create buffered packet structure
-    http_buffered_packet_t* packet = malloc(sizeof(http_buffered_packet_t) + payload_len + 1);
+    size_t packet_size = sizeof(http_buffered_packet_t) + payload_len + 1;
+    http_buffered_packet_t* packet = packet_alloc(packet_size);
     if (packet == NULL) {
         ESP_LOGE(TAG, "Failed to allocate memory for buffered packet");
         return ESP_ERR_NO_MEM;
@@ -115,101 +149,59 @@ esp_err_t http_buffer_add_packet(const char* json_payload)
 
     packet->timestamp = (uint32_t)(esp_utils_get_timestamp_ms());
     packet->payload_size = payload_len;
-    strcpy(packet->payload, json_payload);
+    memcpy(packet->payload, json_payload, payload_len + 1);
 
-    size_t packet_size = sizeof(http_buffered_packet_t) + payload_len + 1;
-    ret = nvs_set_blob(s_nvs_handle, packet_key, packet, packet_size);
-    free(packet);
-
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to store buffered packet: %s", esp_err_to_name(ret));
-        return ret;
+    http_buffer_lock();
+    // Check buffer limit: consuming the oldest record is a single flash write
+    if ((int32_t)flash_log_count(&s_log) >= s_max_buffered_packets) {
+        ESP_LOGW(TAG, "Buffer full (%ld packets), dropping oldest", (long)s_max_buffered_packets);
+        flash_log_pop(&s_log, 1);
     }
 
-    // Update packet count
-    packet_count++;
-    ret = nvs_set_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, packet_count);
+    esp_err_t ret = flash_log_append(&s_log, packet, packet_size);
+    uint32_t stored = flash_log_count(&s_log);
+    http_buffer_unlock();
+    packet_free(packet);
+
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to update packet count: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to store buffered packet: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Commit changes
-    nvs_commit(s_nvs_handle);
-    
-    ESP_LOGI(TAG, "Packet buffered (%ld/%ld packets stored)", (long)packet_count, (long)s_max_buffered_packets);
+    ESP_LOGI(TAG, "Packet buffered (%lu/%ld packets stored)",
+             (unsigned long)stored, (long)s_max_buffered_packets);
     return ESP_OK;
 }
 
 int32_t http_buffer_get_count(void)
 {
-    if (!s_buffering_enabled || s_nvs_handle == 0) {
-        return 0;
-    }
-
-    int32_t stored_count = 0;
-    esp_err_t ret = nvs_get_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, &stored_count);
-    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+    if (!http_buffer_is_enabled()) {
         return 0;
-    } else if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to get buffered packet count: %s", esp_err_to_name(ret));
-        return 0;
-    }
-    
-    // Validate that packets actually exist and count real packets
-    int32_t actual_count = 0;
-    for (int32_t i = 0; i < stored_count; i++) {
-        char packet_key[32];
-        snprintf(packet_key, sizeof(packet_key), HTTP_BUFFER_PACKET_KEY, (int)i);
-        
-        size_t required_size = 0;
-        ret = nvs_get_blob(s_nvs_handle, packet_key, NULL, &required_size);
-        if (ret == ESP_OK && required_size > 0) {
-            actual_count++;
-        }
     }
-    
-    // If count mismatch detected, correct it
-    if (actual_count != stored_count) {
-        ESP_LOGW(TAG, "Packet count mismatch detected: stored=%ld, actual=%ld. Correcting...", 
-                 (long)stored_count, (long)actual_count);
-        nvs_set_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, actual_count);
-        nvs_commit(s_nvs_handle);
-    }
-    
-    return actual_count;
+    return (int32_t)flash_log_count(&s_log);
 }
 
 esp_err_t http_buffer_clear_all(void)
 {
-    if (!s_buffering_enabled || s_nvs_handle == 0) {
+    if (!http_buffer_is_enabled()) {
         return ESP_OK;
     }
 
-    int32_t packet_count = http_buffer_get_count();
-    
-    // Clear all packet entries
-    for (int32_t i = 0; i < packet_count; i++) {
-        char packet_key[32];
-        snprintf(packet_key, sizeof(packet_key), HTTP_BUFFER_PACKET_KEY, (int)i);
-        nvs_erase_key(s_nvs_handle, packet_key);
-    }
-    
-    // Reset packet count
-    esp_err_t ret = nvs_set_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, 0);
+    http_buffer_lock();
+    int32_t packet_count = (int32_t)flash_log_count(&s_log);
+    esp_err_t ret = flash_log_clear(&s_log);
+    http_buffer_unlock();
     if (ret != ESP_OK) {
         return ret;
     }
-    
-    nvs_commit(s_nvs_handle);
+
     ESP_LOGI(TAG, "Cleared %ld buffered packets", (long)packet_count);
-    
     return ESP_OK;
 }
 
 esp_err_t http_buffer_flush_packets(http_buffer_send_func_t send_func)
 {
-    if (!s_buffering_enabled || s_nvs_handle == 0 || send_func == NULL) {
+    if (!http_buffer_is_enabled() || send_func == NULL) {
         return ESP_OK; // Nothing to flush
     }
 
@@ -219,88 +211,68 @@ esp_err_t http_buffer_flush_packets(http_buffer_send_func_t send_func)
     }
 
     ESP_LOGI(TAG, "Flushing %ld buffered packets...", (long)packet_count);
-    
+
+    http_buffered_packet_t* packet = packet_alloc(MAX_PACKET_SIZE);
+    if (packet == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate memory for packet flush");
+        return ESP_ERR_NO_MEM;
+    }
+
     int32_t sent_count = 0;
     int32_t failed_count = 0;
 
-    for (int32_t i = 0; i < packet_count; i++) {
-        char packet_key[32];
-        snprintf(packet_key, sizeof(packet_key), HTTP_BUFFER_PACKET_KEY, (int)i);
-        
-        // First check if the packet exists
-        size_t required_size = 0;
-        esp_err_t check_ret = nvs_get_blob(s_nvs_handle, packet_key, NULL, &required_size);
-        if (check_ret != ESP_OK || required_size == 0) {
-            ESP_LOGD(TAG, "Packet %ld does not exist, skipping", (long)i);
-            continue; // Skip non-existent packets without counting as failure
-        }
-        
-        size_t packet_size = MAX_PACKET_SIZE;
-        http_buffered_packet_t* packet = malloc(MAX_PACKET_SIZE);
-        if (packet == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate memory for packet flush");
-            failed_count++;
-            continue;
+    // The lock is held from peek to pop, so an add that drops the oldest packet cannot
+    // make the pop consume a packet that was not sent; it is released between packets
+    while (true) {
+        http_buffer_lock();
+        if (flash_log_count(&s_log) == 0) {
+            http_buffer_unlock();
+            break;
         }
 
-        esp_err_t ret = nvs_get_blob(s_nvs_handle, packet_key, packet, &packet_size);
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to read buffered packet %ld: %s", (long)i, esp_err_to_name(ret));
-            free(packet);
-            failed_count++;
+        size_t packet_size = 0;
+        esp_err_t ret = flash_log_peek(&s_log, packet, MAX_PACKET_SIZE - 1, &packet_size);
+        if (ret == ESP_ERR_INVALID_CRC || ret == ESP_ERR_INVALID_SIZE) {
+            ESP_LOGW(TAG, "Discarding unreadable buffered packet: %s", esp_err_to_name(ret));
+            flash_log_pop(&s_log, 1);
+            http_buffer_unlock();
             continue;
+        } else if (ret != ESP_OK) {
+            http_buffer_unlock();
+            ESP_LOGW(TAG, "Failed to read buffered packet: %s", esp_err_to_name(ret));
+            failed_count++;
+            break;
         }
+        ((char*)packet)[packet_size] = '\0';
 
         // Try to send the buffered packet using provided function
         esp_err_t send_result = send_func(packet->payload);
-        if (send_result == ESP_OK) {
-            sent_count++;
-            // Remove successful packet from storage
-            nvs_erase_key(s_nvs_handle, packet_key);
-        } else {
-            ESP_LOGW(TAG, "Failed to send buffered packet %ld, keeping in buffer", (long)i);
+        if (send_result != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send buffered packet, keeping %lu in buffer",
+                     (unsigned long)flash_log_count(&s_log));
+            http_buffer_unlock();
             failed_count++;
+            break;
         }
-        
-        free(packet);
-        
+
+        // Remove successful packet from storage
+        flash_log_pop(&s_log, 1);
+        http_buffer_unlock();
+        sent_count++;
+
         // Small delay between packets to avoid overwhelming server
         vTaskDelay(pdMS_TO_TICKS(100));
     }
 
-    // Compact the buffer by removing gaps
-    if (sent_count > 0) {
-        int32_t new_count = 0;
-        for (int32_t i = 0; i < packet_count; i++) {
-            char packet_key[32];
-            snprintf(packet_key, sizeof(packet_key), HTTP_BUFFER_PACKET_KEY, (int)i);
-            
-            size_t packet_size = MAX_PACKET_SIZE;
-            char temp_buffer[MAX_PACKET_SIZE];
-            esp_err_t ret = nvs_get_blob(s_nvs_handle, packet_key, temp_buffer, &packet_size);
-            if (ret == ESP_OK) {
-                if (new_count != i) {
-                    char new_key[32];
-                    snprintf(new_key, sizeof(new_key), HTTP_BUFFER_PACKET_KEY, (int)new_count);
-                    nvs_set_blob(s_nvs_handle, new_key, temp_buffer, packet_size);
-                    nvs_erase_key(s_nvs_handle, packet_key);
-                }
-                new_count++;
-            }
-        }
-        
-        // Update packet count
-        nvs_set_i32(s_nvs_handle, HTTP_BUFFER_COUNT_KEY, new_count);
-        nvs_commit(s_nvs_handle);
-        
-        ESP_LOGI(TAG, "Flush complete: %ld sent, %ld failed, %ld remaining", 
-                 (long)sent_count, (long)failed_count, (long)new_count);
-    }
+    packet_free(packet);
+
+    ESP_LOGI(TAG, "Flush complete: %ld sent, %ld failed, %ld remaining",
+             (long)sent_count, (long)failed_count, (long)http_buffer_get_count());
 
     return (failed_count == 0) ? ESP_OK : ESP_FAIL;
 }
 
 bool http_buffer_is_enabled(void)
 {
-    return s_buffering_enabled && s_nvs_handle != 0;
-}
\ No newline at end of file
+    return s_buffering_enabled && s_log.is_initialized;
+}
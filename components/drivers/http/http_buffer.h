@@ -2,9 +2,12 @@
  * @file http_buffer.h
  * @brief HTTP Packet Buffering System
  * 
- * This module provides NVS-based packet buffering for HTTP requests when
- * the server is temporarily unavailable. It implements a FIFO buffer with
- * automatic overflow handling.
+ * This module provides flash-based packet buffering for HTTP requests when
+ * the server is temporarily unavailable. Add and flush may be called from
+ * different tasks. Packets are stored in a ring log
+ * on the HTTP_BUFFER_PARTITION data partition (see flash_log.h), so adding
+ * and removing a packet are O(1) flash operations and the oldest packets are
+ * dropped automatically on overflow.
  */
 
 #ifndef HTTP_BUFFER_H
@@ -12,8 +15,6 @@
 
 #include "esp_err.h"
 #include "esp_log.h"
-#include "nvs_flash.h"
-#include "nvs.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -74,6 +75,11 @@ esp_err_t http_buffer_clear_all(void);
 /**
  * @brief Flush buffered packets using provided send function
  * 
+ * Packets are sent oldest first and removed as soon as they are accepted.
+ * Flushing stops at the first failure so the remaining packets keep their order.
+ * Adds from other tasks wait while a packet is sent; send_func must not call
+ * back into http_buffer.
+ * 
  * @param send_func Function pointer to send individual packets
  * @return esp_err_t ESP_OK if all packets sent successfully, ESP_FAIL if some failed
  */
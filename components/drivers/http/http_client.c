@@ -5,6 +5,9 @@
 
 #include "http_client.h"
 #include "http_buffer.h"
+#include "http_pool.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -16,7 +19,11 @@ static const char *TAG = "HTTPClient";
 static http_client_config_t s_config;
 static int s_last_status_code = 0;
 static bool s_initialized = false;
-static esp_http_client_handle_t s_persistent_client = NULL;
+static char s_url[256];                   // Full endpoint URL, built at init
+static const http_pool_header_t s_headers[] = {
+    { "Content-Type", "application/json" },
+};
+static http_pool_endpoint_t s_endpoint;   // Server on the shared connection pool
 
 // Forward declarations
 static esp_err_t http_event_handler(esp_http_client_event_t *evt);
@@ -29,28 +36,19 @@ esp_err_t http_client_init(const http_client_config_t* config)
 
     memcpy(&s_config, config, sizeof(http_client_config_t));
     
-    // Create persistent HTTP client
-    char url[128];
-    snprintf(url, sizeof(url), "http://%s:%d", 
-             s_config.server_ip, s_config.server_port);
-
-    esp_http_client_config_t client_config = {
-        .url = url,
-        .event_handler = http_event_handler,
+    // Requests run on the shared connection pool, which keeps the connection warm
+    snprintf(s_url, sizeof(s_url), "http://%s:%d%s",
+             s_config.server_ip, s_config.server_port, s_config.endpoint);
+    s_endpoint = (http_pool_endpoint_t){
+        .host = s_config.server_ip,
+        .port = s_config.server_port,
+        .use_tls = false,
         .timeout_ms = s_config.timeout_ms,
-        .method = HTTP_METHOD_POST,
-        .keep_alive_enable = true,
-        .keep_alive_idle = 5,
-        .keep_alive_interval = 5,
-        .keep_alive_count = 3,
+        .headers = s_headers,
+        .header_count = sizeof(s_headers) / sizeof(s_headers[0]),
+        .event_handler = http_event_handler,
     };
 
-    s_persistent_client = esp_http_client_init(&client_config);
-    if (s_persistent_client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize persistent HTTP client");
-        return ESP_FAIL;
-    }
-
     s_initialized = true;
     
     // Initialize HTTP buffer
@@ -72,9 +70,8 @@ esp_err_t http_client_init(const http_client_config_t* config)
 
 esp_err_t http_client_deinit(void)
 {
-    if (s_persistent_client) {
-        esp_http_client_cleanup(s_persistent_client);
-        s_persistent_client = NULL;
+    if (s_initialized) {
+        http_pool_drop(&s_endpoint);
     }
     
     // Deinitialize HTTP buffer
@@ -87,64 +84,44 @@ esp_err_t http_client_deinit(void)
 
 http_response_status_t http_client_send_json(const char* json_payload)
 {
-    if (!s_initialized || json_payload == NULL || s_persistent_client == NULL) {
+    if (!s_initialized || json_payload == NULL) {
         return HTTP_RESPONSE_ERROR;
     }
 
-    // Build full URL with endpoint
-    char full_url[256];
-    snprintf(full_url, sizeof(full_url), "http://%s:%d%s", 
-             s_config.server_ip, s_config.server_port, s_config.endpoint);
-
-    // Set the specific endpoint for this request
-    esp_http_client_set_url(s_persistent_client, full_url);
-
-    // Set headers and payload for this request
-    esp_http_client_set_header(s_persistent_client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(s_persistent_client, json_payload, strlen(json_payload));
-
-    ESP_LOGD(TAG, "Sending HTTP POST to %s", full_url);
+    ESP_LOGD(TAG, "Sending HTTP POST to %s", s_url);
     ESP_LOGD(TAG, "Payload: %s", json_payload);
 
-    http_response_status_t result = HTTP_RESPONSE_ERROR;
-    int retry_count = 0;
+    http_pool_result_t res = { .err = ESP_FAIL };
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt <= s_config.max_retries; attempt++) {
+        if (attempt > 0) {
+            // The connection is back in the pool meanwhile, other requests to the server go ahead
+            ESP_LOGW(TAG, "Retrying HTTP POST in %d ms (attempt %d/%d)", HTTP_POOL_RETRY_DELAY_MS,
+                     attempt + 1, s_config.max_retries + 1);
+            vTaskDelay(pdMS_TO_TICKS(HTTP_POOL_RETRY_DELAY_MS));
+        }
 
-    while (retry_count <= s_config.max_retries) {
-        esp_err_t err = esp_http_client_perform(s_persistent_client);
-        
-        if (err == ESP_OK) {
-            s_last_status_code = esp_http_client_get_status_code(s_persistent_client);
-            ESP_LOGD(TAG, "HTTP POST Status = %d", s_last_status_code);
-            
-            if (s_last_status_code >= 200 && s_last_status_code < 300) {
-                result = HTTP_RESPONSE_OK;
-                break;
-            } else {
-                result = HTTP_RESPONSE_ERROR;
-            }
-        } else if (err == ESP_ERR_TIMEOUT) {
-            ESP_LOGW(TAG, "HTTP request timeout (retry %d/%d)", retry_count, s_config.max_retries);
-            result = HTTP_RESPONSE_TIMEOUT;
-        } else if (err == ESP_ERR_HTTP_EAGAIN) {
-            ESP_LOGW(TAG, "HTTP EAGAIN - server busy or connection issue (retry %d/%d)", retry_count, s_config.max_retries);
-            result = HTTP_RESPONSE_TIMEOUT;
-            // Recreate client connection on EAGAIN error
-            esp_http_client_close(s_persistent_client);
-        } else {
-            ESP_LOGE(TAG, "HTTP POST request failed: %s (retry %d/%d)", esp_err_to_name(err), retry_count, s_config.max_retries);
-            result = HTTP_RESPONSE_NO_CONNECTION;
-            // Close and recreate connection for other errors too
-            esp_http_client_close(s_persistent_client);
+        esp_http_client_handle_t client = http_pool_acquire(&s_endpoint, s_url, HTTP_METHOD_POST);
+        if (client == NULL) {
+            return HTTP_RESPONSE_NO_CONNECTION;
         }
+        esp_http_client_set_post_field(client, json_payload, strlen(json_payload));
+        err = http_pool_perform(client, &res);
+        esp_http_client_set_post_field(client, NULL, 0);
+        http_pool_release(client, res.err == ESP_OK);
 
-        retry_count++;
-        if (retry_count <= s_config.max_retries) {
-            ESP_LOGW(TAG, "Retrying HTTP request (%d/%d) in 2 seconds...", retry_count, s_config.max_retries);
-            vTaskDelay(pdMS_TO_TICKS(2000)); // Wait 2 seconds before retry (increased)
+        if (err == ESP_OK || !res.retry) {
+            break;
         }
     }
-    
-    return result;
+
+    if (res.err == ESP_OK) {
+        s_last_status_code = res.status_code;
+        ESP_LOGD(TAG, "HTTP POST Status = %d", s_last_status_code);
+        return (err == ESP_OK) ? HTTP_RESPONSE_OK : HTTP_RESPONSE_ERROR;
+    }
+    ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(res.err));
+    return (err == ESP_ERR_TIMEOUT) ? HTTP_RESPONSE_TIMEOUT : HTTP_RESPONSE_NO_CONNECTION;
 }
 
 http_response_status_t http_client_test_connection(void)
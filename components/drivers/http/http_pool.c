@@ -0,0 +1,290 @@
+/**
+ * @file http_pool.c
+ * @brief Shared HTTP Connection Pool Implementation
+ */
+
+#include "http_pool.h"
+#include "esp_log.h"
+#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "HTTPPool";
+
+typedef struct {
+    esp_http_client_handle_t client;        // NULL = free slot
+    char host[128];                         // Connection key: host, port, scheme
+    int port;
+    bool use_tls;
+    const http_pool_endpoint_t* endpoint;   // Endpoint whose headers are on the handle
+    char url[HTTP_POOL_URL_MAX_LEN];        // URL currently set on the handle ("" = unknown)
+    int users;                              // Tasks holding or waiting for the slot
+    SemaphoreHandle_t busy;                 // Held while a request runs
+    StaticSemaphore_t busy_buffer;
+} http_pool_slot_t;
+
+static http_pool_slot_t s_slots[HTTP_POOL_MAX_CONNECTIONS];
+
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void http_pool_lock(void)
+{
+    if (s_lock == NULL) {
+        portENTER_CRITICAL(&s_lock_mux);
+        if (s_lock == NULL) {
+            s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+            for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS; i++) {
+                s_slots[i].busy = xSemaphoreCreateBinaryStatic(&s_slots[i].busy_buffer);
+                xSemaphoreGive(s_slots[i].busy);
+            }
+        }
+        portEXIT_CRITICAL(&s_lock_mux);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void http_pool_unlock(void)
+{
+    xSemaphoreGive(s_lock);
+}
+
+static bool http_pool_slot_matches(const http_pool_slot_t* slot, const http_pool_endpoint_t* endpoint)
+{
+    return slot->client != NULL && slot->port == endpoint->port && slot->use_tls == endpoint->use_tls &&
+           strcmp(slot->host, endpoint->host) == 0;
+}
+
+static http_pool_slot_t* http_pool_find_client(esp_http_client_handle_t client)
+{
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS; i++) {
+        if (client != NULL && s_slots[i].client == client) {
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Caller holds the lock and the slot has no users
+static void http_pool_free_slot(http_pool_slot_t* slot)
+{
+    if (slot->client != NULL) {
+        esp_http_client_cleanup(slot->client);
+    }
+    slot->client = NULL;
+    slot->endpoint = NULL;
+    slot->host[0] = '\0';
+    slot->url[0] = '\0';
+}
+
+// Forwards events to the endpoint that currently uses the connection
+static esp_err_t http_pool_event_handler(esp_http_client_event_t *evt)
+{
+    http_pool_slot_t* slot = (http_pool_slot_t*)evt->user_data;
+    if (slot == NULL) {
+        return ESP_OK;
+    }
+    if (evt->event_id == HTTP_EVENT_REDIRECT) {
+        slot->url[0] = '\0';    // The handle now points elsewhere; set the URL again next time
+    }
+    if (slot->endpoint != NULL && slot->endpoint->event_handler != NULL) {
+        return slot->endpoint->event_handler(evt);
+    }
+    return ESP_OK;
+}
+
+// Caller holds the lock
+static esp_err_t http_pool_open_slot(http_pool_slot_t* slot, const http_pool_endpoint_t* endpoint, const char* url)
+{
+    esp_http_client_config_t client_config = {
+        .url = url,
+        .event_handler = http_pool_event_handler,
+        .user_data = slot,
+        .timeout_ms = endpoint->timeout_ms,
+        .keep_alive_enable = true,
+        .keep_alive_idle = 5,
+        .keep_alive_interval = 5,
+        .keep_alive_count = 3,
+        .max_redirection_count = 5,  // Handle redirects from HTTP to HTTPS
+    };
+    if (endpoint->use_tls) {
+        client_config.transport_type = HTTP_TRANSPORT_OVER_SSL;
+        client_config.crt_bundle_attach = esp_crt_bundle_attach;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        client_config.save_client_session = endpoint->save_tls_session;
+#endif
+    }
+
+    slot->client = esp_http_client_init(&client_config);
+    if (slot->client == NULL) {
+        return ESP_FAIL;
+    }
+    snprintf(slot->host, sizeof(slot->host), "%s", endpoint->host);
+    slot->port = endpoint->port;
+    slot->use_tls = endpoint->use_tls;
+    slot->endpoint = NULL;
+    snprintf(slot->url, sizeof(slot->url), "%s", url);
+    ESP_LOGI(TAG, "Pooled connection for %s://%s:%d", endpoint->use_tls ? "https" : "http",
+             endpoint->host, endpoint->port);
+    return ESP_OK;
+}
+
+// Slot is held: switch the static request state to this endpoint if another one used it last
+static void http_pool_apply_endpoint(http_pool_slot_t* slot, const http_pool_endpoint_t* endpoint)
+{
+    if (slot->endpoint == endpoint) {
+        return;
+    }
+    if (slot->endpoint != NULL) {
+        for (int i = 0; i < slot->endpoint->header_count; i++) {
+            esp_http_client_delete_header(slot->client, slot->endpoint->headers[i].key);
+        }
+    }
+    for (int i = 0; i < endpoint->header_count; i++) {
+        esp_http_client_set_header(slot->client, endpoint->headers[i].key, endpoint->headers[i].value);
+    }
+    esp_http_client_set_timeout_ms(slot->client, endpoint->timeout_ms);
+    slot->endpoint = endpoint;
+}
+
+esp_http_client_handle_t http_pool_acquire(const http_pool_endpoint_t* endpoint, const char* url,
+                                           esp_http_client_method_t method)
+{
+    if (endpoint == NULL || endpoint->host == NULL || url == NULL) {
+        return NULL;
+    }
+
+    http_pool_lock();
+    http_pool_slot_t* slot = NULL;
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS && slot == NULL; i++) {
+        if (http_pool_slot_matches(&s_slots[i], endpoint)) {
+            slot = &s_slots[i];
+        }
+    }
+    // New host: take a free slot, otherwise evict an idle connection
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS && slot == NULL; i++) {
+        if (s_slots[i].client == NULL) {
+            slot = &s_slots[i];
+        }
+    }
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS && slot == NULL; i++) {
+        if (s_slots[i].users == 0) {
+            ESP_LOGI(TAG, "Evicting idle connection to %s:%d", s_slots[i].host, s_slots[i].port);
+            http_pool_free_slot(&s_slots[i]);
+            slot = &s_slots[i];
+        }
+    }
+    if (slot == NULL) {
+        http_pool_unlock();
+        ESP_LOGE(TAG, "All %d pooled connections busy", HTTP_POOL_MAX_CONNECTIONS);
+        return NULL;
+    }
+    if (slot->client == NULL && http_pool_open_slot(slot, endpoint, url) != ESP_OK) {
+        http_pool_unlock();
+        ESP_LOGE(TAG, "Failed to create HTTP client for %s:%d", endpoint->host, endpoint->port);
+        return NULL;
+    }
+    slot->users++;
+    http_pool_unlock();
+
+    if (xSemaphoreTake(slot->busy, pdMS_TO_TICKS(endpoint->timeout_ms)) != pdTRUE) {
+        http_pool_lock();
+        slot->users--;
+        http_pool_unlock();
+        ESP_LOGW(TAG, "Connection to %s:%d stayed busy", endpoint->host, endpoint->port);
+        return NULL;
+    }
+
+    http_pool_apply_endpoint(slot, endpoint);
+    if (strcmp(slot->url, url) != 0) {
+        esp_http_client_set_url(slot->client, url);
+        snprintf(slot->url, sizeof(slot->url), "%s", url);
+    }
+    esp_http_client_set_method(slot->client, method);
+    return slot->client;
+}
+
+void http_pool_release(esp_http_client_handle_t client, bool keep_alive)
+{
+    http_pool_lock();
+    http_pool_slot_t* slot = http_pool_find_client(client);
+    if (slot == NULL) {
+        http_pool_unlock();
+        return;
+    }
+    if (!keep_alive) {
+        esp_http_client_close(client);
+    }
+    slot->users--;
+    http_pool_unlock();
+    xSemaphoreGive(slot->busy);
+}
+
+esp_err_t http_pool_perform(esp_http_client_handle_t client, http_pool_result_t* result)
+{
+    http_pool_result_t local = {0};
+    esp_err_t ret = ESP_FAIL;
+
+    local.err = esp_http_client_perform(client);
+    if (local.err == ESP_OK) {
+        local.status_code = esp_http_client_get_status_code(client);
+        if (local.status_code >= 200 && local.status_code < 300) {
+            ret = ESP_OK;
+        } else if (local.status_code >= 500 && local.status_code != 503) {
+            // Client errors do not change on retry; 503 is backpressure for the caller
+            local.retry = true;
+            ESP_LOGW(TAG, "Server error %d", local.status_code);
+        }
+    } else {
+        ret = (local.err == ESP_ERR_TIMEOUT || local.err == ESP_ERR_HTTP_EAGAIN) ? ESP_ERR_TIMEOUT : ESP_FAIL;
+        local.retry = true;
+        ESP_LOGW(TAG, "Request failed: %s, errno=%d", esp_err_to_name(local.err),
+                 esp_http_client_get_errno(client));
+        esp_http_client_close(client);  // Reconnect on the next attempt
+    }
+
+    if (result != NULL) {
+        *result = local;
+    }
+    return ret;
+}
+
+esp_err_t http_pool_close(const http_pool_endpoint_t* endpoint)
+{
+    if (endpoint == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    http_pool_lock();
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS; i++) {
+        if (http_pool_slot_matches(&s_slots[i], endpoint) && s_slots[i].users == 0) {
+            ret = esp_http_client_close(s_slots[i].client);
+        }
+    }
+    http_pool_unlock();
+    return ret;
+}
+
+esp_err_t http_pool_drop(const http_pool_endpoint_t* endpoint)
+{
+    if (endpoint == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    http_pool_lock();
+    for (int i = 0; i < HTTP_POOL_MAX_CONNECTIONS; i++) {
+        http_pool_slot_t* slot = &s_slots[i];
+        if (!http_pool_slot_matches(slot, endpoint)) {
+            continue;
+        }
+        if (slot->users > 0) {
+            ret = ESP_ERR_INVALID_STATE;
+            continue;
+        }
+        http_pool_free_slot(slot);
+    }
+    http_pool_unlock();
+    return ret;
+}
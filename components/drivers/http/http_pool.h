@@ -0,0 +1,119 @@
+/**
+ * @file http_pool.h
+ * @brief Shared HTTP Connection Pool
+ * 
+ * One transport layer for the InfluxDB and legacy HTTP clients. The pool
+ * keeps a small number of esp_http_client handles, one warm keep-alive
+ * connection per host, so every request to a host reuses the same socket and
+ * TLS context instead of each client holding its own.
+ * 
+ * An endpoint describes a host and the headers that never change between its
+ * requests. They are applied once when the endpoint takes a connection, and
+ * so is the URL, which is only set again when it differs from the previous
+ * request. Callers set per-request state (body, dynamic headers) themselves.
+ */
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HTTP_POOL_MAX_CONNECTIONS   2       ///< Pooled handles (hosts with a warm connection)
+#define HTTP_POOL_URL_MAX_LEN       256     ///< Longest URL remembered per connection
+
+#ifndef HTTP_POOL_RETRY_DELAY_MS
+#define HTTP_POOL_RETRY_DELAY_MS    2000    ///< Pause before a caller retries (with the connection released)
+#endif
+
+/**
+ * @brief Header that is the same on every request of an endpoint
+ */
+typedef struct {
+    const char* key;                ///< Header name
+    const char* value;              ///< Header value (must outlive the endpoint)
+} http_pool_header_t;
+
+/**
+ * @brief Host and static request state shared by the requests of one client
+ * 
+ * Must stay valid (usually static) while the endpoint has a pooled connection.
+ */
+typedef struct {
+    const char* host;               ///< Host name or IP address
+    int port;                       ///< TCP port
+    bool use_tls;                   ///< HTTPS with the certificate bundle
+    bool save_tls_session;          ///< Resume TLS with a session ticket after a reconnect
+    int timeout_ms;                 ///< Network timeout per request
+    const http_pool_header_t* headers;  ///< Static headers
+    int header_count;               ///< Number of static headers
+    http_event_handle_cb event_handler; ///< Receives the events of this endpoint's requests (may be NULL)
+} http_pool_endpoint_t;
+
+/**
+ * @brief Result of http_pool_perform()
+ */
+typedef struct {
+    esp_err_t err;                  ///< Transport result
+    int status_code;                ///< HTTP status (0 without a response)
+    bool retry;                     ///< Transport error or 5xx other than 503: worth another attempt
+} http_pool_result_t;
+
+/**
+ * @brief Take the endpoint's connection for one request
+ * 
+ * Reuses the host's pooled connection (waiting up to the endpoint timeout if
+ * another task is using it) or opens a handle in a free or idle slot.
+ * 
+ * @param endpoint Target host and static headers
+ * @param url Full request URL (set on the handle only if it changed)
+ * @param method Request method
+ * @return Handle to use until http_pool_release(), NULL if none became free
+ */
+esp_http_client_handle_t http_pool_acquire(const http_pool_endpoint_t* endpoint, const char* url,
+                                           esp_http_client_method_t method);
+
+/**
+ * @brief Return a connection to the pool
+ * 
+ * @param client Handle from http_pool_acquire()
+ * @param keep_alive false to close the socket (e.g. after an unexpected response)
+ */
+void http_pool_release(esp_http_client_handle_t client, bool keep_alive);
+
+/**
+ * @brief Perform the prepared request once
+ * 
+ * A failed connection is closed, so a retry never reuses a broken socket.
+ * Retries are up to the caller: release the connection, wait
+ * HTTP_POOL_RETRY_DELAY_MS and acquire it again, so other requests to the
+ * host are not held up meanwhile. result->retry is false for 4xx and 503
+ * responses: they ask the caller to back off (429/503, see Retry-After) or
+ * will not change on a retry.
+ * 
+ * @param client Handle from http_pool_acquire() with URL, method and body set
+ * @param result Receives transport result, status code and whether to retry (may be NULL)
+ * @return esp_err_t ESP_OK on a 2xx response, ESP_ERR_TIMEOUT if the request timed out,
+ *         ESP_FAIL otherwise
+ */
+esp_err_t http_pool_perform(esp_http_client_handle_t client, http_pool_result_t* result);
+
+/**
+ * @brief Close the endpoint's socket but keep its handle for the next request
+ * 
+ * @param endpoint Endpoint whose connection is closed
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if it has no pooled connection
+ */
+esp_err_t http_pool_close(const http_pool_endpoint_t* endpoint);
+
+/**
+ * @brief Free the endpoint's pooled connection
+ * 
+ * @param endpoint Endpoint whose connection is freed
+ * @return esp_err_t ESP_OK on success (also if it had none)
+ */
+esp_err_t http_pool_drop(const http_pool_endpoint_t* endpoint);
+
+#endif // HTTP_POOL_H
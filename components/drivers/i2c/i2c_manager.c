@@ -0,0 +1,301 @@
+/**
+ * @file i2c_manager.c
+ * @brief Shared I2C Bus Manager - Implementation
+ * 
+ * The bus is created by the first user and deleted with the last one
+ * (reference counting). One mutex guards the port table, the transfer queues
+ * and bus access, so a batch runs without transfers of another task in between.
+ */
+
+#include "i2c_manager.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char* TAG = "I2C_SHARED";
+
+static i2c_shared_port_t shared_ports[I2C_SHARED_MAX_PORTS] = {0};
+
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void i2c_shared_lock(void) {
+    if (s_lock == NULL) {
+        portENTER_CRITICAL(&s_lock_mux);
+        if (s_lock == NULL) {
+            s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+        }
+        portEXIT_CRITICAL(&s_lock_mux);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void i2c_shared_unlock(void) {
+    xSemaphoreGive(s_lock);
+}
+
+static i2c_shared_port_t* get_shared_port(i2c_port_t port) {
+    if (port < 0 || port >= I2C_SHARED_MAX_PORTS) {
+        return NULL;
+    }
+    return &shared_ports[port];
+}
+
+esp_err_t i2c_shared_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_speed_hz) {
+    i2c_shared_port_t* shared_port = get_shared_port(port);
+    if (shared_port == NULL) {
+        ESP_LOGE(TAG, "Invalid I2C port: %d", port);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_shared_lock();
+    if (shared_port->is_initialized) {
+        if (shared_port->sda_io != sda || shared_port->scl_io != scl) {
+            ESP_LOGE(TAG, "I2C%d already runs on SDA=%d SCL=%d", port, shared_port->sda_io, shared_port->scl_io);
+            i2c_shared_unlock();
+            return ESP_ERR_INVALID_STATE;
+        }
+        shared_port->ref_count++;
+        ESP_LOGD(TAG, "Shared I2C%d ref count increased to %d", port, shared_port->ref_count);
+        i2c_shared_unlock();
+        return ESP_OK;
+    }
+
+    i2c_master_bus_config_t bus_conf = {
+        .i2c_port = port,
+        .sda_io_num = sda,
+        .scl_io_num = scl,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t ret = i2c_new_master_bus(&bus_conf, &shared_port->bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C%d bus: %s", port, esp_err_to_name(ret));
+        i2c_shared_unlock();
+        return ret;
+    }
+
+    shared_port->sda_io = sda;
+    shared_port->scl_io = scl;
+    shared_port->clk_speed_hz = clk_speed_hz;
+    shared_port->ref_count = 1;
+    shared_port->device_count = 0;
+    shared_port->queue_len = 0;
+    shared_port->is_initialized = true;
+    i2c_shared_unlock();
+
+    ESP_LOGI(TAG, "Shared I2C%d initialized (SDA=%d SCL=%d, %lu Hz)", port, sda, scl, (unsigned long)clk_speed_hz);
+    return ESP_OK;
+}
+
+esp_err_t i2c_shared_deinit(i2c_port_t port) {
+    i2c_shared_port_t* shared_port = get_shared_port(port);
+    if (shared_port == NULL) {
+        ESP_LOGE(TAG, "Invalid I2C port: %d", port);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_shared_lock();
+    if (!shared_port->is_initialized) {
+        i2c_shared_unlock();
+        ESP_LOGW(TAG, "Shared I2C%d not initialized", port);
+        return ESP_OK;
+    }
+
+    if (shared_port->ref_count == 1 && shared_port->device_count > 0) {
+        ESP_LOGE(TAG, "I2C%d still has %d device(s) attached", port, shared_port->device_count);
+        i2c_shared_unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    shared_port->ref_count--;
+    ESP_LOGD(TAG, "Shared I2C%d ref count decreased to %d", port, shared_port->ref_count);
+    if (shared_port->ref_count > 0) {
+        i2c_shared_unlock();
+        return ESP_OK;  // Still in use by other drivers
+    }
+
+    esp_err_t ret = i2c_del_master_bus(shared_port->bus);
+    shared_port->bus = NULL;
+    shared_port->is_initialized = false;
+    i2c_shared_unlock();
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete I2C%d bus: %s", port, esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Shared I2C%d deinitialized", port);
+    return ESP_OK;
+}
+
+esp_err_t i2c_shared_add_device(i2c_port_t port, uint16_t address, uint32_t scl_speed_hz,
+                                i2c_shared_device_t* dev) {
+    i2c_shared_port_t* shared_port = get_shared_port(port);
+    if (shared_port == NULL || dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_shared_lock();
+    if (!shared_port->is_initialized) {
+        i2c_shared_unlock();
+        ESP_LOGE(TAG, "Shared I2C%d not initialized", port);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    i2c_device_config_t dev_conf = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = scl_speed_hz ? scl_speed_hz : shared_port->clk_speed_hz,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(shared_port->bus, &dev_conf, &dev->handle);
+    if (ret == ESP_OK) {
+        dev->port = port;
+        dev->address = address;
+        dev->scl_speed_hz = dev_conf.scl_speed_hz;
+        shared_port->device_count++;
+    } else {
+        dev->handle = NULL;
+    }
+    i2c_shared_unlock();
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add device 0x%02X on I2C%d: %s", address, port, esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGD(TAG, "Device 0x%02X added on I2C%d (%lu Hz)", address, port, (unsigned long)dev->scl_speed_hz);
+    return ESP_OK;
+}
+
+esp_err_t i2c_shared_remove_device(i2c_shared_device_t* dev) {
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dev->handle == NULL) {
+        return ESP_OK;
+    }
+    i2c_shared_port_t* shared_port = get_shared_port(dev->port);
+    if (shared_port == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_shared_lock();
+    // Drop queued transfers of this device, keep the order of the rest
+    int kept = 0;
+    for (int i = 0; i < shared_port->queue_len; i++) {
+        i2c_shared_transfer_t* t = shared_port->queue[i];
+        if (t->dev == dev) {
+            t->result = ESP_ERR_INVALID_STATE;
+        } else {
+            shared_port->queue[kept++] = t;
+        }
+    }
+    shared_port->queue_len = kept;
+
+    esp_err_t ret = i2c_master_bus_rm_device(dev->handle);
+    dev->handle = NULL;
+    if (shared_port->device_count > 0) {
+        shared_port->device_count--;
+    }
+    i2c_shared_unlock();
+    return ret;
+}
+
+// Caller holds the lock
+static esp_err_t i2c_shared_run_locked(i2c_shared_transfer_t* t) {
+    if (t->dev == NULL || t->dev->handle == NULL) {
+        t->result = ESP_ERR_INVALID_STATE;
+    } else if (t->write_len > 0 && t->read_len > 0) {
+        t->result = i2c_master_transmit_receive(t->dev->handle, t->write_buf, t->write_len,
+                                                t->read_buf, t->read_len, I2C_SHARED_TIMEOUT_MS);
+    } else if (t->write_len > 0) {
+        t->result = i2c_master_transmit(t->dev->handle, t->write_buf, t->write_len, I2C_SHARED_TIMEOUT_MS);
+    } else if (t->read_len > 0) {
+        t->result = i2c_master_receive(t->dev->handle, t->read_buf, t->read_len, I2C_SHARED_TIMEOUT_MS);
+    } else {
+        t->result = ESP_ERR_INVALID_ARG;
+    }
+    return t->result;
+}
+
+esp_err_t i2c_shared_transfer(i2c_shared_device_t* dev, const uint8_t* write_buf, size_t write_len,
+                              uint8_t* read_buf, size_t read_len) {
+    i2c_shared_transfer_t t = {
+        .dev = dev,
+        .write_buf = write_buf,
+        .write_len = write_len,
+        .read_buf = read_buf,
+        .read_len = read_len,
+    };
+    return i2c_shared_transfer_batch(&t, 1);
+}
+
+esp_err_t i2c_shared_transfer_batch(i2c_shared_transfer_t* transfers, int count) {
+    if (transfers == NULL || count <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t first_err = ESP_OK;
+    i2c_shared_lock();
+    for (int i = 0; i < count; i++) {
+        esp_err_t ret = i2c_shared_run_locked(&transfers[i]);
+        if (ret != ESP_OK && first_err == ESP_OK) {
+            first_err = ret;
+        }
+    }
+    i2c_shared_unlock();
+    return first_err;
+}
+
+esp_err_t i2c_shared_queue(i2c_shared_transfer_t* transfer) {
+    if (transfer == NULL || transfer->dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_shared_port_t* shared_port = get_shared_port(transfer->dev->port);
+    if (shared_port == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    i2c_shared_lock();
+    if (!shared_port->is_initialized) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (shared_port->queue_len >= I2C_SHARED_QUEUE_DEPTH) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        transfer->result = ESP_ERR_NOT_FINISHED;
+        shared_port->queue[shared_port->queue_len++] = transfer;
+    }
+    i2c_shared_unlock();
+
+    if (ret == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "I2C%d transfer queue full", transfer->dev->port);
+    }
+    return ret;
+}
+
+esp_err_t i2c_shared_flush(i2c_port_t port) {
+    i2c_shared_port_t* shared_port = get_shared_port(port);
+    if (shared_port == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t first_err = ESP_OK;
+    i2c_shared_lock();
+    for (int i = 0; i < shared_port->queue_len; i++) {
+        esp_err_t ret = i2c_shared_run_locked(shared_port->queue[i]);
+        if (ret != ESP_OK && first_err == ESP_OK) {
+            first_err = ret;
+        }
+    }
+    shared_port->queue_len = 0;
+    i2c_shared_unlock();
+    return first_err;
+}
+
+bool i2c_shared_is_initialized(i2c_port_t port) {
+    i2c_shared_port_t* shared_port = get_shared_port(port);
+    return shared_port != NULL && shared_port->is_initialized;
+}
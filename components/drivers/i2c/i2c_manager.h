@@ -0,0 +1,178 @@
+/**
+ * @file i2c_manager.h
+ * @brief Shared I2C Bus Manager - Hardware Abstraction Layer
+ * 
+ * Lets several sensor drivers share one I2C port. The bus is created by the
+ * first user and deleted when the last one releases it (reference counting);
+ * each driver attaches its device with its own address and clock rate.
+ * 
+ * Transfers of several devices can be queued and run back to back with
+ * i2c_shared_flush(), so a pass over all I2C sensors takes the bus once
+ * instead of once per sensor.
+ */
+
+#ifndef I2C_SHARED_H
+#define I2C_SHARED_H
+
+#include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "soc/soc_caps.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum number of ports managed (the ESP32-C6 has one HP I2C port)
+#ifdef SOC_HP_I2C_NUM
+#define I2C_SHARED_MAX_PORTS        SOC_HP_I2C_NUM
+#else
+#define I2C_SHARED_MAX_PORTS        SOC_I2C_NUM
+#endif
+
+// Transfers waiting for i2c_shared_flush() per port
+#define I2C_SHARED_QUEUE_DEPTH      8
+
+#ifndef I2C_SHARED_TIMEOUT_MS
+#define I2C_SHARED_TIMEOUT_MS       100     ///< Per-transfer timeout
+#endif
+
+/**
+ * @brief Device attached to a shared bus
+ */
+typedef struct {
+    i2c_port_t port;                    ///< Bus the device is on
+    uint16_t address;                   ///< 7-bit device address
+    uint32_t scl_speed_hz;              ///< Clock rate used for this device
+    i2c_master_dev_handle_t handle;     ///< ESP-IDF device handle (NULL = not attached)
+} i2c_shared_device_t;
+
+/**
+ * @brief One transfer: write, read, or write followed by a repeated-start read
+ */
+typedef struct {
+    i2c_shared_device_t* dev;           ///< Target device
+    const uint8_t* write_buf;           ///< Bytes to write (NULL = read only)
+    size_t write_len;                   ///< Number of bytes to write
+    uint8_t* read_buf;                  ///< Receives read bytes (NULL = write only)
+    size_t read_len;                    ///< Number of bytes to read
+    esp_err_t result;                   ///< Outcome, set when the transfer has run
+} i2c_shared_transfer_t;
+
+/**
+ * @brief Shared I2C port structure
+ */
+typedef struct {
+    i2c_master_bus_handle_t bus;        ///< ESP-IDF bus handle
+    gpio_num_t sda_io;                  ///< SDA pin
+    gpio_num_t scl_io;                  ///< SCL pin
+    uint32_t clk_speed_hz;              ///< Default device clock rate
+    int ref_count;                      ///< Reference counter
+    int device_count;                   ///< Attached devices
+    i2c_shared_transfer_t* queue[I2C_SHARED_QUEUE_DEPTH]; ///< Transfers waiting for a flush
+    int queue_len;                      ///< Number of queued transfers
+    bool is_initialized;                ///< Initialization status
+} i2c_shared_port_t;
+
+/**
+ * @brief Initialize shared I2C port
+ * 
+ * Creates the bus on the first call and only takes a reference on later
+ * ones. Later callers must use the same pins.
+ * 
+ * @param port I2C port
+ * @param sda SDA pin
+ * @param scl SCL pin
+ * @param clk_speed_hz Clock rate for devices added without their own (first caller sets it)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the port runs on other pins
+ */
+esp_err_t i2c_shared_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_speed_hz);
+
+/**
+ * @brief Release a reference; the bus is deleted with the last one
+ * 
+ * @param port I2C port
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if devices are still attached
+ */
+esp_err_t i2c_shared_deinit(i2c_port_t port);
+
+/**
+ * @brief Attach a device to an initialized port
+ * 
+ * @param port I2C port
+ * @param address 7-bit device address
+ * @param scl_speed_hz Clock rate for this device (0 = port default)
+ * @param dev Receives the device handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t i2c_shared_add_device(i2c_port_t port, uint16_t address, uint32_t scl_speed_hz,
+                                i2c_shared_device_t* dev);
+
+/**
+ * @brief Detach a device (drops any of its queued transfers with ESP_ERR_INVALID_STATE)
+ * 
+ * @param dev Device added with i2c_shared_add_device()
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t i2c_shared_remove_device(i2c_shared_device_t* dev);
+
+/**
+ * @brief Run one transfer now
+ * 
+ * @param dev Target device
+ * @param write_buf Bytes to write (NULL = read only)
+ * @param write_len Number of bytes to write
+ * @param read_buf Receives read bytes (NULL = write only)
+ * @param read_len Number of bytes to read
+ * @return esp_err_t ESP_OK on success, error code of the transfer otherwise
+ */
+esp_err_t i2c_shared_transfer(i2c_shared_device_t* dev, const uint8_t* write_buf, size_t write_len,
+                              uint8_t* read_buf, size_t read_len);
+
+/**
+ * @brief Run several transfers back to back while holding the bus
+ * 
+ * Transfers may target different devices and run in array order. A failed
+ * transfer does not stop the ones after it; check each result.
+ * 
+ * @param transfers Transfers to run
+ * @param count Number of transfers
+ * @return esp_err_t ESP_OK if every transfer succeeded, otherwise the first error
+ */
+esp_err_t i2c_shared_transfer_batch(i2c_shared_transfer_t* transfers, int count);
+
+/**
+ * @brief Queue a transfer for the next i2c_shared_flush() of its port
+ * 
+ * The transfer is referenced, not copied; it must stay valid until the flush.
+ * Its result is ESP_ERR_NOT_FINISHED until then.
+ * 
+ * @param transfer Transfer to queue
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t i2c_shared_queue(i2c_shared_transfer_t* transfer);
+
+/**
+ * @brief Run every queued transfer of a port in queue order
+ * 
+ * @param port I2C port
+ * @return esp_err_t ESP_OK if every transfer succeeded (or none was queued), otherwise the first error
+ */
+esp_err_t i2c_shared_flush(i2c_port_t port);
+
+/**
+ * @brief Check if shared I2C port is initialized
+ * 
+ * @param port I2C port to check
+ * @return true if initialized, false otherwise
+ */
+bool i2c_shared_is_initialized(i2c_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // I2C_SHARED_H
@@ -0,0 +1,284 @@
+/**
+ * @file influxdb_backlog.c
+ * @brief Offline Store-and-Forward for InfluxDB Line Protocol - Implementation
+ */
+
+#include "influxdb_backlog.h"
+#include "flash_log.h"
+#include "sample_frame.h"
+#include "sample_block.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "INFLUX_BACKLOG";
+
+static flash_log_t s_log;
+
+esp_err_t influxdb_backlog_init(const char* partition_label)
+{
+    if (partition_label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_log.is_initialized) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = flash_log_init(&s_log, partition_label);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open backlog partition '%s': %s", partition_label, esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Backlog initialized (%lu records stored)", (unsigned long)flash_log_count(&s_log));
+    return ESP_OK;
+}
+
+esp_err_t influxdb_backlog_store(const char* body, size_t len)
+{
+    if (!influxdb_backlog_is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (body == NULL || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const size_t max_record = flash_log_max_record_size();
+    uint32_t dropped_before = s_log.dropped_count;
+    size_t start = 0;
+    int records = 0;
+
+    // Cut the body into the largest records that end on a line boundary
+    while (start < len) {
+        size_t end = start;
+        size_t pos = start;
+        while (pos < len && pos - start < max_record) {
+            if (body[pos] == '\n') {
+                end = pos + 1;
+            }
+            pos++;
+        }
+        if (end == start) {
+            ESP_LOGE(TAG, "Line too long to store (> %u bytes)", (unsigned)max_record);
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        esp_err_t ret = flash_log_append(&s_log, body + start, end - start);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to store backlog record: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        records++;
+        start = end;
+    }
+
+    if (s_log.dropped_count != dropped_before) {
+        ESP_LOGW(TAG, "Backlog full, %lu oldest records overwritten",
+                 (unsigned long)(s_log.dropped_count - dropped_before));
+    }
+    ESP_LOGI(TAG, "Stored %u bytes in %d records (%lu pending)",
+             (unsigned)len, records, (unsigned long)flash_log_count(&s_log));
+    return ESP_OK;
+}
+
+esp_err_t influxdb_backlog_store_frame(const uint8_t* frame, size_t len)
+{
+    if (!influxdb_backlog_is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!sample_frame_is_frame(frame, len) && !sample_block_is_block(frame, len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t dropped_before = s_log.dropped_count;
+    esp_err_t ret = flash_log_append(&s_log, frame, len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store backlog frame: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_log.dropped_count != dropped_before) {
+        ESP_LOGW(TAG, "Backlog full, %lu oldest records overwritten",
+                 (unsigned long)(s_log.dropped_count - dropped_before));
+    }
+    ESP_LOGI(TAG, "Stored %u byte frame (%lu pending)", (unsigned)len, (unsigned long)flash_log_count(&s_log));
+    return ESP_OK;
+}
+
+/**
+ * @brief Write packed records route by route (gateway with several buckets)
+ *
+ * The records are read again once per route and only the samples whose device
+ * selects the route are encoded; text lines go to the default route. A failed
+ * route keeps every record, so the routes written before it get the points
+ * again on the next replay (InfluxDB overwrites identical points).
+ */
+static influxdb_response_status_t influxdb_backlog_write_routes(const flash_log_cursor_t* start, uint32_t packed,
+                                                                influxdb_batch_t* scratch, char* record,
+                                                                size_t record_cap, int* posts, int* points)
+{
+    int routes = influxdb_client_route_count();
+    for (int route = 0; route < routes; route++) {
+        flash_log_cursor_t cursor = *start;
+        influxdb_batch_reset(scratch);
+        for (uint32_t i = 0; i < packed; i++) {
+            size_t record_len = 0;
+            esp_err_t ret = flash_log_read(&s_log, &cursor, record, record_cap, &record_len);
+            if (ret == ESP_ERR_NOT_FOUND) {
+                break;
+            }
+            if (ret != ESP_OK) {
+                continue;   // Skipped by the packing pass as well
+            }
+            // The subset of one route fits, as all routes together did; errors were logged there
+            if (sample_frame_is_frame((const uint8_t*)record, record_len) ||
+                sample_block_is_block((const uint8_t*)record, record_len)) {
+                influxdb_batch_add_frame_route(scratch, (const uint8_t*)record, record_len, 0, route);
+            } else if (route == 0) {
+                influxdb_batch_append_raw(scratch, record, record_len);
+            }
+        }
+        if (scratch->point_count == 0) {
+            continue;
+        }
+
+        influxdb_response_status_t status = influxdb_write_batch_to(route, scratch);
+        if (status != INFLUXDB_RESPONSE_OK) {
+            return status;
+        }
+        (*posts)++;
+        *points += scratch->point_count;
+    }
+    influxdb_batch_reset(scratch);
+    return INFLUXDB_RESPONSE_OK;
+}
+
+esp_err_t influxdb_backlog_replay(influxdb_batch_t* scratch, int max_posts, int* points_sent)
+{
+    if (points_sent) {
+        *points_sent = 0;
+    }
+    if (!influxdb_backlog_is_enabled() || flash_log_count(&s_log) == 0) {
+        return ESP_OK;
+    }
+    if (scratch == NULL || scratch->buffer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const size_t record_cap = flash_log_max_record_size();
+    char* record = malloc(record_cap);
+    if (record == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Replaying %lu backlog records...", (unsigned long)flash_log_count(&s_log));
+
+    esp_err_t result = ESP_OK;
+    int posts = 0;
+    int total_points = 0;
+
+    while (posts < max_posts && flash_log_count(&s_log) > 0) {
+        flash_log_cursor_t cursor;
+        flash_log_cursor_init(&s_log, &cursor);
+        const flash_log_cursor_t start = cursor;
+        influxdb_batch_reset(scratch);
+
+        // Pack as many whole records as fit into one request body
+        uint32_t packed = 0;
+        while (1) {
+            flash_log_cursor_t before = cursor;
+            size_t record_len = 0;
+            esp_err_t ret = flash_log_read(&s_log, &cursor, record, record_cap, &record_len);
+            if (ret == ESP_ERR_NOT_FOUND) {
+                break;
+            }
+            if (ret == ESP_ERR_INVALID_CRC) {
+                // Unreadable records are consumed together with this POST
+                ESP_LOGW(TAG, "Skipping unreadable backlog record: %s", esp_err_to_name(ret));
+                packed++;
+                continue;
+            }
+            if (ret != ESP_OK) {
+                result = ret;
+                break;
+            }
+            if (sample_frame_is_frame((const uint8_t*)record, record_len) ||
+                sample_block_is_block((const uint8_t*)record, record_len)) {
+                ret = influxdb_batch_add_frame(scratch, (const uint8_t*)record, record_len, 0);
+                if (ret == ESP_ERR_NO_MEM && scratch->point_count == 0) {
+                    // Would not fit even an empty body: never replayable
+                    ESP_LOGE(TAG, "Discarding backlog frame too large for one POST (%u bytes)",
+                             (unsigned)record_len);
+                    packed++;
+                    continue;
+                }
+                if (ret == ESP_ERR_INVALID_SIZE || ret == ESP_ERR_INVALID_VERSION) {
+                    ESP_LOGW(TAG, "Skipping unreadable backlog frame: %s", esp_err_to_name(ret));
+                    packed++;
+                    continue;
+                }
+            } else {
+                ret = influxdb_batch_append_raw(scratch, record, record_len);
+            }
+            if (ret != ESP_OK) {
+                cursor = before;    // Goes into the next POST
+                break;
+            }
+            packed++;
+        }
+
+        if (packed == 0) {
+            break;
+        }
+
+        if (scratch->point_count > 0) {
+            influxdb_response_status_t status;
+            if (influxdb_client_route_count() > 1) {
+                // Points a gateway stored go back to the bucket of their device
+                status = influxdb_backlog_write_routes(&start, packed, scratch, record, record_cap,
+                                                       &posts, &total_points);
+            } else {
+                status = influxdb_write_batch(scratch);
+                if (status == INFLUXDB_RESPONSE_OK) {
+                    posts++;
+                    total_points += scratch->point_count;
+                }
+            }
+            if (status != INFLUXDB_RESPONSE_OK) {
+                ESP_LOGW(TAG, "Backlog replay POST failed (%d), keeping %lu records",
+                         status, (unsigned long)flash_log_count(&s_log));
+                result = ESP_FAIL;
+                break;
+            }
+        }
+
+        flash_log_pop(&s_log, packed);
+
+        if (result != ESP_OK) {
+            break;
+        }
+    }
+
+    free(record);
+    influxdb_batch_reset(scratch);
+
+    ESP_LOGI(TAG, "Replay done: %d points in %d POSTs, %lu records remaining",
+             total_points, posts, (unsigned long)flash_log_count(&s_log));
+    if (points_sent) {
+        *points_sent = total_points;
+    }
+    return result;
+}
+
+uint32_t influxdb_backlog_count(void)
+{
+    if (!influxdb_backlog_is_enabled()) {
+        return 0;
+    }
+    return flash_log_count(&s_log);
+}
+
+bool influxdb_backlog_is_enabled(void)
+{
+    return s_log.is_initialized;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file influxdb_backlog.h
+ * @brief Offline Store-and-Forward for InfluxDB Line Protocol
+ *
+ * Batches that could not be written (no Wi-Fi, server down) are stored in a
+ * flash ring log, each point keeping its original timestamp. Records are
+ * either encoded line protocol, binary sample frames (sample_frame.h), which
+ * hold roughly ten times more samples per flash sector, or delta-of-delta
+ * sample blocks (sample_block.h), which hold another 2-3 times as many for
+ * slowly changing sensors. Once a write succeeds again the backlog is replayed
+ * oldest first by packing many stored records into one batch body per POST
+ * (frames and blocks are converted to line protocol on the way), so a long
+ * outage is drained with a handful of requests.
+ */
+
+#ifndef INFLUXDB_BACKLOG_H
+#define INFLUXDB_BACKLOG_H
+
+#include "esp_err.h"
+#include "influxdb_client.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Open the backlog on a flash partition
+ *
+ * @param partition_label Label of the backlog data partition
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t influxdb_backlog_init(const char* partition_label);
+
+/**
+ * @brief Store newline-terminated line protocol for later replay
+ *
+ * The body is split at line boundaries into records that fit a flash sector.
+ * When the log is full the oldest records are overwritten.
+ *
+ * @param body Line protocol text, every line ending with '\n'
+ * @param len Length of the text in bytes
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t influxdb_backlog_store(const char* body, size_t len);
+
+/**
+ * @brief Store a binary sample frame or block for later replay
+ *
+ * The frame must convert to less than one batch body (INFLUXDB_BACKLOG_FRAME_SIZE
+ * bounds a frame, INFLUXDB_BACKLOG_BLOCK_RECORDS a block); a frame that can never
+ * fit a POST is discarded during replay.
+ *
+ * @param frame Frame written by sample_frame_finish() or sample_block_finish()
+ * @param len Frame length in bytes
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t influxdb_backlog_store_frame(const uint8_t* frame, size_t len);
+
+/**
+ * @brief Replay stored lines with large batched POSTs
+ *
+ * Records are consumed only after the POST carrying them was accepted.
+ * Replay stops at the first failed write. With routes (a gateway) every
+ * stored sample goes to the bucket its device id selects, text lines to the
+ * default bucket, so one batch of records takes a POST per route.
+ *
+ * @param scratch Empty batch used as the request body (reset on return)
+ * @param max_posts Maximum number of POSTs to issue
+ * @param points_sent Receives the number of replayed lines (may be NULL)
+ * @return esp_err_t ESP_OK if all attempted POSTs succeeded, ESP_FAIL otherwise
+ */
+esp_err_t influxdb_backlog_replay(influxdb_batch_t* scratch, int max_posts, int* points_sent);
+
+/**
+ * @brief Number of stored records (each holds one or more lines)
+ */
+uint32_t influxdb_backlog_count(void);
+
+/**
+ * @brief Check whether the backlog is open
+ */
+bool influxdb_backlog_is_enabled(void);
+
+#endif // INFLUXDB_BACKLOG_H
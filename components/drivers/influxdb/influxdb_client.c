@@ -1,9 +1,15 @@
 
 #include "influxdb_client.h"
+#include "http_pool.h"
+#include "line_protocol.h"
+#include "sample_frame.h"
+#include "sample_block.h"
+#include "report_policy.h"
+#include "gzip_deflate.h"
+#include "perf_profiler.h"
+#include "event_counters.h"
+#include "time_service.h"
 #include "config/esp32-config.h"
-#if INFLUXDB_USE_HTTPS
-#include <esp_crt_bundle.h>
-#endif
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -11,6 +17,14 @@
 #include <errno.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+// Upper bound for a single formatted point (including trailing newline);
+// sized for a device_resources point with every task and checkpoint present
+#define INFLUXDB_LINE_MAX_LEN   768
 
 static const char *TAG = "InfluxDBClient";
 
@@ -18,12 +32,71 @@ static const char *TAG = "InfluxDBClient";
 static influxdb_client_config_t s_config;
 static int s_last_status_code = 0;
 static bool s_initialized = false;
-static esp_http_client_handle_t s_client = NULL;
 static bool s_last_write_success = false; // true when last write received 2xx
+static size_t s_gzip_len = 0;             // Length of the last compressed body
+static size_t s_last_body_len = 0;        // Bytes of the last request body on the wire
+static int64_t s_perform_start_us = 0;    // Start of the running request (TLS phase timing)
+static uint32_t s_retry_after_ms = 0;     // Retry-After of the last response
+static int32_t s_upload_slot_ms = -1;     // Last X-Upload-Slot the backend sent (-1: none yet)
+
+/**
+ * @brief Write destination: bucket/org/token behind one URL and endpoint
+ *
+ * All routes live on the configured server, so the pool keeps one warm
+ * connection for them and only swaps the static headers between routes.
+ */
+typedef struct {
+    char key[32];                       // Routing key prefix ("" for the default route)
+    char write_url[256];                // Write URL incl. org/bucket query, built once
+    char auth_header[272];              // "Token " + token, built once
+    http_pool_header_t headers[3];      // Static headers, applied once per pooled connection
+    http_pool_endpoint_t endpoint;      // InfluxDB host on the shared connection pool
+} influxdb_route_t;
+
+static influxdb_route_t s_routes[INFLUXDB_MAX_ROUTES];  // [0] = bucket of the client config
+static int s_route_count = 0;
 
 // Forward declarations
 static esp_err_t influxdb_event_handler(esp_http_client_event_t *evt);
-static esp_err_t influxdb_send_line_protocol(const char* line_protocol);
+static esp_err_t influxdb_send_line_protocol(const influxdb_route_t* route, const char* body, size_t body_len);
+
+static esp_err_t influxdb_route_setup(influxdb_route_t* route, const char* key, const char* bucket,
+                                      const char* org, const char* token)
+{
+    memset(route, 0, sizeof(*route));
+    snprintf(route->key, sizeof(route->key), "%s", key);
+
+    // Points carry nanosecond timestamps whenever the clock is set (NTP, HTTP Date or kept across deep sleep)
+    const char* precision = "&precision=ns";
+    int url_len = snprintf(route->write_url, sizeof(route->write_url), "%s://%s:%d%s?org=%s&bucket=%s%s",
+                           INFLUXDB_USE_HTTPS ? "https" : "http",
+                           s_config.server, s_config.port, s_config.endpoint,
+                           org, bucket, precision);
+    if (url_len < 0 || url_len >= (int)sizeof(route->write_url)) {
+        ESP_LOGE(TAG, "InfluxDB write URL too long");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Requests run on the shared connection pool; headers persist on the pooled handle
+    int header_count = 0;
+    route->headers[header_count++] = (http_pool_header_t){ "Content-Type", "text/plain; charset=utf-8" };
+    route->headers[header_count++] = (http_pool_header_t){ "Accept", "application/json" };
+    if (strlen(token) > 0) {
+        snprintf(route->auth_header, sizeof(route->auth_header), "Token %s", token);
+        route->headers[header_count++] = (http_pool_header_t){ "Authorization", route->auth_header };
+    }
+    route->endpoint = (http_pool_endpoint_t){
+        .host = s_config.server,
+        .port = s_config.port,
+        .use_tls = INFLUXDB_USE_HTTPS,
+        .save_tls_session = INFLUXDB_TLS_SESSION_REUSE,
+        .timeout_ms = s_config.timeout_ms,
+        .headers = route->headers,
+        .header_count = header_count,
+        .event_handler = influxdb_event_handler,
+    };
+    return ESP_OK;
+}
 
 esp_err_t influxdb_client_init(const influxdb_client_config_t* config)
 {
@@ -33,45 +106,19 @@ esp_err_t influxdb_client_init(const influxdb_client_config_t* config)
 
     memcpy(&s_config, config, sizeof(influxdb_client_config_t));
     
-    // Create HTTP client for InfluxDB
-    char url[256];
-#if INFLUXDB_USE_HTTPS
-    snprintf(url, sizeof(url), "https://%s:%d%s", 
-             s_config.server, s_config.port, s_config.endpoint);
-#else
-    snprintf(url, sizeof(url), "http://%s:%d%s", 
-             s_config.server, s_config.port, s_config.endpoint);
-#endif
-
-    esp_http_client_config_t client_config = {
-        .url = url,
-        .event_handler = influxdb_event_handler,
-        .timeout_ms = s_config.timeout_ms,
-        .method = HTTP_METHOD_POST,
-        .keep_alive_enable = true,
-        .keep_alive_idle = 5,
-        .keep_alive_interval = 5,
-        .keep_alive_count = 3,
-        .max_redirection_count = 5,  // Handle redirects from HTTP to HTTPS
-#if INFLUXDB_USE_HTTPS
-    .transport_type = HTTP_TRANSPORT_OVER_SSL,
-    .crt_bundle_attach = esp_crt_bundle_attach, // Use built-in certificate bundle
-#endif
-    };
-
-    s_client = esp_http_client_init(&client_config);
-    if (s_client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize InfluxDB HTTP client");
-        return ESP_FAIL;
+    // Build the write URL with query parameters once
+    esp_err_t ret = influxdb_route_setup(&s_routes[0], "", s_config.bucket, s_config.org, s_config.token);
+    if (ret != ESP_OK) {
+        return ret;
     }
-
+    s_route_count = 1;
     s_initialized = true;
     
     ESP_LOGI(TAG, "InfluxDB client initialized for server %s:%d", 
              s_config.server, s_config.port);
     ESP_LOGI(TAG, "Protocol: %s", INFLUXDB_USE_HTTPS ? "HTTPS" : "HTTP");
     ESP_LOGI(TAG, "Bucket: %s, Organization: %s", s_config.bucket, s_config.org);
-    ESP_LOGI(TAG, "Full URL: %s", url);
+    ESP_LOGI(TAG, "Write URL: %s", s_routes[0].write_url);
     if (strlen(s_config.token) == 0) {
         ESP_LOGW(TAG, "InfluxDB token is EMPTY - writes will fail (401). Check credentials.h");
     } else {
@@ -81,52 +128,234 @@ esp_err_t influxdb_client_init(const influxdb_client_config_t* config)
     return ESP_OK;
 }
 
+esp_err_t influxdb_client_add_route(const influxdb_route_config_t* route, int* route_id)
+{
+    if (route == NULL || route->key[0] == '\0' || route->bucket[0] == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_route_count >= INFLUXDB_MAX_ROUTES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Org and token default to the ones of the client config
+    const char* org = route->org[0] ? route->org : s_config.org;
+    const char* token = route->token[0] ? route->token : s_config.token;
+    esp_err_t ret = influxdb_route_setup(&s_routes[s_route_count], route->key, route->bucket, org, token);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (route_id != NULL) {
+        *route_id = s_route_count;
+    }
+    s_route_count++;
+    ESP_LOGI(TAG, "Route \"%s\" -> bucket %s (org %s)", route->key, route->bucket, org);
+    return ESP_OK;
+}
+
+int influxdb_client_find_route(const char* key)
+{
+    if (key == NULL) {
+        return 0;
+    }
+    int best = 0;
+    size_t best_len = 0;
+    for (int i = 1; i < s_route_count; i++) {
+        size_t len = strlen(s_routes[i].key);
+        if (len > best_len && strncmp(key, s_routes[i].key, len) == 0) {
+            best = i;
+            best_len = len;
+        }
+    }
+    return best;
+}
+
+int influxdb_client_route_count(void)
+{
+    return s_route_count;
+}
+
+esp_err_t influxdb_client_close_connection(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Routes share the host connection: closing it once is enough
+    for (int i = 0; i < s_route_count; i++) {
+        esp_err_t ret = http_pool_close(&s_routes[i].endpoint);
+        if (ret == ESP_OK) {
+            ESP_LOGD(TAG, "InfluxDB connection closed");
+            return ESP_OK;
+        }
+        if (ret != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "Failed to close InfluxDB connection: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    return ESP_OK;  // No request opened a connection this cycle
+}
+
 esp_err_t influxdb_client_deinit(void)
 {
-    if (s_client) {
-        esp_http_client_cleanup(s_client);
-        s_client = NULL;
+    if (s_initialized) {
+        for (int i = 0; i < s_route_count; i++) {
+            http_pool_drop(&s_routes[i].endpoint);
+        }
     }
     
+    s_route_count = 0;
     s_initialized = false;
     ESP_LOGI(TAG, "InfluxDB client deinitialized");
     return ESP_OK;
 }
 
-influxdb_response_status_t influxdb_write_soil_data(const influxdb_soil_data_t* data)
+// ============================================================================
+// Line Protocol Encoding
+// ============================================================================
+
+bool influxdb_timestamp_is_valid(uint64_t timestamp_ns)
 {
-    if (!s_initialized || data == NULL) {
-        return INFLUXDB_RESPONSE_ERROR;
-    }
+    // Points keep their capture time whenever the clock is set (NTP or restored RTC time).
+    // This matters for backlog replay, where server time would be wrong.
+    return timestamp_ns >= INFLUXDB_MIN_VALID_TIMESTAMP_NS;
+}
 
-    // Create InfluxDB line protocol format
+static esp_err_t influxdb_encode_soil(lp_writer_t* w, const influxdb_soil_data_t* data)
+{
     // soil_moisture,device=ESP32_XXXXXX voltage=2.5,moisture_percent=45.2,raw_adc=2048 [timestamp]
-    char line_protocol[512];
-    
-#if NTP_ENABLED
-    // With NTP: Include timestamp in nanoseconds
-    snprintf(line_protocol, sizeof(line_protocol),
-        "soil_moisture,device=%s voltage=%.3f,moisture_percent=%.2f,raw_adc=%d %llu",
-        data->device_id,
-        data->voltage,
-        data->moisture_percent,
-        data->raw_adc,
-        data->timestamp_ns
-    );
-#else
-    // Without NTP: Let InfluxDB use server time (omit timestamp)
-    snprintf(line_protocol, sizeof(line_protocol),
-        "soil_moisture,device=%s voltage=%.3f,moisture_percent=%.2f,raw_adc=%d",
-        data->device_id,
-        data->voltage,
-        data->moisture_percent,
-        data->raw_adc
-    );
-#endif
+    lp_begin(w, "soil_moisture");
+    lp_tag(w, "device", data->device_id);
+    lp_field_float(w, "voltage", data->voltage, 3);
+    lp_field_float(w, "moisture_percent", data->moisture_percent, 2);
+    lp_field_float(w, "raw_adc", (float)data->raw_adc, 0);   // Existing series store raw_adc as float
+    // Without a valid clock let InfluxDB use server time (omit timestamp)
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+static esp_err_t influxdb_encode_battery(lp_writer_t* w, const influxdb_battery_data_t* data)
+{
+    // battery,device=ESP32_XXXXXX voltage=3.7,percentage=85.0 [timestamp]
+    lp_begin(w, "battery");
+    lp_tag(w, "device", data->device_id);
+    lp_field_float(w, "voltage", data->voltage, 3);
+    if (data->percentage >= 0) {
+        lp_field_float(w, "percentage", data->percentage, 1);
+    }
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+static esp_err_t influxdb_encode_env(lp_writer_t* w, const influxdb_env_data_t* data)
+{
+    // environment,device=ESP32_XXXXXX temperature_c=23.45,humidity_rh=56.78 [timestamp]
+    lp_begin(w, "environment");
+    lp_tag(w, "device", data->device_id);
+    lp_field_float(w, "temperature_c", data->temperature_c, 3);
+    lp_field_float(w, "humidity_rh", data->humidity_rh, 3);
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+static esp_err_t influxdb_encode_perf(lp_writer_t* w, const influxdb_perf_data_t* data)
+{
+    // device_perf,device=ESP32_XXXXXX,fw=1.0.0 wifi_avg=812.4,wifi_max=1630.0,...,cycles=10i [timestamp]
+    lp_begin(w, "device_perf");
+    lp_tag(w, "device", data->device_id);
+    if (data->firmware[0] != '\0') {
+        lp_tag(w, "fw", data->firmware);
+    }
+
+    int count = (data->phase_count < INFLUXDB_PERF_MAX_PHASES) ? data->phase_count : INFLUXDB_PERF_MAX_PHASES;
+    for (int i = 0; i < count; i++) {
+        const influxdb_perf_phase_t* phase = &data->phases[i];
+        char key[24];
+        snprintf(key, sizeof(key), "%s_avg", phase->name);
+        lp_field_float(w, key, phase->avg_ms, 1);
+        snprintf(key, sizeof(key), "%s_max", phase->name);
+        lp_field_float(w, key, phase->max_ms, 1);
+    }
+    lp_field_int(w, "cycles", data->cycles);
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+static esp_err_t influxdb_encode_resources(lp_writer_t* w, const influxdb_resource_data_t* data)
+{
+    // device_resources,device=ESP32_XXXXXX,fw=1.0.0 heap_min=151220i,influx_stack=8192i,influx_free=3120i,...,
+    //     tx_free=160344i,tx_largest=110592i,tx_blocks=412i [timestamp]
+    lp_begin(w, "device_resources");
+    lp_tag(w, "device", data->device_id);
+    if (data->firmware[0] != '\0') {
+        lp_tag(w, "fw", data->firmware);
+    }
+
+    char key[24];
+    lp_field_int(w, "heap_min", data->heap_min_free);
+    int tasks = (data->task_count < INFLUXDB_RESOURCE_MAX_TASKS) ? data->task_count : INFLUXDB_RESOURCE_MAX_TASKS;
+    for (int i = 0; i < tasks; i++) {
+        const influxdb_task_stack_t* task = &data->tasks[i];
+        snprintf(key, sizeof(key), "%s_stack", task->name);
+        lp_field_int(w, key, task->stack_size);
+        snprintf(key, sizeof(key), "%s_free", task->name);
+        lp_field_int(w, key, task->stack_min_free);
+    }
+    int points = (data->point_count < INFLUXDB_RESOURCE_MAX_POINTS) ? data->point_count : INFLUXDB_RESOURCE_MAX_POINTS;
+    for (int i = 0; i < points; i++) {
+        const influxdb_heap_point_t* point = &data->points[i];
+        snprintf(key, sizeof(key), "%s_free", point->name);
+        lp_field_int(w, key, point->free_min);
+        snprintf(key, sizeof(key), "%s_largest", point->name);
+        lp_field_int(w, key, point->largest_min);
+        snprintf(key, sizeof(key), "%s_blocks", point->name);
+        lp_field_int(w, key, point->blocks_max);
+    }
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+static esp_err_t influxdb_encode_window(lp_writer_t* w, const influxdb_window_data_t* data)
+{
+    // sensor_window,device=ESP32_XXXXXX,metric=soil_moisture min=41.2,max=43.0,mean=42.1,count=5i,window_s=1800i [timestamp]
+    lp_begin(w, "sensor_window");
+    lp_tag(w, "device", data->device_id);
+    lp_tag(w, "metric", data->metric);
+    lp_field_float(w, "min", data->min, 3);
+    lp_field_float(w, "max", data->max, 3);
+    lp_field_float(w, "mean", data->mean, 3);
+    lp_field_int(w, "count", data->count);
+    lp_field_int(w, "window_s", data->window_s);
+    if (influxdb_timestamp_is_valid(data->timestamp_ns)) {
+        lp_timestamp(w, data->timestamp_ns);
+    }
+    return lp_end(w);
+}
+
+// ============================================================================
+// Single-Point Writes
+// ============================================================================
 
-    // ESP_LOGI(TAG, "Soil data line protocol: %s", line_protocol);
+static influxdb_response_status_t influxdb_write_line(const lp_writer_t* w, esp_err_t encode_result)
+{
+    if (encode_result != ESP_OK) {
+        ESP_LOGE(TAG, "Line protocol encoding error: %s", esp_err_to_name(encode_result));
+        return INFLUXDB_RESPONSE_ERROR;
+    }
 
-    esp_err_t result = influxdb_send_line_protocol(line_protocol);
+    esp_err_t result = influxdb_send_line_protocol(&s_routes[0], w->buf, w->len);
     if (result == ESP_OK) {
         return INFLUXDB_RESPONSE_OK;
     } else {
@@ -134,181 +363,525 @@ influxdb_response_status_t influxdb_write_soil_data(const influxdb_soil_data_t*
     }
 }
 
+influxdb_response_status_t influxdb_write_soil_data(const influxdb_soil_data_t* data)
+{
+    if (!s_initialized || data == NULL) {
+        return INFLUXDB_RESPONSE_ERROR;
+    }
+
+    char line_protocol[INFLUXDB_LINE_MAX_LEN];
+    lp_writer_t w;
+    lp_writer_init(&w, line_protocol, sizeof(line_protocol), 0);
+    return influxdb_write_line(&w, influxdb_encode_soil(&w, data));
+}
+
 influxdb_response_status_t influxdb_write_battery_data(const influxdb_battery_data_t* data)
 {
     if (!s_initialized || data == NULL) {
         return INFLUXDB_RESPONSE_ERROR;
     }
 
-    // Create InfluxDB line protocol format
-    // battery,device=ESP32_XXXXXX voltage=3.7,percentage=85.0 [timestamp]
-    char line_protocol[512];
-    
-#if NTP_ENABLED
-    // With NTP: Include timestamp
-    if (data->percentage >= 0) {
-        snprintf(line_protocol, sizeof(line_protocol),
-            "battery,device=%s voltage=%.3f,percentage=%.1f %llu",
-            data->device_id,
-            data->voltage,
-            data->percentage,
-            data->timestamp_ns
-        );
-    } else {
-        // No percentage available
-        snprintf(line_protocol, sizeof(line_protocol),
-            "battery,device=%s voltage=%.3f %llu",
-            data->device_id,
-            data->voltage,
-            data->timestamp_ns
-        );
+    char line_protocol[INFLUXDB_LINE_MAX_LEN];
+    lp_writer_t w;
+    lp_writer_init(&w, line_protocol, sizeof(line_protocol), 0);
+    return influxdb_write_line(&w, influxdb_encode_battery(&w, data));
+}
+
+influxdb_response_status_t influxdb_write_env_data(const influxdb_env_data_t* data)
+{
+    if (!s_initialized || data == NULL) {
+        return INFLUXDB_RESPONSE_ERROR;
     }
-#else
-    // Without NTP: Let InfluxDB use server time (omit timestamp)
-    if (data->percentage >= 0) {
-        snprintf(line_protocol, sizeof(line_protocol),
-            "battery,device=%s voltage=%.3f,percentage=%.1f",
-            data->device_id,
-            data->voltage,
-            data->percentage
-        );
-    } else {
-        // No percentage available
-        snprintf(line_protocol, sizeof(line_protocol),
-            "battery,device=%s voltage=%.3f",
-            data->device_id,
-            data->voltage
-        );
+
+    char line_protocol[INFLUXDB_LINE_MAX_LEN];
+    lp_writer_t w;
+    lp_writer_init(&w, line_protocol, sizeof(line_protocol), 0);
+    return influxdb_write_line(&w, influxdb_encode_env(&w, data));
+}
+
+// ============================================================================
+// Batched Writes
+// ============================================================================
+
+esp_err_t influxdb_batch_init(influxdb_batch_t* batch, size_t initial_capacity)
+{
+    if (batch == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (initial_capacity == 0) {
+        initial_capacity = INFLUXDB_BATCH_INITIAL_SIZE;
+    }
+
+    batch->buffer = malloc(initial_capacity);
+    if (batch->buffer == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate batch buffer (%u bytes)", (unsigned)initial_capacity);
+        batch->capacity = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    batch->buffer[0] = '\0';
+    batch->length = 0;
+    batch->capacity = initial_capacity;
+    batch->max_size = INFLUXDB_BATCH_MAX_SIZE;
+    batch->point_count = 0;
+    return ESP_OK;
+}
+
+void influxdb_batch_reset(influxdb_batch_t* batch)
+{
+    if (batch == NULL) {
+        return;
+    }
+    batch->length = 0;
+    batch->point_count = 0;
+    if (batch->buffer) {
+        batch->buffer[0] = '\0';
+    }
+}
+
+void influxdb_batch_free(influxdb_batch_t* batch)
+{
+    if (batch == NULL) {
+        return;
+    }
+    free(batch->buffer);
+    batch->buffer = NULL;
+    batch->length = 0;
+    batch->capacity = 0;
+    batch->point_count = 0;
+}
+
+/**
+ * @brief Grow the arena to hold required bytes (doubling, at most max_size)
+ *
+ * @return ESP_OK if the arena now holds required bytes, ESP_ERR_NO_MEM if
+ *         max_size or the heap stops it short
+ */
+static esp_err_t influxdb_batch_reserve(influxdb_batch_t* batch, size_t required)
+{
+    if (required <= batch->capacity) {
+        return ESP_OK;
+    }
+    if (batch->capacity >= batch->max_size) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t new_capacity = batch->capacity * 2;
+    if (new_capacity < required) {
+        new_capacity = required;
+    }
+    if (new_capacity > batch->max_size) {
+        new_capacity = batch->max_size;
+    }
+
+    char* new_buffer = realloc(batch->buffer, new_capacity);
+    if (new_buffer == NULL) {
+        ESP_LOGW(TAG, "Failed to grow batch buffer to %u bytes", (unsigned)new_capacity);
+        return ESP_ERR_NO_MEM;
+    }
+    batch->buffer = new_buffer;
+    batch->capacity = new_capacity;
+    return (new_capacity >= required) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief Point an encoder at the batch tail (growing the arena if needed)
+ *
+ * A worst-case point is reserved; if the arena cannot grow that far the
+ * encoder detects the overflow itself.
+ */
+static void influxdb_batch_writer(influxdb_batch_t* batch, lp_writer_t* w)
+{
+    (void)influxdb_batch_reserve(batch, batch->length + INFLUXDB_LINE_MAX_LEN);
+    lp_writer_init(w, batch->buffer, batch->capacity, batch->length);
+}
+
+/**
+ * @brief Commit an encoded point to the batch
+ */
+static esp_err_t influxdb_batch_commit(influxdb_batch_t* batch, const lp_writer_t* w, esp_err_t encode_result)
+{
+    if (encode_result != ESP_OK) {
+        return encode_result;
+    }
+    batch->length = w->len;
+    batch->point_count++;
+    return ESP_OK;
+}
+
+esp_err_t influxdb_batch_add_soil(influxdb_batch_t* batch, const influxdb_soil_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_soil(&w, data));
+}
+
+esp_err_t influxdb_batch_add_battery(influxdb_batch_t* batch, const influxdb_battery_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_battery(&w, data));
+}
+
+esp_err_t influxdb_batch_add_env(influxdb_batch_t* batch, const influxdb_env_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_env(&w, data));
+}
+
+esp_err_t influxdb_batch_add_perf(influxdb_batch_t* batch, const influxdb_perf_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_perf(&w, data));
+}
+
+esp_err_t influxdb_batch_add_resources(influxdb_batch_t* batch, const influxdb_resource_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_resources(&w, data));
+}
+
+esp_err_t influxdb_batch_add_window(influxdb_batch_t* batch, const influxdb_window_data_t* data)
+{
+    if (batch == NULL || batch->buffer == NULL || data == NULL || data->metric == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lp_writer_t w;
+    influxdb_batch_writer(batch, &w);
+    return influxdb_batch_commit(batch, &w, influxdb_encode_window(&w, data));
+}
+
+esp_err_t influxdb_batch_add_record(influxdb_batch_t* batch, const sample_frame_record_t* rec,
+                                    uint64_t timestamp_ns)
+{
+    if (batch == NULL || batch->buffer == NULL || rec == NULL || rec->device_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (rec->type) {
+        case SAMPLE_FRAME_SOIL: {
+            influxdb_soil_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = rec->v[0],
+                .moisture_percent = rec->v[1],
+                .raw_adc = (int)rec->aux,
+            };
+            strncpy(d.device_id, rec->device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_soil(batch, &d);
+        }
+        case SAMPLE_FRAME_BATTERY: {
+            influxdb_battery_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = rec->v[0],
+                .percentage = rec->v[1],
+            };
+            strncpy(d.device_id, rec->device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_battery(batch, &d);
+        }
+        case SAMPLE_FRAME_ENV: {
+            influxdb_env_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .temperature_c = rec->v[0],
+                .humidity_rh = rec->v[1],
+            };
+            strncpy(d.device_id, rec->device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_env(batch, &d);
+        }
+        case SAMPLE_FRAME_WINDOW: {
+            if (rec->metric >= REPORT_METRIC_COUNT) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            influxdb_window_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .metric = report_metric_name((report_metric_t)rec->metric),
+                .window_s = rec->aux,
+                .min = rec->v[0],
+                .max = rec->v[1],
+                .mean = rec->v[2],
+                .count = rec->count,
+            };
+            strncpy(d.device_id, rec->device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_window(batch, &d);
+        }
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+// route < 0: every record of the frame
+static esp_err_t influxdb_batch_add_frame_records(influxdb_batch_t* batch, const uint8_t* frame, size_t len,
+                                                  int64_t clock_offset_ms, int route)
+{
+    if (batch == NULL || batch->buffer == NULL || frame == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Compressed blocks decode into the same records as frames
+    union {
+        sample_frame_reader_t frame;
+        sample_block_reader_t block;
+    } reader;
+    const bool is_block = sample_block_is_block(frame, len);
+    esp_err_t ret = is_block ? sample_block_reader_init(&reader.block, frame, len)
+                             : sample_frame_reader_init(&reader.frame, frame, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const size_t length_before = batch->length;
+    const int points_before = batch->point_count;
+    sample_frame_record_t rec;
+    while ((ret = is_block ? sample_block_next(&reader.block, &rec)
+                           : sample_frame_next(&reader.frame, &rec)) == ESP_OK) {
+        if (route >= 0 && influxdb_client_find_route(rec.device_id) != route) {
+            continue;
+        }
+        uint64_t timestamp_ns = (rec.timestamp_ms + (uint64_t)clock_offset_ms) * 1000000ULL;
+        ret = influxdb_batch_add_record(batch, &rec, timestamp_ns);
+        if (ret == ESP_ERR_INVALID_ARG) {
+            ESP_LOGW(TAG, "Skipping frame sample of unknown metric %d", rec.metric);
+            continue;
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+    }
+    if (ret == ESP_ERR_NOT_FOUND) {
+        return ESP_OK;
+    }
+
+    // Out of space or malformed: drop the points added so far
+    batch->length = length_before;
+    batch->point_count = points_before;
+    batch->buffer[batch->length] = '\0';
+    return ret;
+}
+
+esp_err_t influxdb_batch_add_frame(influxdb_batch_t* batch, const uint8_t* frame, size_t len,
+                                   int64_t clock_offset_ms)
+{
+    return influxdb_batch_add_frame_records(batch, frame, len, clock_offset_ms, -1);
+}
+
+esp_err_t influxdb_batch_add_frame_route(influxdb_batch_t* batch, const uint8_t* frame, size_t len,
+                                         int64_t clock_offset_ms, int route_id)
+{
+    if (route_id < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return influxdb_batch_add_frame_records(batch, frame, len, clock_offset_ms, route_id);
+}
+
+esp_err_t influxdb_batch_append_raw(influxdb_batch_t* batch, const char* lines, size_t len)
+{
+    if (batch == NULL || batch->buffer == NULL || lines == NULL || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (lines[len - 1] != '\n') {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Grow the arena if needed (raw chunks can be larger than one point)
+    size_t required = batch->length + len + 1;
+    if (required > batch->max_size) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = influxdb_batch_reserve(batch, required);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memcpy(batch->buffer + batch->length, lines, len);
+    batch->length += len;
+    batch->buffer[batch->length] = '\0';
+    for (size_t i = 0; i < len; i++) {
+        if (lines[i] == '\n') {
+            batch->point_count++;
+        }
+    }
+    return ESP_OK;
+}
+
+influxdb_response_status_t influxdb_write_batch(const influxdb_batch_t* batch)
+{
+    return influxdb_write_batch_to(0, batch);
+}
+
+influxdb_response_status_t influxdb_write_batch_to(int route_id, const influxdb_batch_t* batch)
+{
+    if (!s_initialized || batch == NULL || batch->buffer == NULL || route_id < 0 || route_id >= s_route_count) {
+        return INFLUXDB_RESPONSE_ERROR;
+    }
+
+    if (batch->point_count == 0) {
+        return INFLUXDB_RESPONSE_OK;
     }
-#endif
 
-    // ESP_LOGD(TAG, "Battery data line protocol: %s", line_protocol);
+    EVT_LOGI(TAG, "Writing batch: %d points, %u bytes", batch->point_count, (unsigned)batch->length);
 
-    esp_err_t result = influxdb_send_line_protocol(line_protocol);
+    esp_err_t result = influxdb_send_line_protocol(&s_routes[route_id], batch->buffer, batch->length);
     if (result == ESP_OK) {
         return INFLUXDB_RESPONSE_OK;
+    } else if (result == ESP_ERR_NOT_ALLOWED) {
+        return INFLUXDB_RESPONSE_AUTH_ERROR;
+    } else if (s_last_status_code == 429 || s_last_status_code == 503) {
+        return INFLUXDB_RESPONSE_THROTTLED;
+    } else if (result == ESP_ERR_TIMEOUT) {
+        return INFLUXDB_RESPONSE_TIMEOUT;
     } else {
         return INFLUXDB_RESPONSE_ERROR;
     }
 }
 
-static esp_err_t influxdb_send_line_protocol(const char* line_protocol)
+/**
+ * @brief gzip the body when it is large enough to be worth it
+ *
+ * @return Heap buffer with the compressed body (length in s_gzip_len), or NULL
+ *         to send the body as plain text
+ */
+static uint8_t* influxdb_compress_body(const char* body, size_t body_len)
 {
-    if (!s_initialized || line_protocol == NULL || s_client == NULL) {
-        return ESP_FAIL;
+#if INFLUXDB_GZIP_ENABLED
+    // Only kept if it is actually smaller than the plain body
+    uint8_t* out = gzip_compress_body((const uint8_t*)body, body_len, INFLUXDB_GZIP_MIN_SIZE, &s_gzip_len);
+    if (out == NULL) {
+        if (body_len >= INFLUXDB_GZIP_MIN_SIZE) {
+            ESP_LOGD(TAG, "gzip skipped (not smaller or no memory), sending uncompressed");
+        }
+        return NULL;
     }
 
-    // Build full URL with query parameters
-    char full_url[256];
-#if INFLUXDB_USE_HTTPS
-    #if NTP_ENABLED
-        // With NTP: Include precision parameter for timestamps
-        snprintf(full_url, sizeof(full_url), "https://%s:%d%s?org=%s&bucket=%s&precision=ns", 
-                 s_config.server, s_config.port, s_config.endpoint, s_config.org, s_config.bucket);
-    #else
-        // Without NTP: No precision parameter needed (server time)
-        snprintf(full_url, sizeof(full_url), "https://%s:%d%s?org=%s&bucket=%s", 
-                 s_config.server, s_config.port, s_config.endpoint, s_config.org, s_config.bucket);
-    #endif
+    EVT_LOGD(TAG, "Body compressed: %u -> %u bytes", (unsigned)body_len, (unsigned)s_gzip_len);
+    return out;
 #else
-    #if NTP_ENABLED
-        snprintf(full_url, sizeof(full_url), "http://%s:%d%s?org=%s&bucket=%s&precision=ns", 
-                 s_config.server, s_config.port, s_config.endpoint, s_config.org, s_config.bucket);
-    #else
-        snprintf(full_url, sizeof(full_url), "http://%s:%d%s?org=%s&bucket=%s", 
-                 s_config.server, s_config.port, s_config.endpoint, s_config.org, s_config.bucket);
-    #endif
+    (void)body;
+    (void)body_len;
+    return NULL;
 #endif
+}
 
-    // Set the URL for this request
-    esp_http_client_set_url(s_client, full_url);
-
-    // Set headers
-    esp_http_client_set_header(s_client, "Content-Type", "text/plain; charset=utf-8");
-    esp_http_client_set_header(s_client, "Accept", "application/json");
-    // Avoid reusing a potentially stale connection across deep-sleep cycles
-    esp_http_client_set_header(s_client, "Connection", "close");
-    
-    // Set authorization header if token is provided
-    if (strlen(s_config.token) > 0) {
-        char auth_header[512];
-        snprintf(auth_header, sizeof(auth_header), "Token %s", s_config.token);
-        esp_http_client_set_header(s_client, "Authorization", auth_header);
-    }
-
-    // Set payload (append newline to be proxy-friendly)
-    char lp_with_newline[520];
-    int lp_len = snprintf(lp_with_newline, sizeof(lp_with_newline), "%s\n", line_protocol);
-    if (lp_len < 0 || lp_len >= sizeof(lp_with_newline)) {
-        ESP_LOGE(TAG, "Line protocol formatting error (len=%d)", lp_len);
+/**
+ * @brief POST a newline-terminated line protocol body (one or more points)
+ *
+ * The body must stay valid until this call returns.
+ */
+static esp_err_t influxdb_send_line_protocol(const influxdb_route_t* route, const char* body, size_t body_len)
+{
+    if (!s_initialized || body == NULL || body_len == 0) {
         return ESP_FAIL;
     }
-    esp_http_client_set_post_field(s_client, lp_with_newline, lp_len);
 
-    // Verbose logging enabled to troubleshoot missing data in bucket
-    ESP_LOGI(TAG, "Sending to InfluxDB: %s", full_url);
-    ESP_LOGI(TAG, "Line Protocol: %s", line_protocol);
+    // The body dump is debug only: printing a batch over UART takes longer than the POST
+    EVT_LOGI(TAG, "Sending to InfluxDB: %s (%u bytes)", route->write_url, (unsigned)body_len);
+    EVT_LOGD(TAG, "Line Protocol:\n%.*s", (int)body_len, body);
+
+    // Compressed once for all attempts (every line already ends with a newline, which keeps proxies happy)
+    uint8_t* gzip_body = influxdb_compress_body(body, body_len);
+    const char* post_body = (gzip_body != NULL) ? (const char*)gzip_body : body;
+    s_last_body_len = (gzip_body != NULL) ? s_gzip_len : body_len;
 
+    http_pool_result_t res = { .err = ESP_FAIL };
     esp_err_t result = ESP_FAIL;
+    int attempts = 0;
     s_last_write_success = false; // reset before attempt
-    int retry_count = 0;
+    for (int attempt = 0; attempt <= s_config.max_retries; attempt++) {
+        if (attempt > 0) {
+            // The connection is back in the pool meanwhile, other requests to the host go ahead
+            ESP_LOGW(TAG, "Retrying InfluxDB write in %d ms (attempt %d/%d)", HTTP_POOL_RETRY_DELAY_MS,
+                     attempt + 1, s_config.max_retries + 1);
+            vTaskDelay(pdMS_TO_TICKS(HTTP_POOL_RETRY_DELAY_MS));
+        }
 
-    while (retry_count <= s_config.max_retries) {
-        esp_err_t err = esp_http_client_perform(s_client);
-        
-        if (err == ESP_OK) {
-            s_last_status_code = esp_http_client_get_status_code(s_client);
-            ESP_LOGI(TAG, "InfluxDB POST status code = %d", s_last_status_code);
-            
-            if (s_last_status_code >= 200 && s_last_status_code < 300) {
-                result = ESP_OK;
-                s_last_write_success = true;
-                break;
-            } else if (s_last_status_code == 401) {
-                ESP_LOGE(TAG, "InfluxDB authentication failed - check token");
-                result = ESP_ERR_NOT_ALLOWED;
-                break; // Don't retry auth errors
-            } else if (s_last_status_code == 404) {
-                ESP_LOGE(TAG, "InfluxDB endpoint not found (404) - check nginx routing to InfluxDB");
-                result = ESP_FAIL;
-            } else if (s_last_status_code == 502 || s_last_status_code == 503) {
-                ESP_LOGE(TAG, "nginx reverse proxy error (%d) - InfluxDB backend may be down", s_last_status_code);
-                result = ESP_FAIL;
-            } else {
-                ESP_LOGW(TAG, "InfluxDB returned non-success status %d", s_last_status_code);
-                result = ESP_FAIL;
+        // The pooled connection stays open for the rest of the cycle and keeps the URL and
+        // static headers; influxdb_client_close_connection() drops the socket before sleeping
+        // so a stale one is never reused.
+        esp_http_client_handle_t client = http_pool_acquire(&route->endpoint, route->write_url, HTTP_METHOD_POST);
+        if (client == NULL) {
+            ESP_LOGE(TAG, "No HTTP connection available");
+            if (attempts == 0) {
+                free(gzip_body);
+                return ESP_FAIL;
             }
-        } else if (err == ESP_ERR_TIMEOUT) {
-            ESP_LOGW(TAG, "InfluxDB request timeout (retry %d/%d)", retry_count, s_config.max_retries);
-            result = ESP_ERR_TIMEOUT;
-        } else if (err == ESP_ERR_HTTP_EAGAIN) {
-            ESP_LOGW(TAG, "InfluxDB EAGAIN - server busy (retry %d/%d)", retry_count, s_config.max_retries);
-            result = ESP_ERR_TIMEOUT;
-            esp_http_client_close(s_client);
+            break;
+        }
+
+        if (gzip_body != NULL) {
+            esp_http_client_set_header(client, "Content-Encoding", "gzip");
         } else {
-            int sock_errno = esp_http_client_get_errno(s_client);
-            ESP_LOGE(TAG, "InfluxDB POST failed: %s (0x%x), errno=%d (retry %d/%d)",
-                     esp_err_to_name(err), err, sock_errno, retry_count, s_config.max_retries);
-            result = ESP_FAIL;
-            esp_http_client_close(s_client);
+            esp_http_client_delete_header(client, "Content-Encoding");
         }
+        esp_http_client_set_post_field(client, post_body, (int)s_last_body_len);
+
+        // TLS is timed up to HTTP_EVENT_ON_CONNECTED, which only fires when a new connection is opened
+        s_retry_after_ms = 0;
+        s_perform_start_us = esp_timer_get_time();
+        perf_phase_begin(PERF_PHASE_POST);
+        result = http_pool_perform(client, &res);
+        perf_phase_end(PERF_PHASE_POST);
+        event_counter_inc(EVT_INFLUX_POST);
+        event_counter_add(EVT_INFLUX_BYTES, (uint32_t)s_last_body_len);
+        attempts = attempt + 1;
 
-        retry_count++;
-        if (retry_count <= s_config.max_retries) {
-            ESP_LOGW(TAG, "Retrying InfluxDB request (%d/%d) in 2 seconds...", retry_count, s_config.max_retries);
-            vTaskDelay(pdMS_TO_TICKS(2000));
+        // Drop the post field before the body is freed: the pooled handle outlives this call
+        esp_http_client_set_post_field(client, NULL, 0);
+        http_pool_release(client, res.err == ESP_OK);
+
+        if (result == ESP_OK || !res.retry) {
+            break;
         }
     }
-    
-    if (!s_last_write_success) {
+    free(gzip_body);
+
+    if (res.err == ESP_OK) {
+        s_last_status_code = res.status_code;
+        EVT_LOGI(TAG, "InfluxDB POST status code = %d", s_last_status_code);
+
         if (result == ESP_OK) {
-            // Should not happen: success without 2xx
-            ESP_LOGW(TAG, "Write marked OK but no success status captured");
+            s_last_write_success = true;
+        } else if (s_last_status_code == 401) {
+            ESP_LOGE(TAG, "InfluxDB authentication failed - check token");
+            result = ESP_ERR_NOT_ALLOWED;
+        } else if (s_last_status_code == 404) {
+            ESP_LOGE(TAG, "InfluxDB endpoint not found (404) - check nginx routing to InfluxDB");
+        } else if (s_last_status_code == 429 || s_last_status_code == 503) {
+            ESP_LOGW(TAG, "InfluxDB asks to back off (%d, Retry-After %lu ms)", s_last_status_code,
+                     (unsigned long)s_retry_after_ms);
+        } else if (s_last_status_code == 502) {
+            ESP_LOGE(TAG, "nginx reverse proxy error (%d) - InfluxDB backend may be down", s_last_status_code);
         } else {
-            ESP_LOGW(TAG, "InfluxDB write failed after retries (last_status=%d, result=%s)",
-                     s_last_status_code, esp_err_to_name(result));
+            ESP_LOGW(TAG, "InfluxDB returned non-success status %d", s_last_status_code);
         }
     }
+
+    if (!s_last_write_success) {
+        event_counter_inc(EVT_INFLUX_POST_FAIL);
+        ESP_LOGW(TAG, "InfluxDB write failed after %d attempt(s) (last_status=%d, result=%s)",
+                 attempts, s_last_status_code, esp_err_to_name(result));
+    }
     return result;
 }
 
@@ -402,22 +975,13 @@ influxdb_response_status_t influxdb_test_connection(void)
              s_config.server, s_config.port);
 #endif
 
-    esp_http_client_config_t ping_config = {
-        .url = ping_url,
-        .method = HTTP_METHOD_GET,
-        .timeout_ms = 10000,  // Increase timeout
-        .max_redirection_count = 5,  // Handle redirects from HTTP to HTTPS
-#if INFLUXDB_USE_HTTPS
-    .transport_type = HTTP_TRANSPORT_OVER_SSL,
-    .crt_bundle_attach = esp_crt_bundle_attach, // Use built-in certificate bundle
-#endif
-    };
-
-    esp_http_client_handle_t ping_client = esp_http_client_init(&ping_config);
+    // The ping runs on the pooled connection, so a following write reuses its TLS session
+    esp_http_client_handle_t ping_client = http_pool_acquire(&s_routes[0].endpoint, ping_url, HTTP_METHOD_GET);
     if (ping_client == NULL) {
-        ESP_LOGE(TAG, "Failed to create ping HTTP client");
+        ESP_LOGE(TAG, "Failed to get ping HTTP client");
         return INFLUXDB_RESPONSE_ERROR;
     }
+    esp_http_client_set_post_field(ping_client, NULL, 0);
 
     ESP_LOGI(TAG, "Testing HTTP connection to %s", ping_url);
 
@@ -443,7 +1007,7 @@ influxdb_response_status_t influxdb_test_connection(void)
         result = INFLUXDB_RESPONSE_NO_CONNECTION;
     }
 
-    esp_http_client_cleanup(ping_client);
+    http_pool_release(ping_client, err == ESP_OK);
     ESP_LOGI(TAG, "=== End Connection Test ===");
     return result;
 }
@@ -457,6 +1021,21 @@ bool influxdb_last_write_succeeded(void) {
     return s_last_write_success;
 }
 
+uint32_t influxdb_get_retry_after_ms(void)
+{
+    return s_retry_after_ms;
+}
+
+int32_t influxdb_get_upload_slot_ms(void)
+{
+    return s_upload_slot_ms;
+}
+
+size_t influxdb_get_last_body_size(void)
+{
+    return s_last_body_len;
+}
+
 static esp_err_t influxdb_event_handler(esp_http_client_event_t *evt)
 {
     switch(evt->event_id) {
@@ -465,12 +1044,33 @@ static esp_err_t influxdb_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
+            if (s_perform_start_us != 0) {
+                perf_phase_record(PERF_PHASE_TLS, (uint32_t)(esp_timer_get_time() - s_perform_start_us));
+            }
             break;
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            if (strcasecmp(evt->header_key, "Retry-After") == 0) {
+                char* end = NULL;
+                unsigned long seconds = strtoul(evt->header_value, &end, 10);
+                if (end != evt->header_value && *end == '\0') {
+                    s_retry_after_ms = (seconds > 3600UL) ? 3600UL * 1000UL : (uint32_t)(seconds * 1000UL);
+                }
+            } else if (strcasecmp(evt->header_key, INFLUXDB_UPLOAD_SLOT_HEADER) == 0) {
+                char* end = NULL;
+                unsigned long seconds = strtoul(evt->header_value, &end, 10);
+                if (end != evt->header_value && *end == '\0' && seconds <= 86400UL) {
+                    s_upload_slot_ms = (int32_t)(seconds * 1000UL);
+                }
+            }
+#if TIME_HTTP_DATE_CORRECTION
+            if (strcasecmp(evt->header_key, "Date") == 0) {
+                time_service_apply_http_date(evt->header_value, TIME_HTTP_DATE_MIN_STEP_MS);
+            }
+#endif
             break;
         case HTTP_EVENT_ON_DATA:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
@@ -494,38 +1094,3 @@ static esp_err_t influxdb_event_handler(esp_http_client_event_t *evt)
     }
     return ESP_OK;
 }
-
-influxdb_response_status_t influxdb_write_env_data(const influxdb_env_data_t* data)
-{
-    if (!s_initialized || data == NULL) {
-        return INFLUXDB_RESPONSE_ERROR;
-    }
-
-    // Measurement: environment (temperature/humidity)
-    // environment,device=ESP32_XXXXXX temperature_c=23.45,humidity_rh=56.78 [timestamp]
-    char line_protocol[512];
-
-#if NTP_ENABLED
-    snprintf(line_protocol, sizeof(line_protocol),
-        "environment,device=%s temperature_c=%.3f,humidity_rh=%.3f %llu",
-        data->device_id,
-        data->temperature_c,
-        data->humidity_rh,
-        data->timestamp_ns
-    );
-#else
-    snprintf(line_protocol, sizeof(line_protocol),
-        "environment,device=%s temperature_c=%.3f,humidity_rh=%.3f",
-        data->device_id,
-        data->temperature_c,
-        data->humidity_rh
-    );
-#endif
-
-    esp_err_t result = influxdb_send_line_protocol(line_protocol);
-    if (result == ESP_OK) {
-        return INFLUXDB_RESPONSE_OK;
-    } else {
-        return INFLUXDB_RESPONSE_ERROR;
-    }
-}
\ No newline at end of file
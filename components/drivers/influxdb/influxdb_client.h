@@ -10,6 +10,7 @@
 #define INFLUXDB_CLIENT_H
 
 #include "esp_utils.h"
+#include "sample_frame.h"
 #include "config/esp32-config.h"
 #include "config/credentials.h"
 
@@ -30,9 +31,30 @@ typedef struct {
     char token[256];            ///< InfluxDB authentication token
     char endpoint[64];          ///< API endpoint path
     int timeout_ms;             ///< Request timeout in milliseconds
-    int max_retries;            ///< Maximum retry attempts
+    int max_retries;            ///< Attempts after the first one within one write (0 = caller schedules retries)
 } influxdb_client_config_t;
 
+#ifndef INFLUXDB_MAX_ROUTES
+#define INFLUXDB_MAX_ROUTES     4   ///< Write destinations incl. the default bucket
+#endif
+
+#ifndef INFLUXDB_UPLOAD_SLOT_HEADER
+#define INFLUXDB_UPLOAD_SLOT_HEADER "X-Upload-Slot"  ///< Response header with a backend-assigned upload slot (s)
+#endif
+
+/**
+ * @brief Extra write destination on the configured server
+ *
+ * Batches written with influxdb_write_batch_to() go to the route's bucket.
+ * Empty org/token fields use the ones of the client config.
+ */
+typedef struct {
+    char key[32];               ///< Routing key prefix (see influxdb_client_find_route())
+    char bucket[32];            ///< InfluxDB bucket name
+    char org[32];               ///< InfluxDB organization name ("" = client config)
+    char token[256];            ///< InfluxDB authentication token ("" = client config)
+} influxdb_route_config_t;
+
 /**
  * @brief InfluxDB response status
  */
@@ -41,7 +63,8 @@ typedef enum {
     INFLUXDB_RESPONSE_ERROR,
     INFLUXDB_RESPONSE_TIMEOUT,
     INFLUXDB_RESPONSE_NO_CONNECTION,
-    INFLUXDB_RESPONSE_AUTH_ERROR
+    INFLUXDB_RESPONSE_AUTH_ERROR,
+    INFLUXDB_RESPONSE_THROTTLED     ///< 429/503: server asks to back off (see influxdb_get_retry_after_ms())
 } influxdb_response_status_t;
 
 /**
@@ -75,6 +98,94 @@ typedef struct {
     char device_id[32];             ///< Device identifier
 } influxdb_env_data_t;
 
+#define INFLUXDB_PERF_MAX_PHASES    10  ///< Phases one device_perf point can carry
+
+/**
+ * @brief Averaged duration of one wake-cycle phase
+ */
+typedef struct {
+    const char* name;               ///< Field prefix (static string, e.g. "wifi")
+    float avg_ms;                   ///< Average duration in the window
+    float max_ms;                   ///< Longest duration in the window
+} influxdb_perf_phase_t;
+
+/**
+ * @brief Wake-cycle timing statistics (device_perf measurement)
+ */
+typedef struct {
+    uint64_t timestamp_ns;          ///< Timestamp in nanoseconds
+    char device_id[32];             ///< Device identifier
+    char firmware[32];              ///< Firmware version tag
+    uint32_t cycles;                ///< Wake cycles covered by the statistics
+    int phase_count;                ///< Valid entries in phases
+    influxdb_perf_phase_t phases[INFLUXDB_PERF_MAX_PHASES]; ///< Per-phase timings
+} influxdb_perf_data_t;
+
+#define INFLUXDB_RESOURCE_MAX_TASKS     8   ///< Tasks one device_resources point can carry
+#define INFLUXDB_RESOURCE_MAX_POINTS    4   ///< Heap checkpoints one device_resources point can carry
+
+/**
+ * @brief Worst-case stack use of one task
+ */
+typedef struct {
+    const char* name;               ///< Field prefix (static string, e.g. "influx")
+    uint32_t stack_size;            ///< Configured stack in bytes
+    uint32_t stack_min_free;        ///< Lowest free stack in bytes
+} influxdb_task_stack_t;
+
+/**
+ * @brief Worst-case heap state at one cycle checkpoint
+ */
+typedef struct {
+    const char* name;               ///< Field prefix (static string, e.g. "tx")
+    uint32_t free_min;              ///< Lowest free heap in bytes
+    uint32_t largest_min;           ///< Smallest largest free block in bytes
+    uint32_t blocks_max;            ///< Most allocated blocks
+} influxdb_heap_point_t;
+
+/**
+ * @brief Heap and stack budget (device_resources measurement)
+ */
+typedef struct {
+    uint64_t timestamp_ns;          ///< Timestamp in nanoseconds
+    char device_id[32];             ///< Device identifier
+    char firmware[32];              ///< Firmware version tag
+    uint32_t heap_min_free;         ///< Lowest free heap since power-on in bytes
+    int task_count;                 ///< Valid entries in tasks
+    influxdb_task_stack_t tasks[INFLUXDB_RESOURCE_MAX_TASKS];  ///< Per-task stacks
+    int point_count;                ///< Valid entries in points
+    influxdb_heap_point_t points[INFLUXDB_RESOURCE_MAX_POINTS]; ///< Per-checkpoint heap
+} influxdb_resource_data_t;
+
+/**
+ * @brief Window summary of one metric (sensor_window measurement)
+ */
+typedef struct {
+    uint64_t timestamp_ns;          ///< Window start in nanoseconds
+    char device_id[32];             ///< Device identifier
+    const char* metric;             ///< Metric tag (static string, e.g. "soil_moisture")
+    uint32_t window_s;              ///< Window length in seconds
+    float min;                      ///< Smallest sample in the window
+    float max;                      ///< Largest sample in the window
+    float mean;                     ///< Mean of the samples in the window
+    uint32_t count;                 ///< Number of samples in the window
+} influxdb_window_data_t;
+
+/**
+ * @brief Multi-point line protocol body
+ *
+ * Points from any measurement are appended as newline-terminated lines into
+ * one heap buffer that grows on demand (up to max_size) and is sent with a
+ * single POST by influxdb_write_batch().
+ */
+typedef struct {
+    char* buffer;                   ///< Line protocol body (newline separated)
+    size_t length;                  ///< Bytes currently used (without terminator)
+    size_t capacity;                ///< Allocated buffer size
+    size_t max_size;                ///< Upper bound the buffer may grow to
+    int point_count;                ///< Number of points in the body
+} influxdb_batch_t;
+
 /**
  * @brief Initialize InfluxDB client
  * 
@@ -83,6 +194,48 @@ typedef struct {
  */
 esp_err_t influxdb_client_init(const influxdb_client_config_t* config);
 
+/**
+ * @brief Add a write destination (bucket/org/token) on the configured server
+ * 
+ * Route 0 is the bucket of the client config. Routes share the server's
+ * pooled keep-alive connection; only the URL and the Authorization header
+ * change between them.
+ * 
+ * @param route Route configuration (key and bucket required)
+ * @param route_id Receives the id for influxdb_write_batch_to() (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if INFLUXDB_MAX_ROUTES are in use,
+ *         ESP_ERR_INVALID_STATE if the client is not initialized
+ */
+esp_err_t influxdb_client_add_route(const influxdb_route_config_t* route, int* route_id);
+
+/**
+ * @brief Route for a routing key (e.g. a device id)
+ * 
+ * A route matches when the key starts with the route's key; the longest
+ * match wins.
+ * 
+ * @param key Routing key (NULL or no match: default route)
+ * @return int Route id (0 = bucket of the client config)
+ */
+int influxdb_client_find_route(const char* key);
+
+/**
+ * @brief Number of routes including the default one
+ */
+int influxdb_client_route_count(void);
+
+/**
+ * @brief Close the persistent connection to the server
+ * 
+ * Writes within one cycle share a single keep-alive connection. Call this at the
+ * end of the cycle (before sleeping) so the next write opens a fresh connection.
+ * With INFLUXDB_TLS_SESSION_REUSE the reconnect resumes the TLS session from a
+ * session ticket instead of running a full handshake.
+ * 
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t influxdb_client_close_connection(void);
+
 /**
  * @brief Deinitialize InfluxDB client
  * 
@@ -114,6 +267,176 @@ influxdb_response_status_t influxdb_write_battery_data(const influxdb_battery_da
  */
 influxdb_response_status_t influxdb_write_env_data(const influxdb_env_data_t* data);
 
+/**
+ * @brief Initialize an empty batch
+ * 
+ * @param batch Batch to initialize
+ * @param initial_capacity Initial buffer size in bytes (0 for INFLUXDB_BATCH_INITIAL_SIZE)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if allocation fails
+ */
+esp_err_t influxdb_batch_init(influxdb_batch_t* batch, size_t initial_capacity);
+
+/**
+ * @brief Drop all points but keep the allocated buffer
+ * 
+ * @param batch Batch to reset
+ */
+void influxdb_batch_reset(influxdb_batch_t* batch);
+
+/**
+ * @brief Release the batch buffer
+ * 
+ * @param batch Batch to free
+ */
+void influxdb_batch_free(influxdb_batch_t* batch);
+
+/**
+ * @brief Append a soil moisture point to a batch
+ * 
+ * @param batch Target batch
+ * @param data Soil moisture measurement data
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_soil(influxdb_batch_t* batch, const influxdb_soil_data_t* data);
+
+/**
+ * @brief Append a battery point to a batch
+ * 
+ * @param batch Target batch
+ * @param data Battery measurement data
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_battery(influxdb_batch_t* batch, const influxdb_battery_data_t* data);
+
+/**
+ * @brief Append a temperature/humidity point to a batch
+ * 
+ * @param batch Target batch
+ * @param data Environmental measurement data
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_env(influxdb_batch_t* batch, const influxdb_env_data_t* data);
+
+/**
+ * @brief Append a wake-cycle timing point to a batch
+ * 
+ * Writes <phase>_avg and <phase>_max fields in milliseconds plus the cycle count.
+ * 
+ * @param batch Target batch
+ * @param data Timing statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_perf(influxdb_batch_t* batch, const influxdb_perf_data_t* data);
+
+/**
+ * @brief Append a heap and stack budget point to a batch
+ * 
+ * Writes <task>_stack/<task>_free and <checkpoint>_free/_largest/_blocks
+ * fields in bytes plus the lowest free heap since power-on.
+ * 
+ * @param batch Target batch
+ * @param data Budget statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_resources(influxdb_batch_t* batch, const influxdb_resource_data_t* data);
+
+/**
+ * @brief Append a window summary point to a batch
+ * 
+ * Writes min/max/mean fields plus the sample count and window length,
+ * tagged with the device and the metric name.
+ * 
+ * @param batch Target batch
+ * @param data Window summary
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full
+ */
+esp_err_t influxdb_batch_add_window(influxdb_batch_t* batch, const influxdb_window_data_t* data);
+
+/**
+ * @brief Convert a binary sample frame (see sample_frame.h) into points of a batch
+ * 
+ * Compressed sample blocks (see sample_block.h) are accepted as well.
+ * 
+ * All points of the frame are added, or none: on ESP_ERR_NO_MEM the batch is
+ * left as it was. Timestamps are moved from the sender clock to the local one
+ * by adding clock_offset_ms (0 when the frame was written on this device).
+ * 
+ * @param batch Target batch
+ * @param frame Frame data
+ * @param len Frame length in bytes
+ * @param clock_offset_ms Added to every sample timestamp
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the points do not fit,
+ *         ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_VERSION for an unreadable frame
+ */
+esp_err_t influxdb_batch_add_frame(influxdb_batch_t* batch, const uint8_t* frame, size_t len,
+                                   int64_t clock_offset_ms);
+
+/**
+ * @brief Convert the points of a frame that belong to one route
+ * 
+ * Same as influxdb_batch_add_frame(), but only samples whose device id selects
+ * route_id (influxdb_client_find_route()) are added.
+ * 
+ * @param batch Target batch
+ * @param frame Frame data
+ * @param len Frame length in bytes
+ * @param clock_offset_ms Added to every sample timestamp
+ * @param route_id Route the added samples belong to
+ * @return esp_err_t as influxdb_batch_add_frame()
+ */
+esp_err_t influxdb_batch_add_frame_route(influxdb_batch_t* batch, const uint8_t* frame, size_t len,
+                                         int64_t clock_offset_ms, int route_id);
+
+/**
+ * @brief Append one sample in frame record form through the regular point encoders
+ * 
+ * @param batch Target batch
+ * @param rec Sample (device_id must be set)
+ * @param timestamp_ns Point timestamp in nanoseconds (rec->timestamp_ms is ignored)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the batch is full,
+ *         ESP_ERR_INVALID_ARG for an unknown type or metric
+ */
+esp_err_t influxdb_batch_add_record(influxdb_batch_t* batch, const sample_frame_record_t* rec,
+                                    uint64_t timestamp_ns);
+
+/**
+ * @brief Append already encoded, newline-terminated lines (e.g. from the backlog)
+ * 
+ * @param batch Target batch
+ * @param lines Line protocol text ending with '\n'
+ * @param len Length of the text in bytes
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if it does not fit into the batch
+ */
+esp_err_t influxdb_batch_append_raw(influxdb_batch_t* batch, const char* lines, size_t len);
+
+/**
+ * @brief Check whether a point timestamp comes from a set clock
+ * 
+ * Timestamps before INFLUXDB_MIN_VALID_TIMESTAMP_NS (clock never set) are not
+ * written, so the server assigns its own time instead of 1970.
+ * 
+ * @param timestamp_ns Timestamp in nanoseconds since the Unix epoch
+ * @return true if the timestamp is written with the point
+ */
+bool influxdb_timestamp_is_valid(uint64_t timestamp_ns);
+
+/**
+ * @brief Write all points of a batch with a single POST
+ * 
+ * @param batch Batch to send (left untouched; reset it after a successful write)
+ * @return influxdb_response_status_t Response status
+ */
+influxdb_response_status_t influxdb_write_batch(const influxdb_batch_t* batch);
+
+/**
+ * @brief Write all points of a batch to one route with a single POST
+ * 
+ * @param route_id Route from influxdb_client_add_route() or influxdb_client_find_route()
+ * @param batch Batch to send (left untouched; reset it after a successful write)
+ * @return influxdb_response_status_t Response status
+ */
+influxdb_response_status_t influxdb_write_batch_to(int route_id, const influxdb_batch_t* batch);
+
 /**
  * @brief Test InfluxDB connection
  * 
@@ -136,4 +459,31 @@ int influxdb_get_last_status_code(void);
  */
 bool influxdb_last_write_succeeded(void);
 
+/**
+ * @brief Backoff the server asked for in the Retry-After header of the last response
+ *
+ * Only the delta-seconds form is understood; an HTTP-date yields 0.
+ *
+ * @return Milliseconds to wait before the next write (0 = no hint)
+ */
+uint32_t influxdb_get_retry_after_ms(void);
+
+/**
+ * @brief Upload slot the backend assigned in an INFLUXDB_UPLOAD_SLOT_HEADER response header
+ *
+ * The header carries the node's offset within its wake interval in seconds
+ * (e.g. set per device by the reverse proxy). The value is kept until another
+ * response carries the header.
+ *
+ * @return Offset in milliseconds, -1 if no response carried the header yet
+ */
+int32_t influxdb_get_upload_slot_ms(void);
+
+/**
+ * @brief Size of the body sent with the last write request
+ *
+ * @return Bytes on the wire after compression (0 before the first write)
+ */
+size_t influxdb_get_last_body_size(void);
+
 #endif // INFLUXDB_CLIENT_H
\ No newline at end of file
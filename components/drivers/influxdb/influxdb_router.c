@@ -0,0 +1,273 @@
+/**
+ * @file influxdb_router.c
+ * @brief Per-Bucket Point Batching for a Gateway - Implementation
+ */
+
+#include "influxdb_router.h"
+#include "event_counters.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "INFLUX_ROUTER";
+
+#define ROUTER_POINT_DONE   0xFF    // Tag set index of a point that left the router
+
+_Static_assert(INFLUXDB_ROUTER_MAX_TAGSETS < ROUTER_POINT_DONE, "Tag set index collides with the done marker");
+_Static_assert(INFLUXDB_MAX_ROUTES <= UINT8_MAX, "Route id must fit the tag set");
+
+esp_err_t influxdb_router_init(influxdb_router_t* router, size_t max_points)
+{
+    if (router == NULL || max_points == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(router, 0, sizeof(*router));
+    router->points = calloc(max_points, sizeof(influxdb_routed_point_t));
+    if (router->points == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    router->capacity = max_points;
+    return ESP_OK;
+}
+
+void influxdb_router_free(influxdb_router_t* router)
+{
+    if (router == NULL) {
+        return;
+    }
+    free(router->points);
+    memset(router, 0, sizeof(*router));
+}
+
+/**
+ * @brief Index of the tag set for (device, route), interning it if new
+ *
+ * @return Index, or -1 if the table is full
+ */
+static int influxdb_router_intern(influxdb_router_t* router, const char* device_id, uint8_t route)
+{
+    for (int i = 0; i < router->tagset_count; i++) {
+        const influxdb_tagset_t* t = &router->tagsets[i];
+        if (t->route == route && strcmp(t->device_id, device_id) == 0) {
+            return i;
+        }
+    }
+    if (router->tagset_count >= INFLUXDB_ROUTER_MAX_TAGSETS) {
+        return -1;
+    }
+
+    influxdb_tagset_t* t = &router->tagsets[router->tagset_count];
+    strncpy(t->device_id, device_id, sizeof(t->device_id) - 1);
+    t->device_id[sizeof(t->device_id) - 1] = '\0';
+    t->route = route;
+    t->refs = 0;
+    return router->tagset_count++;
+}
+
+esp_err_t influxdb_router_add(influxdb_router_t* router, const char* route_key, const sample_frame_record_t* rec)
+{
+    if (router == NULL || router->points == NULL || rec == NULL || rec->device_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (router->count >= router->capacity) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t route = (uint8_t)influxdb_client_find_route(route_key ? route_key : rec->device_id);
+    int tagset = influxdb_router_intern(router, rec->device_id, route);
+    if (tagset < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    router->points[router->count++] = (influxdb_routed_point_t){
+        .timestamp_ms = rec->timestamp_ms,
+        .v = { rec->v[0], rec->v[1], rec->v[2] },
+        .aux = rec->aux,
+        .count = rec->count,
+        .type = (uint8_t)rec->type,
+        .metric = rec->metric,
+        .tagset = (uint8_t)tagset,
+    };
+    router->tagsets[tagset].refs++;
+    return ESP_OK;
+}
+
+// The point left the router (written or dropped)
+static void influxdb_router_done(influxdb_router_t* router, influxdb_routed_point_t* p)
+{
+    router->tagsets[p->tagset].refs--;
+    p->tagset = ROUTER_POINT_DONE;
+}
+
+// Frame form of a pending point (device_id points into the tag set table)
+static void influxdb_router_record(const influxdb_router_t* router, const influxdb_routed_point_t* p,
+                                   sample_frame_record_t* rec)
+{
+    *rec = (sample_frame_record_t){
+        .type = (sample_frame_type_t)p->type,
+        .device_id = router->tagsets[p->tagset].device_id,
+        .timestamp_ms = p->timestamp_ms,
+        .metric = p->metric,
+        .aux = p->aux,
+        .count = p->count,
+        .v = { p->v[0], p->v[1], p->v[2] },
+    };
+}
+
+static bool influxdb_router_on_route(const influxdb_router_t* router, const influxdb_routed_point_t* p, int route)
+{
+    return p->tagset != ROUTER_POINT_DONE && router->tagsets[p->tagset].route == route;
+}
+
+/**
+ * @brief Drop finished points and unused tag sets, keeping the order
+ */
+static void influxdb_router_compact(influxdb_router_t* router)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < router->count; i++) {
+        if (router->points[i].tagset != ROUTER_POINT_DONE) {
+            router->points[n++] = router->points[i];
+        }
+    }
+    router->count = n;
+
+    uint8_t remap[INFLUXDB_ROUTER_MAX_TAGSETS];
+    int used = 0;
+    for (int i = 0; i < router->tagset_count; i++) {
+        if (router->tagsets[i].refs == 0) {
+            continue;
+        }
+        remap[i] = (uint8_t)used;
+        if (used != i) {
+            router->tagsets[used] = router->tagsets[i];
+        }
+        used++;
+    }
+    router->tagset_count = used;
+    for (size_t i = 0; i < router->count; i++) {
+        router->points[i].tagset = remap[router->points[i].tagset];
+    }
+}
+
+/**
+ * @brief Write the pending points of one route, as many POSTs as needed
+ *
+ * @return true if every point of the route left the router
+ */
+static bool influxdb_router_flush_route(influxdb_router_t* router, int route, influxdb_batch_t* batch,
+                                        influxdb_router_result_t* res)
+{
+    size_t next = 0;
+    while (next < router->count) {
+        influxdb_batch_reset(batch);
+        size_t first = next;
+        size_t i = next;
+        for (; i < router->count; i++) {
+            influxdb_routed_point_t* p = &router->points[i];
+            if (!influxdb_router_on_route(router, p, route)) {
+                continue;
+            }
+            sample_frame_record_t rec;
+            influxdb_router_record(router, p, &rec);
+            esp_err_t ret = influxdb_batch_add_record(batch, &rec, p->timestamp_ms * 1000000ULL);
+            if (ret == ESP_ERR_NO_MEM && batch->point_count > 0) {
+                break;      // Body full: this point starts the next POST
+            }
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Dropping point of %s (type %d): %s", rec.device_id, p->type, esp_err_to_name(ret));
+                influxdb_router_done(router, p);
+                res->dropped++;
+            }
+        }
+        next = i;
+        if (batch->point_count == 0) {
+            break;
+        }
+
+        influxdb_response_status_t status = influxdb_write_batch_to(route, batch);
+        if (status != INFLUXDB_RESPONSE_OK) {
+            res->failed++;
+            res->status = status;
+            res->status_code = influxdb_get_last_status_code();
+            uint32_t retry_after_ms = influxdb_get_retry_after_ms();
+            if (retry_after_ms > res->retry_after_ms) {
+                res->retry_after_ms = retry_after_ms;
+            }
+            influxdb_batch_reset(batch);
+            return false;
+        }
+        res->posts++;
+        res->written += batch->point_count;
+        res->bytes += influxdb_get_last_body_size();
+        for (size_t j = first; j < next; j++) {
+            if (influxdb_router_on_route(router, &router->points[j], route)) {
+                influxdb_router_done(router, &router->points[j]);
+            }
+        }
+    }
+    influxdb_batch_reset(batch);
+    return true;
+}
+
+esp_err_t influxdb_router_flush(influxdb_router_t* router, influxdb_batch_t* batch,
+                                influxdb_router_result_t* result)
+{
+    influxdb_router_result_t res = { .status = INFLUXDB_RESPONSE_OK };
+    if (router == NULL || router->points == NULL || batch == NULL || batch->buffer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int routes = influxdb_client_route_count();
+    for (int route = 0; route < routes && router->count > 0; route++) {
+        if (!influxdb_router_flush_route(router, route, batch, &res)) {
+            ESP_LOGW(TAG, "Write to route %d failed (status %d), keeping its points", route, res.status);
+        }
+    }
+    influxdb_router_compact(router);
+    res.kept = (uint32_t)router->count;
+
+    if (res.posts + res.failed > 0) {
+        EVT_LOGI(TAG, "Routed %lu points in %lu POSTs (%lu kept, %lu dropped, %d devices pending)",
+                 (unsigned long)res.written, (unsigned long)res.posts, (unsigned long)res.kept,
+                 (unsigned long)res.dropped, router->tagset_count);
+    }
+    if (result != NULL) {
+        *result = res;
+    }
+    return (res.kept == 0) ? ESP_OK : ESP_FAIL;
+}
+
+size_t influxdb_router_spill(influxdb_router_t* router, influxdb_router_spill_cb_t cb, void* ctx)
+{
+    if (router == NULL || router->points == NULL || cb == NULL) {
+        return 0;
+    }
+
+    size_t spilled = 0;
+    for (size_t i = 0; i < router->count; i++) {
+        influxdb_routed_point_t* p = &router->points[i];
+        sample_frame_record_t rec;
+        influxdb_router_record(router, p, &rec);
+        if (cb(&rec, ctx) != ESP_OK) {
+            break;      // Keep this and the newer points in order
+        }
+        influxdb_router_done(router, p);
+        spilled++;
+    }
+    influxdb_router_compact(router);
+    return spilled;
+}
+
+size_t influxdb_router_clear(influxdb_router_t* router)
+{
+    if (router == NULL || router->points == NULL) {
+        return 0;
+    }
+
+    size_t dropped = router->count;
+    router->count = 0;
+    router->tagset_count = 0;
+    return dropped;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file influxdb_router.h
+ * @brief Per-Bucket Point Batching for a Gateway
+ *
+ * A gateway relays points of many devices, and each device may belong in a
+ * different bucket. The router keeps pending points in a compact binary form
+ * and interns their tag set (device id and route), so a point costs one
+ * small record plus a one-byte tag set index instead of a line of text with
+ * the full device id. On flush the points are encoded route by route into
+ * one shared batch body and written with one POST per bucket (more if a
+ * route does not fit a single body).
+ *
+ * Routes are the destinations registered with influxdb_client_add_route();
+ * a point's routing key selects one with influxdb_client_find_route().
+ *
+ * The router is not thread safe: use it from one task.
+ */
+
+#ifndef INFLUXDB_ROUTER_H
+#define INFLUXDB_ROUTER_H
+
+#include "esp_err.h"
+#include "influxdb_client.h"
+#include "sample_frame.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define INFLUXDB_ROUTER_MAX_TAGSETS     32  ///< Distinct (device, route) pairs held at once
+
+/**
+ * @brief Interned tag set shared by all pending points of one device
+ */
+typedef struct {
+    char device_id[SAMPLE_FRAME_DEVICE_ID_LEN]; ///< Device tag
+    uint8_t route;                  ///< Route id (influxdb_client_find_route())
+    uint16_t refs;                  ///< Pending points using this tag set
+} influxdb_tagset_t;
+
+/**
+ * @brief Pending point (fields as in sample_frame_record_t)
+ */
+typedef struct {
+    uint64_t timestamp_ms;          ///< Point time in ms since the epoch
+    float v[3];                     ///< Values (see sample_frame_record_t)
+    uint32_t aux;                   ///< Soil: raw ADC, window: window length (s)
+    uint32_t count;                 ///< Window: sample count
+    uint8_t type;                   ///< sample_frame_type_t
+    uint8_t metric;                 ///< Window: report_metric_t
+    uint8_t tagset;                 ///< Index into the tag set table
+} influxdb_routed_point_t;
+
+/**
+ * @brief Router state
+ */
+typedef struct {
+    influxdb_routed_point_t* points;    ///< Pending points, oldest first
+    size_t capacity;                ///< Allocated points
+    size_t count;                   ///< Pending points
+    influxdb_tagset_t tagsets[INFLUXDB_ROUTER_MAX_TAGSETS];
+    int tagset_count;               ///< Tag sets in use
+} influxdb_router_t;
+
+/**
+ * @brief Result of influxdb_router_flush()
+ */
+typedef struct {
+    uint32_t written;               ///< Points accepted by the server
+    uint32_t dropped;               ///< Points that could not be encoded
+    uint32_t kept;                  ///< Points still pending (their route's write failed)
+    uint32_t posts;                 ///< POST requests accepted
+    uint32_t failed;                ///< POST requests that failed (one per route at most)
+    size_t bytes;                   ///< Request bodies on the wire
+    influxdb_response_status_t status;  ///< Status of the last failed write (OK if none failed)
+    int status_code;                ///< HTTP status of the last failed write
+    uint32_t retry_after_ms;        ///< Largest Retry-After of the failed writes (0 = none sent)
+} influxdb_router_result_t;
+
+/**
+ * @brief Receives a point from influxdb_router_spill()
+ *
+ * @param rec Point (device_id is valid during the call only)
+ * @param ctx Context passed to influxdb_router_spill()
+ * @return esp_err_t ESP_OK once the point is taken over; anything else
+ *         keeps it and the newer points in the router
+ */
+typedef esp_err_t (*influxdb_router_spill_cb_t)(const sample_frame_record_t* rec, void* ctx);
+
+/**
+ * @brief Allocate the pending point array
+ *
+ * @param router Router to initialize
+ * @param max_points Points held before influxdb_router_add() reports ESP_ERR_NO_MEM
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if allocation fails
+ */
+esp_err_t influxdb_router_init(influxdb_router_t* router, size_t max_points);
+
+/**
+ * @brief Release the pending points
+ */
+void influxdb_router_free(influxdb_router_t* router);
+
+/**
+ * @brief Queue a point for the route its key selects
+ *
+ * @param router Router
+ * @param route_key Routing key (NULL: use the device id)
+ * @param rec Point (device_id required; timestamp_ms on the local clock)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the point array or
+ *         the tag set table is full
+ */
+esp_err_t influxdb_router_add(influxdb_router_t* router, const char* route_key, const sample_frame_record_t* rec);
+
+/**
+ * @brief Write every pending point to its route
+ *
+ * Points of a route whose write fails stay pending for the next flush; the
+ * other routes are still written. Tag sets no longer used are released.
+ *
+ * @param router Router
+ * @param batch Body buffer (reset before each POST, empty afterwards)
+ * @param result Receives the counts (may be NULL)
+ * @return esp_err_t ESP_OK if every route was written, ESP_FAIL if points were kept
+ */
+esp_err_t influxdb_router_flush(influxdb_router_t* router, influxdb_batch_t* batch,
+                                influxdb_router_result_t* result);
+
+/**
+ * @brief Hand the pending points, oldest first, to another store
+ *
+ * Used when the points cannot be written now (offline, or the retries of a
+ * failed write ran out), e.g. to move them to the offline backlog.
+ *
+ * @param router Router
+ * @param cb Takes over one point
+ * @param ctx Passed to cb
+ * @return Number of points taken over (they left the router)
+ */
+size_t influxdb_router_spill(influxdb_router_t* router, influxdb_router_spill_cb_t cb, void* ctx);
+
+/**
+ * @brief Drop every pending point
+ *
+ * @return Number of points dropped
+ */
+size_t influxdb_router_clear(influxdb_router_t* router);
+
+/**
+ * @brief Number of pending points
+ */
+static inline size_t influxdb_router_pending(const influxdb_router_t* router)
+{
+    return router->count;
+}
+
+#endif // INFLUXDB_ROUTER_H
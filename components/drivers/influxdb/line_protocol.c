@@ -0,0 +1,217 @@
+/**
+ * @file line_protocol.c
+ * @brief Write-only InfluxDB Line Protocol Encoder - Implementation
+ */
+
+#include "line_protocol.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Characters that need a backslash in measurement names
+#define LP_ESCAPE_MEASUREMENT   ", "
+// Characters that need a backslash in tag keys, tag values and field keys
+#define LP_ESCAPE_KEY           ",= "
+
+static const uint32_t s_pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// ============================================================================
+// Number Formatting
+// ============================================================================
+
+size_t lp_format_u64(char* out, uint64_t value)
+{
+    char tmp[20];
+    size_t n = 0;
+
+    do {
+        tmp[n++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+size_t lp_format_float(char* out, float value, int decimals)
+{
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 6) {
+        decimals = 6;
+    }
+
+    double magnitude = fabs((double)value);
+    double scaled = magnitude * s_pow10[decimals] + 0.5;
+
+    // Out of fixed-point range: scientific notation is valid line protocol too
+    if (scaled >= 1.8e19) {
+        int n = snprintf(out, 32, "%.6e", (double)value);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    uint64_t fixed = (uint64_t)scaled;
+    uint64_t int_part = fixed / s_pow10[decimals];
+    uint32_t frac_part = (uint32_t)(fixed % s_pow10[decimals]);
+    size_t n = 0;
+
+    if (value < 0 && fixed != 0) {
+        out[n++] = '-';
+    }
+    n += lp_format_u64(out + n, int_part);
+
+    if (decimals > 0) {
+        out[n++] = '.';
+        for (int i = decimals - 1; i >= 0; i--) {
+            out[n + i] = (char)('0' + (frac_part % 10));
+            frac_part /= 10;
+        }
+        n += decimals;
+    }
+    return n;
+}
+
+// ============================================================================
+// Writer Helpers
+// ============================================================================
+
+static void lp_put(lp_writer_t* w, const char* data, size_t len)
+{
+    if (w->overflow) {
+        return;
+    }
+    // Always keep one byte free for the newline written by lp_end()
+    if (w->len + len + 1 >= w->cap) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void lp_put_char(lp_writer_t* w, char c)
+{
+    lp_put(w, &c, 1);
+}
+
+static void lp_put_escaped(lp_writer_t* w, const char* str, const char* specials)
+{
+    if (str == NULL) {
+        return;
+    }
+    for (const char* p = str; *p != '\0'; p++) {
+        if (*p == '\n' || *p == '\r') {
+            continue;   // Newlines terminate a point and cannot be escaped
+        }
+        if (strchr(specials, *p) != NULL) {
+            lp_put_char(w, '\\');
+        }
+        lp_put_char(w, *p);
+    }
+}
+
+static void lp_put_field_key(lp_writer_t* w, const char* key)
+{
+    lp_put_char(w, w->field_count == 0 ? ' ' : ',');
+    lp_put_escaped(w, key, LP_ESCAPE_KEY);
+    lp_put_char(w, '=');
+    w->field_count++;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void lp_writer_init(lp_writer_t* w, char* buf, size_t cap, size_t len)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = len;
+    w->line_start = len;
+    w->field_count = 0;
+    w->overflow = (buf == NULL || len >= cap);
+}
+
+void lp_begin(lp_writer_t* w, const char* measurement)
+{
+    w->line_start = w->len;
+    w->field_count = 0;
+    w->overflow = (w->buf == NULL || w->len >= w->cap);
+    lp_put_escaped(w, measurement, LP_ESCAPE_MEASUREMENT);
+}
+
+void lp_tag(lp_writer_t* w, const char* key, const char* value)
+{
+    if (value == NULL || value[0] == '\0') {
+        return;     // Empty tag values are not allowed
+    }
+    lp_put_char(w, ',');
+    lp_put_escaped(w, key, LP_ESCAPE_KEY);
+    lp_put_char(w, '=');
+    lp_put_escaped(w, value, LP_ESCAPE_KEY);
+}
+
+void lp_field_float(lp_writer_t* w, const char* key, float value, int decimals)
+{
+    if (!isfinite(value)) {
+        return;
+    }
+    char num[32];
+    size_t n = lp_format_float(num, value, decimals);
+    lp_put_field_key(w, key);
+    lp_put(w, num, n);
+}
+
+void lp_field_int(lp_writer_t* w, const char* key, int64_t value)
+{
+    char num[24];
+    size_t n = 0;
+    uint64_t magnitude = (uint64_t)value;
+    if (value < 0) {
+        num[n++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    n += lp_format_u64(num + n, magnitude);
+    num[n++] = 'i';
+    lp_put_field_key(w, key);
+    lp_put(w, num, n);
+}
+
+void lp_timestamp(lp_writer_t* w, uint64_t timestamp)
+{
+    char num[21];
+    size_t n = lp_format_u64(num, timestamp);
+    lp_put_char(w, ' ');
+    lp_put(w, num, n);
+}
+
+esp_err_t lp_end(lp_writer_t* w)
+{
+    esp_err_t ret = ESP_OK;
+    if (w->overflow) {
+        ret = ESP_ERR_NO_MEM;
+    } else if (w->field_count == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+
+    if (ret != ESP_OK) {
+        // Roll back the partial line
+        w->len = w->line_start;
+        if (w->buf != NULL && w->len < w->cap) {
+            w->buf[w->len] = '\0';
+        }
+        w->overflow = false;
+        w->field_count = 0;
+        return ret;
+    }
+
+    // lp_put() reserved space for the newline and terminator
+    w->buf[w->len++] = '\n';
+    w->buf[w->len] = '\0';
+    w->line_start = w->len;
+    w->field_count = 0;
+    return ESP_OK;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file line_protocol.h
+ * @brief Write-only InfluxDB Line Protocol Encoder
+ *
+ * Appends points directly into a caller-provided buffer (the per-cycle batch
+ * arena or a small stack buffer) using hand-written integer/float formatters
+ * instead of snprintf. Measurement names, tag keys/values and field keys are
+ * escaped according to the line protocol rules.
+ *
+ * Usage:
+ *   lp_writer_t w;
+ *   lp_writer_init(&w, buf, sizeof(buf), 0);
+ *   lp_begin(&w, "environment");
+ *   lp_tag(&w, "device", device_id);
+ *   lp_field_float(&w, "temperature_c", t, 3);
+ *   lp_timestamp(&w, ts_ns);   // optional
+ *   lp_end(&w);                // appends '\n', rolls back the line on overflow
+ *
+ * The last lp_writer_init() argument is the offset to append at: the batch
+ * arena passes its current length so new points follow the committed ones.
+ */
+
+#ifndef LINE_PROTOCOL_H
+#define LINE_PROTOCOL_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Line protocol writer state
+ */
+typedef struct {
+    char* buf;                  ///< Output buffer
+    size_t cap;                 ///< Buffer capacity in bytes
+    size_t len;                 ///< Bytes written (committed + current line)
+    size_t line_start;          ///< Offset of the line being encoded
+    int field_count;            ///< Fields written on the current line
+    bool overflow;              ///< Set when the current line did not fit
+} lp_writer_t;
+
+/**
+ * @brief Attach a writer to a buffer
+ *
+ * @param w Writer to initialize
+ * @param buf Output buffer
+ * @param cap Buffer capacity in bytes
+ * @param len Bytes already used in the buffer (new lines are appended after them)
+ */
+void lp_writer_init(lp_writer_t* w, char* buf, size_t cap, size_t len);
+
+/**
+ * @brief Start a new point with the given measurement name
+ */
+void lp_begin(lp_writer_t* w, const char* measurement);
+
+/**
+ * @brief Append a tag (must be called before the first field)
+ */
+void lp_tag(lp_writer_t* w, const char* key, const char* value);
+
+/**
+ * @brief Append a float field with a fixed number of decimals (0-6)
+ *
+ * Non-finite values are not representable in line protocol and are skipped.
+ */
+void lp_field_float(lp_writer_t* w, const char* key, float value, int decimals);
+
+/**
+ * @brief Append a signed integer field (written with the 'i' type suffix)
+ */
+void lp_field_int(lp_writer_t* w, const char* key, int64_t value);
+
+/**
+ * @brief Append the point timestamp
+ */
+void lp_timestamp(lp_writer_t* w, uint64_t timestamp);
+
+/**
+ * @brief Terminate the current point with a newline
+ *
+ * On overflow (or a point without fields) the partial line is discarded and
+ * the buffer is left as it was before lp_begin().
+ *
+ * @param w Writer
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the line did not fit,
+ *         ESP_ERR_INVALID_STATE if the point has no fields
+ */
+esp_err_t lp_end(lp_writer_t* w);
+
+/**
+ * @brief Format an unsigned integer in decimal
+ *
+ * @param out Output buffer (at least 21 bytes for any uint64_t)
+ * @param value Value to format
+ * @return Number of characters written (no terminator)
+ */
+size_t lp_format_u64(char* out, uint64_t value);
+
+/**
+ * @brief Format a float in fixed-point notation
+ *
+ * @param out Output buffer (at least 32 bytes)
+ * @param value Value to format (must be finite)
+ * @param decimals Digits after the decimal point (0-6)
+ * @return Number of characters written (no terminator)
+ */
+size_t lp_format_float(char* out, float value, int decimals);
+
+#endif // LINE_PROTOCOL_H
@@ -7,7 +7,7 @@
 #include "mqtt_client.h"
 #include "esp_log.h"
 #include "esp_event.h"
-#include "cJSON.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -19,7 +19,73 @@ static mqtt_client_config_t client_config = {0};
 static bool is_connected = false;
 static SemaphoreHandle_t connection_semaphore = NULL;
 static SemaphoreHandle_t publish_semaphore = NULL;
-static int pending_publishes = 0;
+
+// Outstanding QoS>0 message IDs; an entry marked acked is a PUBACK that arrived
+// before mqtt_client_publish_ex() recorded its ID
+typedef struct {
+    int msg_id;
+    bool acked;
+} mqtt_inflight_t;
+
+static mqtt_inflight_t inflight[MQTT_CLIENT_MAX_INFLIGHT];
+static int inflight_count = 0;          // Used entries
+static int pending_publishes = 0;       // Entries still waiting for a PUBACK
+static portMUX_TYPE inflight_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Match a message ID against the in-flight table
+ *
+ * An entry recorded by the other side (publisher or PUBACK) completes the
+ * message and is removed; otherwise a new entry is added. A PUBACK entry whose
+ * publish was never recorded (the table was full then) would stay behind, so
+ * a publish that finds the table full takes the place of a PUBACK entry.
+ *
+ * @param from_ack true when called for MQTT_EVENT_PUBLISHED
+ * @return true if no entry was free (the ID is not tracked)
+ */
+static bool inflight_match(int msg_id, bool from_ack) {
+    bool full = false;
+    
+    taskENTER_CRITICAL(&inflight_lock);
+    int i;
+    for (i = 0; i < inflight_count; i++) {
+        if (inflight[i].msg_id == msg_id && inflight[i].acked != from_ack) {
+            break;
+        }
+    }
+    if (i < inflight_count) {
+        if (!inflight[i].acked) {
+            pending_publishes--;
+        }
+        inflight[i] = inflight[--inflight_count];
+    } else if (inflight_count < MQTT_CLIENT_MAX_INFLIGHT) {
+        inflight[inflight_count].msg_id = msg_id;
+        inflight[inflight_count].acked = from_ack;
+        inflight_count++;
+        if (!from_ack) {
+            pending_publishes++;
+        }
+    } else {
+        // Full: a PUBACK is not recorded, a publish replaces a PUBACK entry if there is one
+        int orphan = -1;
+        for (int j = 0; !from_ack && j < inflight_count; j++) {
+            if (inflight[j].acked) {
+                orphan = j;
+                break;
+            }
+        }
+        if (orphan >= 0) {
+            inflight[orphan].msg_id = msg_id;
+            inflight[orphan].acked = false;
+            pending_publishes++;
+        } else {
+            full = true;
+        }
+    }
+    taskEXIT_CRITICAL(&inflight_lock);
+    
+    return full;
+}
 
 /**
  * @brief MQTT event handler
@@ -43,10 +109,9 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_
             
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGD(TAG, "Message published successfully, msg_id=%d", event->msg_id);
-            if (pending_publishes > 0) {
-                pending_publishes--;
-            }
-            if (publish_semaphore && pending_publishes == 0) {
+            inflight_match(event->msg_id, true);
+            // Wake mqtt_client_wait_published() to recheck the count
+            if (publish_semaphore) {
                 xSemaphoreGive(publish_semaphore);
             }
             break;
@@ -152,6 +217,8 @@ esp_err_t mqtt_client_deinit(void) {
     esp_err_t ret = esp_mqtt_client_destroy(mqtt_client);
     mqtt_client = NULL;
     is_connected = false;
+    inflight_count = 0;
+    pending_publishes = 0;
     
     if (connection_semaphore) {
         vSemaphoreDelete(connection_semaphore);
@@ -194,24 +261,53 @@ esp_err_t mqtt_client_connect(void) {
     }
 }
 
-    esp_err_t mqtt_client_publish(const char* topic, const char* payload, size_t payload_len, int qos) {
-        if (mqtt_client == NULL || !is_connected) {
-            ESP_LOGE(TAG, "MQTT client not initialized or not connected");
-            return ESP_ERR_INVALID_STATE;
-        }
-        if (topic == NULL || payload == NULL || payload_len == 0) {
-            ESP_LOGE(TAG, "Invalid publish parameters");
-            return ESP_ERR_INVALID_ARG;
-        }
-        int msg_id = esp_mqtt_client_publish(mqtt_client, topic, payload, payload_len, qos, 0);
-        if (msg_id < 0) {
-            ESP_LOGE(TAG, "Failed to publish message to topic %s", topic);
-            return ESP_FAIL;
+esp_err_t mqtt_client_publish(const char* topic, const char* payload, size_t payload_len, int qos) {
+    return mqtt_client_publish_ex(topic, payload, payload_len, qos, false, NULL);
+}
+
+esp_err_t mqtt_client_publish_ex(const char* topic, const char* payload, size_t payload_len,
+                                 int qos, bool retain, int* msg_id_out) {
+    if (mqtt_client == NULL || !is_connected) {
+        ESP_LOGE(TAG, "MQTT client not initialized or not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (topic == NULL || payload == NULL || payload_len == 0) {
+        ESP_LOGE(TAG, "Invalid publish parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    int msg_id = esp_mqtt_client_publish(mqtt_client, topic, payload, payload_len, qos, retain ? 1 : 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish message to topic %s", topic);
+        return ESP_FAIL;
+    }
+    // QoS 0 has no acknowledgement to wait for
+    if (qos > 0 && inflight_match(msg_id, false)) {
+        ESP_LOGW(TAG, "In-flight table full, msg_id=%d not tracked", msg_id);
+    }
+    if (msg_id_out != NULL) {
+        *msg_id_out = msg_id;
+    }
+    ESP_LOGI(TAG, "Published to topic: %s (msg_id=%d%s)", topic, msg_id, retain ? ", retained" : "");
+    return ESP_OK;
+}
+
+int mqtt_client_get_inflight(void) {
+    return pending_publishes;
+}
+
+bool mqtt_client_is_pending(int msg_id) {
+    bool pending = false;
+    
+    taskENTER_CRITICAL(&inflight_lock);
+    for (int i = 0; i < inflight_count; i++) {
+        if (inflight[i].msg_id == msg_id && !inflight[i].acked) {
+            pending = true;
+            break;
         }
-        pending_publishes++;
-        ESP_LOGI(TAG, "Published to topic: %s (msg_id=%d)", topic, msg_id);
-        return ESP_OK;
     }
+    taskEXIT_CRITICAL(&inflight_lock);
+    return pending;
+}
 
 esp_err_t mqtt_client_disconnect(void) {
     if (mqtt_client == NULL) {
@@ -229,14 +325,16 @@ bool mqtt_client_is_connected(void) {
 }
 
 esp_err_t mqtt_client_wait_published(uint32_t timeout_ms) {
-    if (pending_publishes == 0) {
-        return ESP_OK;
-    }
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
     
-    if (xSemaphoreTake(publish_semaphore, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
-        return ESP_OK;
-    } else {
-        ESP_LOGW(TAG, "Timeout waiting for publishes to complete (%d pending)", pending_publishes);
-        return ESP_ERR_TIMEOUT;
+    // Every PUBACK gives the semaphore; recheck until none is outstanding
+    while (pending_publishes > 0) {
+        int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0 || publish_semaphore == NULL ||
+            xSemaphoreTake(publish_semaphore, pdMS_TO_TICKS(remaining_us / 1000 + 1)) != pdTRUE) {
+            ESP_LOGW(TAG, "Timeout waiting for publishes to complete (%d pending)", pending_publishes);
+            return ESP_ERR_TIMEOUT;
+        }
     }
+    return ESP_OK;
 }
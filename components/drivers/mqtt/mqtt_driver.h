@@ -21,6 +21,8 @@
 extern "C" {
 #endif
 
+#define MQTT_CLIENT_MAX_INFLIGHT    16      ///< QoS>0 publishes tracked until their PUBACK
+
 /**
  * @brief MQTT client configuration
  */
@@ -94,7 +96,30 @@ bool mqtt_client_is_connected(void);
 esp_err_t mqtt_client_publish(const char* topic, const char* payload, size_t payload_len, int qos);
 
 /**
- * @brief Wait for all pending publishes to complete
+ * @brief Publish a message, optionally with the retain flag
+ *
+ * Returns once the message is written (QoS 0) or stored in the client outbox
+ * (QoS > 0); it does not wait for the PUBACK. The message ID stays outstanding
+ * until the broker acknowledges it, see mqtt_client_wait_published().
+ *
+ * @param retain Ask the broker to keep the message as the topic's last value
+ * @param msg_id Receives the message ID (0 for QoS 0, may be NULL)
+ */
+esp_err_t mqtt_client_publish_ex(const char* topic, const char* payload, size_t payload_len,
+                                 int qos, bool retain, int* msg_id);
+
+/**
+ * @brief Number of QoS>0 publishes still waiting for their acknowledgement
+ */
+int mqtt_client_get_inflight(void);
+
+/**
+ * @brief Check whether a published message is still waiting for its acknowledgement
+ */
+bool mqtt_client_is_pending(int msg_id);
+
+/**
+ * @brief Wait until every outstanding QoS>0 publish has been acknowledged
  * 
  * @param timeout_ms Maximum time to wait in milliseconds
  * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT on timeout
@@ -0,0 +1,147 @@
+/**
+ * @file mqtt_outbox.c
+ * @brief Persistent MQTT Outbox on a Flash Ring Log - Implementation
+ */
+
+#include "mqtt_outbox.h"
+#include "flash_log.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "MQTT_OUTBOX";
+
+static flash_log_t s_log;
+static uint8_t s_record[MQTT_OUTBOX_MAX_RECORD];   // Store and drain run on the sender task only
+
+esp_err_t mqtt_outbox_init(const char* partition_label)
+{
+    if (partition_label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_log.is_initialized) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = flash_log_init(&s_log, partition_label);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open outbox partition '%s': %s", partition_label, esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Outbox initialized (%lu messages stored)", (unsigned long)flash_log_count(&s_log));
+    return ESP_OK;
+}
+
+esp_err_t mqtt_outbox_store(const char* topic, const uint8_t* payload, size_t payload_len, bool retain)
+{
+    if (!mqtt_outbox_is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (topic == NULL || payload == NULL || payload_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t topic_len = strlen(topic);
+    size_t len = sizeof(mqtt_outbox_record_t) + topic_len + payload_len;
+    if (topic_len > UINT8_MAX || len > sizeof(s_record)) {
+        ESP_LOGE(TAG, "Message too large to store (%u bytes)", (unsigned)len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    mqtt_outbox_record_t hdr = {
+        .retain = retain ? 1 : 0,
+        .topic_len = (uint8_t)topic_len,
+        .payload_len = (uint16_t)payload_len,
+    };
+    memcpy(s_record, &hdr, sizeof(hdr));
+    memcpy(s_record + sizeof(hdr), topic, topic_len);
+    memcpy(s_record + sizeof(hdr) + topic_len, payload, payload_len);
+
+    uint32_t dropped_before = s_log.dropped_count;
+    esp_err_t ret = flash_log_append(&s_log, s_record, len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store message: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_log.dropped_count != dropped_before) {
+        ESP_LOGW(TAG, "Outbox full, %lu oldest messages overwritten",
+                 (unsigned long)(s_log.dropped_count - dropped_before));
+    }
+    ESP_LOGI(TAG, "Stored message for %s (%lu pending)", topic, (unsigned long)flash_log_count(&s_log));
+    return ESP_OK;
+}
+
+esp_err_t mqtt_outbox_drain(mqtt_outbox_send_func_t send_func, int max_messages,
+                            uint32_t interval_ms, int* sent)
+{
+    int sent_count = 0;
+    esp_err_t result = ESP_OK;
+
+    if (sent != NULL) {
+        *sent = 0;
+    }
+    if (!mqtt_outbox_is_enabled() || send_func == NULL) {
+        return ESP_OK;
+    }
+
+    while (sent_count < max_messages && flash_log_count(&s_log) > 0) {
+        size_t len = 0;
+        esp_err_t ret = flash_log_peek(&s_log, s_record, sizeof(s_record), &len);
+        if (ret == ESP_ERR_INVALID_CRC || ret == ESP_ERR_INVALID_SIZE) {
+            ESP_LOGW(TAG, "Discarding unreadable message: %s", esp_err_to_name(ret));
+            flash_log_pop(&s_log, 1);
+            continue;
+        } else if (ret != ESP_OK) {
+            result = ESP_FAIL;
+            break;
+        }
+
+        mqtt_outbox_record_t hdr;
+        memcpy(&hdr, s_record, sizeof(hdr));
+        if (len != sizeof(hdr) + hdr.topic_len + hdr.payload_len || hdr.topic_len == 0) {
+            ESP_LOGW(TAG, "Discarding malformed message (%u bytes)", (unsigned)len);
+            flash_log_pop(&s_log, 1);
+            continue;
+        }
+
+        char topic[UINT8_MAX + 1];
+        memcpy(topic, s_record + sizeof(hdr), hdr.topic_len);
+        topic[hdr.topic_len] = '\0';
+
+        if (sent_count > 0 && interval_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(interval_ms));
+        }
+        ret = send_func(topic, s_record + sizeof(hdr) + hdr.topic_len, hdr.payload_len, hdr.retain != 0);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send stored message, keeping %lu in outbox",
+                     (unsigned long)flash_log_count(&s_log));
+            result = ESP_FAIL;
+            break;
+        }
+
+        flash_log_pop(&s_log, 1);
+        sent_count++;
+    }
+
+    if (sent_count > 0) {
+        ESP_LOGI(TAG, "Drained %d messages (%lu remaining)", sent_count,
+                 (unsigned long)flash_log_count(&s_log));
+    }
+    if (sent != NULL) {
+        *sent = sent_count;
+    }
+    return result;
+}
+
+uint32_t mqtt_outbox_count(void)
+{
+    return mqtt_outbox_is_enabled() ? flash_log_count(&s_log) : 0;
+}
+
+bool mqtt_outbox_is_enabled(void)
+{
+    return s_log.is_initialized;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file mqtt_outbox.h
+ * @brief Persistent MQTT Outbox on a Flash Ring Log
+ *
+ * Messages that could not be handed to the broker (no Wi-Fi, broker down) or
+ * whose QoS 1 acknowledgement was still missing before deep sleep are stored
+ * as encoded payloads in a flash ring log. The payload keeps the original
+ * sample timestamp. Once the client is connected again the outbox is drained
+ * oldest first, with a pause between messages to limit the publish rate.
+ *
+ * Record layout: mqtt_outbox_record_t header, topic (no terminator), payload.
+ */
+
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MQTT_OUTBOX_MAX_RECORD      512     ///< Largest stored record (header + topic + payload)
+
+/**
+ * @brief Stored record header
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t retain;                 ///< Publish with the retain flag
+    uint8_t topic_len;              ///< Topic length in bytes
+    uint16_t payload_len;           ///< Payload length in bytes
+} mqtt_outbox_record_t;
+
+/**
+ * @brief Publish function used while draining
+ *
+ * @return ESP_OK if the message was handed to the client (the record is consumed)
+ */
+typedef esp_err_t (*mqtt_outbox_send_func_t)(const char* topic, const uint8_t* payload,
+                                             size_t payload_len, bool retain);
+
+/**
+ * @brief Open the outbox on a flash partition
+ *
+ * @param partition_label Label of the outbox data partition
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t mqtt_outbox_init(const char* partition_label);
+
+/**
+ * @brief Store a message for a later publish (oldest records are overwritten when full)
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if it exceeds MQTT_OUTBOX_MAX_RECORD
+ */
+esp_err_t mqtt_outbox_store(const char* topic, const uint8_t* payload, size_t payload_len, bool retain);
+
+/**
+ * @brief Publish stored messages oldest first
+ *
+ * Stops at the first failed send; that record stays in the outbox.
+ *
+ * @param send_func Publish function
+ * @param max_messages Maximum number of messages to send
+ * @param interval_ms Pause between two messages
+ * @param sent Receives the number of sent messages (may be NULL)
+ * @return esp_err_t ESP_OK if every attempted send succeeded, ESP_FAIL otherwise
+ */
+esp_err_t mqtt_outbox_drain(mqtt_outbox_send_func_t send_func, int max_messages,
+                            uint32_t interval_ms, int* sent);
+
+/**
+ * @brief Number of stored messages
+ */
+uint32_t mqtt_outbox_count(void);
+
+/**
+ * @brief Check whether the outbox is open
+ */
+bool mqtt_outbox_is_enabled(void);
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,203 @@
+/**
+ * @file mqtt_payload.c
+ * @brief Allocation-free MQTT Payload Encoder - Implementation
+ */
+
+#include "mqtt_payload.h"
+#include "line_protocol.h"
+
+#include <math.h>
+#include <string.h>
+
+// CBOR major types (RFC 8949, section 3.1)
+#define CBOR_MAJOR_UINT         0x00
+#define CBOR_MAJOR_NEGINT       0x20
+#define CBOR_MAJOR_TEXT         0x60
+#define CBOR_MAP_INDEFINITE     0xBF
+#define CBOR_FLOAT32            0xFA
+#define CBOR_BREAK              0xFF
+
+// ============================================================================
+// Writer Helpers
+// ============================================================================
+
+static void payload_put(mqtt_payload_t* p, const void* data, size_t len)
+{
+    if (p->overflow) {
+        return;
+    }
+    // JSON keeps one byte free for the terminator written by mqtt_payload_end()
+    size_t reserve = (p->format == MQTT_PAYLOAD_JSON) ? 1 : 0;
+    if (p->len + len + reserve > p->cap) {
+        p->overflow = true;
+        return;
+    }
+    memcpy(p->buf + p->len, data, len);
+    p->len += len;
+}
+
+static void payload_put_byte(mqtt_payload_t* p, uint8_t b)
+{
+    payload_put(p, &b, 1);
+}
+
+static void cbor_put_head(mqtt_payload_t* p, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t n;
+
+    if (value < 24) {
+        head[0] = major | (uint8_t)value;
+        n = 1;
+    } else if (value <= 0xFF) {
+        head[0] = major | 24;
+        n = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = major | 25;
+        n = 3;
+    } else if (value <= 0xFFFFFFFFULL) {
+        head[0] = major | 26;
+        n = 5;
+    } else {
+        head[0] = major | 27;
+        n = 9;
+    }
+    // Argument bytes are big endian
+    for (size_t i = n - 1; i >= 1; i--) {
+        head[i] = (uint8_t)(value & 0xFF);
+        value >>= 8;
+    }
+    payload_put(p, head, n);
+}
+
+static void cbor_put_text(mqtt_payload_t* p, const char* str)
+{
+    size_t len = (str != NULL) ? strlen(str) : 0;
+    cbor_put_head(p, CBOR_MAJOR_TEXT, len);
+    payload_put(p, str, len);
+}
+
+static void json_put_string(mqtt_payload_t* p, const char* str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    payload_put_byte(p, '"');
+    if (str != NULL) {
+        for (const char* c = str; *c != '\0'; c++) {
+            uint8_t ch = (uint8_t)*c;
+            if (ch == '"' || ch == '\\') {
+                char esc[2] = { '\\', (char)ch };
+                payload_put(p, esc, 2);
+            } else if (ch < 0x20) {
+                char esc[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0x0F] };
+                payload_put(p, esc, 6);
+            } else {
+                payload_put_byte(p, ch);
+            }
+        }
+    }
+    payload_put_byte(p, '"');
+}
+
+static void payload_put_key(mqtt_payload_t* p, const char* key)
+{
+    if (p->format == MQTT_PAYLOAD_CBOR) {
+        cbor_put_text(p, key);
+    } else {
+        if (p->field_count > 0) {
+            payload_put_byte(p, ',');
+        }
+        json_put_string(p, key);
+        payload_put_byte(p, ':');
+    }
+    p->field_count++;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void mqtt_payload_init(mqtt_payload_t* p, mqtt_payload_format_t format, void* buf, size_t cap)
+{
+    p->format = format;
+    p->buf = (uint8_t*)buf;
+    p->cap = cap;
+    p->len = 0;
+    p->field_count = 0;
+    p->overflow = (buf == NULL || cap == 0);
+
+    payload_put_byte(p, (format == MQTT_PAYLOAD_CBOR) ? CBOR_MAP_INDEFINITE : '{');
+}
+
+void mqtt_payload_string(mqtt_payload_t* p, const char* key, const char* value)
+{
+    payload_put_key(p, key);
+    if (p->format == MQTT_PAYLOAD_CBOR) {
+        cbor_put_text(p, value);
+    } else {
+        json_put_string(p, value);
+    }
+}
+
+void mqtt_payload_float(mqtt_payload_t* p, const char* key, float value, int decimals)
+{
+    payload_put_key(p, key);
+    if (p->format == MQTT_PAYLOAD_CBOR) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint8_t out[5] = { CBOR_FLOAT32, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+                           (uint8_t)(bits >> 8), (uint8_t)bits };
+        payload_put(p, out, sizeof(out));
+        return;
+    }
+
+    if (!isfinite(value)) {
+        payload_put(p, "null", 4);   // JSON has no NaN/Inf
+        return;
+    }
+    char num[32];
+    size_t n = lp_format_float(num, value, decimals);
+    payload_put(p, num, n);
+}
+
+void mqtt_payload_int(mqtt_payload_t* p, const char* key, int64_t value)
+{
+    if (value >= 0) {
+        mqtt_payload_uint(p, key, (uint64_t)value);
+        return;
+    }
+
+    payload_put_key(p, key);
+    if (p->format == MQTT_PAYLOAD_CBOR) {
+        cbor_put_head(p, CBOR_MAJOR_NEGINT, (uint64_t)(-(value + 1)));
+        return;
+    }
+    char num[21];
+    num[0] = '-';
+    size_t n = 1 + lp_format_u64(num + 1, (uint64_t)(-(value + 1)) + 1);
+    payload_put(p, num, n);
+}
+
+void mqtt_payload_uint(mqtt_payload_t* p, const char* key, uint64_t value)
+{
+    payload_put_key(p, key);
+    if (p->format == MQTT_PAYLOAD_CBOR) {
+        cbor_put_head(p, CBOR_MAJOR_UINT, value);
+        return;
+    }
+    char num[20];
+    size_t n = lp_format_u64(num, value);
+    payload_put(p, num, n);
+}
+
+esp_err_t mqtt_payload_end(mqtt_payload_t* p)
+{
+    payload_put_byte(p, (p->format == MQTT_PAYLOAD_CBOR) ? CBOR_BREAK : '}');
+    if (p->overflow) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (p->format == MQTT_PAYLOAD_JSON) {
+        p->buf[p->len] = '\0';  // Space reserved by payload_put()
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file mqtt_payload.h
+ * @brief Allocation-free MQTT Payload Encoder (JSON or CBOR)
+ *
+ * Writes one flat key/value object straight into a caller-provided buffer,
+ * without building a cJSON tree or heap-allocating the printed string.
+ * Floats are written with a fixed number of decimals using the line protocol
+ * formatters. The same calls produce either format:
+ *   - JSON: {"key":value,...} (NUL-terminated, non-finite floats become null)
+ *   - CBOR: indefinite-length map, floats as single precision (RFC 8949)
+ *
+ * Usage:
+ *   mqtt_payload_t p;
+ *   mqtt_payload_init(&p, MQTT_PAYLOAD_JSON, buf, sizeof(buf));
+ *   mqtt_payload_string(&p, "device_id", id);
+ *   mqtt_payload_float(&p, "temperature", t, 2);
+ *   if (mqtt_payload_end(&p) == ESP_OK) publish(buf, p.len);
+ */
+
+#ifndef MQTT_PAYLOAD_H
+#define MQTT_PAYLOAD_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Payload encoding
+ */
+typedef enum {
+    MQTT_PAYLOAD_JSON = 0,      ///< UTF-8 JSON object
+    MQTT_PAYLOAD_CBOR = 1,      ///< Binary CBOR map
+} mqtt_payload_format_t;
+
+/**
+ * @brief Payload writer state
+ */
+typedef struct {
+    mqtt_payload_format_t format;   ///< Output encoding
+    uint8_t* buf;                   ///< Output buffer
+    size_t cap;                     ///< Buffer capacity in bytes
+    size_t len;                     ///< Bytes written
+    int field_count;                ///< Fields written so far
+    bool overflow;                  ///< Set when the payload did not fit
+} mqtt_payload_t;
+
+/**
+ * @brief Attach a writer to a buffer and open the object
+ */
+void mqtt_payload_init(mqtt_payload_t* p, mqtt_payload_format_t format, void* buf, size_t cap);
+
+/**
+ * @brief Append a string field
+ */
+void mqtt_payload_string(mqtt_payload_t* p, const char* key, const char* value);
+
+/**
+ * @brief Append a float field with a fixed number of decimals (0-6, JSON only)
+ */
+void mqtt_payload_float(mqtt_payload_t* p, const char* key, float value, int decimals);
+
+/**
+ * @brief Append a signed integer field
+ */
+void mqtt_payload_int(mqtt_payload_t* p, const char* key, int64_t value);
+
+/**
+ * @brief Append an unsigned integer field
+ */
+void mqtt_payload_uint(mqtt_payload_t* p, const char* key, uint64_t value);
+
+/**
+ * @brief Close the object
+ *
+ * @param p Writer
+ * @return esp_err_t ESP_OK on success (payload is p->len bytes),
+ *         ESP_ERR_NO_MEM if the payload did not fit
+ */
+esp_err_t mqtt_payload_end(mqtt_payload_t* p);
+
+#endif // MQTT_PAYLOAD_H
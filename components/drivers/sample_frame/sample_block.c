@@ -0,0 +1,440 @@
+/**
+ * @file sample_block.c
+ * @brief Compressed Time-Series Sample Block - Implementation
+ */
+
+#include "sample_block.h"
+#include <string.h>
+
+#define SAMPLE_BLOCK_SERIES_BITS    4           // Series index at the start of every record
+#define SAMPLE_BLOCK_SERIES_ENTRY   3           // Series table entry: type, metric, device
+
+_Static_assert(SAMPLE_BLOCK_MAX_SERIES <= (1 << SAMPLE_BLOCK_SERIES_BITS), "Series index must fit its bits");
+_Static_assert(SAMPLE_FRAME_MAX_SIZE < UINT16_MAX, "Stream length must fit the header");
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t zigzag_encode(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int bit_length(uint64_t v)
+{
+    return (v == 0) ? 0 : 64 - __builtin_clzll(v);
+}
+
+// Bits of the variable-length code of a zigzag value
+static size_t code_bits(uint64_t u)
+{
+    if (u == 0) {
+        return 1;
+    }
+    if (u < (1u << 7)) {
+        return 2 + 7;
+    }
+    if (u < (1u << 12)) {
+        return 3 + 12;
+    }
+    if (u < (1u << 20)) {
+        return 4 + 20;
+    }
+    return 4 + 6 + bit_length(u);
+}
+
+// Write the low n bits of v, most significant first
+static void put_bits(uint8_t* s, size_t* pos, uint64_t v, int n)
+{
+    for (int i = n - 1; i >= 0; i--) {
+        uint8_t mask = (uint8_t)(0x80 >> (*pos & 7));
+        if ((v >> i) & 1) {
+            s[*pos >> 3] |= mask;
+        } else {
+            s[*pos >> 3] &= (uint8_t)~mask;
+        }
+        (*pos)++;
+    }
+}
+
+static bool get_bits(const uint8_t* s, size_t end, size_t* pos, int n, uint64_t* v)
+{
+    if (*pos + (size_t)n > end) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (int i = 0; i < n; i++) {
+        result = (result << 1) | ((s[*pos >> 3] >> (7 - (*pos & 7))) & 1);
+        (*pos)++;
+    }
+    *v = result;
+    return true;
+}
+
+static void put_code(uint8_t* s, size_t* pos, int64_t value)
+{
+    uint64_t u = zigzag_encode(value);
+    if (u == 0) {
+        put_bits(s, pos, 0x0, 1);
+    } else if (u < (1u << 7)) {
+        put_bits(s, pos, 0x2, 2);
+        put_bits(s, pos, u, 7);
+    } else if (u < (1u << 12)) {
+        put_bits(s, pos, 0x6, 3);
+        put_bits(s, pos, u, 12);
+    } else if (u < (1u << 20)) {
+        put_bits(s, pos, 0xE, 4);
+        put_bits(s, pos, u, 20);
+    } else {
+        int n = bit_length(u);
+        put_bits(s, pos, 0xF, 4);
+        put_bits(s, pos, (uint64_t)(n - 1), 6);
+        put_bits(s, pos, u, n);
+    }
+}
+
+static bool get_code(const uint8_t* s, size_t end, size_t* pos, int64_t* value)
+{
+    static const int s_payload_bits[4] = { 7, 12, 20, 0 };
+    uint64_t bit = 0;
+    int ones = 0;
+    while (ones < 4) {
+        if (!get_bits(s, end, pos, 1, &bit)) {
+            return false;
+        }
+        if (bit == 0) {
+            break;
+        }
+        ones++;
+    }
+    if (ones == 0) {
+        *value = 0;
+        return true;
+    }
+
+    int n = s_payload_bits[ones - 1];
+    uint64_t u;
+    if (n == 0) {
+        if (!get_bits(s, end, pos, 6, &u)) {
+            return false;
+        }
+        n = (int)u + 1;
+    }
+    if (!get_bits(s, end, pos, n, &u)) {
+        return false;
+    }
+    *value = zigzag_decode(u);
+    return true;
+}
+
+// Fields a record type encodes
+static int field_count(uint8_t type)
+{
+    switch (type) {
+        case SAMPLE_FRAME_WINDOW: return 5;     // Window length, count, min, max, mean
+        case SAMPLE_FRAME_SOIL: return 3;       // Voltage, moisture, raw ADC
+        default: return 2;
+    }
+}
+
+static void record_to_fields(const sample_frame_record_t* rec, int64_t f[SAMPLE_BLOCK_MAX_FIELDS])
+{
+    if (rec->type == SAMPLE_FRAME_WINDOW) {
+        f[0] = rec->aux;
+        f[1] = rec->count;
+        for (int i = 0; i < 3; i++) {
+            f[2 + i] = sample_frame_quantize(rec->v[i], sample_frame_scale(rec->type, rec->metric, i));
+        }
+        return;
+    }
+    f[0] = sample_frame_quantize(rec->v[0], sample_frame_scale(rec->type, 0, 0));
+    f[1] = sample_frame_quantize(rec->v[1], sample_frame_scale(rec->type, 0, 1));
+    f[2] = rec->aux;
+}
+
+static void fields_to_record(const int64_t f[SAMPLE_BLOCK_MAX_FIELDS], sample_frame_record_t* rec)
+{
+    if (rec->type == SAMPLE_FRAME_WINDOW) {
+        rec->aux = (uint32_t)f[0];
+        rec->count = (uint32_t)f[1];
+        for (int i = 0; i < 3; i++) {
+            rec->v[i] = sample_frame_dequantize(f[2 + i], sample_frame_scale(rec->type, rec->metric, i));
+        }
+        return;
+    }
+    rec->v[0] = sample_frame_dequantize(f[0], sample_frame_scale(rec->type, 0, 0));
+    rec->v[1] = sample_frame_dequantize(f[1], sample_frame_scale(rec->type, 0, 1));
+    rec->aux = (rec->type == SAMPLE_FRAME_SOIL) ? (uint32_t)f[2] : 0;
+}
+
+// Index of a device id in the writer's table, device_count if it would be added
+static uint8_t writer_device_index(const sample_block_writer_t* w, const char* device_id)
+{
+    for (uint8_t i = 0; i < w->device_count; i++) {
+        if (strncmp(w->device_ids[i], device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    return w->device_count;
+}
+
+// Index of a series in the writer's table, series_count if it would be added
+static uint8_t writer_series_index(const sample_block_writer_t* w, uint8_t type, uint8_t metric, uint8_t device)
+{
+    for (uint8_t i = 0; i < w->series_count; i++) {
+        const sample_block_series_t* s = &w->series[i];
+        if (s->type == type && s->metric == metric && s->device == device) {
+            return i;
+        }
+    }
+    return w->series_count;
+}
+
+// Timestamp in units since the reference, rounded to the nearest unit
+static int64_t to_units(uint64_t timestamp_ms, uint64_t ref_ms, uint16_t unit_ms)
+{
+    int64_t d = (int64_t)(timestamp_ms - ref_ms);
+    int64_t half = unit_ms / 2;
+    return (d >= 0) ? (d + half) / unit_ms : (d - half) / unit_ms;
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+void sample_block_writer_init(sample_block_writer_t* w, uint8_t* buf, size_t cap,
+                              uint64_t ref_ms, uint16_t unit_ms, uint16_t max_records)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = (cap > SAMPLE_FRAME_MAX_SIZE) ? SAMPLE_FRAME_MAX_SIZE : cap;
+    w->unit_ms = (unit_ms == 0) ? 1 : unit_ms;
+    w->ref_ms = ref_ms - ref_ms % w->unit_ms;   // Decoded times land on whole units
+    w->max_records = (max_records == 0) ? UINT16_MAX : max_records;
+}
+
+esp_err_t sample_block_add(sample_block_writer_t* w, const sample_frame_record_t* rec)
+{
+    if (rec == NULL || rec->type >= SAMPLE_FRAME_TYPE_COUNT || rec->device_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (w->record_count >= w->max_records) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t type = (uint8_t)rec->type;
+    uint8_t metric = (rec->type == SAMPLE_FRAME_WINDOW) ? rec->metric : 0;
+    size_t table_len = w->table_len;
+    uint8_t device = writer_device_index(w, rec->device_id);
+    if (device == w->device_count) {
+        if (device >= SAMPLE_FRAME_MAX_DEVICES) {
+            return ESP_ERR_NO_MEM;
+        }
+        table_len += 1 + strnlen(rec->device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+    }
+    uint8_t index = writer_series_index(w, type, metric, device);
+    if (index == w->series_count) {
+        if (index >= SAMPLE_BLOCK_MAX_SERIES) {
+            return ESP_ERR_NO_MEM;
+        }
+        table_len += SAMPLE_BLOCK_SERIES_ENTRY;
+    }
+
+    // New series start from zero: their first values are coded in full
+    sample_block_series_t next = { .type = type, .metric = metric, .device = device };
+    if (index < w->series_count) {
+        next = w->series[index];
+    }
+
+    int64_t t = to_units(rec->timestamp_ms, w->ref_ms, w->unit_ms);
+    int64_t t_code = t;
+    int64_t delta = 0;
+    if (next.records > 0) {
+        delta = t - next.last_t;
+        t_code = delta - next.last_delta;   // Delta of delta
+    }
+    int64_t f[SAMPLE_BLOCK_MAX_FIELDS] = { 0 };
+    record_to_fields(rec, f);
+    int fields = field_count(type);
+
+    size_t bits = SAMPLE_BLOCK_SERIES_BITS + code_bits(zigzag_encode(t_code));
+    for (int i = 0; i < fields; i++) {
+        bits += code_bits(zigzag_encode(f[i] - next.last[i]));
+    }
+    size_t stream_len = (w->bit_pos + bits + 7) / 8;
+    if (w->buf == NULL || sizeof(sample_block_header_t) + stream_len + table_len > w->cap) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t* s = w->buf + sizeof(sample_block_header_t);
+    put_bits(s, &w->bit_pos, index, SAMPLE_BLOCK_SERIES_BITS);
+    put_code(s, &w->bit_pos, t_code);
+    for (int i = 0; i < fields; i++) {
+        put_code(s, &w->bit_pos, f[i] - next.last[i]);
+        next.last[i] = f[i];
+    }
+    next.last_delta = delta;
+    next.last_t = t;
+    next.records++;
+
+    if (device == w->device_count) {
+        strncpy(w->device_ids[device], rec->device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+        w->device_count++;
+    }
+    if (index == w->series_count) {
+        w->series_count++;
+    }
+    w->series[index] = next;
+    w->table_len = table_len;
+    w->record_count++;
+    return ESP_OK;
+}
+
+size_t sample_block_finish(sample_block_writer_t* w)
+{
+    if (w->record_count == 0) {
+        return 0;
+    }
+
+    size_t stream_len = (w->bit_pos + 7) / 8;
+    sample_block_header_t hdr = {
+        .magic = SAMPLE_BLOCK_MAGIC,
+        .version = SAMPLE_BLOCK_VERSION,
+        .series_count = w->series_count,
+        .device_count = w->device_count,
+        .record_count = w->record_count,
+        .bits_len = (uint16_t)stream_len,
+        .unit_ms = w->unit_ms,
+        .ref_ms = w->ref_ms,
+    };
+    memcpy(w->buf, &hdr, sizeof(hdr));
+
+    // Zero the padding of the last stream byte
+    size_t pad = stream_len * 8 - w->bit_pos;
+    put_bits(w->buf + sizeof(hdr), &w->bit_pos, 0, (int)pad);
+
+    size_t len = sizeof(hdr) + stream_len;
+    for (uint8_t i = 0; i < w->series_count; i++) {
+        w->buf[len++] = w->series[i].type;
+        w->buf[len++] = w->series[i].metric;
+        w->buf[len++] = w->series[i].device;
+    }
+    for (uint8_t i = 0; i < w->device_count; i++) {
+        size_t id_len = strnlen(w->device_ids[i], SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+        w->buf[len++] = (uint8_t)id_len;
+        memcpy(w->buf + len, w->device_ids[i], id_len);
+        len += id_len;
+    }
+
+    // Further adds would overwrite the tables
+    w->cap = 0;
+    return len;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+bool sample_block_is_block(const uint8_t* data, size_t len)
+{
+    return data != NULL && len >= sizeof(sample_block_header_t) && data[0] == SAMPLE_BLOCK_MAGIC;
+}
+
+esp_err_t sample_block_reader_init(sample_block_reader_t* r, const uint8_t* data, size_t len)
+{
+    if (r == NULL || !sample_block_is_block(data, len)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    sample_block_header_t hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.version != SAMPLE_BLOCK_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    size_t pos = sizeof(hdr) + hdr.bits_len;
+    if (hdr.series_count > SAMPLE_BLOCK_MAX_SERIES || hdr.device_count > SAMPLE_FRAME_MAX_DEVICES ||
+        hdr.unit_ms == 0 || pos + (size_t)hdr.series_count * SAMPLE_BLOCK_SERIES_ENTRY > len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(r, 0, sizeof(*r));
+    for (uint8_t i = 0; i < hdr.series_count; i++) {
+        sample_block_series_t* s = &r->series[i];
+        s->type = data[pos++];
+        s->metric = data[pos++];
+        s->device = data[pos++];
+        if (s->type >= SAMPLE_FRAME_TYPE_COUNT || s->device >= hdr.device_count) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    for (uint8_t i = 0; i < hdr.device_count; i++) {
+        if (pos >= len || data[pos] >= SAMPLE_FRAME_DEVICE_ID_LEN || pos + 1 + data[pos] > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(r->device_ids[i], data + pos + 1, data[pos]);
+        pos += 1 + data[pos];
+    }
+    if (pos != len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    r->data = data + sizeof(hdr);
+    r->bit_end = (size_t)hdr.bits_len * 8;
+    r->remaining = hdr.record_count;
+    r->ref_ms = hdr.ref_ms;
+    r->unit_ms = hdr.unit_ms;
+    r->series_count = hdr.series_count;
+    r->device_count = hdr.device_count;
+    return ESP_OK;
+}
+
+esp_err_t sample_block_next(sample_block_reader_t* r, sample_frame_record_t* rec)
+{
+    if (r->remaining == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint64_t index;
+    int64_t t_code;
+    if (!get_bits(r->data, r->bit_end, &r->bit_pos, SAMPLE_BLOCK_SERIES_BITS, &index) ||
+        index >= r->series_count ||
+        !get_code(r->data, r->bit_end, &r->bit_pos, &t_code)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    sample_block_series_t* s = &r->series[index];
+
+    int64_t f[SAMPLE_BLOCK_MAX_FIELDS] = { 0 };
+    int fields = field_count(s->type);
+    for (int i = 0; i < fields; i++) {
+        int64_t delta;
+        if (!get_code(r->data, r->bit_end, &r->bit_pos, &delta)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        f[i] = s->last[i] + delta;
+    }
+
+    int64_t t = t_code;
+    if (s->records > 0) {
+        int64_t delta = s->last_delta + t_code;
+        t = s->last_t + delta;
+        s->last_delta = delta;
+    }
+    s->last_t = t;
+    s->records++;
+    memcpy(s->last, f, sizeof(s->last));
+
+    memset(rec, 0, sizeof(*rec));
+    rec->type = (sample_frame_type_t)s->type;
+    rec->metric = s->metric;
+    rec->device_id = r->device_ids[s->device];
+    rec->timestamp_ms = r->ref_ms + (uint64_t)(t * r->unit_ms);
+    fields_to_record(f, rec);
+    r->remaining--;
+    return ESP_OK;
+}
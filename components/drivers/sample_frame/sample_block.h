@@ -0,0 +1,174 @@
+/**
+ * @file sample_block.h
+ * @brief Compressed Time-Series Sample Block
+ *
+ * Long offline periods fill the flash backlog with sample frames, where each
+ * record still carries its type, device and values in full. A block keeps the
+ * same samples per series (device, sample type and window metric) and only
+ * encodes what changed, Gorilla style, as a bit stream:
+ *   - Each record starts with its series index (4 bits)
+ *   - Timestamps are delta-of-delta to the series' previous two records: a
+ *     sensor on a fixed wake grid costs a single '0' bit per sample
+ *   - Values are the fixed-point values of sample_frame (same precision) as
+ *     deltas to the series' previous record
+ *   - Both use the same variable-length code: '0' for no change, '10' + 7,
+ *     '110' + 12, '1110' + 20 bits, '1111' + 6-bit length + value otherwise
+ *   - Series and device tables follow the bit stream, appended by finish()
+ *
+ * A slowly changing soil, battery or environment reading takes 2-4 bytes
+ * instead of the 8-10 of a frame record. Timestamps are kept in units of
+ * unit_ms (1 ms, or 1000 ms for sources that only keep seconds), so wake
+ * jitter below the unit does not cost bits.
+ *
+ * The first byte (SAMPLE_BLOCK_MAGIC) differs from a frame's and never starts
+ * a line protocol line, so blocks, frames and text can share one log. Records
+ * decode into sample_frame_record_t, the same as a frame's.
+ *
+ * Usage:
+ *   sample_block_writer_t w;
+ *   sample_block_writer_init(&w, buf, sizeof(buf), now_ms, 1, 0);
+ *   sample_block_add(&w, &rec);        // ESP_ERR_NO_MEM once the block is full
+ *   size_t len = sample_block_finish(&w);
+ *
+ *   sample_block_reader_t r;
+ *   sample_block_reader_init(&r, buf, len);
+ *   while (sample_block_next(&r, &rec) == ESP_OK) { ... }
+ */
+
+#ifndef SAMPLE_BLOCK_H
+#define SAMPLE_BLOCK_H
+
+#include "esp_err.h"
+#include "sample_frame.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_BLOCK_MAGIC          0xA6    ///< First byte of every block
+#define SAMPLE_BLOCK_VERSION        1       ///< Increment on any change of the encoding
+#define SAMPLE_BLOCK_MAX_SERIES     16      ///< Series one block can hold (4-bit index)
+#define SAMPLE_BLOCK_MAX_FIELDS     5       ///< Encoded fields of the largest record (window)
+
+/**
+ * @brief Block header (packed, little endian)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t magic;                  ///< SAMPLE_BLOCK_MAGIC
+    uint8_t version;                ///< SAMPLE_BLOCK_VERSION
+    uint8_t series_count;           ///< Entries in the series table
+    uint8_t device_count;           ///< Entries in the device table
+    uint16_t record_count;          ///< Records in the block
+    uint16_t bits_len;              ///< Bytes of bit stream after the header (tables follow)
+    uint16_t unit_ms;               ///< Timestamp unit
+    uint64_t ref_ms;                ///< Sender clock (ms) when the block was started
+} sample_block_header_t;
+
+/**
+ * @brief Per-series coder state
+ */
+typedef struct {
+    uint8_t type;                   ///< sample_frame_type_t
+    uint8_t metric;                 ///< Window: report_metric_t
+    uint8_t device;                 ///< Index into the device table
+    uint16_t records;               ///< Records of the series so far
+    int64_t last_t;                 ///< Previous timestamp (units since ref_ms)
+    int64_t last_delta;             ///< Previous timestamp delta (units)
+    int64_t last[SAMPLE_BLOCK_MAX_FIELDS];  ///< Previous fixed-point fields
+} sample_block_series_t;
+
+/**
+ * @brief Block writer state
+ */
+typedef struct {
+    uint8_t* buf;                   ///< Output buffer
+    size_t cap;                     ///< Buffer capacity in bytes
+    size_t bit_pos;                 ///< Bits of stream written after the header
+    size_t table_len;               ///< Bytes the series and device tables will take
+    uint64_t ref_ms;                ///< Clock reference written to the header
+    uint16_t unit_ms;               ///< Timestamp unit
+    uint16_t max_records;           ///< Records before the block counts as full
+    uint16_t record_count;          ///< Records written
+    uint8_t series_count;           ///< Series referenced
+    uint8_t device_count;           ///< Distinct device ids referenced
+    sample_block_series_t series[SAMPLE_BLOCK_MAX_SERIES];
+    char device_ids[SAMPLE_FRAME_MAX_DEVICES][SAMPLE_FRAME_DEVICE_ID_LEN];
+} sample_block_writer_t;
+
+/**
+ * @brief Block reader state
+ */
+typedef struct {
+    const uint8_t* data;            ///< Block being read
+    size_t bit_pos;                 ///< Next bit of the stream (from the end of the header)
+    size_t bit_end;                 ///< Bits in the stream
+    uint16_t remaining;             ///< Records not read yet
+    uint64_t ref_ms;                ///< Sender clock when the block was started
+    uint16_t unit_ms;               ///< Timestamp unit
+    uint8_t series_count;           ///< Entries in series
+    uint8_t device_count;           ///< Entries in device_ids
+    sample_block_series_t series[SAMPLE_BLOCK_MAX_SERIES];
+    char device_ids[SAMPLE_FRAME_MAX_DEVICES][SAMPLE_FRAME_DEVICE_ID_LEN];
+} sample_block_reader_t;
+
+/**
+ * @brief Start a block in a buffer
+ *
+ * @param w Writer to initialize
+ * @param buf Output buffer (at most SAMPLE_FRAME_MAX_SIZE bytes are used)
+ * @param cap Buffer capacity in bytes
+ * @param ref_ms Sender clock now, rounded down to a multiple of unit_ms; record
+ *        timestamps are encoded relative to it
+ * @param unit_ms Timestamp unit (timestamps are rounded to the nearest multiple, 0 is taken as 1)
+ * @param max_records Records the block takes at most (0: until the buffer is full);
+ *        bounds what one block decodes to, e.g. to fit a request body
+ */
+void sample_block_writer_init(sample_block_writer_t* w, uint8_t* buf, size_t cap,
+                              uint64_t ref_ms, uint16_t unit_ms, uint16_t max_records);
+
+/**
+ * @brief Append a sample
+ *
+ * @param w Writer
+ * @param rec Sample to encode
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the record, its series or
+ *         its device id does not fit or max_records is reached (the block is
+ *         unchanged), ESP_ERR_INVALID_ARG
+ *         for an unknown type
+ */
+esp_err_t sample_block_add(sample_block_writer_t* w, const sample_frame_record_t* rec);
+
+/**
+ * @brief Append the series and device tables and complete the header
+ *
+ * @param w Writer (must be initialized again before the next block)
+ * @return Block length in bytes, 0 if the block holds no records
+ */
+size_t sample_block_finish(sample_block_writer_t* w);
+
+/**
+ * @brief Check whether a buffer starts with a block header
+ */
+bool sample_block_is_block(const uint8_t* data, size_t len);
+
+/**
+ * @brief Validate a block and load its tables
+ *
+ * @param r Reader to initialize (data must stay valid while reading)
+ * @param data Block
+ * @param len Block length in bytes
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_VERSION for another version,
+ *         ESP_ERR_INVALID_SIZE for a truncated or malformed block
+ */
+esp_err_t sample_block_reader_init(sample_block_reader_t* r, const uint8_t* data, size_t len);
+
+/**
+ * @brief Decode the next sample
+ *
+ * @param r Reader
+ * @param rec Receives the sample (device_id points into the reader)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND after the last record,
+ *         ESP_ERR_INVALID_SIZE for a malformed record (stop reading)
+ */
+esp_err_t sample_block_next(sample_block_reader_t* r, sample_frame_record_t* rec);
+
+#endif // SAMPLE_BLOCK_H
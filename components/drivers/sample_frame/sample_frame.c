@@ -0,0 +1,328 @@
+/**
+ * @file sample_frame.c
+ * @brief Compact Binary Sample Frame - Implementation
+ */
+
+#include "sample_frame.h"
+#include "report_policy.h"
+#include <math.h>
+#include <string.h>
+
+#define SAMPLE_FRAME_MAX_RECORD     48          // Worst case record: 1 + 10 + 1 + 2 * 5 + 3 * 5 bytes
+#define SAMPLE_FRAME_NAN_CODE       INT32_MIN   // Quantized value of NaN/inf
+
+// Fixed-point scale of v[0]/v[1] per sample type (windows use the metric's scale)
+static const float s_type_scale[SAMPLE_FRAME_TYPE_COUNT][2] = {
+    [SAMPLE_FRAME_SOIL]    = { 1000.0f, 100.0f },  // V in mV, moisture in 0.01 %
+    [SAMPLE_FRAME_BATTERY] = { 1000.0f, 10.0f },   // V in mV, percentage in 0.1 % (-1 stays -1)
+    [SAMPLE_FRAME_ENV]     = { 100.0f, 100.0f },   // 0.01 C, 0.01 %RH
+};
+
+static const float s_metric_scale[REPORT_METRIC_COUNT] = {
+    [REPORT_METRIC_BATTERY_VOLTAGE] = 1000.0f,
+    [REPORT_METRIC_TEMPERATURE] = 100.0f,
+    [REPORT_METRIC_HUMIDITY] = 100.0f,
+    [REPORT_METRIC_SOIL_MOISTURE] = 100.0f,
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static float metric_scale(uint8_t metric)
+{
+    return (metric < REPORT_METRIC_COUNT) ? s_metric_scale[metric] : 1000.0f;
+}
+
+float sample_frame_scale(sample_frame_type_t type, uint8_t metric, int index)
+{
+    if (type == SAMPLE_FRAME_WINDOW) {
+        return metric_scale(metric);
+    }
+    return (type < SAMPLE_FRAME_WINDOW && index >= 0 && index < 2) ? s_type_scale[type][index] : 1.0f;
+}
+
+int32_t sample_frame_quantize(float value, float scale)
+{
+    if (!isfinite(value)) {
+        return SAMPLE_FRAME_NAN_CODE;
+    }
+    float q = roundf(value * scale);
+    if (q >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (q <= -2147483520.0f) {
+        return INT32_MIN + 1;
+    }
+    return (int32_t)q;
+}
+
+float sample_frame_dequantize(int64_t q, float scale)
+{
+    return (q == SAMPLE_FRAME_NAN_CODE) ? NAN : (float)q / scale;
+}
+
+static uint64_t zigzag_encode(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t* out, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t put_svarint(uint8_t* out, int64_t v)
+{
+    return put_varint(out, zigzag_encode(v));
+}
+
+static bool get_varint(const uint8_t* data, size_t end, size_t* pos, uint64_t* v)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+        uint8_t b = data[(*pos)++];
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_svarint(const uint8_t* data, size_t end, size_t* pos, int64_t* v)
+{
+    uint64_t raw;
+    if (!get_varint(data, end, pos, &raw)) {
+        return false;
+    }
+    *v = zigzag_decode(raw);
+    return true;
+}
+
+// Index of a device id in the writer's table, device_count if it would be added
+static uint8_t writer_device_index(const sample_frame_writer_t* w, const char* device_id)
+{
+    for (uint8_t i = 0; i < w->device_count; i++) {
+        if (strncmp(w->device_ids[i], device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    return w->device_count;
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+void sample_frame_writer_init(sample_frame_writer_t* w, uint8_t* buf, size_t cap, uint64_t ref_ms)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = (cap > SAMPLE_FRAME_MAX_SIZE) ? SAMPLE_FRAME_MAX_SIZE : cap;
+    w->len = sizeof(sample_frame_header_t);
+    w->ref_ms = ref_ms;
+    w->last_ms = ref_ms;
+}
+
+esp_err_t sample_frame_add(sample_frame_writer_t* w, const sample_frame_record_t* rec)
+{
+    if (rec == NULL || rec->type >= SAMPLE_FRAME_TYPE_COUNT || rec->device_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (w->record_count == UINT16_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t device = writer_device_index(w, rec->device_id);
+    size_t table_len = w->table_len;
+    if (device == w->device_count) {
+        if (device >= SAMPLE_FRAME_MAX_DEVICES) {
+            return ESP_ERR_NO_MEM;
+        }
+        table_len += 1 + strnlen(rec->device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+    }
+
+    uint8_t tmp[SAMPLE_FRAME_MAX_RECORD];
+    size_t n = 0;
+    tmp[n++] = (uint8_t)((rec->type << 4) | device);
+    n += put_svarint(tmp + n, (int64_t)(rec->timestamp_ms - w->last_ms));
+
+    if (rec->type == SAMPLE_FRAME_WINDOW) {
+        float scale = metric_scale(rec->metric);
+        tmp[n++] = rec->metric;
+        n += put_varint(tmp + n, rec->aux);
+        n += put_varint(tmp + n, rec->count);
+        for (int i = 0; i < 3; i++) {
+            n += put_svarint(tmp + n, sample_frame_quantize(rec->v[i], scale));
+        }
+    } else {
+        n += put_svarint(tmp + n, sample_frame_quantize(rec->v[0], s_type_scale[rec->type][0]));
+        n += put_svarint(tmp + n, sample_frame_quantize(rec->v[1], s_type_scale[rec->type][1]));
+        if (rec->type == SAMPLE_FRAME_SOIL) {
+            n += put_varint(tmp + n, rec->aux);
+        }
+    }
+
+    if (w->buf == NULL || w->len + n + table_len > w->cap) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (device == w->device_count) {
+        strncpy(w->device_ids[device], rec->device_id, SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+        w->device_count++;
+    }
+    memcpy(w->buf + w->len, tmp, n);
+    w->len += n;
+    w->table_len = table_len;
+    w->last_ms = rec->timestamp_ms;
+    w->record_count++;
+    return ESP_OK;
+}
+
+size_t sample_frame_finish(sample_frame_writer_t* w)
+{
+    if (w->record_count == 0) {
+        return 0;
+    }
+
+    sample_frame_header_t hdr = {
+        .magic = SAMPLE_FRAME_MAGIC,
+        .version = SAMPLE_FRAME_VERSION,
+        .device_count = w->device_count,
+        .record_count = w->record_count,
+        .records_len = (uint16_t)(w->len - sizeof(hdr)),
+        .ref_ms = w->ref_ms,
+    };
+    memcpy(w->buf, &hdr, sizeof(hdr));
+
+    size_t len = w->len;
+    for (uint8_t i = 0; i < w->device_count; i++) {
+        size_t id_len = strnlen(w->device_ids[i], SAMPLE_FRAME_DEVICE_ID_LEN - 1);
+        w->buf[len++] = (uint8_t)id_len;
+        memcpy(w->buf + len, w->device_ids[i], id_len);
+        len += id_len;
+    }
+
+    // Further adds would overwrite the table
+    w->cap = 0;
+    return len;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+bool sample_frame_is_frame(const uint8_t* data, size_t len)
+{
+    return data != NULL && len >= sizeof(sample_frame_header_t) && data[0] == SAMPLE_FRAME_MAGIC;
+}
+
+esp_err_t sample_frame_reader_init(sample_frame_reader_t* r, const uint8_t* data, size_t len)
+{
+    if (r == NULL || !sample_frame_is_frame(data, len)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    sample_frame_header_t hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.version != SAMPLE_FRAME_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (hdr.device_count > SAMPLE_FRAME_MAX_DEVICES || sizeof(hdr) + hdr.records_len > len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(r, 0, sizeof(*r));
+    size_t pos = sizeof(hdr) + hdr.records_len;
+    for (uint8_t i = 0; i < hdr.device_count; i++) {
+        if (pos >= len || data[pos] >= SAMPLE_FRAME_DEVICE_ID_LEN || pos + 1 + data[pos] > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(r->device_ids[i], data + pos + 1, data[pos]);
+        pos += 1 + data[pos];
+    }
+    if (pos != len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    r->data = data;
+    r->pos = sizeof(hdr);
+    r->records_end = sizeof(hdr) + hdr.records_len;
+    r->remaining = hdr.record_count;
+    r->ref_ms = hdr.ref_ms;
+    r->last_ms = hdr.ref_ms;
+    r->device_count = hdr.device_count;
+    return ESP_OK;
+}
+
+esp_err_t sample_frame_next(sample_frame_reader_t* r, sample_frame_record_t* rec)
+{
+    if (r->remaining == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (r->pos >= r->records_end) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t* d = r->data;
+    const size_t end = r->records_end;
+    uint8_t type = d[r->pos] >> 4;
+    uint8_t device = d[r->pos] & 0x0F;
+    r->pos++;
+    if (type >= SAMPLE_FRAME_TYPE_COUNT || device >= r->device_count) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->type = (sample_frame_type_t)type;
+    rec->device_id = r->device_ids[device];
+
+    int64_t delta, q[3];
+    uint64_t aux = 0, count = 0;
+    if (!get_svarint(d, end, &r->pos, &delta)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (type == SAMPLE_FRAME_WINDOW) {
+        if (r->pos >= end) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        rec->metric = d[r->pos++];
+        if (!get_varint(d, end, &r->pos, &aux) || !get_varint(d, end, &r->pos, &count) ||
+            !get_svarint(d, end, &r->pos, &q[0]) || !get_svarint(d, end, &r->pos, &q[1]) ||
+            !get_svarint(d, end, &r->pos, &q[2])) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        float scale = metric_scale(rec->metric);
+        for (int i = 0; i < 3; i++) {
+            rec->v[i] = sample_frame_dequantize(q[i], scale);
+        }
+    } else {
+        if (!get_svarint(d, end, &r->pos, &q[0]) || !get_svarint(d, end, &r->pos, &q[1]) ||
+            (type == SAMPLE_FRAME_SOIL && !get_varint(d, end, &r->pos, &aux))) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        rec->v[0] = sample_frame_dequantize(q[0], s_type_scale[type][0]);
+        rec->v[1] = sample_frame_dequantize(q[1], s_type_scale[type][1]);
+    }
+
+    r->last_ms += (uint64_t)delta;
+    rec->timestamp_ms = r->last_ms;
+    rec->aux = (uint32_t)aux;
+    rec->count = (uint32_t)count;
+    r->remaining--;
+    return ESP_OK;
+}
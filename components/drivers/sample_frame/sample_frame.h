@@ -0,0 +1,185 @@
+/**
+ * @file sample_frame.h
+ * @brief Compact Binary Sample Frame
+ *
+ * One frame carries many sensor samples in a few bytes each and is shared by
+ * the ESP-NOW leaf/gateway link and the InfluxDB flash backlog:
+ *   - Header: magic, version, device count, record count, records length and
+ *     the sender's clock when the frame was written (ref_ms)
+ *   - Records: type and device index in one byte, the timestamp as a zigzag
+ *     varint delta to the previous record (the first one to ref_ms), then the
+ *     values as zigzag varints in fixed point with a per-type/per-metric scale
+ *   - Device table: the length-prefixed device ids, appended by finish()
+ *
+ * A soil, battery or environment reading takes 8-10 bytes instead of a
+ * 28-byte struct plus its 32-byte device id, or ~90 bytes of line protocol.
+ * The first byte (SAMPLE_FRAME_MAGIC) never starts a line protocol line, so
+ * frames and text records can share one log.
+ *
+ * Usage:
+ *   sample_frame_writer_t w;
+ *   sample_frame_writer_init(&w, buf, sizeof(buf), now_ms);
+ *   sample_frame_add(&w, &rec);        // ESP_ERR_NO_MEM once the frame is full
+ *   size_t len = sample_frame_finish(&w);
+ *
+ *   sample_frame_reader_t r;
+ *   sample_frame_reader_init(&r, buf, len);
+ *   while (sample_frame_next(&r, &rec) == ESP_OK) { ... }
+ */
+
+#ifndef SAMPLE_FRAME_H
+#define SAMPLE_FRAME_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_FRAME_MAGIC          0xA5    ///< First byte of every frame
+#define SAMPLE_FRAME_VERSION        1       ///< Increment on any change of the encoding
+#define SAMPLE_FRAME_MAX_DEVICES    8       ///< Device ids one frame can reference
+#define SAMPLE_FRAME_DEVICE_ID_LEN  32      ///< Device id buffer size (including terminator)
+#define SAMPLE_FRAME_MAX_SIZE       1024    ///< Largest frame (fits a flash log record and an ESP-NOW message)
+
+/**
+ * @brief Sample types (same order as telemetry_sample_type_t)
+ */
+typedef enum {
+    SAMPLE_FRAME_SOIL = 0,
+    SAMPLE_FRAME_BATTERY,
+    SAMPLE_FRAME_ENV,
+    SAMPLE_FRAME_WINDOW,
+    SAMPLE_FRAME_TYPE_COUNT
+} sample_frame_type_t;
+
+/**
+ * @brief Frame header (packed, little endian)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t magic;                  ///< SAMPLE_FRAME_MAGIC
+    uint8_t version;                ///< SAMPLE_FRAME_VERSION
+    uint8_t device_count;           ///< Entries in the device table
+    uint16_t record_count;          ///< Records in the frame
+    uint16_t records_len;           ///< Bytes of records after the header (device table follows)
+    uint64_t ref_ms;                ///< Sender clock (ms) when the frame was written
+} sample_frame_header_t;
+
+/**
+ * @brief One decoded sample
+ *
+ * Values are quantized on encode: voltages to 1 mV, moisture, temperature and
+ * humidity to 0.01, battery percentage to 0.1, window values per metric.
+ */
+typedef struct {
+    sample_frame_type_t type;
+    const char* device_id;          ///< Device id (reader: points into the reader's table)
+    uint64_t timestamp_ms;          ///< Sample time (window: window start) on the sender clock
+    uint8_t metric;                 ///< Window: report_metric_t
+    uint32_t aux;                   ///< Soil: raw ADC, window: window length (s)
+    uint32_t count;                 ///< Window: sample count
+    float v[3];                     ///< Soil: voltage/moisture, battery: voltage/percent, env: T/RH, window: min/max/mean
+} sample_frame_record_t;
+
+/**
+ * @brief Frame writer state
+ */
+typedef struct {
+    uint8_t* buf;                   ///< Output buffer
+    size_t cap;                     ///< Buffer capacity in bytes
+    size_t len;                     ///< Header and records written so far
+    size_t table_len;               ///< Bytes the device table will take
+    uint64_t ref_ms;                ///< Clock reference written to the header
+    uint64_t last_ms;               ///< Timestamp of the previous record
+    uint16_t record_count;          ///< Records written
+    uint8_t device_count;           ///< Distinct device ids referenced
+    char device_ids[SAMPLE_FRAME_MAX_DEVICES][SAMPLE_FRAME_DEVICE_ID_LEN];
+} sample_frame_writer_t;
+
+/**
+ * @brief Frame reader state
+ */
+typedef struct {
+    const uint8_t* data;            ///< Frame being read
+    size_t pos;                     ///< Offset of the next record
+    size_t records_end;             ///< Offset of the device table
+    uint16_t remaining;             ///< Records not read yet
+    uint64_t ref_ms;                ///< Sender clock when the frame was written
+    uint64_t last_ms;               ///< Timestamp of the previous record
+    uint8_t device_count;           ///< Entries in device_ids
+    char device_ids[SAMPLE_FRAME_MAX_DEVICES][SAMPLE_FRAME_DEVICE_ID_LEN];
+} sample_frame_reader_t;
+
+/**
+ * @brief Start a frame in a buffer
+ *
+ * @param w Writer to initialize
+ * @param buf Output buffer (at most SAMPLE_FRAME_MAX_SIZE bytes are used)
+ * @param cap Buffer capacity in bytes
+ * @param ref_ms Sender clock now; record timestamps are encoded relative to it
+ */
+void sample_frame_writer_init(sample_frame_writer_t* w, uint8_t* buf, size_t cap, uint64_t ref_ms);
+
+/**
+ * @brief Append a sample
+ *
+ * @param w Writer
+ * @param rec Sample to encode
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the record or its device id
+ *         does not fit (the frame is unchanged), ESP_ERR_INVALID_ARG for an unknown type
+ */
+esp_err_t sample_frame_add(sample_frame_writer_t* w, const sample_frame_record_t* rec);
+
+/**
+ * @brief Append the device table and complete the header
+ *
+ * @param w Writer (must be initialized again before the next frame)
+ * @return Frame length in bytes, 0 if the frame holds no records
+ */
+size_t sample_frame_finish(sample_frame_writer_t* w);
+
+/**
+ * @brief Check whether a buffer starts with a frame header
+ */
+bool sample_frame_is_frame(const uint8_t* data, size_t len);
+
+/**
+ * @brief Validate a frame and load its device table
+ *
+ * @param r Reader to initialize (data must stay valid while reading)
+ * @param data Frame
+ * @param len Frame length in bytes
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_VERSION for another version,
+ *         ESP_ERR_INVALID_SIZE for a truncated or malformed frame
+ */
+esp_err_t sample_frame_reader_init(sample_frame_reader_t* r, const uint8_t* data, size_t len);
+
+/**
+ * @brief Decode the next sample
+ *
+ * @param r Reader
+ * @param rec Receives the sample (device_id points into the reader)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND after the last record,
+ *         ESP_ERR_INVALID_SIZE for a malformed record (stop reading)
+ */
+esp_err_t sample_frame_next(sample_frame_reader_t* r, sample_frame_record_t* rec);
+
+/**
+ * @brief Fixed-point scale of value v[index] of a record (the precision kept on encode)
+ *
+ * @param type Sample type
+ * @param metric Window: report_metric_t (ignored for other types)
+ * @param index Value index (0-1, windows 0-2)
+ */
+float sample_frame_scale(sample_frame_type_t type, uint8_t metric, int index);
+
+/**
+ * @brief Value in fixed point (NaN/inf map to a reserved code)
+ */
+int32_t sample_frame_quantize(float value, float scale);
+
+/**
+ * @brief Inverse of sample_frame_quantize() (the reserved code gives NAN)
+ */
+float sample_frame_dequantize(int64_t q, float scale);
+
+#endif // SAMPLE_FRAME_H
@@ -1,37 +1,31 @@
 #include "aht20.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char* TAG = "AHT20";
 
-static esp_err_t i2c_master_write_bytes(i2c_port_t port, uint8_t addr, const uint8_t* data, size_t len)
+#define AHT20_STATUS_BUSY       0x80
+#define AHT20_FRAME_LEN         7       // status + 5 data bytes + CRC
+
+// CRC-8, polynomial x^8 + x^5 + x^4 + 1 (0x31), initial value 0xFF
+static uint8_t aht20_crc8(const uint8_t* data, size_t len)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
-    if (len > 0) {
-        i2c_master_write(cmd, (uint8_t*)data, len, true);
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
     }
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+    return crc;
 }
 
-static esp_err_t i2c_master_read_bytes(i2c_port_t port, uint8_t addr, uint8_t* data, size_t len)
+static void aht20_delay_us(int64_t us)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
-    if (len > 1) {
-        i2c_master_read(cmd, data, len - 1, I2C_MASTER_ACK);
-    }
-    i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+    TickType_t ticks = pdMS_TO_TICKS((us + 999) / 1000);
+    vTaskDelay(ticks > 0 ? ticks : 1);
 }
 
 esp_err_t aht20_init(aht20_t* dev, i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_speed_hz)
@@ -42,43 +36,61 @@ esp_err_t aht20_init(aht20_t* dev, i2c_port_t port, gpio_num_t sda, gpio_num_t s
     dev->sda_io = sda;
     dev->scl_io = scl;
     dev->clk_speed_hz = clk_speed_hz;
+    dev->i2c.handle = NULL;
+    dev->measuring = false;
     dev->initialized = false;
 
-    // Configure I2C
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = sda,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_io_num = scl,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = clk_speed_hz,
-        .clk_flags = 0,
-    };
+    // Join the shared bus and attach the sensor
+    esp_err_t ret = i2c_shared_init(port, sda, scl, clk_speed_hz);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
-    ESP_ERROR_CHECK(i2c_param_config(port, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(port, conf.mode, 0, 0, 0));
+    ret = i2c_shared_add_device(port, AHT20_I2C_ADDR, clk_speed_hz, &dev->i2c);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Adding device failed: %s", esp_err_to_name(ret));
+        i2c_shared_deinit(port);
+        return ret;
+    }
+
+    // Trigger measurement: 0xAC 0x33 0x00
+    dev->trigger_cmd[0] = 0xAC;
+    dev->trigger_cmd[1] = 0x33;
+    dev->trigger_cmd[2] = 0x00;
+    dev->trigger = (i2c_shared_transfer_t) {
+        .dev = &dev->i2c,
+        .write_buf = dev->trigger_cmd,
+        .write_len = sizeof(dev->trigger_cmd),
+    };
 
     // Soft reset
     uint8_t soft_reset = 0xBA;
-    esp_err_t ret = i2c_master_write_bytes(port, AHT20_I2C_ADDR, &soft_reset, 1);
+    ret = i2c_shared_transfer(&dev->i2c, &soft_reset, 1, NULL, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Soft reset failed: %s", esp_err_to_name(ret));
-        return ret;
+        goto fail;
     }
     vTaskDelay(pdMS_TO_TICKS(20));
 
     // Initialization/calibration command: 0xBE 0x08 0x00
     uint8_t init_cmd[3] = {0xBE, 0x08, 0x00};
-    ret = i2c_master_write_bytes(port, AHT20_I2C_ADDR, init_cmd, sizeof(init_cmd));
+    ret = i2c_shared_transfer(&dev->i2c, init_cmd, sizeof(init_cmd), NULL, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Init command failed: %s", esp_err_to_name(ret));
-        return ret;
+        goto fail;
     }
     vTaskDelay(pdMS_TO_TICKS(10));
 
     dev->initialized = true;
-    ESP_LOGI(TAG, "AHT20 initialized on I2C%d SDA=%d SCL=%d", port, sda, scl);
+    ESP_LOGI(TAG, "AHT20 initialized on I2C%d SDA=%d SCL=%d (%lu Hz)", port, sda, scl,
+             (unsigned long)dev->i2c.scl_speed_hz);
     return ESP_OK;
+
+fail:
+    i2c_shared_remove_device(&dev->i2c);
+    i2c_shared_deinit(port);
+    return ret;
 }
 
 esp_err_t aht20_deinit(aht20_t* dev)
@@ -86,43 +98,104 @@ esp_err_t aht20_deinit(aht20_t* dev)
     if (!dev) return ESP_ERR_INVALID_ARG;
     if (!dev->initialized) return ESP_OK;
     dev->initialized = false;
-    i2c_driver_delete(dev->i2c_port);
-    return ESP_OK;
+    dev->measuring = false;
+    i2c_shared_remove_device(&dev->i2c);
+    return i2c_shared_deinit(dev->i2c_port);
 }
 
-esp_err_t aht20_read(aht20_t* dev, float* temperature_c, float* humidity_rh)
+esp_err_t aht20_start_measurement(aht20_t* dev)
 {
     if (!dev || !dev->initialized) return ESP_ERR_INVALID_STATE;
 
-    // Trigger measurement: 0xAC 0x33 0x00
-    uint8_t trig_cmd[3] = {0xAC, 0x33, 0x00};
-    esp_err_t ret = i2c_master_write_bytes(dev->i2c_port, AHT20_I2C_ADDR, trig_cmd, sizeof(trig_cmd));
+    esp_err_t ret = i2c_shared_transfer_batch(&dev->trigger, 1);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Trigger measurement failed: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Wait for measurement to complete (~80ms)
-    vTaskDelay(pdMS_TO_TICKS(85));
+    dev->measure_start_us = esp_timer_get_time();
+    dev->measuring = true;
+    return ESP_OK;
+}
 
-    // Read 6 bytes: status + 5 data bytes
-    uint8_t buf[6] = {0};
-    ret = i2c_master_read_bytes(dev->i2c_port, AHT20_I2C_ADDR, buf, sizeof(buf));
+esp_err_t aht20_queue_measurement(aht20_t* dev)
+{
+    if (!dev || !dev->initialized) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = i2c_shared_queue(&dev->trigger);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Read failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Queueing trigger failed: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Check busy bit
-    if (buf[0] & 0x80) {
-        ESP_LOGW(TAG, "Sensor busy after wait");
-        // Optionally wait a bit more and re-read
-        vTaskDelay(pdMS_TO_TICKS(20));
-        ret = i2c_master_read_bytes(dev->i2c_port, AHT20_I2C_ADDR, buf, sizeof(buf));
-        if (ret != ESP_OK) return ret;
-        if (buf[0] & 0x80) return ESP_ERR_TIMEOUT;
+    // The flush follows within the same scheduler pass, so count the conversion from here
+    dev->measure_start_us = esp_timer_get_time();
+    dev->measuring = true;
+    return ESP_OK;
+}
+
+esp_err_t aht20_fetch_result(aht20_t* dev, float* temperature_c, float* humidity_rh, uint32_t timeout_ms)
+{
+    if (!dev || !dev->initialized || !dev->measuring) return ESP_ERR_INVALID_STATE;
+
+    if (dev->trigger.result != ESP_OK) {
+        // Queued trigger failed or was never flushed: no conversion is running
+        esp_err_t err = (dev->trigger.result == ESP_ERR_NOT_FINISHED) ? ESP_ERR_INVALID_STATE : dev->trigger.result;
+        ESP_LOGE(TAG, "Trigger measurement failed: %s", esp_err_to_name(err));
+        dev->measuring = false;
+        return err;
+    }
+
+    int64_t first_poll_us = dev->measure_start_us + (int64_t)AHT20_MEASURE_MIN_MS * 1000;
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    esp_err_t ret;
+
+    // Poll the busy bit instead of sleeping for the worst-case conversion time
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (now >= first_poll_us) {
+            uint8_t status = 0;
+            ret = i2c_shared_transfer(&dev->i2c, NULL, 0, &status, 1);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Status read failed: %s", esp_err_to_name(ret));
+                dev->measuring = false;
+                return ret;
+            }
+            if (!(status & AHT20_STATUS_BUSY)) {
+                break;
+            }
+            if (now - dev->measure_start_us > (int64_t)AHT20_MEASURE_TIMEOUT_MS * 1000) {
+                ESP_LOGW(TAG, "Sensor still busy after %d ms", AHT20_MEASURE_TIMEOUT_MS);
+                dev->measuring = false;
+                return ESP_ERR_TIMEOUT;
+            }
+        }
+        if (now >= deadline_us) {
+            return ESP_ERR_NOT_FINISHED;
+        }
+
+        int64_t wait_us = (now < first_poll_us) ? first_poll_us - now : AHT20_POLL_INTERVAL_MS * 1000;
+        if (now + wait_us > deadline_us) {
+            wait_us = deadline_us - now;
+        }
+        aht20_delay_us(wait_us);
+    }
+
+    // Read 7 bytes: status + 5 data bytes + CRC
+    uint8_t buf[AHT20_FRAME_LEN] = {0};
+    dev->measuring = false;
+    ret = i2c_shared_transfer(&dev->i2c, NULL, 0, buf, sizeof(buf));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Read failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (aht20_crc8(buf, AHT20_FRAME_LEN - 1) != buf[AHT20_FRAME_LEN - 1]) {
+        ESP_LOGW(TAG, "CRC mismatch, discarding sample");
+        return ESP_ERR_INVALID_CRC;
     }
 
+    ESP_LOGD(TAG, "Conversion took %lld us", (long long)(esp_timer_get_time() - dev->measure_start_us));
+
     // Parse 20-bit humidity and temperature per datasheet
     uint32_t humidity_raw = ((uint32_t)buf[1] << 12) | ((uint32_t)buf[2] << 4) | ((uint32_t)buf[3] >> 4);
     uint32_t temperature_raw = (((uint32_t)buf[3] & 0x0F) << 16) | ((uint32_t)buf[4] << 8) | (uint32_t)buf[5];
@@ -135,3 +208,42 @@ esp_err_t aht20_read(aht20_t* dev, float* temperature_c, float* humidity_rh)
 
     return ESP_OK;
 }
+
+esp_err_t aht20_read(aht20_t* dev, float* temperature_c, float* humidity_rh)
+{
+    esp_err_t ret = aht20_start_measurement(dev);
+    if (ret != ESP_OK) return ret;
+    return aht20_fetch_result(dev, temperature_c, humidity_rh, AHT20_MEASURE_TIMEOUT_MS);
+}
+
+static esp_err_t aht20_hal_start(void* ctx)
+{
+    aht20_t* dev = (aht20_t*)ctx;
+    return dev->measuring ? ESP_OK : aht20_queue_measurement(dev);
+}
+
+static esp_err_t aht20_hal_read(void* ctx, sensor_hal_reading_t* reading)
+{
+    esp_err_t ret = aht20_fetch_result((aht20_t*)ctx, &reading->values[0], &reading->values[1],
+                                       AHT20_MEASURE_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    reading->count = 2;
+    reading->raw = 0;
+    return ESP_OK;
+}
+
+static const sensor_hal_ops_t s_hal_ops = {
+    .prepare = NULL,            // Always powered, idles between conversions
+    .start_conversion = aht20_hal_start,
+    .read = aht20_hal_read,
+    .power_down = NULL,
+};
+
+void aht20_get_sensor_hal(aht20_t* dev, sensor_hal_t* hal)
+{
+    hal->name = "aht20";
+    hal->ops = &s_hal_ops;
+    hal->ctx = dev;
+    hal->warmup_ms = 0;
+    hal->conversion_ms = AHT20_MEASURE_TYPICAL_MS;
+}
@@ -2,8 +2,10 @@
 #define AHT20_H
 
 #include "esp_err.h"
-#include "driver/i2c.h"
+#include "i2c_manager.h"
+#include "sensor_hal.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,29 +13,69 @@ extern "C" {
 
 #define AHT20_I2C_ADDR         0x38
 
+#define AHT20_MEASURE_MIN_MS       40   // No status polling before this (typical conversion ~75 ms)
+#define AHT20_MEASURE_TYPICAL_MS   80   // Latency hint for the sensor interface
+#define AHT20_POLL_INTERVAL_MS     5    // Busy-bit polling period
+#define AHT20_MEASURE_TIMEOUT_MS   150  // Give up on a conversion after this
+
 typedef struct {
     i2c_port_t i2c_port;
     gpio_num_t sda_io;
     gpio_num_t scl_io;
     uint32_t clk_speed_hz;
+    i2c_shared_device_t i2c;        // Device on the shared bus
+    i2c_shared_transfer_t trigger;  // Trigger command, queued by aht20_queue_measurement()
+    uint8_t trigger_cmd[3];
+    int64_t measure_start_us;   // Time the pending conversion was triggered
+    bool measuring;             // A conversion was triggered and not fetched yet
     bool initialized;
 } aht20_t;
 
 /**
- * Initialize I2C and AHT20 sensor (soft reset + init/calibration)
+ * Attach the AHT20 to the shared I2C bus (created if this is its first user)
+ * and initialize it (soft reset + init/calibration)
  */
 esp_err_t aht20_init(aht20_t* dev, i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_speed_hz);
 
 /**
- * Deinitialize I2C for this device (does not uninstall shared bus if shared elsewhere)
+ * Remove the device and release the shared I2C bus
  */
 esp_err_t aht20_deinit(aht20_t* dev);
 
 /**
- * Trigger measurement and read temperature (C) and humidity (%RH)
+ * Trigger a conversion and return immediately; collect it with aht20_fetch_result()
+ */
+esp_err_t aht20_start_measurement(aht20_t* dev);
+
+/**
+ * Queue the conversion trigger on the shared bus and return; the trigger is sent
+ * by the next i2c_shared_flush() of the port, together with the transfers other
+ * devices queued. Collect the conversion with aht20_fetch_result().
+ */
+esp_err_t aht20_queue_measurement(aht20_t* dev);
+
+/**
+ * Collect the pending conversion, waiting up to timeout_ms for the busy bit to clear.
+ * Returns ESP_ERR_NOT_FINISHED if still busy after timeout_ms (call again later),
+ * ESP_ERR_TIMEOUT if the conversion exceeded AHT20_MEASURE_TIMEOUT_MS,
+ * ESP_ERR_INVALID_CRC if the data failed its CRC check, or the error of a queued
+ * trigger that failed (ESP_ERR_INVALID_STATE if it was never flushed).
+ */
+esp_err_t aht20_fetch_result(aht20_t* dev, float* temperature_c, float* humidity_rh, uint32_t timeout_ms);
+
+/**
+ * Trigger measurement and read temperature (C) and humidity (%RH), blocking until done
  */
 esp_err_t aht20_read(aht20_t* dev, float* temperature_c, float* humidity_rh);
 
+/**
+ * Describe the sensor through the generic sensor interface (dev must outlive hal).
+ * A conversion already triggered with aht20_start_measurement() is reused;
+ * otherwise start_conversion queues the trigger on the shared bus.
+ * Reading values: [0] temperature (C), [1] humidity (%RH).
+ */
+void aht20_get_sensor_hal(aht20_t* dev, sensor_hal_t* hal);
+
 #ifdef __cplusplus
 }
 #endif
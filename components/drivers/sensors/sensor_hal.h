@@ -0,0 +1,58 @@
+/**
+ * @file sensor_hal.h
+ * @brief Generic Sensor Interface
+ *
+ * A measurement is split into four steps so one task can interleave many
+ * sensors instead of blocking in each one's warm-up:
+ *   prepare()          - power the sensor up, then wait warmup_ms
+ *   start_conversion() - trigger a conversion, then wait conversion_ms
+ *   read()             - fetch the result
+ *   power_down()       - remove power until the next measurement
+ *
+ * start_conversion() of an I2C sensor may queue its trigger with
+ * i2c_shared_queue() instead of sending it; the scheduler flushes the bus
+ * once after all steps due at the same instant.
+ *
+ * Steps a sensor does not need are NULL. The latency hints let the scheduler
+ * start slow sensors first, so readings taken in one pass finish together.
+ */
+
+#ifndef SENSOR_HAL_H
+#define SENSOR_HAL_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define SENSOR_HAL_MAX_VALUES   3       ///< Values one reading can carry
+
+/**
+ * @brief One reading (value order is defined by the driver)
+ */
+typedef struct {
+    float values[SENSOR_HAL_MAX_VALUES];    ///< Converted values
+    uint8_t count;                          ///< Valid entries in values
+    int32_t raw;                            ///< Raw converter value (0 if none)
+} sensor_hal_reading_t;
+
+/**
+ * @brief Measurement steps (NULL: step not needed)
+ */
+typedef struct {
+    esp_err_t (*prepare)(void* ctx);                                ///< Power up
+    esp_err_t (*start_conversion)(void* ctx);                       ///< Trigger a conversion
+    esp_err_t (*read)(void* ctx, sensor_hal_reading_t* reading);    ///< Fetch the result (required)
+    esp_err_t (*power_down)(void* ctx);                             ///< Power down
+} sensor_hal_ops_t;
+
+/**
+ * @brief Sensor instance
+ */
+typedef struct {
+    const char* name;                   ///< Short name for logs
+    const sensor_hal_ops_t* ops;        ///< Measurement steps
+    void* ctx;                          ///< Driver handle passed to every step
+    uint32_t warmup_ms;                 ///< Settling time after prepare()
+    uint32_t conversion_ms;             ///< Typical time from start_conversion() to a valid read()
+} sensor_hal_t;
+
+#endif // SENSOR_HAL_H
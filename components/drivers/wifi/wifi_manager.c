@@ -5,9 +5,14 @@
 
 #include "config/esp32-config.h"
 #include "wifi_manager.h"
+#include "perf_profiler.h"
 
 #include <string.h>
+#include <time.h>
 #include "nvs_flash.h"
+#include "esp_attr.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
 #include "freertos/task.h"
 
 static const char *TAG = WIFI_MANAGER_TAG;
@@ -20,9 +25,43 @@ static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 static esp_netif_t *s_sta_netif = NULL;
 
+// ============================================================================
+// Fast-connect cache (survives deep sleep)
+// ============================================================================
+
+#define WIFI_FAST_CACHE_MAGIC   0x57464331  // "WFC1"
+
+/**
+ * @brief Last successful association, reused on the next wake
+ */
+typedef struct {
+    uint32_t magic;                 ///< WIFI_FAST_CACHE_MAGIC when valid
+    char ssid[33];                  ///< SSID the entry belongs to
+    uint8_t bssid[6];               ///< Access point MAC
+    uint8_t channel;                ///< Primary channel
+    bool has_lease;                 ///< ip/gw/netmask/dns hold a DHCP lease
+    esp_netif_ip_info_t ip_info;    ///< Leased address
+    esp_ip4_addr_t dns;             ///< Leased DNS server
+    time_t lease_time;              ///< When the lease was obtained (RTC-backed system time)
+} wifi_fast_cache_t;
+
+static RTC_DATA_ATTR wifi_fast_cache_t s_fast_cache;
+static bool s_fast_attempt = false;         // Current attempt uses the cache
+static bool s_dhcp_stopped = false;         // Address configured statically for this attempt
+static esp_netif_ip_info_t s_static_ip;     // Applied once the station has associated
+static esp_ip4_addr_t s_static_dns;
+static bool s_associated = false;           // Between STA_CONNECTED and STA_DISCONNECTED
+static esp_timer_handle_t s_fast_timer = NULL;
+
 // Internal function declarations
 static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 static void update_status(wifi_status_t new_status, const char* ip_addr);
+static bool fast_cache_valid(void);
+static void fast_cache_store(const esp_netif_ip_info_t* ip_info);
+static void prepare_static_ip(const esp_netif_ip_info_t* ip_info, const esp_ip4_addr_t* dns);
+static void apply_static_ip(void);
+static void fall_back_to_full_scan(void);
+static void fast_timeout_cb(void* arg);
 
 esp_err_t wifi_manager_init(const wifi_manager_config_t* config, wifi_status_callback_t callback)
 {
@@ -54,6 +93,15 @@ esp_err_t wifi_manager_init(const wifi_manager_config_t* config, wifi_status_cal
     // Reduce WiFi driver verbosity
     esp_log_level_set("wifi", ESP_LOG_WARN);
 
+    // Keep the driver state in RAM only: the fast-connect cache lives in RTC memory
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = fast_timeout_cb,
+        .name = "wifi_fast",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_fast_timer));
+
     // Register event handlers
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                        ESP_EVENT_ANY_ID,
@@ -71,6 +119,15 @@ esp_err_t wifi_manager_init(const wifi_manager_config_t* config, wifi_status_cal
 }
 
 esp_err_t wifi_manager_connect(void)
+{
+    esp_err_t ret = wifi_manager_connect_start();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return wifi_manager_wait_for_connection(WIFI_CONNECT_TIMEOUT_MS);
+}
+
+esp_err_t wifi_manager_connect_start(void)
 {
     wifi_config_t wifi_config = {
         .sta = {
@@ -85,23 +142,77 @@ esp_err_t wifi_manager_connect(void)
     // Copy SSID and password
     strcpy((char*)wifi_config.sta.ssid, s_wifi_config.ssid);
     strcpy((char*)wifi_config.sta.password, s_wifi_config.password);
+    wifi_config.sta.listen_interval = s_wifi_config.listen_interval;
 
     // Reset retry counter
     s_retry_num = 0;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+
+    // Fast path: skip the scan by targeting the AP and channel of the last wake
+    s_fast_attempt = WIFI_FAST_CONNECT_ENABLED && fast_cache_valid();
+    if (s_fast_attempt) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_fast_cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = s_fast_cache.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        ESP_LOGI(TAG, "Fast connect to " MACSTR " on channel %d",
+                 MAC2STR(s_fast_cache.bssid), s_fast_cache.channel);
+    }
+
+    // Skip DHCP with a configured static address or the cached lease (set on association)
+    s_associated = false;
+#if WIFI_STATIC_IP_ENABLED
+    esp_netif_ip_info_t static_ip = {0};
+    esp_ip4_addr_t static_dns = {0};
+    static_ip.ip.addr = esp_ip4addr_aton(WIFI_STATIC_IP);
+    static_ip.gw.addr = esp_ip4addr_aton(WIFI_STATIC_GATEWAY);
+    static_ip.netmask.addr = esp_ip4addr_aton(WIFI_STATIC_NETMASK);
+    static_dns.addr = esp_ip4addr_aton(WIFI_STATIC_DNS);
+    prepare_static_ip(&static_ip, &static_dns);
+#else
+    // Reuse the lease only while it is young; afterwards renew it with a normal DHCP exchange
+    if (s_fast_attempt && s_fast_cache.has_lease &&
+        time(NULL) - s_fast_cache.lease_time < WIFI_FAST_LEASE_MAX_AGE_S) {
+        prepare_static_ip(&s_fast_cache.ip_info, &s_fast_cache.dns);
+    } else if (s_dhcp_stopped) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_dhcp_stopped = false;
+    }
+#endif
     
     // Set WiFi mode and configuration
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
     
     update_status(WIFI_STATUS_CONNECTING, NULL);
+    perf_phase_begin(PERF_PHASE_WIFI);      // Ends on GOT_IP
+    ESP_ERROR_CHECK(esp_wifi_start());
+    
+    // Minimum modem sleep (DTIM) keeps a short wake responsive; max modem sleep lets a
+    // continuously running node stay associated between cycles at a fraction of the current
+    esp_wifi_set_ps(s_wifi_config.power_save ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
+
+    if (s_fast_attempt) {
+        esp_timer_start_once(s_fast_timer, (uint64_t)WIFI_FAST_CONNECT_TIMEOUT_MS * 1000ULL);
+    }
+
+    // Association and DHCP continue in the event handler
+    return ESP_OK;
+}
+
+esp_err_t wifi_manager_wait_for_connection(uint32_t timeout_ms)
+{
+    if (s_wifi_event_group == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     // Wait for connection or failure
+    TickType_t wait = (timeout_ms > 0) ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY;
     EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
                                            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
                                            pdFALSE,
                                            pdFALSE,
-                                           portMAX_DELAY);
+                                           wait);
 
     if (bits & WIFI_CONNECTED_BIT) {
         return ESP_OK;
@@ -120,8 +231,19 @@ esp_err_t wifi_manager_disconnect(void)
     return ESP_OK;
 }
 
+void wifi_manager_forget_fast_connect(void)
+{
+    memset(&s_fast_cache, 0, sizeof(s_fast_cache));
+}
+
 esp_err_t wifi_manager_deinit(void)
 {
+    if (s_fast_timer != NULL) {
+        esp_timer_stop(s_fast_timer);
+        esp_timer_delete(s_fast_timer);
+        s_fast_timer = NULL;
+    }
+
     esp_wifi_stop();
     esp_wifi_deinit();
     
@@ -145,6 +267,11 @@ bool wifi_manager_is_connected(void)
     return s_current_status == WIFI_STATUS_CONNECTED;
 }
 
+bool wifi_manager_is_connecting_or_connected(void)
+{
+    return s_current_status == WIFI_STATUS_CONNECTED || s_current_status == WIFI_STATUS_CONNECTING;
+}
+
 esp_err_t wifi_manager_get_ip(char* ip_str)
 {
     if (!wifi_manager_is_connected()) {
@@ -165,10 +292,24 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         ESP_LOGI(TAG, "WiFi station started, attempting connection...");
         esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        // Setting the address posts GOT_IP, so a static one is only set once associated
+        s_associated = true;
+        if (s_dhcp_stopped) {
+            apply_static_ip();
+        }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         wifi_event_sta_disconnected_t* disconnected = (wifi_event_sta_disconnected_t*) event_data;
+        s_associated = false;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         
         ESP_LOGW(TAG, "WiFi disconnected - Reason: %d", disconnected->reason);
+
+        if (s_fast_attempt) {
+            // Cached AP did not answer (or timed out): rescan right away, do not count as a retry
+            fall_back_to_full_scan();
+            return;
+        }
         
         // Handle different disconnection reasons
         switch(disconnected->reason) {
@@ -203,10 +344,20 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        if (!s_associated) {
+            ESP_LOGD(TAG, "Address set before association, waiting for the AP");
+            return;
+        }
         char ip_str[WIFI_IP_STRING_MAX_LEN];
         sprintf(ip_str, IPSTR, IP2STR(&event->ip_info.ip));
         
         s_retry_num = 0;
+        if (s_fast_attempt) {
+            esp_timer_stop(s_fast_timer);
+            s_fast_attempt = false;
+        }
+        fast_cache_store(&event->ip_info);
+        perf_phase_end(PERF_PHASE_WIFI);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         update_status(WIFI_STATUS_CONNECTED, ip_str);
         ESP_LOGI(TAG, "WiFi connected successfully! IP: %s", ip_str);
@@ -221,4 +372,107 @@ static void update_status(wifi_status_t new_status, const char* ip_addr)
             s_status_callback(new_status, ip_addr);
         }
     }
-}
\ No newline at end of file
+}
+
+static bool fast_cache_valid(void)
+{
+    return s_fast_cache.magic == WIFI_FAST_CACHE_MAGIC &&
+           strncmp(s_fast_cache.ssid, s_wifi_config.ssid, sizeof(s_fast_cache.ssid)) == 0 &&
+           s_fast_cache.channel != 0;
+}
+
+static void fast_cache_store(const esp_netif_ip_info_t* ip_info)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+
+    strncpy(s_fast_cache.ssid, s_wifi_config.ssid, sizeof(s_fast_cache.ssid) - 1);
+    s_fast_cache.ssid[sizeof(s_fast_cache.ssid) - 1] = '\0';
+    memcpy(s_fast_cache.bssid, ap.bssid, sizeof(s_fast_cache.bssid));
+    s_fast_cache.channel = ap.primary;
+
+    // Remember the DHCP lease so the next wake can skip DHCP
+    s_fast_cache.has_lease = false;
+    if (!s_dhcp_stopped && ip_info != NULL) {
+        esp_netif_dns_info_t dns;
+        s_fast_cache.ip_info = *ip_info;
+        if (esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+            s_fast_cache.dns = dns.ip.u_addr.ip4;
+        } else {
+            s_fast_cache.dns = ip_info->gw;
+        }
+        s_fast_cache.lease_time = time(NULL);
+        s_fast_cache.has_lease = true;
+    } else if (s_dhcp_stopped && s_fast_cache.magic == WIFI_FAST_CACHE_MAGIC) {
+        s_fast_cache.has_lease = !WIFI_STATIC_IP_ENABLED;     // Cached lease just worked again
+    }
+    s_fast_cache.magic = WIFI_FAST_CACHE_MAGIC;
+}
+
+// Stop DHCP for this attempt; the address itself is set in apply_static_ip() on association
+static void prepare_static_ip(const esp_netif_ip_info_t* ip_info, const esp_ip4_addr_t* dns)
+{
+    esp_err_t ret = esp_netif_dhcpc_stop(s_sta_netif);
+    if (ret != ESP_OK && ret != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        ESP_LOGW(TAG, "Failed to stop DHCP client: %s", esp_err_to_name(ret));
+        return;
+    }
+    s_static_ip = *ip_info;
+    s_static_dns = *dns;
+    s_dhcp_stopped = true;
+}
+
+static void apply_static_ip(void)
+{
+    if (esp_netif_set_ip_info(s_sta_netif, &s_static_ip) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set static IP, using DHCP");
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_dhcp_stopped = false;
+        return;
+    }
+
+    esp_netif_dns_info_t dns_info = {0};
+    dns_info.ip.type = ESP_IPADDR_TYPE_V4;
+    dns_info.ip.u_addr.ip4 = s_static_dns;
+    esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+
+    ESP_LOGI(TAG, "Using static IP " IPSTR " (DHCP skipped)", IP2STR(&s_static_ip.ip));
+}
+
+static void fall_back_to_full_scan(void)
+{
+    ESP_LOGW(TAG, "Fast connect failed, falling back to full scan");
+    esp_timer_stop(s_fast_timer);
+    s_fast_attempt = false;
+    wifi_manager_forget_fast_connect();
+
+    wifi_config_t wifi_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+        wifi_config.sta.bssid_set = false;
+        wifi_config.sta.channel = 0;
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+
+#if !WIFI_STATIC_IP_ENABLED
+    // The cached lease may be stale as well
+    if (s_dhcp_stopped) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_dhcp_stopped = false;
+    }
+#endif
+
+    update_status(WIFI_STATUS_CONNECTING, NULL);
+    esp_wifi_connect();
+}
+
+static void fast_timeout_cb(void* arg)
+{
+    if (s_fast_attempt && !wifi_manager_is_connected()) {
+        ESP_LOGW(TAG, "Fast connect timed out after %d ms", WIFI_FAST_CONNECT_TIMEOUT_MS);
+        // Handled as a disconnect in the event handler
+        esp_wifi_disconnect();
+    }
+}
@@ -4,6 +4,12 @@
  * 
  * This module handles WiFi connectivity including connection, reconnection,
  * and status monitoring.
+ *
+ * Fast connect: the BSSID, channel and DHCP lease of the last successful
+ * association are kept in RTC memory. The next wake connects directly to that
+ * AP without scanning and reuses the address without DHCP. If the cached AP
+ * does not answer within WIFI_FAST_CONNECT_TIMEOUT_MS the manager falls back
+ * to a full scan with DHCP.
  */
 
 #ifndef WIFI_MANAGER_H
@@ -39,6 +45,8 @@ typedef struct {
     char ssid[32];
     char password[64];
     int max_retry;
+    bool power_save;        ///< Max modem sleep: wake for every listen_interval-th beacon (continuous operation)
+    uint8_t listen_interval; ///< Beacon intervals between wakes with power_save (0 = driver default)
 } wifi_manager_config_t;
 
 /**
@@ -59,12 +67,35 @@ typedef void (*wifi_status_callback_t)(wifi_status_t status, const char* ip_addr
 esp_err_t wifi_manager_init(const wifi_manager_config_t* config, wifi_status_callback_t callback);
 
 /**
- * @brief Start WiFi connection
+ * @brief Start WiFi connection and wait until it succeeds or fails
  * 
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
 esp_err_t wifi_manager_connect(void);
 
+/**
+ * @brief Start WiFi connection without waiting
+ * 
+ * Association and DHCP run in the background; use wifi_manager_wait_for_connection()
+ * or the status callback to learn the result.
+ * 
+ * @return esp_err_t ESP_OK if the connection attempt was started
+ */
+esp_err_t wifi_manager_connect_start(void);
+
+/**
+ * @brief Wait for a started connection attempt to finish
+ * 
+ * @param timeout_ms Maximum wait time (0 = wait forever)
+ * @return esp_err_t ESP_OK if connected, ESP_FAIL if all retries failed, ESP_ERR_TIMEOUT
+ */
+esp_err_t wifi_manager_wait_for_connection(uint32_t timeout_ms);
+
+/**
+ * @brief Drop the cached AP/IP so the next connect does a full scan and DHCP
+ */
+void wifi_manager_forget_fast_connect(void);
+
 /**
  * @brief Stop WiFi connection
  * 
@@ -93,6 +124,13 @@ wifi_status_t wifi_manager_get_status(void);
  */
 bool wifi_manager_is_connected(void);
 
+/**
+ * @brief Check if WiFi is connected or a connection attempt is still running
+ * 
+ * @return true if data queued now can still be sent in this cycle
+ */
+bool wifi_manager_is_connecting_or_connected(void);
+
 /**
  * @brief Get current IP address
  * 
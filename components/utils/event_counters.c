@@ -0,0 +1,72 @@
+/**
+ * @file event_counters.c
+ * @brief Per-Cycle Event Counters - Implementation
+ */
+
+#include "event_counters.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+static atomic_uint_fast32_t s_counters[EVT_COUNTER_COUNT];
+
+static const char* const s_counter_names[EVT_COUNTER_COUNT] = {
+    [EVT_INFLUX_POST]       = "influx_post",
+    [EVT_INFLUX_POST_FAIL]  = "influx_fail",
+    [EVT_INFLUX_BYTES]      = "influx_bytes",
+    [EVT_MQTT_PUBLISH]      = "mqtt_pub",
+    [EVT_ESPNOW_RX_FRAME]   = "espnow_rx",
+    [EVT_ESPNOW_RX_BYTES]   = "espnow_rx_bytes",
+    [EVT_ESPNOW_TX_MSG]     = "espnow_tx",
+    [EVT_DISPLAY_PRIMITIVE] = "draw",
+    [EVT_DISPLAY_REFRESH]   = "refresh",
+    [EVT_SAMPLE]            = "samples",
+};
+
+void event_counter_add(evt_counter_t counter, uint32_t n)
+{
+    if (counter < EVT_COUNTER_COUNT) {
+        atomic_fetch_add_explicit(&s_counters[counter], n, memory_order_relaxed);
+    }
+}
+
+uint32_t event_counter_get(evt_counter_t counter)
+{
+    if (counter >= EVT_COUNTER_COUNT) {
+        return 0;
+    }
+    return (uint32_t)atomic_load_explicit(&s_counters[counter], memory_order_relaxed);
+}
+
+void event_counters_report(const char* tag)
+{
+    char line[256];
+    size_t len = 0;
+
+    for (int c = 0; c < EVT_COUNTER_COUNT; c++) {
+        uint32_t value = (uint32_t)atomic_exchange_explicit(&s_counters[c], 0, memory_order_relaxed);
+        if (value == 0 || len >= sizeof(line)) {
+            continue;
+        }
+        int n = snprintf(line + len, sizeof(line) - len, "%s%s=%lu",
+                         len ? " " : "", s_counter_names[c], (unsigned long)value);
+        if (n > 0) {
+            len += (size_t)n;
+        }
+    }
+
+    if (len > 0) {
+        ESP_LOGI(tag, "Events: %s", line);
+    }
+}
+
+void event_counters_reset(void)
+{
+    for (int c = 0; c < EVT_COUNTER_COUNT; c++) {
+        atomic_store_explicit(&s_counters[c], 0, memory_order_relaxed);
+    }
+}
+
+const char* event_counter_name(evt_counter_t counter)
+{
+    return (counter < EVT_COUNTER_COUNT) ? s_counter_names[counter] : "unknown";
+}
@@ -0,0 +1,92 @@
+/**
+ * @file event_counters.h
+ * @brief Per-Cycle Event Counters and Hot-Path Logging
+ *
+ * Hot paths (HTTP posts, display primitives, ESP-NOW frames, samples) count
+ * their events here instead of logging each one. The counts are logged as a
+ * single line once per cycle and then cleared.
+ *
+ * EVT_LOGI/EVT_LOGD are used for the per-event log lines that remain. With
+ * CONFIG_APP_LOG_PRODUCTION they compile to nothing, arguments included, so
+ * the format strings and UART time are gone from production builds.
+ */
+
+#ifndef EVENT_COUNTERS_H
+#define EVENT_COUNTERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+// Kconfig driven setting (menuconfig → Logging), fallback default if not defined
+#ifndef CONFIG_APP_LOG_PRODUCTION
+#define CONFIG_APP_LOG_PRODUCTION 0
+#endif
+
+#if CONFIG_APP_LOG_PRODUCTION
+#define EVT_LOGI(tag, format, ...)  do { } while (0)
+#define EVT_LOGD(tag, format, ...)  do { } while (0)
+#else
+#define EVT_LOGI(tag, format, ...)  ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define EVT_LOGD(tag, format, ...)  ESP_LOGD(tag, format, ##__VA_ARGS__)
+#endif
+
+/**
+ * @brief Counted events
+ */
+typedef enum {
+    EVT_INFLUX_POST = 0,        ///< InfluxDB write requests sent
+    EVT_INFLUX_POST_FAIL,       ///< InfluxDB write requests without a 2xx answer
+    EVT_INFLUX_BYTES,           ///< Request body bytes sent to InfluxDB
+    EVT_MQTT_PUBLISH,           ///< MQTT messages handed to the client
+    EVT_ESPNOW_RX_FRAME,        ///< ESP-NOW frames accepted by the RX task
+    EVT_ESPNOW_RX_BYTES,        ///< ESP-NOW payload bytes received
+    EVT_ESPNOW_TX_MSG,          ///< ESP-NOW messages sent (all chunks acked)
+    EVT_DISPLAY_PRIMITIVE,      ///< Text/line/indicator primitives drawn
+    EVT_DISPLAY_REFRESH,        ///< E-paper refreshes started
+    EVT_SAMPLE,                 ///< Samples published on the telemetry bus
+    EVT_COUNTER_COUNT
+} evt_counter_t;
+
+/**
+ * @brief Add to a counter (any task, lock free)
+ *
+ * @param counter Counter to increase (ignored if out of range)
+ * @param n Amount to add
+ */
+void event_counter_add(evt_counter_t counter, uint32_t n);
+
+/**
+ * @brief Increase a counter by one
+ */
+static inline void event_counter_inc(evt_counter_t counter)
+{
+    event_counter_add(counter, 1);
+}
+
+/**
+ * @brief Current value of a counter
+ */
+uint32_t event_counter_get(evt_counter_t counter);
+
+/**
+ * @brief Log all non-zero counters as one line and clear them
+ *
+ * Call once per cycle. Nothing is logged if no event was counted.
+ *
+ * @param tag Log tag of the caller
+ */
+void event_counters_report(const char* tag);
+
+/**
+ * @brief Clear all counters
+ */
+void event_counters_reset(void);
+
+/**
+ * @brief Short snake_case name of a counter
+ */
+const char* event_counter_name(evt_counter_t counter);
+
+#endif // EVENT_COUNTERS_H
@@ -0,0 +1,244 @@
+/**
+ * @file gzip_deflate.c
+ * @brief Minimal gzip (RFC 1952) compressor - Implementation
+ */
+
+#include "gzip_deflate.h"
+#include "esp_crc.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFLATE_HASH_BITS       11
+#define DEFLATE_HASH_SIZE       (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MIN_MATCH       3
+#define DEFLATE_MAX_MATCH       258
+#define DEFLATE_MAX_DISTANCE    32768
+
+#define GZIP_HEADER_SIZE        10
+#define GZIP_TRAILER_SIZE       8
+
+// RFC 1951 length codes 257..285
+static const uint16_t s_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// RFC 1951 distance codes 0..29
+static const uint16_t s_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t s_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * @brief LSB-first bit writer over a bounded output buffer
+ */
+typedef struct {
+    uint8_t* out;
+    size_t cap;
+    size_t pos;
+    uint32_t bit_buf;
+    int bit_count;
+    bool overflow;
+} bit_writer_t;
+
+static void put_bits(bit_writer_t* bw, uint32_t value, int count)
+{
+    bw->bit_buf |= value << bw->bit_count;
+    bw->bit_count += count;
+    while (bw->bit_count >= 8) {
+        if (bw->pos >= bw->cap) {
+            bw->overflow = true;
+            return;
+        }
+        bw->out[bw->pos++] = (uint8_t)bw->bit_buf;
+        bw->bit_buf >>= 8;
+        bw->bit_count -= 8;
+    }
+}
+
+static void flush_bits(bit_writer_t* bw)
+{
+    if (bw->bit_count > 0) {
+        put_bits(bw, 0, 8 - bw->bit_count);
+    }
+}
+
+/**
+ * @brief Write a Huffman code (codes are defined MSB-first)
+ */
+static void put_code(bit_writer_t* bw, uint32_t code, int length)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    put_bits(bw, reversed, length);
+}
+
+/**
+ * @brief Emit a literal/length symbol with the fixed Huffman code
+ */
+static void put_litlen(bit_writer_t* bw, int symbol)
+{
+    if (symbol < 144) {
+        put_code(bw, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        put_code(bw, 0x190 + (symbol - 144), 9);
+    } else if (symbol < 280) {
+        put_code(bw, symbol - 256, 7);
+    } else {
+        put_code(bw, 0xC0 + (symbol - 280), 8);
+    }
+}
+
+static void put_match(bit_writer_t* bw, int length, int distance)
+{
+    int li = 28;
+    while (s_len_base[li] > length) {
+        li--;
+    }
+    put_litlen(bw, 257 + li);
+    if (s_len_extra[li]) {
+        put_bits(bw, length - s_len_base[li], s_len_extra[li]);
+    }
+
+    int di = 29;
+    while (s_dist_base[di] > distance) {
+        di--;
+    }
+    put_code(bw, di, 5);
+    if (s_dist_extra[di]) {
+        put_bits(bw, distance - s_dist_base[di], s_dist_extra[di]);
+    }
+}
+
+static inline uint32_t hash3(const uint8_t* p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+esp_err_t gzip_compress(const uint8_t* in, size_t in_len,
+                        uint8_t* out, size_t out_cap, size_t* out_len)
+{
+    if (in == NULL || out == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (out_cap < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE + 2) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Positions are stored +1 so that 0 means "empty"
+    uint32_t* head = calloc(DEFLATE_HASH_SIZE, sizeof(uint32_t));
+    if (head == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // gzip header: magic, CM=deflate, no flags, no mtime, XFL=0, OS=unknown
+    static const uint8_t header[GZIP_HEADER_SIZE] = { 0x1F, 0x8B, 0x08, 0, 0, 0, 0, 0, 0, 0xFF };
+    memcpy(out, header, GZIP_HEADER_SIZE);
+
+    bit_writer_t bw = {
+        .out = out,
+        .cap = out_cap - GZIP_TRAILER_SIZE,
+        .pos = GZIP_HEADER_SIZE,
+    };
+
+    // One final block with fixed Huffman codes
+    put_bits(&bw, 1, 1);    // BFINAL
+    put_bits(&bw, 1, 2);    // BTYPE = 01
+
+    size_t i = 0;
+    while (i < in_len && !bw.overflow) {
+        int best_len = 0;
+        size_t best_dist = 0;
+
+        if (i + DEFLATE_MIN_MATCH <= in_len) {
+            uint32_t h = hash3(&in[i]);
+            uint32_t candidate = head[h];
+            head[h] = (uint32_t)i + 1;
+
+            if (candidate != 0) {
+                size_t pos = candidate - 1;
+                size_t dist = i - pos;
+                if (dist <= DEFLATE_MAX_DISTANCE) {
+                    size_t max_len = in_len - i;
+                    if (max_len > DEFLATE_MAX_MATCH) {
+                        max_len = DEFLATE_MAX_MATCH;
+                    }
+                    size_t len = 0;
+                    while (len < max_len && in[pos + len] == in[i + len]) {
+                        len++;
+                    }
+                    if (len >= DEFLATE_MIN_MATCH) {
+                        best_len = (int)len;
+                        best_dist = dist;
+                    }
+                }
+            }
+        }
+
+        if (best_len > 0) {
+            put_match(&bw, best_len, (int)best_dist);
+            // Index the positions covered by the match so later lines find them
+            size_t end = i + best_len;
+            for (i = i + 1; i < end; i++) {
+                if (i + DEFLATE_MIN_MATCH <= in_len) {
+                    head[hash3(&in[i])] = (uint32_t)i + 1;
+                }
+            }
+        } else {
+            put_litlen(&bw, in[i]);
+            i++;
+        }
+    }
+
+    put_litlen(&bw, 256);   // End of block
+    flush_bits(&bw);
+    free(head);
+
+    if (bw.overflow) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Trailer: CRC32 and input size, both little endian
+    uint32_t crc = esp_crc32_le(0, in, in_len);
+    uint32_t size = (uint32_t)in_len;
+    for (int b = 0; b < 4; b++) {
+        out[bw.pos++] = (uint8_t)(crc >> (8 * b));
+    }
+    for (int b = 0; b < 4; b++) {
+        out[bw.pos++] = (uint8_t)(size >> (8 * b));
+    }
+
+    *out_len = bw.pos;
+    return ESP_OK;
+}
+
+uint8_t* gzip_compress_body(const uint8_t* in, size_t in_len, size_t min_len, size_t* out_len)
+{
+    if (in == NULL || out_len == NULL || in_len < min_len) {
+        return NULL;
+    }
+
+    uint8_t* out = malloc(in_len);
+    if (out == NULL) {
+        return NULL;
+    }
+    if (gzip_compress(in, in_len, out, in_len, out_len) != ESP_OK) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
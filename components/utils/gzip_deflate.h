@@ -0,0 +1,48 @@
+/**
+ * @file gzip_deflate.h
+ * @brief Minimal gzip (RFC 1952) compressor for HTTP request bodies
+ *
+ * Single-pass LZ77 with a hash table of recent 3-byte sequences and the
+ * fixed Huffman code from RFC 1951. No dynamic trees are built, which keeps
+ * the code small and the working memory at a few KB while still removing
+ * most of the redundancy in repetitive payloads such as line protocol.
+ */
+
+#ifndef GZIP_DEFLATE_H
+#define GZIP_DEFLATE_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Compress a buffer into a gzip member
+ *
+ * @param in Input data
+ * @param in_len Input length in bytes
+ * @param out Output buffer
+ * @param out_cap Output capacity; compression stops with ESP_ERR_NO_MEM
+ *                as soon as the result would not fit
+ * @param out_len Receives the compressed length
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the output does not
+ *         fit (or the work buffer cannot be allocated), ESP_ERR_INVALID_ARG
+ */
+esp_err_t gzip_compress(const uint8_t* in, size_t in_len,
+                        uint8_t* out, size_t out_cap, size_t* out_len);
+
+/**
+ * @brief Compress a request body only when that makes it smaller
+ *
+ * The output buffer is as large as the input, so a body that does not shrink
+ * ends in ESP_ERR_NO_MEM from gzip_compress() and is sent as it is.
+ *
+ * @param in Body
+ * @param in_len Body length in bytes
+ * @param min_len Bodies shorter than this are not compressed
+ * @param out_len Receives the compressed length
+ * @return Heap buffer with the gzip member (free() it), or NULL to send the
+ *         plain body (too short, not smaller, or no memory)
+ */
+uint8_t* gzip_compress_body(const uint8_t* in, size_t in_len, size_t min_len, size_t* out_len);
+
+#endif // GZIP_DEFLATE_H
@@ -4,8 +4,11 @@
  */
 
 #include "ntp_time.h"
+#include "perf_profiler.h"
+#include "time_service.h"
 #include "esp_log.h"
 #include "esp_sntp.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -27,13 +30,15 @@ static const char* TAG = "NTP_TIME";
 static ntp_status_t s_ntp_status = NTP_STATUS_NOT_INITIALIZED;
 static ntp_sync_callback_t s_sync_callback = NULL;
 static EventGroupHandle_t s_time_event_group = NULL;
+static esp_timer_handle_t s_timeout_timer = NULL;
 
 // Event bits
 #define TIME_SYNC_BIT    BIT0
+#define TIME_FAIL_BIT    BIT1   // Sync attempt timed out
 
 // Forward declarations
 static void ntp_sync_notification_cb(struct timeval *tv);
-static void ntp_sync_task(void *pvParameters);
+static void ntp_sync_timeout_cb(void *arg);
 
 esp_err_t ntp_time_init(ntp_sync_callback_t callback)
 {
@@ -74,31 +79,26 @@ esp_err_t ntp_time_init(ntp_sync_callback_t callback)
     ESP_LOGI(TAG, "  Secondary: %s", NTP_SERVER_SECONDARY);
     ESP_LOGI(TAG, "  Tertiary: %s", NTP_SERVER_TERTIARY);
 
-    // Initialize and start SNTP
-    esp_sntp_init();
-
-    s_ntp_status = NTP_STATUS_SYNCING;
-
-    // Create task to handle initial sync
-    BaseType_t task_created = xTaskCreate(
-        ntp_sync_task,
-        "ntp_sync_task",
-        4096,
-        NULL,
-        5,
-        NULL
-    );
-
-    if (task_created != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create NTP sync task");
-        esp_sntp_stop();
+    // The attempt is bounded by a one-shot timer instead of a polling task
+    const esp_timer_create_args_t timer_args = {
+        .callback = ntp_sync_timeout_cb,
+        .name = "ntp_timeout",
+    };
+    if (esp_timer_create(&timer_args, &s_timeout_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create NTP timeout timer");
         vEventGroupDelete(s_time_event_group);
         s_time_event_group = NULL;
         s_ntp_status = NTP_STATUS_FAILED;
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "NTP time synchronization initialized");
+    // Initialize and start SNTP; the notification callback completes the sync
+    perf_phase_begin(PERF_PHASE_NTP);
+    s_ntp_status = NTP_STATUS_SYNCING;
+    esp_timer_start_once(s_timeout_timer, (uint64_t)NTP_SYNC_TIMEOUT_MS * 1000ULL);
+    esp_sntp_init();
+
+    ESP_LOGI(TAG, "NTP time synchronization started");
     return ESP_OK;
 }
 
@@ -109,6 +109,12 @@ esp_err_t ntp_time_deinit(void)
     // Stop SNTP
     esp_sntp_stop();
 
+    if (s_timeout_timer != NULL) {
+        esp_timer_stop(s_timeout_timer);
+        esp_timer_delete(s_timeout_timer);
+        s_timeout_timer = NULL;
+    }
+
     // Clean up event group
     if (s_time_event_group != NULL) {
         vEventGroupDelete(s_time_event_group);
@@ -238,21 +244,28 @@ esp_err_t ntp_time_force_sync(void)
 
     ESP_LOGI(TAG, "Forcing NTP synchronization");
     
-    // Clear sync bit
+    // A new attempt: waiters block until its own result
     if (s_time_event_group != NULL) {
-        xEventGroupClearBits(s_time_event_group, TIME_SYNC_BIT);
+        xEventGroupClearBits(s_time_event_group, TIME_SYNC_BIT | TIME_FAIL_BIT);
     }
 
     s_ntp_status = NTP_STATUS_SYNCING;
+    esp_timer_stop(s_timeout_timer);
+    esp_timer_start_once(s_timeout_timer, (uint64_t)NTP_SYNC_TIMEOUT_MS * 1000ULL);
 
-    // Restart SNTP
-    esp_sntp_stop();
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-    esp_sntp_init();
+    // Sends a new request right away, no stop/delay/init cycle
+    if (!esp_sntp_restart()) {
+        esp_sntp_init();
+    }
 
     return ESP_OK;
 }
 
+bool ntp_time_sync_pending(void)
+{
+    return s_ntp_status == NTP_STATUS_SYNCING;
+}
+
 esp_err_t ntp_time_wait_for_sync(uint32_t timeout_ms)
 {
     if (s_ntp_status == NTP_STATUS_NOT_INITIALIZED) {
@@ -263,15 +276,20 @@ esp_err_t ntp_time_wait_for_sync(uint32_t timeout_ms)
         return ESP_OK;  // Already synced
     }
 
+    if (s_ntp_status == NTP_STATUS_FAILED) {
+        return ESP_FAIL;    // This attempt is over, nothing to wait for
+    }
+
     if (s_time_event_group == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
     ESP_LOGI(TAG, "Waiting for NTP sync (timeout: %lu ms)", timeout_ms);
 
+    // Returns as soon as the notification (or the attempt timeout) fires
     EventBits_t bits = xEventGroupWaitBits(
         s_time_event_group,
-        TIME_SYNC_BIT,
+        TIME_SYNC_BIT | TIME_FAIL_BIT,
         pdFALSE,  // Don't clear bits
         pdFALSE,  // Wait for any bit
         pdMS_TO_TICKS(timeout_ms)
@@ -280,6 +298,8 @@ esp_err_t ntp_time_wait_for_sync(uint32_t timeout_ms)
     if (bits & TIME_SYNC_BIT) {
         ESP_LOGI(TAG, "NTP sync completed successfully");
         return ESP_OK;
+    } else if (bits & TIME_FAIL_BIT) {
+        return ESP_FAIL;
     } else {
         ESP_LOGW(TAG, "NTP sync timeout after %lu ms", timeout_ms);
         return ESP_ERR_TIMEOUT;
@@ -291,11 +311,17 @@ esp_err_t ntp_time_wait_for_sync(uint32_t timeout_ms)
 static void ntp_sync_notification_cb(struct timeval *tv)
 {
     ESP_LOGI(TAG, "NTP time synchronized successfully");
+    perf_phase_end(PERF_PHASE_NTP);     // Only the first sync after init is recorded
+    if (s_timeout_timer != NULL) {
+        esp_timer_stop(s_timeout_timer);
+    }
 
     s_ntp_status = NTP_STATUS_SYNCED;
+    time_service_clock_set(TIME_SOURCE_NTP);
 
     // Set the sync bit
     if (s_time_event_group != NULL) {
+        xEventGroupClearBits(s_time_event_group, TIME_FAIL_BIT);
         xEventGroupSetBits(s_time_event_group, TIME_SYNC_BIT);
     }
 
@@ -312,34 +338,21 @@ static void ntp_sync_notification_cb(struct timeval *tv)
     }
 }
 
-static void ntp_sync_task(void *pvParameters)
+static void ntp_sync_timeout_cb(void *arg)
 {
-    ESP_LOGI(TAG, "NTP sync task started");
-
-    const int max_wait_iterations = NTP_SYNC_TIMEOUT_MS / 1000;  // Wait up to 30 seconds
-    int wait_count = 0;
-
-    while (wait_count < max_wait_iterations) {
-        if (ntp_time_is_synced()) {
-            ESP_LOGI(TAG, "NTP sync completed in %d seconds", wait_count);
-            break;
-        }
-
-        wait_count++;
-        ESP_LOGI(TAG, "Waiting for NTP sync... (%d/%d)", wait_count, max_wait_iterations);
-        vTaskDelay(1000 / portTICK_PERIOD_MS);  // Wait 1 second
+    if (s_ntp_status != NTP_STATUS_SYNCING) {
+        return;
     }
 
-    if (!ntp_time_is_synced()) {
-        ESP_LOGW(TAG, "NTP sync failed after %d seconds", max_wait_iterations);
-        s_ntp_status = NTP_STATUS_FAILED;
-
-        // Call user callback if registered
-        if (s_sync_callback != NULL) {
-            s_sync_callback(NTP_STATUS_FAILED, NULL);
-        }
+    // SNTP keeps polling in the background; a late answer still sets the clock
+    ESP_LOGW(TAG, "NTP sync failed after %d ms", NTP_SYNC_TIMEOUT_MS);
+    s_ntp_status = NTP_STATUS_FAILED;
+    if (s_time_event_group != NULL) {
+        xEventGroupSetBits(s_time_event_group, TIME_FAIL_BIT);
     }
 
-    // Task complete - delete self
-    vTaskDelete(NULL);
-}
\ No newline at end of file
+    // Call user callback if registered
+    if (s_sync_callback != NULL) {
+        s_sync_callback(NTP_STATUS_FAILED, NULL);
+    }
+}
@@ -108,13 +108,23 @@ esp_err_t ntp_time_get_iso_string(char* buffer, size_t buffer_size);
  */
 esp_err_t ntp_time_force_sync(void);
 
+/**
+ * @brief Check whether a sync attempt is still running
+ * 
+ * @return true between ntp_time_init()/ntp_time_force_sync() and the sync or its timeout
+ */
+bool ntp_time_sync_pending(void);
+
 /**
  * @brief Wait for NTP synchronization with timeout
  * 
- * Blocks until NTP is synchronized or timeout occurs.
+ * Blocks until the SNTP notification arrives, the attempt times out, or
+ * timeout_ms passes, whichever is first. Start the sync as soon as the IP is
+ * up and call this only where a timestamp is really needed.
  * 
  * @param timeout_ms Maximum time to wait in milliseconds
- * @return esp_err_t ESP_OK if synced, ESP_ERR_TIMEOUT if timeout, other error codes on failure
+ * @return esp_err_t ESP_OK if synced, ESP_ERR_TIMEOUT if timeout_ms passed,
+ *         ESP_FAIL if the attempt timed out, ESP_ERR_INVALID_STATE if not initialized
  */
 esp_err_t ntp_time_wait_for_sync(uint32_t timeout_ms);
 
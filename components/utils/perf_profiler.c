@@ -0,0 +1,116 @@
+/**
+ * @file perf_profiler.c
+ * @brief Wake-Cycle Phase Profiler - Implementation
+ */
+
+#include "perf_profiler.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#define PERF_RTC_MAGIC  0x50524631  // "PRF1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cycles;
+    perf_phase_stats_t phases[PERF_PHASE_COUNT];
+} perf_rtc_state_t;
+
+static RTC_DATA_ATTR perf_rtc_state_t s_rtc;
+static int64_t s_start_us[PERF_PHASE_COUNT];    // 0 = phase not running
+
+static const char* const s_phase_names[PERF_PHASE_COUNT] = {
+    [PERF_PHASE_BOOT]    = "boot",
+    [PERF_PHASE_INIT]    = "init",
+    [PERF_PHASE_WIFI]    = "wifi",
+    [PERF_PHASE_NTP]     = "ntp",
+    [PERF_PHASE_SENSORS] = "sensors",
+    [PERF_PHASE_TLS]     = "tls",
+    [PERF_PHASE_POST]    = "post",
+    [PERF_PHASE_TX_WAIT] = "tx_wait",
+    [PERF_PHASE_DISPLAY] = "display",
+    [PERF_PHASE_AWAKE]   = "awake",
+};
+
+void perf_profiler_init(void)
+{
+    // RTC contents are only meaningful after a deep-sleep wakeup
+    if (s_rtc.magic != PERF_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        perf_profiler_reset_window();
+    }
+    memset(s_start_us, 0, sizeof(s_start_us));
+
+    // esp_timer starts counting during startup, so its value here is the boot time
+    perf_phase_record(PERF_PHASE_BOOT, (uint32_t)esp_timer_get_time());
+    s_start_us[PERF_PHASE_AWAKE] = 1;   // The first cycle is awake since reset
+}
+
+void perf_phase_begin(perf_phase_t phase)
+{
+    if (phase < PERF_PHASE_COUNT) {
+        int64_t now = esp_timer_get_time();
+        s_start_us[phase] = (now > 0) ? now : 1;
+    }
+}
+
+void perf_phase_end(perf_phase_t phase)
+{
+    if (phase >= PERF_PHASE_COUNT || s_start_us[phase] == 0) {
+        return;
+    }
+    int64_t duration = esp_timer_get_time() - s_start_us[phase];
+    s_start_us[phase] = 0;
+    perf_phase_record(phase, (uint32_t)duration);
+}
+
+void perf_phase_record(perf_phase_t phase, uint32_t duration_us)
+{
+    if (phase >= PERF_PHASE_COUNT) {
+        return;
+    }
+    perf_phase_stats_t* st = &s_rtc.phases[phase];
+    st->last_us = duration_us;
+    if (duration_us > st->max_us) {
+        st->max_us = duration_us;
+    }
+    st->sum_us += duration_us;
+    st->count++;
+}
+
+void perf_profiler_cycle_begin(void)
+{
+    if (s_start_us[PERF_PHASE_AWAKE] == 0) {
+        perf_phase_begin(PERF_PHASE_AWAKE);
+    }
+}
+
+void perf_profiler_cycle_done(void)
+{
+    perf_phase_end(PERF_PHASE_AWAKE);
+    s_rtc.cycles++;
+}
+
+const perf_phase_stats_t* perf_profiler_get(perf_phase_t phase)
+{
+    if (phase >= PERF_PHASE_COUNT) {
+        phase = PERF_PHASE_AWAKE;
+    }
+    return &s_rtc.phases[phase];
+}
+
+uint32_t perf_profiler_window_cycles(void)
+{
+    return s_rtc.cycles;
+}
+
+void perf_profiler_reset_window(void)
+{
+    memset(&s_rtc, 0, sizeof(s_rtc));
+    s_rtc.magic = PERF_RTC_MAGIC;
+}
+
+const char* perf_phase_name(perf_phase_t phase)
+{
+    return (phase < PERF_PHASE_COUNT) ? s_phase_names[phase] : "unknown";
+}
@@ -0,0 +1,111 @@
+/**
+ * @file perf_profiler.h
+ * @brief Wake-Cycle Phase Profiler
+ *
+ * Lightweight esp_timer based phase markers. Each phase keeps its last,
+ * maximum and summed duration in RTC memory, so statistics accumulate over
+ * many deep-sleep cycles until the window is reset (typically after the
+ * statistics have been published).
+ */
+
+#ifndef PERF_PROFILER_H
+#define PERF_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Profiled phases of a wake cycle
+ */
+typedef enum {
+    PERF_PHASE_BOOT = 0,        ///< Reset until app_main (esp_timer start)
+    PERF_PHASE_INIT,            ///< init_system + init_sensors
+    PERF_PHASE_WIFI,            ///< Connect start until IP address
+    PERF_PHASE_NTP,             ///< SNTP start until first sync
+    PERF_PHASE_SENSORS,         ///< Monitor start until the cycle barrier
+    PERF_PHASE_TLS,             ///< TCP connect + TLS handshake of an HTTP request
+    PERF_PHASE_POST,            ///< One HTTP POST (incl. connect if needed)
+    PERF_PHASE_TX_WAIT,         ///< Waiting for the senders to drain
+    PERF_PHASE_DISPLAY,         ///< One e-paper refresh
+    PERF_PHASE_AWAKE,           ///< Whole awake time of a cycle
+    PERF_PHASE_COUNT
+} perf_phase_t;
+
+/**
+ * @brief Accumulated statistics of one phase
+ */
+typedef struct {
+    uint32_t last_us;           ///< Most recent duration
+    uint32_t max_us;            ///< Longest duration in the window
+    uint64_t sum_us;            ///< Sum of all durations in the window
+    uint32_t count;             ///< Number of recorded durations
+} perf_phase_stats_t;
+
+/**
+ * @brief Initialize the profiler and record the boot phase
+ *
+ * The RTC statistics are kept after a deep-sleep wakeup and cleared after
+ * any other reset. Boot time is the esp_timer value at this call, so it
+ * covers the application startup but not the ROM and second stage bootloader.
+ */
+void perf_profiler_init(void);
+
+/**
+ * @brief Mark the start of a phase
+ *
+ * @param phase Phase to start (restarts it if already running)
+ */
+void perf_phase_begin(perf_phase_t phase);
+
+/**
+ * @brief Mark the end of a phase and record its duration
+ *
+ * @param phase Phase to end (ignored if it was not started)
+ */
+void perf_phase_end(perf_phase_t phase);
+
+/**
+ * @brief Record a duration that was measured elsewhere
+ *
+ * @param phase Phase to record
+ * @param duration_us Duration in microseconds
+ */
+void perf_phase_record(perf_phase_t phase, uint32_t duration_us);
+
+/**
+ * @brief Start timing the awake phase of a new cycle
+ *
+ * The first cycle after reset is already timed from the reset; this only
+ * matters for continuous mode where cycles repeat without a reset.
+ */
+void perf_profiler_cycle_begin(void);
+
+/**
+ * @brief Record the awake time and count the cycle (call right before sleeping)
+ */
+void perf_profiler_cycle_done(void);
+
+/**
+ * @brief Get the statistics of a phase
+ *
+ * @param phase Phase to query
+ * @return const perf_phase_stats_t* Statistics in RTC memory (never NULL)
+ */
+const perf_phase_stats_t* perf_profiler_get(perf_phase_t phase);
+
+/**
+ * @brief Number of cycles recorded since the last window reset
+ */
+uint32_t perf_profiler_window_cycles(void);
+
+/**
+ * @brief Clear all statistics and start a new window
+ */
+void perf_profiler_reset_window(void);
+
+/**
+ * @brief Short snake_case name of a phase, used as field prefix
+ */
+const char* perf_phase_name(perf_phase_t phase);
+
+#endif // PERF_PROFILER_H
@@ -0,0 +1,84 @@
+/**
+ * @file power_mode.c
+ * @brief Automatic Light Sleep for Continuous Operation - Implementation
+ */
+
+#include "power_mode.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "POWER_MODE";
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t s_busy_lock = NULL;
+#endif
+static bool s_light_sleep = false;
+
+esp_err_t power_mode_init(const power_mode_config_t* config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if CONFIG_PM_ENABLE
+    if (s_busy_lock == NULL) {
+        esp_err_t ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cycle", &s_busy_lock);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create PM lock: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+#if !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (config->light_sleep) {
+        ESP_LOGW(TAG, "CONFIG_FREERTOS_USE_TICKLESS_IDLE is off, light sleep not available");
+    }
+    const bool light_sleep = false;
+#else
+    const bool light_sleep = config->light_sleep;
+#endif
+
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = config->max_freq_mhz,
+        .min_freq_mhz = config->min_freq_mhz,
+        .light_sleep_enable = light_sleep,
+    };
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure power management: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_light_sleep = light_sleep;
+    ESP_LOGI(TAG, "CPU %d-%d MHz, light sleep %s", config->min_freq_mhz, config->max_freq_mhz,
+             light_sleep ? "on" : "off");
+    return ESP_OK;
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, running at full power");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void power_mode_busy_begin(void)
+{
+#if CONFIG_PM_ENABLE
+    if (s_busy_lock != NULL) {
+        esp_pm_lock_acquire(s_busy_lock);
+    }
+#endif
+}
+
+void power_mode_busy_end(void)
+{
+#if CONFIG_PM_ENABLE
+    if (s_busy_lock != NULL) {
+        esp_pm_lock_release(s_busy_lock);
+    }
+#endif
+}
+
+bool power_mode_light_sleep_active(void)
+{
+    return s_light_sleep;
+}
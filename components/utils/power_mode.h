@@ -0,0 +1,54 @@
+/**
+ * @file power_mode.h
+ * @brief Automatic Light Sleep for Continuous Operation
+ *
+ * Without deep sleep the device stays booted between cycles. With power
+ * management and tickless idle enabled in sdkconfig, the idle task enters
+ * light sleep (and scales the CPU clock down) whenever every task is blocked,
+ * e.g. in the delay between two cycles; WiFi stays associated through modem
+ * sleep, so connections survive the pause.
+ *
+ * A cycle holds a CPU frequency lock from power_mode_busy_begin() to
+ * power_mode_busy_end(), which keeps the full clock and no light sleep while
+ * sensors are read and data is sent. Both are no-ops until power_mode_init().
+ */
+
+#ifndef POWER_MODE_H
+#define POWER_MODE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+/**
+ * @brief Power management settings
+ */
+typedef struct {
+    int max_freq_mhz;               ///< CPU clock while busy
+    int min_freq_mhz;               ///< CPU clock while idle (XTAL frequency at the lowest)
+    bool light_sleep;               ///< Enter light sleep when idle
+} power_mode_config_t;
+
+/**
+ * @brief Configure dynamic frequency scaling and automatic light sleep
+ *
+ * @param config Power management settings
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if CONFIG_PM_ENABLE is off
+ */
+esp_err_t power_mode_init(const power_mode_config_t* config);
+
+/**
+ * @brief Keep the full CPU clock and stay out of light sleep (nests)
+ */
+void power_mode_busy_begin(void);
+
+/**
+ * @brief Release one power_mode_busy_begin()
+ */
+void power_mode_busy_end(void);
+
+/**
+ * @brief Check whether the device light sleeps while idle
+ */
+bool power_mode_light_sleep_active(void);
+
+#endif // POWER_MODE_H
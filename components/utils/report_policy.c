@@ -0,0 +1,147 @@
+/**
+ * @file report_policy.c
+ * @brief Report-by-Exception Policy for Sensor Metrics - Implementation
+ */
+
+#include "report_policy.h"
+#include "esp_utils.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "REPORT_POLICY";
+
+#define REPORT_RTC_MAGIC    0x52505031  // "RPP1"
+
+/**
+ * @brief Per metric state kept across deep sleep
+ */
+typedef struct {
+    float reported_value;       ///< Last value handed to the senders
+    float sample_value;         ///< Last sampled value
+    uint32_t reported_s;        ///< Time of the last report (s)
+    uint32_t sample_s;          ///< Time of the last sample (s)
+    bool has_report;
+    bool has_sample;
+} report_metric_state_t;
+
+typedef struct {
+    uint32_t magic;
+    report_metric_state_t metrics[REPORT_METRIC_COUNT];
+} report_rtc_state_t;
+
+static RTC_DATA_ATTR report_rtc_state_t s_rtc;
+static report_policy_config_t s_config[REPORT_METRIC_COUNT];
+static bool s_configured[REPORT_METRIC_COUNT];
+static volatile bool s_alarm = false;   // Threshold trip during this boot
+
+static const char* const s_metric_names[REPORT_METRIC_COUNT] = {
+    [REPORT_METRIC_BATTERY_VOLTAGE] = "battery_voltage",
+    [REPORT_METRIC_TEMPERATURE]     = "temperature",
+    [REPORT_METRIC_HUMIDITY]        = "humidity",
+    [REPORT_METRIC_SOIL_MOISTURE]   = "soil_moisture",
+};
+
+// System time keeps running through deep sleep (RTC timer), unlike esp_timer
+static uint32_t report_now_s(void)
+{
+    return (uint32_t)(esp_utils_get_timestamp_ms() / 1000);
+}
+
+void report_policy_init(void)
+{
+    // RTC contents are only meaningful after a deep-sleep wakeup
+    if (s_rtc.magic != REPORT_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = REPORT_RTC_MAGIC;
+    }
+}
+
+void report_policy_configure(report_metric_t metric, const report_policy_config_t* config)
+{
+    if (metric >= REPORT_METRIC_COUNT || config == NULL) {
+        return;
+    }
+    s_config[metric] = *config;
+    s_configured[metric] = true;
+}
+
+bool report_policy_check(report_metric_t metric, float value)
+{
+    if (metric >= REPORT_METRIC_COUNT) {
+        return true;
+    }
+
+    report_metric_state_t* st = &s_rtc.metrics[metric];
+    const report_policy_config_t* cfg = &s_config[metric];
+    uint32_t now = report_now_s();
+
+    // Rate of change against the previous sample, reported or not
+    float rate_per_min = 0.0f;
+    bool have_rate = st->has_sample && now > st->sample_s;
+    if (have_rate) {
+        rate_per_min = fabsf(value - st->sample_value) * 60.0f / (float)(now - st->sample_s);
+    }
+    st->sample_value = value;
+    st->sample_s = now;
+    st->has_sample = true;
+
+    const char* reason = NULL;
+    if (!s_configured[metric]) {
+        reason = "no policy";
+    } else if (!st->has_report) {
+        reason = "first sample";
+    } else if (now < st->reported_s) {
+        reason = "clock stepped back";         // e.g. NTP correction; restart the intervals
+    } else {
+        uint32_t elapsed = now - st->reported_s;
+        float delta = fabsf(value - st->reported_value);
+
+        if (cfg->min_interval_s > 0 && elapsed < cfg->min_interval_s) {
+            ESP_LOGD(TAG, "%s: held back (%lus < min interval)", s_metric_names[metric], (unsigned long)elapsed);
+            return false;
+        }
+        if (cfg->max_interval_s > 0 && elapsed >= cfg->max_interval_s) {
+            reason = "heartbeat";
+        } else if (cfg->deadband > 0.0f && delta >= cfg->deadband) {
+            reason = "deadband";
+            s_alarm = true;
+        } else if (cfg->rate_per_min > 0.0f && have_rate && rate_per_min >= cfg->rate_per_min) {
+            reason = "rate of change";
+            s_alarm = true;
+        } else if (cfg->deadband <= 0.0f && cfg->rate_per_min <= 0.0f && cfg->max_interval_s == 0) {
+            reason = "interval";                // Only a minimum interval configured
+        }
+    }
+
+    if (reason == NULL) {
+        ESP_LOGD(TAG, "%s: %.3f suppressed (last reported %.3f)",
+                 s_metric_names[metric], value, st->reported_value);
+        return false;
+    }
+    ESP_LOGD(TAG, "%s: %.3f reported (%s)", s_metric_names[metric], value, reason);
+    return true;
+}
+
+void report_policy_mark_reported(report_metric_t metric, float value)
+{
+    if (metric >= REPORT_METRIC_COUNT) {
+        return;
+    }
+    report_metric_state_t* st = &s_rtc.metrics[metric];
+    st->reported_value = value;
+    st->reported_s = report_now_s();
+    st->has_report = true;
+}
+
+bool report_policy_alarm_raised(void)
+{
+    return s_alarm;
+}
+
+const char* report_metric_name(report_metric_t metric)
+{
+    return (metric < REPORT_METRIC_COUNT) ? s_metric_names[metric] : "unknown";
+}
@@ -0,0 +1,94 @@
+/**
+ * @file report_policy.h
+ * @brief Report-by-Exception Policy for Sensor Metrics
+ *
+ * Decides per metric whether a new sample is worth transmitting. A sample is
+ * reported when it leaves the deadband around the last reported value, when
+ * it changes faster than the rate-of-change threshold, or when the heartbeat
+ * interval expired; it is never reported sooner than the minimum interval.
+ * The last reported and last sampled values live in RTC memory, so the
+ * decision spans deep-sleep cycles.
+ *
+ * Each metric is expected to be owned by one task; different metrics can be
+ * used from different tasks without locking.
+ */
+
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Metrics with a reporting policy
+ */
+typedef enum {
+    REPORT_METRIC_BATTERY_VOLTAGE = 0,  ///< Battery voltage (V)
+    REPORT_METRIC_TEMPERATURE,          ///< Air temperature (C)
+    REPORT_METRIC_HUMIDITY,             ///< Relative humidity (%RH)
+    REPORT_METRIC_SOIL_MOISTURE,        ///< Soil moisture (%)
+    REPORT_METRIC_COUNT
+} report_metric_t;
+
+/**
+ * @brief Thresholds of one metric (0 disables a threshold)
+ */
+typedef struct {
+    float deadband;             ///< Report when |value - last reported| >= deadband
+    float rate_per_min;         ///< Report when |change per minute| since the last sample >= this
+    uint32_t min_interval_s;    ///< Never report more often than this
+    uint32_t max_interval_s;    ///< Always report after this long (heartbeat)
+} report_policy_config_t;
+
+/**
+ * @brief Initialize the policy state
+ *
+ * The RTC state is kept after a deep-sleep wakeup and cleared after any other
+ * reset, so the first sample after power-on is always reported.
+ */
+void report_policy_init(void);
+
+/**
+ * @brief Set the thresholds of a metric
+ *
+ * Metrics without a configuration report every sample.
+ *
+ * @param metric Metric to configure
+ * @param config Thresholds
+ */
+void report_policy_configure(report_metric_t metric, const report_policy_config_t* config);
+
+/**
+ * @brief Record a sample and decide whether it should be reported
+ *
+ * @param metric Sampled metric
+ * @param value Sample value
+ * @return true if the sample should be transmitted
+ */
+bool report_policy_check(report_metric_t metric, float value);
+
+/**
+ * @brief Record that a value was handed to the senders
+ *
+ * Call only after the enqueue succeeded, so a failed transmission is retried
+ * with the next sample.
+ *
+ * @param metric Reported metric
+ * @param value Reported value
+ */
+void report_policy_mark_reported(report_metric_t metric, float value);
+
+/**
+ * @brief Check whether a deadband or rate-of-change trigger fired since init
+ *
+ * Heartbeats and first samples do not count; this flags readings that are
+ * worth an immediate upload.
+ */
+bool report_policy_alarm_raised(void);
+
+/**
+ * @brief Human readable metric name
+ */
+const char* report_metric_name(report_metric_t metric);
+
+#endif // REPORT_POLICY_H
@@ -0,0 +1,201 @@
+/**
+ * @file resource_tracker.c
+ * @brief Heap and Task Stack Budget Tracker - Implementation
+ */
+
+#include "resource_tracker.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char* TAG = "RESOURCES";
+
+#define RESOURCE_RTC_MAGIC          0x52534331  // "RSC1"
+#define RESOURCE_STACK_MARGIN_PCT   25          // Headroom of the suggested stack size
+#define RESOURCE_STACK_ROUND        512
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cycles;                            // Since the last report
+    uint32_t heap_min_free;
+    resource_task_stats_t tasks[RESOURCE_TASK_COUNT];
+    resource_point_stats_t points[RESOURCE_POINT_COUNT];
+} resource_rtc_t;
+
+static RTC_DATA_ATTR resource_rtc_t s_rtc;
+static TaskHandle_t s_handles[RESOURCE_TASK_COUNT];    // Running tasks (not kept across sleep)
+static SemaphoreHandle_t s_lock = NULL;                 // Handles must not be sampled while a task exits
+
+static const char* const s_task_names[RESOURCE_TASK_COUNT] = {
+    [RESOURCE_TASK_MAIN]    = "main",
+    [RESOURCE_TASK_INFLUX]  = "influx",
+    [RESOURCE_TASK_MQTT]    = "mqtt",
+    [RESOURCE_TASK_SENSORS] = "sensors",
+    [RESOURCE_TASK_EPAPER]  = "epaper",
+    [RESOURCE_TASK_ESPNOW]  = "espnow",
+};
+
+static const char* const s_point_names[RESOURCE_POINT_COUNT] = {
+    [RESOURCE_POINT_INIT]    = "init",
+    [RESOURCE_POINT_SENSORS] = "sensors",
+    [RESOURCE_POINT_TX]      = "tx",
+    [RESOURCE_POINT_SLEEP]   = "sleep",
+};
+
+static void sample_task(resource_task_t task, TaskHandle_t handle)
+{
+    // ESP-IDF reports the high-water mark in bytes
+    uint32_t free_bytes = (uint32_t)uxTaskGetStackHighWaterMark(handle);
+    if (free_bytes < s_rtc.tasks[task].stack_min_free) {
+        s_rtc.tasks[task].stack_min_free = free_bytes;
+    }
+}
+
+void resource_tracker_init(void)
+{
+    if (s_rtc.magic != RESOURCE_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = RESOURCE_RTC_MAGIC;
+        s_rtc.heap_min_free = UINT32_MAX;
+    }
+    memset(s_handles, 0, sizeof(s_handles));
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+void resource_tracker_task_enter(resource_task_t task, uint32_t stack_size)
+{
+    if (task >= RESOURCE_TASK_COUNT || s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    resource_task_stats_t* st = &s_rtc.tasks[task];
+    if (st->stack_size != stack_size) {
+        st->stack_size = stack_size;        // New size (or first run): earlier marks no longer apply
+        st->stack_min_free = UINT32_MAX;
+    }
+    s_handles[task] = xTaskGetCurrentTaskHandle();
+    xSemaphoreGive(s_lock);
+}
+
+void resource_tracker_task_exit(resource_task_t task)
+{
+    if (task >= RESOURCE_TASK_COUNT || s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_handles[task] != NULL) {
+        sample_task(task, NULL);
+        s_handles[task] = NULL;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void resource_tracker_checkpoint(resource_point_t point)
+{
+    if (point >= RESOURCE_POINT_COUNT || s_lock == NULL) {
+        return;
+    }
+
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    resource_point_stats_t* st = &s_rtc.points[point];
+    if (st->free_min == 0 || info.total_free_bytes < st->free_min) {
+        st->free_min = (uint32_t)info.total_free_bytes;
+    }
+    if (st->largest_min == 0 || info.largest_free_block < st->largest_min) {
+        st->largest_min = (uint32_t)info.largest_free_block;
+    }
+    if (info.allocated_blocks > st->blocks_max) {
+        st->blocks_max = (uint32_t)info.allocated_blocks;
+    }
+    // The allocator's own low mark also covers peaks between checkpoints (e.g. a TLS handshake)
+    uint32_t heap_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    if (heap_min < s_rtc.heap_min_free) {
+        s_rtc.heap_min_free = heap_min;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < RESOURCE_TASK_COUNT; i++) {
+        if (s_handles[i] != NULL) {
+            sample_task((resource_task_t)i, s_handles[i]);
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+const resource_task_stats_t* resource_tracker_task(resource_task_t task)
+{
+    if (task >= RESOURCE_TASK_COUNT) {
+        task = RESOURCE_TASK_MAIN;
+    }
+    return &s_rtc.tasks[task];
+}
+
+const resource_point_stats_t* resource_tracker_point(resource_point_t point)
+{
+    if (point >= RESOURCE_POINT_COUNT) {
+        point = RESOURCE_POINT_SLEEP;
+    }
+    return &s_rtc.points[point];
+}
+
+uint32_t resource_tracker_heap_min_free(void)
+{
+    return (s_rtc.heap_min_free == UINT32_MAX) ? 0 : s_rtc.heap_min_free;
+}
+
+void resource_tracker_cycle_done(void)
+{
+    s_rtc.cycles++;
+}
+
+uint32_t resource_tracker_cycles_since_report(void)
+{
+    return s_rtc.cycles;
+}
+
+void resource_tracker_mark_reported(void)
+{
+    s_rtc.cycles = 0;
+}
+
+void resource_tracker_log_report(void)
+{
+    ESP_LOGI(TAG, "Heap: lowest free %lu bytes since power-on", (unsigned long)resource_tracker_heap_min_free());
+    for (int p = 0; p < RESOURCE_POINT_COUNT; p++) {
+        const resource_point_stats_t* st = &s_rtc.points[p];
+        if (st->free_min == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-8s free >= %lu, largest block >= %lu, blocks <= %lu", s_point_names[p],
+                 (unsigned long)st->free_min, (unsigned long)st->largest_min, (unsigned long)st->blocks_max);
+    }
+    for (int t = 0; t < RESOURCE_TASK_COUNT; t++) {
+        const resource_task_stats_t* st = &s_rtc.tasks[t];
+        if (st->stack_size == 0 || st->stack_min_free == UINT32_MAX) {
+            continue;
+        }
+        uint32_t used = st->stack_size - st->stack_min_free;
+        uint32_t suggested = used + used * RESOURCE_STACK_MARGIN_PCT / 100;
+        suggested = (suggested + RESOURCE_STACK_ROUND - 1) / RESOURCE_STACK_ROUND * RESOURCE_STACK_ROUND;
+        ESP_LOGI(TAG, "  task %-8s stack used %5lu of %5lu bytes, suggested %lu", s_task_names[t],
+                 (unsigned long)used, (unsigned long)st->stack_size, (unsigned long)suggested);
+    }
+}
+
+const char* resource_task_name(resource_task_t task)
+{
+    return (task < RESOURCE_TASK_COUNT) ? s_task_names[task] : "unknown";
+}
+
+const char* resource_point_name(resource_point_t point)
+{
+    return (point < RESOURCE_POINT_COUNT) ? s_point_names[point] : "unknown";
+}
@@ -0,0 +1,128 @@
+/**
+ * @file resource_tracker.h
+ * @brief Heap and Task Stack Budget Tracker
+ *
+ * Records the worst case seen since power-on, kept in RTC memory across deep
+ * sleep, so task stacks and buffers can be sized from field data:
+ *   - per task: stack size and the lowest free stack (high-water mark)
+ *   - per cycle checkpoint: lowest free heap, smallest largest free block
+ *     and most allocated blocks
+ *   - lowest free heap ever reported by the allocator
+ *
+ * Tasks report themselves with resource_tracker_task_enter() (and _exit()
+ * right before a short-lived task deletes itself); running tasks are sampled
+ * at every checkpoint.
+ */
+
+#ifndef RESOURCE_TRACKER_H
+#define RESOURCE_TRACKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tracked tasks
+ */
+typedef enum {
+    RESOURCE_TASK_MAIN = 0,     ///< app_main
+    RESOURCE_TASK_INFLUX,       ///< InfluxDB sender
+    RESOURCE_TASK_MQTT,         ///< MQTT sender
+    RESOURCE_TASK_SENSORS,      ///< Sensor runtime
+    RESOURCE_TASK_EPAPER,       ///< ePaper display
+    RESOURCE_TASK_ESPNOW,       ///< ESP-NOW gateway
+    RESOURCE_TASK_COUNT
+} resource_task_t;
+
+/**
+ * @brief Heap checkpoints of a cycle
+ */
+typedef enum {
+    RESOURCE_POINT_INIT = 0,    ///< System and sensors initialized
+    RESOURCE_POINT_SENSORS,     ///< Cycle jobs joined
+    RESOURCE_POINT_TX,          ///< Senders drained
+    RESOURCE_POINT_SLEEP,       ///< Right before sleeping
+    RESOURCE_POINT_COUNT
+} resource_point_t;
+
+/**
+ * @brief Worst case of one task
+ */
+typedef struct {
+    uint32_t stack_size;        ///< Configured stack in bytes (0 = never ran)
+    uint32_t stack_min_free;    ///< Lowest free stack in bytes
+} resource_task_stats_t;
+
+/**
+ * @brief Worst case at one checkpoint
+ */
+typedef struct {
+    uint32_t free_min;          ///< Lowest free heap in bytes (0 = never reached)
+    uint32_t largest_min;       ///< Smallest largest free block in bytes
+    uint32_t blocks_max;        ///< Most allocated heap blocks
+} resource_point_stats_t;
+
+/**
+ * @brief Restore the worst-case values (kept after a deep-sleep wakeup only)
+ */
+void resource_tracker_init(void);
+
+/**
+ * @brief Report the calling task (call first thing in the task function)
+ *
+ * @param task Task id
+ * @param stack_size Stack size the task was created with (bytes)
+ */
+void resource_tracker_task_enter(resource_task_t task, uint32_t stack_size);
+
+/**
+ * @brief Sample the calling task a last time before it deletes itself
+ */
+void resource_tracker_task_exit(resource_task_t task);
+
+/**
+ * @brief Sample the heap and every running task
+ */
+void resource_tracker_checkpoint(resource_point_t point);
+
+/**
+ * @brief Get the worst case of a task
+ */
+const resource_task_stats_t* resource_tracker_task(resource_task_t task);
+
+/**
+ * @brief Get the worst case at a checkpoint
+ */
+const resource_point_stats_t* resource_tracker_point(resource_point_t point);
+
+/**
+ * @brief Lowest free heap since power-on (bytes)
+ */
+uint32_t resource_tracker_heap_min_free(void);
+
+/**
+ * @brief Count a finished cycle
+ */
+void resource_tracker_cycle_done(void);
+
+/**
+ * @brief Cycles since the last resource_tracker_mark_reported()
+ */
+uint32_t resource_tracker_cycles_since_report(void);
+
+/**
+ * @brief Restart the report interval (the worst-case values are kept)
+ */
+void resource_tracker_mark_reported(void);
+
+/**
+ * @brief Log the sizing report: per task used/size and a suggested stack size
+ */
+void resource_tracker_log_report(void);
+
+/**
+ * @brief Short snake_case names, used as field prefixes
+ */
+const char* resource_task_name(resource_task_t task);
+const char* resource_point_name(resource_point_t point);
+
+#endif // RESOURCE_TRACKER_H
@@ -0,0 +1,94 @@
+/**
+ * @file retry_backoff.c
+ * @brief Retry Scheduler with Exponential Backoff, Jitter and a Time Budget - Implementation
+ */
+
+#include "retry_backoff.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "RETRY_BACKOFF";
+
+void retry_backoff_init(retry_backoff_t* backoff, const retry_backoff_config_t* config)
+{
+    if (backoff == NULL || config == NULL) {
+        return;
+    }
+    memset(backoff, 0, sizeof(*backoff));
+    backoff->config = *config;
+    if (backoff->config.jitter_percent > 100) {
+        backoff->config.jitter_percent = 100;
+    }
+}
+
+void retry_backoff_reset(retry_backoff_t* backoff)
+{
+    if (backoff == NULL) {
+        return;
+    }
+    backoff->failures = 0;
+    backoff->first_failure_us = 0;
+    backoff->next_attempt_us = 0;
+    backoff->exhausted = false;
+}
+
+bool retry_backoff_failed(retry_backoff_t* backoff, uint32_t retry_after_ms)
+{
+    if (backoff == NULL) {
+        return false;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (backoff->failures == 0) {
+        backoff->first_failure_us = now;
+    }
+
+    // base * 2^failures, without overflowing the shift
+    uint64_t delay_ms = backoff->config.base_ms;
+    for (uint32_t i = 0; i < backoff->failures && delay_ms < backoff->config.max_ms; i++) {
+        delay_ms *= 2;
+    }
+    if (delay_ms > backoff->config.max_ms) {
+        delay_ms = backoff->config.max_ms;
+    }
+    backoff->failures++;
+
+    // Random share of the delay so nodes that failed together spread out
+    uint32_t jitter_ms = (uint32_t)(delay_ms * backoff->config.jitter_percent / 100);
+    if (jitter_ms > 0) {
+        delay_ms -= esp_random() % (jitter_ms + 1);
+    }
+
+    // The server knows its load better than our counter
+    if (retry_after_ms > delay_ms) {
+        delay_ms = retry_after_ms;
+    }
+
+    backoff->next_attempt_us = now + (int64_t)delay_ms * 1000;
+    if (backoff->config.budget_ms > 0 &&
+        backoff->next_attempt_us - backoff->first_failure_us > (int64_t)backoff->config.budget_ms * 1000) {
+        ESP_LOGW(TAG, "Retry budget of %lu ms exhausted after %lu failures",
+                 (unsigned long)backoff->config.budget_ms, (unsigned long)backoff->failures);
+        backoff->exhausted = true;
+        return false;
+    }
+
+    ESP_LOGD(TAG, "Failure %lu: next attempt in %lu ms", (unsigned long)backoff->failures, (unsigned long)delay_ms);
+    return true;
+}
+
+bool retry_backoff_pending(const retry_backoff_t* backoff)
+{
+    return backoff != NULL && backoff->failures > 0 && !backoff->exhausted;
+}
+
+uint32_t retry_backoff_wait_ms(const retry_backoff_t* backoff)
+{
+    if (!retry_backoff_pending(backoff)) {
+        return 0;
+    }
+    int64_t remaining_us = backoff->next_attempt_us - esp_timer_get_time();
+    return (remaining_us > 0) ? (uint32_t)((remaining_us + 999) / 1000) : 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file retry_backoff.h
+ * @brief Retry Scheduler with Exponential Backoff, Jitter and a Time Budget
+ *
+ * Decides when a failed operation may run again instead of delaying in place,
+ * so the caller's task keeps serving other work between attempts. Delays
+ * double from base_ms up to max_ms and are spread by a random jitter, so a
+ * fleet of nodes that failed together does not retry in lockstep. A server
+ * backoff hint (Retry-After) replaces the computed delay when it is longer.
+ *
+ * The budget starts with the first failure; once the next attempt would fall
+ * after it, the scheduler reports the operation as exhausted so the caller
+ * can hand the data to offline storage and the device can sleep.
+ */
+
+#ifndef RETRY_BACKOFF_H
+#define RETRY_BACKOFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Backoff settings
+ */
+typedef struct {
+    uint32_t base_ms;           ///< Delay after the first failure
+    uint32_t max_ms;            ///< Upper bound for one delay
+    uint8_t jitter_percent;     ///< Delay is drawn from [delay * (100 - jitter) / 100, delay]
+    uint32_t budget_ms;         ///< Time from the first failure after which no attempt is scheduled (0 = unlimited)
+} retry_backoff_config_t;
+
+/**
+ * @brief Retry state of one operation
+ */
+typedef struct {
+    retry_backoff_config_t config;
+    uint32_t failures;          ///< Consecutive failures
+    int64_t first_failure_us;   ///< esp_timer time of the first failure
+    int64_t next_attempt_us;    ///< Earliest time of the next attempt
+    bool exhausted;             ///< Budget used up: give up until retry_backoff_reset()
+} retry_backoff_t;
+
+/**
+ * @brief Initialize the state (no failure pending)
+ *
+ * @param backoff State to initialize
+ * @param config Settings (copied)
+ */
+void retry_backoff_init(retry_backoff_t* backoff, const retry_backoff_config_t* config);
+
+/**
+ * @brief Clear the failures after a success or when the data was handed off
+ *
+ * @param backoff Retry state
+ */
+void retry_backoff_reset(retry_backoff_t* backoff);
+
+/**
+ * @brief Record a failure and schedule the next attempt
+ *
+ * @param backoff Retry state
+ * @param retry_after_ms Server backoff hint (0 = none); used when longer than the computed delay
+ * @return true if another attempt is scheduled, false if the budget is exhausted
+ */
+bool retry_backoff_failed(retry_backoff_t* backoff, uint32_t retry_after_ms);
+
+/**
+ * @brief Whether a failure is waiting for its next attempt
+ *
+ * @param backoff Retry state
+ * @return true between a failure and the next attempt (not after exhaustion)
+ */
+bool retry_backoff_pending(const retry_backoff_t* backoff);
+
+/**
+ * @brief Time until the next attempt is due
+ *
+ * @param backoff Retry state
+ * @return Milliseconds to wait (0 = due now or nothing pending)
+ */
+uint32_t retry_backoff_wait_ms(const retry_backoff_t* backoff);
+
+#endif // RETRY_BACKOFF_H
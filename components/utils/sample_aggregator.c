@@ -0,0 +1,110 @@
+/**
+ * @file sample_aggregator.c
+ * @brief Streaming Windowed Aggregation of Sensor Samples - Implementation
+ */
+
+#include "sample_aggregator.h"
+#include "esp_utils.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include <string.h>
+
+#define AGG_RTC_MAGIC   0x41474731  // "AGG1"
+
+/**
+ * @brief Running window of one metric
+ */
+typedef struct {
+    uint32_t window_s;          ///< Window length the state was built with
+    uint32_t window_index;      ///< Start time / window_s
+    uint32_t count;
+    float min;
+    float max;
+    double sum;                 ///< double keeps long windows of small deltas exact enough
+} agg_metric_state_t;
+
+typedef struct {
+    uint32_t magic;
+    agg_metric_state_t metrics[REPORT_METRIC_COUNT];
+} agg_rtc_state_t;
+
+static RTC_DATA_ATTR agg_rtc_state_t s_rtc;
+
+static void agg_summarize(const agg_metric_state_t* st, sample_window_t* out)
+{
+    out->start_ms = (uint64_t)st->window_index * st->window_s * 1000ULL;
+    out->window_s = st->window_s;
+    out->min = st->min;
+    out->max = st->max;
+    out->mean = (float)(st->sum / st->count);
+    out->count = st->count;
+}
+
+void sample_aggregator_init(void)
+{
+    // RTC contents are only meaningful after a deep-sleep wakeup
+    if (s_rtc.magic != AGG_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = AGG_RTC_MAGIC;
+    }
+}
+
+void sample_aggregator_configure(report_metric_t metric, uint32_t window_s)
+{
+    if (metric >= REPORT_METRIC_COUNT) {
+        return;
+    }
+    agg_metric_state_t* st = &s_rtc.metrics[metric];
+    if (st->window_s != window_s) {
+        memset(st, 0, sizeof(*st));
+        st->window_s = window_s;
+    }
+}
+
+bool sample_aggregator_is_enabled(report_metric_t metric)
+{
+    return metric < REPORT_METRIC_COUNT && s_rtc.metrics[metric].window_s > 0;
+}
+
+bool sample_aggregator_add(report_metric_t metric, float value, sample_window_t* closed)
+{
+    if (!sample_aggregator_is_enabled(metric)) {
+        return false;
+    }
+
+    agg_metric_state_t* st = &s_rtc.metrics[metric];
+    uint32_t index = (uint32_t)(esp_utils_get_timestamp_ms() / 1000 / st->window_s);
+    bool did_close = false;
+
+    // Any other window index (later, or earlier after a clock step) ends the running window
+    if (st->count > 0 && index != st->window_index) {
+        if (closed != NULL) {
+            agg_summarize(st, closed);
+            did_close = true;
+        }
+        st->count = 0;
+    }
+
+    if (st->count == 0) {
+        st->window_index = index;
+        st->min = value;
+        st->max = value;
+        st->sum = 0.0;
+    } else {
+        if (value < st->min) st->min = value;
+        if (value > st->max) st->max = value;
+    }
+    st->sum += value;
+    st->count++;
+    return did_close;
+}
+
+bool sample_aggregator_flush(report_metric_t metric, sample_window_t* closed)
+{
+    if (!sample_aggregator_is_enabled(metric) || closed == NULL || s_rtc.metrics[metric].count == 0) {
+        return false;
+    }
+    agg_summarize(&s_rtc.metrics[metric], closed);
+    s_rtc.metrics[metric].count = 0;
+    return true;
+}
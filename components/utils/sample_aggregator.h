@@ -0,0 +1,77 @@
+/**
+ * @file sample_aggregator.h
+ * @brief Streaming Windowed Aggregation of Sensor Samples
+ *
+ * Folds the samples of a metric into fixed windows aligned to the system
+ * clock (window start = time rounded down to a multiple of the window
+ * length) and keeps only min, max, sum and count. The running windows live
+ * in RTC memory, so one window can collect the samples of several deep-sleep
+ * wakes. A window is closed by the first sample that falls into a later
+ * window, and its summary replaces the raw points in the upload.
+ *
+ * Metrics are the ones of report_policy.h; each metric is expected to be fed
+ * by one task.
+ */
+
+#ifndef SAMPLE_AGGREGATOR_H
+#define SAMPLE_AGGREGATOR_H
+
+#include "report_policy.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Summary of one closed window
+ */
+typedef struct {
+    uint64_t start_ms;          ///< Window start (Unix time in ms)
+    uint32_t window_s;          ///< Window length in seconds
+    float min;                  ///< Smallest sample
+    float max;                  ///< Largest sample
+    float mean;                 ///< Arithmetic mean of the samples
+    uint32_t count;             ///< Number of samples
+} sample_window_t;
+
+/**
+ * @brief Initialize the aggregator state
+ *
+ * Running windows are kept after a deep-sleep wakeup and dropped after any
+ * other reset.
+ */
+void sample_aggregator_init(void);
+
+/**
+ * @brief Enable aggregation of a metric
+ *
+ * Changing the window length discards the running window of the metric.
+ *
+ * @param metric Metric to aggregate
+ * @param window_s Window length in seconds (0 disables aggregation)
+ */
+void sample_aggregator_configure(report_metric_t metric, uint32_t window_s);
+
+/**
+ * @brief Check whether a metric is aggregated
+ */
+bool sample_aggregator_is_enabled(report_metric_t metric);
+
+/**
+ * @brief Add a sample
+ *
+ * @param metric Sampled metric
+ * @param value Sample value
+ * @param closed Receives the summary of the window this sample closed
+ * @return true if a window was closed and closed was filled
+ */
+bool sample_aggregator_add(report_metric_t metric, float value, sample_window_t* closed);
+
+/**
+ * @brief Close the running window early (e.g. before a long shutdown)
+ *
+ * @param metric Metric to flush
+ * @param closed Receives the summary of the partial window
+ * @return true if the window held samples and closed was filled
+ */
+bool sample_aggregator_flush(report_metric_t metric, sample_window_t* closed);
+
+#endif // SAMPLE_AGGREGATOR_H
@@ -0,0 +1,213 @@
+/**
+ * @file time_service.c
+ * @brief Wall Clock Service Across Deep Sleep - Implementation
+ */
+
+#include "time_service.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char* TAG = "TIME_SERVICE";
+
+#define TIME_SERVICE_RTC_MAGIC          0x54535631      // "TSV1"
+#define TIME_SERVICE_MIN_VALID_S        1577836800LL    // 2020-01-01
+#define TIME_SERVICE_DRIFT_WINDOW_MS    (10 * 60 * 1000) // Shorter spans give no usable drift estimate
+
+typedef struct {
+    uint32_t magic;
+    uint8_t source;                 // time_source_t
+    bool drift_measured;
+    int32_t drift_ppm;
+    int32_t last_step_ms;
+    uint32_t corrections;
+    uint64_t last_sync_ms;
+    int64_t first_step_ms;          // Step of the first correction: boot-relative stamps to wall clock
+} time_service_rtc_t;
+
+static RTC_DATA_ATTR time_service_rtc_t s_rtc;
+static time_service_config_t s_config = {
+    .resync_interval_s = 6 * 60 * 60,
+    .max_error_ms = 500,
+    .assumed_drift_ppm = 150,
+};
+static int64_t s_base_us = 0;       // Wall clock minus monotonic clock when last checked
+
+static int64_t wall_clock_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static const char* source_name(time_source_t source)
+{
+    switch (source) {
+        case TIME_SOURCE_NTP:       return "NTP";
+        case TIME_SOURCE_HTTP_DATE: return "HTTP Date";
+        default:                    return "none";
+    }
+}
+
+static uint32_t estimated_error_ms(void)
+{
+    if (s_rtc.source == TIME_SOURCE_NONE) {
+        return UINT32_MAX;
+    }
+    uint64_t now_ms = (uint64_t)(wall_clock_us() / 1000);
+    uint64_t elapsed_ms = (now_ms > s_rtc.last_sync_ms) ? now_ms - s_rtc.last_sync_ms : 0;
+    uint64_t error_ms = elapsed_ms * (uint64_t)abs(s_rtc.drift_ppm) / 1000000ULL;
+    return (error_ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)error_ms;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int year, int month, int day)
+{
+    year -= (month <= 2);
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void time_service_init(const time_service_config_t* config)
+{
+    if (config != NULL) {
+        s_config = *config;
+    }
+
+    // The wall clock only keeps running across deep sleep; any other reset restarts it
+    if (s_rtc.magic != TIME_SERVICE_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = TIME_SERVICE_RTC_MAGIC;
+    }
+    if (!s_rtc.drift_measured) {
+        s_rtc.drift_ppm = (int32_t)s_config.assumed_drift_ppm;
+    }
+    s_base_us = wall_clock_us() - esp_timer_get_time();
+
+    if (s_rtc.source != TIME_SOURCE_NONE) {
+        ESP_LOGI(TAG, "Clock set by %s %llu s ago (est. error %lu ms, drift %ld ppm%s)",
+                 source_name((time_source_t)s_rtc.source),
+                 (unsigned long long)(((uint64_t)(wall_clock_us() / 1000) - s_rtc.last_sync_ms) / 1000),
+                 (unsigned long)estimated_error_ms(), (long)s_rtc.drift_ppm,
+                 s_rtc.drift_measured ? "" : " assumed");
+    }
+}
+
+bool time_service_is_valid(void)
+{
+    return s_rtc.source != TIME_SOURCE_NONE;
+}
+
+bool time_service_sync_due(void)
+{
+    if (s_rtc.source == TIME_SOURCE_NONE) {
+        return true;
+    }
+    uint64_t now_ms = (uint64_t)(wall_clock_us() / 1000);
+    if (now_ms < s_rtc.last_sync_ms ||
+        now_ms - s_rtc.last_sync_ms >= (uint64_t)s_config.resync_interval_s * 1000ULL) {
+        return true;
+    }
+    return estimated_error_ms() > s_config.max_error_ms;
+}
+
+void time_service_clock_set(time_source_t source)
+{
+    int64_t base_us = wall_clock_us() - esp_timer_get_time();
+    int64_t step_ms = (base_us - s_base_us) / 1000;
+    uint64_t now_ms = (uint64_t)(wall_clock_us() / 1000);
+    s_base_us = base_us;
+
+    // Only NTP-to-NTP spans are precise enough to measure the drift
+    if (source == TIME_SOURCE_NTP && s_rtc.source == TIME_SOURCE_NTP &&
+        now_ms > s_rtc.last_sync_ms + TIME_SERVICE_DRIFT_WINDOW_MS) {
+        int64_t drift = -step_ms * 1000000LL / (int64_t)(now_ms - s_rtc.last_sync_ms);
+        s_rtc.drift_ppm = s_rtc.drift_measured ? (int32_t)((s_rtc.drift_ppm + drift) / 2) : (int32_t)drift;
+        s_rtc.drift_measured = true;
+    }
+
+    bool first = (s_rtc.source == TIME_SOURCE_NONE);
+    if (first) {
+        s_rtc.first_step_ms = step_ms;
+    }
+    s_rtc.source = (uint8_t)source;
+    s_rtc.last_sync_ms = now_ms;
+    s_rtc.last_step_ms = (step_ms > INT32_MAX || step_ms < INT32_MIN) ? INT32_MAX : (int32_t)step_ms;
+    s_rtc.corrections++;
+
+    if (first) {
+        ESP_LOGI(TAG, "Clock set by %s", source_name(source));
+    } else {
+        ESP_LOGI(TAG, "Clock corrected by %s: step %ld ms, drift %ld ppm%s", source_name(source),
+                 (long)s_rtc.last_step_ms, (long)s_rtc.drift_ppm, s_rtc.drift_measured ? "" : " (assumed)");
+    }
+}
+
+esp_err_t time_service_apply_http_date(const char* date, uint32_t min_step_ms)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    if (date == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char mon[4] = {0};
+    int day, year, hour, min, sec;
+    if (sscanf(date, "%*3s, %d %3s %d %d:%d:%d", &day, mon, &year, &hour, &min, &sec) != 6) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char* m = strstr(months, mon);
+    if (m == NULL || strlen(mon) != 3 || (m - months) % 3 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t epoch_s = days_from_civil(year, (int)(m - months) / 3 + 1, day) * 86400LL +
+                      hour * 3600LL + min * 60LL + sec;
+    if (epoch_s < TIME_SERVICE_MIN_VALID_S) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The header truncates to the second: its midpoint is the best estimate
+    int64_t date_us = epoch_s * 1000000LL + 500000LL;
+    int64_t error_ms = (date_us - wall_clock_us()) / 1000;
+    if (s_rtc.source != TIME_SOURCE_NONE && llabs(error_ms) <= (int64_t)min_step_ms) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct timeval tv = {
+        .tv_sec = (time_t)(date_us / 1000000LL),
+        .tv_usec = (suseconds_t)(date_us % 1000000LL),
+    };
+    settimeofday(&tv, NULL);
+    time_service_clock_set(TIME_SOURCE_HTTP_DATE);
+    return ESP_OK;
+}
+
+uint64_t time_service_resolve_ms(uint64_t timestamp_ms)
+{
+    if (s_rtc.source == TIME_SOURCE_NONE || timestamp_ms >= (uint64_t)TIME_SERVICE_MIN_VALID_S * 1000ULL) {
+        return timestamp_ms;
+    }
+    return (uint64_t)((int64_t)timestamp_ms + s_rtc.first_step_ms);
+}
+
+void time_service_get_status(time_service_status_t* status)
+{
+    if (status == NULL) {
+        return;
+    }
+    status->source = (time_source_t)s_rtc.source;
+    status->last_sync_ms = s_rtc.last_sync_ms;
+    status->drift_ppm = s_rtc.drift_ppm;
+    status->drift_measured = s_rtc.drift_measured;
+    status->est_error_ms = estimated_error_ms();
+    status->last_step_ms = s_rtc.last_step_ms;
+    status->corrections = s_rtc.corrections;
+}
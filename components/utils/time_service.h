@@ -0,0 +1,116 @@
+/**
+ * @file time_service.h
+ * @brief Wall Clock Service Across Deep Sleep
+ *
+ * The system time keeps running in the RTC during deep sleep, so once it was
+ * set it is usable from the first instruction of every later wake. This module
+ * remembers in RTC memory when and from which source the clock was last
+ * corrected and how fast it drifted between corrections, and tells the
+ * application when a new SNTP sync is actually due:
+ *   - never set since power-on,
+ *   - last correction older than resync_interval_s, or
+ *   - estimated drift since the last correction above max_error_ms.
+ *
+ * Between syncs the clock can also be stepped from the Date header of an HTTP
+ * response (one second resolution), which keeps devices without NTP on time.
+ */
+
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Source of the last clock correction
+ */
+typedef enum {
+    TIME_SOURCE_NONE = 0,           ///< Clock not set since power-on
+    TIME_SOURCE_NTP,                ///< SNTP sync
+    TIME_SOURCE_HTTP_DATE,          ///< HTTP response Date header
+} time_source_t;
+
+/**
+ * @brief Re-sync policy
+ */
+typedef struct {
+    uint32_t resync_interval_s;     ///< Re-sync at least this often
+    uint32_t max_error_ms;          ///< Re-sync once the estimated drift exceeds this
+    uint32_t assumed_drift_ppm;     ///< Drift assumed until two syncs measured it
+} time_service_config_t;
+
+/**
+ * @brief Clock state
+ */
+typedef struct {
+    time_source_t source;           ///< Source of the last correction
+    uint64_t last_sync_ms;          ///< Wall clock of the last correction
+    int32_t drift_ppm;              ///< Clock drift (positive: runs fast), assumed value until measured
+    bool drift_measured;            ///< drift_ppm comes from two syncs
+    uint32_t est_error_ms;          ///< Estimated error now
+    int32_t last_step_ms;           ///< Step applied by the last correction
+    uint32_t corrections;           ///< Corrections since power-on
+} time_service_status_t;
+
+/**
+ * @brief Restore the clock state (call first thing on every wake)
+ *
+ * The state survives deep sleep only; after any other reset the clock counts as not set.
+ *
+ * @param config Re-sync policy (copied)
+ */
+void time_service_init(const time_service_config_t* config);
+
+/**
+ * @brief Check whether the wall clock has been set since power-on
+ */
+bool time_service_is_valid(void);
+
+/**
+ * @brief Check whether an SNTP sync should be started on this wake
+ */
+bool time_service_sync_due(void);
+
+/**
+ * @brief Record that the system time was just set by a sync
+ *
+ * The step is measured against the in-wake monotonic clock, so the caller
+ * only reports the source (e.g. from the SNTP notification callback).
+ *
+ * @param source Source that set the clock
+ */
+void time_service_clock_set(time_source_t source);
+
+/**
+ * @brief Step the clock from an HTTP Date header ("Tue, 14 Oct 2026 08:49:37 GMT")
+ *
+ * The clock is only stepped when it was never set or is off by more than
+ * min_step_ms, since the header has one second resolution.
+ *
+ * @param date Header value (IMF-fixdate)
+ * @param min_step_ms Smallest error that is corrected
+ * @return esp_err_t ESP_OK if stepped, ESP_ERR_INVALID_STATE if within min_step_ms,
+ *         ESP_ERR_INVALID_ARG if the header cannot be parsed
+ */
+esp_err_t time_service_apply_http_date(const char* date, uint32_t min_step_ms);
+
+/**
+ * @brief Map a timestamp taken before the clock was set to wall-clock time
+ *
+ * Until the first correction after power-on the system time counts from
+ * boot (uptime plus the time slept), so such a stamp is moved by the step of
+ * that first correction. Stamps that are already valid are returned unchanged,
+ * as is everything while the clock is still not set.
+ *
+ * @param timestamp_ms Timestamp read from the system clock (ms)
+ * @return Wall-clock timestamp in ms
+ */
+uint64_t time_service_resolve_ms(uint64_t timestamp_ms);
+
+/**
+ * @brief Get the clock state
+ */
+void time_service_get_status(time_service_status_t* status);
+
+#endif // TIME_SERVICE_H
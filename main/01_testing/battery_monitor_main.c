@@ -1,15 +1,43 @@
 #include "battery_monitor_main.h"
 #include "esp_log.h"
-
-
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 static const char *TAG = "BATTERY_MONITOR_TESTING";
 
 void app_main(void) {
     ESP_LOGI(TAG, "Starting Battery Monitoring Testing");
 
-    battery_monitor_start();
+    // ADC path alone: one direct reading
+    float voltage = 0.0f;
+    ESP_ERROR_CHECK(battery_monitor_init());
+    if (battery_monitor_read_voltage(&voltage) == ESP_OK) {
+        ESP_LOGI(TAG, "Direct reading: %.3f V", voltage);
+    }
+    battery_monitor_deinit();
+
+    // Same sensor through the runtime, one cycle per BATTERY_MONITOR_MEASUREMENT_INTERVAL_MS
+    ESP_ERROR_CHECK(cycle_scheduler_init());
+    ESP_ERROR_CHECK(battery_monitor_register(BATTERY_MEASUREMENTS_PER_CYCLE));
+
+    while (1) {
+        cycle_scheduler_begin(CYCLE_JOB_BATTERY);
+        esp_err_t ret = sensor_runtime_start(CYCLE_JOB_BATTERY);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start sensor pass: %s", esp_err_to_name(ret));
+            break;
+        }
+        if (cycle_scheduler_join(CYCLE_DEADLINE_MS, NULL) != ESP_OK) {
+            ESP_LOGW(TAG, "Battery reading not finished in time");
+            sensor_runtime_stop(CYCLE_DEADLINE_MS);
+        } else if (battery_monitor_get_last_voltage(&voltage) == ESP_OK) {
+            ESP_LOGI(TAG, "Runtime reading: %.3f V%s", voltage,
+                     battery_monitor_is_critical() ? " (critical)" : "");
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(BATTERY_MONITOR_MEASUREMENT_INTERVAL_MS));
+    }
 
     // Cleanup
-    
+    battery_monitor_deinit();
 }
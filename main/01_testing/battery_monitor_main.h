@@ -6,6 +6,8 @@
 #include "../config/credentials.h"
 
 #include "../application/battery_monitor_task.h"
+#include "../application/cycle_scheduler.h"
+#include "../application/sensor_runtime.h"
 
 
 /**
@@ -0,0 +1,335 @@
+#include "bench_cases.h"
+#include "line_protocol.h"
+#include "mqtt_payload.h"
+#include "sample_frame.h"
+#include "sample_block.h"
+#include "gzip_deflate.h"
+#include "espnow_fragment.h"
+#include "epaper_driver.h"
+#include "http_buffer.h"
+#if BENCH_BATCH_CASES
+#include "influxdb_client.h"
+#endif
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SOIL_POINTS       32
+#define BENCH_GZIP_IN_SIZE      4096    // 32 soil lines of line protocol
+
+// Shared state of the cases; only one case runs at a time
+static struct {
+    char lp_buf[768];
+    uint8_t out_buf[SAMPLE_FRAME_MAX_SIZE];
+    espnow_packet_t packets[ESPNOW_MAX_CHUNKS];
+#if BENCH_BATCH_CASES
+    influxdb_batch_t batch;
+#endif
+    char *gzip_in;
+    size_t gzip_in_len;
+    uint8_t *gzip_out;
+    epaper_driver_t epaper;
+} s_bench;
+
+// ============================================================================
+// Line protocol
+// ============================================================================
+
+static size_t bench_lp_env(void *ctx)
+{
+    lp_writer_t w;
+    lp_writer_init(&w, s_bench.lp_buf, sizeof(s_bench.lp_buf), 0);
+    lp_begin(&w, "environment");
+    lp_tag(&w, "device", "ESP32C6_A1B2C3");
+    lp_tag(&w, "sensor", "AHT20");
+    lp_field_float(&w, "temperature", 23.456f, 2);
+    lp_field_float(&w, "humidity", 45.678f, 2);
+    lp_timestamp(&w, 1760000000123456789ULL);
+    return lp_end(&w) == ESP_OK ? w.len : 0;
+}
+
+#if BENCH_BATCH_CASES
+static esp_err_t bench_batch_setup(void *ctx)
+{
+    return influxdb_batch_init(&s_bench.batch, 0);
+}
+
+// 32 soil points through the batch builder (includes its buffer growth)
+static size_t bench_batch_soil(void *ctx)
+{
+    influxdb_soil_data_t point = {
+        .voltage = 1.234f,
+        .moisture_percent = 56.78f,
+        .raw_adc = 2345,
+    };
+    strncpy(point.device_id, "ESP32C6_A1B2C3", sizeof(point.device_id) - 1);
+
+    influxdb_batch_reset(&s_bench.batch);
+    for (int i = 0; i < BENCH_SOIL_POINTS; i++) {
+        point.timestamp_ns = 1760000000000000000ULL + (uint64_t)i * 1000000000ULL;
+        if (influxdb_batch_add_soil(&s_bench.batch, &point) != ESP_OK) {
+            return 0;
+        }
+    }
+    return s_bench.batch.length;
+}
+
+static void bench_batch_teardown(void *ctx)
+{
+    influxdb_batch_free(&s_bench.batch);
+}
+#endif
+
+// ============================================================================
+// MQTT payloads (same fields as a soil message in mqtt_sender.c)
+// ============================================================================
+
+static size_t bench_mqtt_soil(void *ctx)
+{
+    mqtt_payload_t p;
+    mqtt_payload_init(&p, (mqtt_payload_format_t)(intptr_t)ctx, s_bench.out_buf, sizeof(s_bench.out_buf));
+    mqtt_payload_string(&p, "device_id", "ESP32C6_A1B2C3");
+    mqtt_payload_uint(&p, "timestamp", 1760000000123ULL);
+    mqtt_payload_float(&p, "voltage", 1.234f, 3);
+    mqtt_payload_float(&p, "moisture_percent", 56.78f, 2);
+    mqtt_payload_int(&p, "raw_adc", 2345);
+    return mqtt_payload_end(&p) == ESP_OK ? p.len : 0;
+}
+
+// ============================================================================
+// Sample frames
+// ============================================================================
+
+// Fill a frame with soil samples and decode it again
+static size_t bench_sample_frame(void *ctx)
+{
+    sample_frame_writer_t w;
+    sample_frame_record_t rec = {
+        .type = SAMPLE_FRAME_SOIL,
+        .device_id = "ESP32C6_A1B2C3",
+        .aux = 2345,
+        .v = { 1.234f, 56.78f, 0.0f },
+    };
+
+    sample_frame_writer_init(&w, s_bench.out_buf, sizeof(s_bench.out_buf), 1760000000000ULL);
+    for (int i = 0; i < 64; i++) {
+        rec.timestamp_ms = 1760000000000ULL - (uint64_t)(64 - i) * 1000ULL;
+        if (sample_frame_add(&w, &rec) != ESP_OK) {
+            break;
+        }
+    }
+    size_t len = sample_frame_finish(&w);
+
+    sample_frame_reader_t r;
+    if (sample_frame_reader_init(&r, s_bench.out_buf, len) != ESP_OK) {
+        return 0;
+    }
+    while (sample_frame_next(&r, &rec) == ESP_OK) {
+    }
+    return len;
+}
+
+// Same samples as a compressed block (backlog format)
+static size_t bench_sample_block(void *ctx)
+{
+    static sample_block_writer_t w;     // Series and device tables: too large for the bench stack
+    static sample_block_reader_t r;
+    sample_frame_record_t rec = {
+        .type = SAMPLE_FRAME_SOIL,
+        .device_id = "ESP32C6_A1B2C3",
+        .aux = 2345,
+        .v = { 1.234f, 56.78f, 0.0f },
+    };
+
+    sample_block_writer_init(&w, s_bench.out_buf, sizeof(s_bench.out_buf), 1760000000000ULL, 1000, 0);
+    for (int i = 0; i < 64; i++) {
+        rec.timestamp_ms = 1760000000000ULL - (uint64_t)(64 - i) * 1000ULL;
+        rec.aux = 2345 + (i & 3);
+        if (sample_block_add(&w, &rec) != ESP_OK) {
+            break;
+        }
+    }
+    size_t len = sample_block_finish(&w);
+
+    if (sample_block_reader_init(&r, s_bench.out_buf, len) != ESP_OK) {
+        return 0;
+    }
+    while (sample_block_next(&r, &rec) == ESP_OK) {
+    }
+    return len;
+}
+
+// ============================================================================
+// gzip
+// ============================================================================
+
+static void bench_gzip_teardown(void *ctx)
+{
+    free(s_bench.gzip_in);
+    free(s_bench.gzip_out);
+    s_bench.gzip_in = NULL;
+    s_bench.gzip_out = NULL;
+}
+
+// A batch body of 32 soil points (the lines influxdb_batch_add_soil writes) as the input
+static esp_err_t bench_gzip_setup(void *ctx)
+{
+    s_bench.gzip_in = malloc(BENCH_GZIP_IN_SIZE);
+    s_bench.gzip_out = malloc(BENCH_GZIP_IN_SIZE);
+    if (s_bench.gzip_in == NULL || s_bench.gzip_out == NULL) {
+        bench_gzip_teardown(ctx);
+        return ESP_ERR_NO_MEM;
+    }
+
+    lp_writer_t w;
+    lp_writer_init(&w, s_bench.gzip_in, BENCH_GZIP_IN_SIZE, 0);
+    for (int i = 0; i < BENCH_SOIL_POINTS; i++) {
+        lp_begin(&w, "soil_moisture");
+        lp_tag(&w, "device", "ESP32C6_A1B2C3");
+        lp_field_float(&w, "voltage", 1.234f, 3);
+        lp_field_float(&w, "moisture_percent", 56.78f, 2);
+        lp_field_float(&w, "raw_adc", 2345.0f, 0);
+        lp_timestamp(&w, 1760000000000000000ULL + (uint64_t)i * 1000000000ULL);
+        if (lp_end(&w) != ESP_OK) {
+            bench_gzip_teardown(ctx);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_bench.gzip_in_len = w.len;
+    return ESP_OK;
+}
+
+static size_t bench_gzip(void *ctx)
+{
+    size_t out_len = 0;
+    if (gzip_compress((const uint8_t *)s_bench.gzip_in, s_bench.gzip_in_len,
+                      s_bench.gzip_out, s_bench.gzip_in_len, &out_len) != ESP_OK) {
+        return 0;
+    }
+    return out_len;
+}
+
+// ============================================================================
+// ESP-NOW
+// ============================================================================
+
+static esp_err_t bench_espnow_setup(void *ctx)
+{
+    for (size_t i = 0; i < sizeof(s_bench.out_buf); i++) {
+        s_bench.out_buf[i] = (uint8_t)(i * 31u + 7u);
+    }
+    return ESP_OK;
+}
+
+// One maximum size ESP-NOW payload
+static size_t bench_crc(void *ctx)
+{
+    volatile uint16_t crc = espnow_crc16(s_bench.out_buf, ESPNOW_MAX_PAYLOAD_SIZE);
+    (void)crc;
+    return ESPNOW_MAX_PAYLOAD_SIZE;
+}
+
+// The largest sample frame into packets with header CRCs
+static size_t bench_fragment(void *ctx)
+{
+    uint8_t total = espnow_fragment(s_bench.packets, s_bench.out_buf, sizeof(s_bench.out_buf),
+                                    5, 0x1234, true, true);
+    return total > 0 ? sizeof(s_bench.out_buf) : 0;
+}
+
+// ============================================================================
+// E-paper text (framebuffer only, no SPI)
+// ============================================================================
+
+static esp_err_t bench_epaper_setup(void *ctx)
+{
+    memset(&s_bench.epaper, 0, sizeof(s_bench.epaper));
+    epaper_get_default_config(&s_bench.epaper.config, EPAPER_MODEL_290_128x296);
+    s_bench.epaper.fb_size = ((s_bench.epaper.config.width + 7) / 8) * s_bench.epaper.config.height;
+    s_bench.epaper.framebuffer = calloc(1, s_bench.epaper.fb_size);
+    return s_bench.epaper.framebuffer != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// The text of one display update
+static size_t bench_epaper_text(void *ctx)
+{
+    epaper_driver_t *d = &s_bench.epaper;
+    if (epaper_draw_text(d, 4, 4, "Soil 56.8%", 2, EPAPER_ALIGN_LEFT) != ESP_OK ||
+        epaper_draw_text(d, 4, 28, "Batt 3.92V 87%", 1, EPAPER_ALIGN_LEFT) != ESP_OK ||
+        epaper_draw_text(d, 4, 40, "23.4C 45.7%RH", 1, EPAPER_ALIGN_LEFT) != ESP_OK ||
+        epaper_draw_text_font(d, 0, 60, "56.8%", &epaper_font_numerals_24, EPAPER_ALIGN_CENTER) != ESP_OK) {
+        return 0;
+    }
+    return d->fb_size;
+}
+
+static void bench_epaper_teardown(void *ctx)
+{
+    free(s_bench.epaper.framebuffer);
+    s_bench.epaper.framebuffer = NULL;
+}
+
+// ============================================================================
+// HTTP buffer (flash ring log)
+// ============================================================================
+
+#if BENCH_FLASH_CASES
+static esp_err_t bench_http_buffer_setup(void *ctx)
+{
+    http_buffer_config_t config = {
+        .max_buffered_packets = 0,      // Driver default
+        .enable_buffering = true,
+    };
+    esp_err_t ret = http_buffer_init(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return http_buffer_clear_all();
+}
+
+static esp_err_t bench_http_buffer_discard(const char *json_payload)
+{
+    return ESP_OK;
+}
+
+// Buffer one line protocol point and drain it again
+static size_t bench_http_buffer(void *ctx)
+{
+    size_t len = bench_lp_env(ctx);
+    if (len == 0 ||
+        http_buffer_add_packet(s_bench.lp_buf) != ESP_OK ||
+        http_buffer_flush_packets(bench_http_buffer_discard) != ESP_OK) {
+        return 0;
+    }
+    return len;
+}
+
+static void bench_http_buffer_teardown(void *ctx)
+{
+    http_buffer_deinit();
+}
+#endif
+
+// ============================================================================
+// Case table
+// ============================================================================
+
+const bench_case_t bench_cases[] = {
+    { "lp_env_point",    NULL,                    bench_lp_env,       NULL,                  NULL },
+#if BENCH_BATCH_CASES
+    { "batch_32_soil",   bench_batch_setup,       bench_batch_soil,   bench_batch_teardown,  NULL },
+#endif
+    { "mqtt_soil_json",  NULL,                    bench_mqtt_soil,    NULL,                  (void *)MQTT_PAYLOAD_JSON },
+    { "mqtt_soil_cbor",  NULL,                    bench_mqtt_soil,    NULL,                  (void *)MQTT_PAYLOAD_CBOR },
+    { "sample_frame_64", NULL,                    bench_sample_frame, NULL,                  NULL },
+    { "sample_block_64", NULL,                    bench_sample_block, NULL,                  NULL },
+    { "gzip_batch",      bench_gzip_setup,        bench_gzip,         bench_gzip_teardown,   NULL },
+    { "espnow_crc16",    bench_espnow_setup,      bench_crc,          NULL,                  NULL },
+    { "espnow_frag_1k",  bench_espnow_setup,      bench_fragment,     NULL,                  NULL },
+    { "epaper_text",     bench_epaper_setup,      bench_epaper_text,  bench_epaper_teardown, NULL },
+#if BENCH_FLASH_CASES
+    { "http_buffer_rt",  bench_http_buffer_setup, bench_http_buffer,  bench_http_buffer_teardown, NULL },
+#endif
+};
+
+const size_t bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
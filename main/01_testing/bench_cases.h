@@ -0,0 +1,40 @@
+#ifndef BENCH_CASES_H
+#define BENCH_CASES_H
+
+#include "esp_err.h"
+#include <stddef.h>
+
+// Also run the http_buffer cases. On a board they erase and write the HTTP
+// buffer partition, so they are off by default there; the host build turns
+// them on (its partition is RAM).
+#ifndef BENCH_FLASH_CASES
+#define BENCH_FLASH_CASES       0
+#endif
+
+// Also run the InfluxDB batch builder. influxdb_client.c needs the HTTP
+// client, so the host build leaves it out.
+#ifndef BENCH_BATCH_CASES
+#define BENCH_BATCH_CASES       1
+#endif
+
+/**
+ * @brief One benchmark case
+ *
+ * setup() and teardown() run outside the measurement; run() is one iteration
+ * and returns the bytes it produced (0 on failure). All three get ctx.
+ * The cases are shared by main/01_testing/encoder_bench_main.c (on the board)
+ * and test/host/bench_codecs.c (on the host); the runners add the timing,
+ * allocation counting and stack measurement.
+ */
+typedef struct {
+    const char *name;
+    esp_err_t (*setup)(void *ctx);
+    size_t (*run)(void *ctx);
+    void (*teardown)(void *ctx);
+    void *ctx;
+} bench_case_t;
+
+extern const bench_case_t bench_cases[];
+extern const size_t bench_case_count;
+
+#endif // BENCH_CASES_H
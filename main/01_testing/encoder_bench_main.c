@@ -0,0 +1,124 @@
+#include "encoder_bench_main.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#if CONFIG_HEAP_TRACING_STANDALONE
+#include "esp_heap_trace.h"
+#define BENCH_TRACE_RECORDS     64
+static heap_trace_record_t s_trace_records[BENCH_TRACE_RECORDS];
+#endif
+
+static const char *TAG = "ENCODER_BENCH";
+
+typedef struct {
+    int64_t elapsed_us;             // BENCH_ITERATIONS iterations
+    size_t bytes;                   // Output of one iteration
+    uint32_t allocs;                // Heap allocations per iteration (tracing only)
+    int32_t heap_delta;             // Free heap after - before (negative = leak)
+    uint32_t peak_stack;            // Bytes of BENCH_TASK_STACK used
+    bool ok;
+} bench_result_t;
+
+static struct {
+    const bench_case_t *bench;
+    bench_result_t result;
+    SemaphoreHandle_t done;
+} s_run;
+
+// Runs one case on a fresh task, so the stack high-water mark is the case's own
+static void bench_task(void *arg)
+{
+    const bench_case_t *bench = s_run.bench;
+    bench_result_t *res = &s_run.result;
+    memset(res, 0, sizeof(*res));
+
+    if (bench->setup != NULL && bench->setup(bench->ctx) != ESP_OK) {
+        xSemaphoreGive(s_run.done);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    // Warm-up: first-use allocations and cache misses stay out of the numbers
+    res->bytes = bench->run(bench->ctx);
+    res->ok = res->bytes > 0;
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#if CONFIG_HEAP_TRACING_STANDALONE
+    heap_trace_start(HEAP_TRACE_ALL);
+#endif
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ITERATIONS && res->ok; i++) {
+        res->ok = bench->run(bench->ctx) > 0;
+    }
+    res->elapsed_us = esp_timer_get_time() - start_us;
+#if CONFIG_HEAP_TRACING_STANDALONE
+    heap_trace_stop();
+    heap_trace_summary_t summary;
+    if (heap_trace_summary(&summary) == ESP_OK) {
+        res->allocs = summary.total_allocations / BENCH_ITERATIONS;
+    }
+#endif
+    res->heap_delta = (int32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT) - (int32_t)free_before;
+    res->peak_stack = BENCH_TASK_STACK - uxTaskGetStackHighWaterMark(NULL);
+
+    if (bench->teardown != NULL) {
+        bench->teardown(bench->ctx);
+    }
+    xSemaphoreGive(s_run.done);
+    vTaskDelete(NULL);
+}
+
+void app_main(void) {
+    ESP_LOGI(TAG, "Starting Encoder Benchmark - %d iterations per case", BENCH_ITERATIONS);
+
+    s_run.done = xSemaphoreCreateBinary();
+    if (s_run.done == NULL) {
+        ESP_LOGE(TAG, "❌ Failed to create semaphore");
+        return;
+    }
+#if CONFIG_HEAP_TRACING_STANDALONE
+    heap_trace_init_standalone(s_trace_records, BENCH_TRACE_RECORDS);
+#endif
+
+    size_t min_free_start = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+
+    ESP_LOGI(TAG, "%-16s %10s %10s %8s %7s %7s %6s",
+             "case", "us/iter", "KB/s", "bytes", "allocs", "heap", "stack");
+    for (size_t i = 0; i < bench_case_count; i++) {
+        s_run.bench = &bench_cases[i];
+
+        if (xTaskCreate(bench_task, "bench", BENCH_TASK_STACK, NULL, BENCH_TASK_PRIO, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "❌ Failed to create benchmark task");
+            return;
+        }
+        xSemaphoreTake(s_run.done, portMAX_DELAY);
+
+        const bench_result_t *res = &s_run.result;
+        if (!res->ok) {
+            ESP_LOGE(TAG, "%-16s failed", s_run.bench->name);
+            continue;
+        }
+        float us_per_iter = (float)res->elapsed_us / BENCH_ITERATIONS;
+        float kb_per_s = us_per_iter > 0.0f ? (res->bytes / 1024.0f) * (1000000.0f / us_per_iter) : 0.0f;
+#if CONFIG_HEAP_TRACING_STANDALONE
+        char allocs[12];
+        snprintf(allocs, sizeof(allocs), "%lu", (unsigned long)res->allocs);
+#else
+        const char *allocs = "-";
+#endif
+        ESP_LOGI(TAG, "%-16s %10.2f %10.1f %8u %7s %7ld %6lu",
+                 s_run.bench->name, us_per_iter, kb_per_s, (unsigned)res->bytes,
+                 allocs, (long)res->heap_delta, (unsigned long)res->peak_stack);
+    }
+
+    ESP_LOGI(TAG, "Heap: %u bytes free, minimum %u (%u at start)",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             (unsigned)min_free_start);
+    ESP_LOGI(TAG, "✅ Benchmark finished");
+}
@@ -0,0 +1,30 @@
+#ifndef ENCODER_BENCH_MAIN_H
+#define ENCODER_BENCH_MAIN_H
+
+#include <stdio.h>
+#include "esp_system.h"
+#include "esp_log.h"
+
+// Project configuration
+#include "../config/esp32-config.h"
+
+// The cases (shared with the host benchmark in test/host)
+#include "bench_cases.h"
+
+// Iterations per case (after one warm-up iteration)
+#define BENCH_ITERATIONS        200
+
+// Stack of the task each case runs on; peak stack is reported against it
+#define BENCH_TASK_STACK        (8 * 1024)
+#define BENCH_TASK_PRIO         5
+
+/**
+ * @brief Main application entry point
+ *
+ * Runs every benchmark case once and logs one result line per case:
+ * time per iteration, throughput, heap allocations, net heap change and
+ * peak stack. No WiFi or sensors are needed.
+ */
+void app_main(void);
+
+#endif // ENCODER_BENCH_MAIN_H
@@ -0,0 +1,436 @@
+#include "upload_bench_main.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "esp_utils.h"
+#include "time_service.h"
+#include "ntp_time.h"
+#include "perf_profiler.h"
+#include "resource_tracker.h"
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "UPLOAD_BENCH";
+
+typedef enum {
+    BENCH_PATH_INFLUX,
+    BENCH_PATH_MQTT,
+    BENCH_PATH_ESPNOW,
+} bench_path_t;
+
+static const char *const s_path_names[] = {
+    [BENCH_PATH_INFLUX] = "influx",
+    [BENCH_PATH_MQTT]   = "mqtt",
+    [BENCH_PATH_ESPNOW] = "espnow",
+};
+
+// Statistics of the path being measured (one path runs at a time)
+static struct {
+    bench_path_t path;
+    uint32_t generated;             // Points produced by the generator
+    uint32_t rejected;              // Enqueue failed (queue full) or no pending slot
+    uint32_t delivered;             // Acked as written / published / sent
+    uint32_t lost;                  // Acked as stored, dropped or not sent
+    size_t bytes;                   // Request bodies / payloads / frames on the wire
+    int64_t start_us;
+    int64_t last_ack_us;
+    size_t min_free_heap;           // Lowest free heap seen during the run
+
+    // Enqueue times of points in flight, in queue order (generator pushes, ack pops)
+    int64_t pending_us[UPLOAD_BENCH_MAX_PENDING];
+    uint32_t pending_head;
+    uint32_t pending_tail;
+
+    uint32_t latency_ms[UPLOAD_BENCH_MAX_LATENCIES];
+    uint32_t latency_count;
+} s_bench;
+
+static portMUX_TYPE s_bench_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================================================
+// Latency bookkeeping
+// ============================================================================
+
+static bool bench_pending_push(int64_t now_us)
+{
+    bool ok = false;
+    taskENTER_CRITICAL(&s_bench_lock);
+    if (s_bench.pending_head - s_bench.pending_tail < UPLOAD_BENCH_MAX_PENDING) {
+        s_bench.pending_us[s_bench.pending_head % UPLOAD_BENCH_MAX_PENDING] = now_us;
+        s_bench.pending_head++;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&s_bench_lock);
+    return ok;
+}
+
+// Take back the point pushed last (its enqueue failed, so no ack will come)
+static void bench_pending_unpush(void)
+{
+    taskENTER_CRITICAL(&s_bench_lock);
+    s_bench.pending_head--;
+    taskEXIT_CRITICAL(&s_bench_lock);
+}
+
+static void bench_record(int64_t enqueued_us, int64_t now_us, bool delivered)
+{
+    if (!delivered) {
+        s_bench.lost++;
+        return;
+    }
+    s_bench.delivered++;
+    if (s_bench.latency_count < UPLOAD_BENCH_MAX_LATENCIES) {
+        s_bench.latency_ms[s_bench.latency_count++] = (uint32_t)((now_us - enqueued_us) / 1000);
+    }
+}
+
+// Ack callback of both senders: the oldest points in flight are done
+static void bench_ack(uint32_t points, bool delivered, size_t bytes)
+{
+    int64_t now_us = esp_timer_get_time();
+    s_bench.bytes += bytes;
+    s_bench.last_ack_us = now_us;
+
+    for (uint32_t i = 0; i < points; i++) {
+        int64_t enqueued_us;
+        taskENTER_CRITICAL(&s_bench_lock);
+        bool have = s_bench.pending_tail != s_bench.pending_head;
+        if (have) {
+            enqueued_us = s_bench.pending_us[s_bench.pending_tail % UPLOAD_BENCH_MAX_PENDING];
+            s_bench.pending_tail++;
+        }
+        taskEXIT_CRITICAL(&s_bench_lock);
+        if (!have) {
+            return;     // Not a benchmark point (e.g. replayed from the backlog)
+        }
+        bench_record(enqueued_us, now_us, delivered);
+    }
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t bench_percentile(uint32_t pct)
+{
+    if (s_bench.latency_count == 0) {
+        return 0;
+    }
+    uint32_t idx = (s_bench.latency_count * pct) / 100;
+    return s_bench.latency_ms[idx < s_bench.latency_count ? idx : s_bench.latency_count - 1];
+}
+
+// ============================================================================
+// Point generator
+// ============================================================================
+
+static void bench_fill_device_id(char *device_id, size_t len, const char *kind)
+{
+    snprintf(device_id, len, "bench_%s", kind);
+}
+
+static bool bench_enqueue_influx(uint32_t seq, uint64_t timestamp_ms)
+{
+    uint64_t timestamp_ns = timestamp_ms * 1000000ULL;
+    switch (seq % 3) {
+        case 0: {
+            influxdb_soil_data_t d = { .timestamp_ns = timestamp_ns, .voltage = 1.2f + (seq % 100) * 0.001f,
+                                       .moisture_percent = 50.0f + (seq % 20), .raw_adc = 2000 + (int)(seq % 500) };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "soil");
+            return influx_sender_enqueue_soil(&d) == ESP_OK;
+        }
+        case 1: {
+            influxdb_battery_data_t d = { .timestamp_ns = timestamp_ns, .voltage = 3.9f, .percentage = 85.0f };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "battery");
+            return influx_sender_enqueue_battery(&d) == ESP_OK;
+        }
+        default: {
+            influxdb_env_data_t d = { .timestamp_ns = timestamp_ns, .temperature_c = 21.0f + (seq % 50) * 0.1f,
+                                      .humidity_rh = 45.0f };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "env");
+            return influx_sender_enqueue_env(&d) == ESP_OK;
+        }
+    }
+}
+
+static bool bench_enqueue_mqtt(uint32_t seq, uint64_t timestamp_ms)
+{
+    switch (seq % 3) {
+        case 0: {
+            mqtt_soil_data_t d = { .timestamp_ms = timestamp_ms, .voltage = 1.2f + (seq % 100) * 0.001f,
+                                   .moisture_percent = 50.0f + (seq % 20), .raw_adc = 2000 + (int)(seq % 500) };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "soil");
+            return mqtt_sender_enqueue_soil(&d) == ESP_OK;
+        }
+        case 1: {
+            mqtt_battery_data_t d = { .timestamp_ms = timestamp_ms, .voltage = 3.9f, .percentage = 85.0f };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "battery");
+            return mqtt_sender_enqueue_battery(&d) == ESP_OK;
+        }
+        default: {
+            mqtt_env_data_t d = { .timestamp_ms = timestamp_ms, .temperature = 21.0f + (seq % 50) * 0.1f,
+                                  .humidity = 45.0f };
+            bench_fill_device_id(d.device_id, sizeof(d.device_id), "env");
+            return mqtt_sender_enqueue_env(&d) == ESP_OK;
+        }
+    }
+}
+
+// ESP-NOW: points are collected into a sample frame like a leaf batch and sent
+// from the generator task once CONFIG_UPLOAD_BENCH_ESPNOW_POINTS are in it
+static struct {
+    uint8_t gateway_mac[6];
+    sample_frame_writer_t frame;
+    uint8_t buf[SAMPLE_FRAME_MAX_SIZE];
+    int64_t enqueued_us[CONFIG_UPLOAD_BENCH_ESPNOW_POINTS];
+    uint32_t count;
+} s_espnow;
+
+static void bench_espnow_send(void)
+{
+    if (s_espnow.count == 0) {
+        return;
+    }
+    size_t len = sample_frame_finish(&s_espnow.frame);
+    esp_err_t ret = (len > 0) ? espnow_driver_send(s_espnow.gateway_mac, s_espnow.buf, len) : ESP_ERR_INVALID_SIZE;
+
+    int64_t now_us = esp_timer_get_time();
+    s_bench.last_ack_us = now_us;
+    if (ret == ESP_OK) {
+        s_bench.bytes += len;
+    }
+    for (uint32_t i = 0; i < s_espnow.count; i++) {
+        bench_record(s_espnow.enqueued_us[i], now_us, ret == ESP_OK);
+    }
+    s_espnow.count = 0;
+}
+
+static bool bench_enqueue_espnow(uint32_t seq, uint64_t timestamp_ms, int64_t now_us)
+{
+    if (s_espnow.count == 0) {
+        sample_frame_writer_init(&s_espnow.frame, s_espnow.buf, sizeof(s_espnow.buf), esp_utils_get_timestamp_ms());
+    }
+    sample_frame_record_t rec = {
+        .type = (sample_frame_type_t)(seq % 3),     // Soil, battery, env
+        .device_id = "bench",
+        .timestamp_ms = timestamp_ms,
+        .aux = 2000 + (seq % 500),
+        .v = { 1.2f, 50.0f + (seq % 20), 45.0f },
+    };
+    if (sample_frame_add(&s_espnow.frame, &rec) != ESP_OK) {
+        if (s_espnow.count == 0) {
+            return false;
+        }
+        bench_espnow_send();    // Frame full before the point count: send it and start over
+        return bench_enqueue_espnow(seq, timestamp_ms, now_us);
+    }
+    s_espnow.enqueued_us[s_espnow.count++] = now_us;
+    if (s_espnow.count >= CONFIG_UPLOAD_BENCH_ESPNOW_POINTS) {
+        bench_espnow_send();
+    }
+    return true;
+}
+
+static void bench_generate(bench_path_t path)
+{
+    const TickType_t period = pdMS_TO_TICKS(1000 / CONFIG_UPLOAD_BENCH_RATE_HZ) > 0 ?
+                              pdMS_TO_TICKS(1000 / CONFIG_UPLOAD_BENCH_RATE_HZ) : 1;
+    const int64_t end_us = esp_timer_get_time() + (int64_t)CONFIG_UPLOAD_BENCH_DURATION_S * 1000000LL;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    for (uint32_t seq = 0; esp_timer_get_time() < end_us; seq++) {
+        int64_t now_us = esp_timer_get_time();
+        uint64_t timestamp_ms = esp_utils_get_timestamp_ms();
+        bool ok;
+
+        s_bench.generated++;
+        if (path == BENCH_PATH_ESPNOW) {
+            ok = bench_enqueue_espnow(seq, timestamp_ms, now_us);
+        } else if (!bench_pending_push(now_us)) {
+            ok = false;
+        } else {
+            ok = (path == BENCH_PATH_INFLUX) ? bench_enqueue_influx(seq, timestamp_ms)
+                                             : bench_enqueue_mqtt(seq, timestamp_ms);
+            if (!ok) {
+                bench_pending_unpush();
+            }
+        }
+        if (!ok) {
+            s_bench.rejected++;
+        }
+
+        size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        if (free_heap < s_bench.min_free_heap) {
+            s_bench.min_free_heap = free_heap;
+        }
+        vTaskDelayUntil(&last_wake, period);
+    }
+
+    if (path == BENCH_PATH_ESPNOW) {
+        bench_espnow_send();
+    }
+}
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+static void bench_report(void)
+{
+    qsort(s_bench.latency_ms, s_bench.latency_count, sizeof(s_bench.latency_ms[0]), bench_cmp_u32);
+
+    float elapsed_s = (s_bench.last_ack_us > s_bench.start_us) ?
+                      (s_bench.last_ack_us - s_bench.start_us) / 1000000.0f : 0.0f;
+    float points_per_s = elapsed_s > 0.0f ? s_bench.delivered / elapsed_s : 0.0f;
+    // mA * V * s = mJ
+    float energy_mj = UPLOAD_BENCH_ACTIVE_MA * (UPLOAD_BENCH_SUPPLY_MV / 1000.0f) * elapsed_s;
+
+    ESP_LOGI(TAG, "[%s] %lu generated, %lu delivered, %lu lost, %lu rejected in %.1f s",
+             s_path_names[s_bench.path], (unsigned long)s_bench.generated, (unsigned long)s_bench.delivered,
+             (unsigned long)s_bench.lost, (unsigned long)s_bench.rejected, elapsed_s);
+    ESP_LOGI(TAG, "[%s] %.2f points/s, latency p50 %lu ms, p99 %lu ms, max %lu ms",
+             s_path_names[s_bench.path], points_per_s, (unsigned long)bench_percentile(50),
+             (unsigned long)bench_percentile(99),
+             (unsigned long)(s_bench.latency_count > 0 ? s_bench.latency_ms[s_bench.latency_count - 1] : 0));
+    ESP_LOGI(TAG, "[%s] %u bytes on the wire (%.1f per point), heap min %u bytes",
+             s_path_names[s_bench.path], (unsigned)s_bench.bytes,
+             s_bench.delivered > 0 ? (float)s_bench.bytes / s_bench.delivered : 0.0f,
+             (unsigned)s_bench.min_free_heap);
+    ESP_LOGI(TAG, "[%s] Energy estimate %.1f mJ (%.2f mJ per point at %d mA)",
+             s_path_names[s_bench.path], energy_mj,
+             s_bench.delivered > 0 ? energy_mj / s_bench.delivered : 0.0f, UPLOAD_BENCH_ACTIVE_MA);
+}
+
+static void bench_run(bench_path_t path)
+{
+    memset(&s_bench, 0, sizeof(s_bench));
+    s_bench.path = path;
+    s_bench.min_free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s_bench.start_us = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "[%s] %d points/s for %d s", s_path_names[path],
+             CONFIG_UPLOAD_BENCH_RATE_HZ, CONFIG_UPLOAD_BENCH_DURATION_S);
+    bench_generate(path);
+
+    esp_err_t ret = ESP_OK;
+    if (path == BENCH_PATH_INFLUX) {
+        ret = influx_sender_wait_until_empty(UPLOAD_BENCH_DRAIN_MS);
+    } else if (path == BENCH_PATH_MQTT) {
+        ret = mqtt_sender_wait_until_empty(UPLOAD_BENCH_DRAIN_MS);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "[%s] Not drained: %s", s_path_names[path], esp_err_to_name(ret));
+    }
+    bench_report();
+}
+
+static esp_err_t bench_espnow_start(void)
+{
+    uint8_t channel = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&channel, &second);
+
+    espnow_config_t config = {
+        .node_id = ESPNOW_LINK_NODE_ID,
+        .wifi_channel = channel,    // The access point's channel
+        .send_timeout_ms = ESPNOW_SEND_TIMEOUT_MS,
+        .max_retries = ESPNOW_MAX_RETRY_COUNT,
+        .end_to_end_ack = true,     // Ignored when the gateway address is broadcast
+    };
+    esp_err_t ret = espnow_driver_init(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    espnow_peer_t peer = {
+        .mac_addr = ESPNOW_GATEWAY_MAC,
+        .channel = channel,
+        .encrypt = false,
+    };
+    memcpy(s_espnow.gateway_mac, peer.mac_addr, sizeof(s_espnow.gateway_mac));
+    return espnow_driver_add_peer(&peer);
+}
+
+static void upload_bench_task(void *arg)
+{
+#if CONFIG_UPLOAD_BENCH_INFLUX
+    if (influx_sender_init() == ESP_OK) {
+        influx_sender_set_ack_cb(bench_ack);
+        bench_run(BENCH_PATH_INFLUX);
+        influx_sender_set_ack_cb(NULL);
+    } else {
+        ESP_LOGE(TAG, "❌ InfluxDB sender could not be started");
+    }
+#endif
+
+#if CONFIG_UPLOAD_BENCH_MQTT
+    if (mqtt_sender_init() == ESP_OK) {
+        mqtt_sender_set_ack_cb(bench_ack);
+        bench_run(BENCH_PATH_MQTT);
+        mqtt_sender_set_ack_cb(NULL);
+    } else {
+        ESP_LOGE(TAG, "❌ MQTT sender could not be started");
+    }
+#endif
+
+#if CONFIG_UPLOAD_BENCH_ESPNOW
+    esp_err_t ret = bench_espnow_start();
+    if (ret == ESP_OK) {
+        bench_run(BENCH_PATH_ESPNOW);
+    } else {
+        ESP_LOGE(TAG, "❌ ESP-NOW could not be started: %s", esp_err_to_name(ret));
+    }
+#endif
+
+    ESP_LOGI(TAG, "✅ Benchmark finished, heap minimum since boot %u bytes",
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    vTaskDelete(NULL);
+}
+
+void app_main(void) {
+    ESP_LOGI(TAG, "Starting Upload Benchmark");
+
+    const time_service_config_t time_config = {
+        .resync_interval_s = TIME_RESYNC_INTERVAL_S,
+        .max_error_ms = TIME_MAX_ERROR_MS,
+        .assumed_drift_ppm = TIME_ASSUMED_DRIFT_PPM,
+    };
+    time_service_init(&time_config);
+    perf_profiler_init();
+    resource_tracker_init();
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    wifi_manager_config_t wifi_config = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASSWORD,
+        .max_retry = WIFI_MAX_RETRY,
+    };
+    ESP_ERROR_CHECK(wifi_manager_init(&wifi_config, NULL));
+    if (wifi_manager_connect() != ESP_OK) {
+        ESP_LOGE(TAG, "❌ WiFi connection failed");
+        return;
+    }
+#if NTP_ENABLED
+    // Points get wall-clock timestamps (the senders would otherwise wait for the sync)
+    ntp_time_init(NULL);
+    ntp_time_wait_for_sync(NTP_SYNC_TIMEOUT_MS);
+#endif
+
+    xTaskCreate(upload_bench_task, "upload_bench", UPLOAD_BENCH_TASK_STACK, NULL, UPLOAD_BENCH_TASK_PRIO, NULL);
+}
@@ -0,0 +1,58 @@
+#ifndef UPLOAD_BENCH_MAIN_H
+#define UPLOAD_BENCH_MAIN_H
+
+#include <stdio.h>
+#include "esp_system.h"
+#include "esp_log.h"
+
+// Project configuration
+#include "../config/esp32-config.h"
+#include "../config/credentials.h"
+
+#include "wifi_manager.h"
+#include "espnow_driver.h"
+#include "sample_frame.h"
+#include "../application/influx_sender.h"
+#include "../application/mqtt_sender.h"
+
+// Kconfig driven settings (menuconfig → Upload Benchmark), fallback defaults if not defined
+#ifndef CONFIG_UPLOAD_BENCH_RATE_HZ
+#define CONFIG_UPLOAD_BENCH_RATE_HZ 10
+#endif
+#ifndef CONFIG_UPLOAD_BENCH_DURATION_S
+#define CONFIG_UPLOAD_BENCH_DURATION_S 60
+#endif
+#ifndef CONFIG_UPLOAD_BENCH_INFLUX
+#define CONFIG_UPLOAD_BENCH_INFLUX 1
+#endif
+#ifndef CONFIG_UPLOAD_BENCH_MQTT
+#define CONFIG_UPLOAD_BENCH_MQTT 1
+#endif
+#ifndef CONFIG_UPLOAD_BENCH_ESPNOW
+#define CONFIG_UPLOAD_BENCH_ESPNOW 0
+#endif
+#ifndef CONFIG_UPLOAD_BENCH_ESPNOW_POINTS
+#define CONFIG_UPLOAD_BENCH_ESPNOW_POINTS 8
+#endif
+
+#define UPLOAD_BENCH_TASK_STACK     (6 * 1024)
+#define UPLOAD_BENCH_TASK_PRIO      4
+#define UPLOAD_BENCH_DRAIN_MS       30000   // Wait for the senders after the last point
+#define UPLOAD_BENCH_MAX_LATENCIES  1024    // Latency samples kept per path (first N points)
+#define UPLOAD_BENCH_MAX_PENDING    256     // Points in flight per path (enqueued, not acked)
+
+// Energy estimate: average board current while the radio is up (measure yours)
+#define UPLOAD_BENCH_SUPPLY_MV      3300
+#define UPLOAD_BENCH_ACTIVE_MA      80
+
+/**
+ * @brief Main application entry point
+ *
+ * Connects to WiFi, then feeds synthetic soil/battery/env points at
+ * CONFIG_UPLOAD_BENCH_RATE_HZ through each enabled upload path for
+ * CONFIG_UPLOAD_BENCH_DURATION_S and logs points/s, p50/p99 enqueue-to-ack
+ * latency, bytes on the wire, heap minimum and an energy estimate per path.
+ */
+void app_main(void);
+
+#endif // UPLOAD_BENCH_MAIN_H
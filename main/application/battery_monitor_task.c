@@ -1,74 +1,29 @@
 /**
  * @file battery_monitor_task.c
- * @brief Battery Voltage Monitoring Task - Implementation
+ * @brief Battery Voltage Monitoring - Implementation
  * 
  * Simple battery voltage monitoring using ADC (direct 1:1 connection).
- * Reads voltage from GPIO0 and sends measurements to InfluxDB.
+ * Reads voltage from GPIO0; the sensor runtime measures and reports it.
  */
 
 #include "battery_monitor_task.h"
 #include "../config/esp32-config.h"
-#include "esp_utils.h"
-#include "ntp_time.h"
 #include "adc_manager.h"
-#include "../drivers/influxdb/influxdb_client.h"
-#include "influx_sender.h"
-#include "../drivers/wifi/wifi_manager.h"
+#include "cycle_scheduler.h"
+#include "report_policy.h"
+#include "sample_aggregator.h"
+#include "sensor_runtime.h"
 #include "esp_log.h"
-
-#if ENABLE_MQTT
-#include "mqtt_sender.h"
-#endif
+#include "esp_timer.h"
 #include "esp_mac.h"
-#include "esp_sleep.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include <stdio.h>
 #include <string.h>
 
 static const char* TAG = "BATTERY_MONITOR_TASK";
 
-// Task handle for the monitoring task
-static TaskHandle_t monitoring_task_handle = NULL;
-
-// Configuration for measurement cycles
-static uint32_t measurements_per_cycle = 0;  // 0 = infinite loop
-
 // Last measured voltage
 static float last_voltage = 0.0f;
-static volatile bool is_running = false;
-
-/**
- * @brief Send battery voltage reading to InfluxDB
- */
-static influxdb_response_status_t battery_send_reading_to_influxdb(float voltage, const char* device_id) {
-    if (device_id == NULL) {
-        return INFLUXDB_RESPONSE_ERROR;
-    }
-
-    influxdb_battery_data_t influx_data;
-    
-    // Use NTP timestamp if available, otherwise fallback to system timestamp
-    uint64_t timestamp_ms;
-    if (ntp_time_is_synced()) {
-        timestamp_ms = ntp_time_get_timestamp_ms();
-    } else {
-        timestamp_ms = esp_utils_get_timestamp_ms();
-    }
-    
-    // Convert milliseconds to nanoseconds for InfluxDB
-    influx_data.timestamp_ns = timestamp_ms * 1000000ULL;
-    influx_data.voltage = voltage;
-    influx_data.percentage = -1;  // No percentage calculation for now
-    strncpy(influx_data.device_id, device_id, sizeof(influx_data.device_id) - 1);
-    influx_data.device_id[sizeof(influx_data.device_id) - 1] = '\0';
-
-#if USE_INFLUXDB
-    influx_sender_init();
-    return influx_sender_enqueue_battery(&influx_data);
-#else
-    return ESP_OK;  // Data logged, but not sent (WiFi disabled)
-#endif
-}
+static volatile bool s_critical = false;    // Protection shutdown requested (battery_monitor_is_critical)
 
 esp_err_t battery_monitor_init() {
     // Initialize shared ADC unit
@@ -87,6 +42,15 @@ esp_err_t battery_monitor_init() {
         adc_shared_deinit(BATTERY_ADC_UNIT);
         return ret;
     }
+    
+    // Share the soil sensor's acquisition window instead of sampling on our own
+    ret = adc_shared_scan_add_channel(BATTERY_ADC_UNIT, BATTERY_ADC_CHANNEL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add battery channel to scan group: %s", esp_err_to_name(ret));
+        adc_shared_remove_channel(BATTERY_ADC_UNIT, BATTERY_ADC_CHANNEL);
+        adc_shared_deinit(BATTERY_ADC_UNIT);
+        return ret;
+    }
 
     ESP_LOGI(TAG, "Battery monitor initialized on GPIO0 (ADC%d CH%d, 1:1 direct)", 
              BATTERY_ADC_UNIT + 1, BATTERY_ADC_CHANNEL);
@@ -116,24 +80,14 @@ esp_err_t battery_monitor_read_voltage(float* voltage) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Multisampling to reduce noise (recommended by Espressif)
-    const int samples = 64;  // Average 64 readings
-    int64_t raw_sum = 0;
-    
-    for (int i = 0; i < samples; i++) {
-        int raw_value;
-        esp_err_t ret = adc_shared_read_raw(BATTERY_ADC_UNIT, BATTERY_ADC_CHANNEL, &raw_value);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read raw ADC: %s", esp_err_to_name(ret));
-            return ret;
-        }
-        raw_sum += raw_value;
+    // Filtered scan pass; the soil sensor's pass of the same sensor pass is reused
+    adc_shared_scan_result_t scan;
+    int raw_value = 0;
+    int64_t not_before_us = esp_timer_get_time() - (int64_t)BATTERY_ADC_SCAN_MAX_AGE_MS * 1000;
+    esp_err_t ret = adc_shared_scan(BATTERY_ADC_UNIT, not_before_us, 0, &scan);
+    if (ret == ESP_OK) {
+        ret = adc_shared_scan_get(&scan, BATTERY_ADC_CHANNEL, voltage, &raw_value);
     }
-    
-    int raw_avg = (int)(raw_sum / samples);
-
-    // Read calibrated voltage using the averaged raw value
-    esp_err_t ret = adc_shared_read_voltage(BATTERY_ADC_UNIT, BATTERY_ADC_CHANNEL, voltage);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read battery voltage: %s", esp_err_to_name(ret));
         return ret;
@@ -144,183 +98,89 @@ esp_err_t battery_monitor_read_voltage(float* voltage) {
     // Apply scale factor (2.0 for voltage divider)
     *voltage = *voltage * BATTERY_MONITOR_VOLTAGE_SCALE_FACTOR;
 
-    ESP_LOGI(TAG, "ADC: RawAvg=%d (n=%d), Calibrated=%.3fV, Final=%.3fV", 
-             raw_avg, samples, adc_voltage_before_scale, *voltage);
+    ESP_LOGI(TAG, "ADC: Raw=%d (filtered), Calibrated=%.3fV, Final=%.3fV", 
+             raw_value, adc_voltage_before_scale, *voltage);
 
     return ESP_OK;
 }
 
-esp_err_t battery_monitor_stop() {
-    if (monitoring_task_handle == NULL) {
-        ESP_LOGW(TAG, "Battery monitor task not running");
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    is_running = false;
-    
-    // Wait for task to finish gracefully
-    uint32_t wait_count = 0;
-    while (monitoring_task_handle != NULL && wait_count < 50) {  // 5 second timeout
-        vTaskDelay(pdMS_TO_TICKS(100));
-        wait_count++;
-    }
-    
-    if (monitoring_task_handle != NULL) {
-        ESP_LOGW(TAG, "Battery monitor task did not stop gracefully, forcing deletion");
-        vTaskDelete(monitoring_task_handle);
-        monitoring_task_handle = NULL;
+// MARK: SENSOR HAL
+static esp_err_t battery_hal_read(void* ctx, sensor_hal_reading_t* reading) {
+    float voltage = 0.0f;
+    esp_err_t ret = battery_monitor_read_voltage(&voltage);
+    if (ret != ESP_OK) {
+        return ret;
     }
-
-    ESP_LOGI(TAG, "Battery monitor task stopped");
+    reading->values[0] = voltage;
+    reading->values[1] = -1.0f;     // No percentage calculation for now
+    reading->count = 2;
     return ESP_OK;
 }
 
-esp_err_t battery_monitor_start(uint32_t cycles) {
-    if (monitoring_task_handle != NULL) {
-        ESP_LOGW(TAG, "Battery monitor task already running");
-        return ESP_ERR_INVALID_STATE;
-    }
+static const sensor_hal_ops_t s_hal_ops = {
+    .read = battery_hal_read,       // Divider always connected, the scan runs inside read()
+};
 
-    measurements_per_cycle = cycles;
-    is_running = true;
+static void battery_fill_sample(const sensor_hal_reading_t* reading, telemetry_sample_t* sample) {
+    sample->data.battery.voltage = reading->values[0];
+    sample->data.battery.percentage = reading->values[1];
+}
 
-    BaseType_t result = xTaskCreatePinnedToCore(
-        battery_monitor_task,
-        "battery_monitor_task",
-        BATTERY_MONITOR_TASK_STACK_SIZE, // Stack size
-        NULL, // Parameters
-        BATTERY_MONITOR_TASK_PRIORITY,    // Priority
-        &monitoring_task_handle,
-        0 /* pin to core 0 */
-    );
+static void battery_on_reading(void* ctx, const sensor_hal_reading_t* reading) {
+    float battery_voltage = reading->values[0];
+    last_voltage = battery_voltage;
 
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create battery monitor task");
-        is_running = false;
-        return ESP_FAIL;
+    // Low battery protection: the cycle still sends this sample, then main shuts down
+    if (battery_voltage < BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD && !s_critical) {
+        ESP_LOGW(TAG, "Battery voltage critically low: %.2f V (threshold: %.2f V)", 
+                 battery_voltage, BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD);
+        s_critical = BATTERY_MONITOR_USE_DEEP_SLEEP_ON_LOW_BATTERY;
     }
-
-    ESP_LOGI(TAG, "Battery monitor task started with %lu measurements per cycle", measurements_per_cycle);
-    return ESP_OK;
 }
 
-esp_err_t battery_monitor_wait_for_completion(uint32_t timeout_ms) {
-    if (measurements_per_cycle == 0) {
-        ESP_LOGW(TAG, "measurements_per_cycle is 0, task runs indefinitely");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    uint32_t elapsed_ms = 0;
-    const uint32_t check_interval_ms = 100;
-    
-    ESP_LOGI(TAG, "Waiting for battery monitoring task to complete...");
-    
-    while (monitoring_task_handle != NULL) {
-        vTaskDelay(pdMS_TO_TICKS(check_interval_ms));
-        elapsed_ms += check_interval_ms;
-        
-        if (timeout_ms > 0 && elapsed_ms >= timeout_ms) {
-            ESP_LOGW(TAG, "Timeout waiting for battery monitoring task");
-            return ESP_ERR_TIMEOUT;
-        }
+esp_err_t battery_monitor_register(uint32_t measurements_per_cycle) {
+    esp_err_t ret = battery_monitor_init();
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    ESP_LOGI(TAG, "Battery monitoring task completed");
-    return ESP_OK;
-}
-
-void battery_monitor_task(void *pvParameters) {
 
-    battery_monitor_init();
-
-    // Generate device ID from MAC address for battery monitoring
-    char device_id[32];
+#if REPORT_POLICY_ENABLED
+    const report_policy_config_t policy = {
+        .deadband = BATTERY_REPORT_DEADBAND_V,
+        .rate_per_min = BATTERY_REPORT_RATE_PER_MIN,
+        .min_interval_s = BATTERY_REPORT_MIN_INTERVAL_S,
+        .max_interval_s = BATTERY_REPORT_MAX_INTERVAL_S,
+    };
+    report_policy_configure(REPORT_METRIC_BATTERY_VOLTAGE, &policy);
+#endif
+    sample_aggregator_configure(REPORT_METRIC_BATTERY_VOLTAGE, AGGREGATION_ENABLED ? BATTERY_AGG_WINDOW_S : 0);
+
+    sensor_runtime_sensor_t sensor = {
+        .hal = {
+            .name = "battery",
+            .ops = &s_hal_ops,
+        },
+        .job = CYCLE_JOB_BATTERY,
+        .sample_type = TELEMETRY_SAMPLE_BATTERY,
+        .measurements_per_cycle = measurements_per_cycle,
+        .interval_ms = BATTERY_MONITOR_MEASUREMENT_INTERVAL_MS,
+        .publish = true,
+        .log = true,
+        .metric_count = 1,
+        .metrics = { REPORT_METRIC_BATTERY_VOLTAGE },
+        .metric_values = { 0 },
+        .fill_sample = battery_fill_sample,
+        .on_reading = battery_on_reading,
+    };
+
+    // Device ID from the MAC address
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    snprintf(device_id, sizeof(device_id), "BATT_%02X%02X%02X%02X%02X%02X",
+    snprintf(sensor.device_id, sizeof(sensor.device_id), "BATT_%02X%02X%02X%02X%02X%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    
-    ESP_LOGI(TAG, "Battery monitor device ID: %s", device_id);
-    
-    uint32_t measurement_count = 0;
-
-    while (is_running) {
-        float battery_voltage = 0;
-        battery_monitor_read_voltage(&battery_voltage);
-        
-        // Store last reading
-        last_voltage = battery_voltage;
-
-        // Log the reading
-        ESP_LOGI(TAG, "Battery Voltage: %.2f V", battery_voltage);
-
-#if USE_INFLUXDB
-        // Send data to InfluxDB if WiFi is connected
-        if (wifi_manager_is_connected()) {
-            influxdb_response_status_t influx_status = battery_send_reading_to_influxdb(battery_voltage, device_id);
-            if (influx_status == INFLUXDB_RESPONSE_OK) {
-                ESP_LOGI(TAG, "Battery data sent successfully to InfluxDB");
-            } else {
-                ESP_LOGW(TAG, "Failed to send battery data to InfluxDB (status: %d)", influx_status);
-            }
-        } else {
-            ESP_LOGW(TAG, "WiFi not connected, skipping InfluxDB transmission");
-        }
-#endif
-
-#if USE_MQTT
-        // Send data to MQTT if WiFi is connected
-        if (wifi_manager_is_connected()) {
-            mqtt_battery_data_t mqtt_data = {
-                .timestamp_ms = esp_utils_get_timestamp_ms(),
-                .voltage = battery_voltage,
-                .percentage = -1.0f,  // No percentage calculation for now
-            };
-            strncpy(mqtt_data.device_id, device_id, sizeof(mqtt_data.device_id) - 1);
-            mqtt_data.device_id[sizeof(mqtt_data.device_id) - 1] = '\0';
-            
-            esp_err_t mqtt_ret = mqtt_sender_enqueue_battery(&mqtt_data);
-            if (mqtt_ret == ESP_OK) {
-                ESP_LOGI(TAG, "Battery data queued for MQTT");
-            } else {
-                ESP_LOGW(TAG, "Failed to queue battery data for MQTT: %s", esp_err_to_name(mqtt_ret));
-            }
-        } else {
-            ESP_LOGW(TAG, "WiFi not connected, skipping MQTT transmission");
-        }
-#endif
+    ESP_LOGI(TAG, "Battery monitor device ID: %s", sensor.device_id);
 
-        // Low battery protection - enter deep sleep if voltage too low
-        if (battery_voltage < BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD) {
-            ESP_LOGW(TAG, "Battery voltage critically low: %.2f V (threshold: %.2f V)", 
-                     battery_voltage, BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD);
-            ESP_LOGW(TAG, "Battery protection activated! Entering deep sleep to prevent damage.");
-            
-            // Perform cleanup and shutdown
-            if (BATTERY_MONITOR_USE_DEEP_SLEEP_ON_LOW_BATTERY) {
-                ESP_LOGI(TAG, "Entering indefinite deep sleep mode to conserve power and protect battery.");
-                battery_monitor_deinit();
-                // Enter deep sleep without timer (device stays asleep until manual reset)
-                esp_deep_sleep_start();
-            }
-        }
-
-        measurement_count++;
-        
-        // Check if we've reached the target count (if configured)
-        if (measurements_per_cycle > 0 && measurement_count >= measurements_per_cycle) {
-            ESP_LOGI(TAG, "Completed %lu measurements, stopping task", measurement_count);
-            break;
-        }
-
-        // Wait for the next measurement interval
-        vTaskDelay(pdMS_TO_TICKS(BATTERY_MONITOR_MEASUREMENT_INTERVAL_MS));
-    }
-    
-    ESP_LOGI(TAG, "Battery monitor task stopped");
-    is_running = false;
-    monitoring_task_handle = NULL;
-    vTaskDelete(NULL);
+    return sensor_runtime_register(&sensor);
 }
 
 esp_err_t battery_monitor_get_last_voltage(float* voltage) {
@@ -329,4 +189,8 @@ esp_err_t battery_monitor_get_last_voltage(float* voltage) {
     }
     *voltage = last_voltage;
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+bool battery_monitor_is_critical(void) {
+    return s_critical;
+}
@@ -1,8 +1,9 @@
 /**
  * @file battery_monitor_task.h
- * @brief Battery Voltage Monitoring Task
+ * @brief Battery Voltage Monitoring
  * 
- * Simple battery voltage monitoring via ADC (direct 1:1 connection on GPIO0).
+ * Simple battery voltage monitoring via ADC (direct 1:1 connection on GPIO0),
+ * measured by the sensor runtime as CYCLE_JOB_BATTERY.
  */
 
 #ifndef BATTERY_MONITOR_TASK_H
@@ -10,6 +11,7 @@
 
 #include "esp_err.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "adc_manager.h"
@@ -18,10 +20,11 @@
 esp_err_t battery_monitor_init();
 esp_err_t battery_monitor_deinit();
 esp_err_t battery_monitor_read_voltage(float* voltage);
-esp_err_t battery_monitor_start(uint32_t measurements_per_cycle);
-esp_err_t battery_monitor_stop();
-esp_err_t battery_monitor_wait_for_completion(uint32_t timeout_ms);
-void battery_monitor_task(void* pvParameters);
+// Set up the ADC channel and register the battery with the sensor runtime
+esp_err_t battery_monitor_register(uint32_t measurements_per_cycle);
 esp_err_t battery_monitor_get_last_voltage(float* voltage);
+// A reading fell below BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD: the application
+// flushes the cycle's data and enters deep sleep without a wake timer
+bool battery_monitor_is_critical(void);
 
 #endif // BATTERY_MONITOR_TASK_H
\ No newline at end of file
@@ -0,0 +1,242 @@
+/**
+ * @file cycle_scheduler.c
+ * @brief Wake Cycle Scheduler - Implementation
+ */
+
+#include "cycle_scheduler.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char* TAG = "CYCLE_SCHED";
+
+#define CYCLE_JOB_ALL   (CYCLE_JOB_BATTERY | CYCLE_JOB_ENV | CYCLE_JOB_SOIL | CYCLE_JOB_WIFI)
+
+#define CYCLE_PLAN_RTC_MAGIC    0x43504C31      // "CPL1"
+#define CYCLE_PLAN_JOBS         3
+#define CYCLE_PLAN_MIN_SLEEP_MS 1000
+
+// Deadlines on the system clock, kept across deep sleep
+typedef struct {
+    uint32_t magic;
+    float battery_voltage;                  // Last battery reading, NAN before the first
+    int64_t next_due_ms[CYCLE_PLAN_JOBS];
+} cycle_plan_rtc_t;
+
+static const EventBits_t s_plan_jobs[CYCLE_PLAN_JOBS] = {
+    CYCLE_JOB_BATTERY, CYCLE_JOB_ENV, CYCLE_JOB_SOIL,
+};
+
+static EventGroupHandle_t s_done = NULL;
+static EventBits_t s_armed = 0;
+
+static RTC_DATA_ATTR cycle_plan_rtc_t s_plan;
+static cycle_plan_config_t s_plan_config;
+static int64_t s_plan_base_ms = 0;          // System clock minus uptime: a change is a clock step
+static EventBits_t s_plan_due = 0;
+
+esp_err_t cycle_scheduler_init(void) {
+    if (s_done == NULL) {
+        s_done = xEventGroupCreate();
+        if (s_done == NULL) {
+            ESP_LOGE(TAG, "Failed to create event group");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void cycle_scheduler_begin(EventBits_t jobs) {
+    if (s_done == NULL) {
+        return;
+    }
+    xEventGroupClearBits(s_done, CYCLE_JOB_ALL);
+    s_armed = jobs & CYCLE_JOB_ALL;
+}
+
+void cycle_scheduler_job_done(EventBits_t job) {
+    if (s_done != NULL) {
+        xEventGroupSetBits(s_done, job & CYCLE_JOB_ALL);
+    }
+}
+
+esp_err_t cycle_scheduler_join(uint32_t deadline_ms, EventBits_t* pending) {
+    if (pending) {
+        *pending = 0;
+    }
+    if (s_done == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_armed == 0) {
+        return ESP_OK;
+    }
+
+    TickType_t wait = (deadline_ms > 0) ? pdMS_TO_TICKS(deadline_ms) : portMAX_DELAY;
+    EventBits_t bits = xEventGroupWaitBits(s_done, s_armed, pdFALSE, pdTRUE, wait);
+    EventBits_t missing = s_armed & ~bits;
+    if (pending) {
+        *pending = missing;
+    }
+    if (missing != 0) {
+        ESP_LOGW(TAG, "Cycle deadline (%lu ms) reached, jobs still pending: 0x%02lx",
+                 (unsigned long)deadline_ms, (unsigned long)missing);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Wake Plan
+// ============================================================================
+
+static int64_t plan_now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+static uint32_t plan_interval_s(int job) {
+    switch (job) {
+        case 0:  return s_plan_config.battery_interval_s;
+        case 1:  return s_plan_config.env_interval_s;
+        default: return s_plan_config.soil_interval_s;
+    }
+}
+
+// Move the deadlines along when the clock was set during this wake (e.g. by NTP)
+static void plan_follow_clock_step(void) {
+    int64_t base_ms = plan_now_ms() - esp_timer_get_time() / 1000;
+    int64_t step_ms = base_ms - s_plan_base_ms;
+    if (step_ms == 0) {
+        return;
+    }
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        s_plan.next_due_ms[i] += step_ms;
+    }
+    s_plan_base_ms = base_ms;
+}
+
+void cycle_scheduler_plan_init(const cycle_plan_config_t* config) {
+    if (config != NULL) {
+        s_plan_config = *config;
+    }
+
+    int64_t now_ms = plan_now_ms();
+    if (s_plan.magic != CYCLE_PLAN_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_plan, 0, sizeof(s_plan));
+        s_plan.magic = CYCLE_PLAN_RTC_MAGIC;
+        s_plan.battery_voltage = NAN;
+        // Due now; the first advance lands phase_ms from now (the phase is below the intervals)
+        for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+            s_plan.next_due_ms[i] = now_ms;
+            uint32_t interval_s = plan_interval_s(i);
+            if ((int64_t)s_plan_config.phase_ms < (int64_t)interval_s * 1000LL) {
+                s_plan.next_due_ms[i] += (int64_t)s_plan_config.phase_ms - (int64_t)interval_s * 1000LL;
+            }
+        }
+    }
+    s_plan_base_ms = now_ms - esp_timer_get_time() / 1000;
+    s_plan_due = 0;
+}
+
+EventBits_t cycle_scheduler_plan_due(void) {
+    plan_follow_clock_step();
+
+    int64_t now_ms = plan_now_ms();
+    s_plan_due = 0;
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        if (plan_interval_s(i) > 0 &&
+            s_plan.next_due_ms[i] <= now_ms + (int64_t)s_plan_config.early_ms) {
+            s_plan_due |= s_plan_jobs[i];
+        }
+    }
+    ESP_LOGI(TAG, "Jobs due: 0x%02lx (intervals x%lu)",
+             (unsigned long)s_plan_due, (unsigned long)cycle_scheduler_plan_stretch());
+    return s_plan_due;
+}
+
+void cycle_scheduler_plan_shift(int64_t shift_ms) {
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        s_plan.next_due_ms[i] += shift_ms;
+    }
+}
+
+int64_t cycle_scheduler_plan_first_ms(void) {
+    int64_t first_ms = INT64_MAX;
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        if (plan_interval_s(i) > 0 && s_plan.next_due_ms[i] < first_ms) {
+            first_ms = s_plan.next_due_ms[i];
+        }
+    }
+    return first_ms;
+}
+
+EventBits_t cycle_scheduler_plan_upcoming(uint32_t sleep_ms) {
+    int64_t wake_ms = plan_now_ms() + (int64_t)sleep_ms;
+    EventBits_t jobs = 0;
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        if (plan_interval_s(i) > 0 &&
+            s_plan.next_due_ms[i] <= wake_ms + (int64_t)s_plan_config.early_ms) {
+            jobs |= s_plan_jobs[i];
+        }
+    }
+    return jobs;
+}
+
+uint32_t cycle_scheduler_plan_stretch(void) {
+    float v = s_plan.battery_voltage;
+    if (isnan(v)) {
+        return 1;
+    }
+    if (v < s_plan_config.stretch_4x_below_v) {
+        return 4;
+    }
+    if (v < s_plan_config.stretch_2x_below_v) {
+        return 2;
+    }
+    return 1;
+}
+
+uint32_t cycle_scheduler_plan_next(float battery_voltage) {
+    if (!isnan(battery_voltage)) {
+        s_plan.battery_voltage = battery_voltage;
+    }
+    plan_follow_clock_step();
+
+    int64_t now_ms = plan_now_ms();
+    uint32_t stretch = cycle_scheduler_plan_stretch();
+    int64_t next_ms = INT64_MAX;
+    for (int i = 0; i < CYCLE_PLAN_JOBS; i++) {
+        uint32_t interval_s = plan_interval_s(i);
+        if (interval_s == 0) {
+            continue;
+        }
+        if (s_plan_due & s_plan_jobs[i]) {
+            // Fixed rate: whole intervals from the previous deadline, skipping missed ones
+            int64_t step_ms = (int64_t)interval_s * 1000LL * stretch;
+            int64_t due = s_plan.next_due_ms[i] + step_ms;
+            if (due <= now_ms) {
+                due += ((now_ms - due) / step_ms + 1) * step_ms;
+            }
+            s_plan.next_due_ms[i] = due;
+        }
+        if (s_plan.next_due_ms[i] < next_ms) {
+            next_ms = s_plan.next_due_ms[i];
+        }
+    }
+    s_plan_due = 0;
+
+    int64_t sleep_ms = (next_ms == INT64_MAX) ? (int64_t)s_plan_config.idle_interval_s * 1000LL
+                                              : next_ms - now_ms;
+    if (sleep_ms < CYCLE_PLAN_MIN_SLEEP_MS) {
+        sleep_ms = CYCLE_PLAN_MIN_SLEEP_MS;
+    }
+    if (sleep_ms > UINT32_MAX) {
+        sleep_ms = UINT32_MAX;
+    }
+    return (uint32_t)sleep_ms;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file cycle_scheduler.h
+ * @brief Wake Cycle Scheduler
+ * 
+ * Lets all jobs of a measurement cycle (sensor monitors, WiFi association)
+ * run concurrently and joins them with a single barrier. Each job reports
+ * completion with cycle_scheduler_job_done(); cycle_scheduler_join() returns
+ * once every armed job has finished or the per-cycle deadline expires, so the
+ * awake window is the slowest job instead of the sum of all of them.
+ *
+ * The wake plan decides which sensor jobs run on a wake and when the next one
+ * is. Every job has its own cadence on a fixed-rate grid kept in RTC memory:
+ * a deadline advances by whole intervals from the previous deadline, not from
+ * the end of the wake, so the sampling instants do not drift by the awake
+ * time. As the battery voltage falls all intervals are doubled or quadrupled,
+ * which keeps the stretched deadlines on the original grid.
+ */
+
+#ifndef CYCLE_SCHEDULER_H
+#define CYCLE_SCHEDULER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Jobs that can take part in a cycle (bit mask)
+ */
+typedef enum {
+    CYCLE_JOB_BATTERY   = BIT0,     ///< Battery monitor task
+    CYCLE_JOB_ENV       = BIT1,     ///< Environment monitor task
+    CYCLE_JOB_SOIL      = BIT2,     ///< Soil monitor task
+    CYCLE_JOB_WIFI      = BIT3,     ///< WiFi connected (or given up)
+} cycle_job_t;
+
+// Create the barrier (idempotent)
+esp_err_t cycle_scheduler_init(void);
+
+// Arm the barrier for a new cycle; clears the completion state of all jobs
+void cycle_scheduler_begin(EventBits_t jobs);
+
+// Report a job as finished (callable from any task)
+void cycle_scheduler_job_done(EventBits_t job);
+
+// Wait until all armed jobs are done or deadline_ms expired (0 = wait forever).
+// pending receives the jobs that did not finish (may be NULL).
+esp_err_t cycle_scheduler_join(uint32_t deadline_ms, EventBits_t* pending);
+
+/**
+ * @brief Cadence of the sensor jobs
+ */
+typedef struct {
+    uint32_t battery_interval_s;    ///< Battery job interval (0 = never planned)
+    uint32_t env_interval_s;        ///< Environment job interval (0 = never planned)
+    uint32_t soil_interval_s;       ///< Soil job interval (0 = never planned)
+    uint32_t idle_interval_s;       ///< Sleep when no job is planned
+    float stretch_2x_below_v;       ///< Battery voltage below which all intervals double
+    float stretch_4x_below_v;       ///< Battery voltage below which all intervals quadruple
+    uint32_t early_ms;              ///< Jobs due within this window run on the current wake
+    uint32_t phase_ms;              ///< Offset of the grid from the reset (the node's upload slot)
+} cycle_plan_config_t;
+
+// Restore the wake plan (call once per boot). After any reset but a deep
+// sleep wake every planned job is due and the grid restarts phase_ms from now.
+void cycle_scheduler_plan_init(const cycle_plan_config_t* config);
+
+// Sensor jobs due now (call once per cycle, before cycle_scheduler_plan_next)
+EventBits_t cycle_scheduler_plan_due(void);
+
+// Advance the deadlines of the due jobs and return the time until the next
+// one (ms). battery_voltage is this wake's reading, NAN if none was taken.
+uint32_t cycle_scheduler_plan_next(float battery_voltage);
+
+// Move every deadline by shift_ms (call before cycle_scheduler_plan_next),
+// e.g. when the node's upload slot changes
+void cycle_scheduler_plan_shift(int64_t shift_ms);
+
+// Earliest deadline on the system clock (ms since the epoch once the clock is
+// set), INT64_MAX when no job is scheduled
+int64_t cycle_scheduler_plan_first_ms(void);
+
+// Sensor jobs that will be due on the wake after sleeping sleep_ms
+// (call after cycle_scheduler_plan_next)
+EventBits_t cycle_scheduler_plan_upcoming(uint32_t sleep_ms);
+
+// Current interval multiplier from the last battery reading (1, 2 or 4)
+uint32_t cycle_scheduler_plan_stretch(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CYCLE_SCHEDULER_H
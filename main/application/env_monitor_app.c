@@ -2,9 +2,8 @@
  * @file env_monitor_app.c
  * @brief Environment Monitoring Application - Implementation
  * 
- * Implements a FreeRTOS task-based application for continuous environmental
- * monitoring using the AHT20 sensor. Integrates with WiFi, NTP time sync,
- * and InfluxDB for remote data logging.
+ * Sets up the AHT20 sensor and its report policy and registers it with the
+ * sensor runtime, which measures and reports it on the cycles that need it.
  */
 
 #include "env_monitor_app.h"
@@ -20,119 +19,28 @@
 #include "ntp_time.h"
 #include "wifi_manager.h"
 #include "influxdb_client.h"
-#include "influx_sender.h"
+#include "telemetry.h"
+#include "cycle_scheduler.h"
+#include "report_policy.h"
+#include "sample_aggregator.h"
+#include "sensor_runtime.h"
 #include "aht20.h"
 
-#if ENABLE_MQTT
-#include "mqtt_sender.h"
-#endif
-
 static const char* TAG = "ENV_MONITOR_APP";
 
-static TaskHandle_t s_task = NULL;
 static aht20_t s_aht20;
 
-static influxdb_response_status_t send_env_to_influx(float temperature_c, float humidity_rh, const char* device_id)
+static void env_fill_sample(const sensor_hal_reading_t* reading, telemetry_sample_t* sample)
 {
-    if (!device_id) return INFLUXDB_RESPONSE_ERROR;
-
-    influxdb_env_data_t data;
-
-    uint64_t timestamp_ms;
-    if (ntp_time_is_synced()) {
-        timestamp_ms = ntp_time_get_timestamp_ms();
-    } else {
-        timestamp_ms = esp_utils_get_timestamp_ms();
-    }
-
-    data.timestamp_ns = timestamp_ms * 1000000ULL;
-    data.temperature_c = temperature_c;
-    data.humidity_rh = humidity_rh;
-    strncpy(data.device_id, device_id, sizeof(data.device_id) - 1);
-    data.device_id[sizeof(data.device_id) - 1] = '\0';
-
-#if USE_INFLUXDB
-    influx_sender_init();
-    return influx_sender_enqueue_env(&data);
-#else
-    return ESP_OK;  // Data logged, but not sent (WiFi disabled)
-#endif
+    sample->data.env.temperature = reading->values[0];
+    sample->data.env.humidity = reading->values[1];
 }
 
-static void env_monitor_task(void* pv)
+static void env_on_reading(void* ctx, const sensor_hal_reading_t* reading)
 {
-    env_monitor_app_t* app = (env_monitor_app_t*)pv;
-
-    ESP_LOGI(TAG, "Environment monitor task started");
-    // Log stack high watermark to detect potential stack pressure
-    UBaseType_t hwm = uxTaskGetStackHighWaterMark(NULL);
-    ESP_LOGI(TAG, "Env task stack high watermark: %lu bytes", (unsigned long)(hwm * sizeof(StackType_t)));
-
-    uint32_t count = 0;
-    while (app->is_running) {
-        float t = 0.0f, h = 0.0f;
-        esp_err_t ret = aht20_read(&s_aht20, &t, &h);
-        if (ret == ESP_OK) {
-            // Store last reading
-            app->last_temperature = t;
-            app->last_humidity = h;
-            
-            if (app->config.enable_logging) {
-                ESP_LOGI(TAG, "AHT20: T=%.2f C, RH=%.2f%%", t, h);
-                // Extra serial output for quick testing
-                printf("AHT20 TEST -> Temperature: %.2f C, Humidity: %.2f %%\n", t, h);
-            }
-#if USE_INFLUXDB
-            if (app->config.enable_http_sending && wifi_manager_is_connected()) {
-                influxdb_response_status_t st = send_env_to_influx(t, h, app->config.device_id);
-                if (st != INFLUXDB_RESPONSE_OK) {
-                    ESP_LOGW(TAG, "Failed to enqueue env data (status %d)", st);
-                }
-            }
-#endif
-            
-#if USE_MQTT
-            if (app->config.enable_http_sending && wifi_manager_is_connected()) {
-                mqtt_env_data_t mqtt_data = {
-                    .timestamp_ms = esp_utils_get_timestamp_ms(),
-                    .temperature = t,
-                    .humidity = h,
-                };
-                strncpy(mqtt_data.device_id, app->config.device_id, sizeof(mqtt_data.device_id) - 1);
-                mqtt_data.device_id[sizeof(mqtt_data.device_id) - 1] = '\0';
-                
-                esp_err_t mqtt_ret = mqtt_sender_enqueue_env(&mqtt_data);
-                if (mqtt_ret == ESP_OK) {
-                    if (app->config.enable_logging) {
-                        ESP_LOGI(TAG, "Env data queued for MQTT");
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to queue env data for MQTT: %s", esp_err_to_name(mqtt_ret));
-                }
-            }
-#endif
-        } else {
-            ESP_LOGE(TAG, "AHT20 read failed: %s", esp_err_to_name(ret));
-        }
-
-        count++;
-        if (app->config.measurements_per_cycle > 0 && count >= app->config.measurements_per_cycle) {
-            ESP_LOGI(TAG, "Completed %lu measurements, stopping task", count);
-            // Log stack watermark before exiting
-            hwm = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Env task exiting, stack high watermark: %lu bytes", (unsigned long)(hwm * sizeof(StackType_t)));
-            break;
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(app->config.measurement_interval_ms));
-    }
-
-    ESP_LOGI(TAG, "Environment monitor task stopped");
-    // Extra serial output to confirm task end
-    printf("ENV MONITOR: task completed, preparing for sleep...\n");
-    app->is_running = false;
-    s_task = NULL;
-    vTaskDelete(NULL);
+    env_monitor_app_t* app = (env_monitor_app_t*)ctx;
+    app->last_temperature = reading->values[0];
+    app->last_humidity = reading->values[1];
 }
 
 void env_monitor_get_default_config(env_monitor_config_t* cfg)
@@ -161,22 +69,8 @@ esp_err_t env_monitor_init(env_monitor_app_t* app, const env_monitor_config_t* c
     memcpy(&app->config, cfg, sizeof(*cfg));
 
 #if ENABLE_WIFI
-    // Check if WiFi is already connected (initialized by main)
-    if (!wifi_manager_is_connected()) {
-        ESP_LOGW(TAG, "WiFi not connected, waiting for connection...");
-        int wifi_wait_count = 0;
-        while (!wifi_manager_is_connected() && wifi_wait_count < 30) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            wifi_wait_count++;
-        }
-        
-        if (!wifi_manager_is_connected()) {
-            ESP_LOGE(TAG, "WiFi connection timeout");
-            return ESP_ERR_TIMEOUT;
-        }
-    }
-    
-    ESP_LOGI(TAG, "WiFi is connected - using shared WiFi and InfluxDB instances");
+    // WiFi associates in the background while the sensor warms up; data is queued either way
+    ESP_LOGI(TAG, "Using shared WiFi and InfluxDB instances");
 #else
     ESP_LOGI(TAG, "WiFi disabled - sensor will run in offline mode");
 #endif
@@ -188,56 +82,57 @@ esp_err_t env_monitor_init(env_monitor_app_t* app, const env_monitor_config_t* c
         return ret;
     }
 
-    app->is_running = false;
-    app->last_temperature = 0.0f;
-    app->last_humidity = 0.0f;
-    ESP_LOGI(TAG, "Environment monitoring initialized. Device ID: %s, sleep=%ds, measurements_per_cycle=%lu", app->config.device_id, CONFIG_ENV_SLEEP_SECONDS, (unsigned long)app->config.measurements_per_cycle);
-    return ESP_OK;
-}
-
-esp_err_t env_monitor_start(env_monitor_app_t* app)
-{
-    if (!app) return ESP_ERR_INVALID_ARG;
-    if (app->is_running) return ESP_OK;
-    app->is_running = true;
+#if REPORT_POLICY_ENABLED
+    const report_policy_config_t temp_policy = {
+        .deadband = ENV_REPORT_TEMP_DEADBAND_C,
+        .rate_per_min = ENV_REPORT_TEMP_RATE_PER_MIN,
+        .min_interval_s = ENV_REPORT_MIN_INTERVAL_S,
+        .max_interval_s = ENV_REPORT_MAX_INTERVAL_S,
+    };
+    const report_policy_config_t humidity_policy = {
+        .deadband = ENV_REPORT_HUMIDITY_DEADBAND,
+        .rate_per_min = ENV_REPORT_HUMIDITY_RATE_PER_MIN,
+        .min_interval_s = ENV_REPORT_MIN_INTERVAL_S,
+        .max_interval_s = ENV_REPORT_MAX_INTERVAL_S,
+    };
+    report_policy_configure(REPORT_METRIC_TEMPERATURE, &temp_policy);
+    report_policy_configure(REPORT_METRIC_HUMIDITY, &humidity_policy);
+#endif
+    sample_aggregator_configure(REPORT_METRIC_TEMPERATURE, AGGREGATION_ENABLED ? ENV_AGG_WINDOW_S : 0);
+    sample_aggregator_configure(REPORT_METRIC_HUMIDITY, AGGREGATION_ENABLED ? ENV_AGG_WINDOW_S : 0);
 
-    BaseType_t ok = xTaskCreatePinnedToCore(
-        env_monitor_task,
-        "env_monitor",
-        ENV_TASK_STACK_SIZE,
-        app,
-        ENV_TASK_PRIORITY,
-        &s_task,
-        0
-    );
-    if (ok != pdPASS) {
-        app->is_running = false;
-        return ESP_FAIL;
+    // Start converting now so the ~80 ms overlap with the rest of the startup
+    ret = aht20_start_measurement(&s_aht20);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Early AHT20 trigger failed, task will retry: %s", esp_err_to_name(ret));
     }
-    return ESP_OK;
-}
 
-esp_err_t env_monitor_wait_for_completion(env_monitor_app_t* app, uint32_t timeout_ms)
-{
-    if (!app) return ESP_ERR_INVALID_ARG;
-    if (app->config.measurements_per_cycle == 0) return ESP_ERR_INVALID_STATE;
+    app->last_temperature = 0.0f;
+    app->last_humidity = 0.0f;
 
-    uint32_t elapsed = 0;
-    const uint32_t step = 100;
-    while (s_task != NULL) {
-        vTaskDelay(pdMS_TO_TICKS(step));
-        elapsed += step;
-        if (timeout_ms > 0 && elapsed >= timeout_ms) {
-            return ESP_ERR_TIMEOUT;
-        }
+    // Both values travel in one point, so either one tripping reports both
+    sensor_runtime_sensor_t sensor = {
+        .job = CYCLE_JOB_ENV,
+        .sample_type = TELEMETRY_SAMPLE_ENV,
+        .measurements_per_cycle = cfg->measurements_per_cycle,
+        .interval_ms = cfg->measurement_interval_ms,
+        .publish = cfg->enable_http_sending,
+        .log = cfg->enable_logging,
+        .metric_count = 2,
+        .metrics = { REPORT_METRIC_TEMPERATURE, REPORT_METRIC_HUMIDITY },
+        .metric_values = { 0, 1 },
+        .fill_sample = env_fill_sample,
+        .on_reading = env_on_reading,
+        .ctx = app,
+    };
+    aht20_get_sensor_hal(&s_aht20, &sensor.hal);
+    strncpy(sensor.device_id, cfg->device_id, sizeof(sensor.device_id) - 1);
+    ret = sensor_runtime_register(&sensor);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register AHT20: %s", esp_err_to_name(ret));
+        return ret;
     }
-    return ESP_OK;
-}
-
-esp_err_t env_monitor_stop(env_monitor_app_t* app)
-{
-    if (!app) return ESP_ERR_INVALID_ARG;
-    app->is_running = false;
+    ESP_LOGI(TAG, "Environment monitoring initialized. Device ID: %s, sleep=%ds, measurements_per_cycle=%lu", app->config.device_id, CONFIG_ENV_SLEEP_SECONDS, (unsigned long)app->config.measurements_per_cycle);
     return ESP_OK;
 }
 
@@ -245,9 +140,8 @@ esp_err_t env_monitor_deinit(env_monitor_app_t* app)
 {
     if (!app) return ESP_ERR_INVALID_ARG;
 
-    // Stop task
-    env_monitor_stop(app);
-    while (s_task != NULL) vTaskDelay(pdMS_TO_TICKS(10));
+    // Stop measuring before the sensor goes away (other sensors keep running)
+    sensor_runtime_remove(CYCLE_JOB_ENV, 0);
 
     // Deinit sensor
     aht20_deinit(&s_aht20);
@@ -2,9 +2,9 @@
  * @file env_monitor_app.h
  * @brief Environment Monitoring Application (AHT20 Temperature/Humidity Sensor)
  * 
- * This module provides a complete application layer for monitoring environmental
- * conditions using the AHT20 sensor. Handles sensor initialization, periodic
- * measurements, WiFi connectivity, and InfluxDB data transmission.
+ * This module provides the application layer for monitoring environmental
+ * conditions using the AHT20 sensor. Handles sensor initialization and the
+ * report policy; the sensor runtime takes the measurements (CYCLE_JOB_ENV).
  */
 
 #ifndef ENV_MONITOR_APP_H
@@ -28,7 +28,7 @@ typedef struct {
 
     // App behavior
     uint32_t measurement_interval_ms; // delay between readings
-    uint32_t measurements_per_cycle;  // 0=infinite; else stop after N
+    uint32_t measurements_per_cycle;  // 0=until stopped; else job done after N
     bool enable_logging;
     bool enable_wifi;
     bool enable_http_sending;
@@ -39,7 +39,6 @@ typedef struct {
 
 typedef struct {
     env_monitor_config_t config;
-    bool is_running;
     float last_temperature;
     float last_humidity;
 } env_monitor_app_t;
@@ -48,12 +47,6 @@ void env_monitor_get_default_config(env_monitor_config_t* cfg);
 
 esp_err_t env_monitor_init(env_monitor_app_t* app, const env_monitor_config_t* cfg);
 
-esp_err_t env_monitor_start(env_monitor_app_t* app);
-
-esp_err_t env_monitor_wait_for_completion(env_monitor_app_t* app, uint32_t timeout_ms);
-
-esp_err_t env_monitor_stop(env_monitor_app_t* app);
-
 esp_err_t env_monitor_deinit(env_monitor_app_t* app);
 
 esp_err_t env_monitor_get_last_reading(env_monitor_app_t* app, float* temperature, float* humidity);
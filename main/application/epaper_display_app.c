@@ -5,14 +5,64 @@
 
 #include "epaper_display_app.h"
 #include "../config/esp32-config.h"
+#include "resource_tracker.h"
+#include "event_counters.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_system.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <math.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
 
 static const char* TAG = "EPAPER_APP";
 
+#define EPAPER_DISPLAY_TASK_NAME    "epaper_display"
+#define EPAPER_DISPLAY_EVT_IDLE     BIT0    // No request pending and no refresh running
+#define EPAPER_DISPLAY_RTC_MAGIC    0x45505631  // "EPV1"
+
+// Latest requested values; a newer request overwrites one not yet rendered
+typedef struct {
+    float temperature;
+    float humidity;
+    float soil_moisture;
+    float battery_voltage;
+    bool pending;
+} epaper_display_mailbox_t;
+
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_mailbox_mutex = NULL;
+static EventGroupHandle_t s_events = NULL;
+static epaper_display_mailbox_t s_mailbox;
+static esp_err_t s_last_result = ESP_OK;
+static uint32_t s_coalesced = 0;
+
+// Values on the panel, kept across deep sleep (the panel keeps its image)
+typedef struct {
+    uint32_t magic;
+    float temperature;
+    float humidity;
+    float soil_moisture;
+    float battery_voltage;
+} epaper_display_shown_t;
+
+static RTC_DATA_ATTR epaper_display_shown_t s_shown;
+
+// Value to show: NAN (not measured on this wake) keeps the shown one
+static float epaper_display_value(float value, float shown) {
+    return isnan(value) ? shown : value;
+}
+
+// Same digits at the precision the value is drawn with
+static bool epaper_display_same(float a, float b, float scale) {
+    return roundf(a * scale) == roundf(b * scale);
+}
+
 void epaper_display_get_default_config(epaper_display_config_t* config) {
     if (config == NULL) {
         return;
@@ -30,6 +80,30 @@ void epaper_display_get_default_config(epaper_display_config_t* config) {
     config->show_soil = true;
     config->show_battery = true;
     config->show_timestamp = true;
+    config->large_numerals = true;
+}
+
+// Draw "label value unit" at y and return the line height
+static uint16_t epaper_display_draw_value(epaper_display_app_t* app, uint16_t y,
+                                          const char* label, const char* value, const char* unit) {
+    EVT_LOGD(TAG, "Drawing: %s:%s%s at y=%d", label, value, unit, y);
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
+    
+    if (!app->config.large_numerals) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%s:%s%s", label, value, unit);
+        epaper_draw_text(&app->driver, 10, y, buffer, 2, EPAPER_ALIGN_LEFT);
+        return 18;
+    }
+    
+    // Label and unit (16 px) are bottom-aligned with the 24 px numerals
+    const epaper_font_t* font = &epaper_font_numerals_24;
+    epaper_draw_text(&app->driver, 10, y + 8, label, 2, EPAPER_ALIGN_LEFT);
+    uint16_t x = 26;
+    epaper_draw_text_font(&app->driver, x, y, value, font, EPAPER_ALIGN_LEFT);
+    x += epaper_text_width_font(value, font) + 2;
+    epaper_draw_text(&app->driver, x, y + 8, unit, 2, EPAPER_ALIGN_LEFT);
+    return font->height + 4;
 }
 
 esp_err_t epaper_display_init(epaper_display_app_t* app, const epaper_display_config_t* config) {
@@ -71,6 +145,8 @@ esp_err_t epaper_display_init(epaper_display_app_t* app, const epaper_display_co
     driver_config.power_pin = EPAPER_POWER_PIN;
     driver_config.rotation = EPAPER_ROTATION;
     driver_config.full_update_interval = EPAPER_FULL_UPDATE_INTERVAL;
+    driver_config.full_refresh_percent = EPAPER_FULL_REFRESH_PERCENT;
+    driver_config.ghost_limit_percent = EPAPER_GHOST_LIMIT_PERCENT;
     
     // Initialize driver
     esp_err_t ret = epaper_init(&app->driver, &driver_config);
@@ -87,6 +163,11 @@ esp_err_t epaper_display_init(epaper_display_app_t* app, const epaper_display_co
         return ret;
     }
     
+    // The shown values only describe the panel after a deep sleep wake
+    if (s_shown.magic != EPAPER_DISPLAY_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_shown, 0, sizeof(s_shown));
+    }
+    
     // Just clear framebuffer in memory, don't update display yet
     // First sensor data update will initialize display properly
     epaper_clear(&app->driver);
@@ -103,6 +184,18 @@ esp_err_t epaper_display_deinit(epaper_display_app_t* app) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    // Let a requested refresh finish before the task goes away
+    if (s_task != NULL) {
+        epaper_display_wait_idle(app, EPAPER_DISPLAY_TIMEOUT_MS);
+        xSemaphoreTake(s_mailbox_mutex, portMAX_DELAY);
+        vTaskDelete(s_task);
+        s_task = NULL;
+        vSemaphoreDelete(s_mailbox_mutex);
+        s_mailbox_mutex = NULL;
+        vEventGroupDelete(s_events);
+        s_events = NULL;
+    }
+    
     app->is_running = false;
     
     // Clear display before shutdown
@@ -136,7 +229,7 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
     }
     
     // Clear framebuffer (set all to white)
-    ESP_LOGI(TAG, "Clearing framebuffer...");
+    EVT_LOGD(TAG, "Clearing framebuffer...");
     epaper_clear(&app->driver);
     
     char buffer[64];
@@ -144,46 +237,44 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
     const uint16_t line_height = 18;  // Increased spacing for larger text
     
     // Draw compact header
-    ESP_LOGI(TAG, "Drawing header...");
+    EVT_LOGD(TAG, "Drawing header...");
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
     epaper_draw_text(&app->driver, app->driver.config.width / 2, y_pos, 
                      "Sensor \n  Data", 2, EPAPER_ALIGN_CENTER);
     y_pos += 18 * 2;
     
     // Draw separator line
-    ESP_LOGI(TAG, "Drawing separator at y=%d", y_pos);
+    EVT_LOGD(TAG, "Drawing separator at y=%d", y_pos);
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
     epaper_draw_line(&app->driver, 5, y_pos, app->driver.config.width - 5, y_pos, EPAPER_COLOR_BLACK);
     y_pos += 10;
     
     // Temperature - larger text size
     if (app->config.show_temperature) {
-        snprintf(buffer, sizeof(buffer), "T:%.1fC", temperature);
-        ESP_LOGI(TAG, "Drawing: %s at y=%d", buffer, y_pos);
-        epaper_draw_text(&app->driver, 10, y_pos, buffer, 2, EPAPER_ALIGN_LEFT);
-        y_pos += line_height;
+        snprintf(buffer, sizeof(buffer), "%.1f", temperature);
+        y_pos += epaper_display_draw_value(app, y_pos, "T", buffer, "C");
     }
     
     // Humidity - larger text size
     if (app->config.show_humidity) {
-        snprintf(buffer, sizeof(buffer), "H:%.0f%%", humidity);
-        ESP_LOGI(TAG, "Drawing: %s at y=%d", buffer, y_pos);
-        epaper_draw_text(&app->driver, 10, y_pos, buffer, 2, EPAPER_ALIGN_LEFT);
-        y_pos += line_height;
+        snprintf(buffer, sizeof(buffer), "%.0f", humidity);
+        y_pos += epaper_display_draw_value(app, y_pos, "H", buffer, "%");
     }
     
     // Separator line after temp/humidity
-    ESP_LOGI(TAG, "Drawing separator at y=%d", y_pos);
+    EVT_LOGD(TAG, "Drawing separator at y=%d", y_pos);
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
     epaper_draw_line(&app->driver, 5, y_pos, app->driver.config.width - 5, y_pos, EPAPER_COLOR_BLACK);
     y_pos += 10;
     
     // Soil Moisture - larger text with percentage bar
     if (app->config.show_soil) {
-        snprintf(buffer, sizeof(buffer), "S:%.0f%%", soil_moisture);
-        ESP_LOGI(TAG, "Drawing: %s at y=%d", buffer, y_pos);
-        epaper_draw_text(&app->driver, 10, y_pos, buffer, 2, EPAPER_ALIGN_LEFT);
-        y_pos += line_height;
+        snprintf(buffer, sizeof(buffer), "%.0f", soil_moisture);
+        y_pos += epaper_display_draw_value(app, y_pos, "S", buffer, "%");
         
         // Draw soil moisture indicator bar
-        ESP_LOGI(TAG, "Drawing soil indicator at y=%d", y_pos);
+        EVT_LOGD(TAG, "Drawing soil indicator at y=%d", y_pos);
+        event_counter_inc(EVT_DISPLAY_PRIMITIVE);
         uint16_t soil_bar_width = (uint16_t)(soil_moisture / 100.0 * 102);
         if (soil_bar_width > 102) soil_bar_width = 102;
         if (soil_bar_width > 0) {
@@ -194,19 +285,19 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
     }
     
     // Separator line before battery
-    ESP_LOGI(TAG, "Drawing separator at y=%d", y_pos);
+    EVT_LOGD(TAG, "Drawing separator at y=%d", y_pos);
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
     epaper_draw_line(&app->driver, 5, y_pos, app->driver.config.width - 5, y_pos, EPAPER_COLOR_BLACK);
     y_pos += 10;
     
     // Battery Voltage - larger text with bar
     if (app->config.show_battery) {
-        snprintf(buffer, sizeof(buffer), "B:%.2fV", battery_voltage);
-        ESP_LOGI(TAG, "Drawing: %s at y=%d", buffer, y_pos);
-        epaper_draw_text(&app->driver, 10, y_pos, buffer, 2, EPAPER_ALIGN_LEFT);
-        y_pos += line_height;
+        snprintf(buffer, sizeof(buffer), "%.2f", battery_voltage);
+        y_pos += epaper_display_draw_value(app, y_pos, "B", buffer, "V");
         
         // Draw battery indicator bar
-        ESP_LOGI(TAG, "Drawing battery indicator at y=%d", y_pos);
+        EVT_LOGD(TAG, "Drawing battery indicator at y=%d", y_pos);
+        event_counter_inc(EVT_DISPLAY_PRIMITIVE);
         uint16_t battery_bar_width = (uint16_t)((battery_voltage - 3.0) / (4.2 - 3.0) * 102);
         if (battery_bar_width > 102) battery_bar_width = 102;
         if (battery_bar_width > 0) {
@@ -218,7 +309,8 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
     
 #if ENABLE_WIFI
     // Separator line before timestamp
-    ESP_LOGI(TAG, "Drawing separator at y=%d", y_pos);
+    EVT_LOGD(TAG, "Drawing separator at y=%d", y_pos);
+    event_counter_inc(EVT_DISPLAY_PRIMITIVE);
     epaper_draw_line(&app->driver, 5, y_pos, app->driver.config.width - 5, y_pos, EPAPER_COLOR_BLACK);
     y_pos += 10;
     
@@ -232,25 +324,27 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
         // Check if time is valid (year > 2020 means NTP synced)
         if (timeinfo.tm_year + 1900 > 2020) {
             snprintf(buffer, sizeof(buffer), "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
-            ESP_LOGI(TAG, "Drawing time: %s at y=%d", buffer, y_pos);
+            EVT_LOGD(TAG, "Drawing time: %s at y=%d", buffer, y_pos);
+            event_counter_inc(EVT_DISPLAY_PRIMITIVE);
             epaper_draw_text(&app->driver, 10, y_pos, buffer, 2, EPAPER_ALIGN_LEFT);
             y_pos += line_height;
             
             snprintf(buffer, sizeof(buffer), "%02d.%02d.%04d", 
                      timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
-            ESP_LOGI(TAG, "Drawing date: %s at y=%d", buffer, y_pos);
+            EVT_LOGD(TAG, "Drawing date: %s at y=%d", buffer, y_pos);
+            event_counter_inc(EVT_DISPLAY_PRIMITIVE);
             epaper_draw_text(&app->driver, 10, y_pos, buffer, 1, EPAPER_ALIGN_LEFT);
         } else {
-            ESP_LOGI(TAG, "Time not synced yet");
+            EVT_LOGD(TAG, "Time not synced yet");
         }
     }
 #endif
     
-    // Update display (will auto-select full/partial based on counter)
-    ESP_LOGI(TAG, "Sending framebuffer to display...");
-    esp_err_t ret = epaper_update(&app->driver, false);  // Let driver decide full vs partial
+    // Update display (will auto-select full/partial based on counter); the refresh runs in the background
+    EVT_LOGD(TAG, "Sending framebuffer to display...");
+    esp_err_t ret = epaper_update_start(&app->driver, false);  // Let driver decide full vs partial
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Display updated successfully");
+        EVT_LOGD(TAG, "Display refresh running");
         app->last_update_time = esp_timer_get_time() / 1000; // Convert to ms
     } else {
         ESP_LOGE(TAG, "Display update failed: %s", esp_err_to_name(ret));
@@ -259,6 +353,159 @@ esp_err_t epaper_display_update_data(epaper_display_app_t* app,
     return ret;
 }
 
+esp_err_t epaper_display_wait(epaper_display_app_t* app) {
+    if (app == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = epaper_update_finish(&app->driver);
+    if (ret == ESP_OK) {
+        EVT_LOGD(TAG, "Display updated successfully");
+    } else {
+        ESP_LOGE(TAG, "Display refresh failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static void epaper_display_task(void* arg) {
+    epaper_display_app_t* app = (epaper_display_app_t*)arg;
+    
+    resource_tracker_task_enter(RESOURCE_TASK_EPAPER, EPAPER_TASK_STACK_SIZE);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        xSemaphoreTake(s_mailbox_mutex, portMAX_DELAY);
+        epaper_display_mailbox_t req = s_mailbox;
+        s_mailbox.pending = false;
+        xSemaphoreGive(s_mailbox_mutex);
+        
+        if (req.pending) {
+            esp_err_t ret = epaper_display_update_data(app, req.temperature, req.humidity,
+                                                       req.soil_moisture, req.battery_voltage);
+            if (ret == ESP_OK) {
+                ret = epaper_display_wait(app);
+            }
+            s_last_result = ret;
+        }
+        
+        // Only report idle if no request arrived while this one was refreshing
+        xSemaphoreTake(s_mailbox_mutex, portMAX_DELAY);
+        if (!s_mailbox.pending) {
+            xEventGroupSetBits(s_events, EPAPER_DISPLAY_EVT_IDLE);
+        }
+        xSemaphoreGive(s_mailbox_mutex);
+    }
+}
+
+esp_err_t epaper_display_start(epaper_display_app_t* app) {
+    if (app == NULL || !app->is_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+    
+    s_mailbox_mutex = xSemaphoreCreateMutex();
+    s_events = xEventGroupCreate();
+    if (s_mailbox_mutex == NULL || s_events == NULL) {
+        ESP_LOGE(TAG, "Failed to create display task primitives");
+        if (s_mailbox_mutex != NULL) {
+            vSemaphoreDelete(s_mailbox_mutex);
+            s_mailbox_mutex = NULL;
+        }
+        if (s_events != NULL) {
+            vEventGroupDelete(s_events);
+            s_events = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&s_mailbox, 0, sizeof(s_mailbox));
+    xEventGroupSetBits(s_events, EPAPER_DISPLAY_EVT_IDLE);
+    
+    BaseType_t ok = xTaskCreate(epaper_display_task, EPAPER_DISPLAY_TASK_NAME,
+                                EPAPER_TASK_STACK_SIZE, app, EPAPER_TASK_PRIORITY, &s_task);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create display task");
+        vSemaphoreDelete(s_mailbox_mutex);
+        s_mailbox_mutex = NULL;
+        vEventGroupDelete(s_events);
+        s_events = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "Display task started");
+    return ESP_OK;
+}
+
+bool epaper_display_needs_refresh(float temperature, float humidity,
+                                  float soil_moisture, float battery_voltage) {
+#if EPAPER_REFRESH_ON_CHANGE
+    return s_shown.magic != EPAPER_DISPLAY_RTC_MAGIC ||
+           !epaper_display_same(epaper_display_value(temperature, s_shown.temperature), s_shown.temperature, 10.0f) ||
+           !epaper_display_same(epaper_display_value(humidity, s_shown.humidity), s_shown.humidity, 1.0f) ||
+           !epaper_display_same(epaper_display_value(soil_moisture, s_shown.soil_moisture), s_shown.soil_moisture, 1.0f) ||
+           !epaper_display_same(epaper_display_value(battery_voltage, s_shown.battery_voltage), s_shown.battery_voltage, 100.0f);
+#else
+    return true;
+#endif
+}
+
+esp_err_t epaper_display_request_update(epaper_display_app_t* app,
+                                        float temperature, float humidity,
+                                        float soil_moisture, float battery_voltage) {
+    if (app == NULL || s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!epaper_display_needs_refresh(temperature, humidity, soil_moisture, battery_voltage)) {
+        ESP_LOGI(TAG, "Shown values unchanged, display not refreshed");
+        return ESP_OK;
+    }
+    temperature = epaper_display_value(temperature, s_shown.temperature);
+    humidity = epaper_display_value(humidity, s_shown.humidity);
+    soil_moisture = epaper_display_value(soil_moisture, s_shown.soil_moisture);
+    battery_voltage = epaper_display_value(battery_voltage, s_shown.battery_voltage);
+    
+    s_shown.magic = EPAPER_DISPLAY_RTC_MAGIC;
+    s_shown.temperature = temperature;
+    s_shown.humidity = humidity;
+    s_shown.soil_moisture = soil_moisture;
+    s_shown.battery_voltage = battery_voltage;
+    
+    xSemaphoreTake(s_mailbox_mutex, portMAX_DELAY);
+    if (s_mailbox.pending) {
+        s_coalesced++;
+    }
+    s_mailbox.temperature = temperature;
+    s_mailbox.humidity = humidity;
+    s_mailbox.soil_moisture = soil_moisture;
+    s_mailbox.battery_voltage = battery_voltage;
+    s_mailbox.pending = true;
+    xEventGroupClearBits(s_events, EPAPER_DISPLAY_EVT_IDLE);
+    xSemaphoreGive(s_mailbox_mutex);
+    
+    xTaskNotifyGive(s_task);
+    return ESP_OK;
+}
+
+esp_err_t epaper_display_wait_idle(epaper_display_app_t* app, uint32_t timeout_ms) {
+    if (app == NULL || s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    EventBits_t bits = xEventGroupWaitBits(s_events, EPAPER_DISPLAY_EVT_IDLE, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    if (!(bits & EPAPER_DISPLAY_EVT_IDLE)) {
+        ESP_LOGW(TAG, "Display refresh still running after %lu ms", (unsigned long)timeout_ms);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (s_coalesced > 0) {
+        ESP_LOGI(TAG, "%lu display requests superseded before rendering", (unsigned long)s_coalesced);
+        s_coalesced = 0;
+    }
+    return s_last_result;
+}
+
 esp_err_t epaper_display_refresh(epaper_display_app_t* app, bool full_update) {
     if (app == NULL || !app->is_running) {
         return ESP_ERR_INVALID_STATE;
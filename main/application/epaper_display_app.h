@@ -35,6 +35,7 @@ typedef struct {
     bool show_soil;
     bool show_battery;
     bool show_timestamp;
+    bool large_numerals;             // Values in the 24 px numeral font instead of 5x8 size 2
 } epaper_display_config_t;
 
 // Application Handle
@@ -61,12 +62,53 @@ esp_err_t epaper_display_init(epaper_display_app_t* app, const epaper_display_co
 esp_err_t epaper_display_deinit(epaper_display_app_t* app);
 
 /**
- * @brief Update sensor data to display
+ * @brief Update sensor data to display (returns while the panel refreshes)
  */
 esp_err_t epaper_display_update_data(epaper_display_app_t* app,
                                      float temperature, float humidity,
                                      float soil_moisture, float battery_voltage);
 
+/**
+ * @brief Wait for the refresh started by epaper_display_update_data
+ */
+esp_err_t epaper_display_wait(epaper_display_app_t* app);
+
+/**
+ * @brief Start the display task that serves epaper_display_request_update
+ *
+ * Direct epaper_display_update_data/epaper_display_wait calls must not
+ * overlap a request the task is serving.
+ */
+esp_err_t epaper_display_start(epaper_display_app_t* app);
+
+/**
+ * @brief Hand new sensor data to the display task (does not block on the panel)
+ *
+ * Only the latest values are kept: a request that has not been rendered yet
+ * is replaced. A NAN value (sensor not read on this wake) keeps the value on
+ * the panel; with EPAPER_REFRESH_ON_CHANGE a request whose values all round
+ * to the digits already shown does not refresh the panel.
+ */
+esp_err_t epaper_display_request_update(epaper_display_app_t* app,
+                                        float temperature, float humidity,
+                                        float soil_moisture, float battery_voltage);
+
+/**
+ * @brief Whether a request with these values would refresh the panel
+ *
+ * Works from the values kept across deep sleep, so it needs no initialized
+ * display: a wake whose values change nothing can skip the display bring-up.
+ */
+bool epaper_display_needs_refresh(float temperature, float humidity,
+                                  float soil_moisture, float battery_voltage);
+
+/**
+ * @brief Wait until every requested update has been rendered and refreshed
+ *
+ * @return Result of the last refresh, ESP_ERR_TIMEOUT if still running
+ */
+esp_err_t epaper_display_wait_idle(epaper_display_app_t* app, uint32_t timeout_ms);
+
 /**
  * @brief Force display refresh
  */
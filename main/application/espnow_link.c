@@ -0,0 +1,382 @@
+/**
+ * @file espnow_link.c
+ * @brief ESP-NOW Link between Leaf Nodes and a Gateway - Implementation
+ */
+
+#include "espnow_link.h"
+#include "telemetry.h"
+#include "../config/esp32-config.h"
+#include "espnow_driver.h"
+#include "sample_frame.h"
+#include "esp_utils.h"
+#include "resource_tracker.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_event.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char* TAG = "ESPNOW_LINK";
+
+#define ESPNOW_LINK_RTC_MAGIC       0x454E4C31  // "ENL1"
+
+#define ESPNOW_GATEWAY_TASK_STACK   (4 * 1024)
+#define ESPNOW_GATEWAY_TASK_PRIO    4
+
+// Batches are binary sample frames (sample_frame.h): the frame's ref_ms is the
+// leaf clock at send time, so the gateway shifts timestamps onto its own clock.
+_Static_assert(ESPNOW_LINK_MAX_DEVICES <= SAMPLE_FRAME_MAX_DEVICES, "Leaf device table exceeds the frame's");
+
+// ============================================================================
+// Leaf
+// ============================================================================
+
+typedef struct {
+    uint64_t timestamp_ms;
+    uint8_t type;
+    uint8_t device;
+    uint8_t metric;
+    uint32_t aux;
+    uint16_t count;
+    float v[3];
+} espnow_link_pending_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    char device_ids[ESPNOW_LINK_MAX_DEVICES][32];
+    espnow_link_pending_t samples[ESPNOW_LINK_MAX_SAMPLES];
+} espnow_link_rtc_t;
+
+// Samples of cycles whose send failed survive deep sleep
+static RTC_DATA_ATTR espnow_link_rtc_t s_rtc;
+static SemaphoreHandle_t s_lock = NULL;
+static uint8_t s_buffer[SAMPLE_FRAME_MAX_SIZE];
+static sample_frame_writer_t s_frame;
+static espnow_link_stats_t s_stats;
+static const uint8_t s_gateway_mac[6] = ESPNOW_GATEWAY_MAC;
+
+// Table index of a device id (adds it when new); 0xFF if the table is full
+static uint8_t leaf_device_index(const char* device_id) {
+    for (int i = 0; i < ESPNOW_LINK_MAX_DEVICES; i++) {
+        if (s_rtc.device_ids[i][0] == '\0') {
+            strncpy(s_rtc.device_ids[i], device_id, sizeof(s_rtc.device_ids[i]) - 1);
+            return (uint8_t)i;
+        }
+        if (strncmp(s_rtc.device_ids[i], device_id, sizeof(s_rtc.device_ids[i]) - 1) == 0) {
+            return (uint8_t)i;
+        }
+    }
+    return 0xFF;
+}
+
+static esp_err_t espnow_sink_publish(const telemetry_sample_t* sample) {
+    espnow_link_pending_t rec = {
+        .timestamp_ms = sample->timestamp_ms,
+        .type = (uint8_t)sample->type,
+    };
+
+    switch (sample->type) {
+        case TELEMETRY_SAMPLE_SOIL:
+            rec.v[0] = sample->data.soil.voltage;
+            rec.v[1] = sample->data.soil.moisture_percent;
+            rec.aux = (uint32_t)sample->data.soil.raw_adc;
+            break;
+        case TELEMETRY_SAMPLE_BATTERY:
+            rec.v[0] = sample->data.battery.voltage;
+            rec.v[1] = sample->data.battery.percentage;
+            break;
+        case TELEMETRY_SAMPLE_ENV:
+            rec.v[0] = sample->data.env.temperature;
+            rec.v[1] = sample->data.env.humidity;
+            break;
+        case TELEMETRY_SAMPLE_WINDOW: {
+            const sample_window_t* w = &sample->data.window.window;
+            rec.timestamp_ms = w->start_ms;
+            rec.metric = (uint8_t)sample->data.window.metric;
+            rec.aux = w->window_s;
+            rec.count = (w->count > UINT16_MAX) ? UINT16_MAX : (uint16_t)w->count;
+            rec.v[0] = w->min;
+            rec.v[1] = w->max;
+            rec.v[2] = w->mean;
+            break;
+        }
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    rec.device = leaf_device_index(sample->device_id);
+    if (rec.device == 0xFF) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "Device table full, dropping sample of %s", sample->device_id);
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_rtc.count >= ESPNOW_LINK_MAX_SAMPLES) {
+        // Gateway unreachable for a while: the oldest sample makes room
+        memmove(&s_rtc.samples[0], &s_rtc.samples[1], (ESPNOW_LINK_MAX_SAMPLES - 1) * sizeof(s_rtc.samples[0]));
+        s_rtc.count--;
+        s_stats.samples_dropped++;
+    }
+    s_rtc.samples[s_rtc.count++] = rec;
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+static const telemetry_sink_t s_espnow_sink = {
+    .name = "espnow",
+    .types = TELEMETRY_TYPES_ALL,
+    .is_transport = true,
+    .publish = espnow_sink_publish,
+};
+
+/**
+ * @brief Encode the pending samples into s_buffer (lock held)
+ *
+ * @param encoded Receives the number of samples in the frame (the oldest ones)
+ */
+static size_t leaf_encode_batch(uint32_t* encoded) {
+    sample_frame_writer_init(&s_frame, s_buffer, sizeof(s_buffer), esp_utils_get_timestamp_ms());
+
+    uint32_t n = 0;
+    for (; n < s_rtc.count; n++) {
+        const espnow_link_pending_t* p = &s_rtc.samples[n];
+        sample_frame_record_t rec = {
+            .type = (sample_frame_type_t)p->type,
+            .device_id = s_rtc.device_ids[p->device],
+            .timestamp_ms = p->timestamp_ms,
+            .metric = p->metric,
+            .aux = p->aux,
+            .count = p->count,
+            .v = { p->v[0], p->v[1], p->v[2] },
+        };
+        if (sample_frame_add(&s_frame, &rec) != ESP_OK) {
+            break;
+        }
+    }
+
+    *encoded = n;
+    return sample_frame_finish(&s_frame);
+}
+
+/**
+ * @brief Bring up the WiFi driver for ESP-NOW only (no netif, no association)
+ */
+static esp_err_t leaf_radio_start(void) {
+    esp_err_t ret = esp_event_loop_create_default();
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    return ESP_OK;
+}
+
+esp_err_t espnow_link_start_leaf(void) {
+    if (s_rtc.magic != ESPNOW_LINK_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = ESPNOW_LINK_RTC_MAGIC;
+    }
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t ret = leaf_radio_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Radio start failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    espnow_config_t config = {
+        .node_id = ESPNOW_LINK_NODE_ID,
+        .wifi_channel = ESPNOW_LINK_CHANNEL,
+        .send_timeout_ms = ESPNOW_SEND_TIMEOUT_MS,
+        .max_retries = ESPNOW_MAX_RETRY_COUNT,
+        .end_to_end_ack = true,     // Ignored when the gateway address is broadcast
+        .header_crc = ESPNOW_LINK_HEADER_CRC,
+    };
+    ret = espnow_driver_init(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    espnow_peer_t peer = {
+        .mac_addr = ESPNOW_GATEWAY_MAC,
+        .channel = ESPNOW_LINK_CHANNEL,
+        .encrypt = false,
+    };
+    ret = espnow_driver_add_peer(&peer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Leaf node %d ready (%lu samples pending)", ESPNOW_LINK_NODE_ID, (unsigned long)s_rtc.count);
+    return telemetry_register_sink(&s_espnow_sink);
+}
+
+esp_err_t espnow_link_flush(void) {
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t count = s_rtc.count;
+    if (count == 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    size_t len = leaf_encode_batch(&count);
+    xSemaphoreGive(s_lock);
+    if (len == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = espnow_driver_send(s_gateway_mac, s_buffer, len);
+    if (ret != ESP_OK) {
+        s_stats.batches_failed++;
+        ESP_LOGW(TAG, "Batch not delivered (%s), keeping %lu samples", esp_err_to_name(ret), (unsigned long)count);
+        return ret;
+    }
+
+    // Samples published while the batch was on air stay for the next flush
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t sent = (count < s_rtc.count) ? count : s_rtc.count;
+    memmove(&s_rtc.samples[0], &s_rtc.samples[sent], (s_rtc.count - sent) * sizeof(s_rtc.samples[0]));
+    s_rtc.count -= sent;
+    xSemaphoreGive(s_lock);
+
+    s_stats.batches_sent++;
+    ESP_LOGI(TAG, "Sent %lu samples to the gateway (%u bytes)", (unsigned long)sent, (unsigned)len);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Gateway
+// ============================================================================
+
+static QueueHandle_t s_gateway_queue = NULL;
+
+/**
+ * @brief Decode a leaf batch into samples (runs on the ESP-NOW RX task, keep it short)
+ */
+static void gateway_recv_cb(const uint8_t* src_mac, const uint8_t* data, size_t len, int8_t rssi) {
+    static sample_frame_reader_t reader;    // Only used from the RX task
+    esp_err_t ret = sample_frame_reader_init(&reader, data, len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Unreadable batch (%u bytes): %s", (unsigned)len, esp_err_to_name(ret));
+        return;
+    }
+
+    // The leaf stamped the frame when sending: move its clock onto ours
+    int64_t offset_ms = (int64_t)(esp_utils_get_timestamp_ms() - reader.ref_ms);
+    sample_frame_record_t rec;
+    while ((ret = sample_frame_next(&reader, &rec)) == ESP_OK) {
+        telemetry_sample_t sample;
+        telemetry_sample_init(&sample, (telemetry_sample_type_t)rec.type, rec.device_id);
+        sample.timestamp_ms = rec.timestamp_ms + (uint64_t)offset_ms;
+        switch (sample.type) {
+            case TELEMETRY_SAMPLE_SOIL:
+                sample.data.soil.voltage = rec.v[0];
+                sample.data.soil.moisture_percent = rec.v[1];
+                sample.data.soil.raw_adc = (int)rec.aux;
+                break;
+            case TELEMETRY_SAMPLE_BATTERY:
+                sample.data.battery.voltage = rec.v[0];
+                sample.data.battery.percentage = rec.v[1];
+                break;
+            case TELEMETRY_SAMPLE_ENV:
+                sample.data.env.temperature = rec.v[0];
+                sample.data.env.humidity = rec.v[1];
+                break;
+            case TELEMETRY_SAMPLE_WINDOW:
+                if (rec.metric >= REPORT_METRIC_COUNT) {
+                    continue;
+                }
+                sample.data.window.metric = (report_metric_t)rec.metric;
+                sample.data.window.window = (sample_window_t){
+                    .start_ms = sample.timestamp_ms,
+                    .window_s = rec.aux,
+                    .min = rec.v[0],
+                    .max = rec.v[1],
+                    .mean = rec.v[2],
+                    .count = rec.count,
+                };
+                break;
+            default:
+                continue;
+        }
+
+        if (xQueueSend(s_gateway_queue, &sample, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Gateway queue full, dropping sample of %s", sample.device_id);
+        }
+    }
+    if (ret != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Malformed batch from node, rest dropped");
+    }
+    s_stats.batches_received++;
+}
+
+static void gateway_task(void* arg) {
+    telemetry_sample_t sample;
+
+    resource_tracker_task_enter(RESOURCE_TASK_ESPNOW, ESPNOW_GATEWAY_TASK_STACK);
+    while (1) {
+        if (xQueueReceive(s_gateway_queue, &sample, portMAX_DELAY) == pdTRUE) {
+            if (telemetry_publish(&sample) == ESP_OK) {
+                s_stats.samples_received++;
+            }
+        }
+    }
+}
+
+esp_err_t espnow_link_start_gateway(void) {
+    if (s_gateway_queue != NULL) {
+        return ESP_OK;
+    }
+
+    s_gateway_queue = xQueueCreate(ESPNOW_GATEWAY_QUEUE_SIZE, sizeof(telemetry_sample_t));
+    if (s_gateway_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(gateway_task, "espnow_gw", ESPNOW_GATEWAY_TASK_STACK, NULL,
+                    ESPNOW_GATEWAY_TASK_PRIO, NULL) != pdPASS) {
+        vQueueDelete(s_gateway_queue);
+        s_gateway_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Once associated the radio follows the access point's channel
+    espnow_config_t config = {
+        .node_id = 0,
+        .wifi_channel = ESPNOW_LINK_CHANNEL,
+        .send_timeout_ms = ESPNOW_SEND_TIMEOUT_MS,
+        .max_retries = ESPNOW_MAX_RETRY_COUNT,
+        .header_crc = ESPNOW_LINK_HEADER_CRC,   // ACK frames
+    };
+    esp_err_t ret = espnow_driver_init(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    espnow_driver_register_recv_cb(gateway_recv_cb);
+
+    ESP_LOGI(TAG, "Gateway listening on channel %d", ESPNOW_LINK_CHANNEL);
+    return ESP_OK;
+}
+
+void espnow_link_get_stats(espnow_link_stats_t* stats) {
+    if (stats != NULL) {
+        *stats = s_stats;
+    }
+}
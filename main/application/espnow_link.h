@@ -0,0 +1,53 @@
+/**
+ * @file espnow_link.h
+ * @brief ESP-NOW Link between Leaf Nodes and a Gateway
+ *
+ * Leaf nodes never associate with the access point or start the IP stack.
+ * Their samples are collected by an "espnow" telemetry sink in RTC memory and
+ * sent to the gateway as one binary batch per cycle, which takes a few
+ * milliseconds of radio time instead of seconds of WiFi and HTTPS.
+ *
+ * The mains-powered gateway stays connected to WiFi, decodes the batches of
+ * every leaf and republishes the samples on its own telemetry bus, so the
+ * InfluxDB and MQTT senders upload the whole fleet with their usual batching.
+ *
+ * Batches are binary sample frames (sample_frame.h). Leaves have no wall clock
+ * of their own, so the frame carries the leaf clock at send time and the
+ * gateway moves each timestamp onto its own clock.
+ */
+
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counters since boot
+typedef struct {
+    uint32_t batches_sent;          // Leaf: batches delivered to the gateway
+    uint32_t batches_failed;        // Leaf: sends that failed (samples kept for the next cycle)
+    uint32_t samples_dropped;       // Leaf: oldest samples overwritten while the gateway was unreachable
+    uint32_t batches_received;      // Gateway: batches decoded
+    uint32_t samples_received;      // Gateway: samples republished on the bus
+} espnow_link_stats_t;
+
+// Leaf: start the radio without association, add the gateway peer, register the sink
+esp_err_t espnow_link_start_leaf(void);
+
+// Leaf: send the samples collected so far to the gateway (kept in RTC memory on failure)
+esp_err_t espnow_link_flush(void);
+
+// Gateway: receive leaf batches (call once WiFi is started) and republish them
+esp_err_t espnow_link_start_gateway(void);
+
+void espnow_link_get_stats(espnow_link_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESPNOW_LINK_H
@@ -8,21 +8,41 @@
  */
 
 #include "influx_sender.h"
+#include "influxdb_backlog.h"
+#include "influxdb_router.h"
+#include "sample_block.h"
+#include "sample_frame.h"
+#include "sample_store.h"
+#include "report_policy.h"
+#include "esp_utils.h"
+#include "ntp_time.h"
+#include "time_service.h"
+#include "resource_tracker.h"
+#include "retry_backoff.h"
+#include "wifi_manager.h"
 #include "esp_log.h"
 #include "string.h"
 #include "../config/esp32-config.h"
 #include "../config/credentials.h"
 
-#define INFLUX_SENDER_STACK   (14 * 1024)
+#define INFLUX_SENDER_STACK   (8 * 1024)   // Points are encoded into the heap batch, not on the stack
 #define INFLUX_SENDER_PRIO    5
 #define INFLUX_QUEUE_LEN      10
+#define INFLUX_UNRESOLVED_LEN INFLUX_QUEUE_LEN  // Points held back until the clock is set
+#define INFLUX_CLOCK_POLL_MS  250          // Check for the NTP result while points are held back
+
+#define INFLUX_EVT_DRAINED    BIT0         // Set by the task once a FLUSH request has been fully processed
 
 static const char* TAG = "INFLUX_SENDER";
 
 typedef enum {
     INFLUX_MSG_SOIL,
     INFLUX_MSG_BATTERY,
-    INFLUX_MSG_ENV
+    INFLUX_MSG_ENV,
+    INFLUX_MSG_PERF,
+    INFLUX_MSG_RESOURCES,
+    INFLUX_MSG_WINDOW,
+    INFLUX_MSG_FLUSH        ///< Send the pending batch now and signal completion
 } influx_msg_type_t;
 
 typedef struct {
@@ -31,13 +51,523 @@ typedef struct {
         influxdb_soil_data_t soil;
         influxdb_battery_data_t battery;
         influxdb_env_data_t env;
+        influxdb_perf_data_t perf;
+        influxdb_resource_data_t resources;
+        influxdb_window_data_t window;
+        TickType_t flush_by;    ///< FLUSH: tick by which held-back points must be written (0: no deadline)
     } payload;
 } influx_msg_t;
 
 static TaskHandle_t s_task = NULL;
 static QueueHandle_t s_queue = NULL;
+static EventGroupHandle_t s_events = NULL;
+#if STATIC_ALLOCATION_ENABLED
+static StaticTask_t s_task_buffer;
+static StackType_t s_task_stack[INFLUX_SENDER_STACK];
+static StaticQueue_t s_queue_buffer;
+static uint8_t s_queue_storage[INFLUX_QUEUE_LEN * sizeof(influx_msg_t)];
+static StaticEventGroup_t s_events_buffer;
+#endif
+static influxdb_batch_t s_batch = {0};
+static influx_sender_stats_t s_stats = {0};     // Only written by the sender task
+static volatile bool s_deferred = false;        // Sensor-only wake: points go to the RTC sample store
+static retry_backoff_t s_retry;                 // Next attempt of a failed batch (kept in s_batch meanwhile)
+static bool s_flush_waiting = false;            // A FLUSH request waits for the pending retry to settle
+static influx_sender_ack_cb_t s_ack_cb = NULL;  // Told when queued points leave the sender
+#if NTP_ENABLED
+// Points that predate the first clock set wait here while NTP runs, so the task keeps writing
+static influx_msg_t s_unresolved[INFLUX_UNRESOLVED_LEN];
+static uint8_t s_unresolved_count = 0;
+#endif
+
+// Queued points left the sender (written, stored or dropped)
+static void influx_sender_ack(uint32_t points, bool written, size_t bytes) {
+    influx_sender_ack_cb_t cb = s_ack_cb;
+    if (cb != NULL && points > 0) {
+        cb(points, written, bytes);
+    }
+}
+
+// Count a failed POST. 429/502/503 mean the backend is overloaded: the upload slot moves (upload_slot.h)
+static void influx_sender_count_failure(influxdb_response_status_t r, int http_status, uint32_t retry_after_ms) {
+    s_stats.writes_failed++;
+    if (r == INFLUXDB_RESPONSE_THROTTLED || http_status == 502) {
+        s_stats.writes_throttled++;
+        s_stats.retry_after_ms = retry_after_ms;
+    }
+}
+
+#if INFLUXDB_ROUTER_ENABLED
+// Gateway: relayed points wait here per bucket until the next flush (offline they go to the backlog)
+static influxdb_router_t s_router;
+
+typedef struct {
+    const char* prefix;
+    const char* bucket;
+} influx_gateway_route_t;
+
+static const influx_gateway_route_t s_gateway_routes[] = { INFLUXDB_GATEWAY_ROUTES { NULL, NULL } };
+#endif
+
+#if INFLUXDB_BACKLOG_ENABLED || INFLUXDB_ROUTER_ENABLED
+// Frame form of a queued point; false for points frames cannot carry (perf, resources)
+static bool influx_sender_msg_to_record(const influx_msg_t* msg, sample_frame_record_t* rec) {
+    memset(rec, 0, sizeof(*rec));
+    switch (msg->type) {
+        case INFLUX_MSG_SOIL:
+            rec->type = SAMPLE_FRAME_SOIL;
+            rec->device_id = msg->payload.soil.device_id;
+            rec->timestamp_ms = msg->payload.soil.timestamp_ns / 1000000ULL;
+            rec->v[0] = msg->payload.soil.voltage;
+            rec->v[1] = msg->payload.soil.moisture_percent;
+            rec->aux = (uint32_t)msg->payload.soil.raw_adc;
+            return true;
+        case INFLUX_MSG_BATTERY:
+            rec->type = SAMPLE_FRAME_BATTERY;
+            rec->device_id = msg->payload.battery.device_id;
+            rec->timestamp_ms = msg->payload.battery.timestamp_ns / 1000000ULL;
+            rec->v[0] = msg->payload.battery.voltage;
+            rec->v[1] = msg->payload.battery.percentage;
+            return true;
+        case INFLUX_MSG_ENV:
+            rec->type = SAMPLE_FRAME_ENV;
+            rec->device_id = msg->payload.env.device_id;
+            rec->timestamp_ms = msg->payload.env.timestamp_ns / 1000000ULL;
+            rec->v[0] = msg->payload.env.temperature_c;
+            rec->v[1] = msg->payload.env.humidity_rh;
+            return true;
+        case INFLUX_MSG_WINDOW: {
+            const influxdb_window_data_t* w = &msg->payload.window;
+            uint8_t metric = 0;
+            while (metric < REPORT_METRIC_COUNT && strcmp(report_metric_name((report_metric_t)metric), w->metric) != 0) {
+                metric++;
+            }
+            if (metric >= REPORT_METRIC_COUNT) {
+                return false;
+            }
+            rec->type = SAMPLE_FRAME_WINDOW;
+            rec->device_id = w->device_id;
+            rec->timestamp_ms = w->timestamp_ns / 1000000ULL;
+            rec->metric = metric;
+            rec->aux = w->window_s;
+            rec->count = w->count;
+            rec->v[0] = w->min;
+            rec->v[1] = w->max;
+            rec->v[2] = w->mean;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+#endif
+
+#if INFLUXDB_BACKLOG_ENABLED
+// Points queued while WiFi is offline go straight into a binary frame for the backlog
+#if INFLUXDB_BACKLOG_COMPRESSED
+static sample_block_writer_t s_frame;
+#else
+static sample_frame_writer_t s_frame;
+#endif
+static uint8_t s_frame_buf[INFLUXDB_BACKLOG_FRAME_SIZE];
+static bool s_frame_open = false;
+
+static void influx_sender_store_frame(void) {
+    if (!s_frame_open) {
+        return;
+    }
+    uint32_t points = s_frame.record_count;
+#if INFLUXDB_BACKLOG_COMPRESSED
+    size_t len = sample_block_finish(&s_frame);
+#else
+    size_t len = sample_frame_finish(&s_frame);
+#endif
+    s_frame_open = false;
+    influx_sender_ack(points, false, 0);
+    if (len == 0) {
+        return;
+    }
+
+    esp_err_t ret = influxdb_backlog_is_enabled() ? influxdb_backlog_store_frame(s_frame_buf, len)
+                                                  : ESP_ERR_INVALID_STATE;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store %lu offline points: %s", (unsigned long)points, esp_err_to_name(ret));
+        s_stats.points_dropped += points;
+        return;
+    }
+    s_stats.points_stored += points;
+}
+
+// Add a sample to the backlog frame, storing the frame once it is full
+static esp_err_t influx_sender_add_record_to_frame(const sample_frame_record_t* rec) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+#if INFLUXDB_BACKLOG_COMPRESSED
+        if (!s_frame_open) {
+            sample_block_writer_init(&s_frame, s_frame_buf, sizeof(s_frame_buf), esp_utils_get_timestamp_ms(),
+                                     1, INFLUXDB_BACKLOG_BLOCK_RECORDS);
+            s_frame_open = true;
+        }
+        esp_err_t ret = sample_block_add(&s_frame, rec);
+#else
+        if (!s_frame_open) {
+            sample_frame_writer_init(&s_frame, s_frame_buf, sizeof(s_frame_buf), esp_utils_get_timestamp_ms());
+            s_frame_open = true;
+        }
+        esp_err_t ret = sample_frame_add(&s_frame, rec);
+#endif
+        if (ret != ESP_ERR_NO_MEM || s_frame.record_count == 0) {
+            return ret;
+        }
+        influx_sender_store_frame();    // Full: store it and start the next one
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// Offline: add the point to the backlog frame. ESP_ERR_NOT_SUPPORTED if it needs the text batch.
+static esp_err_t influx_sender_add_to_frame(const influx_msg_t* msg) {
+    sample_frame_record_t rec;
+    if (!influx_sender_msg_to_record(msg, &rec)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return influx_sender_add_record_to_frame(&rec);
+}
+
+static void influx_sender_store_batch(void) {
+    if (!influxdb_backlog_is_enabled()) {
+        ESP_LOGW(TAG, "Backlog unavailable, dropping %d points", s_batch.point_count);
+        s_stats.points_dropped += s_batch.point_count;
+        return;
+    }
+    esp_err_t ret = influxdb_backlog_store(s_batch.buffer, s_batch.length);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store %d points in backlog: %s", s_batch.point_count, esp_err_to_name(ret));
+        s_stats.points_dropped += s_batch.point_count;
+        return;
+    }
+    s_stats.points_stored += s_batch.point_count;
+}
+#endif
+
+#if INFLUXDB_ROUTER_ENABLED
+#if INFLUXDB_BACKLOG_ENABLED
+static esp_err_t influx_sender_spill_record(const sample_frame_record_t* rec, void* ctx) {
+    return influx_sender_add_record_to_frame(rec);
+}
+#endif
+
+// Move the routed points to the backlog (replay writes them to their buckets), drop what does not fit
+static void influx_sender_give_up_router(void) {
+#if INFLUXDB_BACKLOG_ENABLED
+    if (influxdb_backlog_is_enabled()) {
+        size_t spilled = influxdb_router_spill(&s_router, influx_sender_spill_record, NULL);
+        if (spilled > 0) {
+            ESP_LOGI(TAG, "Moved %u routed points to the backlog", (unsigned)spilled);
+        }
+        influx_sender_store_frame();
+    }
+#endif
+    size_t dropped = influxdb_router_clear(&s_router);
+    if (dropped > 0) {
+        ESP_LOGW(TAG, "Dropping %u routed points", (unsigned)dropped);
+        s_stats.points_dropped += dropped;
+        influx_sender_ack(dropped, false, 0);
+    }
+}
+
+// Write the routed points, one POST per bucket. s_batch is the body buffer, so it must be empty.
+// A failed write is retried on the s_retry schedule like a batch; offline or out of retries the
+// points go to the backlog. Returns true if every route was written.
+static bool influx_sender_flush_router(void) {
+    if (influxdb_router_pending(&s_router) == 0 || s_batch.point_count > 0) {
+        return false;
+    }
+    if (!wifi_manager_is_connected()) {
+#if INFLUXDB_BACKLOG_ENABLED
+        influx_sender_give_up_router();
+        retry_backoff_reset(&s_retry);
+#endif
+        return false;   // Without a backlog the points wait in RAM for the connection
+    }
+    if (retry_backoff_wait_ms(&s_retry) > 0) {
+        return false;   // Next attempt not due yet
+    }
+
+    influxdb_router_result_t res;
+    influxdb_router_flush(&s_router, &s_batch, &res);
+    s_stats.writes_ok += res.posts;
+    s_stats.points_written += res.written;
+    s_stats.points_dropped += res.dropped;
+    influx_sender_ack(res.written, true, res.bytes);
+    influx_sender_ack(res.dropped, false, 0);
+    if (res.failed == 0) {
+        retry_backoff_reset(&s_retry);
+        return res.posts > 0;
+    }
+
+    for (uint32_t i = 0; i < res.failed; i++) {
+        influx_sender_count_failure(res.status, res.status_code, res.retry_after_ms);
+    }
+    uint32_t retry_after_ms = (res.status == INFLUXDB_RESPONSE_THROTTLED) ? res.retry_after_ms : 0;
+    if (res.status != INFLUXDB_RESPONSE_AUTH_ERROR && retry_backoff_failed(&s_retry, retry_after_ms)) {
+        ESP_LOGW(TAG, "Retrying %lu routed points in %lu ms (attempt %lu)", (unsigned long)res.kept,
+                 (unsigned long)retry_backoff_wait_ms(&s_retry), (unsigned long)s_retry.failures + 1);
+        return false;
+    }
+    influx_sender_give_up_router();
+    retry_backoff_reset(&s_retry);
+    return false;
+}
+
+// Gateway with routes: frame-capable points wait in the router. ESP_ERR_NOT_SUPPORTED if it needs the text batch.
+static esp_err_t influx_sender_add_to_router(const influx_msg_t* msg) {
+    sample_frame_record_t rec;
+    if (s_router.points == NULL || !influx_sender_msg_to_record(msg, &rec)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    esp_err_t ret = influxdb_router_add(&s_router, NULL, &rec);
+    if (ret == ESP_ERR_NO_MEM) {
+        influx_sender_flush_router();   // Full: write the points, or move them to the backlog
+        ret = influxdb_router_add(&s_router, NULL, &rec);
+    }
+    if (ret == ESP_ERR_NO_MEM) {
+        influx_sender_give_up_router();  // Still full (a retry is pending): make room rather than drop
+        retry_backoff_reset(&s_retry);
+        ret = influxdb_router_add(&s_router, NULL, &rec);
+    }
+    // Never fall back to the default bucket's batch
+    return (ret == ESP_ERR_NO_MEM) ? ESP_FAIL : ret;
+}
+#endif
+
+// Hand the batch to the offline store (or drop it without one) and forget its retries
+static void influx_sender_give_up_batch(void) {
+#if INFLUXDB_BACKLOG_ENABLED
+    influx_sender_store_batch();
+#else
+    s_stats.points_dropped += s_batch.point_count;
+#endif
+    influx_sender_ack(s_batch.point_count, false, 0);
+    influxdb_batch_reset(&s_batch);
+    retry_backoff_reset(&s_retry);
+}
+
+// Server is reachable again: drain stored data with large POSTs (the batch is reused as body)
+static void influx_sender_replay_backlog(void) {
+#if INFLUXDB_BACKLOG_ENABLED
+    if (influxdb_backlog_count() > 0) {
+        int replayed = 0;
+        influxdb_backlog_replay(&s_batch, INFLUXDB_BACKLOG_REPLAY_MAX_POSTS, &replayed);
+        s_stats.points_replayed += replayed;
+    }
+#endif
+}
+
+// Write the batch. A failure keeps it for a retry scheduled by s_retry instead of
+// blocking the task; once the retry budget is used up it goes to the backlog.
+static void influx_sender_flush_batch(void) {
+#if INFLUXDB_BACKLOG_ENABLED
+    influx_sender_store_frame();
+#endif
+    if (s_batch.point_count == 0) {
+#if INFLUXDB_ROUTER_ENABLED
+        if (influx_sender_flush_router()) {
+            influx_sender_replay_backlog();
+        }
+#endif
+        return;
+    }
+#if INFLUXDB_BACKLOG_ENABLED
+    // Offline: keep the encoded lines (with their timestamps) for the next connection
+    if (!wifi_manager_is_connected()) {
+        ESP_LOGI(TAG, "WiFi offline, storing %d points in backlog", s_batch.point_count);
+        influx_sender_give_up_batch();
+#if INFLUXDB_ROUTER_ENABLED
+        influx_sender_flush_router();   // Moves the routed points to the backlog as well
+#endif
+        return;
+    }
+#endif
+    if (retry_backoff_wait_ms(&s_retry) > 0) {
+        return;     // Next attempt not due yet
+    }
+
+    influxdb_response_status_t r = influxdb_write_batch(&s_batch);
+    ESP_LOGI(TAG, "Batch write result: %d (%d points, http=%d, success=%s)", r, s_batch.point_count,
+             influxdb_get_last_status_code(), influxdb_last_write_succeeded()?"yes":"no");
+    if (r != INFLUXDB_RESPONSE_OK) {
+        // Auth errors do not heal by waiting; 429/503 carry the server's own backoff
+        uint32_t retry_after_ms = (r == INFLUXDB_RESPONSE_THROTTLED) ? influxdb_get_retry_after_ms() : 0;
+        influx_sender_count_failure(r, influxdb_get_last_status_code(), retry_after_ms);
+        if (r != INFLUXDB_RESPONSE_AUTH_ERROR && retry_backoff_failed(&s_retry, retry_after_ms)) {
+            ESP_LOGW(TAG, "Retrying %d points in %lu ms (attempt %lu)", s_batch.point_count,
+                     (unsigned long)retry_backoff_wait_ms(&s_retry), (unsigned long)s_retry.failures + 1);
+            return;
+        }
+        influx_sender_give_up_batch();
+        return;
+    }
+
+    s_stats.writes_ok++;
+    s_stats.points_written += s_batch.point_count;
+    influx_sender_ack(s_batch.point_count, true, influxdb_get_last_body_size());
+    influxdb_batch_reset(&s_batch);
+    retry_backoff_reset(&s_retry);
+#if INFLUXDB_ROUTER_ENABLED
+    influx_sender_flush_router();
+#endif
+    influx_sender_replay_backlog();
+}
+
+// The batch must be empty afterwards (it is full): write it, or store it if a retry is pending
+static void influx_sender_settle_batch(void) {
+    influx_sender_flush_batch();
+    if (s_batch.point_count > 0) {
+        influx_sender_give_up_batch();
+    }
+}
+
+#if DEFERRED_UPLOAD_ENABLED
+// Points of sensor-only wakes join this cycle's batch (full batches are written on the way)
+static void influx_sender_drain_store(void) {
+    int drained = 0;
+    for (;;) {
+        if (s_batch.point_count >= INFLUXDB_BATCH_MAX_POINTS) {
+            influx_sender_settle_batch();
+        }
+        esp_err_t ret = sample_store_encode_oldest(&s_batch);
+        if (ret == ESP_ERR_NO_MEM && s_batch.point_count > 0) {
+            influx_sender_settle_batch();
+            continue;
+        }
+        if (ret == ESP_ERR_INVALID_ARG) {
+            s_stats.points_dropped++;
+            continue;
+        }
+        if (ret != ESP_OK) {
+            break;  // Empty (or not initialized)
+        }
+        drained++;
+    }
+    if (drained > 0) {
+        ESP_LOGI(TAG, "Added %d points from sensor-only wakes", drained);
+    }
+}
+#endif
+
+static uint64_t* influx_sender_timestamp(influx_msg_t* msg) {
+    switch (msg->type) {
+        case INFLUX_MSG_SOIL:    return &msg->payload.soil.timestamp_ns;
+        case INFLUX_MSG_BATTERY: return &msg->payload.battery.timestamp_ns;
+        case INFLUX_MSG_ENV:     return &msg->payload.env.timestamp_ns;
+        case INFLUX_MSG_PERF:    return &msg->payload.perf.timestamp_ns;
+        case INFLUX_MSG_RESOURCES: return &msg->payload.resources.timestamp_ns;
+        case INFLUX_MSG_WINDOW:  return &msg->payload.window.timestamp_ns;
+        default: return NULL;
+    }
+}
+
+// Points stamped before the clock was set get their wall-clock time once it is known
+static void influx_sender_resolve_timestamp(influx_msg_t* msg) {
+    uint64_t* timestamp_ns = influx_sender_timestamp(msg);
+    if (timestamp_ns != NULL && !influxdb_timestamp_is_valid(*timestamp_ns)) {
+        *timestamp_ns = time_service_resolve_ms(*timestamp_ns / 1000000ULL) * 1000000ULL;
+    }
+}
+
+#if NTP_ENABLED
+// An NTP sync is running and the clock was never set
+static bool influx_sender_clock_pending(void) {
+    return !time_service_is_valid() && ntp_time_sync_pending();
+}
+
+// The point's wall-clock time is only known once the running sync finished
+static bool influx_sender_awaits_clock(influx_msg_t* msg) {
+    uint64_t* timestamp_ns = influx_sender_timestamp(msg);
+    return timestamp_ns != NULL && !influxdb_timestamp_is_valid(*timestamp_ns) && influx_sender_clock_pending();
+}
+#endif
+
+static esp_err_t influx_sender_add_to_batch(const influx_msg_t* msg) {
+    switch (msg->type) {
+        case INFLUX_MSG_SOIL:
+            return influxdb_batch_add_soil(&s_batch, &msg->payload.soil);
+        case INFLUX_MSG_BATTERY:
+            return influxdb_batch_add_battery(&s_batch, &msg->payload.battery);
+        case INFLUX_MSG_ENV:
+            return influxdb_batch_add_env(&s_batch, &msg->payload.env);
+        case INFLUX_MSG_PERF:
+            return influxdb_batch_add_perf(&s_batch, &msg->payload.perf);
+        case INFLUX_MSG_RESOURCES:
+            return influxdb_batch_add_resources(&s_batch, &msg->payload.resources);
+        case INFLUX_MSG_WINDOW:
+            return influxdb_batch_add_window(&s_batch, &msg->payload.window);
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+// Route, store or batch one point
+static void influx_sender_add_point(influx_msg_t* msg) {
+    influx_sender_resolve_timestamp(msg);
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#if INFLUXDB_ROUTER_ENABLED
+    ret = influx_sender_add_to_router(msg);
+#endif
+#if INFLUXDB_BACKLOG_ENABLED
+    if (ret == ESP_ERR_NOT_SUPPORTED && !wifi_manager_is_connected()) {
+        ret = influx_sender_add_to_frame(msg);
+    }
+#endif
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        ret = influx_sender_add_to_batch(msg);
+    }
+    if (ret == ESP_ERR_NO_MEM) {
+        // Batch body is full: send (or store) what we have and start a new one
+        influx_sender_settle_batch();
+        ret = influx_sender_add_to_batch(msg);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add point (type %d) to batch: %s", msg->type, esp_err_to_name(ret));
+        s_stats.points_dropped++;
+        influx_sender_ack(1, false, 0);
+    }
+    if (s_batch.point_count >= INFLUXDB_BATCH_MAX_POINTS) {
+        influx_sender_flush_batch();
+    }
+}
+
+// Keep a point back while the running sync decides its timestamp; false if it can be added now
+static bool influx_sender_hold_back(influx_msg_t* msg) {
+#if NTP_ENABLED
+    if (s_unresolved_count < INFLUX_UNRESOLVED_LEN && influx_sender_awaits_clock(msg)) {
+        s_unresolved[s_unresolved_count++] = *msg;
+        return true;
+    }
+#endif
+    return false;
+}
+
+#if NTP_ENABLED
+// The sync finished, failed or ran out of time: add the held-back points in arrival order
+static void influx_sender_release_unresolved(void) {
+    uint8_t count = s_unresolved_count;
+    s_unresolved_count = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        influx_sender_add_point(&s_unresolved[i]);
+    }
+}
+#endif
+
+// Complete a waiting FLUSH request once no retry holds the batch back
+static void influx_sender_signal_drained(void) {
+    if (s_flush_waiting && !retry_backoff_pending(&s_retry)) {
+        s_flush_waiting = false;
+        xEventGroupSetBits(s_events, INFLUX_EVT_DRAINED);
+    }
+}
 
 static void influx_sender_task(void* pv) {
+    resource_tracker_task_enter(RESOURCE_TASK_INFLUX, INFLUX_SENDER_STACK);
     ESP_LOGI(TAG, "Influx sender task started");
     // Log stack high watermark to detect potential stack pressure
     UBaseType_t hwm = uxTaskGetStackHighWaterMark(NULL);
@@ -45,27 +575,79 @@ static void influx_sender_task(void* pv) {
 
     influx_msg_t msg;
     while (1) {
-        if (xQueueReceive(s_queue, &msg, portMAX_DELAY) == pdTRUE) {
-            if (msg.type == INFLUX_MSG_SOIL) {
-                influxdb_response_status_t r = influxdb_write_soil_data(&msg.payload.soil);
-                ESP_LOGI(TAG, "Soil write result: %d (http=%d, success=%s)", r, influxdb_get_last_status_code(), influxdb_last_write_succeeded()?"yes":"no");
-            } else if (msg.type == INFLUX_MSG_BATTERY) {
-                influxdb_response_status_t r = influxdb_write_battery_data(&msg.payload.battery);
-                ESP_LOGI(TAG, "Battery write result: %d (http=%d, success=%s)", r, influxdb_get_last_status_code(), influxdb_last_write_succeeded()?"yes":"no");
-            } else if (msg.type == INFLUX_MSG_ENV) {
-                influxdb_response_status_t r = influxdb_write_env_data(&msg.payload.env);
-                ESP_LOGI(TAG, "Env write result: %d (http=%d, success=%s)", r, influxdb_get_last_status_code(), influxdb_last_write_succeeded()?"yes":"no");
+#if NTP_ENABLED
+        if (s_unresolved_count > 0 && !influx_sender_clock_pending()) {
+            influx_sender_release_unresolved();
+        }
+#endif
+        // Block indefinitely while idle; once points are pending, flush after the linger time
+        bool pending = (s_batch.point_count > 0);
+#if INFLUXDB_BACKLOG_ENABLED
+        pending = pending || s_frame_open;
+#endif
+#if INFLUXDB_ROUTER_ENABLED
+        pending = pending || influxdb_router_pending(&s_router) > 0;
+#endif
+        TickType_t wait = pending ? pdMS_TO_TICKS(INFLUXDB_BATCH_LINGER_MS) : portMAX_DELAY;
+        if (retry_backoff_pending(&s_retry) && (s_flush_waiting || retry_backoff_wait_ms(&s_retry) < INFLUXDB_BATCH_LINGER_MS)) {
+            wait = pdMS_TO_TICKS(retry_backoff_wait_ms(&s_retry));
+        }
+        bool polling = false;
+#if NTP_ENABLED
+        if (s_unresolved_count > 0 && wait > pdMS_TO_TICKS(INFLUX_CLOCK_POLL_MS)) {
+            wait = pdMS_TO_TICKS(INFLUX_CLOCK_POLL_MS);
+            polling = true;
+        }
+#endif
+        if (xQueueReceive(s_queue, &msg, wait) != pdTRUE) {
+            if (polling) {
+                continue;   // Only woke up to check the clock
             }
-            // Periodically log stack watermark
-            hwm = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Sender task stack high watermark: %lu bytes", (unsigned long)(hwm * sizeof(StackType_t)));
+            influx_sender_flush_batch();
+            influx_sender_signal_drained();
+            continue;
         }
+
+        if (msg.type == INFLUX_MSG_FLUSH) {
+            // Every point queued before this request is in the batch: once it is written, the caller can stop waiting
+#if NTP_ENABLED
+            if (s_unresolved_count > 0 && influx_sender_clock_pending()) {
+                // Give the sync what the caller's deadline leaves after the retry budget
+                uint32_t wait_ms = NTP_SYNC_TIMEOUT_MS;
+                if (msg.payload.flush_by != 0) {
+                    int32_t left_ms = (int32_t)pdTICKS_TO_MS(msg.payload.flush_by - xTaskGetTickCount());
+                    left_ms -= INFLUXDB_RETRY_BUDGET_MS;
+                    wait_ms = (left_ms > 0) ? (uint32_t)left_ms : 0;
+                }
+                if (wait_ms > 0) {
+                    ntp_time_wait_for_sync(wait_ms);
+                }
+            }
+            influx_sender_release_unresolved();
+#endif
+#if DEFERRED_UPLOAD_ENABLED
+            influx_sender_drain_store();
+#endif
+            influx_sender_flush_batch();
+            s_flush_waiting = true;
+            influx_sender_signal_drained();
+        } else if (!influx_sender_hold_back(&msg)) {
+            influx_sender_add_point(&msg);
+        }
+
+        // Periodically log stack watermark
+        hwm = uxTaskGetStackHighWaterMark(NULL);
+        ESP_LOGD(TAG, "Sender task stack high watermark: %lu bytes", (unsigned long)(hwm * sizeof(StackType_t)));
     }
 }
 
 esp_err_t influx_sender_init(void) {
     static bool client_initialized = false;
     
+    if (s_deferred) {
+        return ESP_OK;  // Nothing to start: points are kept in RTC memory
+    }
+    
     // Initialize InfluxDB client once
     if (!client_initialized) {
         influxdb_client_config_t influx_config = {
@@ -75,6 +657,7 @@ esp_err_t influx_sender_init(void) {
             .org = INFLUXDB_ORG,
             .endpoint = INFLUXDB_ENDPOINT,
             .timeout_ms = 10000,
+            .max_retries = 0,   // Retries are scheduled by the sender task (s_retry)
         };
         strncpy(influx_config.token, INFLUXDB_TOKEN, sizeof(influx_config.token) - 1);
         influx_config.token[sizeof(influx_config.token) - 1] = '\0';
@@ -86,16 +669,91 @@ esp_err_t influx_sender_init(void) {
         }
         client_initialized = true;
         ESP_LOGI(TAG, "InfluxDB client initialized");
+        
+#if INFLUXDB_ROUTER_ENABLED
+        for (const influx_gateway_route_t* gr = s_gateway_routes; gr->prefix != NULL; gr++) {
+            influxdb_route_config_t route = {0};
+            strncpy(route.key, gr->prefix, sizeof(route.key) - 1);
+            strncpy(route.bucket, gr->bucket, sizeof(route.bucket) - 1);
+            ret = influxdb_client_add_route(&route, NULL);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Route for %s not added: %s", gr->prefix, esp_err_to_name(ret));
+            }
+        }
+#endif
     }
     
+#if INFLUXDB_ROUTER_ENABLED
+    // Only needed once there is more than one bucket to write to
+    if (s_router.points == NULL && influxdb_client_route_count() > 1) {
+        esp_err_t ret = influxdb_router_init(&s_router, INFLUXDB_ROUTER_MAX_POINTS);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to allocate the point router, routed points go to %s", INFLUXDB_BUCKET);
+        }
+    }
+#endif
+    
+#if INFLUXDB_BACKLOG_ENABLED
+    if (!influxdb_backlog_is_enabled()) {
+        // Not fatal: without the partition failed batches are dropped as before
+        influxdb_backlog_init(INFLUXDB_BACKLOG_PARTITION);
+    }
+#endif
+
+    const retry_backoff_config_t retry_config = {
+        .base_ms = INFLUXDB_RETRY_BASE_MS,
+        .max_ms = INFLUXDB_RETRY_MAX_MS,
+        .jitter_percent = INFLUXDB_RETRY_JITTER_PERCENT,
+        .budget_ms = INFLUXDB_RETRY_BUDGET_MS,
+    };
+    if (s_task == NULL) {
+        retry_backoff_init(&s_retry, &retry_config);
+    }
+
+    if (s_batch.buffer == NULL) {
+        esp_err_t ret = influxdb_batch_init(&s_batch, 0);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to allocate batch buffer");
+            return ret;
+        }
+    }
+
+    if (s_events == NULL) {
+#if STATIC_ALLOCATION_ENABLED
+        s_events = xEventGroupCreateStatic(&s_events_buffer);
+#else
+        s_events = xEventGroupCreate();
+#endif
+        if (!s_events) {
+            ESP_LOGE(TAG, "Failed to create event group");
+            return ESP_FAIL;
+        }
+    }
     if (s_queue == NULL) {
+#if STATIC_ALLOCATION_ENABLED
+        s_queue = xQueueCreateStatic(INFLUX_QUEUE_LEN, sizeof(influx_msg_t), s_queue_storage, &s_queue_buffer);
+#else
         s_queue = xQueueCreate(INFLUX_QUEUE_LEN, sizeof(influx_msg_t));
+#endif
         if (!s_queue) {
             ESP_LOGE(TAG, "Failed to create queue");
             return ESP_FAIL;
         }
     }
     if (s_task == NULL) {
+#if STATIC_ALLOCATION_ENABLED
+        s_task = xTaskCreateStaticPinnedToCore(
+            influx_sender_task,
+            "influx_sender",
+            INFLUX_SENDER_STACK,
+            NULL,
+            INFLUX_SENDER_PRIO,
+            s_task_stack,
+            &s_task_buffer,
+            0
+        );
+        BaseType_t ok = (s_task != NULL) ? pdPASS : pdFAIL;
+#else
         BaseType_t ok = xTaskCreatePinnedToCore(
             influx_sender_task,
             "influx_sender",
@@ -105,6 +763,7 @@ esp_err_t influx_sender_init(void) {
             &s_task,
             0
         );
+#endif
         if (ok != pdPASS) {
             ESP_LOGE(TAG, "Failed to create sender task");
             return ESP_FAIL;
@@ -114,6 +773,7 @@ esp_err_t influx_sender_init(void) {
 }
 
 esp_err_t influx_sender_enqueue_soil(const influxdb_soil_data_t* data) {
+    if (s_deferred) return sample_store_append_soil(data);
     if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
     influx_msg_t msg = { .type = INFLUX_MSG_SOIL };
     memcpy(&msg.payload.soil, data, sizeof(*data));
@@ -121,6 +781,7 @@ esp_err_t influx_sender_enqueue_soil(const influxdb_soil_data_t* data) {
 }
 
 esp_err_t influx_sender_enqueue_battery(const influxdb_battery_data_t* data) {
+    if (s_deferred) return sample_store_append_battery(data);
     if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
     influx_msg_t msg = { .type = INFLUX_MSG_BATTERY };
     memcpy(&msg.payload.battery, data, sizeof(*data));
@@ -128,45 +789,111 @@ esp_err_t influx_sender_enqueue_battery(const influxdb_battery_data_t* data) {
 }
 
 esp_err_t influx_sender_enqueue_env(const influxdb_env_data_t* data) {
+    if (s_deferred) return sample_store_append_env(data);
     if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
     influx_msg_t msg = { .type = INFLUX_MSG_ENV };
     memcpy(&msg.payload.env, data, sizeof(*data));
     return xQueueSend(s_queue, &msg, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
 }
 
+esp_err_t influx_sender_enqueue_perf(const influxdb_perf_data_t* data) {
+    if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
+    influx_msg_t msg = { .type = INFLUX_MSG_PERF };
+    memcpy(&msg.payload.perf, data, sizeof(*data));
+    return xQueueSend(s_queue, &msg, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t influx_sender_enqueue_resources(const influxdb_resource_data_t* data) {
+    if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
+    influx_msg_t msg = { .type = INFLUX_MSG_RESOURCES };
+    memcpy(&msg.payload.resources, data, sizeof(*data));
+    return xQueueSend(s_queue, &msg, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t influx_sender_enqueue_window(const influxdb_window_data_t* data) {
+    if (s_deferred) return sample_store_append_window(data);
+    if (!s_queue || !data) return ESP_ERR_INVALID_STATE;
+    influx_msg_t msg = { .type = INFLUX_MSG_WINDOW };
+    memcpy(&msg.payload.window, data, sizeof(*data));
+    return xQueueSend(s_queue, &msg, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t influx_sender_enqueue_aggregate(report_metric_t metric, const sample_window_t* window, const char* device_id) {
+    if (!window || !device_id) return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = influx_sender_init();
+    if (ret != ESP_OK) return ret;
+
+    influxdb_window_data_t data = {
+        .timestamp_ns = window->start_ms * 1000000ULL,
+        .metric = report_metric_name(metric),
+        .window_s = window->window_s,
+        .min = window->min,
+        .max = window->max,
+        .mean = window->mean,
+        .count = window->count,
+    };
+    strncpy(data.device_id, device_id, sizeof(data.device_id) - 1);
+    data.device_id[sizeof(data.device_id) - 1] = '\0';
+    return influx_sender_enqueue_window(&data);
+}
+
+void influx_sender_set_deferred(bool deferred) {
+    s_deferred = deferred;
+}
+
 esp_err_t influx_sender_wait_until_empty(uint32_t timeout_ms) {
-    if (!s_queue) {
+    if (!s_queue || !s_events) {
         ESP_LOGW(TAG, "Sender queue not initialized");
         return ESP_ERR_INVALID_STATE;
     }
-    
-    uint32_t elapsed_ms = 0;
-    const uint32_t check_interval_ms = 100;
-    
+
+    TickType_t wait = (timeout_ms > 0) ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY;
+    TickType_t start = xTaskGetTickCount();
+
     ESP_LOGI(TAG, "Waiting for InfluxDB sender queue to empty...");
-    
-    while (uxQueueMessagesWaiting(s_queue) > 0) {
-        vTaskDelay(pdMS_TO_TICKS(check_interval_ms));
-        elapsed_ms += check_interval_ms;
-        
-        if (timeout_ms > 0 && elapsed_ms >= timeout_ms) {
-            ESP_LOGW(TAG, "Timeout waiting for sender queue to empty (%lu messages remaining)", 
-                     uxQueueMessagesWaiting(s_queue));
-            return ESP_ERR_TIMEOUT;
-        }
+
+    // The FLUSH request queues behind all pending points; the task signals once it has been processed
+    xEventGroupClearBits(s_events, INFLUX_EVT_DRAINED);
+    influx_msg_t flush_msg = { .type = INFLUX_MSG_FLUSH };
+    flush_msg.payload.flush_by = (wait == portMAX_DELAY) ? 0 : ((start + wait) | 1);    // Never 0
+    if (xQueueSend(s_queue, &flush_msg, wait) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not queue batch flush request");
+        return ESP_ERR_TIMEOUT;
     }
-    
-    // Give sender task a bit more time to complete the last transmission
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    if (influxdb_last_write_succeeded()) {
-        ESP_LOGI(TAG, "InfluxDB sender queue is empty, last write confirmed (http %d)", influxdb_get_last_status_code());
-    } else {
-        ESP_LOGW(TAG, "InfluxDB sender queue empty BUT last write failed (http %d) -- data NOT accepted", influxdb_get_last_status_code());
+
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    TickType_t remaining = (wait == portMAX_DELAY) ? portMAX_DELAY : (elapsed < wait ? wait - elapsed : 0);
+    EventBits_t bits = xEventGroupWaitBits(s_events, INFLUX_EVT_DRAINED, pdTRUE, pdTRUE, remaining);
+    if (!(bits & INFLUX_EVT_DRAINED)) {
+        ESP_LOGW(TAG, "Timeout waiting for sender queue to empty (%lu messages remaining)",
+                 (unsigned long)uxQueueMessagesWaiting(s_queue));
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // All writes of this cycle are done: release the keep-alive connection before deep sleep
+    // (a continuously running node keeps it for the next cycle)
+    if (DEEP_SLEEP_ENABLED) {
+        influxdb_client_close_connection();
     }
+
+    ESP_LOGI(TAG, "InfluxDB sender drained in %lu ms: %lu written, %lu replayed, %lu stored, %lu dropped (http %d)",
+             (unsigned long)pdTICKS_TO_MS(xTaskGetTickCount() - start),
+             (unsigned long)s_stats.points_written, (unsigned long)s_stats.points_replayed,
+             (unsigned long)s_stats.points_stored, (unsigned long)s_stats.points_dropped,
+             influxdb_get_last_status_code());
     return ESP_OK;
 }
 
+void influx_sender_get_stats(influx_sender_stats_t* stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
+
+void influx_sender_set_ack_cb(influx_sender_ack_cb_t cb) {
+    s_ack_cb = cb;
+}
+
 esp_err_t influx_sender_deinit(void) {
     // Stop task:
     if (s_task) {
@@ -178,6 +905,18 @@ esp_err_t influx_sender_deinit(void) {
         vQueueDelete(s_queue);
         s_queue = NULL;
     }
+    if (s_events) {
+        vEventGroupDelete(s_events);
+        s_events = NULL;
+    }
+    influxdb_batch_free(&s_batch);
+#if NTP_ENABLED
+    s_unresolved_count = 0;     // Lost like the points still queued
+#endif
+#if INFLUXDB_ROUTER_ENABLED
+    influx_sender_give_up_router();
+    influxdb_router_free(&s_router);
+#endif
     ESP_LOGI(TAG, "Influx sender deinitialized");
     return ESP_OK;
 }
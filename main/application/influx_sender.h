@@ -5,6 +5,13 @@
  * Provides a queue-based service task for asynchronously sending sensor data
  * to InfluxDB. Decouples measurement tasks from HTTP transmission to prevent
  * stack overflow and improve system responsiveness.
+ *
+ * Queued points are collected into one line protocol batch and written with a
+ * single POST when the batch is full, when the queue has been idle for
+ * INFLUXDB_BATCH_LINGER_MS, or when influx_sender_wait_until_empty() is called.
+ *
+ * With INFLUXDB_BACKLOG_ENABLED, batches that cannot be written (WiFi offline or
+ * write failed) are stored in flash and replayed after the next successful write.
  */
 
 #ifndef INFLUX_SENDER_H
@@ -14,12 +21,37 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "influxdb_client.h"
+#include "sample_aggregator.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Point counters since init (updated by the sender task)
+ */
+typedef struct {
+    uint32_t points_written;        ///< Points accepted by the server in live writes
+    uint32_t points_replayed;       ///< Backlog points accepted during replay
+    uint32_t points_stored;         ///< Points moved to the offline backlog
+    uint32_t points_dropped;        ///< Points lost (encode error, write failed without backlog)
+    uint32_t writes_ok;             ///< Successful batch POSTs
+    uint32_t writes_failed;         ///< Failed batch POSTs
+    uint32_t writes_throttled;      ///< Failed batch POSTs the backend refused for load (429/502/503)
+    uint32_t retry_after_ms;        ///< Retry-After of the last of those responses (0 = none sent)
+} influx_sender_stats_t;
+
+/**
+ * @brief Called on the sender task when queued points leave the sender
+ *
+ * Points leave in the order they were queued. written is true when the server
+ * accepted them; otherwise they were stored in the backlog or dropped. bytes is
+ * the request body on the wire (0 when nothing was sent).
+ */
+typedef void (*influx_sender_ack_cb_t)(uint32_t points, bool written, size_t bytes);
+
 // Initialize and start the sender task (idempotent)
 esp_err_t influx_sender_init(void);
 
@@ -27,10 +59,28 @@ esp_err_t influx_sender_init(void);
 esp_err_t influx_sender_enqueue_soil(const influxdb_soil_data_t* data);
 esp_err_t influx_sender_enqueue_battery(const influxdb_battery_data_t* data);
 esp_err_t influx_sender_enqueue_env(const influxdb_env_data_t* data);
+esp_err_t influx_sender_enqueue_perf(const influxdb_perf_data_t* data);
+esp_err_t influx_sender_enqueue_resources(const influxdb_resource_data_t* data);
+esp_err_t influx_sender_enqueue_window(const influxdb_window_data_t* data);
+
+// Enqueue a closed aggregation window of a metric as a sensor_window point (starts the sender if needed)
+esp_err_t influx_sender_enqueue_aggregate(report_metric_t metric, const sample_window_t* window, const char* device_id);
+
+// Sensor-only wake: point enqueues go to the RTC sample store (see sample_store.h) and the
+// sender task is not started. The stored points are drained into the batch on the next flush
+// of a wake that runs the sender.
+void influx_sender_set_deferred(bool deferred);
 
-// Wait until the queue is empty (all data has been sent)
+// Flush the pending batch and block until every point queued so far has been written
+// or stored (0 = wait forever). Returns as soon as the last write completes.
 esp_err_t influx_sender_wait_until_empty(uint32_t timeout_ms);
 
+// Copy the point counters (consistent after influx_sender_wait_until_empty returned)
+void influx_sender_get_stats(influx_sender_stats_t* stats);
+
+// Register the ack callback (NULL to remove), e.g. to measure enqueue-to-ack latency
+void influx_sender_set_ack_cb(influx_sender_ack_cb_t cb);
+
 // Stop sender task and free queue (for clean deep-sleep deinit)
 esp_err_t influx_sender_deinit(void);
 
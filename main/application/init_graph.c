@@ -0,0 +1,250 @@
+/**
+ * @file init_graph.c
+ * @brief Lazy Component Initialization - Implementation
+ */
+
+#include "init_graph.h"
+#include "../config/esp32-config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+static const char* TAG = "INIT_GRAPH";
+
+_Static_assert(INIT_GRAPH_MAX_NODES <= 24, "One event group bit per component");
+
+typedef enum {
+    INIT_NODE_IDLE = 0,
+    INIT_NODE_STARTING,             // Claimed by an init task
+    INIT_NODE_UP,
+    INIT_NODE_FAILED,
+} init_node_state_t;
+
+static const init_graph_node_t* s_nodes = NULL;
+static int s_count = 0;
+static uint32_t s_all = 0;
+static init_node_state_t s_state[INIT_GRAPH_MAX_NODES];
+static uint32_t s_wanted = 0;       // Started by a caller, directly or as a dependency
+static uint32_t s_up = 0;
+static uint32_t s_failed = 0;
+
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static StaticEventGroup_t s_done_buffer;
+static EventGroupHandle_t s_done = NULL;   // Bit per component: up or failed
+
+static int init_graph_run(int node);
+
+// Components of mask plus everything they depend on
+static uint32_t init_graph_closure(uint32_t mask) {
+    uint32_t prev;
+    do {
+        prev = mask;
+        for (int i = 0; i < s_count; i++) {
+            if (mask & INIT_GRAPH_BIT(i)) {
+                mask |= s_nodes[i].deps;
+            }
+        }
+    } while (mask != prev);
+    return mask & s_all;
+}
+
+// Record the outcome of a component (lock held)
+static void init_graph_finish_locked(int node, bool up) {
+    s_state[node] = up ? INIT_NODE_UP : INIT_NODE_FAILED;
+    if (up) {
+        s_up |= INIT_GRAPH_BIT(node);
+    } else {
+        s_failed |= INIT_GRAPH_BIT(node);
+    }
+    xEventGroupSetBits(s_done, INIT_GRAPH_BIT(node));
+}
+
+/**
+ * @brief Claim the wanted components whose dependencies are all up (lock held)
+ *
+ * Components without an init function are up at once, components with a
+ * failed dependency fail at once; both can release further components.
+ *
+ * @return Claimed components, to be run by an init task
+ */
+static uint32_t init_graph_claim_locked(void) {
+    uint32_t ready = 0;
+    bool changed;
+    do {
+        changed = false;
+        for (int i = 0; i < s_count; i++) {
+            if (!(s_wanted & INIT_GRAPH_BIT(i)) || s_state[i] != INIT_NODE_IDLE) {
+                continue;
+            }
+            uint32_t deps = s_nodes[i].deps;
+            if (s_failed & deps) {
+                ESP_LOGW(TAG, "%s not started, a dependency failed", s_nodes[i].name);
+                init_graph_finish_locked(i, false);
+                changed = true;
+            } else if ((s_up & deps) == deps) {
+                if (s_nodes[i].init == NULL) {
+                    init_graph_finish_locked(i, true);
+                    changed = true;
+                } else {
+                    s_state[i] = INIT_NODE_STARTING;
+                    ready |= INIT_GRAPH_BIT(i);
+                }
+            }
+        }
+    } while (changed);
+    return ready;
+}
+
+static void init_graph_task(void* arg) {
+    int node = (int)(intptr_t)arg;
+    while (node >= 0) {
+        node = init_graph_run(node);
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Start an init task for each claimed component
+ *
+ * @param ready Claimed components
+ * @param keep_one Leave the first one to the calling init task instead
+ * @return Component kept for the caller, -1 if none
+ */
+static int init_graph_spawn(uint32_t ready, bool keep_one) {
+    int own = -1;
+    for (int i = 0; i < s_count; i++) {
+        if (!(ready & INIT_GRAPH_BIT(i))) {
+            continue;
+        }
+        if (keep_one && own < 0) {
+            own = i;
+            continue;
+        }
+        if (xTaskCreate(init_graph_task, INIT_TASK_NAME, INIT_TASK_STACK_SIZE, (void*)(intptr_t)i,
+                        INIT_TASK_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "No init task for %s", s_nodes[i].name);
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            init_graph_finish_locked(i, false);
+            init_graph_claim_locked();      // Only fails the dependents, nothing becomes ready
+            xSemaphoreGive(s_lock);
+        }
+    }
+    return own;
+}
+
+// Bring one claimed component up; returns the next component for this task (-1: none)
+static int init_graph_run(int node) {
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = s_nodes[node].init();
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "%s up (%lu ms)", s_nodes[node].name, (unsigned long)ms);
+    } else {
+        ESP_LOGE(TAG, "%s failed: %s", s_nodes[node].name, esp_err_to_name(ret));
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    init_graph_finish_locked(node, ret == ESP_OK);
+    uint32_t ready = init_graph_claim_locked();
+    xSemaphoreGive(s_lock);
+    return init_graph_spawn(ready, true);
+}
+
+esp_err_t init_graph_setup(const init_graph_node_t* nodes, int count) {
+    if (nodes == NULL || count <= 0 || count > INIT_GRAPH_MAX_NODES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_nodes != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t all = INIT_GRAPH_BIT(count) - 1;
+
+    // Every component must become startable once its dependencies are: peel off
+    // the components whose dependencies are resolved until none is left
+    uint32_t resolved = 0;
+    uint32_t prev;
+    do {
+        prev = resolved;
+        for (int i = 0; i < count; i++) {
+            if (nodes[i].deps & ~all) {
+                ESP_LOGE(TAG, "%s depends on an unknown component", nodes[i].name);
+                return ESP_ERR_INVALID_ARG;
+            }
+            if ((resolved & nodes[i].deps) == nodes[i].deps) {
+                resolved |= INIT_GRAPH_BIT(i);
+            }
+        }
+    } while (resolved != prev);
+    if (resolved != all) {
+        ESP_LOGE(TAG, "Dependency cycle (components 0x%04lx)", (unsigned long)(all & ~resolved));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+    s_done = xEventGroupCreateStatic(&s_done_buffer);
+    s_nodes = nodes;
+    s_count = count;
+    s_all = all;
+    return ESP_OK;
+}
+
+esp_err_t init_graph_start(uint32_t mask) {
+    if (s_nodes == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_wanted |= init_graph_closure(mask);
+    uint32_t ready = init_graph_claim_locked();
+    xSemaphoreGive(s_lock);
+
+    init_graph_spawn(ready, false);
+    return ESP_OK;
+}
+
+esp_err_t init_graph_wait(uint32_t mask, uint32_t timeout_ms) {
+    if (s_nodes == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mask &= s_all;
+    if ((mask & s_wanted) != mask) {
+        ESP_LOGE(TAG, "Waiting for components never started (0x%04lx)", (unsigned long)(mask & ~s_wanted));
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (mask == 0) {
+        return ESP_OK;
+    }
+
+    TickType_t wait = (timeout_ms > 0) ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY;
+    EventBits_t done = xEventGroupWaitBits(s_done, mask, pdFALSE, pdTRUE, wait);
+    if ((done & mask) != mask) {
+        for (int i = 0; i < s_count; i++) {
+            if ((mask & ~done) & INIT_GRAPH_BIT(i)) {
+                ESP_LOGW(TAG, "%s still starting after %lu ms", s_nodes[i].name, (unsigned long)timeout_ms);
+            }
+        }
+        return ESP_ERR_TIMEOUT;
+    }
+    return (init_graph_failed(mask) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t init_graph_require(uint32_t mask, uint32_t timeout_ms) {
+    esp_err_t ret = init_graph_start(mask);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return init_graph_wait(mask, timeout_ms);
+}
+
+uint32_t init_graph_up(uint32_t mask) {
+    return s_up & mask;
+}
+
+uint32_t init_graph_failed(uint32_t mask) {
+    return s_failed & mask;
+}
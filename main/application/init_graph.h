@@ -0,0 +1,65 @@
+/**
+ * @file init_graph.h
+ * @brief Lazy Component Initialization
+ *
+ * Components (network stack, WiFi, senders, sensors, display) are brought up
+ * the first time a cycle asks for them instead of all at boot, so a wake that
+ * only measures never pays for the radio or display bring-up. Each component
+ * names the components it needs; starting one also starts its dependencies
+ * first. Components that do not depend on each other start concurrently, each
+ * on a short-lived init task, so the bring-up takes as long as the slowest
+ * chain instead of the sum of all inits.
+ *
+ * A component is brought up once. One that failed stays failed for the rest
+ * of the boot, and so does everything that depends on it.
+ */
+
+#ifndef INIT_GRAPH_H
+#define INIT_GRAPH_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INIT_GRAPH_MAX_NODES    16
+#define INIT_GRAPH_BIT(node)    (1UL << (node))
+
+/**
+ * @brief One component of the graph
+ */
+typedef struct {
+    const char* name;
+    esp_err_t (*init)(void);        ///< Bring the component up (NULL: nothing to do, always up)
+    uint32_t deps;                  ///< INIT_GRAPH_BIT mask of components that must be up first
+} init_graph_node_t;
+
+// Install the component table (must stay valid), indexed by component id.
+// Call once, before any other function; dependencies must not form a cycle.
+esp_err_t init_graph_setup(const init_graph_node_t* nodes, int count);
+
+// Start the components in mask and their dependencies without waiting.
+// Components already up or starting are left alone.
+esp_err_t init_graph_start(uint32_t mask);
+
+// Wait up to timeout_ms for the components in mask (0 = wait forever).
+// ESP_OK if all are up, ESP_FAIL if one of them failed, ESP_ERR_TIMEOUT.
+esp_err_t init_graph_wait(uint32_t mask, uint32_t timeout_ms);
+
+// init_graph_start() followed by init_graph_wait()
+esp_err_t init_graph_require(uint32_t mask, uint32_t timeout_ms);
+
+// Components of mask that are up
+uint32_t init_graph_up(uint32_t mask);
+
+// Components of mask that failed (or whose dependency failed)
+uint32_t init_graph_failed(uint32_t mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INIT_GRAPH_H
@@ -3,7 +3,10 @@
  * @brief MQTT Data Sender Service Implementation
  * 
  * Implements a queue-based service task for asynchronously sending sensor data
- * to MQTT broker using JSON format.
+ * to MQTT broker. Messages that cannot be published, and (with deep sleep)
+ * QoS 1 messages still unacknowledged at the end of a cycle, are kept in the
+ * flash outbox and replayed oldest first on the next connection. Without deep
+ * sleep unacknowledged messages stay with the client, which retransmits them.
  */
 
 #include "mqtt_sender.h"
@@ -13,7 +16,10 @@
 #include "wifi_manager.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "cJSON.h"
+#include "mqtt_payload.h"
+#include "mqtt_outbox.h"
+#include "resource_tracker.h"
+#include "event_counters.h"
 #include <string.h>
 
 static const char *TAG = "MQTT_SENDER";
@@ -22,7 +28,8 @@ static const char *TAG = "MQTT_SENDER";
 typedef enum {
     MQTT_MSG_TYPE_SOIL,
     MQTT_MSG_TYPE_BATTERY,
-    MQTT_MSG_TYPE_ENV
+    MQTT_MSG_TYPE_ENV,
+    MQTT_MSG_TYPE_SYNC      // Completion marker queued by mqtt_sender_wait_until_empty
 } mqtt_message_type_t;
 
 // Union message structure
@@ -32,6 +39,7 @@ typedef struct {
         mqtt_soil_data_t soil;
         mqtt_battery_data_t battery;
         mqtt_env_data_t env;
+        int64_t sync_deadline_us;   // Time by which the cycle must be flushed
     } data;
 } mqtt_queue_message_t;
 
@@ -40,145 +48,424 @@ typedef struct {
 #define MQTT_SENDER_TASK_PRIORITY   4
 #define MQTT_SENDER_TASK_NAME       "mqtt_sender"
 
+#define MQTT_SENDER_EVT_DRAINED     BIT0
+
+// Time kept free before the flush deadline to move unacked messages to flash
+#define MQTT_FLUSH_MARGIN_MS        500
+
 static QueueHandle_t mqtt_queue = NULL;
 static TaskHandle_t mqtt_task_handle = NULL;
+static EventGroupHandle_t mqtt_events = NULL;
+#if STATIC_ALLOCATION_ENABLED
+static StaticTask_t mqtt_task_buffer;
+static StackType_t mqtt_task_stack[MQTT_SENDER_TASK_STACK_SIZE];
+static StaticQueue_t mqtt_queue_buffer;
+static uint8_t mqtt_queue_storage[MQTT_SENDER_QUEUE_SIZE * sizeof(mqtt_queue_message_t)];
+static StaticEventGroup_t mqtt_events_buffer;
+#endif
 static bool mqtt_initialized = false;
+static bool mqtt_connect_started = false;
+static uint32_t messages_published = 0;
+static uint32_t messages_failed = 0;
+static uint32_t messages_stored = 0;
+static uint32_t messages_replayed = 0;
+static mqtt_sender_ack_cb_t s_ack_cb = NULL;
+
+// Latest sample of each type since the last snapshot publish
+typedef struct {
+    bool has_soil;
+    bool has_battery;
+    bool has_env;
+    mqtt_soil_data_t soil;
+    mqtt_battery_data_t battery;
+    mqtt_env_data_t env;
+    uint32_t queued;                // Messages merged since the last publish
+} mqtt_snapshot_t;
+
+static mqtt_snapshot_t s_snapshot;
+static char s_snapshot_topic[96];
+
+// Topic and payload encoding per message type, topics are built once at init
+typedef struct {
+    const char* suffix;
+    mqtt_payload_format_t format;
+    char topic[64];
+} mqtt_topic_t;
+
+static mqtt_topic_t s_topics[] = {
+    [MQTT_MSG_TYPE_SOIL]    = { .suffix = "soil",        .format = MQTT_SOIL_PAYLOAD_FORMAT },
+    [MQTT_MSG_TYPE_BATTERY] = { .suffix = "battery",     .format = MQTT_BATTERY_PAYLOAD_FORMAT },
+    [MQTT_MSG_TYPE_ENV]     = { .suffix = "environment", .format = MQTT_ENV_PAYLOAD_FORMAT },
+};
+
+// Only the sender task encodes, so one buffer is reused for every publish
+static uint8_t s_payload_buf[MQTT_PAYLOAD_BUFFER_SIZE];
+
+// Unacknowledged publishes go to the flash outbox only when the client's own copy dies
+// with deep sleep; otherwise the client retransmits them and a flash copy would be a duplicate
+#define MQTT_UNACKED_TO_OUTBOX      (MQTT_OUTBOX_ENABLED && DEEP_SLEEP_ENABLED)
+
+#if MQTT_UNACKED_TO_OUTBOX
+// Copies of QoS > 0 publishes of this cycle, stored to the outbox if never acknowledged
+typedef struct {
+    int msg_id;
+    bool retain;
+    uint16_t len;
+    char topic[96];
+    uint8_t payload[MQTT_PAYLOAD_BUFFER_SIZE];
+} mqtt_unacked_t;
+
+static mqtt_unacked_t s_unacked[MQTT_UNACKED_JOURNAL_SIZE];
+static size_t s_unacked_count = 0;
+#endif
+
+static void mqtt_build_topics(void) {
+    for (size_t i = 0; i < sizeof(s_topics) / sizeof(s_topics[0]); i++) {
+        snprintf(s_topics[i].topic, sizeof(s_topics[i].topic), "%s/%s", MQTT_BASE_TOPIC, s_topics[i].suffix);
+    }
+    snprintf(s_snapshot_topic, sizeof(s_snapshot_topic), "%s/%s", MQTT_BASE_TOPIC, MQTT_DEVICE_ID);
+}
 
 /**
- * @brief Build JSON payload for soil data
+ * @brief Encode a queued message into the payload buffer
  */
-static char* build_soil_json(const mqtt_soil_data_t* data) {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        return NULL;
-    }
-    
-    cJSON_AddStringToObject(root, "device_id", data->device_id);
-    cJSON_AddNumberToObject(root, "timestamp", data->timestamp_ms);
-    cJSON_AddNumberToObject(root, "voltage", data->voltage);
-    cJSON_AddNumberToObject(root, "moisture_percent", data->moisture_percent);
-    cJSON_AddNumberToObject(root, "raw_adc", data->raw_adc);
+static esp_err_t encode_mqtt_message(const mqtt_queue_message_t* msg, mqtt_payload_t* p) {
+    mqtt_payload_init(p, s_topics[msg->type].format, s_payload_buf, sizeof(s_payload_buf));
     
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    switch (msg->type) {
+        case MQTT_MSG_TYPE_SOIL:
+            mqtt_payload_string(p, "device_id", msg->data.soil.device_id);
+            mqtt_payload_uint(p, "timestamp", msg->data.soil.timestamp_ms);
+            mqtt_payload_float(p, "voltage", msg->data.soil.voltage, 3);
+            mqtt_payload_float(p, "moisture_percent", msg->data.soil.moisture_percent, 2);
+            mqtt_payload_int(p, "raw_adc", msg->data.soil.raw_adc);
+            break;
+            
+        case MQTT_MSG_TYPE_BATTERY:
+            mqtt_payload_string(p, "device_id", msg->data.battery.device_id);
+            mqtt_payload_uint(p, "timestamp", msg->data.battery.timestamp_ms);
+            mqtt_payload_float(p, "voltage", msg->data.battery.voltage, 3);
+            mqtt_payload_float(p, "percentage", msg->data.battery.percentage, 1);
+            break;
+            
+        case MQTT_MSG_TYPE_ENV:
+            mqtt_payload_string(p, "device_id", msg->data.env.device_id);
+            mqtt_payload_uint(p, "timestamp", msg->data.env.timestamp_ms);
+            mqtt_payload_float(p, "temperature", msg->data.env.temperature, 2);
+            mqtt_payload_float(p, "humidity", msg->data.env.humidity, 2);
+            break;
+            
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
     
-    return json_string;
+    return mqtt_payload_end(p);
 }
 
 /**
- * @brief Build JSON payload for battery data
+ * @brief Wait for WiFi and the broker session before a publish
  */
-static char* build_battery_json(const mqtt_battery_data_t* data) {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        return NULL;
+static esp_err_t mqtt_sender_ensure_connected(void) {
+    if (!wifi_manager_is_connected()) {
+        // Sensors may queue data while WiFi is still associating
+        if (!wifi_manager_is_connecting_or_connected() ||
+            wifi_manager_wait_for_connection(MQTT_TIMEOUT_MS) != ESP_OK) {
+            ESP_LOGW(TAG, "WiFi not connected, skipping MQTT transmission");
+            return ESP_ERR_INVALID_STATE;
+        }
     }
     
-    cJSON_AddStringToObject(root, "device_id", data->device_id);
-    cJSON_AddNumberToObject(root, "timestamp", data->timestamp_ms);
-    cJSON_AddNumberToObject(root, "voltage", data->voltage);
-    cJSON_AddNumberToObject(root, "percentage", data->percentage);
+    // Connect lazily once WiFi is up (the client reconnects on its own afterwards)
+    if (!mqtt_client_is_connected() && !mqtt_connect_started) {
+        mqtt_connect_started = true;
+        mqtt_client_connect();
+    }
     
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    if (!mqtt_client_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping transmission");
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+#if MQTT_UNACKED_TO_OUTBOX
+/**
+ * @brief Remember a publish until its acknowledgement arrives
+ */
+static void mqtt_unacked_add(int msg_id, const char* topic, const uint8_t* payload,
+                             size_t len, bool retain) {
+    if (s_unacked_count >= MQTT_UNACKED_JOURNAL_SIZE) {
+        // Drop entries that were acknowledged in the meantime
+        size_t n = 0;
+        for (size_t i = 0; i < s_unacked_count; i++) {
+            if (mqtt_client_is_pending(s_unacked[i].msg_id)) {
+                if (n != i) {
+                    s_unacked[n] = s_unacked[i];
+                }
+                n++;
+            }
+        }
+        s_unacked_count = n;
+    }
+    if (s_unacked_count >= MQTT_UNACKED_JOURNAL_SIZE || len > sizeof(s_unacked[0].payload) ||
+        strlen(topic) >= sizeof(s_unacked[0].topic)) {
+        ESP_LOGW(TAG, "Unacked journal full, msg_id=%d not kept for the outbox", msg_id);
+        return;
+    }
     
-    return json_string;
+    mqtt_unacked_t* e = &s_unacked[s_unacked_count++];
+    e->msg_id = msg_id;
+    e->retain = retain;
+    e->len = (uint16_t)len;
+    strcpy(e->topic, topic);
+    memcpy(e->payload, payload, len);
 }
 
 /**
- * @brief Build JSON payload for environment data
+ * @brief Move publishes that are still unacknowledged to the outbox
  */
-static char* build_env_json(const mqtt_env_data_t* data) {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        return NULL;
+static void mqtt_unacked_store(void) {
+    for (size_t i = 0; i < s_unacked_count; i++) {
+        const mqtt_unacked_t* e = &s_unacked[i];
+        if (mqtt_client_is_pending(e->msg_id) &&
+            mqtt_outbox_store(e->topic, e->payload, e->len, e->retain) == ESP_OK) {
+            messages_stored++;
+        }
+    }
+    s_unacked_count = 0;
+}
+#endif
+
+/**
+ * @brief Hand an encoded message to the client (does not wait for the PUBACK)
+ */
+static esp_err_t mqtt_sender_publish(const char* topic, const uint8_t* payload, size_t len, bool retain) {
+    int msg_id = 0;
+    esp_err_t ret = mqtt_client_publish_ex(topic, (const char*)payload, len, MQTT_QOS, retain, &msg_id);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to publish to MQTT topic %s", topic);
+        return ret;
     }
     
-    cJSON_AddStringToObject(root, "device_id", data->device_id);
-    cJSON_AddNumberToObject(root, "timestamp", data->timestamp_ms);
-    cJSON_AddNumberToObject(root, "temperature", data->temperature);
-    cJSON_AddNumberToObject(root, "humidity", data->humidity);
+#if MQTT_UNACKED_TO_OUTBOX
+    if (msg_id > 0 && mqtt_outbox_is_enabled()) {
+        mqtt_unacked_add(msg_id, topic, payload, len, retain);
+    }
+#endif
+    event_counter_inc(EVT_MQTT_PUBLISH);
+    EVT_LOGI(TAG, "Published to %s", topic);
+    return ESP_OK;
+}
+
+/**
+ * @brief Replay stored messages before anything new is published
+ */
+static void mqtt_sender_drain_outbox(void) {
+#if MQTT_OUTBOX_ENABLED
+    if (mqtt_outbox_count() == 0) {
+        return;
+    }
     
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    int sent = 0;
+    mqtt_outbox_drain(mqtt_sender_publish, MQTT_OUTBOX_DRAIN_MAX, MQTT_OUTBOX_DRAIN_INTERVAL_MS, &sent);
+    messages_replayed += sent;
+#endif
+}
+
+/**
+ * @brief Publish an encoded message, or keep it in the outbox while offline
+ */
+static esp_err_t mqtt_sender_deliver(const char* topic, const mqtt_payload_t* p, bool retain) {
+    esp_err_t ret = mqtt_sender_ensure_connected();
+    if (ret == ESP_OK) {
+        mqtt_sender_drain_outbox();
+        ret = mqtt_sender_publish(topic, p->buf, p->len, retain);
+        if (ret == ESP_OK) {
+            messages_published++;
+            return ESP_OK;
+        }
+    }
     
-    return json_string;
+#if MQTT_OUTBOX_ENABLED
+    if (mqtt_outbox_store(topic, p->buf, p->len, retain) == ESP_OK) {
+        messages_stored++;
+        return ESP_OK;
+    }
+#endif
+    messages_failed++;
+    return ret;
+}
+
+/**
+ * @brief Tell the ack callback that queued messages left the sender
+ */
+static void mqtt_sender_ack(uint32_t messages, bool published, size_t bytes) {
+    mqtt_sender_ack_cb_t cb = s_ack_cb;
+    if (cb != NULL && messages > 0) {
+        cb(messages, published, bytes);
+    }
 }
 
 /**
  * @brief Process and send a queued MQTT message
  */
 static esp_err_t process_mqtt_message(const mqtt_queue_message_t* msg) {
-    if (!wifi_manager_is_connected()) {
-        ESP_LOGW(TAG, "WiFi not connected, skipping MQTT transmission");
-        return ESP_ERR_INVALID_STATE;
+    if (msg->type >= sizeof(s_topics) / sizeof(s_topics[0])) {
+        ESP_LOGE(TAG, "Unknown message type: %d", msg->type);
+        messages_failed++;
+        mqtt_sender_ack(1, false, 0);
+        return ESP_ERR_INVALID_ARG;
     }
     
-    if (!mqtt_client_is_connected()) {
-        ESP_LOGW(TAG, "MQTT not connected, skipping transmission");
-        return ESP_ERR_INVALID_STATE;
+    const char *topic = s_topics[msg->type].topic;
+    mqtt_payload_t payload;
+    esp_err_t ret = encode_mqtt_message(msg, &payload);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to encode payload for %s: %s", topic, esp_err_to_name(ret));
+        messages_failed++;
+        mqtt_sender_ack(1, false, 0);
+        return ret;
     }
     
-    char *json_payload = NULL;
-    const char *topic = NULL;
-    char topic_buffer[128];
-    
-    // Build JSON and topic based on message type
+    uint32_t published = messages_published;
+    ret = mqtt_sender_deliver(topic, &payload, false);
+    mqtt_sender_ack(1, messages_published != published, payload.len);
+    return ret;
+}
+
+/**
+ * @brief Keep a queued message as the latest value of its type
+ */
+static void mqtt_snapshot_add(const mqtt_queue_message_t* msg) {
     switch (msg->type) {
         case MQTT_MSG_TYPE_SOIL:
-            json_payload = build_soil_json(&msg->data.soil);
-            snprintf(topic_buffer, sizeof(topic_buffer), "%s/soil", MQTT_BASE_TOPIC);
-            topic = topic_buffer;
+            s_snapshot.soil = msg->data.soil;
+            s_snapshot.has_soil = true;
             break;
-            
         case MQTT_MSG_TYPE_BATTERY:
-            json_payload = build_battery_json(&msg->data.battery);
-            snprintf(topic_buffer, sizeof(topic_buffer), "%s/battery", MQTT_BASE_TOPIC);
-            topic = topic_buffer;
+            s_snapshot.battery = msg->data.battery;
+            s_snapshot.has_battery = true;
             break;
-            
         case MQTT_MSG_TYPE_ENV:
-            json_payload = build_env_json(&msg->data.env);
-            snprintf(topic_buffer, sizeof(topic_buffer), "%s/environment", MQTT_BASE_TOPIC);
-            topic = topic_buffer;
+            s_snapshot.env = msg->data.env;
+            s_snapshot.has_env = true;
             break;
-            
         default:
-            ESP_LOGE(TAG, "Unknown message type: %d", msg->type);
-            return ESP_ERR_INVALID_ARG;
+            return;
     }
-    
-    if (json_payload == NULL) {
-        ESP_LOGE(TAG, "Failed to build JSON payload");
-        return ESP_ERR_NO_MEM;
+    s_snapshot.queued++;
+}
+
+/**
+ * @brief Publish the collected samples as one message to the device topic
+ *
+ * Without a connection the snapshot goes to the outbox; if that fails too it
+ * is kept and goes out with the next flush.
+ */
+static esp_err_t mqtt_snapshot_publish(void) {
+    if (!s_snapshot.has_soil && !s_snapshot.has_battery && !s_snapshot.has_env) {
+        return ESP_OK;
     }
     
-    // Publish to MQTT
-    esp_err_t ret = mqtt_client_publish(topic, json_payload, strlen(json_payload), MQTT_QOS);
+    const char* device_id = s_snapshot.has_env ? s_snapshot.env.device_id :
+                            s_snapshot.has_soil ? s_snapshot.soil.device_id : s_snapshot.battery.device_id;
+    uint64_t timestamp_ms = 0;
+    if (s_snapshot.has_soil && s_snapshot.soil.timestamp_ms > timestamp_ms) {
+        timestamp_ms = s_snapshot.soil.timestamp_ms;
+    }
+    if (s_snapshot.has_battery && s_snapshot.battery.timestamp_ms > timestamp_ms) {
+        timestamp_ms = s_snapshot.battery.timestamp_ms;
+    }
+    if (s_snapshot.has_env && s_snapshot.env.timestamp_ms > timestamp_ms) {
+        timestamp_ms = s_snapshot.env.timestamp_ms;
+    }
     
-    // Free the JSON string
-    cJSON_free(json_payload);
+    mqtt_payload_t p;
+    mqtt_payload_init(&p, MQTT_SNAPSHOT_PAYLOAD_FORMAT, s_payload_buf, sizeof(s_payload_buf));
+    mqtt_payload_string(&p, "device_id", device_id);
+    mqtt_payload_uint(&p, "timestamp", timestamp_ms);
+    if (s_snapshot.has_env) {
+        mqtt_payload_float(&p, "temperature", s_snapshot.env.temperature, 2);
+        mqtt_payload_float(&p, "humidity", s_snapshot.env.humidity, 2);
+    }
+    if (s_snapshot.has_soil) {
+        mqtt_payload_float(&p, "soil_voltage", s_snapshot.soil.voltage, 3);
+        mqtt_payload_float(&p, "moisture_percent", s_snapshot.soil.moisture_percent, 2);
+        mqtt_payload_int(&p, "raw_adc", s_snapshot.soil.raw_adc);
+    }
+    if (s_snapshot.has_battery) {
+        mqtt_payload_float(&p, "battery_voltage", s_snapshot.battery.voltage, 3);
+        mqtt_payload_float(&p, "battery_percentage", s_snapshot.battery.percentage, 1);
+    }
+    esp_err_t ret = mqtt_payload_end(&p);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Snapshot does not fit the payload buffer");
+        messages_failed++;
+        return ret;
+    }
     
+    uint32_t published = messages_published;
+    ret = mqtt_sender_deliver(s_snapshot_topic, &p, MQTT_SNAPSHOT_RETAIN);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to publish to MQTT topic %s", topic);
         return ret;
     }
     
-    ESP_LOGI(TAG, "Published to %s", topic);
+    // With per-metric topics every message was already reported on its own publish
+    if (!MQTT_PER_METRIC_TOPICS) {
+        mqtt_sender_ack(s_snapshot.queued, messages_published != published, p.len);
+    }
+    memset(&s_snapshot, 0, sizeof(s_snapshot));
+    EVT_LOGI(TAG, "Snapshot for %s done (%u bytes)", s_snapshot_topic, (unsigned)p.len);
     return ESP_OK;
 }
 
+/**
+ * @brief End of a cycle: wait for outstanding acknowledgements until the deadline
+ */
+static void mqtt_sender_flush(int64_t deadline_us) {
+    int64_t remaining_ms = (deadline_us - esp_timer_get_time()) / 1000 - MQTT_FLUSH_MARGIN_MS;
+    esp_err_t ret = mqtt_client_wait_published(remaining_ms > 0 ? (uint32_t)remaining_ms : 0);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "%d publishes unacknowledged: %s", mqtt_client_get_inflight(), esp_err_to_name(ret));
+    }
+    
+#if MQTT_UNACKED_TO_OUTBOX
+    // The client's own outbox is lost in deep sleep, the flash copies survive it
+    mqtt_unacked_store();
+#endif
+}
+
 /**
  * @brief MQTT sender task - processes queued messages
  */
 static void mqtt_sender_task(void *pvParameters) {
     mqtt_queue_message_t msg;
     
+    resource_tracker_task_enter(RESOURCE_TASK_MQTT, MQTT_SENDER_TASK_STACK_SIZE);
     ESP_LOGI(TAG, "MQTT sender task started");
     
     while (1) {
         // Wait for a message in the queue
         if (xQueueReceive(mqtt_queue, &msg, portMAX_DELAY) == pdTRUE) {
+            if (msg.type == MQTT_MSG_TYPE_SYNC) {
+#if MQTT_SNAPSHOT_ENABLED
+                // End of the cycle: the collected samples go out as one message
+                esp_err_t snap_ret = mqtt_snapshot_publish();
+                if (snap_ret != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to publish snapshot (error: %s)", esp_err_to_name(snap_ret));
+                }
+#endif
+                mqtt_sender_flush(msg.data.sync_deadline_us);
+                // All messages queued before the marker are acknowledged or stored
+                xEventGroupSetBits(mqtt_events, MQTT_SENDER_EVT_DRAINED);
+                continue;
+            }
+#if MQTT_SNAPSHOT_ENABLED
+            mqtt_snapshot_add(&msg);
+            if (!MQTT_PER_METRIC_TOPICS) {
+                continue;
+            }
+#endif
             esp_err_t ret = process_mqtt_message(&msg);
             if (ret != ESP_OK) {
                 ESP_LOGW(TAG, "Failed to process MQTT message (error: %s)", esp_err_to_name(ret));
@@ -193,12 +480,36 @@ esp_err_t mqtt_sender_init(void) {
         return ESP_OK;
     }
     
+    mqtt_build_topics();
+    
+#if MQTT_OUTBOX_ENABLED
+    // Without the partition messages are simply not kept while offline
+    mqtt_outbox_init(MQTT_OUTBOX_PARTITION);
+#endif
+    
     // Create the message queue
+#if STATIC_ALLOCATION_ENABLED
+    mqtt_queue = xQueueCreateStatic(MQTT_SENDER_QUEUE_SIZE, sizeof(mqtt_queue_message_t),
+                                    mqtt_queue_storage, &mqtt_queue_buffer);
+#else
     mqtt_queue = xQueueCreate(MQTT_SENDER_QUEUE_SIZE, sizeof(mqtt_queue_message_t));
+#endif
     if (mqtt_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create MQTT queue");
         return ESP_ERR_NO_MEM;
     }
+
+#if STATIC_ALLOCATION_ENABLED
+    mqtt_events = xEventGroupCreateStatic(&mqtt_events_buffer);
+#else
+    mqtt_events = xEventGroupCreate();
+#endif
+    if (mqtt_events == NULL) {
+        ESP_LOGE(TAG, "Failed to create MQTT event group");
+        vQueueDelete(mqtt_queue);
+        mqtt_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
     
     // Initialize MQTT client
     mqtt_client_config_t mqtt_config = {
@@ -215,6 +526,8 @@ esp_err_t mqtt_sender_init(void) {
     esp_err_t ret = mqtt_client_init(&mqtt_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize MQTT client: %s", esp_err_to_name(ret));
+        vEventGroupDelete(mqtt_events);
+        mqtt_events = NULL;
         vQueueDelete(mqtt_queue);
         mqtt_queue = NULL;
         return ret;
@@ -222,16 +535,29 @@ esp_err_t mqtt_sender_init(void) {
     
     // Connect to MQTT broker (only if WiFi is connected)
     if (wifi_manager_is_connected()) {
+        mqtt_connect_started = true;
         ret = mqtt_client_connect();
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Failed to connect to MQTT broker: %s", esp_err_to_name(ret));
             // Don't fail initialization, we'll retry in the task
         }
     } else {
-        ESP_LOGW(TAG, "WiFi not connected, MQTT connection deferred");
+        ESP_LOGW(TAG, "WiFi not connected, MQTT connection deferred to first publish");
     }
     
     // Create the sender task
+#if STATIC_ALLOCATION_ENABLED
+    mqtt_task_handle = xTaskCreateStatic(
+        mqtt_sender_task,
+        MQTT_SENDER_TASK_NAME,
+        MQTT_SENDER_TASK_STACK_SIZE,
+        NULL,
+        MQTT_SENDER_TASK_PRIORITY,
+        mqtt_task_stack,
+        &mqtt_task_buffer
+    );
+    BaseType_t task_ret = (mqtt_task_handle != NULL) ? pdPASS : pdFAIL;
+#else
     BaseType_t task_ret = xTaskCreate(
         mqtt_sender_task,
         MQTT_SENDER_TASK_NAME,
@@ -240,10 +566,13 @@ esp_err_t mqtt_sender_init(void) {
         MQTT_SENDER_TASK_PRIORITY,
         &mqtt_task_handle
     );
+#endif
     
     if (task_ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create MQTT sender task");
         mqtt_client_deinit();
+        vEventGroupDelete(mqtt_events);
+        mqtt_events = NULL;
         vQueueDelete(mqtt_queue);
         mqtt_queue = NULL;
         return ESP_ERR_NO_MEM;
@@ -309,33 +638,42 @@ esp_err_t mqtt_sender_enqueue_env(const mqtt_env_data_t* data) {
 }
 
 esp_err_t mqtt_sender_wait_until_empty(uint32_t timeout_ms) {
-    if (mqtt_queue == NULL) {
+    if (mqtt_queue == NULL || mqtt_events == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
     
     uint32_t start_time = esp_timer_get_time() / 1000;
     
-    while (uxQueueMessagesWaiting(mqtt_queue) > 0) {
-        uint32_t elapsed = (esp_timer_get_time() / 1000) - start_time;
-        if (elapsed >= timeout_ms) {
-            ESP_LOGW(TAG, "Timeout waiting for queue to empty");
-            return ESP_ERR_TIMEOUT;
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+    // Queue a marker behind the pending messages and wait until the task reaches it
+    xEventGroupClearBits(mqtt_events, MQTT_SENDER_EVT_DRAINED);
+    mqtt_queue_message_t sync_msg = {
+        .type = MQTT_MSG_TYPE_SYNC,
+        .data.sync_deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000
+    };
+    if (xQueueSend(mqtt_queue, &sync_msg, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        ESP_LOGW(TAG, "Timeout waiting for queue to empty");
+        return ESP_ERR_TIMEOUT;
     }
     
-    // Wait a bit more for the last message to be transmitted
-    vTaskDelay(pdMS_TO_TICKS(500));
-    
-    // Wait for MQTT publishes to complete
-    esp_err_t ret = mqtt_client_wait_published(timeout_ms);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to wait for MQTT publishes: %s", esp_err_to_name(ret));
+    uint32_t elapsed = (esp_timer_get_time() / 1000) - start_time;
+    uint32_t remaining = (elapsed < timeout_ms) ? timeout_ms - elapsed : 0;
+    EventBits_t bits = xEventGroupWaitBits(mqtt_events, MQTT_SENDER_EVT_DRAINED, pdTRUE, pdTRUE,
+                                           pdMS_TO_TICKS(remaining));
+    if (!(bits & MQTT_SENDER_EVT_DRAINED)) {
+        ESP_LOGW(TAG, "Timeout waiting for queue to empty");
+        return ESP_ERR_TIMEOUT;
     }
     
+    ESP_LOGI(TAG, "MQTT sender drained: %lu published, %lu replayed, %lu stored, %lu failed",
+             (unsigned long)messages_published, (unsigned long)messages_replayed,
+             (unsigned long)messages_stored, (unsigned long)messages_failed);
     return ESP_OK;
 }
 
+void mqtt_sender_set_ack_cb(mqtt_sender_ack_cb_t cb) {
+    s_ack_cb = cb;
+}
+
 esp_err_t mqtt_sender_deinit(void) {
     if (!mqtt_initialized) {
         return ESP_OK;
@@ -352,11 +690,17 @@ esp_err_t mqtt_sender_deinit(void) {
         vQueueDelete(mqtt_queue);
         mqtt_queue = NULL;
     }
+
+    if (mqtt_events != NULL) {
+        vEventGroupDelete(mqtt_events);
+        mqtt_events = NULL;
+    }
     
     // Deinitialize MQTT client
     mqtt_client_deinit();
     
     mqtt_initialized = false;
+    mqtt_connect_started = false;
     ESP_LOGI(TAG, "MQTT sender deinitialized");
     return ESP_OK;
 }
@@ -14,6 +14,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -51,6 +54,17 @@ typedef struct {
     char device_id[32];            ///< Device identifier
 } mqtt_env_data_t;
 
+/**
+ * @brief Called on the sender task when queued messages leave the sender
+ *
+ * Messages leave in the order they were queued, one per publish or all
+ * messages merged into a snapshot at once. published is true when the
+ * publish was handed to the client (QoS > 0 acknowledgements are awaited by
+ * mqtt_sender_wait_until_empty), false when it went to the outbox or was
+ * dropped. bytes is the payload size.
+ */
+typedef void (*mqtt_sender_ack_cb_t)(uint32_t messages, bool published, size_t bytes);
+
 // Initialize and start the sender task (idempotent)
 esp_err_t mqtt_sender_init(void);
 
@@ -59,9 +73,12 @@ esp_err_t mqtt_sender_enqueue_soil(const mqtt_soil_data_t* data);
 esp_err_t mqtt_sender_enqueue_battery(const mqtt_battery_data_t* data);
 esp_err_t mqtt_sender_enqueue_env(const mqtt_env_data_t* data);
 
-// Wait until the queue is empty (all data has been sent)
+// Block until every message queued so far has been published (returns as soon as it is done)
 esp_err_t mqtt_sender_wait_until_empty(uint32_t timeout_ms);
 
+// Register the ack callback (NULL to remove), e.g. to measure enqueue-to-publish latency
+void mqtt_sender_set_ack_cb(mqtt_sender_ack_cb_t cb);
+
 // Stop sender task and free queue (for clean deep-sleep deinit)
 esp_err_t mqtt_sender_deinit(void);
 
@@ -0,0 +1,333 @@
+/**
+ * @file sample_store.c
+ * @brief RTC Sample Store for Sensor-Only Wakes - Implementation
+ */
+
+#include "sample_store.h"
+#include "influxdb_backlog.h"
+#include "report_policy.h"
+#include "sample_block.h"
+#include "sample_frame.h"
+#include "esp_utils.h"
+#include "time_service.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#include "../config/esp32-config.h"
+
+static const char* TAG = "SAMPLE_STORE";
+
+#define SAMPLE_STORE_RTC_MAGIC      0x53535431  // "SST1"
+#define SAMPLE_STORE_MAX_DEVICES    4           // Distinct device ids (one per monitor)
+
+typedef enum {
+    SAMPLE_RECORD_SOIL = 0,
+    SAMPLE_RECORD_BATTERY,
+    SAMPLE_RECORD_ENV,
+    SAMPLE_RECORD_WINDOW,
+} sample_record_type_t;
+
+/**
+ * @brief Compact point (28 bytes)
+ */
+typedef struct {
+    uint32_t timestamp_s;       ///< Capture time in Unix seconds
+    uint8_t type;               ///< sample_record_type_t
+    uint8_t device;             ///< Index into the device id table
+    uint8_t metric;             ///< Window: report_metric_t
+    uint8_t reserved;
+    uint32_t aux;               ///< Soil: raw ADC, window: window length (s)
+    uint32_t count;             ///< Window: sample count
+    float v[3];                 ///< Soil: voltage/moisture, battery: voltage/percent, env: T/RH, window: min/max/mean
+} sample_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t head;              ///< Index of the oldest record
+    uint32_t count;             ///< Records in the ring
+    uint32_t wakes_since_upload;
+    char device_ids[SAMPLE_STORE_MAX_DEVICES][32];
+    sample_record_t records[SAMPLE_STORE_CAPACITY];
+} sample_store_rtc_t;
+
+static RTC_DATA_ATTR sample_store_rtc_t s_rtc;
+static SemaphoreHandle_t s_lock = NULL;
+
+#if INFLUXDB_BACKLOG_ENABLED
+// Spill frame (used with the lock held)
+#if INFLUXDB_BACKLOG_COMPRESSED
+static sample_block_writer_t s_frame;
+#else
+static sample_frame_writer_t s_frame;
+#endif
+static uint8_t s_frame_buf[INFLUXDB_BACKLOG_FRAME_SIZE];
+#endif
+
+esp_err_t sample_store_init(void) {
+    // RTC contents are only meaningful after a deep-sleep wakeup
+    if (s_rtc.magic != SAMPLE_STORE_RTC_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = SAMPLE_STORE_RTC_MAGIC;
+    }
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_rtc.count > 0) {
+        ESP_LOGI(TAG, "%lu points held in RTC memory (%lu wakes since upload)",
+                 (unsigned long)s_rtc.count, (unsigned long)s_rtc.wakes_since_upload);
+    }
+    return ESP_OK;
+}
+
+// Table index of a device id (adds it when new); 0xFF if the table is full
+static uint8_t sample_store_device_index(const char* device_id) {
+    for (int i = 0; i < SAMPLE_STORE_MAX_DEVICES; i++) {
+        if (s_rtc.device_ids[i][0] == '\0') {
+            strncpy(s_rtc.device_ids[i], device_id, sizeof(s_rtc.device_ids[i]) - 1);
+            return (uint8_t)i;
+        }
+        if (strncmp(s_rtc.device_ids[i], device_id, sizeof(s_rtc.device_ids[i]) - 1) == 0) {
+            return (uint8_t)i;
+        }
+    }
+    return 0xFF;
+}
+
+static esp_err_t sample_store_encode(const sample_record_t* rec, influxdb_batch_t* batch) {
+    // Wakes before the clock was set stamped boot-relative times
+    uint64_t timestamp_ns = time_service_resolve_ms((uint64_t)rec->timestamp_s * 1000ULL) * 1000000ULL;
+    const char* device_id = s_rtc.device_ids[rec->device];
+
+    switch (rec->type) {
+        case SAMPLE_RECORD_SOIL: {
+            influxdb_soil_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = rec->v[0],
+                .moisture_percent = rec->v[1],
+                .raw_adc = (int)rec->aux,
+            };
+            strncpy(d.device_id, device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_soil(batch, &d);
+        }
+        case SAMPLE_RECORD_BATTERY: {
+            influxdb_battery_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = rec->v[0],
+                .percentage = rec->v[1],
+            };
+            strncpy(d.device_id, device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_battery(batch, &d);
+        }
+        case SAMPLE_RECORD_ENV: {
+            influxdb_env_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .temperature_c = rec->v[0],
+                .humidity_rh = rec->v[1],
+            };
+            strncpy(d.device_id, device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_env(batch, &d);
+        }
+        case SAMPLE_RECORD_WINDOW: {
+            influxdb_window_data_t d = {
+                .timestamp_ns = timestamp_ns,
+                .metric = report_metric_name((report_metric_t)rec->metric),
+                .window_s = rec->aux,
+                .min = rec->v[0],
+                .max = rec->v[1],
+                .mean = rec->v[2],
+                .count = rec->count,
+            };
+            strncpy(d.device_id, device_id, sizeof(d.device_id) - 1);
+            return influxdb_batch_add_window(batch, &d);
+        }
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void sample_store_pop_locked(void) {
+    s_rtc.head = (s_rtc.head + 1) % SAMPLE_STORE_CAPACITY;
+    s_rtc.count--;
+}
+
+// Ring is full: move the oldest half to the flash backlog (or drop it without one)
+static void sample_store_spill_locked(void) {
+    uint32_t spill = (SAMPLE_STORE_CAPACITY + 1) / 2;
+#if INFLUXDB_BACKLOG_ENABLED
+    if (!influxdb_backlog_is_enabled()) {
+        influxdb_backlog_init(INFLUXDB_BACKLOG_PARTITION);
+    }
+    if (influxdb_backlog_is_enabled()) {
+        // The record types match the frame's sample types one to one
+#if INFLUXDB_BACKLOG_COMPRESSED
+        // Records only keep seconds: a 1 s timestamp unit makes a steady wake grid cost one bit
+        sample_block_writer_init(&s_frame, s_frame_buf, sizeof(s_frame_buf), esp_utils_get_timestamp_ms(),
+                                 1000, INFLUXDB_BACKLOG_BLOCK_RECORDS);
+#else
+        sample_frame_writer_init(&s_frame, s_frame_buf, sizeof(s_frame_buf), esp_utils_get_timestamp_ms());
+#endif
+        uint32_t moved = 0;
+        while (moved < spill && s_rtc.count > 0) {
+            const sample_record_t* r = &s_rtc.records[s_rtc.head];
+            sample_frame_record_t rec = {
+                .type = (sample_frame_type_t)r->type,
+                .device_id = s_rtc.device_ids[r->device],
+                .timestamp_ms = time_service_resolve_ms((uint64_t)r->timestamp_s * 1000ULL),
+                .metric = r->metric,
+                .aux = r->aux,
+                .count = r->count,
+                .v = { r->v[0], r->v[1], r->v[2] },
+            };
+#if INFLUXDB_BACKLOG_COMPRESSED
+            esp_err_t ret = sample_block_add(&s_frame, &rec);
+#else
+            esp_err_t ret = sample_frame_add(&s_frame, &rec);
+#endif
+            if (ret == ESP_ERR_NO_MEM) {
+                break;
+            }
+            sample_store_pop_locked();      // Added, or unusable and dropped
+            moved += (ret == ESP_OK) ? 1 : 0;
+        }
+#if INFLUXDB_BACKLOG_COMPRESSED
+        size_t len = sample_block_finish(&s_frame);
+#else
+        size_t len = sample_frame_finish(&s_frame);
+#endif
+        esp_err_t ret = (len > 0) ? influxdb_backlog_store_frame(s_frame_buf, len) : ESP_OK;
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "RTC store full, moved %lu points to the flash backlog", (unsigned long)moved);
+            if (moved > 0) {
+                return;
+            }
+        } else {
+            ESP_LOGE(TAG, "Backlog store failed (%s), %lu points lost", esp_err_to_name(ret), (unsigned long)moved);
+        }
+    }
+#endif
+    // Without a backlog the oldest records are overwritten
+    while (spill-- > 0 && s_rtc.count > 0) {
+        sample_store_pop_locked();
+    }
+    ESP_LOGW(TAG, "RTC store full, dropped oldest points");
+}
+
+static esp_err_t sample_store_push(const sample_record_t* rec, const char* device_id) {
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint8_t device = sample_store_device_index(device_id);
+    if (device == 0xFF) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Device id table full, cannot store point of %s", device_id);
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_rtc.count >= SAMPLE_STORE_CAPACITY) {
+        sample_store_spill_locked();
+    }
+    uint32_t tail = (s_rtc.head + s_rtc.count) % SAMPLE_STORE_CAPACITY;
+    s_rtc.records[tail] = *rec;
+    s_rtc.records[tail].device = device;
+    s_rtc.count++;
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t sample_store_append_soil(const influxdb_soil_data_t* data) {
+    if (data == NULL) return ESP_ERR_INVALID_ARG;
+    sample_record_t rec = {
+        .timestamp_s = (uint32_t)(data->timestamp_ns / 1000000000ULL),
+        .type = SAMPLE_RECORD_SOIL,
+        .aux = (uint32_t)data->raw_adc,
+        .v = { data->voltage, data->moisture_percent },
+    };
+    return sample_store_push(&rec, data->device_id);
+}
+
+esp_err_t sample_store_append_battery(const influxdb_battery_data_t* data) {
+    if (data == NULL) return ESP_ERR_INVALID_ARG;
+    sample_record_t rec = {
+        .timestamp_s = (uint32_t)(data->timestamp_ns / 1000000000ULL),
+        .type = SAMPLE_RECORD_BATTERY,
+        .v = { data->voltage, data->percentage },
+    };
+    return sample_store_push(&rec, data->device_id);
+}
+
+esp_err_t sample_store_append_env(const influxdb_env_data_t* data) {
+    if (data == NULL) return ESP_ERR_INVALID_ARG;
+    sample_record_t rec = {
+        .timestamp_s = (uint32_t)(data->timestamp_ns / 1000000000ULL),
+        .type = SAMPLE_RECORD_ENV,
+        .v = { data->temperature_c, data->humidity_rh },
+    };
+    return sample_store_push(&rec, data->device_id);
+}
+
+esp_err_t sample_store_append_window(const influxdb_window_data_t* data) {
+    if (data == NULL || data->metric == NULL) return ESP_ERR_INVALID_ARG;
+
+    // The metric travels as its index; the name is looked up again when encoding
+    uint8_t metric = 0;
+    while (metric < REPORT_METRIC_COUNT && strcmp(report_metric_name((report_metric_t)metric), data->metric) != 0) {
+        metric++;
+    }
+    if (metric >= REPORT_METRIC_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sample_record_t rec = {
+        .timestamp_s = (uint32_t)(data->timestamp_ns / 1000000000ULL),
+        .type = SAMPLE_RECORD_WINDOW,
+        .metric = metric,
+        .aux = data->window_s,
+        .count = data->count,
+        .v = { data->min, data->max, data->mean },
+    };
+    return sample_store_push(&rec, data->device_id);
+}
+
+esp_err_t sample_store_encode_oldest(influxdb_batch_t* batch) {
+    if (batch == NULL || s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (s_rtc.count > 0) {
+        ret = sample_store_encode(&s_rtc.records[s_rtc.head], batch);
+        if (ret != ESP_ERR_NO_MEM) {
+            sample_store_pop_locked();      // Encoded, or unusable and dropped
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+uint32_t sample_store_count(void) {
+    return s_rtc.count;
+}
+
+uint32_t sample_store_fill_percent(void) {
+    return s_rtc.count * 100 / SAMPLE_STORE_CAPACITY;
+}
+
+bool sample_store_upload_due(uint32_t every_n_wakes, uint32_t fill_percent) {
+    // This wake is number wakes_since_upload + 1 since the last upload
+    if (every_n_wakes > 0 && s_rtc.wakes_since_upload + 1 >= every_n_wakes) {
+        return true;
+    }
+    return sample_store_fill_percent() >= fill_percent;
+}
+
+void sample_store_note_wake(bool uploaded) {
+    s_rtc.wakes_since_upload = uploaded ? 0 : s_rtc.wakes_since_upload + 1;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file sample_store.h
+ * @brief RTC Sample Store for Sensor-Only Wakes
+ * 
+ * Keeps the points of wakes that do not start the radio in a ring of compact
+ * records in RTC memory (timestamps are kept with one second resolution, the
+ * device id as an index into a small table). When the ring is full the oldest
+ * half is encoded as one binary sample frame and moved to the InfluxDB flash
+ * backlog.
+ * On the next radio wake the influx sender drains the ring into its batch, so
+ * all stored points go out with the cycle's POST.
+ * 
+ * The store also counts wakes since the last upload so the application can
+ * decide when the radio is due.
+ */
+
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include "esp_err.h"
+#include "influxdb_client.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Initialize the store (RTC contents survive deep sleep only) and its lock
+esp_err_t sample_store_init(void);
+
+// Append a point (moves the oldest records to the flash backlog when full)
+esp_err_t sample_store_append_soil(const influxdb_soil_data_t* data);
+esp_err_t sample_store_append_battery(const influxdb_battery_data_t* data);
+esp_err_t sample_store_append_env(const influxdb_env_data_t* data);
+esp_err_t sample_store_append_window(const influxdb_window_data_t* data);
+
+// Encode the oldest record into a batch and remove it.
+// Returns ESP_ERR_NOT_FOUND when empty, ESP_ERR_NO_MEM if the batch is full (record is kept),
+// ESP_ERR_INVALID_ARG for an unusable record (it is dropped).
+esp_err_t sample_store_encode_oldest(influxdb_batch_t* batch);
+
+// Records currently held in RTC memory and the ring fill level in percent
+uint32_t sample_store_count(void);
+uint32_t sample_store_fill_percent(void);
+
+// Radio is due after every_n_wakes wakes or once the ring is fill_percent full
+bool sample_store_upload_due(uint32_t every_n_wakes, uint32_t fill_percent);
+
+// Count the finished wake; an upload wake restarts the wake counter
+void sample_store_note_wake(bool uploaded);
+
+#endif // SAMPLE_STORE_H
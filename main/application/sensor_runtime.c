@@ -0,0 +1,446 @@
+/**
+ * @file sensor_runtime.c
+ * @brief Sensor Runtime - Implementation
+ */
+
+#include "sensor_runtime.h"
+#include "../config/esp32-config.h"
+#include "cycle_scheduler.h"
+#include "sample_aggregator.h"
+#include "resource_tracker.h"
+#include "event_counters.h"
+#include "i2c_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char* TAG = "SENSOR_RUNTIME";
+
+// s_events bits
+#define SENSOR_EVT_WAKE     BIT0    // Cut the task's sleep short (stop or remove requested)
+#define SENSOR_EVT_PARKED   BIT1    // No task running (set by the task as its last step)
+#define SENSOR_EVT_REMOVED  BIT2    // sensor_remove_pending() dropped a set of jobs
+
+typedef enum {
+    SENSOR_STEP_PREPARE = 0,
+    SENSOR_STEP_START,
+    SENSOR_STEP_READ,
+    SENSOR_STEP_DONE,
+} sensor_step_t;
+
+typedef struct {
+    sensor_runtime_sensor_t cfg;
+    sensor_step_t step;
+    int64_t next_us;                // When the next step is due
+    uint32_t taken;                 // Readings of this cycle (failed ones included)
+} sensor_slot_t;
+
+static sensor_slot_t s_sensors[SENSOR_RUNTIME_MAX_SENSORS];
+static uint8_t s_sensor_count = 0;
+static EventBits_t s_due = 0;
+static volatile bool s_active = false;     // Task alive (set before creation, cleared by the task)
+static volatile bool s_stop = false;
+static volatile EventBits_t s_remove = 0;  // Jobs whose sensors leave the runtime (sensor_runtime_remove)
+static TaskHandle_t s_task = NULL;
+static EventGroupHandle_t s_events = NULL;
+static StaticEventGroup_t s_events_buffer;
+static portMUX_TYPE s_register_mux = portMUX_INITIALIZER_UNLOCKED;    // Monitors may register from concurrent init tasks
+#if STATIC_ALLOCATION_ENABLED
+static StaticTask_t s_task_buffer;
+static StackType_t s_task_stack[SENSOR_TASK_STACK_SIZE];
+#endif
+
+// Created on first use: stop and remove may run before any pass was started
+static void sensor_events(void) {
+    if (s_events == NULL) {
+        portENTER_CRITICAL(&s_register_mux);
+        if (s_events == NULL) {
+            s_events = xEventGroupCreateStatic(&s_events_buffer);
+            xEventGroupSetBits(s_events, SENSOR_EVT_PARKED);
+        }
+        portEXIT_CRITICAL(&s_register_mux);
+    }
+}
+
+// Ticks left of a wait that began at start (portMAX_DELAY waits forever)
+static TickType_t sensor_wait_remaining(TickType_t start, TickType_t wait) {
+    if (wait == portMAX_DELAY) {
+        return portMAX_DELAY;
+    }
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    return (elapsed < wait) ? wait - elapsed : 0;
+}
+
+static uint32_t sensor_latency_ms(const sensor_slot_t* slot) {
+    return slot->cfg.hal.warmup_ms + slot->cfg.hal.conversion_ms;
+}
+
+static void sensor_power_down(sensor_slot_t* slot) {
+    const sensor_hal_t* hal = &slot->cfg.hal;
+    if (hal->ops->power_down != NULL) {
+        esp_err_t ret = hal->ops->power_down(hal->ctx);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "%s: power down failed: %s", hal->name, esp_err_to_name(ret));
+        }
+    }
+}
+
+// Finish the slot; its job is done once no other sensor of the same job is still measuring
+static void sensor_finish(sensor_slot_t* slot) {
+    slot->step = SENSOR_STEP_DONE;
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (s_sensors[i].step != SENSOR_STEP_DONE && s_sensors[i].cfg.job == slot->cfg.job) {
+            return;
+        }
+    }
+    cycle_scheduler_job_done(slot->cfg.job);
+}
+
+// Report policy, aggregation windows, telemetry bus
+static void sensor_publish(const sensor_slot_t* slot, const sensor_hal_reading_t* reading) {
+    const sensor_runtime_sensor_t* s = &slot->cfg;
+
+    // All values travel in one sample, so any metric tripping reports the whole sample
+    bool report = false;
+    for (int i = 0; i < s->metric_count; i++) {
+        report |= report_policy_check(s->metrics[i], reading->values[s->metric_values[i]]);
+    }
+
+    for (int i = 0; i < s->metric_count; i++) {
+        if (!sample_aggregator_is_enabled(s->metrics[i])) {
+            continue;
+        }
+        // The reading goes into the running window; closed windows are published as summaries
+        telemetry_sample_t window;
+        telemetry_sample_init(&window, TELEMETRY_SAMPLE_WINDOW, s->device_id);
+        window.data.window.metric = s->metrics[i];
+        if (sample_aggregator_add(s->metrics[i], reading->values[s->metric_values[i]], &window.data.window.window) &&
+            telemetry_publish(&window) != ESP_OK) {
+            ESP_LOGW(TAG, "%s: failed to publish window summary", s->hal.name);
+        }
+    }
+
+    if (!report) {
+        if (s->log) {
+            EVT_LOGI(TAG, "%s: unchanged, not reported", s->hal.name);
+        }
+        return;
+    }
+
+    telemetry_sample_t sample;
+    telemetry_sample_init(&sample, s->sample_type, s->device_id);
+    s->fill_sample(reading, &sample);
+    esp_err_t ret = telemetry_publish(&sample);
+    if (ret == ESP_OK) {
+        for (int i = 0; i < s->metric_count; i++) {
+            report_policy_mark_reported(s->metrics[i], reading->values[s->metric_values[i]]);
+        }
+        if (s->log) {
+            EVT_LOGI(TAG, "%s: published", s->hal.name);
+        }
+    } else if (ret != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "%s: failed to publish: %s", s->hal.name, esp_err_to_name(ret));
+    }
+}
+
+// Shared reporting path; the sensor's own hook runs once the sample is on the bus
+static void sensor_report(const sensor_slot_t* slot, const sensor_hal_reading_t* reading) {
+    const sensor_runtime_sensor_t* s = &slot->cfg;
+
+    if (s->log) {
+        EVT_LOGI(TAG, "%s: %.3f / %.3f (raw %ld)", s->hal.name, reading->values[0],
+                 (reading->count > 1) ? reading->values[1] : 0.0f, (long)reading->raw);
+    }
+    if (s->publish) {
+        sensor_publish(slot, reading);
+    }
+    if (s->on_reading != NULL) {
+        s->on_reading(s->ctx, reading);
+    }
+}
+
+// Drop the sensors of the jobs in s_remove (on the task, or by the caller while no pass runs)
+static void sensor_remove_pending(void) {
+    portENTER_CRITICAL(&s_register_mux);
+    EventBits_t jobs = s_remove;
+    portEXIT_CRITICAL(&s_register_mux);
+    if (jobs == 0) {
+        return;
+    }
+    for (int i = 0; i < s_sensor_count; i++) {
+        if ((s_sensors[i].cfg.job & jobs) && s_sensors[i].step != SENSOR_STEP_DONE) {
+            sensor_power_down(&s_sensors[i]);
+            s_sensors[i].step = SENSOR_STEP_DONE;
+        }
+    }
+
+    portENTER_CRITICAL(&s_register_mux);
+    int n = 0;
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (!(s_sensors[i].cfg.job & jobs)) {
+            if (n != i) {
+                s_sensors[n] = s_sensors[i];
+            }
+            n++;
+        }
+    }
+    s_sensor_count = n;
+    s_remove &= ~jobs;
+    portEXIT_CRITICAL(&s_register_mux);
+    cycle_scheduler_job_done(jobs);     // Removed sensors no longer hold the cycle barrier
+    xEventGroupSetBits(s_events, SENSOR_EVT_REMOVED);
+}
+
+// Count a reading and plan the next one at a fixed rate from this one
+static void sensor_reading_taken(sensor_slot_t* slot, int64_t now) {
+    slot->taken++;
+    if (slot->cfg.measurements_per_cycle > 0 && slot->taken >= slot->cfg.measurements_per_cycle) {
+        sensor_finish(slot);
+        return;
+    }
+    slot->step = SENSOR_STEP_PREPARE;
+    slot->next_us = now + ((int64_t)slot->cfg.interval_ms - sensor_latency_ms(slot)) * 1000;
+    if (slot->next_us < now) {
+        slot->next_us = now;
+    }
+}
+
+// Run the due step; steps that need no wait afterwards run right away
+static void sensor_step(sensor_slot_t* slot) {
+    const sensor_hal_t* hal = &slot->cfg.hal;
+    int64_t now = esp_timer_get_time();
+    esp_err_t ret;
+
+    switch (slot->step) {
+    case SENSOR_STEP_PREPARE:
+        if (hal->ops->prepare != NULL) {
+            ret = hal->ops->prepare(hal->ctx);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "%s: prepare failed: %s", hal->name, esp_err_to_name(ret));
+                sensor_power_down(slot);
+                sensor_reading_taken(slot, now);
+                return;
+            }
+        }
+        slot->step = SENSOR_STEP_START;
+        slot->next_us = now + (int64_t)hal->warmup_ms * 1000;
+        if (hal->warmup_ms > 0) {
+            return;
+        }
+        /* fall through */
+    case SENSOR_STEP_START:
+        if (hal->ops->start_conversion != NULL) {
+            ret = hal->ops->start_conversion(hal->ctx);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "%s: conversion start failed: %s", hal->name, esp_err_to_name(ret));
+                sensor_power_down(slot);
+                sensor_reading_taken(slot, now);
+                return;
+            }
+        }
+        slot->step = SENSOR_STEP_READ;
+        slot->next_us = now + (int64_t)hal->conversion_ms * 1000;
+        if (hal->conversion_ms > 0) {
+            return;
+        }
+        i2c_shared_flush(I2C_PORT);     // A queued trigger must be on the bus before the read
+        /* fall through */
+    case SENSOR_STEP_READ: {
+        sensor_hal_reading_t reading = {0};
+        ret = hal->ops->read(hal->ctx, &reading);
+        sensor_power_down(slot);
+        if (ret == ESP_OK) {
+            sensor_report(slot, &reading);
+        } else {
+            ESP_LOGE(TAG, "%s: read failed: %s", hal->name, esp_err_to_name(ret));
+        }
+        sensor_reading_taken(slot, now);
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+static void sensor_runtime_task(void* pv) {
+    resource_tracker_task_enter(RESOURCE_TASK_SENSORS, SENSOR_TASK_STACK_SIZE);
+
+    // Start the slowest sensor first so the first readings of all sensors are taken together
+    uint32_t longest_ms = 0;
+    for (int i = 0; i < s_sensor_count; i++) {
+        if ((s_sensors[i].cfg.job & s_due) && sensor_latency_ms(&s_sensors[i]) > longest_ms) {
+            longest_ms = sensor_latency_ms(&s_sensors[i]);
+        }
+    }
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < s_sensor_count; i++) {
+        sensor_slot_t* slot = &s_sensors[i];
+        slot->taken = 0;
+        slot->step = SENSOR_STEP_DONE;
+        if (slot->cfg.job & s_due) {
+            slot->step = SENSOR_STEP_PREPARE;
+            slot->next_us = start_us + (int64_t)(longest_ms - sensor_latency_ms(slot)) * 1000;
+        }
+    }
+
+    while (!s_stop) {
+        sensor_remove_pending();
+        int64_t next_us = INT64_MAX;
+        for (int i = 0; i < s_sensor_count; i++) {
+            if (s_sensors[i].step != SENSOR_STEP_DONE && s_sensors[i].next_us < next_us) {
+                next_us = s_sensors[i].next_us;
+            }
+        }
+        if (next_us == INT64_MAX) {
+            break;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (next_us > now) {
+            TickType_t ticks = (TickType_t)(((next_us - now) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+            // Sleep until the next step, or until stop/remove wants the task
+            xEventGroupWaitBits(s_events, SENSOR_EVT_WAKE, pdTRUE, pdFALSE, ticks > 0 ? ticks : 1);
+            continue;
+        }
+        for (int i = 0; i < s_sensor_count; i++) {
+            if (s_sensors[i].step != SENSOR_STEP_DONE && s_sensors[i].next_us <= now) {
+                sensor_step(&s_sensors[i]);
+            }
+        }
+        // Send the bus transfers the steps of this instant queued in one go
+        i2c_shared_flush(I2C_PORT);
+    }
+
+    // Stopped early: leave no sensor powered and do not hold the cycle barrier
+    sensor_remove_pending();
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (s_sensors[i].step != SENSOR_STEP_DONE) {
+            sensor_power_down(&s_sensors[i]);
+            sensor_finish(&s_sensors[i]);
+        }
+    }
+
+    ESP_LOGI(TAG, "Sensor pass done");
+    resource_tracker_task_exit(RESOURCE_TASK_SENSORS);
+    s_active = false;
+    xEventGroupSetBits(s_events, SENSOR_EVT_PARKED);
+    vTaskDelete(NULL);
+}
+
+esp_err_t sensor_runtime_register(const sensor_runtime_sensor_t* sensor) {
+    if (sensor == NULL || sensor->hal.ops == NULL || sensor->hal.ops->read == NULL ||
+        sensor->metric_count > SENSOR_RUNTIME_MAX_METRICS || (sensor->publish && sensor->fill_sample == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < sensor->metric_count; i++) {
+        if (sensor->metric_values[i] >= SENSOR_HAL_MAX_VALUES) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_register_mux);
+    if (s_sensor_count >= SENSOR_RUNTIME_MAX_SENSORS) {
+        portEXIT_CRITICAL(&s_register_mux);
+        return ESP_ERR_NO_MEM;
+    }
+    sensor_slot_t* slot = &s_sensors[s_sensor_count];
+    memset(slot, 0, sizeof(*slot));
+    slot->cfg = *sensor;
+    slot->step = SENSOR_STEP_DONE;
+    s_sensor_count++;
+    portEXIT_CRITICAL(&s_register_mux);
+    ESP_LOGI(TAG, "Registered %s (warm-up %lu ms, conversion %lu ms)", sensor->hal.name,
+             (unsigned long)sensor->hal.warmup_ms, (unsigned long)sensor->hal.conversion_ms);
+    return ESP_OK;
+}
+
+EventBits_t sensor_runtime_jobs(EventBits_t due) {
+    EventBits_t jobs = 0;
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (s_sensors[i].cfg.measurements_per_cycle > 0) {
+            jobs |= s_sensors[i].cfg.job;
+        }
+    }
+    return jobs & due;
+}
+
+esp_err_t sensor_runtime_start(EventBits_t due) {
+    if (s_active) {
+        ESP_LOGW(TAG, "Sensor pass already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    EventBits_t registered = 0;
+    for (int i = 0; i < s_sensor_count; i++) {
+        registered |= s_sensors[i].cfg.job;
+    }
+    s_due = due & registered;
+    if (s_due == 0) {
+        return ESP_OK;
+    }
+    sensor_events();
+    s_stop = false;
+    s_active = true;
+    xEventGroupClearBits(s_events, SENSOR_EVT_WAKE | SENSOR_EVT_PARKED);
+
+#if STATIC_ALLOCATION_ENABLED
+    s_task = xTaskCreateStaticPinnedToCore(sensor_runtime_task, SENSOR_TASK_NAME, SENSOR_TASK_STACK_SIZE,
+                                           NULL, SENSOR_TASK_PRIORITY, s_task_stack, &s_task_buffer, 0);
+    BaseType_t ok = (s_task != NULL) ? pdPASS : pdFAIL;
+#else
+    BaseType_t ok = xTaskCreatePinnedToCore(sensor_runtime_task, SENSOR_TASK_NAME, SENSOR_TASK_STACK_SIZE,
+                                            NULL, SENSOR_TASK_PRIORITY, &s_task, 0);
+#endif
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sensor task");
+        s_active = false;
+        xEventGroupSetBits(s_events, SENSOR_EVT_PARKED);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sensor_runtime_stop(uint32_t timeout_ms) {
+    sensor_events();
+    s_stop = true;
+    xEventGroupSetBits(s_events, SENSOR_EVT_WAKE);
+
+    TickType_t wait = (timeout_ms > 0) ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY;
+    EventBits_t bits = xEventGroupWaitBits(s_events, SENSOR_EVT_PARKED, pdFALSE, pdTRUE, wait);
+    return (bits & SENSOR_EVT_PARKED) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t sensor_runtime_remove(EventBits_t job, uint32_t timeout_ms) {
+    sensor_events();
+    portENTER_CRITICAL(&s_register_mux);
+    s_remove |= job;
+    portEXIT_CRITICAL(&s_register_mux);
+
+    // A running pass drops them between two steps; each drop sets SENSOR_EVT_REMOVED
+    TickType_t wait = (timeout_ms > 0) ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY;
+    TickType_t start = xTaskGetTickCount();
+    xEventGroupSetBits(s_events, SENSOR_EVT_WAKE);
+    while (s_remove & job) {
+        EventBits_t bits = xEventGroupWaitBits(s_events, SENSOR_EVT_REMOVED | SENSOR_EVT_PARKED, pdFALSE, pdFALSE,
+                                               sensor_wait_remaining(start, wait));
+        if (bits & SENSOR_EVT_PARKED) {
+            break;
+        }
+        if (!(bits & SENSOR_EVT_REMOVED)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        xEventGroupClearBits(s_events, SENSOR_EVT_REMOVED);
+    }
+    if (!s_active) {
+        sensor_remove_pending();
+    }
+    return ESP_OK;
+}
+
+bool sensor_runtime_is_running(void) {
+    return s_active;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file sensor_runtime.h
+ * @brief Sensor Runtime
+ *
+ * Measures every registered sensor from one task instead of a task per
+ * sensor. A pass is scheduled from the sensors' latency hints: the slowest
+ * sensor is powered first and the others just in time, so all readings of a
+ * pass are taken together and every sensor is powered only as long as it
+ * needs. Sensors read at the same instant are read in registration order.
+ *
+ * Each reading runs through the same reporting path: the report policy
+ * decides whether the sample is published on the telemetry bus, and the
+ * aggregation windows of the sensor's metrics are fed. A sensor finishes its
+ * cycle job once its measurements_per_cycle readings are taken.
+ */
+
+#ifndef SENSOR_RUNTIME_H
+#define SENSOR_RUNTIME_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "sensor_hal.h"
+#include "telemetry.h"
+#include "report_policy.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_RUNTIME_MAX_SENSORS  6
+#define SENSOR_RUNTIME_MAX_METRICS  2
+
+/**
+ * @brief Registered sensor
+ */
+typedef struct {
+    sensor_hal_t hal;                       // Driver steps and latency hints
+    EventBits_t job;                        // Cycle job (CYCLE_JOB_*) that runs this sensor
+    telemetry_sample_type_t sample_type;    // Sample published for a reading
+    char device_id[32];
+    uint32_t measurements_per_cycle;        // 0 = measure until sensor_runtime_stop()
+    uint32_t interval_ms;                   // Between readings of one cycle
+    bool publish;                           // Report readings on the telemetry bus
+    bool log;                               // Log every reading
+
+    // Report policy / aggregation metrics and the reading value each one takes
+    uint8_t metric_count;
+    report_metric_t metrics[SENSOR_RUNTIME_MAX_METRICS];
+    uint8_t metric_values[SENSOR_RUNTIME_MAX_METRICS];
+
+    // Fill the typed sample from a reading (required when publish is set)
+    void (*fill_sample)(const sensor_hal_reading_t* reading, telemetry_sample_t* sample);
+    // Called for every successful reading after it is reported (may be NULL)
+    void (*on_reading)(void* ctx, const sensor_hal_reading_t* reading);
+    void* ctx;
+} sensor_runtime_sensor_t;
+
+// Add a sensor (copied). Not while a pass is running; monitors may register from concurrent tasks.
+esp_err_t sensor_runtime_register(const sensor_runtime_sensor_t* sensor);
+
+// Jobs in due that finish on their own this cycle (registered, measurements_per_cycle > 0)
+EventBits_t sensor_runtime_jobs(EventBits_t due);
+
+// Measure the sensors of the due jobs on the runtime task. Each job is reported
+// done with cycle_scheduler_job_done() after its last reading.
+esp_err_t sensor_runtime_start(EventBits_t due);
+
+// Ask the task to finish after the current step and wait up to timeout_ms for it
+esp_err_t sensor_runtime_stop(uint32_t timeout_ms);
+
+// Remove the sensors of a job (powered down, also from a running pass) and wait
+// up to timeout_ms (0 = no limit) until they are gone
+esp_err_t sensor_runtime_remove(EventBits_t job, uint32_t timeout_ms);
+
+// Whether a pass is running
+bool sensor_runtime_is_running(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_RUNTIME_H
@@ -8,7 +8,11 @@
 #include "esp_utils.h"
 #include "ntp_time.h"
 #include "influxdb_client.h"
-#include "influx_sender.h"
+#include "telemetry.h"
+#include "cycle_scheduler.h"
+#include "report_policy.h"
+#include "sample_aggregator.h"
+#include "sensor_runtime.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_netif.h"
@@ -16,155 +20,19 @@
 #include "freertos/task.h"
 #include <string.h>
 
-#if ENABLE_MQTT
-#include "mqtt_sender.h"
-#endif
-
 static const char* TAG = "SOIL_MONITOR_APP";
 
-// Task handle for the monitoring task
-static TaskHandle_t monitoring_task_handle = NULL;
-
-/**
- * @brief Send soil sensor reading to InfluxDB
- */
-static influxdb_response_status_t soil_send_reading_to_influxdb(const csm_v2_reading_t* reading, const char* device_id) {
-    if (reading == NULL || device_id == NULL) {
-        return INFLUXDB_RESPONSE_ERROR;
-    }
-
-    influxdb_soil_data_t influx_data;
-    
-    // Use NTP timestamp if available, otherwise fallback to system timestamp
-    uint64_t timestamp_ms;
-    if (ntp_time_is_synced()) {
-        timestamp_ms = ntp_time_get_timestamp_ms();
-    } else {
-        timestamp_ms = esp_utils_get_timestamp_ms();
-    }
-    
-    // Convert milliseconds to nanoseconds for InfluxDB
-    influx_data.timestamp_ns = timestamp_ms * 1000000ULL;
-    influx_data.voltage = reading->voltage;
-    influx_data.moisture_percent = reading->moisture_percent;
-    influx_data.raw_adc = reading->raw_adc;
-    strncpy(influx_data.device_id, device_id, sizeof(influx_data.device_id) - 1);
-    influx_data.device_id[sizeof(influx_data.device_id) - 1] = '\0';
-
-#if USE_INFLUXDB
-    // Route via sender task to avoid stack pressure in this task
-    influx_sender_init();
-    return influx_sender_enqueue_soil(&influx_data);
-#else
-    return ESP_OK;  // Data logged, but not sent (WiFi disabled)
-#endif
+// MARK: SENSOR RUNTIME
+static void soil_fill_sample(const sensor_hal_reading_t* reading, telemetry_sample_t* sample) {
+    sample->data.soil.voltage = reading->values[0];
+    sample->data.soil.moisture_percent = reading->values[1];
+    sample->data.soil.raw_adc = reading->raw;
 }
 
-/**
- * @brief Soil monitoring task
- */
-static void soil_monitoring_task(void* pvParameters) {
-    soil_monitor_app_t* app = (soil_monitor_app_t*)pvParameters;
-    csm_v2_reading_t reading;
-    uint32_t measurement_count = 0;
-    
-    ESP_LOGI(TAG, "Soil monitoring task started");
-    
-    // Measurement loop - runs until configured count reached or infinite if measurements_per_cycle == 0
-    while (app->is_running) {
-
-        // Power the sensor
-        esp_err_t ret = csm_v2_enable_power(&app->sensor_driver);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to power on sensor: %s", esp_err_to_name(ret));
-            continue;
-        }
-        
-        // Wait for sensor to stabilize
-        vTaskDelay(pdMS_TO_TICKS(1000));
-
-        // Read sensor data
-        ret = csm_v2_read(&app->sensor_driver, &reading);
-
-        // Power off the sensor to save energy
-        esp_err_t ret2 = csm_v2_disable_power(&app->sensor_driver);
-        if (ret2 != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to power off sensor: %s", esp_err_to_name(ret2));
-        }
-
-        if (ret == ESP_OK) {
-            // Store last reading
-            app->last_voltage = reading.voltage;
-            app->last_moisture_percent = reading.moisture_percent;
-            
-            if (app->config.enable_logging) {
-                ESP_LOGI(TAG, "Soil Moisture: %.1f%% | Voltage: %.3fV | Raw ADC: %d",
-                         reading.moisture_percent, reading.voltage, reading.raw_adc);
-            }
-            
-#if USE_INFLUXDB
-            // Send data to InfluxDB if enabled and WiFi is connected
-            if (app->config.enable_http_sending && wifi_manager_is_connected()) {
-                influxdb_response_status_t influx_status = soil_send_reading_to_influxdb(&reading, app->config.device_id);
-                if (influx_status == INFLUXDB_RESPONSE_OK) {
-                    if (app->config.enable_logging) {
-                        ESP_LOGI(TAG, "Soil data sent successfully to InfluxDB");
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to send soil data to InfluxDB (status: %d)", influx_status);
-                }
-            }
-#endif
-            
-#if USE_MQTT
-            // Send data to MQTT if enabled and WiFi is connected
-            if (app->config.enable_http_sending && wifi_manager_is_connected()) {
-                mqtt_soil_data_t mqtt_data = {
-                    .timestamp_ms = esp_utils_get_timestamp_ms(),
-                    .voltage = reading.voltage,
-                    .moisture_percent = reading.moisture_percent,
-                    .raw_adc = reading.raw_adc,
-                };
-                strncpy(mqtt_data.device_id, app->config.device_id, sizeof(mqtt_data.device_id) - 1);
-                mqtt_data.device_id[sizeof(mqtt_data.device_id) - 1] = '\0';
-                
-                esp_err_t mqtt_ret = mqtt_sender_enqueue_soil(&mqtt_data);
-                if (mqtt_ret == ESP_OK) {
-                    if (app->config.enable_logging) {
-                        ESP_LOGI(TAG, "Soil data queued for MQTT");
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to queue soil data for MQTT: %s", esp_err_to_name(mqtt_ret));
-                }
-            }
-#endif
-        } else {
-            ESP_LOGE(TAG, "Failed to read sensor: %s", esp_err_to_name(ret));
-        }
-        
-        measurement_count++;
-        
-        // Check if we've reached the target count (if configured)
-        if (app->config.measurements_per_cycle > 0 && measurement_count >= app->config.measurements_per_cycle) {
-            ESP_LOGI(TAG, "Completed %lu measurements, stopping task", measurement_count);
-            break;
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(app->config.measurement_interval_ms));
-    }
-
-    // Ensure sensor is powered off before exiting
-    esp_err_t final_ret = csm_v2_disable_power(&app->sensor_driver);
-    if (final_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to power off sensor: %s", esp_err_to_name(final_ret));
-    } else {
-        ESP_LOGI(TAG, "CSM V2 Sensor powered off successfully");
-    }
-
-    ESP_LOGI(TAG, "Soil monitoring task stopped");
-    app->is_running = false;
-    monitoring_task_handle = NULL;
-    vTaskDelete(NULL);
+static void soil_on_reading(void* ctx, const sensor_hal_reading_t* reading) {
+    soil_monitor_app_t* app = (soil_monitor_app_t*)ctx;
+    app->last_voltage = reading->values[0];
+    app->last_moisture_percent = reading->values[1];
 }
 
 void soil_monitor_get_default_config(soil_monitor_config_t* config) {
@@ -211,131 +79,72 @@ esp_err_t soil_monitor_init(soil_monitor_app_t* app, const soil_monitor_config_t
         return ret;
     }
     
-#if ENABLE_WIFI
-    // Check if WiFi is already connected (initialized by main)
-    if (!wifi_manager_is_connected()) {
-        ESP_LOGW(TAG, "WiFi not connected, waiting for connection...");
-        int wifi_wait_count = 0;
-        while (!wifi_manager_is_connected() && wifi_wait_count < 30) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            wifi_wait_count++;
-        }
-        
-        if (!wifi_manager_is_connected()) {
-            ESP_LOGE(TAG, "WiFi connection timeout");
-            return ESP_ERR_TIMEOUT;
-        }
+#if REPORT_POLICY_ENABLED
+    const report_policy_config_t policy = {
+        .deadband = SOIL_REPORT_DEADBAND_PERCENT,
+        .rate_per_min = SOIL_REPORT_RATE_PER_MIN,
+        .min_interval_s = SOIL_REPORT_MIN_INTERVAL_S,
+        .max_interval_s = SOIL_REPORT_MAX_INTERVAL_S,
+    };
+    report_policy_configure(REPORT_METRIC_SOIL_MOISTURE, &policy);
+#endif
+    sample_aggregator_configure(REPORT_METRIC_SOIL_MOISTURE, AGGREGATION_ENABLED ? SOIL_AGG_WINDOW_S : 0);
+    
+#ifdef SOIL_CALIBRATION_TABLE
+    static const csm_v2_cal_point_t cal_table[] = SOIL_CALIBRATION_TABLE;
+    ret = csm_v2_calibrate_table(&app->sensor_driver, cal_table, sizeof(cal_table) / sizeof(cal_table[0]));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Calibration table rejected, using dry/wet calibration");
     }
+#endif
     
-    ESP_LOGI(TAG, "WiFi is connected - using shared WiFi and InfluxDB instances");
+#if ENABLE_WIFI
+    // WiFi associates in the background while the sensor warms up; data is queued either way
+    ESP_LOGI(TAG, "Using shared WiFi and InfluxDB instances");
 #else
     ESP_LOGI(TAG, "WiFi disabled - sensor will run in offline mode");
 #endif
     
-    // Heavy operations moved to task above to avoid main stack overflow
-
-
+    sensor_runtime_sensor_t sensor = {
+        .job = CYCLE_JOB_SOIL,
+        .sample_type = TELEMETRY_SAMPLE_SOIL,
+        .measurements_per_cycle = config->measurements_per_cycle,
+        .interval_ms = config->measurement_interval_ms,
+        .publish = config->enable_http_sending,
+        .log = config->enable_logging,
+        .metric_count = 1,
+        .metrics = { REPORT_METRIC_SOIL_MOISTURE },
+        .metric_values = { 1 },
+        .fill_sample = soil_fill_sample,
+        .on_reading = soil_on_reading,
+        .ctx = app,
+    };
+    csm_v2_get_sensor_hal(&app->sensor_driver, &sensor.hal);
+    if (app->sensor_driver.lp_powered && sensor.measurements_per_cycle == 1) {
+        sensor.hal.warmup_ms = 0;       // Settled while the main core slept
+    }
+    strncpy(sensor.device_id, config->device_id, sizeof(sensor.device_id) - 1);
+    ret = sensor_runtime_register(&sensor);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register soil sensor: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    app->is_running = false;
     ESP_LOGI(TAG, "Soil monitoring application initialized");
     ESP_LOGI(TAG, "Device ID: %s", app->config.device_id);
     return ESP_OK;
 }
 
-esp_err_t soil_monitor_start(soil_monitor_app_t* app) {
-    if (app == NULL) {
-        ESP_LOGE(TAG, "Invalid parameter");
-        return ESP_ERR_INVALID_ARG;
-    }
-    if (app->is_running) {
-        ESP_LOGW(TAG, "Application already running");
-        return ESP_OK;
-    }
-    app->is_running = true;
-    
-    // Create monitoring task with larger stack to handle TLS/HTTP
-    BaseType_t task_created = xTaskCreatePinnedToCore(
-        soil_monitoring_task,
-        "soil_monitor",
-        SOIL_TASK_STACK_SIZE,
-        app,
-        SOIL_TASK_PRIORITY,
-        &monitoring_task_handle,
-        0 /* pin to core 0 */
-    );
-    
-    if (task_created != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create monitoring task");
-        app->is_running = false;
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Soil monitoring application started");
-    return ESP_OK;
-}
-
-esp_err_t soil_monitor_stop(soil_monitor_app_t* app) {
-    if (app == NULL) {
-        ESP_LOGE(TAG, "Invalid parameter");
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    if (!app->is_running) {
-        ESP_LOGW(TAG, "Application not running");
-        return ESP_OK;
-    }
-    
-    app->is_running = false;
-    
-    // Wait for task to finish
-    while (monitoring_task_handle != NULL) {
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
-    
-    ESP_LOGI(TAG, "Soil monitoring application stopped");
-    return ESP_OK;
-}
-
-esp_err_t soil_monitor_wait_for_completion(soil_monitor_app_t* app, uint32_t timeout_ms) {
-    if (app == NULL) {
-        ESP_LOGE(TAG, "Invalid parameter");
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    if (app->config.measurements_per_cycle == 0) {
-        ESP_LOGW(TAG, "measurements_per_cycle is 0, task runs indefinitely");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    uint32_t elapsed_ms = 0;
-    const uint32_t check_interval_ms = 100;
-    
-    ESP_LOGI(TAG, "Waiting for soil monitoring task to complete...");
-    
-    while (monitoring_task_handle != NULL) {
-        vTaskDelay(pdMS_TO_TICKS(check_interval_ms));
-        elapsed_ms += check_interval_ms;
-        
-        if (timeout_ms > 0 && elapsed_ms >= timeout_ms) {
-            ESP_LOGW(TAG, "Timeout waiting for soil monitoring task");
-            return ESP_ERR_TIMEOUT;
-        }
-    }
-    
-    ESP_LOGI(TAG, "Soil monitoring task completed");
-    return ESP_OK;
-}
-
 esp_err_t soil_monitor_deinit(soil_monitor_app_t* app) {
     if (app == NULL) {
         ESP_LOGE(TAG, "Invalid parameter");
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Stop application if running
-    esp_err_t ret = soil_monitor_stop(app);
+    // The sensor must not be measured while the driver goes away; other sensors keep running
+    esp_err_t ret = sensor_runtime_remove(CYCLE_JOB_SOIL, 0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop application: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to remove soil sensor: %s", esp_err_to_name(ret));
     }
     
     // Deinitialize InfluxDB client if enabled
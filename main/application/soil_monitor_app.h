@@ -27,7 +27,7 @@ typedef struct {
     bool enable_wifi;                   ///< Enable WiFi connectivity
     bool enable_http_sending;           ///< Enable HTTP data transmission
     char device_id[32];                 ///< Unique device identifier
-    uint32_t measurements_per_cycle;    ///< Number of measurements before task completion (0 = infinite)
+    uint32_t measurements_per_cycle;    ///< Measurements per cycle before the job is done (0 = until stopped)
 } soil_monitor_config_t;
 
 /**
@@ -36,7 +36,6 @@ typedef struct {
 typedef struct {
     csm_v2_driver_t sensor_driver;      ///< Soil sensor driver
     soil_monitor_config_t config;       ///< Application configuration
-    bool is_running;                    ///< Application running status
     float last_voltage;                 ///< Last measured voltage
     float last_moisture_percent;        ///< Last measured moisture percentage
 } soil_monitor_app_t;
@@ -51,36 +50,15 @@ void soil_monitor_get_default_config(soil_monitor_config_t* config);
 /**
  * @brief Initialize the soil monitoring application
  * 
- * @param app Pointer to application handle
+ * Initializes the sensor driver and registers it with the sensor runtime,
+ * which measures it on every cycle with CYCLE_JOB_SOIL due.
+ * 
+ * @param app Pointer to application handle (must stay valid while registered)
  * @param config Pointer to application configuration
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
 esp_err_t soil_monitor_init(soil_monitor_app_t* app, const soil_monitor_config_t* config);
 
-/**
- * @brief Start the soil monitoring application
- * 
- * Creates monitoring task that will run for measurements_per_cycle iterations.
- * If measurements_per_cycle is 0, runs indefinitely.
- * Use soil_monitor_wait_for_completion() to wait for task to finish.
- * 
- * @param app Pointer to application handle
- * @return esp_err_t ESP_OK on success, error code otherwise
- */
-esp_err_t soil_monitor_start(soil_monitor_app_t* app);
-
-/**
- * @brief Wait for soil monitoring task to complete all measurements
- * 
- * Blocks until the monitoring task has finished all configured measurements.
- * Only returns when measurements_per_cycle > 0, otherwise blocks indefinitely.
- * 
- * @param app Pointer to application handle
- * @param timeout_ms Maximum time to wait in milliseconds (0 = wait forever)
- * @return esp_err_t ESP_OK if completed, ESP_ERR_TIMEOUT if timed out
- */
-esp_err_t soil_monitor_wait_for_completion(soil_monitor_app_t* app, uint32_t timeout_ms);
-
 /**
  * @brief Get last measured soil moisture reading
  * 
@@ -91,14 +69,6 @@ esp_err_t soil_monitor_wait_for_completion(soil_monitor_app_t* app, uint32_t tim
  */
 esp_err_t soil_monitor_get_last_reading(soil_monitor_app_t* app, float* voltage, float* moisture_percent);
 
-/**
- * @brief Stop the soil monitoring application
- * 
- * @param app Pointer to application handle
- * @return esp_err_t ESP_OK on success, error code otherwise
- */
-esp_err_t soil_monitor_stop(soil_monitor_app_t* app);
-
 /**
  * @brief Deinitialize the soil monitoring application
  * 
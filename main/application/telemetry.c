@@ -0,0 +1,315 @@
+/**
+ * @file telemetry.c
+ * @brief Telemetry Bus Implementation
+ */
+
+#include "telemetry.h"
+#include "../config/esp32-config.h"
+#include "esp_utils.h"
+#include "event_counters.h"
+#include "influxdb_client.h"
+#include "influx_sender.h"
+#include "wifi_manager.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+#if ENABLE_MQTT
+#include "mqtt_sender.h"
+#endif
+
+static const char* TAG = "TELEMETRY";
+
+static const telemetry_sink_t* s_sinks[TELEMETRY_MAX_SINKS];
+static telemetry_sink_stats_t s_stats[TELEMETRY_MAX_SINKS];
+static size_t s_sink_count = 0;
+// Per sample type: indexes of the sinks that take it, so publish() only calls those
+static uint8_t s_dispatch[TELEMETRY_SAMPLE_TYPE_COUNT][TELEMETRY_MAX_SINKS];
+static uint8_t s_dispatch_count[TELEMETRY_SAMPLE_TYPE_COUNT];
+static bool s_initialized = false;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================================================
+// InfluxDB sink
+// ============================================================================
+
+#if USE_INFLUXDB
+static esp_err_t influx_sink_publish(const telemetry_sample_t* sample) {
+    uint64_t timestamp_ns = sample->timestamp_ms * 1000000ULL;
+
+    switch (sample->type) {
+        case TELEMETRY_SAMPLE_SOIL: {
+            // With aggregation only the window summaries are written
+            if (sample_aggregator_is_enabled(REPORT_METRIC_SOIL_MOISTURE)) {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            influxdb_soil_data_t data = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = sample->data.soil.voltage,
+                .moisture_percent = sample->data.soil.moisture_percent,
+                .raw_adc = sample->data.soil.raw_adc,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            influx_sender_init();
+            return influx_sender_enqueue_soil(&data);
+        }
+        case TELEMETRY_SAMPLE_BATTERY: {
+            if (sample_aggregator_is_enabled(REPORT_METRIC_BATTERY_VOLTAGE)) {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            influxdb_battery_data_t data = {
+                .timestamp_ns = timestamp_ns,
+                .voltage = sample->data.battery.voltage,
+                .percentage = sample->data.battery.percentage,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            influx_sender_init();
+            return influx_sender_enqueue_battery(&data);
+        }
+        case TELEMETRY_SAMPLE_ENV: {
+            if (sample_aggregator_is_enabled(REPORT_METRIC_TEMPERATURE)) {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            influxdb_env_data_t data = {
+                .timestamp_ns = timestamp_ns,
+                .temperature_c = sample->data.env.temperature,
+                .humidity_rh = sample->data.env.humidity,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            influx_sender_init();
+            return influx_sender_enqueue_env(&data);
+        }
+        case TELEMETRY_SAMPLE_WINDOW:
+            return influx_sender_enqueue_aggregate(sample->data.window.metric,
+                                                   &sample->data.window.window, sample->device_id);
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const telemetry_sink_t s_influx_sink = {
+    .name = "influxdb",
+    .types = TELEMETRY_TYPES_ALL,
+    .is_transport = true,
+    .publish = influx_sink_publish,
+};
+#endif
+
+// ============================================================================
+// MQTT sink
+// ============================================================================
+
+#if USE_MQTT
+static esp_err_t mqtt_sink_publish(const telemetry_sample_t* sample) {
+#if !MQTT_OUTBOX_ENABLED
+    // No broker session without WiFi (still associating is fine, the sender waits)
+    if (!wifi_manager_is_connecting_or_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
+    switch (sample->type) {
+        case TELEMETRY_SAMPLE_SOIL: {
+            mqtt_soil_data_t data = {
+                .timestamp_ms = sample->timestamp_ms,
+                .voltage = sample->data.soil.voltage,
+                .moisture_percent = sample->data.soil.moisture_percent,
+                .raw_adc = sample->data.soil.raw_adc,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            return mqtt_sender_enqueue_soil(&data);
+        }
+        case TELEMETRY_SAMPLE_BATTERY: {
+            mqtt_battery_data_t data = {
+                .timestamp_ms = sample->timestamp_ms,
+                .voltage = sample->data.battery.voltage,
+                .percentage = sample->data.battery.percentage,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            return mqtt_sender_enqueue_battery(&data);
+        }
+        case TELEMETRY_SAMPLE_ENV: {
+            mqtt_env_data_t data = {
+                .timestamp_ms = sample->timestamp_ms,
+                .temperature = sample->data.env.temperature,
+                .humidity = sample->data.env.humidity,
+            };
+            memcpy(data.device_id, sample->device_id, sizeof(data.device_id));
+            return mqtt_sender_enqueue_env(&data);
+        }
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const telemetry_sink_t s_mqtt_sink = {
+    .name = "mqtt",
+    .types = TELEMETRY_TYPES_READINGS,
+    .is_transport = true,
+    .publish = mqtt_sink_publish,
+};
+#endif
+
+// ============================================================================
+// Log sink
+// ============================================================================
+
+#if TELEMETRY_LOG_SINK_ENABLED
+static esp_err_t log_sink_publish(const telemetry_sample_t* sample) {
+    switch (sample->type) {
+        case TELEMETRY_SAMPLE_SOIL:
+            ESP_LOGI(TAG, "[%s] soil %.1f%% %.3fV raw=%d", sample->device_id,
+                     sample->data.soil.moisture_percent, sample->data.soil.voltage, sample->data.soil.raw_adc);
+            break;
+        case TELEMETRY_SAMPLE_BATTERY:
+            ESP_LOGI(TAG, "[%s] battery %.2fV", sample->device_id, sample->data.battery.voltage);
+            break;
+        case TELEMETRY_SAMPLE_ENV:
+            ESP_LOGI(TAG, "[%s] env %.2fC %.2f%%RH", sample->device_id,
+                     sample->data.env.temperature, sample->data.env.humidity);
+            break;
+        case TELEMETRY_SAMPLE_WINDOW: {
+            const sample_window_t* w = &sample->data.window.window;
+            ESP_LOGI(TAG, "[%s] %s window %lus min=%.2f max=%.2f mean=%.2f n=%lu", sample->device_id,
+                     report_metric_name(sample->data.window.metric), (unsigned long)w->window_s,
+                     w->min, w->max, w->mean, (unsigned long)w->count);
+            break;
+        }
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+static const telemetry_sink_t s_log_sink = {
+    .name = "log",
+    .types = TELEMETRY_TYPES_ALL,
+    .is_transport = false,
+    .publish = log_sink_publish,
+};
+#endif
+
+// Built-in sinks, selected at build time by the feature toggles
+static const telemetry_sink_t* const s_builtin_sinks[] = {
+#if USE_INFLUXDB
+    &s_influx_sink,
+#endif
+#if USE_MQTT
+    &s_mqtt_sink,
+#endif
+#if TELEMETRY_LOG_SINK_ENABLED
+    &s_log_sink,
+#endif
+};
+
+_Static_assert(sizeof(s_builtin_sinks) / sizeof(s_builtin_sinks[0]) <= TELEMETRY_MAX_SINKS,
+               "TELEMETRY_MAX_SINKS too small for the built-in sinks");
+
+// ============================================================================
+// Bus
+// ============================================================================
+
+void telemetry_sample_init(telemetry_sample_t* sample, telemetry_sample_type_t type, const char* device_id) {
+    memset(sample, 0, sizeof(*sample));
+    sample->type = type;
+    if (device_id != NULL) {
+        strncpy(sample->device_id, device_id, sizeof(sample->device_id) - 1);
+    }
+}
+
+esp_err_t telemetry_register_sink(const telemetry_sink_t* sink) {
+    if (sink == NULL || sink->publish == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < s_sink_count; i++) {
+        if (s_sinks[i] == sink) {
+            return ESP_OK;
+        }
+    }
+    if (s_sink_count >= TELEMETRY_MAX_SINKS) {
+        ESP_LOGE(TAG, "No free sink slot for %s", sink->name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t index = s_sink_count;
+    s_stats[index] = (telemetry_sink_stats_t){ .name = sink->name };
+    s_sinks[index] = sink;
+    for (int type = 0; type < TELEMETRY_SAMPLE_TYPE_COUNT; type++) {
+        if (sink->types & TELEMETRY_TYPE_BIT(type)) {
+            s_dispatch[type][s_dispatch_count[type]] = (uint8_t)index;
+            s_dispatch_count[type]++;   // Entry first: a concurrent publish never sees an unset slot
+        }
+    }
+    s_sink_count++;
+    ESP_LOGI(TAG, "Sink registered: %s", sink->name);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_init(void) {
+    if (s_initialized) {
+        return ESP_OK;
+    }
+    s_initialized = true;
+
+    for (size_t i = 0; i < sizeof(s_builtin_sinks) / sizeof(s_builtin_sinks[0]); i++) {
+        telemetry_register_sink(s_builtin_sinks[i]);
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_publish(telemetry_sample_t* sample) {
+    if (sample == NULL || sample->type >= TELEMETRY_SAMPLE_TYPE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (sample->timestamp_ms == 0) {
+        sample->timestamp_ms = esp_utils_get_timestamp_ms();
+    }
+    event_counter_inc(EVT_SAMPLE);
+
+    esp_err_t result = ESP_ERR_NOT_FOUND;
+    bool delivered = false;
+    const uint8_t* dispatch = s_dispatch[sample->type];
+    size_t count = s_dispatch_count[sample->type];
+    for (size_t k = 0; k < count; k++) {
+        size_t i = dispatch[k];
+        const telemetry_sink_t* sink = s_sinks[i];
+        esp_err_t ret = sink->publish(sample);
+        if (ret == ESP_ERR_NOT_SUPPORTED) {
+            continue;
+        }
+
+        taskENTER_CRITICAL(&s_stats_lock);
+        if (ret == ESP_OK) {
+            s_stats[i].accepted++;
+        } else {
+            s_stats[i].dropped++;
+        }
+        taskEXIT_CRITICAL(&s_stats_lock);
+
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Sink %s rejected sample: %s", sink->name, esp_err_to_name(ret));
+        }
+        if (sink->is_transport) {
+            if (ret == ESP_OK) {
+                delivered = true;
+            } else {
+                result = ret;
+            }
+        }
+    }
+
+    return delivered ? ESP_OK : result;
+}
+
+size_t telemetry_get_stats(telemetry_sink_stats_t* stats, size_t max) {
+    if (stats == NULL) {
+        return s_sink_count;
+    }
+
+    size_t n = (s_sink_count < max) ? s_sink_count : max;
+    taskENTER_CRITICAL(&s_stats_lock);
+    memcpy(stats, s_stats, n * sizeof(telemetry_sink_stats_t));
+    taskEXIT_CRITICAL(&s_stats_lock);
+    return s_sink_count;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file telemetry.h
+ * @brief Telemetry Bus
+ *
+ * Monitor apps publish one typed sample per reading instead of filling an
+ * InfluxDB struct and a near-identical MQTT struct by hand. The bus stamps the
+ * sample once and hands the same copy to every registered sink, which encodes
+ * it in its own format (line protocol point, MQTT JSON, log line).
+ *
+ * Batching, backpressure and offline buffering stay with the sink's sender
+ * (influx_sender batches and stores offline, mqtt_sender queues): a sink that
+ * cannot take a sample returns an error and the bus counts it for that sink.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "esp_err.h"
+#include "report_policy.h"
+#include "sample_aggregator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_MAX_SINKS         4
+
+typedef enum {
+    TELEMETRY_SAMPLE_SOIL,
+    TELEMETRY_SAMPLE_BATTERY,
+    TELEMETRY_SAMPLE_ENV,
+    TELEMETRY_SAMPLE_WINDOW,        // Closed aggregation window of one metric
+    TELEMETRY_SAMPLE_TYPE_COUNT
+} telemetry_sample_type_t;
+
+#define TELEMETRY_TYPE_BIT(type)    (1u << (type))
+#define TELEMETRY_TYPES_READINGS    (TELEMETRY_TYPE_BIT(TELEMETRY_SAMPLE_SOIL) | \
+                                     TELEMETRY_TYPE_BIT(TELEMETRY_SAMPLE_BATTERY) | \
+                                     TELEMETRY_TYPE_BIT(TELEMETRY_SAMPLE_ENV))
+#define TELEMETRY_TYPES_ALL         (TELEMETRY_TYPES_READINGS | TELEMETRY_TYPE_BIT(TELEMETRY_SAMPLE_WINDOW))
+
+// One reading as published by a monitor app
+typedef struct {
+    telemetry_sample_type_t type;
+    uint64_t timestamp_ms;          // Set by telemetry_publish (wall clock, NTP time once synced)
+    char device_id[32];
+    union {
+        struct {
+            float voltage;
+            float moisture_percent;
+            int raw_adc;
+        } soil;
+        struct {
+            float voltage;
+            float percentage;       // -1 if not calculated
+        } battery;
+        struct {
+            float temperature;
+            float humidity;
+        } env;
+        struct {
+            report_metric_t metric;
+            sample_window_t window;
+        } window;
+    } data;
+} telemetry_sample_t;
+
+// Output of the bus; publish() encodes the sample into the sink's own format
+typedef struct {
+    const char* name;
+    uint32_t types;                 // TELEMETRY_TYPE_BIT mask of accepted sample types
+    bool is_transport;              // Acceptance counts as the sample being reported
+    // ESP_OK when taken, ESP_ERR_NOT_SUPPORTED to skip this sample, any other error is a drop
+    esp_err_t (*publish)(const telemetry_sample_t* sample);
+} telemetry_sink_t;
+
+// Per-sink counters since init
+typedef struct {
+    const char* name;
+    uint32_t accepted;
+    uint32_t dropped;
+} telemetry_sink_stats_t;
+
+// Register the built-in sinks selected at build time (menuconfig → Features; idempotent)
+esp_err_t telemetry_init(void);
+
+// Zero a sample and set its type and device id
+void telemetry_sample_init(telemetry_sample_t* sample, telemetry_sample_type_t type, const char* device_id);
+
+// Add a sink (the descriptor must stay valid); ESP_ERR_NO_MEM when TELEMETRY_MAX_SINKS are in use
+esp_err_t telemetry_register_sink(const telemetry_sink_t* sink);
+
+// Stamp the sample and fan it out. ESP_OK if at least one transport sink took it,
+// ESP_ERR_NOT_FOUND if no transport sink handles it, otherwise the last sink error.
+esp_err_t telemetry_publish(telemetry_sample_t* sample);
+
+// Copy the counters of up to max sinks, returns the number of sinks
+size_t telemetry_get_stats(telemetry_sink_stats_t* stats, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_H
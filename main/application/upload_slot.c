@@ -0,0 +1,120 @@
+/**
+ * @file upload_slot.c
+ * @brief Fleet Upload Slot - Implementation
+ */
+
+#include "upload_slot.h"
+#include "cycle_scheduler.h"
+#include "influxdb_client.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+
+#include "../config/esp32-config.h"
+
+static const char* TAG = "UPLOAD_SLOT";
+
+#define UPLOAD_SLOT_RTC_MAGIC   0x55534C31      // "USL1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t period_ms;
+    uint32_t slot_ms;
+    int32_t server_slot_ms;                     // Last backend-assigned slot applied (-1: none)
+} upload_slot_rtc_t;
+
+static RTC_DATA_ATTR upload_slot_rtc_t s_slot;
+static uint32_t s_throttled_seen = 0;           // writes_throttled already acted on (continuous mode)
+
+static uint32_t upload_slot_from_mac(uint32_t period_ms) {
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        hash = (hash ^ mac[i]) * 16777619u;
+    }
+    return hash % period_ms;
+}
+
+uint32_t upload_slot_init(uint32_t period_ms) {
+    if (period_ms == 0) {
+        period_ms = 1;
+    }
+    if (s_slot.magic == UPLOAD_SLOT_RTC_MAGIC && s_slot.period_ms == period_ms &&
+        esp_reset_reason() == ESP_RST_DEEPSLEEP) {
+        return s_slot.slot_ms;
+    }
+
+    s_slot.magic = UPLOAD_SLOT_RTC_MAGIC;
+    s_slot.period_ms = period_ms;
+    s_slot.server_slot_ms = -1;
+    s_slot.slot_ms = (UPLOAD_SLOT_OFFSET_MS >= 0) ? (uint32_t)UPLOAD_SLOT_OFFSET_MS % period_ms
+                                                  : upload_slot_from_mac(period_ms);
+    ESP_LOGI(TAG, "Upload slot %lu ms of %lu ms (%s)", (unsigned long)s_slot.slot_ms,
+             (unsigned long)period_ms, (UPLOAD_SLOT_OFFSET_MS >= 0) ? "configured" : "from MAC");
+    return s_slot.slot_ms;
+}
+
+uint32_t upload_slot_get(void) {
+    return s_slot.slot_ms;
+}
+
+// Move to slot_ms; the grid only ever moves forward, so no deadline falls into the past
+static int64_t upload_slot_move(uint32_t slot_ms, const char* why) {
+    uint32_t period_ms = s_slot.period_ms;
+    slot_ms %= period_ms;
+    int64_t shift_ms = ((int64_t)slot_ms - (int64_t)s_slot.slot_ms + period_ms) % period_ms;
+    if (shift_ms != 0) {
+        ESP_LOGI(TAG, "Upload slot %lu -> %lu ms (%s)", (unsigned long)s_slot.slot_ms,
+                 (unsigned long)slot_ms, why);
+    }
+    s_slot.slot_ms = slot_ms;
+    return shift_ms;
+}
+
+// Once the wall clock is set the grid sits at a wall-clock offset; moves are measured from there,
+// so a backend-assigned slot means the same instant on every node
+static void upload_slot_follow_clock(void) {
+    int64_t first_ms = cycle_scheduler_plan_first_ms();
+    if (first_ms == INT64_MAX ||
+        first_ms < (int64_t)(INFLUXDB_MIN_VALID_TIMESTAMP_NS / 1000000ULL)) {
+        return;
+    }
+    s_slot.slot_ms = (uint32_t)(first_ms % s_slot.period_ms);
+}
+
+int64_t upload_slot_update(const influx_sender_stats_t* stats) {
+    if (s_slot.magic != UPLOAD_SLOT_RTC_MAGIC) {
+        return 0;
+    }
+    upload_slot_follow_clock();
+
+    // A slot assigned by the backend takes precedence over the own choice
+    int32_t server_ms = influxdb_get_upload_slot_ms();
+    if (server_ms >= 0 && server_ms != s_slot.server_slot_ms) {
+        s_slot.server_slot_ms = server_ms;
+        return upload_slot_move((uint32_t)server_ms, "assigned by the backend");
+    }
+
+    if (stats == NULL || stats->writes_throttled <= s_throttled_seen) {
+        return 0;
+    }
+    s_throttled_seen = stats->writes_throttled;
+    if (s_slot.server_slot_ms >= 0) {
+        return 0;       // The backend placed this node, it moves it through the header
+    }
+
+    // Crowded slot: wait as long as the backend asked, plus a random share of it so nodes
+    // refused together do not all land on the same new slot, or draw a new slot
+    uint32_t retry_after_ms = stats->retry_after_ms;
+    if (retry_after_ms > 0 && retry_after_ms < s_slot.period_ms) {
+        uint32_t spread_ms = (uint32_t)((uint64_t)retry_after_ms * UPLOAD_SLOT_RETRY_SPREAD_PERCENT / 100);
+        if (spread_ms > 0) {
+            retry_after_ms += esp_random() % spread_ms;
+        }
+        return upload_slot_move(s_slot.slot_ms + retry_after_ms, "Retry-After");
+    }
+    return upload_slot_move(esp_random() % s_slot.period_ms, "backend overloaded");
+}
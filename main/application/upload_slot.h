@@ -0,0 +1,43 @@
+/**
+ * @file upload_slot.h
+ * @brief Fleet Upload Slot
+ *
+ * Nodes with the same wake interval that boot together (e.g. after a power
+ * cut) would wake, associate and POST at the same instant, and the backend
+ * answers the burst with 502/503. Each node instead offsets its wake grid by
+ * its own slot within the interval:
+ *   - Derived from the MAC (FNV-1a), so a fleet spreads without coordination,
+ *     or fixed per build (UPLOAD_SLOT_OFFSET_MS)
+ *   - Replaced by a slot the backend assigns in an X-Upload-Slot response
+ *     header (influxdb_get_upload_slot_ms())
+ *   - Moved by the backend's Retry-After plus a random share of it, or to a
+ *     random offset without one, after an upload the backend refused for
+ *     load (429/502/503)
+ *
+ * Once the wall clock is set the slot is the grid's offset within the
+ * interval on the wall clock, so an assigned slot is the same instant on
+ * every node.
+ *
+ * The slot is kept in RTC memory across deep sleep; after any other reset it
+ * is derived again.
+ */
+
+#ifndef UPLOAD_SLOT_H
+#define UPLOAD_SLOT_H
+
+#include "influx_sender.h"
+#include <stdint.h>
+
+// Restore or derive the slot (call once per boot, before cycle_scheduler_plan_init).
+// Returns the slot: the offset in ms within period_ms (the base wake interval).
+uint32_t upload_slot_init(uint32_t period_ms);
+
+// Current slot (ms within the period)
+uint32_t upload_slot_get(void);
+
+// Move the slot from this wake's upload results (call after the upload, before
+// cycle_scheduler_plan_next). Returns the shift in ms (0 = slot unchanged) to
+// pass to cycle_scheduler_plan_shift().
+int64_t upload_slot_update(const influx_sender_stats_t* stats);
+
+#endif // UPLOAD_SLOT_H
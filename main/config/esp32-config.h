@@ -9,6 +9,7 @@
 #ifndef ESP32_CONFIG_H
 #define ESP32_CONFIG_H
 
+#include "sdkconfig.h"
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
 
@@ -19,12 +20,43 @@
 // Feature Toggles - Enable/Disable Monitoring Modules
 // ============================================================================
 
+// Selected in idf.py menuconfig → Features. The sources of a disabled feature are
+// left out of the build (main/CMakeLists.txt, components/drivers/CMakeLists.txt).
+#ifdef CONFIG_APP_ENABLE_WIFI
 #define ENABLE_WIFI             1   // WiFi connectivity (needed for InfluxDB/MQTT)
+#else
+#define ENABLE_WIFI             0
+#endif
+#ifdef CONFIG_APP_ENABLE_INFLUXDB
+#define ENABLE_INFLUXDB         1   // InfluxDB data logging (requires WiFi)
+#else
+#define ENABLE_INFLUXDB         0
+#endif
+#ifdef CONFIG_APP_ENABLE_MQTT
 #define ENABLE_MQTT             1   // MQTT client for IoT data publishing (requires WiFi)
+#else
+#define ENABLE_MQTT             0
+#endif
+#ifdef CONFIG_APP_ENABLE_ENV_MONITOR
 #define ENABLE_ENV_MONITOR      1   // AHT20 temperature/humidity sensor
+#else
+#define ENABLE_ENV_MONITOR      0
+#endif
+#ifdef CONFIG_APP_ENABLE_BATTERY_MONITOR
 #define ENABLE_BATTERY_MONITOR  1   // Battery voltage monitoring via ADC, Battery connected to GPIO0 with 2:1 voltage divider
+#else
+#define ENABLE_BATTERY_MONITOR  0
+#endif
+#ifdef CONFIG_APP_ENABLE_SOIL_MONITOR
 #define ENABLE_SOIL_MONITOR     1   // Soil moisture monitoring via ADC
+#else
+#define ENABLE_SOIL_MONITOR     0
+#endif
+#ifdef CONFIG_APP_ENABLE_EPAPER_DISPLAY
 #define ENABLE_EPAPER_DISPLAY   1   // WeAct ePaper display (SPI)
+#else
+#define ENABLE_EPAPER_DISPLAY   0
+#endif
 
 // ============================================================================
 // Deep Sleep Configuration
@@ -33,6 +65,61 @@
 #define DEEP_SLEEP_ENABLED              1                   // Enable/disable deep sleep mode (0 = continuous loop with delay)
 #define DEEP_SLEEP_DURATION_SECONDS     360                  // Sleep duration between measurement cycles (60s for e-paper refresh interval)
 #define DEEP_SLEEP_WAKEUP_DELAY_MS      100                 // Delay before entering deep sleep
+#define CYCLE_DEADLINE_MS               30000               // Max time to wait for sensors + WiFi in one cycle
+
+// Wake plan: per-sensor cadences on one fixed-rate grid (keep them multiples of DEEP_SLEEP_DURATION_SECONDS
+// so the jobs share wakes). Sleep lasts until the next deadline, not a fixed time after the cycle.
+#define SCHEDULE_ENV_INTERVAL_S         DEEP_SLEEP_DURATION_SECONDS         // Temperature/humidity
+#define SCHEDULE_SOIL_INTERVAL_S        (2 * DEEP_SLEEP_DURATION_SECONDS)   // Soil moisture
+#define SCHEDULE_BATTERY_INTERVAL_S     (10 * DEEP_SLEEP_DURATION_SECONDS)  // Battery voltage (hourly)
+#define SCHEDULE_STRETCH_2X_BELOW_V     3.7f    // All intervals doubled below this battery voltage
+#define SCHEDULE_STRETCH_4X_BELOW_V     3.5f    // All intervals quadrupled below this battery voltage
+#define SCHEDULE_EARLY_WAKE_MS          2000    // Jobs due within this window run on the current wake
+
+// Fleet upload slots: the grid is offset by a per-node slot within DEEP_SLEEP_DURATION_SECONDS so
+// nodes that boot together do not upload together. The slot comes from the MAC (or the fixed
+// offset below), an X-Upload-Slot response header (seconds) replaces it, and a 429/502/503 moves
+// it by the backend's Retry-After (randomly without one). Applied from the first sleep after a reset;
+// once the wall clock is set the slot is the offset of the wall clock within the interval.
+#define UPLOAD_SLOT_ENABLED             1
+#define UPLOAD_SLOT_OFFSET_MS           (-1)    // Offset within the interval, -1 = derived from the MAC
+#define UPLOAD_SLOT_RETRY_SPREAD_PERCENT 25     // Random extra wait after a Retry-After, in % of it
+
+// Continuous mode (DEEP_SLEEP_ENABLED 0): automatic light sleep between cycles, WiFi and the
+// InfluxDB/MQTT connections stay up. Not for the ESP-NOW gateway, which must keep its radio listening.
+#define CONTINUOUS_LIGHT_SLEEP_ENABLED  (ESPNOW_ROLE != ESPNOW_ROLE_GATEWAY)
+#define CONTINUOUS_CPU_MAX_FREQ_MHZ     160
+#define CONTINUOUS_CPU_MIN_FREQ_MHZ     40      // XTAL
+
+// ============================================================================
+// Sensor Runtime
+// ============================================================================
+
+// One task measures every registered sensor (soil, battery, AHT20) instead of a task per sensor
+#define SENSOR_TASK_STACK_SIZE          (8 * 1024)  // Reporting path formats and queues samples on this stack
+#define SENSOR_TASK_PRIORITY            5
+#define SENSOR_TASK_NAME                "sensors"
+#define SENSOR_STOP_TIMEOUT_MS          1000        // Wait for a pass stopped at the cycle deadline
+
+// ============================================================================
+// Lazy Initialization
+// ============================================================================
+
+// Components (radio, senders, sensors, display) start the first time a cycle needs them;
+// components without a dependency between them start concurrently on short-lived init tasks
+#define INIT_TASK_STACK_SIZE            (6 * 1024)  // WiFi and driver bring-up run on this stack
+#define INIT_TASK_PRIORITY              5
+#define INIT_TASK_NAME                  "init"
+#define INIT_TIMEOUT_MS                 5000        // Longest wait for the components of a cycle
+
+// ============================================================================
+// Memory Allocation
+// ============================================================================
+
+// 1: sensor/sender tasks, their queues and event groups and the HTTP packet buffers live in .bss
+// (reserved at link time, no heap allocation or fragmentation per wake). 0: created on the heap.
+#define STATIC_ALLOCATION_ENABLED       1
+#define HTTP_BUFFER_POOL_SLOTS          2       // Packet buffers of MAX_PACKET_SIZE (one for add, one for flush)
 
 // ============================================================================
 // GPIO Pin Assignments
@@ -56,11 +143,9 @@
 #define BATTERY_MONITOR_LOW_VOLTAGE_THRESHOLD   3.2f    // Low battery threshold in volts
 #define BATTERY_MONITOR_USE_DEEP_SLEEP_ON_LOW_BATTERY  1
 
-#define BATTERY_MONITOR_TASK_STACK_SIZE         (8 * 1024)
-#define BATTERY_MONITOR_TASK_PRIORITY           5
-#define BATTERY_MONITOR_TASK_NAME               "battery_monitor"
 #define BATTERY_MONITOR_MEASUREMENT_INTERVAL_MS (10 * 1000)
 #define BATTERY_MEASUREMENTS_PER_CYCLE          1
+#define BATTERY_ADC_SCAN_MAX_AGE_MS             200     // Reuse an ADC scan pass this recent (the soil sensor's, read just before)
 
 
 
@@ -76,22 +161,23 @@
 
 #define SOIL_SENSOR_POWER_PIN       GPIO_NUM_18    // GPIO18 (changed to avoid ePaper conflict)
 
-#define SOIL_TASK_STACK_SIZE            (4 * 1024)
-#define SOIL_TASK_PRIORITY              5
-#define SOIL_TASK_NAME                  "soil_monitor"
 #define SOIL_DRY_VOLTAGE_DEFAULT        3.0f
 #define SOIL_WET_VOLTAGE_DEFAULT        1.0f
 #define SOIL_MEASUREMENT_INTERVAL_MS    (10 * 1000)
 #define SOIL_MEASUREMENTS_PER_CYCLE     1
+// Optional multi-point curve {voltage, percent} replacing the dry/wet line, e.g.
+// #define SOIL_CALIBRATION_TABLE       { {1.00f, 100.0f}, {1.45f, 70.0f}, {2.10f, 35.0f}, {3.00f, 0.0f} }
 
 // ============================================================================
-// I2C + Environment Task (AHT20) Configuration
+// I2C Bus + Environment Sensor (AHT20) Configuration
 // ============================================================================
 
+// One shared bus (components/drivers/i2c) for every I2C sensor; each device
+// may override the clock, I2C_FREQ_HZ is the default
 #define I2C_PORT                     I2C_NUM_0
 #define I2C_SDA_PIN                  GPIO_NUM_19  // matches firebeetle 2 silkscreen
 #define I2C_SCL_PIN                  GPIO_NUM_20  // matches firebeetle 2 silkscreen
-#define I2C_FREQ_HZ                  100000
+#define I2C_FREQ_HZ                  400000       // Fast mode (AHT20 max 400 kHz); 100000 for long wires
 
 // ============================================================================
 // ePaper Display Configuration (WeAct Studio Module)
@@ -118,13 +204,15 @@
 // Display Configuration
 #define EPAPER_ROTATION             0   // 0=normal (Y-decrement mode handles physical orientation)
 #define EPAPER_FULL_UPDATE_INTERVAL 10  // Full refresh every N partial updates (partial refresh is faster, ~0.3s vs ~2s)
+#define EPAPER_FULL_REFRESH_PERCENT 50  // Changed pixels (% of the panel) that get a full refresh instead (0 = off)
+#define EPAPER_GHOST_LIMIT_PERCENT  100 // Pixels flipped by partial refreshes (% of the panel) before a full refresh (0 = off)
 #define EPAPER_TASK_STACK_SIZE      (8 * 1024)
 #define EPAPER_TASK_PRIORITY        4
+#define EPAPER_DISPLAY_TIMEOUT_MS   15000   // Max time the sleep gate waits for a requested refresh
+#define EPAPER_REFRESH_ON_CHANGE    1       // Skip the refresh while every shown value rounds to the same digits
 
 #endif // ENABLE_EPAPER_DISPLAY
 
-#define ENV_TASK_STACK_SIZE          (8 * 1024)   // Increased to reduce stack pressure during logging/formatting
-#define ENV_TASK_PRIORITY            5
 // Interval between measurements inside a single wake cycle (used if measurements per cycle > 1)
 #define ENV_MEASUREMENT_INTERVAL_MS  (10 * 1000) // 10 seconds
 
@@ -143,9 +231,79 @@
 // NTP Time Synchronization Configuration
 // ============================================================================
 
-#define NTP_ENABLED                     0                   // Enable/disable NTP time synchronization (0 = use server time, 1 = use NTP time)
+#define NTP_ENABLED                     0                   // Enable/disable NTP time synchronization (SNTP runs only when a re-sync is due)
 #define NTP_SYNC_TIMEOUT_MS             15000               // NTP sync timeout in milliseconds
 
+// The wall clock keeps running in the RTC across deep sleep; the time service
+// tracks its drift and only asks for SNTP when the clock may be off
+#define TIME_RESYNC_INTERVAL_S          (6 * 60 * 60)       // Re-sync SNTP at least this often
+#define TIME_MAX_ERROR_MS               500                 // Re-sync once the estimated drift exceeds this
+#define TIME_ASSUMED_DRIFT_PPM          150                 // Drift assumed until two syncs measured it
+#define TIME_HTTP_DATE_CORRECTION       1                   // Step the clock from the InfluxDB response Date header
+#define TIME_HTTP_DATE_MIN_STEP_MS      2000                // Header has 1 s resolution: only larger errors are corrected
+
+// ============================================================================
+// Performance Profiling Configuration
+// ============================================================================
+
+#define PERF_PROFILER_PUBLISH           1                   // Publish wake-cycle phase timings as device_perf
+#define PERF_PUBLISH_EVERY_N_CYCLES     10                  // Cycles accumulated in RTC memory per device_perf point
+#define RESOURCE_TRACKER_PUBLISH        1                   // Publish worst-case heap/stack use as device_resources
+#define RESOURCE_PUBLISH_EVERY_N_CYCLES 60                  // Cycles between device_resources points (values are since power-on)
+
+// ============================================================================
+// Report-by-Exception Configuration
+// ============================================================================
+// A reading is only sent when it leaves the deadband around the last reported
+// value, changes faster than the rate threshold, or the heartbeat expired.
+// 0 disables a threshold; REPORT_POLICY_ENABLED 0 sends every reading.
+
+#define REPORT_POLICY_ENABLED           1
+
+#define BATTERY_REPORT_DEADBAND_V       0.05f               // Volts
+#define BATTERY_REPORT_RATE_PER_MIN     0.0f                // Volts per minute
+#define BATTERY_REPORT_MIN_INTERVAL_S   0
+#define BATTERY_REPORT_MAX_INTERVAL_S   (60 * 60)           // Heartbeat
+
+#define ENV_REPORT_TEMP_DEADBAND_C      0.3f                // Degrees C
+#define ENV_REPORT_TEMP_RATE_PER_MIN    0.2f                // Degrees C per minute
+#define ENV_REPORT_HUMIDITY_DEADBAND    2.0f                // %RH
+#define ENV_REPORT_HUMIDITY_RATE_PER_MIN 1.0f               // %RH per minute
+#define ENV_REPORT_MIN_INTERVAL_S       0
+#define ENV_REPORT_MAX_INTERVAL_S       (30 * 60)
+
+#define SOIL_REPORT_DEADBAND_PERCENT    2.0f                // Moisture %
+#define SOIL_REPORT_RATE_PER_MIN        0.5f                // Moisture % per minute (watering)
+#define SOIL_REPORT_MIN_INTERVAL_S      0
+#define SOIL_REPORT_MAX_INTERVAL_S      (3 * 60 * 60)
+
+// ============================================================================
+// Windowed Aggregation Configuration
+// ============================================================================
+// Readings (taken every *_MEASUREMENT_INTERVAL_MS within a wake and once per wake
+// across deep sleep) are folded into clock-aligned windows held in RTC memory.
+// InfluxDB then receives one sensor_window point (min/max/mean/count) per window
+// and metric instead of every reading. MQTT keeps publishing live readings.
+
+#define AGGREGATION_ENABLED             0                   // 0 = write raw points to InfluxDB
+#define BATTERY_AGG_WINDOW_S            (60 * 60)
+#define ENV_AGG_WINDOW_S                (30 * 60)
+#define SOIL_AGG_WINDOW_S               (60 * 60)
+
+// ============================================================================
+// Deferred Upload Configuration
+// ============================================================================
+// Wakes that only sample keep their InfluxDB points in an RTC-memory ring and
+// skip WiFi entirely. The radio comes up every Nth wake, when the ring passes
+// the fill threshold, or when a reading trips a report-policy deadband/rate
+// trigger; that wake drains the ring into its batch. Requires USE_INFLUXDB.
+// A ring that fills anyway spills its oldest half to the flash backlog.
+
+#define DEFERRED_UPLOAD_ENABLED         0                   // 0 = connect on every wake
+#define DEFERRED_UPLOAD_EVERY_N_WAKES   6
+#define DEFERRED_UPLOAD_FILL_PERCENT    75
+#define SAMPLE_STORE_CAPACITY           64                  // Records (28 bytes each) in RTC memory
+
 // ============================================================================
 // Logging Configuration
 // ============================================================================
@@ -160,6 +318,22 @@
 #define WIFI_MAX_RETRY          15
 #define WIFI_CONNECTED_BIT      BIT0
 #define WIFI_FAIL_BIT           BIT1
+#define WIFI_CONNECT_TIMEOUT_MS       20000   // Upper bound for a blocking wifi_manager_connect()
+
+// Fast connect: reuse BSSID/channel/DHCP lease of the last wake (RTC memory)
+#define WIFI_FAST_CONNECT_ENABLED     1
+#define WIFI_FAST_CONNECT_TIMEOUT_MS  3000    // Fall back to a full scan if the cached AP does not answer
+#define WIFI_FAST_LEASE_MAX_AGE_S     3600    // Reuse a cached DHCP lease for at most this long
+
+// Static IP (skips DHCP on every wake, overrides the cached lease)
+#define WIFI_STATIC_IP_ENABLED        0
+#define WIFI_STATIC_IP                "192.168.1.50"
+#define WIFI_STATIC_GATEWAY           "192.168.1.1"
+#define WIFI_STATIC_NETMASK           "255.255.255.0"
+#define WIFI_STATIC_DNS               "192.168.1.1"
+
+// Max modem sleep in continuous light-sleep mode: the station wakes for every Nth beacon
+#define WIFI_LISTEN_INTERVAL          3
 
 // ============================================================================
 // InfluxDB Configuration
@@ -167,10 +341,36 @@
 // Note: INFLUXDB_SERVER, INFLUXDB_BUCKET, INFLUXDB_ORG, and INFLUXDB_TOKEN
 //       are defined in credentials.h (git-ignored)
 
-#define USE_INFLUXDB            (ENABLE_WIFI && 1)  // Enable InfluxDB data logging (requires WiFi)
+#define USE_INFLUXDB            (ENABLE_WIFI && ENABLE_INFLUXDB)  // Enable InfluxDB data logging (requires WiFi)
 #define INFLUXDB_PORT           443                 // HTTPS port (Caddy reverse proxy)
 #define INFLUXDB_USE_HTTPS      1                   // HTTPS required for Caddy proxy
 #define INFLUXDB_ENDPOINT       "/api/v2/write"
+#define INFLUXDB_TLS_SESSION_REUSE    1             // Resume TLS via session tickets (needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+#define INFLUXDB_GZIP_ENABLED         1             // gzip request bodies (Content-Encoding: gzip)
+#define INFLUXDB_GZIP_MIN_SIZE        512           // Bodies smaller than this are sent uncompressed (bytes)
+
+// Batched writes: all points of a cycle go out in one POST
+#define INFLUXDB_BATCH_INITIAL_SIZE   512           // Initial line protocol buffer (bytes)
+#define INFLUXDB_BATCH_MAX_SIZE       8192          // Maximum body size of one POST (bytes)
+#define INFLUXDB_BATCH_MAX_POINTS     32            // Flush once this many points are queued
+#define INFLUXDB_BATCH_LINGER_MS      5000          // Flush a partial batch after this idle time
+#define INFLUXDB_MIN_VALID_TIMESTAMP_NS 1577836800000000000ULL  // 2020-01-01: older means clock not set
+
+// Failed batches are retried by the sender task without blocking it: delays double from
+// BASE to MAX with random jitter, 429/503 wait for Retry-After. Once the next attempt would
+// fall after BUDGET (from the first failure) the batch goes to the backlog and the cycle ends.
+#define INFLUXDB_RETRY_BASE_MS        500
+#define INFLUXDB_RETRY_MAX_MS         4000
+#define INFLUXDB_RETRY_JITTER_PERCENT 50            // Delay drawn from [50 %, 100 %] of the backoff
+#define INFLUXDB_RETRY_BUDGET_MS      4000          // Keep below the influx_sender_wait_until_empty() timeout
+
+// Offline store-and-forward: failed batches go to flash and are replayed later
+#define INFLUXDB_BACKLOG_ENABLED      1
+#define INFLUXDB_BACKLOG_PARTITION    "influxlog"   // Flash ring log partition (partitions.csv)
+#define INFLUXDB_BACKLOG_REPLAY_MAX_POSTS  8        // Replay POSTs per flush (bounds awake time)
+#define INFLUXDB_BACKLOG_FRAME_SIZE   512           // Binary frame of offline points (~50 samples, < one POST body)
+#define INFLUXDB_BACKLOG_COMPRESSED   1             // Offline points as delta-of-delta sample blocks (sample_block.h), 0: frames
+#define INFLUXDB_BACKLOG_BLOCK_RECORDS  48          // Points per block (~3 bytes each; their line protocol must fit one POST body)
 
 // ============================================================================
 // Wi-Fi Failure Backoff
@@ -183,6 +383,7 @@
 #define HTTP_MAX_RETRIES        3                   // More retries
 #define HTTP_ENABLE_BUFFERING   1
 #define HTTP_MAX_BUFFERED_PACKETS  100
+#define HTTP_BUFFER_PARTITION   "httplog"           // Flash ring log partition (partitions.csv)
 
 // ============================================================================
 // MQTT Configuration
@@ -196,6 +397,79 @@
 #define MQTT_TIMEOUT_MS         10000                         // Connection timeout in milliseconds
 #define MQTT_QOS                1                             // Quality of Service (0, 1, or 2)
 #define MQTT_DEVICE_ID          "ESP32_C6_001"                // Device identifier for MQTT messages
+#define MQTT_PAYLOAD_BUFFER_SIZE    256                       // Encode buffer of the sender task (bytes)
+
+// Payload encoding per topic: MQTT_PAYLOAD_JSON or MQTT_PAYLOAD_CBOR (binary, about 40% smaller)
+#define MQTT_SOIL_PAYLOAD_FORMAT    MQTT_PAYLOAD_JSON
+#define MQTT_BATTERY_PAYLOAD_FORMAT MQTT_PAYLOAD_JSON
+#define MQTT_ENV_PAYLOAD_FORMAT     MQTT_PAYLOAD_JSON
+
+// Cycle snapshot: the samples of a cycle are published as one (retained) message to
+// <MQTT_BASE_TOPIC>/<MQTT_DEVICE_ID> when the cycle flushes the sender. Opt-in: existing
+// subscribers listen on the per-metric topics.
+#define MQTT_SNAPSHOT_ENABLED       0
+#define MQTT_SNAPSHOT_RETAIN        1   // Broker keeps the last snapshot for new subscribers
+#define MQTT_PER_METRIC_TOPICS      1   // Also publish each sample to its soil/battery/environment topic (0: snapshot only)
+#define MQTT_SNAPSHOT_PAYLOAD_FORMAT MQTT_PAYLOAD_JSON
+
+// Offline outbox: encoded messages that cannot be published, or (with deep sleep) are still
+// unacknowledged at the end of a cycle, are stored in a flash partition and replayed after the
+// next connect. Without deep sleep the client keeps retransmitting unacknowledged messages.
+#define MQTT_OUTBOX_ENABLED         1
+#define MQTT_OUTBOX_PARTITION       "mqttlog"   // Data partition label (see partitions.csv)
+#define MQTT_OUTBOX_DRAIN_MAX       20          // Stored messages replayed per publish
+#define MQTT_OUTBOX_DRAIN_INTERVAL_MS 50        // Pause between replayed messages (rate limit)
+#define MQTT_UNACKED_JOURNAL_SIZE   8           // QoS 1 publishes per cycle kept until their PUBACK
+
+// ============================================================================
+// Telemetry Bus
+// ============================================================================
+// Apps publish each reading once; the bus fans it out to the InfluxDB and MQTT
+// sinks enabled above (see application/telemetry.h).
+
+#ifdef CONFIG_APP_TELEMETRY_LOG_SINK
+#define TELEMETRY_LOG_SINK_ENABLED  1   // Also log every published sample (debugging)
+#else
+#define TELEMETRY_LOG_SINK_ENABLED  0
+#endif
+
+// ============================================================================
+// ESP-NOW Gateway Mode
+// ============================================================================
+// Leaf nodes send their samples over ESP-NOW to a mains-powered gateway, which
+// uploads for the whole fleet (see application/espnow_link.h).
+
+#define ESPNOW_ROLE_NONE            0   // Every node uploads over WiFi itself
+#define ESPNOW_ROLE_LEAF            1   // Sensor node: ESP-NOW only, no association or IP stack
+#define ESPNOW_ROLE_GATEWAY         2   // Mains-powered uploader: WiFi plus ESP-NOW receive
+#define ESPNOW_ROLE                 ESPNOW_ROLE_NONE
+
+#define ESPNOW_LINK_NODE_ID         1   // Leaf id carried in the ESP-NOW header
+#define ESPNOW_LINK_CHANNEL         1   // Must be the channel of the gateway's access point
+// Gateway STA MAC; broadcast works without pairing but gets no end-to-end ACK
+#define ESPNOW_GATEWAY_MAC          { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }
+#define ESPNOW_LINK_MAX_SAMPLES     24  // Leaf: samples kept in RTC memory until delivered
+#define ESPNOW_LINK_MAX_DEVICES     4   // Device ids per leaf (soil, env, battery)
+#define ESPNOW_GATEWAY_QUEUE_SIZE   32  // Gateway: decoded samples waiting for the bus
+// CRC also covers the frame header. Receivers accept both forms; enable once the
+// gateway runs firmware that understands ESPNOW_HEADER_CRC.
+#define ESPNOW_LINK_HEADER_CRC      0
+
+// Gateway bucket routing: points whose device id starts with a prefix are written to
+// that bucket (org and token from credentials.h), all others to INFLUXDB_BUCKET.
+// Pending points are kept in compact form with interned device tags and sent with
+// one POST per bucket. Entries: { "prefix", "bucket" },
+#define INFLUXDB_ROUTER_ENABLED     (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY)
+#define INFLUXDB_GATEWAY_ROUTES     /* { "greenhouse-", "greenhouse" }, */
+#define INFLUXDB_MAX_ROUTES         4   // Buckets incl. INFLUXDB_BUCKET
+#define INFLUXDB_ROUTER_MAX_POINTS  512 // Routed points held until written (36 bytes each)
+
+#if ESPNOW_ROLE == ESPNOW_ROLE_LEAF && ENABLE_WIFI
+#error "ESP-NOW leaf nodes do not associate: disable CONFIG_APP_ENABLE_WIFI"
+#endif
+#if ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY && (!ENABLE_WIFI || DEEP_SLEEP_ENABLED)
+#error "The ESP-NOW gateway needs CONFIG_APP_ENABLE_WIFI and DEEP_SLEEP_ENABLED 0"
+#endif
 
 #endif // ESP32_CONFIG_H
 
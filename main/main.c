@@ -7,7 +7,9 @@
  * and optional deep sleep power management.
  */
 
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -16,19 +18,39 @@
 #include "esp_netif.h"
 #include "esp_sleep.h"
 #include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_app_desc.h"
 #include "nvs_flash.h"
 
 #include "config/esp32-config.h"
 #include "config/credentials.h"
 #include "wifi_manager.h"
 #include "application/influx_sender.h"
+#include "application/cycle_scheduler.h"
+#include "application/sample_store.h"
+#include "application/upload_slot.h"
+#include "application/telemetry.h"
+#include "application/sensor_runtime.h"
+#include "application/init_graph.h"
 #include "influxdb_client.h"
 #include "esp_utils.h"
+#include "ntp_time.h"
+#include "time_service.h"
+#include "perf_profiler.h"
+#include "power_mode.h"
+#include "resource_tracker.h"
+#include "event_counters.h"
+#include "report_policy.h"
+#include "sample_aggregator.h"
 
 #if ENABLE_MQTT
 #include "application/mqtt_sender.h"
 #endif
 
+#if ESPNOW_ROLE != ESPNOW_ROLE_NONE
+#include "application/espnow_link.h"
+#endif
+
 #if ENABLE_BATTERY_MONITOR
 #include "application/battery_monitor_task.h"
 #endif
@@ -43,6 +65,10 @@ static env_monitor_app_t env_app;
 #include "application/soil_monitor_app.h"
 
 static soil_monitor_app_t soil_app;
+
+#if CONFIG_APP_SOIL_LP_POWER
+#include "csm_v2_lp_power.h"
+#endif
 #endif
 
 #if ENABLE_EPAPER_DISPLAY
@@ -53,6 +79,10 @@ static epaper_display_app_t epaper_app;
 
 static const char *TAG = "MAIN";
 
+#if ENABLE_WIFI
+static bool s_radio_on = false;     // WiFi and senders started on this wake
+#endif
+
 // ============================================================================
 // Initialization & Utility Functions
 // ============================================================================
@@ -63,6 +93,14 @@ static void wifi_status_cb(wifi_status_t status, const char* ip_addr) {
     switch(status) {
         case WIFI_STATUS_CONNECTED:
             ESP_LOGI(TAG, "WiFi Connected! IP: %s", ip_addr ? ip_addr : "N/A");
+#if NTP_ENABLED
+            // SNTP syncs in its own task, overlapping with the running sensor jobs; the clock
+            // survives deep sleep, so most wakes skip it
+            if (time_service_sync_due() && ntp_time_get_status() == NTP_STATUS_NOT_INITIALIZED) {
+                ntp_time_init(NULL);
+            }
+#endif
+            cycle_scheduler_job_done(CYCLE_JOB_WIFI);
             break;
         case WIFI_STATUS_DISCONNECTED:
             ESP_LOGW(TAG, "WiFi Disconnected");
@@ -72,6 +110,7 @@ static void wifi_status_cb(wifi_status_t status, const char* ip_addr) {
             break;
         case WIFI_STATUS_ERROR:
             ESP_LOGE(TAG, "WiFi Error");
+            cycle_scheduler_job_done(CYCLE_JOB_WIFI);   // Given up: do not hold the cycle
             break;
     }
 }
@@ -89,123 +128,367 @@ static void log_wakeup_reason(void) {
     }
 }
 
-static void enter_deep_sleep(uint32_t duration_seconds) {
+#if USE_INFLUXDB && PERF_PROFILER_PUBLISH
+/**
+ * @brief Queue the accumulated phase timings once the window is full
+ *
+ * The point goes out with this cycle's batch; the window is restarted once it
+ * is queued, so a point that cannot be sent is stored offline like any other.
+ */
+static void publish_perf_stats(void) {
+    uint32_t cycles = perf_profiler_window_cycles();
+    if (cycles < PERF_PUBLISH_EVERY_N_CYCLES) {
+        return;
+    }
+    
+    influxdb_perf_data_t perf = {
+        .timestamp_ns = esp_utils_get_timestamp_ms() * 1000000ULL,
+        .cycles = cycles,
+    };
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(perf.device_id, sizeof(perf.device_id), "ESP32_%02X%02X%02X%02X%02X%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    strncpy(perf.firmware, esp_app_get_description()->version, sizeof(perf.firmware) - 1);
+    
+    for (int p = 0; p < PERF_PHASE_COUNT && perf.phase_count < INFLUXDB_PERF_MAX_PHASES; p++) {
+        const perf_phase_stats_t* st = perf_profiler_get((perf_phase_t)p);
+        if (st->count == 0) {
+            continue;   // Phase did not run in this window (e.g. NTP disabled)
+        }
+        influxdb_perf_phase_t* out = &perf.phases[perf.phase_count++];
+        out->name = perf_phase_name((perf_phase_t)p);
+        out->avg_ms = (float)st->sum_us / (float)st->count / 1000.0f;
+        out->max_ms = (float)st->max_us / 1000.0f;
+    }
+    
+    if (influx_sender_enqueue_perf(&perf) == ESP_OK) {
+        ESP_LOGI(TAG, "Queued device_perf over %lu cycles", (unsigned long)cycles);
+        perf_profiler_reset_window();
+    }
+}
+#endif
+
+#if USE_INFLUXDB && RESOURCE_TRACKER_PUBLISH
+/**
+ * @brief Queue the worst-case heap and stack use every few cycles
+ *
+ * The values cover everything since power-on; only the report interval restarts.
+ */
+static void publish_resource_stats(void) {
+    if (resource_tracker_cycles_since_report() < RESOURCE_PUBLISH_EVERY_N_CYCLES) {
+        return;
+    }
+    
+    influxdb_resource_data_t res = {
+        .timestamp_ns = esp_utils_get_timestamp_ms() * 1000000ULL,
+        .heap_min_free = resource_tracker_heap_min_free(),
+    };
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(res.device_id, sizeof(res.device_id), "ESP32_%02X%02X%02X%02X%02X%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    strncpy(res.firmware, esp_app_get_description()->version, sizeof(res.firmware) - 1);
+    
+    for (int t = 0; t < RESOURCE_TASK_COUNT && res.task_count < INFLUXDB_RESOURCE_MAX_TASKS; t++) {
+        const resource_task_stats_t* st = resource_tracker_task((resource_task_t)t);
+        if (st->stack_size == 0 || st->stack_min_free == UINT32_MAX) {
+            continue;   // Task never ran (feature disabled)
+        }
+        influxdb_task_stack_t* out = &res.tasks[res.task_count++];
+        out->name = resource_task_name((resource_task_t)t);
+        out->stack_size = st->stack_size;
+        out->stack_min_free = st->stack_min_free;
+    }
+    for (int p = 0; p < RESOURCE_POINT_COUNT && res.point_count < INFLUXDB_RESOURCE_MAX_POINTS; p++) {
+        const resource_point_stats_t* st = resource_tracker_point((resource_point_t)p);
+        if (st->free_min == 0) {
+            continue;
+        }
+        influxdb_heap_point_t* out = &res.points[res.point_count++];
+        out->name = resource_point_name((resource_point_t)p);
+        out->free_min = st->free_min;
+        out->largest_min = st->largest_min;
+        out->blocks_max = st->blocks_max;
+    }
+    
+    if (influx_sender_enqueue_resources(&res) == ESP_OK) {
+        resource_tracker_log_report();
+        resource_tracker_mark_reported();
+    }
+}
+#endif
+
+#if CONFIG_APP_SOIL_LP_POWER
+/**
+ * @brief Let the LP core warm the soil sensor up for the next wake
+ *
+ * Armed only when the next wake samples the soil; otherwise a program left
+ * from an earlier sleep is stopped and the supply switched off.
+ */
+static void arm_soil_lp_power(uint32_t sleep_ms) {
+    if ((cycle_scheduler_plan_upcoming(sleep_ms) & CYCLE_JOB_SOIL) && sleep_ms > CSM_V2_WARMUP_MS &&
+        csm_v2_lp_power_arm(SOIL_SENSOR_POWER_PIN, sleep_ms - CSM_V2_WARMUP_MS) == ESP_OK) {
+        return;
+    }
+    if (csm_v2_lp_power_release(SOIL_SENSOR_POWER_PIN)) {
+        gpio_set_level(SOIL_SENSOR_POWER_PIN, 0);
+    }
+}
+#endif
+
+static void enter_deep_sleep(uint32_t duration_ms) {
     if (!DEEP_SLEEP_ENABLED) {
-        ESP_LOGI(TAG, "Deep sleep disabled, waiting %lu seconds before next cycle...", duration_seconds);
-        vTaskDelay(pdMS_TO_TICKS(duration_seconds * 1000));
+        ESP_LOGI(TAG, "Deep sleep disabled, %s %lu ms before next cycle...",
+                 power_mode_light_sleep_active() ? "light sleeping" : "waiting", (unsigned long)duration_ms);
+        vTaskDelay(pdMS_TO_TICKS(duration_ms));
         return;  // Return to loop
     }
     
-    uint64_t sleep_time_us = (uint64_t)duration_seconds * 1000000ULL;
+    uint64_t sleep_time_us = (uint64_t)duration_ms * 1000ULL;
     esp_sleep_enable_timer_wakeup(sleep_time_us);
     
-    ESP_LOGI(TAG, "Entering deep sleep for %lu seconds...", duration_seconds);
+    ESP_LOGI(TAG, "Entering deep sleep for %lu ms...", (unsigned long)duration_ms);
     ESP_LOGI(TAG, "============================================");
     
     vTaskDelay(pdMS_TO_TICKS(DEEP_SLEEP_WAKEUP_DELAY_MS));
     esp_deep_sleep_start();
 }
 
-static esp_err_t init_system(void) {
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+#if ENABLE_WIFI
+/**
+ * @brief Decide whether this wake brings up WiFi
+ *
+ * With deferred upload only every Nth timer wake (or a wake that finds the
+ * sample store filling up) connects; a reset always does.
+ */
+static bool radio_wanted(void) {
+#if DEFERRED_UPLOAD_ENABLED && USE_INFLUXDB
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP &&
+        !sample_store_upload_due(DEFERRED_UPLOAD_EVERY_N_WAKES, DEFERRED_UPLOAD_FILL_PERCENT)) {
+        return false;
     }
-    ESP_ERROR_CHECK(ret);
-    ESP_LOGI(TAG, "NVS initialized");
-    
+#endif
+    return true;
+}
+#endif
+
+// ============================================================================
+// Components (brought up the first time a cycle needs them)
+// ============================================================================
+
+typedef enum {
+    COMP_NET = 0,       // Network stack and default event loop
+    COMP_WIFI,          // WiFi manager, association started
+    COMP_INFLUX,        // InfluxDB sender
+    COMP_MQTT,          // MQTT sender
+    COMP_GATEWAY,       // ESP-NOW gateway receive path
+    COMP_LEAF,          // ESP-NOW leaf link
+    COMP_BATTERY,       // Battery monitor
+    COMP_ENV,           // Environment monitor (AHT20)
+    COMP_SOIL,          // Soil monitor
+    COMP_DISPLAY,       // ePaper display and its task
+    COMP_COUNT
+} component_t;
+
+#define COMP(c)         INIT_GRAPH_BIT(c)
+#define COMP_RADIO      (COMP(COMP_WIFI) | COMP(COMP_INFLUX) | COMP(COMP_MQTT) | COMP(COMP_GATEWAY))
+
 #if ENABLE_WIFI
-    // Initialize network stack (only needed for WiFi/InfluxDB)
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    ESP_LOGI(TAG, "Network stack initialized");
-    
-    // Initialize and connect WiFi
+static esp_err_t init_net(void) {
+    // Only needed for WiFi/InfluxDB
+    esp_err_t ret = esp_netif_init();
+    if (ret == ESP_OK) {
+        ret = esp_event_loop_create_default();
+    }
+    return ret;
+}
+
+static esp_err_t init_wifi(void) {
     wifi_manager_config_t wifi_config = {
         .ssid = WIFI_SSID,
         .password = WIFI_PASSWORD,
-        .max_retry = WIFI_MAX_RETRY
+        .max_retry = WIFI_MAX_RETRY,
+        .power_save = !DEEP_SLEEP_ENABLED && CONTINUOUS_LIGHT_SLEEP_ENABLED,
+        .listen_interval = WIFI_LISTEN_INTERVAL,
     };
-    ESP_ERROR_CHECK(wifi_manager_init(&wifi_config, wifi_status_cb));
-    ESP_LOGI(TAG, "WiFi Manager initialized");
-    
-    ret = wifi_manager_connect();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi connection failed!");
-        return ret;
-    }
-    ESP_LOGI(TAG, "WiFi connected successfully");
-    
-    // Initialize InfluxDB sender
-    if (USE_INFLUXDB) {
-        ESP_ERROR_CHECK(influx_sender_init());
-        ESP_LOGI(TAG, "InfluxDB sender initialized");
+    esp_err_t ret = wifi_manager_init(&wifi_config, wifi_status_cb);
+    if (ret == ESP_OK) {
+        // Associate in the background; the cycle joins on the result together with the sensors
+        ret = wifi_manager_connect_start();
     }
-    
-    // Initialize MQTT sender
-    if (USE_MQTT) {
-        ESP_ERROR_CHECK(mqtt_sender_init());
-        ESP_LOGI(TAG, "MQTT sender initialized");
+    if (ret != ESP_OK) {
+        cycle_scheduler_job_done(CYCLE_JOB_WIFI);   // Given up: do not hold the cycle
     }
-#else
-    ESP_LOGI(TAG, "WiFi disabled - running in offline mode");
+    return ret;
+}
+
+#if USE_INFLUXDB
+static esp_err_t init_influx(void) {
+    // Batches are held or stored offline until WiFi is up
+    return influx_sender_init();
+}
 #endif
-    
-    return ESP_OK;
+
+#if USE_MQTT
+static esp_err_t init_mqtt(void) {
+    // Connects to the broker once WiFi is up
+    return mqtt_sender_init();
 }
+#endif
+
+#if ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY
+static esp_err_t init_gateway(void) {
+    // Leaf batches are republished on this node's bus and uploaded with its own points
+    return espnow_link_start_gateway();
+}
+#endif
+#elif ESPNOW_ROLE == ESPNOW_ROLE_LEAF
+static esp_err_t init_leaf(void) {
+    return espnow_link_start_leaf();
+}
+#endif
 
-static esp_err_t init_sensors(void) {
-    esp_err_t ret = ESP_OK;
-    
 #if ENABLE_BATTERY_MONITOR
-    ESP_LOGI(TAG, "Battery Monitor enabled (init handled by task)");
+static esp_err_t init_battery(void) {
+    return battery_monitor_register(BATTERY_MEASUREMENTS_PER_CYCLE);
+}
 #endif
 
 #if ENABLE_ENV_MONITOR
-    ESP_LOGI(TAG, "Initializing Environment Monitor (AHT20)...");
+static esp_err_t init_env(void) {
     env_monitor_config_t env_config;
     env_monitor_get_default_config(&env_config);
-    ret = env_monitor_init(&env_app, &env_config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "ENV monitor init failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    ESP_LOGI(TAG, "Environment Monitor initialized");
+    return env_monitor_init(&env_app, &env_config);
+}
 #endif
 
 #if ENABLE_SOIL_MONITOR
-    ESP_LOGI(TAG, "Initializing Soil Monitor...");
+static esp_err_t init_soil(void) {
     soil_monitor_config_t soil_config;
     soil_monitor_get_default_config(&soil_config);
     soil_config.measurements_per_cycle = SOIL_MEASUREMENTS_PER_CYCLE;
-    
-    ret = soil_monitor_init(&soil_app, &soil_config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize soil monitor: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    ESP_LOGI(TAG, "Soil Monitor initialized");
+    return soil_monitor_init(&soil_app, &soil_config);
+}
 #endif
 
 #if ENABLE_EPAPER_DISPLAY
-    ESP_LOGI(TAG, "Initializing ePaper Display (1.54\" 200x200)...");
+static esp_err_t init_display(void) {
     epaper_display_config_t epaper_config;
     epaper_display_get_default_config(&epaper_config);
     
-    ret = epaper_display_init(&epaper_app, &epaper_config);
+    esp_err_t ret = epaper_display_init(&epaper_app, &epaper_config);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize ePaper display: %s", esp_err_to_name(ret));
         return ret;
     }
-    ESP_LOGI(TAG, "ePaper Display initialized");
+    return epaper_display_start(&epaper_app);
+}
 #endif
 
 #if !ENABLE_ENV_MONITOR && !ENABLE_BATTERY_MONITOR && !ENABLE_SOIL_MONITOR && !ENABLE_EPAPER_DISPLAY
     #error "At least one monitor or display must be enabled!"
 #endif
 
+// Disabled components are left out: without an init function they count as up
+static const init_graph_node_t s_components[COMP_COUNT] = {
+#if ENABLE_WIFI
+    [COMP_NET]      = { "net",      init_net,       0 },
+    [COMP_WIFI]     = { "wifi",     init_wifi,      COMP(COMP_NET) },
+#if USE_INFLUXDB
+    [COMP_INFLUX]   = { "influx",   init_influx,    COMP(COMP_NET) },
+#endif
+#if USE_MQTT
+    [COMP_MQTT]     = { "mqtt",     init_mqtt,      COMP(COMP_NET) },
+#endif
+#if ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY
+    [COMP_GATEWAY]  = { "gateway",  init_gateway,   COMP(COMP_WIFI) },
+#endif
+#elif ESPNOW_ROLE == ESPNOW_ROLE_LEAF
+    [COMP_LEAF]     = { "leaf",     init_leaf,      0 },
+#endif
+#if ENABLE_BATTERY_MONITOR
+    [COMP_BATTERY]  = { "battery",  init_battery,   0 },
+#endif
+#if ENABLE_ENV_MONITOR
+    [COMP_ENV]      = { "env",      init_env,       0 },
+#endif
+#if ENABLE_SOIL_MONITOR
+    [COMP_SOIL]     = { "soil",     init_soil,      0 },
+#endif
+#if ENABLE_EPAPER_DISPLAY
+    [COMP_DISPLAY]  = { "display",  init_display,   0 },
+#endif
+};
+
+// Monitors of the sensor jobs in due
+static uint32_t sensor_components(EventBits_t due) {
+    uint32_t comps = 0;
+    if (due & CYCLE_JOB_BATTERY) {
+        comps |= COMP(COMP_BATTERY);
+    }
+    if (due & CYCLE_JOB_ENV) {
+        comps |= COMP(COMP_ENV);
+    }
+    if (due & CYCLE_JOB_SOIL) {
+        comps |= COMP(COMP_SOIL);
+    }
+    return comps;
+}
+
+#if ENABLE_WIFI
+// Start WiFi and the senders in the background; association reports CYCLE_JOB_WIFI
+static void start_radio(void) {
+    influx_sender_set_deferred(false);
+    s_radio_on = true;
+    init_graph_start(COMP_RADIO);
+}
+#endif
+
+static esp_err_t init_system(void) {
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_LOGI(TAG, "NVS initialized");
+    
+#if !DEEP_SLEEP_ENABLED && CONTINUOUS_LIGHT_SLEEP_ENABLED
+    // Light sleep while idle between cycles; each cycle holds the full clock
+    const power_mode_config_t power_config = {
+        .max_freq_mhz = CONTINUOUS_CPU_MAX_FREQ_MHZ,
+        .min_freq_mhz = CONTINUOUS_CPU_MIN_FREQ_MHZ,
+        .light_sleep = true,
+    };
+    if (power_mode_init(&power_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Power management not available, idling at full power");
+    }
+#endif
+    
+    ESP_ERROR_CHECK(cycle_scheduler_init());
+    const cycle_plan_config_t plan_config = {
+        .battery_interval_s = ENABLE_BATTERY_MONITOR ? SCHEDULE_BATTERY_INTERVAL_S : 0,
+        .env_interval_s = ENABLE_ENV_MONITOR ? SCHEDULE_ENV_INTERVAL_S : 0,
+        .soil_interval_s = ENABLE_SOIL_MONITOR ? SCHEDULE_SOIL_INTERVAL_S : 0,
+        .idle_interval_s = DEEP_SLEEP_DURATION_SECONDS,
+        .stretch_2x_below_v = SCHEDULE_STRETCH_2X_BELOW_V,
+        .stretch_4x_below_v = SCHEDULE_STRETCH_4X_BELOW_V,
+        .early_ms = SCHEDULE_EARLY_WAKE_MS,
+        .phase_ms = UPLOAD_SLOT_ENABLED ? upload_slot_init(DEEP_SLEEP_DURATION_SECONDS * 1000UL) : 0,
+    };
+    cycle_scheduler_plan_init(&plan_config);
+    ESP_ERROR_CHECK(sample_store_init());
+    ESP_ERROR_CHECK(telemetry_init());
+    
+    // Radio, sensors and display are started by the cycles that need them
+    ESP_ERROR_CHECK(init_graph_setup(s_components, COMP_COUNT));
+#if !ENABLE_WIFI && ESPNOW_ROLE == ESPNOW_ROLE_LEAF
+    ESP_LOGI(TAG, "ESP-NOW leaf mode - samples go to the gateway");
+#elif !ENABLE_WIFI
+    ESP_LOGI(TAG, "WiFi disabled - running in offline mode");
+#endif
+    
     return ESP_OK;
 }
 
@@ -280,6 +563,7 @@ static void run_partial_refresh_demo(void) {
         
         uint32_t start_time = esp_timer_get_time() / 1000;
         epaper_display_update_data(&epaper_app, temp, hum, soil, batt);
+        epaper_display_wait(&epaper_app);
         uint32_t duration = (esp_timer_get_time() / 1000) - start_time;
         
         ESP_LOGI(TAG, "Update took %lu ms", duration);
@@ -317,95 +601,189 @@ static void run_partial_refresh_demo(void) {
 // Monitoring Cycle
 // ============================================================================
 
-static esp_err_t run_measurement_cycle(void) {
+static esp_err_t run_measurement_cycle(EventBits_t due) {
     esp_err_t ret = ESP_OK;
     
     ESP_LOGI(TAG, "--- Starting Measurement Cycle ---");
+    perf_profiler_cycle_begin();
     
-#if ENABLE_BATTERY_MONITOR
-    // Battery monitor task handles everything internally
-    ESP_LOGI(TAG, "Starting battery monitor task...");
-    ret = battery_monitor_start(BATTERY_MEASUREMENTS_PER_CYCLE);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start battery monitor: %s", esp_err_to_name(ret));
-        return ret;
+    // Bring up only what this cycle uses: the monitors of the due sensors and the sinks
+    // their readings go to. WiFi starts with them and keeps associating in the background.
+    uint32_t needed = sensor_components(due) | COMP(COMP_LEAF);
+#if ENABLE_WIFI
+    if (!s_radio_on) {
+        if (radio_wanted()) {
+            start_radio();
+        } else {
+            // Sensor-only wake: points stay in RTC memory until the radio is due
+            influx_sender_set_deferred(true);
+            ESP_LOGI(TAG, "Sensor-only wake (%lu points held in RTC memory)",
+                     (unsigned long)sample_store_count());
+        }
     }
-    
-    // Wait for battery monitoring to complete
-    ret = battery_monitor_wait_for_completion(30000);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Battery monitor timeout: %s", esp_err_to_name(ret));
+    if (s_radio_on) {
+        needed |= COMP(COMP_INFLUX) | COMP(COMP_MQTT);
     }
 #endif
-
-#if ENABLE_ENV_MONITOR
-    ESP_LOGI(TAG, "Starting environment monitor task...");
-    ret = env_monitor_start(&env_app);
+    perf_phase_begin(PERF_PHASE_SENSORS);
+    ret = init_graph_require(needed, INIT_TIMEOUT_MS);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start environment monitor: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGW(TAG, "Components of this cycle not all up (%s), failed ones are skipped",
+                 esp_err_to_name(ret));
     }
     
-    // Wait for environment monitoring to complete
-    ret = env_monitor_wait_for_completion(&env_app, 30000);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Environment monitor timeout: %s", esp_err_to_name(ret));
+    // Arm the barrier with every job that is due and finishes on its own this cycle
+    EventBits_t sensor_jobs = sensor_runtime_jobs(due);
+    EventBits_t jobs = sensor_jobs;
+#if ENABLE_WIFI
+    if (s_radio_on) {
+        jobs |= CYCLE_JOB_WIFI;
+    }
+#endif
+    cycle_scheduler_begin(jobs);
+    
+#if ENABLE_WIFI
+    // A result reported before the barrier was armed: already connected, given up or not started
+    if (s_radio_on && (init_graph_failed(COMP(COMP_WIFI)) ||
+                       (init_graph_up(COMP(COMP_WIFI)) && wifi_manager_get_status() != WIFI_STATUS_CONNECTING))) {
+        cycle_scheduler_job_done(CYCLE_JOB_WIFI);
     }
 #endif
 
-#if ENABLE_SOIL_MONITOR
-    ESP_LOGI(TAG, "Starting soil monitor task...");
-    ret = soil_monitor_start(&soil_app);
+    // One pass over all due sensors: their warm-up overlaps with WiFi association
+    ret = sensor_runtime_start(due);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start soil monitor: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Failed to start sensor pass: %s", esp_err_to_name(ret));
+        cycle_scheduler_job_done(sensor_jobs);
     }
-    
-    // Wait for soil monitoring to complete
-    ret = soil_monitor_wait_for_completion(&soil_app, 30000);
+
+    // Single barrier: the cycle takes as long as the slowest job
+    EventBits_t pending = 0;
+    ret = cycle_scheduler_join(CYCLE_DEADLINE_MS, &pending);
+    perf_phase_end(PERF_PHASE_SENSORS);
+    resource_tracker_checkpoint(RESOURCE_POINT_SENSORS);
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Soil monitor timeout: %s", esp_err_to_name(ret));
+        ESP_LOGW(TAG, "Cycle jobs not finished in time (pending 0x%02lx)", (unsigned long)pending);
+        // A sensor still measuring would keep its supply on and race the next cycle's pass
+        if (sensor_runtime_stop(SENSOR_STOP_TIMEOUT_MS) != ESP_OK) {
+            ESP_LOGW(TAG, "Sensor pass did not stop");
+        }
     }
-#endif
     
-    // Wait for InfluxDB transmission to complete
-    if (USE_INFLUXDB) {
-        ESP_LOGI(TAG, "Waiting for InfluxDB transmission...");
-        ret = influx_sender_wait_until_empty(10000);
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "InfluxDB queue not empty: %s", esp_err_to_name(ret));
-        } else {
-            ESP_LOGI(TAG, "Data sent successfully");
-        }
+#if ENABLE_WIFI
+    // A reading that tripped a deadband/rate trigger is worth an early connect
+    if (!s_radio_on && report_policy_alarm_raised()) {
+        ESP_LOGI(TAG, "Report alarm on a sensor-only wake, starting WiFi");
+        cycle_scheduler_begin(CYCLE_JOB_WIFI);
+        start_radio();
+        init_graph_wait(COMP_RADIO, INIT_TIMEOUT_MS);
+        cycle_scheduler_join(WIFI_CONNECT_TIMEOUT_MS, NULL);    // A WiFi that failed to start has given up
     }
+#endif
+    ESP_LOGI(TAG, "Sensors done, WiFi %s", wifi_manager_is_connected() ? "connected" : "offline");
+    
+#if USE_INFLUXDB && PERF_PROFILER_PUBLISH
+    publish_perf_stats();
+#endif
+#if USE_INFLUXDB && RESOURCE_TRACKER_PUBLISH
+    publish_resource_stats();
+#endif
     
 #if ENABLE_EPAPER_DISPLAY
-    // Update ePaper display with latest sensor data
+    // Update ePaper display with latest sensor data (NAN: not read this wake, the panel keeps its value)
     ESP_LOGI(TAG, "Updating ePaper display...");
-    float temp = 0, hum = 0, soil = 0, batt = 0;
+    float temp = NAN, hum = NAN, soil = NAN, batt = NAN;
     
     #if ENABLE_ENV_MONITOR
         // Get temperature and humidity from env monitor
-        env_monitor_get_last_reading(&env_app, &temp, &hum);
+        if (due & CYCLE_JOB_ENV) {
+            env_monitor_get_last_reading(&env_app, &temp, &hum);
+        }
     #endif
     
     #if ENABLE_SOIL_MONITOR
         float soil_voltage = 0;
-        soil_monitor_get_last_reading(&soil_app, &soil_voltage, &soil);
+        if (due & CYCLE_JOB_SOIL) {
+            soil_monitor_get_last_reading(&soil_app, &soil_voltage, &soil);
+        }
     #endif
     
     #if ENABLE_BATTERY_MONITOR
-        battery_monitor_get_last_voltage(&batt);
+        if (due & CYCLE_JOB_BATTERY) {
+            battery_monitor_get_last_voltage(&batt);
+        }
     #endif
     
-    // epaper_display_update_data already calls epaper_update internally
-    ret = epaper_display_update_data(&epaper_app, temp, hum, soil, batt);
+    // The panel keeps its image across deep sleep: the display is only brought up to change it.
+    // The display task renders and refreshes while the senders transmit.
+    if (epaper_display_needs_refresh(temp, hum, soil, batt)) {
+        ret = init_graph_require(COMP(COMP_DISPLAY), INIT_TIMEOUT_MS);
+        if (ret == ESP_OK) {
+            ret = epaper_display_request_update(&epaper_app, temp, hum, soil, batt);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Display update request failed: %s", esp_err_to_name(ret));
+        }
+    } else {
+        ESP_LOGI(TAG, "Shown values unchanged, display left off");
+    }
+#endif
+    
+    // Wait for InfluxDB transmission to complete
+    perf_phase_begin(PERF_PHASE_TX_WAIT);
+#if ENABLE_WIFI
+    bool radio_on = s_radio_on;
+#else
+    bool radio_on = false;
+#endif
+    if (USE_INFLUXDB && radio_on) {
+        ESP_LOGI(TAG, "Waiting for InfluxDB transmission...");
+        ret = influx_sender_wait_until_empty(10000);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "InfluxDB queue not empty: %s", esp_err_to_name(ret));
+        } else {
+            influx_sender_stats_t stats;
+            influx_sender_get_stats(&stats);
+            ESP_LOGI(TAG, "InfluxDB transmission done (%lu points written, %lu stored offline)",
+                     (unsigned long)stats.points_written, (unsigned long)stats.points_stored);
+        }
+    }
+
+#if ENABLE_MQTT
+    // Also offline: the flush is what moves the cycle's snapshot to the outbox
+    if (USE_MQTT && init_graph_up(COMP(COMP_MQTT))) {
+        ret = mqtt_sender_wait_until_empty(10000);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "MQTT queue not empty: %s", esp_err_to_name(ret));
+        }
+    }
+#endif
+
+#if ESPNOW_ROLE == ESPNOW_ROLE_LEAF
+    ret = espnow_link_flush();
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Display update failed: %s", esp_err_to_name(ret));
+        ESP_LOGW(TAG, "ESP-NOW batch not delivered: %s", esp_err_to_name(ret));
+    }
+#endif
+    perf_phase_end(PERF_PHASE_TX_WAIT);
+    resource_tracker_checkpoint(RESOURCE_POINT_TX);
+    
+#if ENABLE_EPAPER_DISPLAY
+    // Sleep gate: the panel must be idle before the supply goes away
+    if (init_graph_up(COMP(COMP_DISPLAY))) {
+        ret = epaper_display_wait_idle(&epaper_app, EPAPER_DISPLAY_TIMEOUT_MS);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Display refresh not finished: %s", esp_err_to_name(ret));
+        }
     }
 #endif
     
-    ESP_LOGI(TAG, "--- Measurement Cycle Complete ---\n");
+    sample_store_note_wake(radio_on);
+    perf_profiler_cycle_done();
+    resource_tracker_cycle_done();
+    event_counters_report(TAG);
+    ESP_LOGI(TAG, "--- Measurement Cycle Complete (awake %lu ms) ---\n",
+             (unsigned long)(perf_profiler_get(PERF_PHASE_AWAKE)->last_us / 1000));
     return ESP_OK;
 }
 
@@ -414,6 +792,19 @@ static esp_err_t run_measurement_cycle(void) {
 // ============================================================================
 
 void app_main(void) {
+    // First: points stamped during init already need the restored clock state
+    const time_service_config_t time_config = {
+        .resync_interval_s = TIME_RESYNC_INTERVAL_S,
+        .max_error_ms = TIME_MAX_ERROR_MS,
+        .assumed_drift_ppm = TIME_ASSUMED_DRIFT_PPM,
+    };
+    time_service_init(&time_config);
+    perf_profiler_init();
+    resource_tracker_init();
+    resource_tracker_task_enter(RESOURCE_TASK_MAIN, CONFIG_ESP_MAIN_TASK_STACK_SIZE);
+    report_policy_init();
+    sample_aggregator_init();
+    
     ESP_LOGI(TAG, "====================================");
     ESP_LOGI(TAG, "=== ESP32 Sensor Monitor v2.0 ===");
     ESP_LOGI(TAG, "====================================");
@@ -430,7 +821,8 @@ void app_main(void) {
     ESP_LOGI(TAG, "  - ePaper Display: ENABLED (1.54\", 200x200)");
 #endif
 #if DEEP_SLEEP_ENABLED
-    ESP_LOGI(TAG, "  - Deep Sleep: ENABLED (%ds cycles)", DEEP_SLEEP_DURATION_SECONDS);
+    ESP_LOGI(TAG, "  - Deep Sleep: ENABLED (env %ds, soil %ds, battery %ds)",
+             SCHEDULE_ENV_INTERVAL_S, SCHEDULE_SOIL_INTERVAL_S, SCHEDULE_BATTERY_INTERVAL_S);
 #else
     ESP_LOGI(TAG, "  - Deep Sleep: DISABLED (continuous loop)");
 #endif
@@ -440,6 +832,7 @@ void app_main(void) {
     log_wakeup_reason();
     
     // Initialize system (only once)
+    perf_phase_begin(PERF_PHASE_INIT);
     ESP_LOGI(TAG, "Initializing system...");
     if (init_system() != ESP_OK) {
         ESP_LOGE(TAG, "System initialization failed! Retrying in 60s...");
@@ -448,15 +841,8 @@ void app_main(void) {
         return;
     }
     
-    // Initialize sensors (only once), inits battery, env, soil monitors as needed
-    ESP_LOGI(TAG, "Initializing sensors...");
-    if (init_sensors() != ESP_OK) { 
-        ESP_LOGE(TAG, "Sensor initialization failed! Retrying in 60s...");
-        vTaskDelay(pdMS_TO_TICKS(60000));
-        esp_restart();
-        return;
-    }
-    
+    perf_phase_end(PERF_PHASE_INIT);
+    resource_tracker_checkpoint(RESOURCE_POINT_INIT);
     ESP_LOGI(TAG, "System ready!\n");
 
 #if ENABLE_EPAPER_DISPLAY
@@ -477,10 +863,46 @@ void app_main(void) {
     
     // Main measurement loop
     while (1) {
-        run_measurement_cycle();
+        power_mode_busy_begin();
+        EventBits_t due = cycle_scheduler_plan_due();
+        run_measurement_cycle(due);
+#if ENABLE_BATTERY_MONITOR
+        // Protection shutdown after the cycle has sent the low reading
+        if (battery_monitor_is_critical()) {
+            ESP_LOGW(TAG, "Battery protection: entering deep sleep until a manual reset");
+            battery_monitor_deinit();
+            vTaskDelay(pdMS_TO_TICKS(DEEP_SLEEP_WAKEUP_DELAY_MS));
+            esp_deep_sleep_start();
+        }
+#endif
         
-        // Sleep or delay before next cycle
-        enter_deep_sleep(DEEP_SLEEP_DURATION_SECONDS);
+        // Sleep or delay until the next deadline of the wake plan
+        float batt = NAN;
+#if ENABLE_BATTERY_MONITOR
+        if (due & CYCLE_JOB_BATTERY) {
+            battery_monitor_get_last_voltage(&batt);
+        }
+#endif
+#if UPLOAD_SLOT_ENABLED && USE_INFLUXDB
+        // A crowded or backend-assigned slot moves the whole grid
+        if (s_radio_on) {
+            influx_sender_stats_t stats;
+            influx_sender_get_stats(&stats);
+            int64_t shift_ms = upload_slot_update(&stats);
+            if (shift_ms != 0) {
+                cycle_scheduler_plan_shift(shift_ms);
+            }
+        }
+#endif
+        uint32_t sleep_ms = cycle_scheduler_plan_next(batt);
+        resource_tracker_checkpoint(RESOURCE_POINT_SLEEP);
+        power_mode_busy_end();
+#if CONFIG_APP_SOIL_LP_POWER
+        if (DEEP_SLEEP_ENABLED) {
+            arm_soil_lp_power(sleep_ms);
+        }
+#endif
+        enter_deep_sleep(sleep_ms);
         
         // If deep sleep is enabled, we never reach here (device resets)
         // If disabled, loop continues after delay
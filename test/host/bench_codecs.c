@@ -0,0 +1,207 @@
+/**
+ * @file bench_codecs.c
+ * @brief Host benchmark of the encoders, buffers and e-paper text path
+ *
+ * Host runner for the cases in main/01_testing/bench_cases.c, which
+ * encoder_bench_main.c runs on the board. The InfluxDB batch case is left
+ * out (BENCH_BATCH_CASES); the HTTP buffer case runs on a RAM partition from
+ * stubs/idf_stubs.c (BENCH_FLASH_CASES).
+ *
+ * Every case runs on its own thread with a painted stack and reports time per
+ * iteration, throughput, heap allocations per iteration (malloc, calloc and
+ * realloc are wrapped at link time) and peak stack above an empty case.
+ *
+ *   bench_codecs [iterations]
+ *
+ * Exits non-zero if a case fails.
+ */
+
+#include "bench_cases.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_ITERATIONS    10000
+#define BENCH_STACK_SIZE            (256 * 1024)
+#define BENCH_STACK_FILL            0xA5
+#define BENCH_STACK_MARGIN          128     // Left unpainted below the painter (memset, red zone)
+
+// ============================================================================
+// Allocation counting (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc)
+// ============================================================================
+
+static volatile bool s_counting = false;
+static unsigned long s_allocs = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if (s_counting) {
+        s_allocs++;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    if (s_counting) {
+        s_allocs++;
+    }
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (s_counting) {
+        s_allocs++;
+    }
+    return __real_realloc(ptr, size);
+}
+
+typedef struct {
+    int64_t elapsed_us;             // All iterations
+    size_t bytes;                   // Output of one iteration
+    unsigned long allocs;           // Heap allocations over all iterations
+    size_t peak_stack;              // Bytes of stack touched below the runner
+    bool ok;
+} bench_result_t;
+
+static int s_iterations = BENCH_DEFAULT_ITERATIONS;
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+static size_t bench_empty(void *ctx)
+{
+    return 1;
+}
+
+static const bench_case_t s_baseline = { "empty", NULL, bench_empty, NULL, NULL };
+
+static struct {
+    const bench_case_t *bench;
+    uint8_t *stack;
+    bench_result_t result;
+} s_run;
+
+// Paint the unused stack below the caller; returns the painted size
+static size_t bench_stack_paint(void)
+{
+    uint8_t here;
+    size_t painted = (size_t)(&here - s_run.stack) - BENCH_STACK_MARGIN;
+    memset(s_run.stack, BENCH_STACK_FILL, painted);
+    return painted;
+}
+
+// The stack grows down: the lowest overwritten byte marks the peak below the painted top
+static size_t bench_stack_used(size_t painted)
+{
+    size_t untouched = 0;
+    while (untouched < painted && s_run.stack[untouched] == BENCH_STACK_FILL) {
+        untouched++;
+    }
+    return painted - untouched;
+}
+
+static void *bench_thread(void *arg)
+{
+    const bench_case_t *bench = s_run.bench;
+    bench_result_t *res = &s_run.result;
+    // Thread start-up in libc is not part of the case
+    size_t painted = bench_stack_paint();
+
+    if (bench->setup != NULL && bench->setup(bench->ctx) != ESP_OK) {
+        return NULL;
+    }
+
+    // Warm-up: first-use allocations stay out of the numbers
+    res->bytes = bench->run(bench->ctx);
+    res->ok = res->bytes > 0;
+
+    s_allocs = 0;
+    s_counting = true;
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < s_iterations && res->ok; i++) {
+        res->ok = bench->run(bench->ctx) > 0;
+    }
+    res->elapsed_us = esp_timer_get_time() - start_us;
+    s_counting = false;
+    res->allocs = s_allocs;
+    res->peak_stack = bench_stack_used(painted);
+
+    if (bench->teardown != NULL) {
+        bench->teardown(bench->ctx);
+    }
+    return NULL;
+}
+
+// Runs one case on its own thread stack, so the touched bytes are the case's own
+static bool bench_run(const bench_case_t *bench, uint8_t *stack)
+{
+    memset(&s_run.result, 0, sizeof(s_run.result));
+    s_run.bench = bench;
+    s_run.stack = stack;
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, BENCH_STACK_SIZE);
+    bool started = pthread_create(&thread, &attr, bench_thread, NULL) == 0;
+    pthread_attr_destroy(&attr);
+    if (!started) {
+        return false;
+    }
+    pthread_join(thread, NULL);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        s_iterations = atoi(argv[1]);
+        if (s_iterations <= 0) {
+            fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (host_partition_add("httplog", 16 * 4096) != ESP_OK) {
+        fprintf(stderr, "Failed to create the httplog partition\n");
+        return 1;
+    }
+
+    uint8_t *stack = malloc(BENCH_STACK_SIZE);
+    if (stack == NULL || !bench_run(&s_baseline, stack)) {
+        fprintf(stderr, "Failed to start the benchmark thread\n");
+        return 1;
+    }
+    size_t base_stack = s_run.result.peak_stack;
+
+    int failures = 0;
+    printf("%d iterations per case, stack above an empty case (%zu bytes)\n", s_iterations, base_stack);
+    printf("%-16s %10s %10s %8s %8s %7s\n", "case", "us/iter", "KB/s", "bytes", "allocs", "stack");
+    for (size_t i = 0; i < bench_case_count; i++) {
+        const bench_case_t *bench = &bench_cases[i];
+        if (!bench_run(bench, stack) || !s_run.result.ok) {
+            printf("%-16s failed\n", bench->name);
+            failures++;
+            continue;
+        }
+        const bench_result_t *res = &s_run.result;
+        double us_per_iter = (double)res->elapsed_us / s_iterations;
+        double kb_per_s = us_per_iter > 0.0 ? (res->bytes / 1024.0) * (1000000.0 / us_per_iter) : 0.0;
+        size_t stack_used = res->peak_stack > base_stack ? res->peak_stack - base_stack : 0;
+        printf("%-16s %10.3f %10.1f %8zu %8.2f %7zu\n", bench->name, us_per_iter, kb_per_s,
+               res->bytes, (double)res->allocs / s_iterations, stack_used);
+    }
+
+    free(stack);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+// Host stand-in for main/config/esp32-config.h: only the values the
+// host-built sources read, as in the firmware configuration
+#pragma once
+
+#define STATIC_ALLOCATION_ENABLED       1
+#define HTTP_BUFFER_POOL_SLOTS          2
+#define HTTP_BUFFER_PARTITION           "httplog"
@@ -0,0 +1,6 @@
+// Host stand-in for esp_attr.h (placement attributes are meaningless on the host)
+#pragma once
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
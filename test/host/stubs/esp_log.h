@@ -0,0 +1,11 @@
+// Host stand-in for esp_log.h (warnings and errors go to stderr, info and
+// debug lines are compiled but never printed)
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { if (0) { fprintf(stderr, "%s: " fmt "\n", tag, ##__VA_ARGS__); } } while (0)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,2 @@
+// Host stand-in for esp_now.h (espnow_driver.h only needs it to exist)
+#pragma once
@@ -0,0 +1,13 @@
+// Host stand-in for esp_system.h: every host run is a power-on reset
+#pragma once
+
+#include "esp_err.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_SW,
+    ESP_RST_DEEPSLEEP,
+} esp_reset_reason_t;
+
+esp_reset_reason_t esp_reset_reason(void);
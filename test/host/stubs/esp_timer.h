@@ -0,0 +1,6 @@
+// Host stand-in for esp_timer.h (monotonic clock in µs)
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,20 @@
+// Host stand-in for freertos/FreeRTOS.h (one tick per ms, no scheduler)
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         do { (void)(mux); } while (0)
+#define portEXIT_CRITICAL(mux)          do { (void)(mux); } while (0)
+#define portYIELD_FROM_ISR(...)         do { } while (0)
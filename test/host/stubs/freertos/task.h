@@ -0,0 +1,8 @@
+// Host stand-in for freertos/task.h: delays return at once, so the host
+// timings leave out the pauses the firmware makes between flash or SPI steps
+#pragma once
+
+#include "FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
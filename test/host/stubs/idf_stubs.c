@@ -0,0 +1,286 @@
+/**
+ * @file idf_stubs.c
+ * @brief Host implementations behind the stand-in IDF headers
+ *
+ * Flash partitions are RAM arrays with NOR semantics, SPI transfers and GPIOs
+ * do nothing, delays return at once and semaphores only count. Enough for
+ * flash_log, http_buffer and the e-paper framebuffer code to run unchanged.
+ */
+
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "perf_profiler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Partitions
+// ============================================================================
+
+#define HOST_PARTITIONS     4
+
+static struct {
+    esp_partition_t part;
+    uint8_t *data;
+} s_partitions[HOST_PARTITIONS];
+static int s_partition_count = 0;
+
+esp_err_t host_partition_add(const char *label, uint32_t size)
+{
+    if (s_partition_count >= HOST_PARTITIONS) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t *data = malloc(size);
+    if (data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(data, 0xFF, size);
+
+    esp_partition_t *p = &s_partitions[s_partition_count].part;
+    p->type = ESP_PARTITION_TYPE_DATA;
+    p->subtype = ESP_PARTITION_SUBTYPE_ANY;
+    p->address = 0x310000u + (uint32_t)s_partition_count * 0x100000u;
+    p->size = size;
+    strncpy(p->label, label, sizeof(p->label) - 1);
+    s_partitions[s_partition_count].data = data;
+    s_partition_count++;
+    return ESP_OK;
+}
+
+static uint8_t *partition_data(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    for (int i = 0; i < s_partition_count; i++) {
+        if (&s_partitions[i].part == partition) {
+            return (offset + size <= partition->size) ? s_partitions[i].data + offset : NULL;
+        }
+    }
+    return NULL;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (int i = 0; i < s_partition_count; i++) {
+        const esp_partition_t *p = &s_partitions[i].part;
+        if (p->type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (label == NULL || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    uint8_t *src = partition_data(partition, src_offset, size);
+    if (src == NULL) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, src, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    uint8_t *dst = partition_data(partition, dst_offset, size);
+    if (dst == NULL) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // Programming only clears bits
+    const uint8_t *in = src;
+    for (size_t i = 0; i < size; i++) {
+        dst[i] &= in[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    uint8_t *dst = partition_data(partition, offset, size);
+    if (dst == NULL || offset % 4096 != 0 || size % 4096 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(dst, 0xFF, size);
+    return ESP_OK;
+}
+
+// ============================================================================
+// System, timer, profiler
+// ============================================================================
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void perf_phase_begin(perf_phase_t phase)
+{
+    (void)phase;
+}
+
+void perf_phase_end(perf_phase_t phase)
+{
+    (void)phase;
+}
+
+// ============================================================================
+// FreeRTOS
+// ============================================================================
+
+void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+// Same layout as StaticSemaphore_t, so a static buffer can serve as the semaphore
+struct host_semaphore {
+    int count;
+};
+
+static SemaphoreHandle_t semaphore_create(int count)
+{
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+    if (sem != NULL) {
+        sem->count = count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    SemaphoreHandle_t sem = (SemaphoreHandle_t)buffer;
+    sem->count = 1;
+    return sem;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    if (sem == NULL || sem->count == 0) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (sem == NULL || sem->count > 0) {
+        return pdFALSE;
+    }
+    sem->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+// ============================================================================
+// GPIO and SPI
+// ============================================================================
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return 0;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config, int dma_chan)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks_to_wait)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans,
+                                      TickType_t ticks_to_wait)
+{
+    return ESP_ERR_TIMEOUT;
+}
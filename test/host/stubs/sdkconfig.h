@@ -0,0 +1,2 @@
+// Host stand-in for the generated sdkconfig.h: Kconfig defaults apply
+#pragma once
@@ -0,0 +1,409 @@
+/**
+ * @file test_codecs.c
+ * @brief Host tests of the hardware-free encoders
+ *
+ * Each case encodes known input and checks the exact output, or decodes
+ * what it encoded and compares it to the input. Exits non-zero on the
+ * first failing check of any case.
+ */
+
+#include "line_protocol.h"
+#include "mqtt_payload.h"
+#include "sample_frame.h"
+#include "sample_block.h"
+#include "report_policy.h"
+#include "espnow_fragment.h"
+#include "espnow_reassembly.h"
+#include "gzip_deflate.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static int s_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failures++;                                                   \
+            return;                                                         \
+        }                                                                   \
+    } while (0)
+
+// Decoded value within half a quantization step of the input
+static int near(float decoded, float expected, float scale)
+{
+    return fabsf(decoded - expected) <= 0.5f / scale + 1e-6f;
+}
+
+// ============================================================================
+// Line protocol / MQTT payload
+// ============================================================================
+
+static void test_line_protocol(void)
+{
+    char buf[128];
+    lp_writer_t w;
+    lp_writer_init(&w, buf, sizeof(buf), 0);
+    lp_begin(&w, "soil");
+    lp_tag(&w, "device", "bed 1");
+    lp_field_float(&w, "moisture", 41.5f, 2);
+    lp_field_int(&w, "raw", 1234);
+    lp_timestamp(&w, 1760000000000000000ULL);
+    CHECK(lp_end(&w) == ESP_OK);
+
+    const char* expected = "soil,device=bed\\ 1 moisture=41.50,raw=1234i 1760000000000000000\n";
+    CHECK(w.len == strlen(expected));
+    CHECK(memcmp(buf, expected, w.len) == 0);
+
+    // A line that does not fit is rolled back, the previous one stays
+    size_t first = w.len;
+    lp_writer_init(&w, buf, first + 8, first);
+    lp_begin(&w, "soil");
+    lp_field_float(&w, "moisture", 41.5f, 2);
+    CHECK(lp_end(&w) == ESP_ERR_NO_MEM);
+    CHECK(w.len == first);
+    CHECK(memcmp(buf, expected, first) == 0);
+
+    // A point without fields is not written
+    lp_writer_init(&w, buf, sizeof(buf), 0);
+    lp_begin(&w, "soil");
+    lp_field_float(&w, "moisture", NAN, 2);
+    CHECK(lp_end(&w) == ESP_ERR_INVALID_STATE);
+    CHECK(w.len == 0);
+}
+
+static void test_mqtt_json(void)
+{
+    char buf[96];
+    mqtt_payload_t p;
+    mqtt_payload_init(&p, MQTT_PAYLOAD_JSON, buf, sizeof(buf));
+    mqtt_payload_string(&p, "device_id", "node\"1");
+    mqtt_payload_float(&p, "temperature", 21.25f, 2);
+    mqtt_payload_int(&p, "rssi", -61);
+    CHECK(mqtt_payload_end(&p) == ESP_OK);
+
+    const char* expected = "{\"device_id\":\"node\\\"1\",\"temperature\":21.25,\"rssi\":-61}";
+    CHECK(p.len == strlen(expected));
+    CHECK(memcmp(buf, expected, p.len) == 0);
+}
+
+// ============================================================================
+// Sample frame
+// ============================================================================
+
+static void test_sample_frame(void)
+{
+    const sample_frame_record_t in[] = {
+        { .type = SAMPLE_FRAME_SOIL, .device_id = "soil-1", .timestamp_ms = 1760000000123ULL,
+          .aux = 2048, .v = { 1.234f, 41.57f } },
+        { .type = SAMPLE_FRAME_BATTERY, .device_id = "node-1", .timestamp_ms = 1760000001000ULL,
+          .v = { 3.912f, 87.4f } },
+        { .type = SAMPLE_FRAME_ENV, .device_id = "env-1", .timestamp_ms = 1760000000999ULL,
+          .v = { -4.25f, 63.01f } },
+        { .type = SAMPLE_FRAME_SOIL, .device_id = "soil-1", .timestamp_ms = 1760000060123ULL,
+          .aux = 2050, .v = { 1.236f, 41.49f } },
+    };
+    const size_t count = sizeof(in) / sizeof(in[0]);
+
+    static uint8_t buf[SAMPLE_FRAME_MAX_SIZE];
+    static sample_frame_writer_t w;
+    sample_frame_writer_init(&w, buf, sizeof(buf), 1760000000000ULL);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(sample_frame_add(&w, &in[i]) == ESP_OK);
+    }
+    size_t len = sample_frame_finish(&w);
+    CHECK(len > 0);
+    CHECK(sample_frame_is_frame(buf, len));
+
+    static sample_frame_reader_t r;
+    CHECK(sample_frame_reader_init(&r, buf, len) == ESP_OK);
+    for (size_t i = 0; i < count; i++) {
+        sample_frame_record_t out;
+        CHECK(sample_frame_next(&r, &out) == ESP_OK);
+        CHECK(out.type == in[i].type);
+        CHECK(strcmp(out.device_id, in[i].device_id) == 0);
+        CHECK(out.timestamp_ms == in[i].timestamp_ms);
+        CHECK(out.aux == in[i].aux);
+        for (int k = 0; k < 2; k++) {
+            CHECK(near(out.v[k], in[i].v[k], sample_frame_scale(in[i].type, 0, k)));
+        }
+    }
+    sample_frame_record_t out;
+    CHECK(sample_frame_next(&r, &out) == ESP_ERR_NOT_FOUND);
+
+    // A truncated frame is rejected
+    CHECK(sample_frame_reader_init(&r, buf, len - 1) != ESP_OK);
+}
+
+// ============================================================================
+// Sample block
+// ============================================================================
+
+// Nearest multiple of a timestamp unit
+static uint64_t round_to_unit(uint64_t ms, uint16_t unit_ms)
+{
+    return (ms + unit_ms / 2) / unit_ms * unit_ms;
+}
+
+static void check_block_round_trip(uint64_t ref_ms, uint16_t unit_ms)
+{
+    static sample_frame_record_t in[40];
+    size_t count = 0;
+    for (int i = 0; i < 12; i++) {
+        // Soil on a 60 s grid with wake jitter, battery every other wake
+        uint64_t t = 1760000000400ULL + (uint64_t)i * 60000 + (uint64_t)((i * 37) % 201);
+        in[count++] = (sample_frame_record_t){ .type = SAMPLE_FRAME_SOIL, .device_id = "soil-1",
+            .timestamp_ms = t, .aux = 2048 + i, .v = { 1.234f + i * 0.001f, 41.57f - i * 0.03f } };
+        if (i % 2 == 0) {
+            in[count++] = (sample_frame_record_t){ .type = SAMPLE_FRAME_BATTERY, .device_id = "node-1",
+                .timestamp_ms = t + 15, .v = { 3.912f - i * 0.002f, (i < 6) ? 87.4f : -1.0f } };
+        }
+    }
+    in[count++] = (sample_frame_record_t){ .type = SAMPLE_FRAME_WINDOW, .device_id = "env-1",
+        .timestamp_ms = 1760000600000ULL, .metric = REPORT_METRIC_TEMPERATURE, .aux = 600,
+        .count = 10, .v = { -4.25f, 2.5f, -0.87f } };
+
+    static uint8_t buf[SAMPLE_FRAME_MAX_SIZE];
+    static sample_block_writer_t w;
+    sample_block_writer_init(&w, buf, sizeof(buf), ref_ms, unit_ms, 0);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(sample_block_add(&w, &in[i]) == ESP_OK);
+    }
+    size_t len = sample_block_finish(&w);
+    CHECK(len > 0);
+    CHECK(sample_block_is_block(buf, len));
+
+    static sample_block_reader_t r;
+    CHECK(sample_block_reader_init(&r, buf, len) == ESP_OK);
+    for (size_t i = 0; i < count; i++) {
+        sample_frame_record_t out;
+        CHECK(sample_block_next(&r, &out) == ESP_OK);
+        CHECK(out.type == in[i].type);
+        CHECK(strcmp(out.device_id, in[i].device_id) == 0);
+        CHECK(out.timestamp_ms == round_to_unit(in[i].timestamp_ms, unit_ms));
+        CHECK(out.aux == in[i].aux);
+        int fields = 2;
+        if (in[i].type == SAMPLE_FRAME_WINDOW) {
+            CHECK(out.metric == in[i].metric);
+            CHECK(out.count == in[i].count);
+            fields = 3;
+        }
+        for (int k = 0; k < fields; k++) {
+            CHECK(near(out.v[k], in[i].v[k], sample_frame_scale(in[i].type, in[i].metric, k)));
+        }
+    }
+    sample_frame_record_t out;
+    CHECK(sample_block_next(&r, &out) == ESP_ERR_NOT_FOUND);
+}
+
+static void test_sample_block(void)
+{
+    check_block_round_trip(1760000000000ULL, 1);
+    check_block_round_trip(1760000000123ULL, 1);
+    // A reference off the unit grid must not shift decoded timestamps
+    check_block_round_trip(1760000000123ULL, 1000);
+    check_block_round_trip(1760000000999ULL, 1000);
+}
+
+// ============================================================================
+// ESP-NOW fragmentation and reassembly
+// ============================================================================
+
+static void test_espnow_fragment(void)
+{
+    static const uint8_t mac[6] = { 0x24, 0x0A, 0xC4, 0x01, 0x02, 0x03 };
+    static uint8_t msg[2 * ESPNOW_MAX_PAYLOAD_SIZE + 50];
+    static espnow_packet_t packets[ESPNOW_MAX_CHUNKS];
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    uint8_t total = espnow_fragment(packets, msg, sizeof(msg), 5, 0x1234, true, true);
+    CHECK(total == 3);
+    for (uint8_t i = 0; i < total; i++) {
+        const espnow_packet_header_t* hdr = &packets[i].header;
+        CHECK(hdr->node_id == 5);
+        CHECK(hdr->packet_sequence == 0x1234);
+        CHECK(hdr->total_chunks == (3 | ESPNOW_HEADER_CRC));
+        CHECK(hdr->chunk_index == (i | ESPNOW_CHUNK_ACK_REQUEST));
+        CHECK(hdr->payload_length == ((i < 2) ? ESPNOW_MAX_PAYLOAD_SIZE : 50));
+        CHECK(hdr->crc16 == espnow_frame_crc16(hdr, packets[i].payload));
+    }
+
+    // The header CRC covers the header fields
+    espnow_packet_t tampered = packets[0];
+    tampered.header.packet_sequence++;
+    CHECK(tampered.header.crc16 != espnow_frame_crc16(&tampered.header, tampered.payload));
+
+    // Out of order with a duplicate: only the last missing chunk completes the message
+    espnow_reassembly_reset();
+    const uint8_t* out = NULL;
+    size_t out_len = 0;
+    uint32_t ack_mask = 0;
+    CHECK(espnow_reassembly_feed(mac, &packets[2], 0, &out, &out_len, &ack_mask) == ESP_ERR_NOT_FINISHED);
+    CHECK(espnow_reassembly_feed(mac, &packets[0], 1, &out, &out_len, &ack_mask) == ESP_ERR_NOT_FINISHED);
+    CHECK(espnow_reassembly_feed(mac, &packets[0], 2, &out, &out_len, &ack_mask) == ESP_ERR_INVALID_STATE);
+    CHECK(espnow_reassembly_feed(mac, &packets[1], 3, &out, &out_len, &ack_mask) == ESP_OK);
+    CHECK(ack_mask == 0x7);
+    CHECK(out_len == sizeof(msg));
+    CHECK(memcmp(out, msg, sizeof(msg)) == 0);
+
+    // A retransmission of the completed message is a duplicate
+    CHECK(espnow_reassembly_feed(mac, &packets[1], 4, &out, &out_len, &ack_mask) == ESP_ERR_INVALID_STATE);
+
+    // Messages above the send-side limit are refused
+    static uint8_t big[ESPNOW_MAX_CHUNKS * ESPNOW_MAX_PAYLOAD_SIZE + 1];
+    for (size_t i = 0; i < sizeof(big); i++) {
+        big[i] = (uint8_t)(i * 13 + 1);
+    }
+    CHECK(espnow_fragment(packets, big, sizeof(big), 5, 1, false, false) == 0);
+    CHECK(espnow_fragment(packets, big, sizeof(big) - 1, 5, 1, false, false) == ESPNOW_MAX_CHUNKS);
+
+    // The largest message the sender accepts is one the receiver reassembles
+    espnow_reassembly_reset();
+    for (uint8_t i = 0; i < ESPNOW_MAX_CHUNKS; i++) {
+        esp_err_t expect = (i + 1 < ESPNOW_MAX_CHUNKS) ? ESP_ERR_NOT_FINISHED : ESP_OK;
+        CHECK(espnow_reassembly_feed(mac, &packets[i], 10, &out, &out_len, &ack_mask) == expect);
+    }
+    CHECK(out_len == sizeof(big) - 1);
+    CHECK(memcmp(out, big, out_len) == 0);
+}
+
+// ============================================================================
+// gzip
+// ============================================================================
+
+// Inflate a gzip member with zlib; returns the inflated length or -1 on any error
+static long gunzip(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return -1;
+    }
+    zs.next_in = (Bytef*)in;
+    zs.avail_in = (uInt)in_len;
+    zs.next_out = out;
+    zs.avail_out = (uInt)out_cap;
+    int ret = inflate(&zs, Z_FINISH);
+    long len = (ret == Z_STREAM_END && zs.avail_in == 0) ? (long)zs.total_out : -1;
+    inflateEnd(&zs);
+    return len;
+}
+
+// Compress with room to spare, inflate with zlib and compare
+static void check_gzip_round_trip(const uint8_t* in, size_t in_len)
+{
+    size_t cap = in_len + in_len / 8 + 64;
+    uint8_t* packed = malloc(cap);
+    uint8_t* unpacked = malloc(in_len + 1);
+    CHECK(packed != NULL && unpacked != NULL);
+
+    size_t packed_len = 0;
+    esp_err_t ret = gzip_compress(in, in_len, packed, cap, &packed_len);
+    long unpacked_len = (ret == ESP_OK) ? gunzip(packed, packed_len, unpacked, in_len + 1) : -1;
+    int same = unpacked_len == (long)in_len && memcmp(unpacked, in, in_len) == 0;
+    free(packed);
+    free(unpacked);
+    CHECK(ret == ESP_OK);
+    CHECK(same);
+}
+
+// 32 soil points as influxdb_batch_add_soil() writes them
+static size_t make_soil_batch(char* buf, size_t cap)
+{
+    lp_writer_t w;
+    lp_writer_init(&w, buf, cap, 0);
+    for (int i = 0; i < 32; i++) {
+        lp_begin(&w, "soil_moisture");
+        lp_tag(&w, "device", "ESP32C6_A1B2C3");
+        lp_field_float(&w, "voltage", 1.234f + (i % 5) * 0.001f, 3);
+        lp_field_float(&w, "moisture_percent", 56.78f - (i % 7) * 0.11f, 2);
+        lp_field_float(&w, "raw_adc", (float)(2345 + i % 9), 0);
+        lp_timestamp(&w, 1760000000000000000ULL + (uint64_t)i * 60000000000ULL);
+        if (lp_end(&w) != ESP_OK) {
+            return 0;
+        }
+    }
+    return w.len;
+}
+
+static void test_gzip(void)
+{
+    static uint8_t buf[4096];
+
+    // Empty input and matches of exactly 3 and of the 258 maximum
+    check_gzip_round_trip(buf, 0);
+    const char* short_match = "abcXYZabcQ";
+    check_gzip_round_trip((const uint8_t*)short_match, strlen(short_match));
+    memset(buf, 'a', 1 + 258 + 258 + 3);
+    check_gzip_round_trip(buf, 1 + 258 + 258 + 3);
+    for (size_t i = 0; i < 600; i++) {
+        buf[i] = (uint8_t)"0123456789"[i % 10];
+    }
+    check_gzip_round_trip(buf, 600);
+
+    // Incompressible input still decodes with room to spare
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 24);
+    }
+    check_gzip_round_trip(buf, sizeof(buf));
+
+    // ...but overflows a buffer the size of the input: no byte past out_cap is written,
+    // and the body is sent plain
+    static uint8_t out[sizeof(buf) + 16];
+    size_t out_len = 0;
+    memset(out, 0xEE, sizeof(out));
+    CHECK(gzip_compress(buf, sizeof(buf), out, sizeof(buf), &out_len) == ESP_ERR_NO_MEM);
+    for (size_t i = sizeof(buf); i < sizeof(out); i++) {
+        CHECK(out[i] == 0xEE);
+    }
+    CHECK(gzip_compress_body(buf, sizeof(buf), 512, &out_len) == NULL);
+
+    // A line protocol batch shrinks at least 4x, and a body below the minimum is left alone
+    static char batch[4096];
+    size_t batch_len = make_soil_batch(batch, sizeof(batch));
+    CHECK(batch_len > 0);
+    check_gzip_round_trip((const uint8_t*)batch, batch_len);
+    uint8_t* packed = gzip_compress_body((const uint8_t*)batch, batch_len, 512, &out_len);
+    CHECK(packed != NULL);
+    free(packed);
+    CHECK(out_len * 4 <= batch_len);
+    CHECK(gzip_compress_body((const uint8_t*)batch, 511, 512, &out_len) == NULL);
+
+    // Every capacity below the compressed size is refused without writing past it
+    for (size_t cap = 0; cap < out_len; cap++) {
+        memset(out, 0xEE, sizeof(out));
+        size_t len = 0;
+        CHECK(gzip_compress((const uint8_t*)batch, batch_len, out, cap, &len) == ESP_ERR_NO_MEM);
+        CHECK(out[cap] == 0xEE);
+    }
+    size_t len = 0;
+    CHECK(gzip_compress((const uint8_t*)batch, batch_len, out, out_len, &len) == ESP_OK);
+    CHECK(len == out_len);
+}
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+int main(void)
+{
+    test_line_protocol();
+    test_mqtt_json();
+    test_sample_frame();
+    test_sample_block();
+    test_espnow_fragment();
+    test_gzip();
+
+    if (s_failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("All codec tests passed\n");
+    return 0;
+}